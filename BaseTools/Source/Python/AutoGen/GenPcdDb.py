@@ -1,7 +1,7 @@
 ## @file
 # Routines for generating Pcd Database
 #
-# Copyright (c) 2013 - 2018, Intel Corporation. All rights reserved.<BR>
+# Copyright (c) 2013 - 2020, Intel Corporation. All rights reserved.<BR>
 # SPDX-License-Identifier: BSD-2-Clause-Patent
 #
 from __future__ import absolute_import
@@ -20,7 +20,7 @@ from Common import GlobalData
 from Common import EdkLogger
 import Common.LongFilePathOs as os
 
-DATABASE_VERSION = 7
+DATABASE_VERSION = 8
 
 gPcdDatabaseAutoGenC = TemplateString("""
 //
@@ -1550,6 +1550,17 @@ def CreatePcdDatabasePhaseSpecificAutoGen (Platform, DynamicPcdList, Phase):
         Dict['EXMAP_TABLE_EMPTY']    = 'FALSE'
         Dict['EXMAPPING_TABLE_SIZE'] = str(NumberOfExTokens) + 'U'
         Dict['EX_TOKEN_NUMBER']      = str(NumberOfExTokens) + 'U'
+        #
+        # Since database version 8, the PCD driver/PEIM binary searches the
+        # ExMapTable, so sort it by {token space GUID index, ExTokenNumber}.
+        #
+        ExMapTable = sorted(
+                       zip(Dict['EXMAPPING_TABLE_EXTOKEN'], Dict['EXMAPPING_TABLE_LOCAL_TOKEN'], Dict['EXMAPPING_TABLE_GUID_INDEX']),
+                       key=lambda Item: (GetIntegerValue(Item[2]), GetIntegerValue(Item[0]))
+                       )
+        Dict['EXMAPPING_TABLE_EXTOKEN']     = [Item[0] for Item in ExMapTable]
+        Dict['EXMAPPING_TABLE_LOCAL_TOKEN'] = [Item[1] for Item in ExMapTable]
+        Dict['EXMAPPING_TABLE_GUID_INDEX']  = [Item[2] for Item in ExMapTable]
     else:
         Dict['EXMAPPING_TABLE_EXTOKEN'].append('0U')
         Dict['EXMAPPING_TABLE_LOCAL_TOKEN'].append('0U')
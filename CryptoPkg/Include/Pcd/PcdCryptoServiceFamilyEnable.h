@@ -91,6 +91,7 @@ typedef struct {
       UINT8  Pkcs7GetCertificatesList:1;
       UINT8  AuthenticodeVerify:1;
       UINT8  ImageTimestampVerify:1;
+      UINT8  Pkcs7VerifyWithX509:1;
     } Services;
     UINT32    Family;
   } Pkcs;
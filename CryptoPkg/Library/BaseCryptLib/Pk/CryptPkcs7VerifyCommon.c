@@ -7,10 +7,10 @@
   This external input must be validated carefully to avoid security issue like
   buffer overflow, integer overflow.
 
-  WrapPkcs7Data(), Pkcs7GetSigners(), Pkcs7Verify() will get UEFI Authenticated
-  Variable and will do basic check for data structure.
+  WrapPkcs7Data(), Pkcs7GetSigners(), Pkcs7Verify(), Pkcs7VerifyWithX509() will
+  get UEFI Authenticated Variable and will do basic check for data structure.
 
-Copyright (c) 2009 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -735,23 +735,28 @@ _Error:
 
 /**
   Verifies the validity of a PKCS#7 signed data as described in "PKCS #7:
-  Cryptographic Message Syntax Standard". The input signed data could be wrapped
-  in a ContentInfo structure.
+  Cryptographic Message Syntax Standard" against a list of trusted certificates,
+  which are already constructed as X509 objects. The input signed data could be
+  wrapped in a ContentInfo structure.
 
-  If P7Data, TrustedCert or InData is NULL, then return FALSE.
-  If P7Length, CertLength or DataLength overflow, then return FALSE.
+  The signed data is parsed once, and verified against every trusted certificate
+  in turn, so it is valid if Pkcs7Verify() would accept it with any of them.
+
+  If P7Data, TrustedCerts or InData is NULL, then return FALSE.
+  If P7Length or DataLength overflow, then return FALSE.
 
   Caution: This function may receive untrusted input.
   UEFI Authenticated Variable is external input, so this function will do basic
   check for PKCS#7 data structure.
 
-  @param[in]  P7Data       Pointer to the PKCS#7 message to verify.
-  @param[in]  P7Length     Length of the PKCS#7 message in bytes.
-  @param[in]  TrustedCert  Pointer to a trusted/root certificate encoded in DER, which
-                           is used for certificate chain verification.
-  @param[in]  CertLength   Length of the trusted certificate in bytes.
-  @param[in]  InData       Pointer to the content to be verified.
-  @param[in]  DataLength   Length of InData in bytes.
+  @param[in]  P7Data        Pointer to the PKCS#7 message to verify.
+  @param[in]  P7Length      Length of the PKCS#7 message in bytes.
+  @param[in]  TrustedCerts  Array of trusted/root certificates constructed by
+                            X509ConstructCertificate(), which are used for
+                            certificate chain verification.
+  @param[in]  CertCount     Number of certificates in TrustedCerts.
+  @param[in]  InData        Pointer to the content to be verified.
+  @param[in]  DataLength    Length of InData in bytes.
 
   @retval  TRUE  The specified PKCS#7 signed data is valid.
   @retval  FALSE Invalid PKCS#7 signed data.
@@ -759,11 +764,11 @@ _Error:
 **/
 BOOLEAN
 EFIAPI
-Pkcs7Verify (
+Pkcs7VerifyWithX509 (
   IN  CONST UINT8  *P7Data,
   IN  UINTN        P7Length,
-  IN  CONST UINT8  *TrustedCert,
-  IN  UINTN        CertLength,
+  IN  VOID         **TrustedCerts,
+  IN  UINTN        CertCount,
   IN  CONST UINT8  *InData,
   IN  UINTN        DataLength
   )
@@ -771,24 +776,23 @@ Pkcs7Verify (
   PKCS7       *Pkcs7;
   BIO         *DataBio;
   BOOLEAN     Status;
-  X509        *Cert;
   X509_STORE  *CertStore;
   UINT8       *SignedData;
   CONST UINT8 *Temp;
   UINTN       SignedDataSize;
   BOOLEAN     Wrapped;
+  UINTN       Index;
 
   //
   // Check input parameters.
   //
-  if (P7Data == NULL || TrustedCert == NULL || InData == NULL ||
-    P7Length > INT_MAX || CertLength > INT_MAX || DataLength > INT_MAX) {
+  if (P7Data == NULL || TrustedCerts == NULL || InData == NULL ||
+    P7Length > INT_MAX || DataLength > INT_MAX) {
     return FALSE;
   }
 
   Pkcs7     = NULL;
   DataBio   = NULL;
-  Cert      = NULL;
   CertStore = NULL;
 
   //
@@ -840,64 +844,66 @@ Pkcs7Verify (
     goto _Exit;
   }
 
-  //
-  // Read DER-encoded root certificate and Construct X509 Certificate
-  //
-  Temp = TrustedCert;
-  Cert = d2i_X509 (NULL, &Temp, (long) CertLength);
-  if (Cert == NULL) {
-    goto _Exit;
-  }
+  for (Index = 0; Index < CertCount && !Status; Index++) {
+    if (TrustedCerts[Index] == NULL) {
+      continue;
+    }
 
-  //
-  // Setup X509 Store for trusted certificate
-  //
-  CertStore = X509_STORE_new ();
-  if (CertStore == NULL) {
-    goto _Exit;
-  }
-  if (!(X509_STORE_add_cert (CertStore, Cert))) {
-    goto _Exit;
-  }
+    //
+    // Setup X509 Store for trusted certificate
+    //
+    CertStore = X509_STORE_new ();
+    if (CertStore == NULL) {
+      goto _Exit;
+    }
+    if (!(X509_STORE_add_cert (CertStore, (X509 *) TrustedCerts[Index]))) {
+      goto _Exit;
+    }
 
-  //
-  // For generic PKCS#7 handling, InData may be NULL if the content is present
-  // in PKCS#7 structure. So ignore NULL checking here.
-  //
-  DataBio = BIO_new (BIO_s_mem ());
-  if (DataBio == NULL) {
-    goto _Exit;
-  }
+    //
+    // For generic PKCS#7 handling, InData may be NULL if the content is present
+    // in PKCS#7 structure. So ignore NULL checking here.
+    // PKCS7_verify() consumes the data, so every certificate gets its own BIO.
+    //
+    DataBio = BIO_new (BIO_s_mem ());
+    if (DataBio == NULL) {
+      goto _Exit;
+    }
 
-  if (BIO_write (DataBio, InData, (int) DataLength) <= 0) {
-    goto _Exit;
-  }
+    if (BIO_write (DataBio, InData, (int) DataLength) <= 0) {
+      goto _Exit;
+    }
 
-  //
-  // Allow partial certificate chains, terminated by a non-self-signed but
-  // still trusted intermediate certificate. Also disable time checks.
-  //
-  X509_STORE_set_flags (CertStore,
-                        X509_V_FLAG_PARTIAL_CHAIN | X509_V_FLAG_NO_CHECK_TIME);
+    //
+    // Allow partial certificate chains, terminated by a non-self-signed but
+    // still trusted intermediate certificate. Also disable time checks.
+    //
+    X509_STORE_set_flags (CertStore,
+                          X509_V_FLAG_PARTIAL_CHAIN | X509_V_FLAG_NO_CHECK_TIME);
 
-  //
-  // OpenSSL PKCS7 Verification by default checks for SMIME (email signing) and
-  // doesn't support the extended key usage for Authenticode Code Signing.
-  // Bypass the certificate purpose checking by enabling any purposes setting.
-  //
-  X509_STORE_set_purpose (CertStore, X509_PURPOSE_ANY);
+    //
+    // OpenSSL PKCS7 Verification by default checks for SMIME (email signing) and
+    // doesn't support the extended key usage for Authenticode Code Signing.
+    // Bypass the certificate purpose checking by enabling any purposes setting.
+    //
+    X509_STORE_set_purpose (CertStore, X509_PURPOSE_ANY);
 
-  //
-  // Verifies the PKCS#7 signedData structure
-  //
-  Status = (BOOLEAN) PKCS7_verify (Pkcs7, NULL, CertStore, DataBio, NULL, PKCS7_BINARY);
+    //
+    // Verifies the PKCS#7 signedData structure
+    //
+    Status = (BOOLEAN) PKCS7_verify (Pkcs7, NULL, CertStore, DataBio, NULL, PKCS7_BINARY);
+
+    BIO_free (DataBio);
+    DataBio = NULL;
+    X509_STORE_free (CertStore);
+    CertStore = NULL;
+  }
 
 _Exit:
   //
   // Release Resources
   //
   BIO_free (DataBio);
-  X509_free (Cert);
   X509_STORE_free (CertStore);
   PKCS7_free (Pkcs7);
 
@@ -908,3 +914,66 @@ _Exit:
   return Status;
 }
 
+/**
+  Verifies the validity of a PKCS#7 signed data as described in "PKCS #7:
+  Cryptographic Message Syntax Standard". The input signed data could be wrapped
+  in a ContentInfo structure.
+
+  If P7Data, TrustedCert or InData is NULL, then return FALSE.
+  If P7Length, CertLength or DataLength overflow, then return FALSE.
+
+  Caution: This function may receive untrusted input.
+  UEFI Authenticated Variable is external input, so this function will do basic
+  check for PKCS#7 data structure.
+
+  @param[in]  P7Data       Pointer to the PKCS#7 message to verify.
+  @param[in]  P7Length     Length of the PKCS#7 message in bytes.
+  @param[in]  TrustedCert  Pointer to a trusted/root certificate encoded in DER, which
+                           is used for certificate chain verification.
+  @param[in]  CertLength   Length of the trusted certificate in bytes.
+  @param[in]  InData       Pointer to the content to be verified.
+  @param[in]  DataLength   Length of InData in bytes.
+
+  @retval  TRUE  The specified PKCS#7 signed data is valid.
+  @retval  FALSE Invalid PKCS#7 signed data.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7Verify (
+  IN  CONST UINT8  *P7Data,
+  IN  UINTN        P7Length,
+  IN  CONST UINT8  *TrustedCert,
+  IN  UINTN        CertLength,
+  IN  CONST UINT8  *InData,
+  IN  UINTN        DataLength
+  )
+{
+  BOOLEAN     Status;
+  X509        *Cert;
+  CONST UINT8 *Temp;
+
+  //
+  // Check input parameters.
+  //
+  if (P7Data == NULL || TrustedCert == NULL || InData == NULL ||
+    P7Length > INT_MAX || CertLength > INT_MAX || DataLength > INT_MAX) {
+    return FALSE;
+  }
+
+  //
+  // Read DER-encoded root certificate and Construct X509 Certificate
+  //
+  Temp = TrustedCert;
+  Cert = d2i_X509 (NULL, &Temp, (long) CertLength);
+  if (Cert == NULL) {
+    return FALSE;
+  }
+
+  Status = Pkcs7VerifyWithX509 (P7Data, P7Length, (VOID **) &Cert, 1, InData, DataLength);
+
+  X509_free (Cert);
+
+  return Status;
+}
+
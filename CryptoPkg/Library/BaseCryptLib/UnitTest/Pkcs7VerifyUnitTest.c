@@ -0,0 +1,526 @@
+/** @file
+  Unit tests of Pkcs7VerifyWithX509 (). Its results are compared with the
+  results of Pkcs7Verify () for a valid SignedData, a SignedData checked
+  against a certificate that did not sign it, and tampered content and
+  SignedData, and both are timed.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "PKCS7 Verification With X509 Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// The number of verifications timed for each of Pkcs7Verify () and
+// Pkcs7VerifyWithX509 ().
+//
+#define TEST_TIMED_VERIFY_COUNT   200
+
+//
+// Content signed by mTestSignedData.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST CHAR8 mTestPayload[] = "Signed variable payload for the PKCS#7 verification unit test";
+
+//
+// DER encoded self-signed certificate of the signer (RSA 2048, CN=Pkcs7 Test Signer).
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 mTestSignerCert[] = {
+  0x30, 0x82, 0x03, 0x19, 0x30, 0x82, 0x02, 0x01, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x58,
+  0x58, 0x8a, 0xd0, 0xa7, 0x93, 0x04, 0x0f, 0x4b, 0xd0, 0x1c, 0x2f, 0xf7, 0xdf, 0x6b, 0x97, 0x84,
+  0x3b, 0x73, 0x52, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b,
+  0x05, 0x00, 0x30, 0x1c, 0x31, 0x1a, 0x30, 0x18, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x11, 0x50,
+  0x6b, 0x63, 0x73, 0x37, 0x20, 0x54, 0x65, 0x73, 0x74, 0x20, 0x53, 0x69, 0x67, 0x6e, 0x65, 0x72,
+  0x30, 0x1e, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x39, 0x30, 0x38, 0x33, 0x30, 0x34, 0x39,
+  0x5a, 0x17, 0x0d, 0x33, 0x36, 0x31, 0x30, 0x31, 0x36, 0x30, 0x38, 0x33, 0x30, 0x34, 0x39, 0x5a,
+  0x30, 0x1c, 0x31, 0x1a, 0x30, 0x18, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x11, 0x50, 0x6b, 0x63,
+  0x73, 0x37, 0x20, 0x54, 0x65, 0x73, 0x74, 0x20, 0x53, 0x69, 0x67, 0x6e, 0x65, 0x72, 0x30, 0x82,
+  0x01, 0x22, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x01, 0x05,
+  0x00, 0x03, 0x82, 0x01, 0x0f, 0x00, 0x30, 0x82, 0x01, 0x0a, 0x02, 0x82, 0x01, 0x01, 0x00, 0xa5,
+  0x32, 0x24, 0x80, 0xbf, 0x3d, 0x04, 0x66, 0x8a, 0xac, 0x33, 0x5b, 0xdd, 0x74, 0x56, 0x9a, 0xde,
+  0x8d, 0x3f, 0xf6, 0xc8, 0xa4, 0x46, 0x1e, 0xc7, 0x4f, 0x5a, 0x48, 0x43, 0xa2, 0xd4, 0xdb, 0x10,
+  0xa0, 0x60, 0xab, 0xc3, 0xa8, 0x2f, 0x1a, 0xe3, 0x48, 0x1f, 0x05, 0xc2, 0xbf, 0xd8, 0xfa, 0x4c,
+  0xd3, 0x10, 0x16, 0xc9, 0xb6, 0xeb, 0x1a, 0x1b, 0x7e, 0xc0, 0xcf, 0xa6, 0x9f, 0x35, 0xfd, 0xa8,
+  0xf6, 0x13, 0x05, 0x32, 0x82, 0xf7, 0x56, 0xad, 0x12, 0x17, 0xc1, 0xd2, 0xb6, 0x6d, 0x32, 0x92,
+  0xc2, 0xc6, 0x3c, 0x1a, 0x9d, 0x20, 0x88, 0xa7, 0x1b, 0x59, 0x0f, 0x6c, 0x3d, 0xdd, 0xd1, 0xc1,
+  0x9a, 0x24, 0x2d, 0xdb, 0xeb, 0x63, 0xe5, 0x37, 0x67, 0x7e, 0x68, 0x58, 0xbe, 0xc5, 0x74, 0x4a,
+  0xe2, 0x31, 0xe4, 0x3b, 0xd8, 0xb5, 0x2f, 0xd8, 0xd6, 0xc7, 0x61, 0x6b, 0x5c, 0x8b, 0x5b, 0xe5,
+  0x88, 0x23, 0x25, 0xb4, 0x79, 0x72, 0xf8, 0xa5, 0xca, 0xb0, 0xb6, 0x8f, 0x07, 0xcf, 0x55, 0xe5,
+  0x00, 0x56, 0x4e, 0x2c, 0x8a, 0x96, 0x39, 0x2a, 0x15, 0x47, 0xf3, 0x76, 0x4a, 0x29, 0x34, 0x66,
+  0xa9, 0xc9, 0xc6, 0x41, 0x66, 0x50, 0x13, 0x65, 0x50, 0xa2, 0xde, 0x42, 0x4c, 0x5b, 0x10, 0x4b,
+  0xb3, 0x5c, 0x4a, 0x43, 0xad, 0xb8, 0x2d, 0x29, 0x6a, 0x80, 0x2b, 0x1d, 0xee, 0x6a, 0xd0, 0x33,
+  0xc1, 0xfa, 0xea, 0x64, 0x37, 0x99, 0x3d, 0xb0, 0x7b, 0xfb, 0x72, 0xce, 0x17, 0x9b, 0xc3, 0x91,
+  0xda, 0x0f, 0x53, 0x14, 0x8c, 0x68, 0x9b, 0xde, 0xee, 0x79, 0x6d, 0xc8, 0x9d, 0xe6, 0x83, 0x33,
+  0x89, 0x0a, 0xa0, 0xc8, 0xf5, 0x10, 0x45, 0x97, 0x82, 0x18, 0x34, 0x85, 0x78, 0xaa, 0xc7, 0x82,
+  0x56, 0xab, 0x5c, 0x05, 0x59, 0x03, 0xa5, 0x9d, 0xee, 0xde, 0x1c, 0x13, 0xad, 0x36, 0x31, 0x02,
+  0x03, 0x01, 0x00, 0x01, 0xa3, 0x53, 0x30, 0x51, 0x30, 0x1d, 0x06, 0x03, 0x55, 0x1d, 0x0e, 0x04,
+  0x16, 0x04, 0x14, 0x4c, 0xe8, 0xc5, 0x51, 0x37, 0x16, 0x02, 0xe6, 0xb0, 0x4b, 0xcf, 0xd9, 0x95,
+  0x20, 0xb4, 0x3f, 0xbb, 0xb1, 0x0e, 0x7b, 0x30, 0x1f, 0x06, 0x03, 0x55, 0x1d, 0x23, 0x04, 0x18,
+  0x30, 0x16, 0x80, 0x14, 0x4c, 0xe8, 0xc5, 0x51, 0x37, 0x16, 0x02, 0xe6, 0xb0, 0x4b, 0xcf, 0xd9,
+  0x95, 0x20, 0xb4, 0x3f, 0xbb, 0xb1, 0x0e, 0x7b, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x1d, 0x13, 0x01,
+  0x01, 0xff, 0x04, 0x05, 0x30, 0x03, 0x01, 0x01, 0xff, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48,
+  0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00, 0x03, 0x82, 0x01, 0x01, 0x00, 0x13, 0x04, 0x91,
+  0xea, 0xd2, 0x37, 0xf0, 0x5a, 0x19, 0xad, 0x16, 0xac, 0x99, 0x26, 0xc5, 0x63, 0xf2, 0x5b, 0xe5,
+  0xc7, 0xb4, 0x3a, 0xee, 0x99, 0x67, 0x66, 0x13, 0x56, 0xf2, 0xe8, 0xfb, 0x2b, 0x38, 0xdc, 0xf9,
+  0xb4, 0x74, 0x0f, 0x98, 0x3a, 0xe2, 0xf5, 0x6f, 0xef, 0x4b, 0x26, 0x17, 0x4e, 0xfd, 0xf2, 0xb9,
+  0xd3, 0xb8, 0x0b, 0xb0, 0xb4, 0x63, 0x34, 0xd9, 0x43, 0x0d, 0x9e, 0x49, 0x42, 0xb5, 0xd8, 0xb7,
+  0x47, 0x63, 0xde, 0x8d, 0xde, 0x23, 0x1f, 0x52, 0x17, 0x2e, 0xe3, 0x1c, 0xad, 0x6e, 0x50, 0xd8,
+  0x10, 0x3d, 0x7e, 0x66, 0x56, 0xb6, 0xea, 0x5d, 0x7e, 0x10, 0x6c, 0x04, 0xc2, 0x98, 0x98, 0x2e,
+  0xe8, 0x43, 0x6c, 0x0c, 0xe1, 0x1d, 0x89, 0xef, 0x2e, 0x08, 0x2c, 0xaf, 0xe9, 0xcf, 0xc4, 0x94,
+  0x3d, 0xd1, 0x15, 0x89, 0x69, 0x5e, 0xcd, 0xdf, 0x9b, 0xa2, 0xa9, 0x85, 0x50, 0xee, 0xfa, 0xed,
+  0xc4, 0xdd, 0x1e, 0x92, 0x4a, 0xfb, 0x83, 0xae, 0x24, 0x22, 0x50, 0xc3, 0xef, 0x09, 0x05, 0xb1,
+  0x60, 0xa7, 0x5f, 0xea, 0x34, 0x1a, 0xdc, 0x16, 0x9d, 0x2a, 0x22, 0xff, 0xec, 0xe6, 0x92, 0x5a,
+  0x89, 0xa1, 0x4f, 0xba, 0x15, 0x13, 0x27, 0x5a, 0x62, 0xdb, 0x37, 0xfe, 0x8c, 0x85, 0xa5, 0x28,
+  0xbc, 0x6f, 0xd3, 0xad, 0xae, 0x7b, 0x6c, 0x18, 0xc7, 0xe8, 0xc1, 0x5a, 0xe6, 0xb0, 0x4b, 0xdc,
+  0x44, 0x2f, 0xe9, 0x1a, 0xda, 0xcd, 0x35, 0x71, 0xdc, 0xbe, 0xc4, 0x1d, 0x62, 0x16, 0x76, 0x33,
+  0x66, 0x81, 0x9b, 0xed, 0xdd, 0x11, 0xdc, 0x93, 0x7f, 0x00, 0xbc, 0xf2, 0x09, 0x6e, 0x06, 0xa3,
+  0x89, 0x4d, 0x5a, 0x02, 0x8a, 0xd0, 0x39, 0xa7, 0x1d, 0xe1, 0x82, 0x9a, 0x94, 0xd5, 0x7b, 0x4f,
+  0x93, 0xab, 0xfe, 0x3a, 0x72, 0xab, 0xf0, 0xa7, 0x85, 0xf0, 0x12, 0x0d, 0x6e
+};
+
+//
+// DER encoded self-signed certificate that did not sign the data (RSA 2048, CN=Pkcs7 Test Other).
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 mTestOtherCert[] = {
+  0x30, 0x82, 0x03, 0x17, 0x30, 0x82, 0x01, 0xff, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x6e,
+  0x71, 0xfb, 0x71, 0x76, 0x93, 0x98, 0x01, 0x24, 0x4c, 0x5e, 0xd1, 0xdf, 0xeb, 0xa8, 0x3c, 0xdb,
+  0x78, 0xfa, 0xec, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b,
+  0x05, 0x00, 0x30, 0x1b, 0x31, 0x19, 0x30, 0x17, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x10, 0x50,
+  0x6b, 0x63, 0x73, 0x37, 0x20, 0x54, 0x65, 0x73, 0x74, 0x20, 0x4f, 0x74, 0x68, 0x65, 0x72, 0x30,
+  0x1e, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x39, 0x30, 0x38, 0x33, 0x30, 0x35, 0x30, 0x5a,
+  0x17, 0x0d, 0x33, 0x36, 0x31, 0x30, 0x31, 0x36, 0x30, 0x38, 0x33, 0x30, 0x35, 0x30, 0x5a, 0x30,
+  0x1b, 0x31, 0x19, 0x30, 0x17, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x10, 0x50, 0x6b, 0x63, 0x73,
+  0x37, 0x20, 0x54, 0x65, 0x73, 0x74, 0x20, 0x4f, 0x74, 0x68, 0x65, 0x72, 0x30, 0x82, 0x01, 0x22,
+  0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x01, 0x05, 0x00, 0x03,
+  0x82, 0x01, 0x0f, 0x00, 0x30, 0x82, 0x01, 0x0a, 0x02, 0x82, 0x01, 0x01, 0x00, 0xa7, 0x59, 0xa9,
+  0x0d, 0x2a, 0xbc, 0x41, 0xf8, 0x39, 0x79, 0x93, 0x13, 0x32, 0xe0, 0xdc, 0xe5, 0x1e, 0x3d, 0x84,
+  0x7a, 0x41, 0xdb, 0x8a, 0x11, 0x60, 0x0a, 0x7f, 0x98, 0x8d, 0x3c, 0x4e, 0xc3, 0xb6, 0x4c, 0xcc,
+  0x19, 0xd2, 0x73, 0xa8, 0x03, 0xe6, 0xac, 0xc3, 0x9b, 0x8a, 0xca, 0xed, 0x81, 0x13, 0x40, 0xd7,
+  0xac, 0x70, 0x05, 0x1a, 0x92, 0xa1, 0x39, 0xa6, 0xce, 0x87, 0xd9, 0x65, 0xaf, 0xae, 0xb4, 0x4e,
+  0x13, 0x88, 0x4c, 0xe9, 0x1a, 0xc9, 0x6a, 0xf3, 0x74, 0xb1, 0xb4, 0xae, 0x50, 0x05, 0xf3, 0xb1,
+  0xb0, 0x79, 0xb5, 0x86, 0x8a, 0x2b, 0x0f, 0x5a, 0xe0, 0x27, 0x70, 0xb3, 0xf5, 0x55, 0x8e, 0x84,
+  0xb5, 0xda, 0xdd, 0x5f, 0x0b, 0x2f, 0xa8, 0x27, 0x52, 0x7b, 0x3d, 0x91, 0x78, 0x7d, 0x24, 0x9d,
+  0x27, 0x90, 0x5a, 0xa5, 0x76, 0x44, 0x50, 0x47, 0xde, 0x21, 0x0b, 0xfa, 0x47, 0x9b, 0x34, 0x70,
+  0x40, 0x42, 0x5a, 0xfe, 0xc8, 0xe5, 0xa4, 0x26, 0x12, 0x65, 0x2a, 0xed, 0x2d, 0x06, 0xee, 0xda,
+  0xf3, 0xe1, 0x74, 0xee, 0x13, 0x60, 0x7d, 0x36, 0x1b, 0xe7, 0xf4, 0xb4, 0x8d, 0x42, 0xa1, 0xd4,
+  0x45, 0x54, 0x9c, 0x7d, 0xbf, 0xc8, 0x17, 0xbc, 0x42, 0x01, 0x1b, 0xed, 0xef, 0x72, 0xa4, 0x3b,
+  0xb9, 0x2e, 0x56, 0x8c, 0xa0, 0xd3, 0xdb, 0xbb, 0x3a, 0xc2, 0x38, 0x9e, 0x8c, 0x56, 0xda, 0x71,
+  0x82, 0x9a, 0x77, 0x9e, 0x8d, 0xac, 0xa5, 0x49, 0x54, 0x48, 0x51, 0x78, 0x8f, 0x2e, 0xc3, 0x8c,
+  0xe4, 0xa9, 0xfb, 0xff, 0xdc, 0xcd, 0x7f, 0x26, 0x95, 0xa1, 0x43, 0x12, 0x23, 0x51, 0x5b, 0xa7,
+  0x7b, 0x15, 0xb5, 0x85, 0xa6, 0x19, 0xce, 0xf5, 0xa9, 0x4f, 0x5f, 0x56, 0x0c, 0x1f, 0xf0, 0x9b,
+  0x17, 0x6e, 0x19, 0xcd, 0xda, 0x58, 0xd0, 0x59, 0xaf, 0xd4, 0xd8, 0x5e, 0xd3, 0x02, 0x03, 0x01,
+  0x00, 0x01, 0xa3, 0x53, 0x30, 0x51, 0x30, 0x1d, 0x06, 0x03, 0x55, 0x1d, 0x0e, 0x04, 0x16, 0x04,
+  0x14, 0x16, 0x3c, 0xe4, 0x6c, 0x7e, 0x7c, 0x48, 0x9c, 0xff, 0x69, 0x33, 0x76, 0x4f, 0x12, 0x19,
+  0x56, 0xc0, 0xe0, 0xef, 0xbb, 0x30, 0x1f, 0x06, 0x03, 0x55, 0x1d, 0x23, 0x04, 0x18, 0x30, 0x16,
+  0x80, 0x14, 0x16, 0x3c, 0xe4, 0x6c, 0x7e, 0x7c, 0x48, 0x9c, 0xff, 0x69, 0x33, 0x76, 0x4f, 0x12,
+  0x19, 0x56, 0xc0, 0xe0, 0xef, 0xbb, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x1d, 0x13, 0x01, 0x01, 0xff,
+  0x04, 0x05, 0x30, 0x03, 0x01, 0x01, 0xff, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7,
+  0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00, 0x03, 0x82, 0x01, 0x01, 0x00, 0x9b, 0x7e, 0x22, 0x93, 0xcd,
+  0xfb, 0x7d, 0x4f, 0xb9, 0x14, 0x97, 0xf8, 0x1e, 0x06, 0x09, 0xb0, 0x52, 0x2d, 0xb8, 0x13, 0xb2,
+  0x59, 0x83, 0x5e, 0x17, 0xf3, 0x50, 0xce, 0x0d, 0xd7, 0xce, 0xd3, 0x1b, 0x83, 0xea, 0x29, 0x96,
+  0x2d, 0xea, 0x34, 0x68, 0x4c, 0x68, 0xfb, 0x1c, 0x91, 0x32, 0x15, 0xc2, 0x1f, 0xed, 0xdf, 0x78,
+  0x7f, 0x14, 0xb4, 0x23, 0xe3, 0x89, 0x23, 0xd0, 0x96, 0x4f, 0x0c, 0xcd, 0x8a, 0xb3, 0x54, 0xb3,
+  0xbc, 0xd3, 0x15, 0x01, 0xaf, 0x5e, 0x42, 0x8f, 0x06, 0x2e, 0x1d, 0xf6, 0xb7, 0xc8, 0xd3, 0xc6,
+  0x64, 0xd9, 0x32, 0xb6, 0x6f, 0x5e, 0x5c, 0xaf, 0xa7, 0x06, 0x66, 0x2a, 0x87, 0xe3, 0x11, 0x38,
+  0x70, 0x78, 0x25, 0xda, 0xc5, 0xb5, 0xfd, 0xec, 0xa1, 0x29, 0xdc, 0x54, 0x2f, 0x42, 0xea, 0x21,
+  0x4d, 0xeb, 0x38, 0x9a, 0xbe, 0xbe, 0x32, 0x02, 0xad, 0x29, 0x58, 0x52, 0x4f, 0x74, 0xcd, 0x58,
+  0x2c, 0xd9, 0xc5, 0xe5, 0xbd, 0x33, 0x10, 0x7d, 0xfb, 0x2d, 0x42, 0x7c, 0xe4, 0x5a, 0x75, 0x4d,
+  0x67, 0x1a, 0x36, 0x7d, 0xb2, 0x18, 0xa4, 0xf1, 0x50, 0xb7, 0x29, 0xaf, 0x63, 0x77, 0x33, 0xeb,
+  0x0d, 0xe6, 0x86, 0x91, 0x3f, 0xf2, 0x3e, 0x58, 0x86, 0xba, 0xf8, 0xd3, 0x92, 0x6b, 0x62, 0xcc,
+  0x20, 0xeb, 0x6a, 0xb6, 0xa3, 0xb9, 0xe5, 0xe6, 0x69, 0xf4, 0xbd, 0x09, 0xcc, 0x02, 0xa7, 0xe5,
+  0xe1, 0x2e, 0x1e, 0xc8, 0xd7, 0x76, 0xf7, 0x5b, 0xe8, 0xcf, 0x72, 0x72, 0x5e, 0x63, 0x7e, 0x0d,
+  0x24, 0xff, 0xb5, 0x4f, 0xac, 0x99, 0xf8, 0x95, 0x2a, 0x54, 0xaa, 0x6c, 0xa5, 0x12, 0x5e, 0xd6,
+  0xe6, 0x2c, 0xc0, 0x4e, 0x33, 0x97, 0x24, 0xd3, 0xff, 0x47, 0x70, 0x10, 0xdd, 0xc5, 0x34, 0xc4,
+  0xcc, 0x79, 0xc9, 0xd7, 0x63, 0x99, 0xb7, 0x72, 0xb0, 0xa1, 0xaf
+};
+
+//
+// Detached PKCS#7 SignedData of mTestPayload by the signer, without authenticated attributes,
+// as in EFI_VARIABLE_AUTHENTICATION_2.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 mTestSignedData[] = {
+  0x30, 0x82, 0x04, 0xb8, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x02, 0xa0,
+  0x82, 0x04, 0xa9, 0x30, 0x82, 0x04, 0xa5, 0x02, 0x01, 0x01, 0x31, 0x0f, 0x30, 0x0d, 0x06, 0x09,
+  0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x30, 0x0b, 0x06, 0x09, 0x2a,
+  0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x01, 0xa0, 0x82, 0x03, 0x1d, 0x30, 0x82, 0x03, 0x19,
+  0x30, 0x82, 0x02, 0x01, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x58, 0x58, 0x8a, 0xd0, 0xa7,
+  0x93, 0x04, 0x0f, 0x4b, 0xd0, 0x1c, 0x2f, 0xf7, 0xdf, 0x6b, 0x97, 0x84, 0x3b, 0x73, 0x52, 0x30,
+  0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x0b, 0x05, 0x00, 0x30, 0x1c,
+  0x31, 0x1a, 0x30, 0x18, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x11, 0x50, 0x6b, 0x63, 0x73, 0x37,
+  0x20, 0x54, 0x65, 0x73, 0x74, 0x20, 0x53, 0x69, 0x67, 0x6e, 0x65, 0x72, 0x30, 0x1e, 0x17, 0x0d,
+  0x32, 0x36, 0x31, 0x30, 0x31, 0x39, 0x30, 0x38, 0x33, 0x30, 0x34, 0x39, 0x5a, 0x17, 0x0d, 0x33,
+  0x36, 0x31, 0x30, 0x31, 0x36, 0x30, 0x38, 0x33, 0x30, 0x34, 0x39, 0x5a, 0x30, 0x1c, 0x31, 0x1a,
+  0x30, 0x18, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x11, 0x50, 0x6b, 0x63, 0x73, 0x37, 0x20, 0x54,
+  0x65, 0x73, 0x74, 0x20, 0x53, 0x69, 0x67, 0x6e, 0x65, 0x72, 0x30, 0x82, 0x01, 0x22, 0x30, 0x0d,
+  0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x01, 0x05, 0x00, 0x03, 0x82, 0x01,
+  0x0f, 0x00, 0x30, 0x82, 0x01, 0x0a, 0x02, 0x82, 0x01, 0x01, 0x00, 0xa5, 0x32, 0x24, 0x80, 0xbf,
+  0x3d, 0x04, 0x66, 0x8a, 0xac, 0x33, 0x5b, 0xdd, 0x74, 0x56, 0x9a, 0xde, 0x8d, 0x3f, 0xf6, 0xc8,
+  0xa4, 0x46, 0x1e, 0xc7, 0x4f, 0x5a, 0x48, 0x43, 0xa2, 0xd4, 0xdb, 0x10, 0xa0, 0x60, 0xab, 0xc3,
+  0xa8, 0x2f, 0x1a, 0xe3, 0x48, 0x1f, 0x05, 0xc2, 0xbf, 0xd8, 0xfa, 0x4c, 0xd3, 0x10, 0x16, 0xc9,
+  0xb6, 0xeb, 0x1a, 0x1b, 0x7e, 0xc0, 0xcf, 0xa6, 0x9f, 0x35, 0xfd, 0xa8, 0xf6, 0x13, 0x05, 0x32,
+  0x82, 0xf7, 0x56, 0xad, 0x12, 0x17, 0xc1, 0xd2, 0xb6, 0x6d, 0x32, 0x92, 0xc2, 0xc6, 0x3c, 0x1a,
+  0x9d, 0x20, 0x88, 0xa7, 0x1b, 0x59, 0x0f, 0x6c, 0x3d, 0xdd, 0xd1, 0xc1, 0x9a, 0x24, 0x2d, 0xdb,
+  0xeb, 0x63, 0xe5, 0x37, 0x67, 0x7e, 0x68, 0x58, 0xbe, 0xc5, 0x74, 0x4a, 0xe2, 0x31, 0xe4, 0x3b,
+  0xd8, 0xb5, 0x2f, 0xd8, 0xd6, 0xc7, 0x61, 0x6b, 0x5c, 0x8b, 0x5b, 0xe5, 0x88, 0x23, 0x25, 0xb4,
+  0x79, 0x72, 0xf8, 0xa5, 0xca, 0xb0, 0xb6, 0x8f, 0x07, 0xcf, 0x55, 0xe5, 0x00, 0x56, 0x4e, 0x2c,
+  0x8a, 0x96, 0x39, 0x2a, 0x15, 0x47, 0xf3, 0x76, 0x4a, 0x29, 0x34, 0x66, 0xa9, 0xc9, 0xc6, 0x41,
+  0x66, 0x50, 0x13, 0x65, 0x50, 0xa2, 0xde, 0x42, 0x4c, 0x5b, 0x10, 0x4b, 0xb3, 0x5c, 0x4a, 0x43,
+  0xad, 0xb8, 0x2d, 0x29, 0x6a, 0x80, 0x2b, 0x1d, 0xee, 0x6a, 0xd0, 0x33, 0xc1, 0xfa, 0xea, 0x64,
+  0x37, 0x99, 0x3d, 0xb0, 0x7b, 0xfb, 0x72, 0xce, 0x17, 0x9b, 0xc3, 0x91, 0xda, 0x0f, 0x53, 0x14,
+  0x8c, 0x68, 0x9b, 0xde, 0xee, 0x79, 0x6d, 0xc8, 0x9d, 0xe6, 0x83, 0x33, 0x89, 0x0a, 0xa0, 0xc8,
+  0xf5, 0x10, 0x45, 0x97, 0x82, 0x18, 0x34, 0x85, 0x78, 0xaa, 0xc7, 0x82, 0x56, 0xab, 0x5c, 0x05,
+  0x59, 0x03, 0xa5, 0x9d, 0xee, 0xde, 0x1c, 0x13, 0xad, 0x36, 0x31, 0x02, 0x03, 0x01, 0x00, 0x01,
+  0xa3, 0x53, 0x30, 0x51, 0x30, 0x1d, 0x06, 0x03, 0x55, 0x1d, 0x0e, 0x04, 0x16, 0x04, 0x14, 0x4c,
+  0xe8, 0xc5, 0x51, 0x37, 0x16, 0x02, 0xe6, 0xb0, 0x4b, 0xcf, 0xd9, 0x95, 0x20, 0xb4, 0x3f, 0xbb,
+  0xb1, 0x0e, 0x7b, 0x30, 0x1f, 0x06, 0x03, 0x55, 0x1d, 0x23, 0x04, 0x18, 0x30, 0x16, 0x80, 0x14,
+  0x4c, 0xe8, 0xc5, 0x51, 0x37, 0x16, 0x02, 0xe6, 0xb0, 0x4b, 0xcf, 0xd9, 0x95, 0x20, 0xb4, 0x3f,
+  0xbb, 0xb1, 0x0e, 0x7b, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x1d, 0x13, 0x01, 0x01, 0xff, 0x04, 0x05,
+  0x30, 0x03, 0x01, 0x01, 0xff, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01,
+  0x01, 0x0b, 0x05, 0x00, 0x03, 0x82, 0x01, 0x01, 0x00, 0x13, 0x04, 0x91, 0xea, 0xd2, 0x37, 0xf0,
+  0x5a, 0x19, 0xad, 0x16, 0xac, 0x99, 0x26, 0xc5, 0x63, 0xf2, 0x5b, 0xe5, 0xc7, 0xb4, 0x3a, 0xee,
+  0x99, 0x67, 0x66, 0x13, 0x56, 0xf2, 0xe8, 0xfb, 0x2b, 0x38, 0xdc, 0xf9, 0xb4, 0x74, 0x0f, 0x98,
+  0x3a, 0xe2, 0xf5, 0x6f, 0xef, 0x4b, 0x26, 0x17, 0x4e, 0xfd, 0xf2, 0xb9, 0xd3, 0xb8, 0x0b, 0xb0,
+  0xb4, 0x63, 0x34, 0xd9, 0x43, 0x0d, 0x9e, 0x49, 0x42, 0xb5, 0xd8, 0xb7, 0x47, 0x63, 0xde, 0x8d,
+  0xde, 0x23, 0x1f, 0x52, 0x17, 0x2e, 0xe3, 0x1c, 0xad, 0x6e, 0x50, 0xd8, 0x10, 0x3d, 0x7e, 0x66,
+  0x56, 0xb6, 0xea, 0x5d, 0x7e, 0x10, 0x6c, 0x04, 0xc2, 0x98, 0x98, 0x2e, 0xe8, 0x43, 0x6c, 0x0c,
+  0xe1, 0x1d, 0x89, 0xef, 0x2e, 0x08, 0x2c, 0xaf, 0xe9, 0xcf, 0xc4, 0x94, 0x3d, 0xd1, 0x15, 0x89,
+  0x69, 0x5e, 0xcd, 0xdf, 0x9b, 0xa2, 0xa9, 0x85, 0x50, 0xee, 0xfa, 0xed, 0xc4, 0xdd, 0x1e, 0x92,
+  0x4a, 0xfb, 0x83, 0xae, 0x24, 0x22, 0x50, 0xc3, 0xef, 0x09, 0x05, 0xb1, 0x60, 0xa7, 0x5f, 0xea,
+  0x34, 0x1a, 0xdc, 0x16, 0x9d, 0x2a, 0x22, 0xff, 0xec, 0xe6, 0x92, 0x5a, 0x89, 0xa1, 0x4f, 0xba,
+  0x15, 0x13, 0x27, 0x5a, 0x62, 0xdb, 0x37, 0xfe, 0x8c, 0x85, 0xa5, 0x28, 0xbc, 0x6f, 0xd3, 0xad,
+  0xae, 0x7b, 0x6c, 0x18, 0xc7, 0xe8, 0xc1, 0x5a, 0xe6, 0xb0, 0x4b, 0xdc, 0x44, 0x2f, 0xe9, 0x1a,
+  0xda, 0xcd, 0x35, 0x71, 0xdc, 0xbe, 0xc4, 0x1d, 0x62, 0x16, 0x76, 0x33, 0x66, 0x81, 0x9b, 0xed,
+  0xdd, 0x11, 0xdc, 0x93, 0x7f, 0x00, 0xbc, 0xf2, 0x09, 0x6e, 0x06, 0xa3, 0x89, 0x4d, 0x5a, 0x02,
+  0x8a, 0xd0, 0x39, 0xa7, 0x1d, 0xe1, 0x82, 0x9a, 0x94, 0xd5, 0x7b, 0x4f, 0x93, 0xab, 0xfe, 0x3a,
+  0x72, 0xab, 0xf0, 0xa7, 0x85, 0xf0, 0x12, 0x0d, 0x6e, 0x31, 0x82, 0x01, 0x5f, 0x30, 0x82, 0x01,
+  0x5b, 0x02, 0x01, 0x01, 0x30, 0x34, 0x30, 0x1c, 0x31, 0x1a, 0x30, 0x18, 0x06, 0x03, 0x55, 0x04,
+  0x03, 0x0c, 0x11, 0x50, 0x6b, 0x63, 0x73, 0x37, 0x20, 0x54, 0x65, 0x73, 0x74, 0x20, 0x53, 0x69,
+  0x67, 0x6e, 0x65, 0x72, 0x02, 0x14, 0x58, 0x58, 0x8a, 0xd0, 0xa7, 0x93, 0x04, 0x0f, 0x4b, 0xd0,
+  0x1c, 0x2f, 0xf7, 0xdf, 0x6b, 0x97, 0x84, 0x3b, 0x73, 0x52, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86,
+  0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x30, 0x0d, 0x06, 0x09, 0x2a, 0x86, 0x48,
+  0x86, 0xf7, 0x0d, 0x01, 0x01, 0x01, 0x05, 0x00, 0x04, 0x82, 0x01, 0x00, 0x5d, 0xf9, 0x97, 0xb1,
+  0xde, 0xec, 0x50, 0x78, 0xdd, 0x43, 0xe7, 0x02, 0x49, 0xb9, 0x91, 0x16, 0xf3, 0x3e, 0xaf, 0xc0,
+  0x53, 0xe7, 0x18, 0x75, 0x71, 0x01, 0xec, 0x3d, 0x32, 0x99, 0xb2, 0x84, 0x9a, 0x86, 0x61, 0xa4,
+  0xab, 0x74, 0xf9, 0xca, 0x7a, 0xf3, 0x6e, 0x0e, 0x44, 0x64, 0xed, 0x0f, 0xf1, 0x75, 0x49, 0x4a,
+  0xa5, 0xd2, 0x64, 0xf3, 0x89, 0x4d, 0x87, 0x23, 0xec, 0xb6, 0xa2, 0x78, 0xcf, 0xe9, 0x2a, 0xd8,
+  0x39, 0x0b, 0x21, 0xfc, 0xbd, 0xc7, 0xf2, 0xcb, 0x99, 0xe0, 0xcf, 0x37, 0x55, 0x3a, 0x4c, 0x75,
+  0xdd, 0x74, 0x0d, 0xd0, 0x7f, 0x72, 0x91, 0x2f, 0x93, 0x38, 0xd3, 0xe4, 0xf9, 0x54, 0x1c, 0x25,
+  0xd7, 0xaf, 0xc7, 0x95, 0xbf, 0x16, 0x9d, 0xfa, 0x2f, 0x51, 0xe2, 0x98, 0xde, 0x12, 0xd3, 0xfc,
+  0xae, 0x13, 0xb7, 0xe2, 0x42, 0xaf, 0xb0, 0xbb, 0xf9, 0xf6, 0x73, 0xdc, 0xca, 0x54, 0x9f, 0x1b,
+  0xf6, 0x12, 0x51, 0x82, 0x1e, 0x0b, 0xd1, 0x8c, 0xb0, 0x04, 0xae, 0x2b, 0xf4, 0xb1, 0xc5, 0xef,
+  0xb1, 0x97, 0x96, 0x1e, 0x81, 0x20, 0xe1, 0xe3, 0xfb, 0x96, 0xa5, 0xf4, 0xea, 0x03, 0xa6, 0xad,
+  0x03, 0xf8, 0x81, 0xe6, 0x16, 0x65, 0x3c, 0xa3, 0x26, 0x1c, 0x69, 0x1b, 0x48, 0x61, 0x6b, 0x81,
+  0xca, 0xe8, 0x1c, 0x0d, 0x9b, 0x8e, 0x37, 0xa5, 0x01, 0xac, 0x60, 0xd8, 0xcd, 0xe6, 0xcc, 0x03,
+  0xd0, 0x77, 0x43, 0xd2, 0x44, 0x54, 0x72, 0xe1, 0xf5, 0xe0, 0x00, 0x0b, 0x87, 0xdd, 0x30, 0x20,
+  0x25, 0xf3, 0xc7, 0x8d, 0x53, 0x71, 0x64, 0x83, 0x99, 0xe4, 0xdb, 0xe8, 0x22, 0xeb, 0x70, 0x11,
+  0xb6, 0x36, 0x80, 0xe1, 0x98, 0x91, 0xe0, 0x24, 0xd7, 0x4d, 0xcc, 0x62, 0xb7, 0xcb, 0xef, 0x77,
+  0x31, 0x75, 0x1a, 0x44, 0x02, 0x4d, 0xcc, 0x57, 0x6c, 0x81, 0x85, 0xcc
+};
+
+
+//
+// mTestSignerCert and mTestOtherCert constructed by X509ConstructCertificate ().
+//
+VOID    *mSignerX509;
+VOID    *mOtherX509;
+
+/**
+  Constructs the X509 objects of the test certificates.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                      The certificates are constructed.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  A certificate could not be constructed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupCertificates (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  mSignerX509 = NULL;
+  mOtherX509  = NULL;
+  if (!X509ConstructCertificate (mTestSignerCert, sizeof (mTestSignerCert), (UINT8 **) &mSignerX509) ||
+      !X509ConstructCertificate (mTestOtherCert, sizeof (mTestOtherCert), (UINT8 **) &mOtherX509)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the X509 objects of the test certificates.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupCertificates (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mSignerX509 != NULL) {
+    X509Free (mSignerX509);
+  }
+  if (mOtherX509 != NULL) {
+    X509Free (mOtherX509);
+  }
+}
+
+/**
+  Checks that a valid SignedData is accepted by both Pkcs7Verify () and
+  Pkcs7VerifyWithX509 (), wherever the signer is in the certificate list.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  Both accept the SignedData.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ValidSignatureAccepted (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VOID    *Certs[2];
+
+  UT_ASSERT_TRUE (Pkcs7Verify (mTestSignedData, sizeof (mTestSignedData), mTestSignerCert, sizeof (mTestSignerCert), (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+
+  Certs[0] = mSignerX509;
+  UT_ASSERT_TRUE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 1, (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+
+  Certs[0] = mOtherX509;
+  Certs[1] = mSignerX509;
+  UT_ASSERT_TRUE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 2, (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+
+  Certs[0] = mSignerX509;
+  Certs[1] = mOtherX509;
+  UT_ASSERT_TRUE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 2, (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that a SignedData is rejected by both Pkcs7Verify () and
+  Pkcs7VerifyWithX509 () when it is checked against a certificate that did
+  not sign it, or against no certificate at all.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  Both reject the SignedData.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WrongSignerRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VOID    *Certs[1];
+
+  UT_ASSERT_FALSE (Pkcs7Verify (mTestSignedData, sizeof (mTestSignedData), mTestOtherCert, sizeof (mTestOtherCert), (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+
+  Certs[0] = mOtherX509;
+  UT_ASSERT_FALSE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 1, (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+  UT_ASSERT_FALSE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 0, (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+  UT_ASSERT_FALSE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), NULL, 1, (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Flips one bit in each byte of the content and of the SignedData in turn,
+  and checks that Pkcs7Verify () and Pkcs7VerifyWithX509 () give the same
+  result for every copy. Every tampered content must be rejected.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  Both give the same results.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+TamperedDataRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8     Payload[sizeof (mTestPayload)];
+  UINT8     SignedData[sizeof (mTestSignedData)];
+  VOID      *Certs[1];
+  UINTN     PayloadSize;
+  UINTN     Index;
+  UINTN     Accepted;
+  BOOLEAN   Verified;
+
+  Certs[0]    = mSignerX509;
+  PayloadSize = AsciiStrLen (mTestPayload);
+
+  CopyMem (Payload, mTestPayload, PayloadSize);
+  for (Index = 0; Index < PayloadSize; Index++) {
+    Payload[Index] ^= (UINT8) (1 << (Index % 8));
+    UT_ASSERT_FALSE (Pkcs7Verify (mTestSignedData, sizeof (mTestSignedData), mTestSignerCert, sizeof (mTestSignerCert), Payload, PayloadSize));
+    UT_ASSERT_FALSE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 1, Payload, PayloadSize));
+    Payload[Index] ^= (UINT8) (1 << (Index % 8));
+  }
+  UT_ASSERT_FALSE (Pkcs7Verify (mTestSignedData, sizeof (mTestSignedData), mTestSignerCert, sizeof (mTestSignerCert), Payload, PayloadSize - 1));
+  UT_ASSERT_FALSE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 1, Payload, PayloadSize - 1));
+
+  //
+  // A bit flipped in a part of the SignedData that is not covered by the
+  // signature, such as the unused certificates, may still verify: both must
+  // agree on it.
+  //
+  Accepted = 0;
+  CopyMem (SignedData, mTestSignedData, sizeof (SignedData));
+  for (Index = 0; Index < sizeof (SignedData); Index++) {
+    SignedData[Index] ^= (UINT8) (1 << (Index % 8));
+    Verified = Pkcs7Verify (SignedData, sizeof (SignedData), mTestSignerCert, sizeof (mTestSignerCert), (CONST UINT8 *) mTestPayload, PayloadSize);
+    UT_ASSERT_EQUAL (Verified, Pkcs7VerifyWithX509 (SignedData, sizeof (SignedData), Certs, 1, (CONST UINT8 *) mTestPayload, PayloadSize));
+    if (Verified) {
+      Accepted++;
+    }
+    SignedData[Index] ^= (UINT8) (1 << (Index % 8));
+  }
+  UT_ASSERT_TRUE (Accepted < sizeof (SignedData) / 2);
+  UT_LOG_INFO ("%Lu of %Lu tampered SignedData accepted by both\n", (UINT64) Accepted, (UINT64) sizeof (SignedData));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Times Pkcs7Verify () against a list of certificates, the signer last, as
+  AuthVariableLib goes through KEK, and Pkcs7VerifyWithX509 () against the
+  same list constructed once.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  Every verification succeeds.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+VerifyLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VOID      *Certs[2];
+  UINTN     Round;
+  clock_t   Start;
+  UINT64    VerifyTime;
+  UINT64    VerifyWithX509Time;
+
+  Certs[0] = mOtherX509;
+  Certs[1] = mSignerX509;
+
+  Start = clock ();
+  for (Round = 0; Round < TEST_TIMED_VERIFY_COUNT; Round++) {
+    if (!Pkcs7Verify (mTestSignedData, sizeof (mTestSignedData), mTestOtherCert, sizeof (mTestOtherCert), (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload))) {
+      UT_ASSERT_TRUE (Pkcs7Verify (mTestSignedData, sizeof (mTestSignedData), mTestSignerCert, sizeof (mTestSignerCert), (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+    }
+  }
+  VerifyTime = DivU64x32 (MultU64x32 ((UINT64) (clock () - Start), 1000000 / TEST_TIMED_VERIFY_COUNT), CLOCKS_PER_SEC);
+
+  Start = clock ();
+  for (Round = 0; Round < TEST_TIMED_VERIFY_COUNT; Round++) {
+    UT_ASSERT_TRUE (Pkcs7VerifyWithX509 (mTestSignedData, sizeof (mTestSignedData), Certs, 2, (CONST UINT8 *) mTestPayload, AsciiStrLen (mTestPayload)));
+  }
+  VerifyWithX509Time = DivU64x32 (MultU64x32 ((UINT64) (clock () - Start), 1000000 / TEST_TIMED_VERIFY_COUNT), CLOCKS_PER_SEC);
+
+  UT_LOG_INFO ("2 certificates, signer last: Pkcs7Verify %Lu us, Pkcs7VerifyWithX509 %Lu us\n", VerifyTime, VerifyWithX509Time);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for
+  Pkcs7VerifyWithX509 () and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      VerifyTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the PKCS7 verification Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&VerifyTests, Framework, "PKCS7 Verification With X509 Tests", "BaseCryptLib.Pkcs7VerifyWithX509", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for VerifyTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (VerifyTests, "Valid SignedData should be accepted by both",           "Valid",       ValidSignatureAccepted, SetupCertificates, CleanupCertificates, NULL);
+  AddTestCase (VerifyTests, "Wrong signer should be rejected by both",               "WrongSigner", WrongSignerRejected,    SetupCertificates, CleanupCertificates, NULL);
+  AddTestCase (VerifyTests, "Tampered data should get the same result from both",    "Tampered",    TamperedDataRejected,   SetupCertificates, CleanupCertificates, NULL);
+  AddTestCase (VerifyTests, "Verification latency with and without X509 objects",    "Latency",     VerifyLatency,          SetupCertificates, CleanupCertificates, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
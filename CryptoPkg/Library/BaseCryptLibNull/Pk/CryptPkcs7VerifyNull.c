@@ -2,7 +2,7 @@
   PKCS#7 SignedData Verification Wrapper Implementation which does not provide
   real capabilities.
 
-Copyright (c) 2012 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2012 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -133,6 +133,41 @@ Pkcs7Verify (
   return FALSE;
 }
 
+/**
+  Verifies the validity of a PKCS#7 signed data as described in "PKCS #7:
+  Cryptographic Message Syntax Standard" against a list of trusted certificates,
+  which are already constructed as X509 objects. The input signed data could be
+  wrapped in a ContentInfo structure.
+
+  Return FALSE to indicate this interface is not supported.
+
+  @param[in]  P7Data        Pointer to the PKCS#7 message to verify.
+  @param[in]  P7Length      Length of the PKCS#7 message in bytes.
+  @param[in]  TrustedCerts  Array of trusted/root certificates constructed by
+                            X509ConstructCertificate(), which are used for
+                            certificate chain verification.
+  @param[in]  CertCount     Number of certificates in TrustedCerts.
+  @param[in]  InData        Pointer to the content to be verified.
+  @param[in]  DataLength    Length of InData in bytes.
+
+  @retval FALSE  This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7VerifyWithX509 (
+  IN  CONST UINT8  *P7Data,
+  IN  UINTN        P7Length,
+  IN  VOID         **TrustedCerts,
+  IN  UINTN        CertCount,
+  IN  CONST UINT8  *InData,
+  IN  UINTN        DataLength
+  )
+{
+  ASSERT (FALSE);
+  return FALSE;
+}
+
 /**
   Extracts the attached content from a PKCS#7 signed data if existed. The input signed
   data could be wrapped in a ContentInfo structure.
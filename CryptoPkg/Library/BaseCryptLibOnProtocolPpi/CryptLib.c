@@ -2164,6 +2164,47 @@ Pkcs7Verify (
   CALL_CRYPTO_SERVICE (Pkcs7Verify, (P7Data, P7Length, TrustedCert, CertLength, InData, DataLength), FALSE);
 }
 
+/**
+  Verifies the validity of a PKCS#7 signed data as described in "PKCS #7:
+  Cryptographic Message Syntax Standard" against a list of trusted certificates,
+  which are already constructed as X509 objects. The input signed data could be
+  wrapped in a ContentInfo structure.
+
+  The signed data is parsed once, and verified against every trusted certificate
+  in turn, so it is valid if Pkcs7Verify() would accept it with any of them.
+
+  If P7Data, TrustedCerts or InData is NULL, then return FALSE.
+  If P7Length or DataLength overflow, then return FALSE.
+  If this interface is not supported, then return FALSE.
+
+  @param[in]  P7Data        Pointer to the PKCS#7 message to verify.
+  @param[in]  P7Length      Length of the PKCS#7 message in bytes.
+  @param[in]  TrustedCerts  Array of trusted/root certificates constructed by
+                            X509ConstructCertificate(), which are used for
+                            certificate chain verification.
+  @param[in]  CertCount     Number of certificates in TrustedCerts.
+  @param[in]  InData        Pointer to the content to be verified.
+  @param[in]  DataLength    Length of InData in bytes.
+
+  @retval  TRUE  The specified PKCS#7 signed data is valid.
+  @retval  FALSE Invalid PKCS#7 signed data.
+  @retval  FALSE This interface is not supported.
+
+**/
+BOOLEAN
+EFIAPI
+Pkcs7VerifyWithX509 (
+  IN  CONST UINT8  *P7Data,
+  IN  UINTN        P7Length,
+  IN  VOID         **TrustedCerts,
+  IN  UINTN        CertCount,
+  IN  CONST UINT8  *InData,
+  IN  UINTN        DataLength
+  )
+{
+  CALL_CRYPTO_SERVICE (Pkcs7VerifyWithX509, (P7Data, P7Length, TrustedCerts, CertCount, InData, DataLength), FALSE);
+}
+
 /**
   This function receives a PKCS7 formatted signature, and then verifies that
   the specified Enhanced or Extended Key Usages (EKU's) are present in the end-entity
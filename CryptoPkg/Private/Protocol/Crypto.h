@@ -21,7 +21,7 @@
 /// the EDK II Crypto Protocol is extended, this version define must be
 /// increased.
 ///
-#define EDKII_CRYPTO_VERSION 7
+#define EDKII_CRYPTO_VERSION 8
 
 ///
 /// EDK II Crypto Protocol forward declaration
@@ -592,6 +592,44 @@ IN  CONST UINT8                   *Data,
 IN  UINTN                          DataLength
 );
 
+/**
+  Verifies the validity of a PKCS#7 signed data as described in "PKCS #7:
+  Cryptographic Message Syntax Standard" against a list of trusted certificates,
+  which are already constructed as X509 objects. The input signed data could be
+  wrapped in a ContentInfo structure.
+
+  The signed data is parsed once, and verified against every trusted certificate
+  in turn, so it is valid if Pkcs7Verify() would accept it with any of them.
+
+  If P7Data, TrustedCerts or InData is NULL, then return FALSE.
+  If P7Length or DataLength overflow, then return FALSE.
+  If this interface is not supported, then return FALSE.
+
+  @param[in]  P7Data        Pointer to the PKCS#7 message to verify.
+  @param[in]  P7Length      Length of the PKCS#7 message in bytes.
+  @param[in]  TrustedCerts  Array of trusted/root certificates constructed by
+                            X509ConstructCertificate(), which are used for
+                            certificate chain verification.
+  @param[in]  CertCount     Number of certificates in TrustedCerts.
+  @param[in]  InData        Pointer to the content to be verified.
+  @param[in]  DataLength    Length of InData in bytes.
+
+  @retval  TRUE  The specified PKCS#7 signed data is valid.
+  @retval  FALSE Invalid PKCS#7 signed data.
+  @retval  FALSE This interface is not supported.
+
+**/
+typedef
+BOOLEAN
+(EFIAPI *EDKII_CRYPTO_PKCS7_VERIFY_WITH_X509) (
+IN  CONST UINT8                   *P7Data,
+IN  UINTN                          P7DataLength,
+IN  VOID                           **TrustedCerts,
+IN  UINTN                          CertCount,
+IN  CONST UINT8                   *Data,
+IN  UINTN                          DataLength
+);
+
 /**
   VerifyEKUsInPkcs7Signature()
 
@@ -3619,6 +3657,8 @@ struct _EDKII_CRYPTO_PROTOCOL {
   EDKII_CRYPTO_TLS_GET_HOST_PUBLIC_CERT           TlsGetHostPublicCert;
   EDKII_CRYPTO_TLS_GET_HOST_PRIVATE_KEY           TlsGetHostPrivateKey;
   EDKII_CRYPTO_TLS_GET_CERT_REVOCATION_LIST       TlsGetCertRevocationList;
+  /// Pkcs (Continued)
+  EDKII_CRYPTO_PKCS7_VERIFY_WITH_X509             Pkcs7VerifyWithX509;
 };
 
 extern GUID gEdkiiCryptoProtocolGuid;
@@ -620,6 +620,153 @@ DumpMemoryProfileMemoryRange (
   return (VOID *) Descriptor;
 }
 
+/**
+  Get memory profile driver information by image base.
+
+  @param[in] Context            Pointer to memory profile context.
+  @param[in] ImageBase          Image base address.
+
+  @return Pointer to memory profile driver info, or NULL if it is not found.
+
+**/
+MEMORY_PROFILE_DRIVER_INFO *
+GetMemoryProfileDriverInfoByImageBase (
+  IN MEMORY_PROFILE_CONTEXT     *Context,
+  IN PHYSICAL_ADDRESS           ImageBase
+  )
+{
+  MEMORY_PROFILE_DRIVER_INFO    *DriverInfo;
+  MEMORY_PROFILE_ALLOC_INFO     *AllocInfo;
+  UINTN                         DriverIndex;
+  UINTN                         AllocIndex;
+
+  DriverInfo = (MEMORY_PROFILE_DRIVER_INFO *) ((UINTN) Context + Context->Header.Length);
+  for (DriverIndex = 0; DriverIndex < Context->ImageCount; DriverIndex++) {
+    if (DriverInfo->Header.Signature != MEMORY_PROFILE_DRIVER_INFO_SIGNATURE) {
+      return NULL;
+    }
+    if (DriverInfo->ImageBase == ImageBase) {
+      return DriverInfo;
+    }
+    AllocInfo = (MEMORY_PROFILE_ALLOC_INFO *) ((UINTN) DriverInfo + DriverInfo->Header.Length);
+    for (AllocIndex = 0; AllocIndex < DriverInfo->AllocRecordCount; AllocIndex++) {
+      AllocInfo = (MEMORY_PROFILE_ALLOC_INFO *) ((UINTN) AllocInfo + AllocInfo->Header.Length);
+    }
+    DriverInfo = (MEMORY_PROFILE_DRIVER_INFO *) AllocInfo;
+  }
+
+  return NULL;
+}
+
+/**
+  Dump memory profile sample information.
+
+  @param[in] SampleInfo         Pointer to memory profile sample info.
+  @param[in] Context            Pointer to memory profile context.
+
+**/
+VOID
+DumpMemoryProfileSampleInfo (
+  IN MEMORY_PROFILE_SAMPLE_INFO *SampleInfo,
+  IN MEMORY_PROFILE_CONTEXT     *Context
+  )
+{
+  UINTN                         TypeIndex;
+  MEMORY_PROFILE_DRIVER_SAMPLE  *DriverSample;
+  MEMORY_PROFILE_DRIVER_INFO    *DriverInfo;
+  UINTN                         DriverIndex;
+
+  Print (L"MEMORY_PROFILE_SAMPLE_INFO\n");
+  Print (L"  Signature                     - 0x%08x\n", SampleInfo->Header.Signature);
+  Print (L"  Length                        - 0x%04x\n", SampleInfo->Header.Length);
+  Print (L"  Revision                      - 0x%04x\n", SampleInfo->Header.Revision);
+  Print (L"  SampleInterval                - 0x%08x\n", SampleInfo->SampleInterval);
+  Print (L"  SizeThreshold                 - 0x%016lx\n", SampleInfo->SizeThreshold);
+  Print (L"  AllocateCount                 - 0x%016lx\n", SampleInfo->AllocateCount);
+  Print (L"  SampledCount                  - 0x%016lx\n", SampleInfo->SampledCount);
+  for (TypeIndex = 0; TypeIndex < sizeof (SampleInfo->AllocateCountByType) / sizeof (SampleInfo->AllocateCountByType[0]); TypeIndex++) {
+    if (SampleInfo->AllocateCountByType[TypeIndex] != 0) {
+      Print (L"  AllocateCount[0x%02x]           - 0x%016lx (%a)\n", TypeIndex, SampleInfo->AllocateCountByType[TypeIndex], mMemoryTypeString[TypeIndex]);
+      Print (L"  AllocateSize[0x%02x]            - 0x%016lx (%a)\n", TypeIndex, SampleInfo->AllocateSizeByType[TypeIndex], mMemoryTypeString[TypeIndex]);
+    }
+  }
+  Print (L"  DriverSampleCount             - 0x%08x\n", SampleInfo->DriverSampleCount);
+
+  DriverSample = (MEMORY_PROFILE_DRIVER_SAMPLE *) ((UINTN) SampleInfo + SampleInfo->Header.Length);
+  for (DriverIndex = 0; DriverIndex < SampleInfo->DriverSampleCount; DriverIndex++) {
+    if (DriverSample->Header.Signature != MEMORY_PROFILE_DRIVER_SAMPLE_SIGNATURE) {
+      return ;
+    }
+    if (DriverSample->AllocateCount != 0) {
+      DriverInfo = GetMemoryProfileDriverInfoByImageBase (Context, DriverSample->ImageBase);
+      Print (L"  MEMORY_PROFILE_DRIVER_SAMPLE (0x%x)\n", DriverIndex);
+      if (DriverInfo != NULL) {
+        Print (L"    FileName                - %a\n", GetDriverNameString (DriverInfo));
+      }
+      Print (L"    ImageBase               - 0x%016lx\n", DriverSample->ImageBase);
+      Print (L"    AllocateCount           - 0x%016lx\n", DriverSample->AllocateCount);
+      Print (L"    AllocateSize            - 0x%016lx\n", DriverSample->AllocateSize);
+    }
+    DriverSample = (MEMORY_PROFILE_DRIVER_SAMPLE *) ((UINTN) DriverSample + DriverSample->Header.Length);
+  }
+}
+
+/**
+  Dump the sampled allocations as folded stacks, one "Driver;MemoryType;Action;Offset Weight"
+  line per record, which flame graph tools consume directly. The weight is the size
+  scaled by the sample interval for the records picked by sampling.
+
+  @param[in] SampleInfo         Pointer to memory profile sample info.
+  @param[in] Context            Pointer to memory profile context.
+  @param[in] IsForSmm           TRUE  - SMRAM profile.
+                                FALSE - UEFI memory profile.
+
+**/
+VOID
+DumpMemoryProfileFoldedStack (
+  IN MEMORY_PROFILE_SAMPLE_INFO *SampleInfo,
+  IN MEMORY_PROFILE_CONTEXT     *Context,
+  IN BOOLEAN                    IsForSmm
+  )
+{
+  MEMORY_PROFILE_DRIVER_INFO    *DriverInfo;
+  MEMORY_PROFILE_ALLOC_INFO     *AllocInfo;
+  UINTN                         DriverIndex;
+  UINTN                         AllocIndex;
+  UINT64                        Weight;
+
+  Print (L"======= Folded stack begin =======\n");
+  DriverInfo = (MEMORY_PROFILE_DRIVER_INFO *) ((UINTN) Context + Context->Header.Length);
+  for (DriverIndex = 0; DriverIndex < Context->ImageCount; DriverIndex++) {
+    if (DriverInfo->Header.Signature != MEMORY_PROFILE_DRIVER_INFO_SIGNATURE) {
+      break;
+    }
+    AllocInfo = (MEMORY_PROFILE_ALLOC_INFO *) ((UINTN) DriverInfo + DriverInfo->Header.Length);
+    for (AllocIndex = 0; AllocIndex < DriverInfo->AllocRecordCount; AllocIndex++) {
+      //
+      // Only the basic actions, the library actions describe the same buffers.
+      //
+      if (AllocInfo->Action == (AllocInfo->Action & MEMORY_PROFILE_ACTION_BASIC_MASK)) {
+        Weight = AllocInfo->Size;
+        if ((SampleInfo->SizeThreshold == 0) || (AllocInfo->Size < SampleInfo->SizeThreshold)) {
+          Weight = MultU64x32 (Weight, SampleInfo->SampleInterval);
+        }
+        Print (
+          L"%a;%a;%a;0x%x %ld\n",
+          GetDriverNameString (DriverInfo),
+          ProfileMemoryTypeToStr (AllocInfo->MemoryType),
+          ProfileActionToStr (AllocInfo->Action, NULL, IsForSmm),
+          (UINTN) (AllocInfo->CallerAddress - DriverInfo->ImageBase),
+          Weight
+          );
+      }
+      AllocInfo = (MEMORY_PROFILE_ALLOC_INFO *) ((UINTN) AllocInfo + AllocInfo->Header.Length);
+    }
+    DriverInfo = (MEMORY_PROFILE_DRIVER_INFO *) AllocInfo;
+  }
+  Print (L"======= Folded stack end =======\n");
+}
+
 /**
   Scan memory profile by Signature.
 
@@ -678,6 +825,7 @@ DumpMemoryProfile (
   MEMORY_PROFILE_CONTEXT        *Context;
   MEMORY_PROFILE_FREE_MEMORY    *FreeMemory;
   MEMORY_PROFILE_MEMORY_RANGE   *MemoryRange;
+  MEMORY_PROFILE_SAMPLE_INFO    *SampleInfo;
 
   Context = (MEMORY_PROFILE_CONTEXT *) ScanMemoryProfileBySignature (ProfileBuffer, ProfileSize, MEMORY_PROFILE_CONTEXT_SIGNATURE);
   if (Context != NULL) {
@@ -693,6 +841,12 @@ DumpMemoryProfile (
   if (MemoryRange != NULL) {
     DumpMemoryProfileMemoryRange (MemoryRange);
   }
+
+  SampleInfo = (MEMORY_PROFILE_SAMPLE_INFO *) ScanMemoryProfileBySignature (ProfileBuffer, ProfileSize, MEMORY_PROFILE_SAMPLE_INFO_SIGNATURE);
+  if ((SampleInfo != NULL) && (Context != NULL)) {
+    DumpMemoryProfileSampleInfo (SampleInfo, Context);
+    DumpMemoryProfileFoldedStack (SampleInfo, Context, IsForSmm);
+  }
 }
 
 /**
@@ -577,6 +577,7 @@ DumpSmiHandler(
   SMM_CORE_SMI_DATABASE_STRUCTURE    *SmiStruct;
   SMM_CORE_SMI_HANDLER_STRUCTURE     *SmiHandlerStruct;
   UINTN                              Index;
+  UINTN                              Bucket;
   SMM_CORE_IMAGE_DATABASE_STRUCTURE  *ImageStruct;
   CHAR8                              *NameString;
 
@@ -612,6 +613,20 @@ DumpSmiHandler(
           Print(L"         <RVA>0x%x</RVA>\n", (UINTN) (SmiHandlerStruct->CallerAddr - ImageStruct->ImageBase));
         }
         Print(L"      </Caller>\n", SmiHandlerStruct->Handler);
+        if ((SmiStruct->Header.Revision >= 0x0002) && (SmiHandlerStruct->InvocationCount != 0)) {
+          Print(L"      <Statistics InvocationCount=\"0x%lx\" TotalLatency=\"%ld\" AverageLatency=\"%ld\">\n",
+            SmiHandlerStruct->InvocationCount,
+            SmiHandlerStruct->TotalLatency,
+            DivU64x64Remainder (SmiHandlerStruct->TotalLatency, SmiHandlerStruct->InvocationCount, NULL)
+            );
+          Print(L"      <!-- Latency is in nanoseconds. Bucket 0 counts invocations shorter than 2us, bucket N counts [2^N, 2^(N+1)) us. -->\n");
+          for (Bucket = 0; Bucket < SMI_HANDLER_PROFILE_LATENCY_BUCKETS; Bucket++) {
+            if (SmiHandlerStruct->LatencyHistogram[Bucket] != 0) {
+              Print(L"         <LatencyBucket Index=\"%d\" Count=\"0x%x\"/>\n", (UINT32)Bucket, SmiHandlerStruct->LatencyHistogram[Bucket]);
+            }
+          }
+          Print(L"      </Statistics>\n");
+        }
         SmiHandlerStruct = (VOID *)((UINTN)SmiHandlerStruct + SmiHandlerStruct->Length);
         Print(L"    </SmiHandler>\n");
       }
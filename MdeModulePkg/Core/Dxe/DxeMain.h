@@ -47,10 +47,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/HiiPackageList.h>
 #include <Protocol/SmmBase2.h>
 #include <Protocol/PeCoffImageEmulator.h>
+#include <Protocol/SectionCacheDebug.h>
 #include <Guid/MemoryTypeInformation.h>
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/FirmwareFileSystem3.h>
 #include <Guid/HobList.h>
+#include <Guid/HobIndex.h>
 #include <Guid/DebugImageInfoTable.h>
 #include <Guid/FileInfo.h>
 #include <Guid/Apriori.h>
@@ -62,6 +64,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/LoadModuleAtFixedAddress.h>
 #include <Guid/IdleLoopEvent.h>
 #include <Guid/VectorHandoffTable.h>
+#include <Guid/ZeroGuid.h>
 #include <Ppi/VectorHandoffInfo.h>
 #include <Guid/MemoryProfile.h>
 
@@ -86,6 +89,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DxeServicesLib.h>
 #include <Library/DebugAgentLib.h>
 #include <Library/CpuExceptionHandlerLib.h>
+#include <Library/TimerLib.h>
 
 
 //
@@ -472,6 +476,16 @@ CoreTimerTick (
   );
 
 
+/**
+  Dumps the statistics of the timer services.
+
+**/
+VOID
+CoreDumpTimerStatistics (
+  VOID
+  );
+
+
 /**
   Initialize the dispatcher. Initialize the notification function that runs when
   an FV2 protocol is added to the system.
@@ -2601,6 +2615,37 @@ ProduceFVBProtocolOnBuffer (
   OUT EFI_HANDLE            *FvProtocol  OPTIONAL
   );
 
+/**
+  Locates the first leaf section of the given type in a file without copying
+  it. Only the sections found directly in the file are examined.
+
+  @param  This                  Pointer to an EFI_FIRMWARE_VOLUME2_PROTOCOL
+                                instance produced by the DXE core.
+  @param  NameGuid              Filename identifying the file from which to
+                                locate the section.
+  @param  SectionType           Indicates the section type to return.
+  @param  Buffer                On output, points to the section data.
+  @param  BufferSize            On output, the size of the section data.
+  @param  AuthenticationStatus  On output, the authentication status of the
+                                section.
+
+  @retval EFI_SUCCESS           The section is located.
+  @retval EFI_UNSUPPORTED       This is not produced by the DXE core.
+  @retval EFI_NOT_FOUND         The section is not found at the top level of
+                                the file.
+  @retval EFI_INVALID_PARAMETER Invalid parameter.
+
+**/
+EFI_STATUS
+FvLocateFileSection (
+  IN CONST  EFI_FIRMWARE_VOLUME2_PROTOCOL  *This,
+  IN CONST  EFI_GUID                       *NameGuid,
+  IN        EFI_SECTION_TYPE               SectionType,
+  OUT       VOID                           **Buffer,
+  OUT       UINTN                          *BufferSize,
+  OUT       UINT32                         *AuthenticationStatus
+  );
+
 
 /**
   Raising to the task priority level of the mutual exclusion
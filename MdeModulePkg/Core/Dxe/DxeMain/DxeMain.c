@@ -325,6 +325,19 @@ DxeMain (
   Status = CoreInstallConfigurationTable (&gEfiHobListGuid, HobStart);
   ASSERT_EFI_ERROR (Status);
 
+  //
+  // Publish the GUID HOB index built by DxeIpl, if any, so that HobLib
+  // instances can look up GUID HOBs without walking the whole HOB list.
+  //
+  GuidHob = GetNextGuidHob (&gEdkiiHobIndexGuid, HobStart);
+  if (GuidHob != NULL) {
+    Status = CoreInstallConfigurationTable (
+               &gEdkiiHobIndexGuid,
+               (VOID *) (UINTN) (*(EFI_PHYSICAL_ADDRESS *) GET_GUID_HOB_DATA (GuidHob))
+               );
+    ASSERT_EFI_ERROR (Status);
+  }
+
   //
   // Install Memory Type Information Table into the EFI System Tables's Configuration Table
   //
@@ -745,6 +758,8 @@ CoreExitBootServices (
   //
   gTimer->SetTimerPeriod (gTimer, 0);
 
+  CoreDumpTimerStatistics ();
+
   //
   // Terminate memory services if the MapKey matches
   //
@@ -36,6 +36,36 @@ typedef struct {
   UINT64          Period;
 } TIMER_EVENT_INFO;
 
+///
+/// Timer services statistics
+///
+typedef struct {
+  ///
+  /// Number of timers currently armed, and the peak of it
+  ///
+  UINT32          ActiveTimers;
+  UINT32          PeakActiveTimers;
+  ///
+  /// Number of timers armed, and of armed timers cancelled or re-armed, by SetTimer()
+  ///
+  UINT64          SetCount;
+  UINT64          CancelCount;
+  ///
+  /// Number of timer expirations
+  ///
+  UINT64          SignalCount;
+  ///
+  /// Number of timer moves between the levels of the timer wheel
+  ///
+  UINT64          CascadeCount;
+  ///
+  /// Number of timer checks, and the performance counter ticks spent in them
+  ///
+  UINT64          CheckCount;
+  UINT64          CheckCounterTicks;
+  UINT64          MaxCheckCounterTicks;
+} TIMER_STATISTICS;
+
 #define EVENT_SIGNATURE         SIGNATURE_32('e','v','n','t')
 typedef struct {
   UINTN                   Signature;
@@ -1,7 +1,12 @@
 /** @file
   Core Timer Services
 
-Copyright (c) 2006 - 2013, Intel Corporation. All rights reserved.<BR>
+  Armed timers are kept in a hierarchical timer wheel, so that inserting and
+  cancelling a timer does not depend on the number of armed timers. Once the
+  wheel reaches the jiffy of a timer, the timer is moved to mEfiTimerList,
+  which is sorted by trigger time and from which expired timers are signaled.
+
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -10,10 +15,25 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "DxeMain.h"
 #include "Event.h"
 
+//
+// The timer wheel counts time in jiffies of 2^TIMER_WHEEL_JIFFY_SHIFT 100ns
+// units (about 6.5ms). Each level has TIMER_WHEEL_SLOT_COUNT slots; a slot of
+// level N covers 2^(N * TIMER_WHEEL_SLOT_BITS) jiffies. Timers farther away
+// than the top level can cover are kept in an overflow list.
+//
+#define TIMER_WHEEL_JIFFY_SHIFT   16
+#define TIMER_WHEEL_SLOT_BITS     6
+#define TIMER_WHEEL_SLOT_COUNT    (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK     (TIMER_WHEEL_SLOT_COUNT - 1)
+#define TIMER_WHEEL_LEVELS        4
+
 //
 // Internal data
 //
 
+///
+/// Timers whose jiffy has been reached by the timer wheel, sorted by trigger time
+///
 LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
@@ -21,44 +41,338 @@ EFI_EVENT        mEfiCheckTimerEvent = NULL;
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+LIST_ENTRY       mTimerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOT_COUNT];
+///
+/// Bit N of level L is set if slot N of level L may be non-empty
+///
+UINT64           mTimerWheelBitmap[TIMER_WHEEL_LEVELS];
+LIST_ENTRY       mTimerWheelOverflow = INITIALIZE_LIST_HEAD_VARIABLE (mTimerWheelOverflow);
+///
+/// The next jiffy to be processed by the timer wheel
+///
+UINT64           mTimerWheelJiffy = 0;
+///
+/// The system time at which the timer wheel has to be advanced
+///
+UINT64           mTimerWheelNextExpiry = MAX_UINT64;
+
+TIMER_STATISTICS mTimerStatistics;
+UINT64           mTimerCounterStart = 0;
+UINT64           mTimerCounterEnd = 0;
+
 //
 // Timer functions
 //
+
 /**
-  Inserts the timer event.
+  Returns the first block of a timer wheel level that starts at or after the
+  next jiffy to be processed.
+
+  @param  Level                  The timer wheel level.
+
+  @return The block number, in units of the slot size of Level.
+
+**/
+UINT64
+CoreTimerWheelFirstBlock (
+  IN UINTN    Level
+  )
+{
+  UINTN       Shift;
+
+  Shift = Level * TIMER_WHEEL_SLOT_BITS;
+  return RShiftU64 (mTimerWheelJiffy + LShiftU64 (1, Shift) - 1, Shift);
+}
+
+/**
+  Returns the jiffy at which a slot of the timer wheel is processed next.
+
+  @param  Level                  The timer wheel level.
+  @param  Slot                   The slot in Level.
+
+  @return The jiffy at which the slot is processed next.
+
+**/
+UINT64
+CoreTimerWheelSlotJiffy (
+  IN UINTN    Level,
+  IN UINTN    Slot
+  )
+{
+  UINT64      Block;
+
+  Block  = CoreTimerWheelFirstBlock (Level);
+  Block += (Slot - (UINTN) Block) & TIMER_WHEEL_SLOT_MASK;
+  return LShiftU64 (Block, Level * TIMER_WHEEL_SLOT_BITS);
+}
+
+/**
+  Returns the next jiffy at which the timer wheel has work to do.
+
+  @return The next jiffy to process, or MAX_UINT64 if the timer wheel is empty.
+
+**/
+UINT64
+CoreTimerWheelNextJiffy (
+  VOID
+  )
+{
+  UINT64      NextJiffy;
+  UINT64      Jiffy;
+  UINTN       Level;
+  UINTN       FirstSlot;
+  UINTN       Slot;
+
+  NextJiffy = MAX_UINT64;
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    FirstSlot = (UINTN) CoreTimerWheelFirstBlock (Level) & TIMER_WHEEL_SLOT_MASK;
+    while (mTimerWheelBitmap[Level] != 0) {
+      Slot = (FirstSlot + (UINTN) LowBitSet64 (RRotU64 (mTimerWheelBitmap[Level], FirstSlot))) & TIMER_WHEEL_SLOT_MASK;
+      if (IsListEmpty (&mTimerWheel[Level][Slot])) {
+        //
+        // The timers of this slot have been cancelled.
+        //
+        mTimerWheelBitmap[Level] &= ~LShiftU64 (1, Slot);
+        continue;
+      }
+      Jiffy = CoreTimerWheelSlotJiffy (Level, Slot);
+      if (Jiffy < NextJiffy) {
+        NextJiffy = Jiffy;
+      }
+      break;
+    }
+  }
+
+  //
+  // The overflow list is rechecked at every block of the top level.
+  //
+  if (!IsListEmpty (&mTimerWheelOverflow)) {
+    Jiffy = LShiftU64 (
+              CoreTimerWheelFirstBlock (TIMER_WHEEL_LEVELS - 1),
+              (TIMER_WHEEL_LEVELS - 1) * TIMER_WHEEL_SLOT_BITS
+              );
+    if (Jiffy < NextJiffy) {
+      NextJiffy = Jiffy;
+    }
+  }
+
+  return NextJiffy;
+}
+
+/**
+  Sets the system time at which the timer wheel has to be advanced.
+
+  CoreTimerTick() reads it at TPL_HIGH_LEVEL, so it is written under the
+  system time lock to keep the 64-bit read from tearing on 32-bit processors.
+
+  @param  NextExpiry             The system time at which the timer wheel has
+                                 to be advanced.
+
+**/
+VOID
+CoreSetTimerWheelNextExpiry (
+  IN UINT64   NextExpiry
+  )
+{
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mTimerWheelNextExpiry = NextExpiry;
+  CoreReleaseLock (&mEfiSystemTimeLock);
+}
+
+/**
+  Updates the system time at which the timer wheel has to be advanced.
+
+**/
+VOID
+CoreUpdateTimerWheelNextExpiry (
+  VOID
+  )
+{
+  UINT64      NextJiffy;
+
+  NextJiffy = CoreTimerWheelNextJiffy ();
+  if (NextJiffy == MAX_UINT64) {
+    CoreSetTimerWheelNextExpiry (MAX_UINT64);
+  } else {
+    CoreSetTimerWheelNextExpiry (LShiftU64 (NextJiffy, TIMER_WHEEL_JIFFY_SHIFT));
+  }
+}
+
+/**
+  Places a timer event in the timer wheel, or in the sorted timer list if the
+  timer wheel has already reached the jiffy of the timer.
 
   @param  Event                  Points to the internal structure of timer event
-                                 to be installed
+                                 to be placed
 
 **/
 VOID
-CoreInsertEventTimer (
+CoreTimerWheelInsert (
   IN IEVENT   *Event
   )
 {
   UINT64          TriggerTime;
+  UINT64          Jiffy;
+  UINT64          Delta;
+  UINTN           Level;
+  UINTN           Slot;
   LIST_ENTRY      *Link;
   IEVENT          *Event2;
 
-  ASSERT_LOCKED (&mEfiTimerLock);
-
-  //
-  // Get the timer's trigger time
-  //
   TriggerTime = Event->Timer.TriggerTime;
+  Jiffy       = RShiftU64 (TriggerTime, TIMER_WHEEL_JIFFY_SHIFT);
+
+  if (Jiffy < mTimerWheelJiffy) {
+    //
+    // Insert the timer into the timer list in assending sorted order
+    //
+    for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
+      Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+
+      if (Event2->Timer.TriggerTime > TriggerTime) {
+        break;
+      }
+    }
+
+    InsertTailList (Link, &Event->Timer.Link);
+    return;
+  }
+
+  Delta = Jiffy - mTimerWheelJiffy;
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    if (Delta < LShiftU64 (1, (Level + 1) * TIMER_WHEEL_SLOT_BITS)) {
+      Slot = (UINTN) RShiftU64 (Jiffy, Level * TIMER_WHEEL_SLOT_BITS) & TIMER_WHEEL_SLOT_MASK;
+      InsertTailList (&mTimerWheel[Level][Slot], &Event->Timer.Link);
+      mTimerWheelBitmap[Level] |= LShiftU64 (1, Slot);
+      Jiffy = CoreTimerWheelSlotJiffy (Level, Slot);
+      if (LShiftU64 (Jiffy, TIMER_WHEEL_JIFFY_SHIFT) < mTimerWheelNextExpiry) {
+        CoreSetTimerWheelNextExpiry (LShiftU64 (Jiffy, TIMER_WHEEL_JIFFY_SHIFT));
+      }
+      return;
+    }
+  }
+
+  InsertTailList (&mTimerWheelOverflow, &Event->Timer.Link);
+  CoreUpdateTimerWheelNextExpiry ();
+}
+
+/**
+  Places again all the timers of a timer wheel slot, relative to the current
+  position of the timer wheel.
+
+  @param  List                   The timer wheel slot, or the overflow list.
+
+**/
+VOID
+CoreTimerWheelCascade (
+  IN LIST_ENTRY   *List
+  )
+{
+  LIST_ENTRY      Pending;
+  IEVENT          *Event;
+
+  if (IsListEmpty (List)) {
+    return;
+  }
 
   //
-  // Insert the timer into the timer database in assending sorted order
+  // Timers of the overflow list may go back to it, so move them away first.
   //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  Pending.ForwardLink = List->ForwardLink;
+  Pending.BackLink    = List->BackLink;
+  Pending.ForwardLink->BackLink = &Pending;
+  Pending.BackLink->ForwardLink = &Pending;
+  InitializeListHead (List);
+
+  while (!IsListEmpty (&Pending)) {
+    Event = CR (Pending.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    RemoveEntryList (&Event->Timer.Link);
+    CoreTimerWheelInsert (Event);
+    mTimerStatistics.CascadeCount++;
+  }
+}
+
+/**
+  Advances the timer wheel to the system time, and moves all the timers whose
+  jiffy has been reached to the sorted timer list.
+
+  @param  SystemTime             The current system time.
+
+**/
+VOID
+CoreAdvanceTimerWheel (
+  IN UINT64   SystemTime
+  )
+{
+  UINT64      TargetJiffy;
+  UINT64      Jiffy;
+  UINTN       Level;
+  UINTN       Shift;
+  UINTN       Slot;
+
+  TargetJiffy = RShiftU64 (SystemTime, TIMER_WHEEL_JIFFY_SHIFT);
 
-    if (Event2->Timer.TriggerTime > TriggerTime) {
+  while (mTimerWheelJiffy <= TargetJiffy) {
+    //
+    // Skip the jiffies without work.
+    //
+    Jiffy = CoreTimerWheelNextJiffy ();
+    if (Jiffy > TargetJiffy) {
+      mTimerWheelJiffy = TargetJiffy + 1;
       break;
     }
+
+    mTimerWheelJiffy = Jiffy + 1;
+
+    //
+    // At the start of a block of an upper level, spread the timers of the
+    // block to the lower levels.
+    //
+    for (Level = TIMER_WHEEL_LEVELS - 1; Level > 0; Level--) {
+      Shift = Level * TIMER_WHEEL_SLOT_BITS;
+      if ((Jiffy & (LShiftU64 (1, Shift) - 1)) != 0) {
+        continue;
+      }
+      if (Level == TIMER_WHEEL_LEVELS - 1) {
+        CoreTimerWheelCascade (&mTimerWheelOverflow);
+      }
+      Slot = (UINTN) RShiftU64 (Jiffy, Shift) & TIMER_WHEEL_SLOT_MASK;
+      mTimerWheelBitmap[Level] &= ~LShiftU64 (1, Slot);
+      CoreTimerWheelCascade (&mTimerWheel[Level][Slot]);
+    }
+
+    //
+    // Move the timers of this jiffy to the sorted timer list. The slot may
+    // receive the timers that are one full turn of level 0 away.
+    //
+    Slot = (UINTN) Jiffy & TIMER_WHEEL_SLOT_MASK;
+    mTimerWheelBitmap[0] &= ~LShiftU64 (1, Slot);
+    CoreTimerWheelCascade (&mTimerWheel[0][Slot]);
   }
 
-  InsertTailList (Link, &Event->Timer.Link);
+  CoreUpdateTimerWheelNextExpiry ();
+}
+
+/**
+  Inserts the timer event.
+
+  @param  Event                  Points to the internal structure of timer event
+                                 to be installed
+
+**/
+VOID
+CoreInsertEventTimer (
+  IN IEVENT   *Event
+  )
+{
+  ASSERT_LOCKED (&mEfiTimerLock);
+
+  CoreTimerWheelInsert (Event);
+
+  mTimerStatistics.ActiveTimers++;
+  if (mTimerStatistics.ActiveTimers > mTimerStatistics.PeakActiveTimers) {
+    mTimerStatistics.PeakActiveTimers = mTimerStatistics.ActiveTimers;
+  }
 }
 
 /**
@@ -82,7 +396,7 @@ CoreCurrentSystemTime (
 }
 
 /**
-  Checks the sorted timer list against the current system time.
+  Checks the timer wheel against the current system time.
   Signals any expired event timer.
 
   @param  CheckEvent             Not used
@@ -98,6 +412,13 @@ CoreCheckTimers (
 {
   UINT64                  SystemTime;
   IEVENT                  *Event;
+  UINT64                  StartCounter;
+  UINT64                  Elapsed;
+
+  StartCounter = 0;
+  DEBUG_CODE_BEGIN ();
+  StartCounter = GetPerformanceCounter ();
+  DEBUG_CODE_END ();
 
   //
   // Check the timer database for expired timers
@@ -105,6 +426,8 @@ CoreCheckTimers (
   CoreAcquireLock (&mEfiTimerLock);
   SystemTime = CoreCurrentSystemTime ();
 
+  CoreAdvanceTimerWheel (SystemTime);
+
   while (!IsListEmpty (&mEfiTimerList)) {
     Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
 
@@ -121,6 +444,8 @@ CoreCheckTimers (
 
     RemoveEntryList (&Event->Timer.Link);
     Event->Timer.Link.ForwardLink = NULL;
+    mTimerStatistics.ActiveTimers--;
+    mTimerStatistics.SignalCount++;
 
     //
     // Signal it
@@ -151,6 +476,19 @@ CoreCheckTimers (
     }
   }
 
+  mTimerStatistics.CheckCount++;
+  DEBUG_CODE_BEGIN ();
+  if (mTimerCounterEnd >= mTimerCounterStart) {
+    Elapsed = GetPerformanceCounter () - StartCounter;
+  } else {
+    Elapsed = StartCounter - GetPerformanceCounter ();
+  }
+  mTimerStatistics.CheckCounterTicks += Elapsed;
+  if (Elapsed > mTimerStatistics.MaxCheckCounterTicks) {
+    mTimerStatistics.MaxCheckCounterTicks = Elapsed;
+  }
+  DEBUG_CODE_END ();
+
   CoreReleaseLock (&mEfiTimerLock);
 }
 
@@ -165,6 +503,18 @@ CoreInitializeTimer (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Level;
+  UINTN       Slot;
+
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    for (Slot = 0; Slot < TIMER_WHEEL_SLOT_COUNT; Slot++) {
+      InitializeListHead (&mTimerWheel[Level][Slot]);
+    }
+  }
+
+  DEBUG_CODE_BEGIN ();
+  GetPerformanceCounterProperties (&mTimerCounterStart, &mTimerCounterEnd);
+  DEBUG_CODE_END ();
 
   Status = CoreCreateEventInternal (
              EVT_NOTIFY_SIGNAL,
@@ -204,10 +554,12 @@ CoreTimerTick (
   mEfiSystemTime += Duration;
 
   //
-  // If the head of the list is expired, fire the timer event
-  // to process it
+  // If the head of the list is expired, or the timer wheel has timers to
+  // move to the list, fire the timer event to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
+  if (mEfiSystemTime >= mTimerWheelNextExpiry) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
+  } else if (!IsListEmpty (&mEfiTimerList)) {
     Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
 
     if (Event->Timer.TriggerTime <= mEfiSystemTime) {
@@ -219,6 +571,36 @@ CoreTimerTick (
 }
 
 
+/**
+  Dumps the statistics of the timer services.
+
+**/
+VOID
+CoreDumpTimerStatistics (
+  VOID
+  )
+{
+  DEBUG ((
+    DEBUG_INFO,
+    "Timer: %d armed (peak %d), %ld set, %ld cancelled, %ld signaled, %ld cascaded\n",
+    mTimerStatistics.ActiveTimers,
+    mTimerStatistics.PeakActiveTimers,
+    mTimerStatistics.SetCount,
+    mTimerStatistics.CancelCount,
+    mTimerStatistics.SignalCount,
+    mTimerStatistics.CascadeCount
+    ));
+  DEBUG_CODE_BEGIN ();
+  DEBUG ((
+    DEBUG_INFO,
+    "Timer: %ld checks, %ld ns total, %ld ns max\n",
+    mTimerStatistics.CheckCount,
+    GetTimeInNanoSecond (mTimerStatistics.CheckCounterTicks),
+    GetTimeInNanoSecond (mTimerStatistics.MaxCheckCounterTicks)
+    ));
+  DEBUG_CODE_END ();
+}
+
 
 /**
   Sets the type of timer and the trigger time for a timer event.
@@ -267,6 +649,8 @@ CoreSetTimer (
   if (Event->Timer.Link.ForwardLink != NULL) {
     RemoveEntryList (&Event->Timer.Link);
     Event->Timer.Link.ForwardLink = NULL;
+    mTimerStatistics.ActiveTimers--;
+    mTimerStatistics.CancelCount++;
   }
 
   Event->Timer.TriggerTime = 0;
@@ -283,6 +667,7 @@ CoreSetTimer (
 
     Event->Timer.TriggerTime = CoreCurrentSystemTime () + TriggerTime;
     CoreInsertEventTimer (Event);
+    mTimerStatistics.SetCount++;
 
     if (TriggerTime == 0) {
       CoreSignalEvent (mEfiCheckTimerEvent);
@@ -42,6 +42,7 @@ FV_DEVICE mFvDevice = {
   0,
   0,
   FALSE,
+  FALSE,
   FALSE
 };
 
@@ -299,6 +300,37 @@ FreeFvDeviceResource (
 
 
 
+/**
+  Check if a memory mapped FV is entirely located in system memory.
+
+  @param  BaseAddress           The base address of the FV.
+  @param  Length                The length of the FV.
+
+  @retval TRUE                  The FV is in system memory.
+  @retval FALSE                 The FV is not in system memory, or only partly.
+
+**/
+BOOLEAN
+IsFvInSystemMemory (
+  IN EFI_PHYSICAL_ADDRESS       BaseAddress,
+  IN UINT64                     Length
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_GCD_MEMORY_SPACE_DESCRIPTOR   Descriptor;
+
+  Status = CoreGetMemorySpaceDescriptor (BaseAddress, &Descriptor);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  if (Descriptor.GcdMemoryType != EfiGcdMemoryTypeSystemMemory) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) (BaseAddress + Length <= Descriptor.BaseAddress + Descriptor.Length);
+}
+
 /**
   Check if an FV is consistent and allocate cache for it.
 
@@ -358,6 +390,12 @@ FvCheck (
     // Don't cache memory mapped FV really.
     //
     FvDevice->CachedFv = (UINT8 *) (UINTN) PhysicalAddress;
+
+    //
+    // A memory mapped FV in system memory (e.g. decompressed by DxeIpl) is
+    // as fast to read as a cached copy, so its files are not cached either.
+    //
+    FvDevice->IsInSystemMemory = IsFvInSystemMemory (PhysicalAddress, Size);
   } else {
     FvDevice->IsMemoryMapped = FALSE;
     FvDevice->CachedFv = AllocatePool (Size);
@@ -481,7 +519,7 @@ FvCheck (
 
     CacheFfsHeader = FfsHeader;
     if ((CacheFfsHeader->Attributes & FFS_ATTRIB_CHECKSUM) == FFS_ATTRIB_CHECKSUM) {
-      if (FvDevice->IsMemoryMapped) {
+      if (FvDevice->IsMemoryMapped && !FvDevice->IsInSystemMemory) {
         //
         // Memory mapped FV has not been cached.
         // Here is to cache FFS file to memory buffer for following checksum calculating.
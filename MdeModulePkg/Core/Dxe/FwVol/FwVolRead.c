@@ -320,7 +320,7 @@ FvReadFile (
   // Get a pointer to the header
   //
   FfsHeader = FvDevice->LastKey->FfsHeader;
-  if (FvDevice->IsMemoryMapped) {
+  if (FvDevice->IsMemoryMapped && !FvDevice->IsInSystemMemory) {
     //
     // Memory mapped FV has not been cached, so here is to cache by file.
     //
@@ -533,4 +533,127 @@ Done:
   return Status;
 }
 
+/**
+  Locates the first leaf section of the given type in a file without copying
+  it. Only the sections found directly in the file are examined, so the
+  search stops at the first encapsulation section: the section returned is
+  the same one FvReadFileSection() would return for SectionInstance 0.
+
+  The returned buffer points into the firmware volume (or into the cached
+  file for FVs that are not in system memory) and stays valid as long as the
+  firmware volume is installed. It must not be modified or freed.
+
+  @param  This                  Pointer to an EFI_FIRMWARE_VOLUME2_PROTOCOL
+                                instance produced by the DXE core.
+  @param  NameGuid              Filename identifying the file from which to
+                                locate the section.
+  @param  SectionType           Indicates the section type to return.
+  @param  Buffer                On output, points to the section data.
+  @param  BufferSize            On output, the size of the section data.
+  @param  AuthenticationStatus  On output, the authentication status of the
+                                section.
+
+  @retval EFI_SUCCESS           The section is located.
+  @retval EFI_UNSUPPORTED       This is not produced by the DXE core.
+  @retval EFI_NOT_FOUND         The section is not found at the top level of
+                                the file. FvReadFileSection() must be used.
+  @retval EFI_INVALID_PARAMETER Invalid parameter.
+
+**/
+EFI_STATUS
+FvLocateFileSection (
+  IN CONST  EFI_FIRMWARE_VOLUME2_PROTOCOL  *This,
+  IN CONST  EFI_GUID                       *NameGuid,
+  IN        EFI_SECTION_TYPE               SectionType,
+  OUT       VOID                           **Buffer,
+  OUT       UINTN                          *BufferSize,
+  OUT       UINT32                         *AuthenticationStatus
+  )
+{
+  EFI_STATUS                        Status;
+  FV_DEVICE                         *FvDevice;
+  EFI_FV_FILETYPE                   FileType;
+  EFI_FV_FILE_ATTRIBUTES            FileAttributes;
+  UINTN                             FileSize;
+  UINT8                             *FileBuffer;
+  EFI_COMMON_SECTION_HEADER         *Section;
+  UINTN                             Offset;
+  UINTN                             SectionSize;
+  UINTN                             SectionHeaderSize;
+
+  if (This == NULL || NameGuid == NULL || Buffer == NULL || BufferSize == NULL ||
+      AuthenticationStatus == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (This->ReadSection != FvReadFileSection) {
+    return EFI_UNSUPPORTED;
+  }
 
+  FvDevice = FV_DEVICE_FROM_THIS (This);
+
+  Status = FvReadFile (
+             This,
+             NameGuid,
+             NULL,
+             &FileSize,
+             &FileType,
+             &FileAttributes,
+             AuthenticationStatus
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (FileType == EFI_FV_FILETYPE_RAW) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (IS_FFS_FILE2 (FvDevice->LastKey->FfsHeader)) {
+    FileBuffer = ((UINT8 *) FvDevice->LastKey->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER2);
+  } else {
+    FileBuffer = ((UINT8 *) FvDevice->LastKey->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER);
+  }
+
+  Offset = 0;
+  while (Offset + sizeof (EFI_COMMON_SECTION_HEADER) <= FileSize) {
+    Section = (EFI_COMMON_SECTION_HEADER *) (FileBuffer + Offset);
+    if (IS_SECTION2 (Section)) {
+      if (!FvDevice->IsFfs3Fv || Offset + sizeof (EFI_COMMON_SECTION_HEADER2) > FileSize) {
+        return EFI_NOT_FOUND;
+      }
+      SectionSize       = SECTION2_SIZE (Section);
+      SectionHeaderSize = sizeof (EFI_COMMON_SECTION_HEADER2);
+    } else {
+      SectionSize       = SECTION_SIZE (Section);
+      SectionHeaderSize = sizeof (EFI_COMMON_SECTION_HEADER);
+    }
+    if (SectionSize < SectionHeaderSize || SectionSize > FileSize - Offset) {
+      return EFI_NOT_FOUND;
+    }
+
+    if (Section->Type == SectionType) {
+      *Buffer     = (UINT8 *) Section + SectionHeaderSize;
+      *BufferSize = SectionSize - SectionHeaderSize;
+      //
+      // A leaf section at the top level of the file only inherits the
+      // authentication status of the FV.
+      //
+      *AuthenticationStatus = FvDevice->AuthenticationStatus;
+      return EFI_SUCCESS;
+    }
+
+    if (Section->Type == EFI_SECTION_COMPRESSION ||
+        Section->Type == EFI_SECTION_GUID_DEFINED ||
+        Section->Type == EFI_SECTION_DISPOSABLE) {
+      //
+      // Let the section extraction search the encapsulated sections.
+      //
+      return EFI_NOT_FOUND;
+    }
+
+    Offset = ALIGN_VALUE (Offset + SectionSize, 4);
+  }
+
+  return EFI_NOT_FOUND;
+}
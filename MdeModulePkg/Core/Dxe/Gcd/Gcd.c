@@ -3,7 +3,7 @@
   The GCD services are used to manage the memory and I/O regions that
   are accessible to the CPU that is executing the DXE core.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -2401,6 +2401,8 @@ CoreInitializeGcdServices (
   UINTN                              Index;
   UINT64                             Capabilities;
   EFI_HOB_CPU *                      CpuHob;
+  VOID                               *GuidHob;
+  HOB_INDEX_HEADER                   *HobIndex;
   EFI_GCD_MEMORY_SPACE_DESCRIPTOR    *MemorySpaceMapHobList;
 
   //
@@ -2642,6 +2644,19 @@ CoreInitializeGcdServices (
                  );
   ASSERT (NewHobList != NULL);
 
+  //
+  // The GUID HOB index built by DxeIpl records HOB offsets from the start of
+  // the HOB list, which the copy keeps. Rebase it on the relocated HOB list.
+  //
+  GuidHob = GetNextGuidHob (&gEdkiiHobIndexGuid, NewHobList);
+  if (GuidHob != NULL) {
+    HobIndex = (HOB_INDEX_HEADER *) (UINTN) (*(EFI_PHYSICAL_ADDRESS *) GET_GUID_HOB_DATA (GuidHob));
+    if ((HobIndex->Signature == HOB_INDEX_SIGNATURE) &&
+        (HobIndex->HobList == (EFI_PHYSICAL_ADDRESS) (UINTN) *HobStart)) {
+      HobIndex->HobList = (EFI_PHYSICAL_ADDRESS) (UINTN) NewHobList;
+    }
+  }
+
   *HobStart = NewHobList;
   gHobList  = NewHobList;
 
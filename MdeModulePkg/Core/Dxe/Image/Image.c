@@ -86,6 +86,13 @@ GLOBAL_REMOVE_IF_UNREFERENCED MACHINE_TYPE_INFO  mMachineTypeInfo[] = {
 
 UINT16 mDxeCoreImageMachineType = 0;
 
+//
+// Number of images and bytes that were read in place from a memory mapped
+// firmware volume instead of being copied into a pool buffer first.
+//
+UINTN  mImageInPlaceCount = 0;
+UINTN  mImageInPlaceBytes = 0;
+
 /**
  Return machine type name.
 
@@ -1061,6 +1068,74 @@ CoreUnloadAndCloseImage (
 }
 
 
+/**
+  Locates the PE32 section of an image stored in a firmware volume produced by
+  the DXE core, without copying it.
+
+  @param  DeviceHandle           Handle of the firmware volume.
+  @param  FilePath               The firmware volume file path node of the image.
+  @param  SourceSize             On output, the size of the PE32 section.
+  @param  AuthenticationStatus   On output, the authentication status of the
+                                 PE32 section.
+
+  @return Pointer to the PE32 section data in the firmware volume, or NULL if
+          the section cannot be read in place.
+
+**/
+VOID *
+CoreGetImageBufferInFv (
+  IN  EFI_HANDLE                DeviceHandle,
+  IN  EFI_DEVICE_PATH_PROTOCOL  *FilePath,
+  OUT UINTN                     *SourceSize,
+  OUT UINT32                    *AuthenticationStatus
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_GUID                       *NameGuid;
+  EFI_FIRMWARE_VOLUME2_PROTOCOL  *Fv;
+  VOID                           *Buffer;
+
+  NameGuid = EfiGetNameGuidFromFwVolDevicePathNode (
+               (CONST MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *) FilePath
+               );
+  if (NameGuid == NULL || !IsDevicePathEnd (NextDevicePathNode (FilePath))) {
+    return NULL;
+  }
+
+  Status = CoreHandleProtocol (DeviceHandle, &gEfiFirmwareVolume2ProtocolGuid, (VOID **) &Fv);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  Status = FvLocateFileSection (
+             Fv,
+             NameGuid,
+             EFI_SECTION_PE32,
+             &Buffer,
+             SourceSize,
+             AuthenticationStatus
+             );
+  if (EFI_ERROR (Status)) {
+    *AuthenticationStatus = 0;
+    return NULL;
+  }
+
+  mImageInPlaceCount++;
+  mImageInPlaceBytes += *SourceSize;
+  DEBUG ((
+    DEBUG_LOAD | DEBUG_VERBOSE,
+    "Image %g read in place: 0x%Lx bytes (0x%Lx pages) not copied, total %Lu images 0x%Lx bytes\n",
+    NameGuid,
+    (UINT64) *SourceSize,
+    (UINT64) EFI_SIZE_TO_PAGES (*SourceSize),
+    (UINT64) mImageInPlaceCount,
+    (UINT64) mImageInPlaceBytes
+    ));
+
+  return Buffer;
+}
+
+
 /**
   Loads an EFI image into memory and returns a handle to the image.
 
@@ -1210,25 +1285,42 @@ CoreLoadImageCommon (
     }
 
     //
-    // Get the source file buffer by its device path.
+    // The PE32 section of an image in a firmware volume produced by the DXE
+    // core is read in place, so the image is copied only once into its pages.
     //
-    FHand.Source = GetFileBufferByFilePath (
-                      BootPolicy,
-                      FilePath,
-                      &FHand.SourceSize,
-                      &AuthenticationStatus
-                      );
+    FHand.Source = NULL;
+    if (ImageIsFromFv) {
+      FHand.Source = CoreGetImageBufferInFv (
+                       DeviceHandle,
+                       HandleFilePath,
+                       &FHand.SourceSize,
+                       &AuthenticationStatus
+                       );
+    }
+
     if (FHand.Source == NULL) {
-      Status = EFI_NOT_FOUND;
-    } else {
-      FHand.FreeBuffer = TRUE;
-      if (ImageIsFromLoadFile) {
-        //
-        // LoadFile () may cause the device path of the Handle be updated.
-        //
-        OriginalFilePath = AppendDevicePath (DevicePathFromHandle (DeviceHandle), Node);
+      //
+      // Get the source file buffer by its device path.
+      //
+      FHand.Source = GetFileBufferByFilePath (
+                        BootPolicy,
+                        FilePath,
+                        &FHand.SourceSize,
+                        &AuthenticationStatus
+                        );
+      if (FHand.Source != NULL) {
+        FHand.FreeBuffer = TRUE;
       }
     }
+
+    if (FHand.Source == NULL) {
+      Status = EFI_NOT_FOUND;
+    } else if (ImageIsFromLoadFile) {
+      //
+      // LoadFile () may cause the device path of the Handle be updated.
+      //
+      OriginalFilePath = AppendDevicePath (DevicePathFromHandle (DeviceHandle), Node);
+    }
   }
 
   if (EFI_ERROR (Status)) {
@@ -38,6 +38,15 @@ GLOBAL_REMOVE_IF_UNREFERENCED UINTN mLevelShift[GUARDED_HEAP_MAP_TABLE_DEPTH]
 GLOBAL_REMOVE_IF_UNREFERENCED UINTN mLevelMask[GUARDED_HEAP_MAP_TABLE_DEPTH]
                                     = GUARDED_HEAP_MAP_TABLE_DEPTH_MASKS;
 
+//
+// Memo of the last L4 map table located and the index of the 256MB unit it
+// tracks. Map tables are never freed or moved (growing the table depth only
+// adds tables above), so a memorized L4 table stays valid and most lookups of
+// adjacent addresses skip the walk through the upper levels.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED UINT64  *mLastGuardedMemoryMapUnit = NULL;
+GLOBAL_REMOVE_IF_UNREFERENCED UINT64  mLastGuardedMemoryMapUnitIndex = (UINT64)-1;
+
 //
 // Used for promoting freed but not used pages.
 //
@@ -223,10 +232,19 @@ FindGuardedMemoryMap (
   UINTN                   Index;
   UINTN                   Size;
   UINTN                   BitsToUnitEnd;
+  UINT64                  UnitIndex;
   EFI_STATUS              Status;
 
   MapMemory = 0;
 
+  UnitIndex = RShiftU64 (Address, GUARDED_HEAP_MAP_TABLE_SHIFT);
+  if (mLastGuardedMemoryMapUnit != NULL &&
+      UnitIndex == mLastGuardedMemoryMapUnitIndex) {
+    *BitMap = mLastGuardedMemoryMapUnit
+              + (UINTN)GUARDED_HEAP_MAP_ENTRY_INDEX (Address);
+    return GUARDED_HEAP_MAP_BITS - GUARDED_HEAP_MAP_BIT_INDEX (Address);
+  }
+
   //
   // Adjust current map table depth according to the address to access
   //
@@ -292,6 +310,21 @@ FindGuardedMemoryMap (
 
   }
 
+  //
+  // Memorize the L4 table only if the address is really tracked by current
+  // map table depth, instead of aliased to a lower address.
+  //
+  if (GuardMap != NULL &&
+      (mMapLevel == GUARDED_HEAP_MAP_TABLE_DEPTH ||
+       RShiftU64 (
+         Address,
+         mLevelShift[GUARDED_HEAP_MAP_TABLE_DEPTH - mMapLevel - 1]
+         ) == 0)) {
+    mLastGuardedMemoryMapUnit      = GuardMap
+                                     - (UINTN)GUARDED_HEAP_MAP_ENTRY_INDEX (Address);
+    mLastGuardedMemoryMapUnitIndex = UnitIndex;
+  }
+
   BitsToUnitEnd = GUARDED_HEAP_MAP_BITS - GUARDED_HEAP_MAP_BIT_INDEX (Address);
   *BitMap       = GuardMap;
 
@@ -1464,29 +1497,37 @@ MergeGuardPages (
   EFI_PHYSICAL_ADDRESS        EndAddress;
   UINT64                      Bitmap;
   INTN                        Pages;
+  INTN                        Run;
 
   if (!IsHeapGuardEnabled (GUARD_HEAP_TYPE_FREED) ||
       MemoryMapEntry->Type >= EfiMemoryMappedIO) {
     return;
   }
 
-  Bitmap = 0;
   Pages  = EFI_SIZE_TO_PAGES ((UINTN)(MaxAddress - MemoryMapEntry->PhysicalStart));
   Pages -= (INTN)MemoryMapEntry->NumberOfPages;
   while (Pages > 0) {
-    if (Bitmap == 0) {
-      EndAddress = MemoryMapEntry->PhysicalStart +
-                   EFI_PAGES_TO_SIZE ((UINTN)MemoryMapEntry->NumberOfPages);
-      Bitmap = GetGuardedMemoryBits (EndAddress, GUARDED_HEAP_MAP_ENTRY_BITS);
+    EndAddress = MemoryMapEntry->PhysicalStart +
+                 EFI_PAGES_TO_SIZE ((UINTN)MemoryMapEntry->NumberOfPages);
+    Bitmap = GetGuardedMemoryBits (EndAddress, GUARDED_HEAP_MAP_ENTRY_BITS);
+
+    //
+    // Count the run of guarded free pages at once, instead of bit by bit.
+    //
+    if (Bitmap == (UINT64)-1) {
+      Run = GUARDED_HEAP_MAP_ENTRY_BITS;
+    } else {
+      Run = LowBitSet64 (~Bitmap);
+    }
+    if (Run > Pages) {
+      Run = Pages;
     }
 
-    if ((Bitmap & 1) == 0) {
+    Pages -= Run;
+    MemoryMapEntry->NumberOfPages += Run;
+    if (Run < GUARDED_HEAP_MAP_ENTRY_BITS) {
       break;
     }
-
-    Pages--;
-    MemoryMapEntry->NumberOfPages++;
-    Bitmap = RShiftU64 (Bitmap, 1);
   }
 }
 
@@ -1518,6 +1559,7 @@ PromoteGuardedFreePages (
   EFI_STATUS              Status;
   UINTN                   AvailablePages;
   UINT64                  Bitmap;
+  UINTN                   Zeros;
   EFI_PHYSICAL_ADDRESS    Start;
 
   if (!IsHeapGuardEnabled (GUARD_HEAP_TYPE_FREED)) {
@@ -1542,16 +1584,19 @@ PromoteGuardedFreePages (
     }
 
     Bitmap = GetGuardedMemoryBits (Start, GUARDED_HEAP_MAP_ENTRY_BITS);
-    while (Bitmap > 0) {
-      if ((Bitmap & 1) != 0) {
-        ++AvailablePages;
-      } else if (AvailablePages == 0) {
-        Start += EFI_PAGES_TO_SIZE (1);
+    if (Bitmap != 0) {
+      //
+      // Skip the leading non-guarded pages and take the first run of guarded
+      // free pages, using whole-word bit scans.
+      //
+      Zeros  = (UINTN)LowBitSet64 (Bitmap);
+      Start += EFI_PAGES_TO_SIZE (Zeros);
+      Bitmap = RShiftU64 (Bitmap, Zeros);
+      if (Bitmap == (UINT64)-1) {
+        AvailablePages = GUARDED_HEAP_MAP_ENTRY_BITS;
       } else {
-        break;
+        AvailablePages = (UINTN)LowBitSet64 (~Bitmap);
       }
-
-      Bitmap = RShiftU64 (Bitmap, 1);
     }
   }
 
@@ -11,6 +11,8 @@
 
 #define IS_UEFI_MEMORY_PROFILE_ENABLED ((PcdGet8 (PcdMemoryProfilePropertyMask) & BIT0) != 0)
 
+#define IS_UEFI_MEMORY_PROFILE_SAMPLING_ENABLED (PcdGet32 (PcdMemoryProfileSampleInterval) != 0)
+
 #define GET_OCCUPIED_SIZE(ActualSize, Alignment) \
   ((ActualSize) + (((Alignment) - ((ActualSize) & ((Alignment) - 1))) & ((Alignment) - 1)))
 
@@ -26,6 +28,8 @@ typedef struct {
   LIST_ENTRY                    *AllocInfoList;
   CHAR8                         *PdbString;
   LIST_ENTRY                    Link;
+  UINT64                        AllocateCount;
+  UINT64                        AllocateSize;
 } MEMORY_PROFILE_DRIVER_INFO_DATA;
 
 typedef struct {
@@ -63,6 +67,23 @@ GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN mMemoryProfileRecordingEnable = MEMORY_PRO
 GLOBAL_REMOVE_IF_UNREFERENCED EFI_DEVICE_PATH_PROTOCOL *mMemoryProfileDriverPath;
 GLOBAL_REMOVE_IF_UNREFERENCED UINTN                    mMemoryProfileDriverPathSize;
 
+GLOBAL_REMOVE_IF_UNREFERENCED MEMORY_PROFILE_SAMPLE_INFO mMemoryProfileSampleInfo = {
+  {
+    MEMORY_PROFILE_SAMPLE_INFO_SIGNATURE,
+    sizeof (MEMORY_PROFILE_SAMPLE_INFO),
+    MEMORY_PROFILE_SAMPLE_INFO_REVISION
+  },
+  0,
+  0,
+  0,
+  0,
+  0,
+  {0},
+  {0}
+};
+GLOBAL_REMOVE_IF_UNREFERENCED UINT32           mMemoryProfileSampleCountdown = 0;
+GLOBAL_REMOVE_IF_UNREFERENCED PHYSICAL_ADDRESS mMemoryProfileLastSampledBuffer = 0;
+
 /**
   Get memory profile data.
 
@@ -871,7 +892,10 @@ UnregisterMemoryProfileImage (
   //DriverInfoData->DriverInfo.ImageBase = 0;
   DriverInfoData->DriverInfo.ImageSize = 0;
 
-  if (DriverInfoData->DriverInfo.PeakUsage == 0) {
+  //
+  // Keep the driver info if it still holds sample counters.
+  //
+  if ((DriverInfoData->DriverInfo.PeakUsage == 0) && (DriverInfoData->AllocateCount == 0)) {
     ContextData->Context.ImageCount --;
     RemoveEntryList (&DriverInfoData->Link);
     //
@@ -1304,6 +1328,76 @@ CoreUpdateProfileFree (
   } while (TRUE);
 }
 
+/**
+  Update the memory profile sample counters for an allocate action, and decide
+  whether the allocate action is recorded in sampling mode.
+
+  Basic allocate actions always update the per driver and per memory type counters.
+  One in PcdMemoryProfileSampleInterval of them smaller than
+  PcdMemoryProfileSampleSizeThreshold is recorded, and every one of at least
+  PcdMemoryProfileSampleSizeThreshold is recorded. An extension allocate action is
+  recorded only if it describes the buffer of the last recorded basic allocate action,
+  so that the library action follows the core action it belongs to.
+
+  @param ContextData    Memory profile context.
+  @param CallerAddress  Address of caller who call Allocate.
+  @param Action         This Allocate action.
+  @param MemoryType     Memory type.
+  @param Size           Buffer size.
+  @param Buffer         Buffer address.
+
+  @retval TRUE          This allocate action need to be recorded.
+  @retval FALSE         This allocate action need not to be recorded.
+
+**/
+BOOLEAN
+CoreSampleProfileAllocate (
+  IN MEMORY_PROFILE_CONTEXT_DATA    *ContextData,
+  IN PHYSICAL_ADDRESS               CallerAddress,
+  IN MEMORY_PROFILE_ACTION          Action,
+  IN EFI_MEMORY_TYPE                MemoryType,
+  IN UINTN                          Size,
+  IN VOID                           *Buffer
+  )
+{
+  MEMORY_PROFILE_DRIVER_INFO_DATA   *DriverInfoData;
+  UINTN                             ProfileMemoryIndex;
+  UINT32                            SizeThreshold;
+
+  if (Action != (Action & MEMORY_PROFILE_ACTION_BASIC_MASK)) {
+    return (BOOLEAN) (mMemoryProfileLastSampledBuffer == (PHYSICAL_ADDRESS) (UINTN) Buffer);
+  }
+
+  DriverInfoData = GetMemoryProfileDriverInfoFromAddress (ContextData, CallerAddress);
+  if (DriverInfoData == NULL) {
+    //
+    // Let CoreUpdateProfileAllocate() filter it.
+    //
+    return TRUE;
+  }
+
+  ProfileMemoryIndex = GetProfileMemoryIndex (MemoryType);
+  mMemoryProfileSampleInfo.AllocateCount ++;
+  mMemoryProfileSampleInfo.AllocateCountByType[ProfileMemoryIndex] ++;
+  mMemoryProfileSampleInfo.AllocateSizeByType[ProfileMemoryIndex] += Size;
+  DriverInfoData->AllocateCount ++;
+  DriverInfoData->AllocateSize += Size;
+
+  mMemoryProfileLastSampledBuffer = 0;
+  SizeThreshold = PcdGet32 (PcdMemoryProfileSampleSizeThreshold);
+  if ((SizeThreshold == 0) || (Size < SizeThreshold)) {
+    if (mMemoryProfileSampleCountdown > 1) {
+      mMemoryProfileSampleCountdown --;
+      return FALSE;
+    }
+    mMemoryProfileSampleCountdown = PcdGet32 (PcdMemoryProfileSampleInterval);
+  }
+
+  mMemoryProfileSampleInfo.SampledCount ++;
+  mMemoryProfileLastSampledBuffer = (PHYSICAL_ADDRESS) (UINTN) Buffer;
+  return TRUE;
+}
+
 /**
   Update memory profile information.
 
@@ -1378,14 +1472,17 @@ CoreUpdateProfile (
   CoreAcquireMemoryProfileLock ();
   switch (BasicAction) {
     case MemoryProfileActionAllocatePages:
+    case MemoryProfileActionAllocatePool:
+      if (IS_UEFI_MEMORY_PROFILE_SAMPLING_ENABLED &&
+          !CoreSampleProfileAllocate (ContextData, CallerAddress, Action, MemoryType, Size, Buffer)) {
+        Status = EFI_SUCCESS;
+        break;
+      }
       Status = CoreUpdateProfileAllocate (CallerAddress, Action, MemoryType, Size, Buffer, ActionString);
       break;
     case MemoryProfileActionFreePages:
       Status = CoreUpdateProfileFree (CallerAddress, Action, Size, Buffer);
       break;
-    case MemoryProfileActionAllocatePool:
-      Status = CoreUpdateProfileAllocate (CallerAddress, Action, MemoryType, Size, Buffer, ActionString);
-      break;
     case MemoryProfileActionFreePool:
       Status = CoreUpdateProfileFree (CallerAddress, Action, 0, Buffer);
       break;
@@ -1455,6 +1552,11 @@ MemoryProfileGetDataSize (
     }
   }
 
+  if (IS_UEFI_MEMORY_PROFILE_SAMPLING_ENABLED) {
+    TotalSize += sizeof (MEMORY_PROFILE_SAMPLE_INFO);
+    TotalSize += ContextData->Context.ImageCount * sizeof (MEMORY_PROFILE_DRIVER_SAMPLE);
+  }
+
   return TotalSize;
 }
 
@@ -1472,6 +1574,8 @@ MemoryProfileCopyData (
   MEMORY_PROFILE_CONTEXT            *Context;
   MEMORY_PROFILE_DRIVER_INFO        *DriverInfo;
   MEMORY_PROFILE_ALLOC_INFO         *AllocInfo;
+  MEMORY_PROFILE_SAMPLE_INFO        *SampleInfo;
+  MEMORY_PROFILE_DRIVER_SAMPLE      *DriverSample;
   MEMORY_PROFILE_CONTEXT_DATA       *ContextData;
   MEMORY_PROFILE_DRIVER_INFO_DATA   *DriverInfoData;
   MEMORY_PROFILE_ALLOC_INFO_DATA    *AllocInfoData;
@@ -1528,6 +1632,35 @@ MemoryProfileCopyData (
 
     DriverInfo = (MEMORY_PROFILE_DRIVER_INFO *)  AllocInfo;
   }
+
+  if (!IS_UEFI_MEMORY_PROFILE_SAMPLING_ENABLED) {
+    return ;
+  }
+
+  SampleInfo = (MEMORY_PROFILE_SAMPLE_INFO *) DriverInfo;
+  CopyMem (SampleInfo, &mMemoryProfileSampleInfo, sizeof (MEMORY_PROFILE_SAMPLE_INFO));
+  SampleInfo->SampleInterval    = PcdGet32 (PcdMemoryProfileSampleInterval);
+  SampleInfo->SizeThreshold     = PcdGet32 (PcdMemoryProfileSampleSizeThreshold);
+  SampleInfo->DriverSampleCount = ContextData->Context.ImageCount;
+  DriverSample = (MEMORY_PROFILE_DRIVER_SAMPLE *) (SampleInfo + 1);
+
+  for (DriverLink = DriverInfoList->ForwardLink;
+       DriverLink != DriverInfoList;
+       DriverLink = DriverLink->ForwardLink) {
+    DriverInfoData = CR (
+                       DriverLink,
+                       MEMORY_PROFILE_DRIVER_INFO_DATA,
+                       Link,
+                       MEMORY_PROFILE_DRIVER_INFO_SIGNATURE
+                       );
+    DriverSample->Header.Signature = MEMORY_PROFILE_DRIVER_SAMPLE_SIGNATURE;
+    DriverSample->Header.Length    = sizeof (MEMORY_PROFILE_DRIVER_SAMPLE);
+    DriverSample->Header.Revision  = MEMORY_PROFILE_DRIVER_SAMPLE_REVISION;
+    DriverSample->ImageBase        = DriverInfoData->DriverInfo.ImageBase;
+    DriverSample->AllocateCount    = DriverInfoData->AllocateCount;
+    DriverSample->AllocateSize     = DriverInfoData->AllocateSize;
+    DriverSample ++;
+  }
 }
 
 /**
@@ -27,6 +27,11 @@
   3) A support protocol is not found, and the data is not available to be read
      without it.  This results in EFI_PROTOCOL_ERROR.
 
+  The data extracted from compressed and GUIDed encapsulations may be kept in a
+  cache bounded by PcdDxeSectionCacheSize, so that the same encapsulation opened
+  again from another stream is not decoded again. GUIDed encapsulations that
+  contribute authentication status are never cached.
+
 Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -92,6 +97,32 @@ typedef struct {
   VOID                        *Registration;
 } RPN_EVENT_CONTEXT;
 
+#define SECTION_CACHE_ENTRY_SIGNATURE  SIGNATURE_32('S','X','C','E')
+#define SECTION_CACHE_ENTRY_FROM_LINK(Node) \
+  CR (Node, SECTION_CACHE_ENTRY, Link, SECTION_CACHE_ENTRY_SIGNATURE)
+
+typedef struct {
+  UINT32                      Signature;
+  LIST_ENTRY                  Link;
+  //
+  // The encapsulation section the data was extracted from. The location is
+  // checked against the CRC32 of the section, as the memory of a stream may be
+  // reused for another stream once it is closed.
+  //
+  CONST VOID                  *Section;
+  UINT32                      SectionSize;
+  UINT32                      SectionCrc32;
+  //
+  // The GUID of a GUIDed section, zero for a compression section.
+  //
+  EFI_GUID                    SectionDefinitionGuid;
+  //
+  // The extracted data follows the entry.
+  //
+  UINTN                       DataSize;
+  UINT32                      AuthenticationStatus;
+} SECTION_CACHE_ENTRY;
+
 
 /**
   The ExtractSection() function processes the input section and
@@ -197,6 +228,30 @@ EFI_GUIDED_SECTION_EXTRACTION_PROTOCOL mCustomGuidedSectionExtractionProtocol =
   CustomGuidedSectionExtract
 };
 
+//
+// Cache of extracted section data, the most recently used entry first.
+//
+LIST_ENTRY                      mSectionCache = INITIALIZE_LIST_HEAD_VARIABLE (mSectionCache);
+EDKII_SECTION_CACHE_STATISTICS  mSectionCacheStatistics;
+
+EFI_STATUS
+EFIAPI
+SectionCacheGetStatistics (
+  IN  EDKII_SECTION_CACHE_DEBUG_PROTOCOL  *This,
+  OUT EDKII_SECTION_CACHE_STATISTICS      *Statistics
+  );
+
+EFI_STATUS
+EFIAPI
+SectionCacheFlush (
+  IN  EDKII_SECTION_CACHE_DEBUG_PROTOCOL  *This
+  );
+
+EDKII_SECTION_CACHE_DEBUG_PROTOCOL  mSectionCacheDebug = {
+  SectionCacheGetStatistics,
+  SectionCacheFlush
+};
+
 
 /**
   Entry point of the section extraction code. Initializes an instance of the
@@ -239,10 +294,295 @@ InitializeSectionExtraction (
     ASSERT_EFI_ERROR (Status);
   }
 
+  mSectionCacheStatistics.MaximumBytes = PcdGet32 (PcdDxeSectionCacheSize);
+  if (mSectionCacheStatistics.MaximumBytes != 0) {
+    Status = CoreInstallProtocolInterface (
+               &mSectionExtractionHandle,
+               &gEdkiiSectionCacheDebugProtocolGuid,
+               EFI_NATIVE_INTERFACE,
+               &mSectionCacheDebug
+               );
+    ASSERT_EFI_ERROR (Status);
+  }
+
   return Status;
 }
 
 
+/**
+  Remove an entry from the section cache and free it.
+
+  @param  Entry                  The entry to evict.
+
+**/
+VOID
+SectionCacheEvict (
+  IN SECTION_CACHE_ENTRY  *Entry
+  )
+{
+  RemoveEntryList (&Entry->Link);
+  mSectionCacheStatistics.EntryCount--;
+  mSectionCacheStatistics.CachedBytes -= Entry->DataSize;
+  mSectionCacheStatistics.EvictionCount++;
+  CoreFreePool (Entry);
+}
+
+
+/**
+  Evict the least recently used entries of the section cache, until a number of
+  bytes fits in the cache.
+
+  @param  Size                   The number of bytes to make room for, or
+                                 MAX_UINTN to evict all the entries.
+
+**/
+VOID
+SectionCacheTrim (
+  IN UINTN  Size
+  )
+{
+  EFI_TPL  OldTpl;
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  while (!IsListEmpty (&mSectionCache) &&
+         ((Size == MAX_UINTN) ||
+          (mSectionCacheStatistics.CachedBytes + Size > mSectionCacheStatistics.MaximumBytes))) {
+    SectionCacheEvict (SECTION_CACHE_ENTRY_FROM_LINK (GetPreviousNode (&mSectionCache, &mSectionCache)));
+  }
+  CoreRestoreTpl (OldTpl);
+}
+
+
+/**
+  Allocate a buffer for extracted section data. If memory runs low, the section
+  cache is evicted and the allocation is tried again.
+
+  @param  Size                   The size of the buffer.
+
+  @return The buffer, or NULL if memory is exhausted.
+
+**/
+VOID *
+AllocateSectionBuffer (
+  IN UINTN  Size
+  )
+{
+  VOID  *Buffer;
+
+  Buffer = AllocatePool (Size);
+  if ((Buffer == NULL) && !IsListEmpty (&mSectionCache)) {
+    SectionCacheTrim (MAX_UINTN);
+    Buffer = AllocatePool (Size);
+  }
+  return Buffer;
+}
+
+
+/**
+  Look up the data extracted from an encapsulation section in the section cache.
+
+  @param  Section                The encapsulation section.
+  @param  SectionSize            The size of the encapsulation section.
+  @param  SectionDefinitionGuid  The GUID of a GUIDed section, NULL for a
+                                 compression section.
+  @param  Data                   On return, a copy of the extracted data
+                                 allocated from pool.
+  @param  DataSize               On return, the size of the extracted data.
+  @param  AuthenticationStatus   On return, the authentication status returned
+                                 when the data was extracted.
+  @param  SectionCrc32           On return, the CRC32 of the section, to be
+                                 passed to SectionCacheInsert().
+
+  @retval TRUE                   The extracted data is returned.
+  @retval FALSE                  The section must be decoded.
+
+**/
+BOOLEAN
+SectionCacheLookup (
+  IN  CONST VOID      *Section,
+  IN  UINT32          SectionSize,
+  IN  CONST EFI_GUID  *SectionDefinitionGuid  OPTIONAL,
+  OUT VOID            **Data,
+  OUT UINTN           *DataSize,
+  OUT UINT32          *AuthenticationStatus,
+  OUT UINT32          *SectionCrc32
+  )
+{
+  LIST_ENTRY           *Link;
+  SECTION_CACHE_ENTRY  *Entry;
+  EFI_TPL              OldTpl;
+  BOOLEAN              Found;
+  BOOLEAN              LowMemory;
+
+  if (mSectionCacheStatistics.MaximumBytes == 0) {
+    return FALSE;
+  }
+
+  //
+  // The CRC32 of a large section takes a while, compute it before raising the TPL.
+  //
+  *SectionCrc32 = CalculateCrc32 ((VOID *) Section, SectionSize);
+
+  Found     = FALSE;
+  LowMemory = FALSE;
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  for (Link = GetFirstNode (&mSectionCache); !IsNull (&mSectionCache, Link); Link = GetNextNode (&mSectionCache, Link)) {
+    Entry = SECTION_CACHE_ENTRY_FROM_LINK (Link);
+    if ((Entry->Section != Section) || (Entry->SectionSize != SectionSize) ||
+        !CompareGuid (&Entry->SectionDefinitionGuid, (SectionDefinitionGuid == NULL) ? &gZeroGuid : SectionDefinitionGuid)) {
+      continue;
+    }
+
+    if (Entry->SectionCrc32 != *SectionCrc32) {
+      //
+      // The memory now holds another section.
+      //
+      SectionCacheEvict (Entry);
+      break;
+    }
+
+    *Data = AllocatePool (Entry->DataSize);
+    if (*Data == NULL) {
+      LowMemory = TRUE;
+      break;
+    }
+    CopyMem (*Data, Entry + 1, Entry->DataSize);
+    *DataSize             = Entry->DataSize;
+    *AuthenticationStatus = Entry->AuthenticationStatus;
+    RemoveEntryList (&Entry->Link);
+    InsertHeadList (&mSectionCache, &Entry->Link);
+    Found = TRUE;
+    break;
+  }
+
+  if (LowMemory) {
+    //
+    // Make room for the section to be decoded.
+    //
+    SectionCacheTrim (MAX_UINTN);
+  }
+
+  if (Found) {
+    mSectionCacheStatistics.HitCount++;
+  } else {
+    mSectionCacheStatistics.MissCount++;
+  }
+  CoreRestoreTpl (OldTpl);
+
+  return Found;
+}
+
+
+/**
+  Add the data extracted from an encapsulation section to the section cache.
+
+  @param  Section                The encapsulation section.
+  @param  SectionSize            The size of the encapsulation section.
+  @param  SectionDefinitionGuid  The GUID of a GUIDed section, NULL for a
+                                 compression section.
+  @param  Data                   The extracted data.
+  @param  DataSize               The size of the extracted data.
+  @param  AuthenticationStatus   The authentication status returned when the
+                                 data was extracted.
+  @param  SectionCrc32           The CRC32 of the section returned by
+                                 SectionCacheLookup().
+
+**/
+VOID
+SectionCacheInsert (
+  IN CONST VOID      *Section,
+  IN UINT32          SectionSize,
+  IN CONST EFI_GUID  *SectionDefinitionGuid  OPTIONAL,
+  IN CONST VOID      *Data,
+  IN UINTN           DataSize,
+  IN UINT32          AuthenticationStatus,
+  IN UINT32          SectionCrc32
+  )
+{
+  SECTION_CACHE_ENTRY  *Entry;
+  EFI_TPL              OldTpl;
+
+  if ((DataSize == 0) || (DataSize > mSectionCacheStatistics.MaximumBytes)) {
+    return;
+  }
+
+  SectionCacheTrim (DataSize);
+
+  //
+  // Do not evict the cache again if memory runs low, just skip the entry.
+  //
+  Entry = AllocatePool (sizeof (SECTION_CACHE_ENTRY) + DataSize);
+  if (Entry == NULL) {
+    return;
+  }
+
+  Entry->Signature    = SECTION_CACHE_ENTRY_SIGNATURE;
+  Entry->Section      = Section;
+  Entry->SectionSize  = SectionSize;
+  Entry->SectionCrc32 = SectionCrc32;
+  CopyGuid (&Entry->SectionDefinitionGuid, (SectionDefinitionGuid == NULL) ? &gZeroGuid : SectionDefinitionGuid);
+  Entry->DataSize     = DataSize;
+  Entry->AuthenticationStatus = AuthenticationStatus;
+  CopyMem (Entry + 1, Data, DataSize);
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  InsertHeadList (&mSectionCache, &Entry->Link);
+  mSectionCacheStatistics.EntryCount++;
+  mSectionCacheStatistics.CachedBytes += DataSize;
+  CoreRestoreTpl (OldTpl);
+}
+
+
+/**
+  Get the statistics of the section cache.
+
+  @param  This                   The EDKII_SECTION_CACHE_DEBUG_PROTOCOL instance.
+  @param  Statistics             The statistics of the section cache.
+
+  @retval EFI_SUCCESS            The statistics are returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+SectionCacheGetStatistics (
+  IN  EDKII_SECTION_CACHE_DEBUG_PROTOCOL  *This,
+  OUT EDKII_SECTION_CACHE_STATISTICS      *Statistics
+  )
+{
+  EFI_TPL  OldTpl;
+
+  if (Statistics == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  CopyMem (Statistics, &mSectionCacheStatistics, sizeof (*Statistics));
+  CoreRestoreTpl (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Evict all the entries of the section cache.
+
+  @param  This                   The EDKII_SECTION_CACHE_DEBUG_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            The section cache is empty.
+
+**/
+EFI_STATUS
+EFIAPI
+SectionCacheFlush (
+  IN  EDKII_SECTION_CACHE_DEBUG_PROTOCOL  *This
+  )
+{
+  SectionCacheTrim (MAX_UINTN);
+  return EFI_SUCCESS;
+}
+
+
 /**
   Check if a stream is valid.
 
@@ -685,10 +1025,13 @@ CreateChildNode (
   UINT32                                       UncompressedLength;
   UINT8                                        CompressionType;
   UINT16                                       GuidedSectionAttributes;
+  BOOLEAN                                      CacheSection;
+  UINT32                                       SectionCrc32;
 
   CORE_SECTION_CHILD_NODE                      *Node;
 
   SectionHeader = (EFI_COMMON_SECTION_HEADER *) (Stream->StreamBuffer + ChildOffset);
+  SectionCrc32  = 0;
 
   //
   // Allocate a new node
@@ -743,9 +1086,14 @@ CreateChildNode (
       //
       // Allocate space for the new stream
       //
-      if (UncompressedLength > 0) {
+      if ((UncompressedLength > 0) && (CompressionType == EFI_STANDARD_COMPRESSION) &&
+          SectionCacheLookup (SectionHeader, Node->Size, NULL, &NewStreamBuffer, &NewStreamBufferSize, &AuthenticationStatus, &SectionCrc32)) {
+        //
+        // The stream was decompressed before.
+        //
+      } else if (UncompressedLength > 0) {
         NewStreamBufferSize = UncompressedLength;
-        NewStreamBuffer = AllocatePool (NewStreamBufferSize);
+        NewStreamBuffer = AllocateSectionBuffer (NewStreamBufferSize);
         if (NewStreamBuffer == NULL) {
           CoreFreePool (Node);
           return EFI_OUT_OF_RESOURCES;
@@ -784,7 +1132,7 @@ CreateChildNode (
             return Status;
           }
 
-          ScratchBuffer = AllocatePool (ScratchSize);
+          ScratchBuffer = AllocateSectionBuffer (ScratchSize);
           if (ScratchBuffer == NULL) {
             CoreFreePool (Node);
             CoreFreePool (NewStreamBuffer);
@@ -806,6 +1154,8 @@ CreateChildNode (
             CoreFreePool (NewStreamBuffer);
             return Status;
           }
+
+          SectionCacheInsert (SectionHeader, Node->Size, NULL, NewStreamBuffer, NewStreamBufferSize, 0, SectionCrc32);
         }
       } else {
         NewStreamBuffer = NULL;
@@ -837,19 +1187,44 @@ CreateChildNode (
       }
       if (VerifyGuidedSectionGuid (Node->EncapsulationGuid, &GuidedExtraction)) {
         //
-        // NewStreamBuffer is always allocated by ExtractSection... No caller
-        // allocation here.
+        // Sections that contribute authentication status are always extracted
+        // again, so that they are always authenticated again.
         //
-        Status = GuidedExtraction->ExtractSection (
-                                     GuidedExtraction,
-                                     GuidedHeader,
-                                     &NewStreamBuffer,
-                                     &NewStreamBufferSize,
-                                     &AuthenticationStatus
-                                     );
-        if (EFI_ERROR (Status)) {
-          CoreFreePool (*ChildNode);
-          return EFI_PROTOCOL_ERROR;
+        CacheSection = (BOOLEAN) ((GuidedSectionAttributes & EFI_GUIDED_SECTION_AUTH_STATUS_VALID) == 0);
+        if (!CacheSection ||
+            !SectionCacheLookup (SectionHeader, Node->Size, Node->EncapsulationGuid, &NewStreamBuffer, &NewStreamBufferSize, &AuthenticationStatus, &SectionCrc32)) {
+          //
+          // NewStreamBuffer is always allocated by ExtractSection... No caller
+          // allocation here.
+          //
+          Status = GuidedExtraction->ExtractSection (
+                                       GuidedExtraction,
+                                       GuidedHeader,
+                                       &NewStreamBuffer,
+                                       &NewStreamBufferSize,
+                                       &AuthenticationStatus
+                                       );
+          if ((Status == EFI_OUT_OF_RESOURCES) && !IsListEmpty (&mSectionCache)) {
+            //
+            // Memory ran low, try again with an empty cache.
+            //
+            SectionCacheTrim (MAX_UINTN);
+            Status = GuidedExtraction->ExtractSection (
+                                         GuidedExtraction,
+                                         GuidedHeader,
+                                         &NewStreamBuffer,
+                                         &NewStreamBufferSize,
+                                         &AuthenticationStatus
+                                         );
+          }
+          if (EFI_ERROR (Status)) {
+            CoreFreePool (*ChildNode);
+            return EFI_PROTOCOL_ERROR;
+          }
+
+          if (CacheSection) {
+            SectionCacheInsert (SectionHeader, Node->Size, Node->EncapsulationGuid, NewStreamBuffer, NewStreamBufferSize, AuthenticationStatus, SectionCrc32);
+          }
         }
 
         //
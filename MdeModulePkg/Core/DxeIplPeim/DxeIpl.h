@@ -27,6 +27,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/MemoryTypeInformation.h>
 #include <Guid/MemoryAllocationHob.h>
 #include <Guid/FirmwareFileSystem2.h>
+#include <Guid/HobIndex.h>
 
 #include <Library/DebugLib.h>
 #include <Library/PeimEntryPoint.h>
@@ -105,6 +106,18 @@ DxeLoadCore (
 
 
 
+/**
+   Builds the index of the GUID extension HOBs in the HOB list handed to
+   DxeCore, and a GUID extension HOB that points to it.
+
+   @param HobList       The start of HobList passed to DxeCore.
+
+**/
+VOID
+BuildHobIndex (
+  IN EFI_PEI_HOB_POINTERS   HobList
+  );
+
 /**
    Transfers control to DxeCore.
 
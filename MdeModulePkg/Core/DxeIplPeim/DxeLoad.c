@@ -229,6 +229,113 @@ ValidateMemoryTypeInfoVariable (
   return TRUE;
 }
 
+/**
+   Builds the index of the GUID extension HOBs in the HOB list handed to
+   DxeCore, and a GUID extension HOB that points to it.
+
+   HOBs built after this function, such as the ones built by
+   HandOffToDxeCore(), are not covered by the index. HobLib instances scan
+   them linearly.
+
+   @param HobList       The start of HobList passed to DxeCore.
+
+**/
+VOID
+BuildHobIndex (
+  IN EFI_PEI_HOB_POINTERS   HobList
+  )
+{
+  EFI_PEI_HOB_POINTERS      Hob;
+  HOB_INDEX_HEADER          *HobIndex;
+  EFI_PHYSICAL_ADDRESS      HobIndexAddress;
+  UINT32                    *BucketStart;
+  UINT32                    *HobOffset;
+  UINT32                    EntryCount;
+  UINT32                    BucketCount;
+  UINT32                    Bucket;
+  UINT32                    Start;
+  UINT32                    Count;
+  UINTN                     Size;
+
+  //
+  // Count the GUID HOBs, including the one pointing to the index.
+  //
+  EntryCount = 1;
+  for (Hob = HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      EntryCount++;
+    }
+  }
+
+  //
+  // Keep the average bucket length at or below one.
+  //
+  BucketCount = 16;
+  while (BucketCount < EntryCount) {
+    BucketCount <<= 1;
+  }
+
+  Size = sizeof (HOB_INDEX_HEADER) + sizeof (UINT32) * (BucketCount + 1 + EntryCount);
+  HobIndex = AllocatePages (EFI_SIZE_TO_PAGES (Size));
+  if (HobIndex == NULL) {
+    DEBUG ((DEBUG_WARN, "DxeIpl: no memory for HOB index, HobLib falls back to HOB list walks\n"));
+    return;
+  }
+  ZeroMem (HobIndex, Size);
+
+  HobIndexAddress = (EFI_PHYSICAL_ADDRESS) (UINTN) HobIndex;
+  BuildGuidDataHob (&gEdkiiHobIndexGuid, &HobIndexAddress, sizeof (HobIndexAddress));
+
+  HobIndex->Signature   = HOB_INDEX_SIGNATURE;
+  HobIndex->Revision    = HOB_INDEX_REVISION;
+  HobIndex->HobList     = (EFI_PHYSICAL_ADDRESS) (UINTN) HobList.Raw;
+  HobIndex->BucketCount = BucketCount;
+  HobIndex->EntryCount  = EntryCount;
+  BucketStart = HOB_INDEX_BUCKET_START (HobIndex);
+  HobOffset   = HOB_INDEX_HOB_OFFSET (HobIndex);
+
+  //
+  // Count the HOBs per bucket, and turn the counts into bucket start
+  // positions.
+  //
+  for (Hob = HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      BucketStart[HOB_INDEX_BUCKET (&Hob.Guid->Name, BucketCount)]++;
+    }
+  }
+  Start = 0;
+  for (Bucket = 0; Bucket < BucketCount; Bucket++) {
+    Count = BucketStart[Bucket];
+    BucketStart[Bucket] = Start;
+    Start += Count;
+  }
+  ASSERT (Start == EntryCount);
+
+  //
+  // Place the HOBs in list order. BucketStart[N] is used as the fill cursor
+  // of bucket N and ends up at the start of bucket N + 1, so shift the array
+  // by one afterwards.
+  //
+  for (Hob = HobList; !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      Bucket = HOB_INDEX_BUCKET (&Hob.Guid->Name, BucketCount);
+      HobOffset[BucketStart[Bucket]++] = (UINT32) (Hob.Raw - HobList.Raw);
+    }
+  }
+  CopyMem (&BucketStart[1], &BucketStart[0], sizeof (UINT32) * BucketCount);
+  BucketStart[0] = 0;
+
+  HobIndex->IndexedLength = (UINT64) (Hob.Raw - HobList.Raw);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "DxeIpl: indexed %d GUID HOBs in %d buckets at 0x%p\n",
+    EntryCount,
+    BucketCount,
+    HobIndex
+    ));
+}
+
 /**
    Main entry point to last PEIM.
 
@@ -442,6 +549,13 @@ DxeLoadCore (
 
   DEBUG ((DEBUG_INFO | DEBUG_LOAD, "Loading DXE CORE at 0x%11p EntryPoint=0x%11p\n", (VOID *)(UINTN)DxeCoreAddress, FUNCTION_ENTRY_POINT (DxeCoreEntryPoint)));
 
+  //
+  // The HOB list is complete, index the GUID HOBs for the DXE phase.
+  //
+  if (FeaturePcdGet (PcdDxeIplBuildHobIndex)) {
+    BuildHobIndex (HobList);
+  }
+
   //
   // Transfer control to the DXE Core
   // The hand off state is simply a pointer to the HOB list
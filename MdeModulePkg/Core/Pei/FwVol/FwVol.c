@@ -262,7 +262,7 @@ FileHandleToVolume (
 
 **/
 EFI_STATUS
-FindFileEx (
+FindFileExByScan (
   IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
   IN  CONST EFI_GUID                 *FileName,   OPTIONAL
   IN        EFI_FV_FILETYPE          SearchType,
@@ -411,6 +411,9 @@ FindFileEx (
             }
           }
         }
+      } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE) {
+        *FileHeader = FfsFileHeader;
+        return EFI_SUCCESS;
       } else if (((SearchType == FfsFileHeader->Type) || (SearchType == EFI_FV_FILETYPE_ALL)) &&
                  (FfsFileHeader->Type != EFI_FV_FILETYPE_FFS_PAD)) {
         *FileHeader = FfsFileHeader;
@@ -446,6 +449,245 @@ FindFileEx (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Build the file index of a firmware volume known to PeiCore.
+
+  The FV is walked once, so every file header and checksum is read once.
+  Pad files are indexed too: type searches never return them, but a search
+  by name does, and the index must answer it like the scan. If the pool for
+  the index cannot be allocated, FileIndexBuilt stays FALSE and searches keep
+  scanning the FV.
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the FV.
+
+**/
+VOID
+BuildFvFileIndex (
+  IN OUT PEI_CORE_FV_HANDLE          *CoreFvHandle
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_FFS_FILE_HEADER           *FfsFileHeader;
+  PEI_CORE_FV_FILE_INDEX_ENTRY  *FileIndex;
+  PEI_CORE_FV_FILE_INDEX_ENTRY  *NewFileIndex;
+  UINTN                         FileIndexSize;
+  UINTN                         FileCount;
+
+  FileIndexSize = PEI_CORE_FV_FILE_INDEX_INITIAL_SIZE;
+  FileIndex     = AllocatePool (sizeof (PEI_CORE_FV_FILE_INDEX_ENTRY) * FileIndexSize);
+  if (FileIndex == NULL) {
+    return;
+  }
+
+  FileCount     = 0;
+  FfsFileHeader = NULL;
+  while (TRUE) {
+    Status = FindFileExByScan (CoreFvHandle->FvHandle, NULL, PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE, (EFI_PEI_FILE_HANDLE *) &FfsFileHeader, NULL);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    if (FileCount == FileIndexSize) {
+      //
+      // Run out of room, double the index. PEI pool is never freed, so the
+      // old buffers cost at most the size of the final index.
+      //
+      NewFileIndex = AllocatePool (sizeof (PEI_CORE_FV_FILE_INDEX_ENTRY) * FileIndexSize * 2);
+      if (NewFileIndex == NULL) {
+        return;
+      }
+      CopyMem (NewFileIndex, FileIndex, sizeof (PEI_CORE_FV_FILE_INDEX_ENTRY) * FileCount);
+      FreePool (FileIndex);
+      FileIndex     = NewFileIndex;
+      FileIndexSize = FileIndexSize * 2;
+    }
+
+    CopyGuid (&FileIndex[FileCount].Name, &FfsFileHeader->Name);
+    FileIndex[FileCount].Offset = (UINT32) ((UINTN) FfsFileHeader - (UINTN) CoreFvHandle->FvHandle);
+    FileIndex[FileCount].Type   = FfsFileHeader->Type;
+    FileCount++;
+  }
+
+  CoreFvHandle->FileIndex      = FileIndex;
+  CoreFvHandle->FileIndexCount = FileCount;
+  CoreFvHandle->FileIndexBuilt = TRUE;
+  DEBUG ((DEBUG_VERBOSE, "Indexed %Lu files in FV at 0x%p\n", (UINT64) FileCount, CoreFvHandle->FvHandle));
+}
+
+/**
+  Search the file index of a firmware volume with the same semantics as
+  FindFileExByScan().
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the FV.
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @retval EFI_SUCCESS      Success to search given file
+  @retval EFI_NOT_FOUND    No files matching the search criteria were found
+  @retval EFI_UNSUPPORTED  The file to start from is not in the index.
+
+**/
+EFI_STATUS
+FindFileInFvFileIndex (
+  IN OUT    PEI_CORE_FV_HANDLE       *CoreFvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle,
+  IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
+  )
+{
+  PEI_CORE_FV_FILE_INDEX_ENTRY  *Entry;
+  UINTN                         Index;
+  UINTN                         Low;
+  UINTN                         High;
+  UINTN                         Middle;
+  UINT32                        Offset;
+
+  //
+  // If FileHandle is not specified (NULL) or FileName is not NULL,
+  // start with the first file in the firmware volume.  Otherwise,
+  // start from the entry after FileHandle.
+  //
+  if ((*FileHandle == NULL) || (FileName != NULL)) {
+    Index = 0;
+  } else {
+    Offset = (UINT32) ((UINTN) *FileHandle - (UINTN) CoreFvHandle->FvHandle);
+    Low    = 0;
+    High   = CoreFvHandle->FileIndexCount;
+    while (Low < High) {
+      Middle = (Low + High) / 2;
+      if (CoreFvHandle->FileIndex[Middle].Offset < Offset) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+    if ((Low == CoreFvHandle->FileIndexCount) || (CoreFvHandle->FileIndex[Low].Offset != Offset)) {
+      return EFI_UNSUPPORTED;
+    }
+    Index = Low + 1;
+  }
+
+  CoreFvHandle->FileIndexLookupCount++;
+  for (; Index < CoreFvHandle->FileIndexCount; Index++) {
+    Entry = &CoreFvHandle->FileIndex[Index];
+    CoreFvHandle->FileIndexHeaderReadsSaved++;
+
+    if (FileName != NULL) {
+      if (CompareGuid (&Entry->Name, FileName)) {
+        *FileHandle = (EFI_PEI_FILE_HANDLE) ((UINT8 *) CoreFvHandle->FvHandle + Entry->Offset);
+        return EFI_SUCCESS;
+      }
+    } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) {
+      if ((Entry->Type == EFI_FV_FILETYPE_PEIM) ||
+          (Entry->Type == EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) ||
+          (Entry->Type == EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE)) {
+        *FileHandle = (EFI_PEI_FILE_HANDLE) ((UINT8 *) CoreFvHandle->FvHandle + Entry->Offset);
+        return EFI_SUCCESS;
+      } else if (AprioriFile != NULL) {
+        if ((Entry->Type == EFI_FV_FILETYPE_FREEFORM) && CompareGuid (&Entry->Name, &gPeiAprioriFileNameGuid)) {
+          *AprioriFile = (EFI_PEI_FILE_HANDLE) ((UINT8 *) CoreFvHandle->FvHandle + Entry->Offset);
+        }
+      }
+    } else if (((SearchType == Entry->Type) || (SearchType == EFI_FV_FILETYPE_ALL)) &&
+               (Entry->Type != EFI_FV_FILETYPE_FFS_PAD)) {
+      *FileHandle = (EFI_PEI_FILE_HANDLE) ((UINT8 *) CoreFvHandle->FvHandle + Entry->Offset);
+      return EFI_SUCCESS;
+    }
+  }
+
+  *FileHandle = NULL;
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Given the input file pointer, search for the first matching file in the
+  FFS volume as defined by SearchType. The search starts from FileHeader inside
+  the Firmware Volume defined by FwVolHeader.
+  If SearchType is EFI_FV_FILETYPE_ALL, the first FFS file will return without check its file type.
+  If SearchType is PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE,
+  the first PEIM, or COMBINED PEIM or FV file type FFS file will return.
+
+  Volumes known to PeiCore are searched through their file index, which is
+  built on first use. Other volumes are scanned.
+
+  @param FvHandle        Pointer to the FV header of the volume to search
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @return EFI_NOT_FOUND  No files matching the search criteria were found
+  @retval EFI_SUCCESS    Success to search given file
+
+**/
+EFI_STATUS
+FindFileEx (
+  IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle,
+  IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
+  )
+{
+  EFI_STATUS                  Status;
+  PEI_CORE_FV_HANDLE          *CoreFvHandle;
+
+  CoreFvHandle = FvHandleToCoreHandle (FvHandle);
+  if (CoreFvHandle != NULL) {
+    if (!CoreFvHandle->FileIndexBuilt) {
+      BuildFvFileIndex (CoreFvHandle);
+    }
+    if (CoreFvHandle->FileIndexBuilt) {
+      Status = FindFileInFvFileIndex (CoreFvHandle, FileName, SearchType, FileHandle, AprioriFile);
+      if (Status != EFI_UNSUPPORTED) {
+        return Status;
+      }
+    }
+  }
+
+  return FindFileExByScan (FvHandle, FileName, SearchType, FileHandle, AprioriFile);
+}
+
+/**
+  Dumps the per-FV file index counters to debug output.
+
+  @param PrivateData     Pointer to PEI_CORE_INSTANCE.
+
+**/
+VOID
+DumpFvFileIndexStatistics (
+  IN  PEI_CORE_INSTANCE           *PrivateData
+  )
+{
+  UINTN                 Index;
+  PEI_CORE_FV_HANDLE    *CoreFvHandle;
+  BOOLEAN               InMemory;
+
+  for (Index = 0; Index < PrivateData->FvCount; Index++) {
+    CoreFvHandle = &PrivateData->Fv[Index];
+    if (!CoreFvHandle->FileIndexBuilt) {
+      continue;
+    }
+    InMemory = (BOOLEAN) (((EFI_PHYSICAL_ADDRESS) (UINTN) CoreFvHandle->FvHeader >= PrivateData->PhysicalMemoryBegin) &&
+                          ((EFI_PHYSICAL_ADDRESS) (UINTN) CoreFvHandle->FvHeader < PrivateData->PhysicalMemoryBegin + PrivateData->PhysicalMemoryLength));
+    DEBUG ((
+      DEBUG_INFO,
+      "FV[%Lu] at 0x%p (%a): %Lu files indexed, %u searches, %u FFS header reads saved\n",
+      (UINT64) Index,
+      CoreFvHandle->FvHeader,
+      InMemory ? "memory" : "XIP",
+      (UINT64) CoreFvHandle->FileIndexCount,
+      CoreFvHandle->FileIndexLookupCount,
+      CoreFvHandle->FileIndexHeaderReadsSaved
+      ));
+  }
+}
+
 /**
   Initialize PeiCore FV List.
 
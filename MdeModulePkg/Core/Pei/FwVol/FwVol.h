@@ -282,6 +282,31 @@ FvHandleToCoreHandle (
   the Firmware Volume defined by FwVolHeader.
 
 
+  @param FvHandle        Pointer to the FV header of the volume to search
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @return EFI_NOT_FOUND  No files matching the search criteria were found
+  @retval EFI_SUCCESS    Success to search given file
+
+**/
+EFI_STATUS
+FindFileExByScan (
+  IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle,
+  IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
+  );
+
+/**
+  Given the input file pointer, search for the next matching file in the
+  FFS volume as defined by SearchType. Volumes known to PeiCore are searched
+  through their file index instead of walking the FFS headers.
+
   @param FvHandle        Pointer to the FV header of the volume to search
   @param FileName        File name
   @param SearchType      Filter to find only files of this type.
@@ -52,6 +52,18 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 ///
 #define PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE   0xff
 
+///
+/// It is an FFS type extension used for FindFileExByScan. It returns every
+/// valid file, including pad files, so the FV file index can be built.
+///
+#define PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE      0xfe
+
+///
+/// Initial number of entries in a FV file index. The index doubles from here
+/// when an FV holds more files.
+///
+#define PEI_CORE_FV_FILE_INDEX_INITIAL_SIZE        32
+
 ///
 /// Pei Core private data structures
 ///
@@ -68,6 +80,29 @@ typedef union {
 #define CALLBACK_NOTIFY_GROWTH_STEP 32
 #define DISPATCH_NOTIFY_GROWTH_STEP 8
 
+///
+/// Number of GUID hash buckets in each PPI database index. Must be a power of two.
+///
+#define PPI_INDEX_BUCKET_COUNT      32
+
+///
+/// GUID hash index over one PPI or Notify list.
+///
+/// Each bucket chains the list entries whose GUID hashes to it, in ascending
+/// list order, so an index walk visits entries in the same order as a linear
+/// scan of the list. Chains hold 1-based list indices (0 terminates a chain)
+/// instead of pointers, so the index stays valid when the descriptors are
+/// migrated from temporary RAM to permanent memory.
+///
+typedef struct {
+  UINT16                Head[PPI_INDEX_BUCKET_COUNT];
+  UINT16                Tail[PPI_INDEX_BUCKET_COUNT];
+  ///
+  /// MaxCount number of entries, parallel to the list pointers.
+  ///
+  UINT16                *Next;
+} PEI_PPI_INDEX;
+
 typedef struct {
   UINTN                 CurrentCount;
   UINTN                 MaxCount;
@@ -97,6 +132,29 @@ typedef struct {
   PEI_PPI_LIST_POINTERS *NotifyPtrs;
 } PEI_DISPATCH_NOTIFY_LIST;
 
+///
+/// Boot counters for the PPI database lookups.
+///
+typedef struct {
+  ///
+  /// Number of LocatePpi calls.
+  ///
+  UINT32                LocateCount;
+  ///
+  /// Number of LocatePpi calls that returned EFI_NOT_FOUND.
+  ///
+  UINT32                LocateNotFoundCount;
+  ///
+  /// Number of GUID comparisons done by LocatePpi and notify processing.
+  ///
+  UINT32                GuidCompareCount;
+  ///
+  /// Number of GUID comparisons a linear scan of the lists would have done
+  /// for the same lookups.
+  ///
+  UINT32                LinearCompareCount;
+} PEI_PPI_DATABASE_STATISTICS;
+
 ///
 /// PPI database structure which contains three links:
 /// PpiList, CallbackNotifyList and DispatchNotifyList.
@@ -116,6 +174,16 @@ typedef struct {
   PEI_DISPATCH_NOTIFY_LIST  DispatchNotifyList;
 } PEI_PPI_DATABASE;
 
+///
+/// GUID hash indexes over the three lists of the PPI database.
+///
+typedef struct {
+  PEI_PPI_INDEX               PpiList;
+  PEI_PPI_INDEX               CallbackNotifyList;
+  PEI_PPI_INDEX               DispatchNotifyList;
+  PEI_PPI_DATABASE_STATISTICS Statistics;
+} PEI_PPI_DATABASE_INDEX;
+
 //
 // PEI_CORE_FV_HANDLE.PeimState
 // Do not change these values as there is code doing math to change states.
@@ -131,6 +199,16 @@ typedef struct {
 //
 #define FV_GROWTH_STEP 8
 
+///
+/// Entry of the per-FV file index. Offset is relative to the FV header so the
+/// index stays valid when the FV is migrated to permanent memory.
+///
+typedef struct {
+  EFI_GUID                            Name;
+  UINT32                              Offset;
+  EFI_FV_FILETYPE                     Type;
+} PEI_CORE_FV_FILE_INDEX_ENTRY;
+
 typedef struct {
   EFI_FIRMWARE_VOLUME_HEADER          *FvHeader;
   EFI_PEI_FIRMWARE_VOLUME_PPI         *FvPpi;
@@ -146,6 +224,19 @@ typedef struct {
   EFI_PEI_FILE_HANDLE                 *FvFileHandles;
   BOOLEAN                             ScanFv;
   UINT32                              AuthenticationStatus;
+  //
+  // Pointer to the buffer with the FileIndexCount number of entries, in FV
+  // order. It is built by the first file search in the FV.
+  //
+  PEI_CORE_FV_FILE_INDEX_ENTRY        *FileIndex;
+  UINTN                               FileIndexCount;
+  BOOLEAN                             FileIndexBuilt;
+  //
+  // Number of file searches served by FileIndex and the number of FFS
+  // header reads they did not have to do.
+  //
+  UINT32                              FileIndexLookupCount;
+  UINT32                              FileIndexHeaderReadsSaved;
 } PEI_CORE_FV_HANDLE;
 
 typedef struct {
@@ -308,6 +399,12 @@ struct _PEI_CORE_INSTANCE {
   // Those Memory Range will be migrated into physical memory.
   //
   HOLE_MEMORY_DATA                  HoleData[HOLE_MAX_NUMBER];
+
+  //
+  // GUID hash indexes over PpiData. They are kept out of PpiData so the
+  // offset between Ps and LoadModuleAtFixAddressTopAddress does not change.
+  //
+  PEI_PPI_DATABASE_INDEX            PpiIndex;
 };
 
 ///
@@ -557,6 +654,18 @@ DumpPpiList (
   IN PEI_CORE_INSTANCE    *PrivateData
   );
 
+/**
+
+  Dumps the PPI database lookup counters to debug output.
+
+  @param PrivateData     Points to PeiCore's private instance data.
+
+**/
+VOID
+DumpPpiStatistics (
+  IN PEI_CORE_INSTANCE    *PrivateData
+  );
+
 /**
 
   Install PPI services. It is implementation of EFI_PEI_SERVICE.InstallPpi.
@@ -1262,6 +1371,17 @@ PeiInitializeFv (
   IN CONST EFI_SEC_PEI_HAND_OFF   *SecCoreData
   );
 
+/**
+  Dumps the per-FV file index counters to debug output.
+
+  @param PrivateData     Pointer to PEI_CORE_INSTANCE.
+
+**/
+VOID
+DumpFvFileIndexStatistics (
+  IN  PEI_CORE_INSTANCE           *PrivateData
+  );
+
 /**
   Process Firmware Volume Information once FvInfoPPI install.
 
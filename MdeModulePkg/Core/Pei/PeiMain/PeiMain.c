@@ -214,12 +214,21 @@ PeiCore (
         if (OldCoreData->PpiData.PpiList.PpiPtrs != NULL) {
           OldCoreData->PpiData.PpiList.PpiPtrs = (PEI_PPI_LIST_POINTERS *) ((UINT8 *) OldCoreData->PpiData.PpiList.PpiPtrs + OldCoreData->HeapOffset);
         }
+        if (OldCoreData->PpiIndex.PpiList.Next != NULL) {
+          OldCoreData->PpiIndex.PpiList.Next = (UINT16 *) ((UINT8 *) OldCoreData->PpiIndex.PpiList.Next + OldCoreData->HeapOffset);
+        }
         if (OldCoreData->PpiData.CallbackNotifyList.NotifyPtrs != NULL) {
           OldCoreData->PpiData.CallbackNotifyList.NotifyPtrs = (PEI_PPI_LIST_POINTERS *) ((UINT8 *) OldCoreData->PpiData.CallbackNotifyList.NotifyPtrs + OldCoreData->HeapOffset);
         }
+        if (OldCoreData->PpiIndex.CallbackNotifyList.Next != NULL) {
+          OldCoreData->PpiIndex.CallbackNotifyList.Next = (UINT16 *) ((UINT8 *) OldCoreData->PpiIndex.CallbackNotifyList.Next + OldCoreData->HeapOffset);
+        }
         if (OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs != NULL) {
           OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs = (PEI_PPI_LIST_POINTERS *) ((UINT8 *) OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs + OldCoreData->HeapOffset);
         }
+        if (OldCoreData->PpiIndex.DispatchNotifyList.Next != NULL) {
+          OldCoreData->PpiIndex.DispatchNotifyList.Next = (UINT16 *) ((UINT8 *) OldCoreData->PpiIndex.DispatchNotifyList.Next + OldCoreData->HeapOffset);
+        }
         OldCoreData->Fv                   = (PEI_CORE_FV_HANDLE *) ((UINT8 *) OldCoreData->Fv + OldCoreData->HeapOffset);
         for (Index = 0; Index < OldCoreData->FvCount; Index ++) {
           if (OldCoreData->Fv[Index].PeimState != NULL) {
@@ -228,6 +237,9 @@ PeiCore (
           if (OldCoreData->Fv[Index].FvFileHandles != NULL) {
             OldCoreData->Fv[Index].FvFileHandles = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->Fv[Index].FvFileHandles + OldCoreData->HeapOffset);
           }
+          if (OldCoreData->Fv[Index].FileIndex != NULL) {
+            OldCoreData->Fv[Index].FileIndex = (PEI_CORE_FV_FILE_INDEX_ENTRY *) ((UINT8 *) OldCoreData->Fv[Index].FileIndex + OldCoreData->HeapOffset);
+          }
         }
         OldCoreData->TempFileGuid         = (EFI_GUID *) ((UINT8 *) OldCoreData->TempFileGuid + OldCoreData->HeapOffset);
         OldCoreData->TempFileHandles      = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->TempFileHandles + OldCoreData->HeapOffset);
@@ -242,12 +254,21 @@ PeiCore (
         if (OldCoreData->PpiData.PpiList.PpiPtrs != NULL) {
           OldCoreData->PpiData.PpiList.PpiPtrs = (PEI_PPI_LIST_POINTERS *) ((UINT8 *) OldCoreData->PpiData.PpiList.PpiPtrs - OldCoreData->HeapOffset);
         }
+        if (OldCoreData->PpiIndex.PpiList.Next != NULL) {
+          OldCoreData->PpiIndex.PpiList.Next = (UINT16 *) ((UINT8 *) OldCoreData->PpiIndex.PpiList.Next - OldCoreData->HeapOffset);
+        }
         if (OldCoreData->PpiData.CallbackNotifyList.NotifyPtrs != NULL) {
           OldCoreData->PpiData.CallbackNotifyList.NotifyPtrs = (PEI_PPI_LIST_POINTERS *) ((UINT8 *) OldCoreData->PpiData.CallbackNotifyList.NotifyPtrs - OldCoreData->HeapOffset);
         }
+        if (OldCoreData->PpiIndex.CallbackNotifyList.Next != NULL) {
+          OldCoreData->PpiIndex.CallbackNotifyList.Next = (UINT16 *) ((UINT8 *) OldCoreData->PpiIndex.CallbackNotifyList.Next - OldCoreData->HeapOffset);
+        }
         if (OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs != NULL) {
           OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs = (PEI_PPI_LIST_POINTERS *) ((UINT8 *) OldCoreData->PpiData.DispatchNotifyList.NotifyPtrs - OldCoreData->HeapOffset);
         }
+        if (OldCoreData->PpiIndex.DispatchNotifyList.Next != NULL) {
+          OldCoreData->PpiIndex.DispatchNotifyList.Next = (UINT16 *) ((UINT8 *) OldCoreData->PpiIndex.DispatchNotifyList.Next - OldCoreData->HeapOffset);
+        }
         OldCoreData->Fv                   = (PEI_CORE_FV_HANDLE *) ((UINT8 *) OldCoreData->Fv - OldCoreData->HeapOffset);
         for (Index = 0; Index < OldCoreData->FvCount; Index ++) {
           if (OldCoreData->Fv[Index].PeimState != NULL) {
@@ -256,6 +277,9 @@ PeiCore (
           if (OldCoreData->Fv[Index].FvFileHandles != NULL) {
             OldCoreData->Fv[Index].FvFileHandles = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->Fv[Index].FvFileHandles - OldCoreData->HeapOffset);
           }
+          if (OldCoreData->Fv[Index].FileIndex != NULL) {
+            OldCoreData->Fv[Index].FileIndex = (PEI_CORE_FV_FILE_INDEX_ENTRY *) ((UINT8 *) OldCoreData->Fv[Index].FileIndex - OldCoreData->HeapOffset);
+          }
         }
         OldCoreData->TempFileGuid         = (EFI_GUID *) ((UINT8 *) OldCoreData->TempFileGuid - OldCoreData->HeapOffset);
         OldCoreData->TempFileHandles      = (EFI_PEI_FILE_HANDLE *) ((UINT8 *) OldCoreData->TempFileHandles - OldCoreData->HeapOffset);
@@ -483,6 +507,9 @@ PeiCore (
   //
   PERF_INMODULE_END ("PostMem");
 
+  DumpPpiStatistics (&PrivateData);
+  DumpFvFileIndexStatistics (&PrivateData);
+
   //
   // Lookup DXE IPL PPI
   //
@@ -419,6 +419,146 @@ DumpPpiList (
   DEBUG_CODE_END ();
 }
 
+/**
+
+  Dumps the PPI database lookup counters to debug output.
+
+  @param PrivateData     Points to PeiCore's private instance data.
+
+**/
+VOID
+DumpPpiStatistics (
+  IN PEI_CORE_INSTANCE    *PrivateData
+  )
+{
+  DEBUG ((
+    DEBUG_INFO,
+    "PPI database: %Lu PPIs, %Lu callback notifies, %Lu dispatch notifies\n",
+    (UINT64) PrivateData->PpiData.PpiList.CurrentCount,
+    (UINT64) PrivateData->PpiData.CallbackNotifyList.CurrentCount,
+    (UINT64) PrivateData->PpiData.DispatchNotifyList.CurrentCount
+    ));
+  DEBUG ((
+    DEBUG_INFO,
+    "PPI database: %u LocatePpi calls (%u not found), %u GUID compares (%u for linear scan)\n",
+    PrivateData->PpiIndex.Statistics.LocateCount,
+    PrivateData->PpiIndex.Statistics.LocateNotFoundCount,
+    PrivateData->PpiIndex.Statistics.GuidCompareCount,
+    PrivateData->PpiIndex.Statistics.LinearCompareCount
+    ));
+}
+
+/**
+
+  Compute the PPI index bucket of a GUID.
+
+  @param Guid            Pointer to the GUID.
+
+  @return Bucket number in the range 0 .. PPI_INDEX_BUCKET_COUNT - 1.
+
+**/
+UINTN
+PpiIndexBucket (
+  IN CONST EFI_GUID      *Guid
+  )
+{
+  UINT32                Hash;
+
+  Hash  = ((UINT32 *)Guid)[0] ^ ((UINT32 *)Guid)[1] ^ ((UINT32 *)Guid)[2] ^ ((UINT32 *)Guid)[3];
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+  return (UINTN) (Hash & (PPI_INDEX_BUCKET_COUNT - 1));
+}
+
+/**
+
+  Grow the chain buffer of a PPI index together with the list it indexes.
+
+  @param PpiIndex        Pointer to the PPI index.
+  @param OldMaxCount     Number of entries in the current chain buffer.
+  @param NewMaxCount     Number of entries in the new chain buffer.
+
+**/
+VOID
+PpiIndexGrow (
+  IN OUT PEI_PPI_INDEX   *PpiIndex,
+  IN UINTN               OldMaxCount,
+  IN UINTN               NewMaxCount
+  )
+{
+  UINT16                *TempPtr;
+
+  //
+  // Chains hold 1-based UINT16 list indices.
+  //
+  ASSERT (NewMaxCount < MAX_UINT16);
+
+  TempPtr = AllocateZeroPool (sizeof (UINT16) * NewMaxCount);
+  ASSERT (TempPtr != NULL);
+  if (OldMaxCount != 0) {
+    CopyMem (TempPtr, PpiIndex->Next, sizeof (UINT16) * OldMaxCount);
+  }
+  PpiIndex->Next = TempPtr;
+}
+
+/**
+
+  Append one list entry to the tail of its GUID hash chain.
+
+  @param PpiIndex        Pointer to the PPI index.
+  @param ListPtrs        The PPI or Notify list indexed by PpiIndex.
+  @param ListIndex       Index of the entry to add. It must be larger than
+                         the index of any entry already in PpiIndex.
+
+**/
+VOID
+PpiIndexAdd (
+  IN OUT PEI_PPI_INDEX          *PpiIndex,
+  IN     PEI_PPI_LIST_POINTERS  *ListPtrs,
+  IN     UINTN                  ListIndex
+  )
+{
+  UINTN                 Bucket;
+
+  //
+  // PPI and Notify descriptors keep the GUID pointer at the same offset.
+  //
+  Bucket = PpiIndexBucket (ListPtrs[ListIndex].Ppi->Guid);
+
+  PpiIndex->Next[ListIndex] = 0;
+  if (PpiIndex->Tail[Bucket] == 0) {
+    PpiIndex->Head[Bucket] = (UINT16) (ListIndex + 1);
+  } else {
+    PpiIndex->Next[PpiIndex->Tail[Bucket] - 1] = (UINT16) (ListIndex + 1);
+  }
+  PpiIndex->Tail[Bucket] = (UINT16) (ListIndex + 1);
+}
+
+/**
+
+  Rebuild a PPI index from the entries of the list it indexes.
+
+  @param PpiIndex        Pointer to the PPI index.
+  @param ListPtrs        The PPI or Notify list indexed by PpiIndex.
+  @param Count           Number of valid entries in ListPtrs.
+
+**/
+VOID
+PpiIndexRebuild (
+  IN OUT PEI_PPI_INDEX          *PpiIndex,
+  IN     PEI_PPI_LIST_POINTERS  *ListPtrs,
+  IN     UINTN                  Count
+  )
+{
+  UINTN                 Index;
+
+  ZeroMem (PpiIndex->Head, sizeof (PpiIndex->Head));
+  ZeroMem (PpiIndex->Tail, sizeof (PpiIndex->Tail));
+  for (Index = 0; Index < Count; Index++) {
+    PpiIndexAdd (PpiIndex, ListPtrs, Index);
+  }
+}
+
 /**
 
   This function installs an interface in the PEI PPI database by GUID.
@@ -492,6 +632,7 @@ InternalPeiInstallPpi (
         sizeof (PEI_PPI_LIST_POINTERS) * PpiListPointer->MaxCount
         );
       PpiListPointer->PpiPtrs = TempPtr;
+      PpiIndexGrow (&PrivateData->PpiIndex.PpiList, PpiListPointer->MaxCount, PpiListPointer->MaxCount + PPI_GROWTH_STEP);
       PpiListPointer->MaxCount = PpiListPointer->MaxCount + PPI_GROWTH_STEP;
     }
 
@@ -518,6 +659,14 @@ InternalPeiInstallPpi (
     PpiList++;
   }
 
+  //
+  // Index the newly installed PPIs only once the whole list is known to be
+  // valid, so a rollback never has to unlink chain entries.
+  //
+  for (Index = LastCount; Index < PpiListPointer->CurrentCount; Index++) {
+    PpiIndexAdd (&PrivateData->PpiIndex.PpiList, PpiListPointer->PpiPtrs, Index);
+  }
+
   //
   // Process any callback level notifies for newly installed PPIs.
   //
@@ -584,7 +733,9 @@ PeiReInstallPpi (
   )
 {
   PEI_CORE_INSTANCE   *PrivateData;
+  PEI_PPI_LIST        *PpiListPointer;
   UINTN               Index;
+  UINT16              Entry;
 
 
   if ((OldPpi == NULL) || (NewPpi == NULL)) {
@@ -597,16 +748,23 @@ PeiReInstallPpi (
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
 
+  PpiListPointer = &PrivateData->PpiData.PpiList;
+
   //
   // Find the old PPI instance in the database.  If we can not find it,
-  // return the EFI_NOT_FOUND error.
+  // return the EFI_NOT_FOUND error. An installed descriptor is always on
+  // the chain of its own GUID.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiList.CurrentCount; Index++) {
-    if (OldPpi == PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi) {
+  Index = PpiListPointer->CurrentCount;
+  for (Entry = PrivateData->PpiIndex.PpiList.Head[PpiIndexBucket (OldPpi->Guid)];
+       Entry != 0;
+       Entry = PrivateData->PpiIndex.PpiList.Next[Entry - 1]) {
+    if (OldPpi == PpiListPointer->PpiPtrs[Entry - 1].Ppi) {
+      Index = Entry - 1;
       break;
     }
   }
-  if (Index == PrivateData->PpiData.PpiList.CurrentCount) {
+  if (Index == PpiListPointer->CurrentCount) {
     return EFI_NOT_FOUND;
   }
 
@@ -614,7 +772,15 @@ PeiReInstallPpi (
   // Replace the old PPI with the new one.
   //
   DEBUG((EFI_D_INFO, "Reinstall PPI: %g\n", NewPpi->Guid));
-  PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+  PpiListPointer->PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+
+  //
+  // The new PPI may carry a different GUID. Its chain position must stay in
+  // list order, so rebuild the index in that rare case.
+  //
+  if (PpiIndexBucket (OldPpi->Guid) != PpiIndexBucket (NewPpi->Guid)) {
+    PpiIndexRebuild (&PrivateData->PpiIndex.PpiList, PpiListPointer->PpiPtrs, PpiListPointer->CurrentCount);
+  }
 
   //
   // Process any callback level notifies for the newly installed PPI.
@@ -658,19 +824,28 @@ PeiLocatePpi (
   )
 {
   PEI_CORE_INSTANCE         *PrivateData;
-  UINTN                     Index;
+  PEI_PPI_LIST              *PpiListPointer;
+  UINT16                    Entry;
   EFI_GUID                  *CheckGuid;
   EFI_PEI_PPI_DESCRIPTOR    *TempPtr;
 
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
+  PpiListPointer = &PrivateData->PpiData.PpiList;
+
+  PrivateData->PpiIndex.Statistics.LocateCount++;
 
   //
-  // Search the data base for the matching instance of the GUIDed PPI.
+  // Search the GUID hash chain for the matching instance of the GUIDed PPI.
+  // The chain is in installation order, so Instance counts the same way as
+  // a linear scan of the whole database.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiList.CurrentCount; Index++) {
-    TempPtr = PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi;
+  for (Entry = PrivateData->PpiIndex.PpiList.Head[PpiIndexBucket (Guid)];
+       Entry != 0;
+       Entry = PrivateData->PpiIndex.PpiList.Next[Entry - 1]) {
+    TempPtr = PpiListPointer->PpiPtrs[Entry - 1].Ppi;
     CheckGuid = TempPtr->Guid;
+    PrivateData->PpiIndex.Statistics.GuidCompareCount++;
 
     //
     // Don't use CompareGuid function here for performance reasons.
@@ -691,13 +866,15 @@ PeiLocatePpi (
           *Ppi = TempPtr->Ppi;
         }
 
-
+        PrivateData->PpiIndex.Statistics.LinearCompareCount += Entry;
         return EFI_SUCCESS;
       }
       Instance--;
     }
   }
 
+  PrivateData->PpiIndex.Statistics.LocateNotFoundCount++;
+  PrivateData->PpiIndex.Statistics.LinearCompareCount += (UINT32) PpiListPointer->CurrentCount;
   return EFI_NOT_FOUND;
 }
 
@@ -780,6 +957,11 @@ InternalPeiNotifyPpi (
           sizeof (PEI_PPI_LIST_POINTERS) * CallbackNotifyListPointer->MaxCount
           );
         CallbackNotifyListPointer->NotifyPtrs = TempPtr;
+        PpiIndexGrow (
+          &PrivateData->PpiIndex.CallbackNotifyList,
+          CallbackNotifyListPointer->MaxCount,
+          CallbackNotifyListPointer->MaxCount + CALLBACK_NOTIFY_GROWTH_STEP
+          );
         CallbackNotifyListPointer->MaxCount = CallbackNotifyListPointer->MaxCount + CALLBACK_NOTIFY_GROWTH_STEP;
       }
       CallbackNotifyListPointer->NotifyPtrs[CallbackNotifyIndex].Notify = (EFI_PEI_NOTIFY_DESCRIPTOR *) NotifyList;
@@ -800,6 +982,11 @@ InternalPeiNotifyPpi (
           sizeof (PEI_PPI_LIST_POINTERS) * DispatchNotifyListPointer->MaxCount
           );
         DispatchNotifyListPointer->NotifyPtrs = TempPtr;
+        PpiIndexGrow (
+          &PrivateData->PpiIndex.DispatchNotifyList,
+          DispatchNotifyListPointer->MaxCount,
+          DispatchNotifyListPointer->MaxCount + DISPATCH_NOTIFY_GROWTH_STEP
+          );
         DispatchNotifyListPointer->MaxCount = DispatchNotifyListPointer->MaxCount + DISPATCH_NOTIFY_GROWTH_STEP;
       }
       DispatchNotifyListPointer->NotifyPtrs[DispatchNotifyIndex].Notify = (EFI_PEI_NOTIFY_DESCRIPTOR *) NotifyList;
@@ -827,6 +1014,17 @@ InternalPeiNotifyPpi (
     NotifyList++;
   }
 
+  //
+  // Index the newly registered notifies only once the whole list is known to
+  // be valid, so a rollback never has to unlink chain entries.
+  //
+  for (CallbackNotifyIndex = LastCallbackNotifyCount; CallbackNotifyIndex < CallbackNotifyListPointer->CurrentCount; CallbackNotifyIndex++) {
+    PpiIndexAdd (&PrivateData->PpiIndex.CallbackNotifyList, CallbackNotifyListPointer->NotifyPtrs, CallbackNotifyIndex);
+  }
+  for (DispatchNotifyIndex = LastDispatchNotifyCount; DispatchNotifyIndex < DispatchNotifyListPointer->CurrentCount; DispatchNotifyIndex++) {
+    PpiIndexAdd (&PrivateData->PpiIndex.DispatchNotifyList, DispatchNotifyListPointer->NotifyPtrs, DispatchNotifyIndex);
+  }
+
   //
   // Process any callback level notifies for all previously installed PPIs.
   //
@@ -954,21 +1152,98 @@ ProcessNotify (
 {
   INTN                          Index1;
   INTN                          Index2;
+  UINT16                        Entry;
   EFI_GUID                      *SearchGuid;
   EFI_GUID                      *CheckGuid;
   EFI_PEI_NOTIFY_DESCRIPTOR     *NotifyDescriptor;
+  PEI_PPI_INDEX                 *NotifyIndex;
+  PEI_PPI_LIST_POINTERS         **NotifyPtrs;
 
-  for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
-    if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
-      NotifyDescriptor = PrivateData->PpiData.CallbackNotifyList.NotifyPtrs[Index1].Notify;
-    } else {
-      NotifyDescriptor = PrivateData->PpiData.DispatchNotifyList.NotifyPtrs[Index1].Notify;
+  if ((InstallStartIndex >= InstallStopIndex) || (NotifyStartIndex >= NotifyStopIndex)) {
+    return;
+  }
+
+  if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
+    NotifyIndex = &PrivateData->PpiIndex.CallbackNotifyList;
+    NotifyPtrs  = &PrivateData->PpiData.CallbackNotifyList.NotifyPtrs;
+  } else {
+    NotifyIndex = &PrivateData->PpiIndex.DispatchNotifyList;
+    NotifyPtrs  = &PrivateData->PpiData.DispatchNotifyList.NotifyPtrs;
+  }
+
+  //
+  // The notify functions may install PPIs or notifies and so grow the lists
+  // and their indexes, so the list and chain buffers are re-read from
+  // PrivateData on every step. Entries added by a notify function land at
+  // the tail of the chains, beyond the Stop indexes.
+  //
+  if (InstallStopIndex - InstallStartIndex == 1) {
+    //
+    // A single PPI was installed. Walk the notify chain of its GUID, which
+    // visits the matching notifies in the same order as a linear scan.
+    //
+    Index2     = InstallStartIndex;
+    SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi->Guid;
+    PrivateData->PpiIndex.Statistics.LinearCompareCount += (UINT32) (NotifyStopIndex - NotifyStartIndex);
+
+    for (Entry = NotifyIndex->Head[PpiIndexBucket (SearchGuid)]; Entry != 0; Entry = NotifyIndex->Next[Entry - 1]) {
+      Index1 = Entry - 1;
+      if (Index1 < NotifyStartIndex) {
+        continue;
+      }
+      if (Index1 >= NotifyStopIndex) {
+        break;
+      }
+
+      NotifyDescriptor = (*NotifyPtrs)[Index1].Notify;
+      CheckGuid = NotifyDescriptor->Guid;
+      PrivateData->PpiIndex.Statistics.GuidCompareCount++;
+      //
+      // Don't use CompareGuid function here for performance reasons.
+      // Instead we compare the GUID as INT32 at a time and branch
+      // on the first failed comparison.
+      //
+      if ((((INT32 *)SearchGuid)[0] == ((INT32 *)CheckGuid)[0]) &&
+          (((INT32 *)SearchGuid)[1] == ((INT32 *)CheckGuid)[1]) &&
+          (((INT32 *)SearchGuid)[2] == ((INT32 *)CheckGuid)[2]) &&
+          (((INT32 *)SearchGuid)[3] == ((INT32 *)CheckGuid)[3])) {
+        DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
+          SearchGuid,
+          NotifyDescriptor->Notify
+          ));
+        NotifyDescriptor->Notify (
+                            (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
+                            NotifyDescriptor,
+                            (PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi)->Ppi
+                            );
+      }
     }
+    return;
+  }
+
+  for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
+    NotifyDescriptor = (*NotifyPtrs)[Index1].Notify;
 
     CheckGuid = NotifyDescriptor->Guid;
+    PrivateData->PpiIndex.Statistics.LinearCompareCount += (UINT32) (InstallStopIndex - InstallStartIndex);
+
+    //
+    // Walk the PPI chain of the notify GUID, which visits the matching PPIs
+    // in the same order as a linear scan.
+    //
+    for (Entry = PrivateData->PpiIndex.PpiList.Head[PpiIndexBucket (CheckGuid)];
+         Entry != 0;
+         Entry = PrivateData->PpiIndex.PpiList.Next[Entry - 1]) {
+      Index2 = Entry - 1;
+      if (Index2 < InstallStartIndex) {
+        continue;
+      }
+      if (Index2 >= InstallStopIndex) {
+        break;
+      }
 
-    for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
       SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi->Guid;
+      PrivateData->PpiIndex.Statistics.GuidCompareCount++;
       //
       // Don't use CompareGuid function here for performance reasons.
       // Instead we compare the GUID as INT32 at a time and branch
@@ -52,6 +52,7 @@
 #include <Library/PcdLib.h>
 #include <Library/SmmCorePlatformHookLib.h>
 #include <Library/PerformanceLib.h>
+#include <Library/TimerLib.h>
 #include <Library/HobLib.h>
 #include <Library/SmmMemLib.h>
 
@@ -80,8 +81,14 @@ typedef struct {
 
   EFI_GUID    HandlerType; // Type of interrupt
   LIST_ENTRY  SmiHandlers; // All handlers
+  LIST_ENTRY  HashLink;    // Link on SMI entry hash bucket
 } SMI_ENTRY;
 
+//
+// Number of buckets in the SMI entry hash table. Must be a power of 2.
+//
+#define SMI_ENTRY_HASH_BUCKETS  64
+
 #define SMI_HANDLER_SIGNATURE  SIGNATURE_32('s','m','i','h')
 
  typedef struct {
@@ -92,6 +99,9 @@ typedef struct {
   SMI_ENTRY                     *SmiEntry;
   VOID                          *Context;    // for profile
   UINTN                         ContextSize; // for profile
+  UINT64                        InvocationCount; // for profile
+  UINT64                        TotalLatency;    // for profile, in nanoseconds
+  UINT32                        LatencyHistogram[SMI_HANDLER_PROFILE_LATENCY_BUCKETS]; // for profile
 } SMI_HANDLER;
 
 //
@@ -1148,6 +1158,20 @@ SmmCoreInitializeSmiHandlerProfile (
   VOID
   );
 
+/**
+  Record the statistics of one SMI handler invocation.
+
+  @param SmiHandler  The SMI handler which has been invoked.
+  @param StartTicks  The performance counter value before the handler is invoked.
+  @param EndTicks    The performance counter value after the handler returns.
+**/
+VOID
+SmiHandlerProfileRecordInvocation (
+  IN SMI_HANDLER  *SmiHandler,
+  IN UINT64       StartTicks,
+  IN UINT64       EndTicks
+  );
+
 /**
   This function is called by SmmChildDispatcher module to report
   a new SMI handler is registered, to SmmCore.
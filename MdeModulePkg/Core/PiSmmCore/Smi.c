@@ -15,8 +15,56 @@ SMI_ENTRY   mRootSmiEntry = {
   INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.AllEntries),
   {0},
   INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.SmiHandlers),
+  INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.HashLink),
 };
 
+//
+// SMI entries hashed by handler type, so that SmiManage() does not need to
+// walk the whole mSmiEntryList for every SMI.
+//
+LIST_ENTRY  mSmiEntryHashTable[SMI_ENTRY_HASH_BUCKETS];
+BOOLEAN     mSmiEntryHashTableInitialized = FALSE;
+
+//
+// The SMI handler currently invoked by SmiManage(). It is cleared by
+// SmiHandlerUnRegister() if the handler unregisters itself, so that the
+// profile statistics are not recorded into a freed handler.
+//
+SMI_HANDLER  *mSmiManageCurrentHandler = NULL;
+
+/**
+  Get the SMI entry hash bucket for the requested handler type.
+
+  @param  HandlerType            The type of the interrupt
+
+  @return The list head of the hash bucket.
+
+**/
+LIST_ENTRY *
+SmmCoreGetSmiEntryHashBucket (
+  IN EFI_GUID  *HandlerType
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  if (!mSmiEntryHashTableInitialized) {
+    for (Index = 0; Index < SMI_ENTRY_HASH_BUCKETS; Index++) {
+      InitializeListHead (&mSmiEntryHashTable[Index]);
+    }
+    mSmiEntryHashTableInitialized = TRUE;
+  }
+
+  Hash = ReadUnaligned32 ((UINT32 *)HandlerType) ^
+         ReadUnaligned32 ((UINT32 *)HandlerType + 1) ^
+         ReadUnaligned32 ((UINT32 *)HandlerType + 2) ^
+         ReadUnaligned32 ((UINT32 *)HandlerType + 3);
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return &mSmiEntryHashTable[Hash & (SMI_ENTRY_HASH_BUCKETS - 1)];
+}
+
 /**
   Finds the SMI entry for the requested handler type.
 
@@ -33,19 +81,21 @@ SmmCoreFindSmiEntry (
   IN BOOLEAN   Create
   )
 {
+  LIST_ENTRY  *Bucket;
   LIST_ENTRY  *Link;
   SMI_ENTRY   *Item;
   SMI_ENTRY   *SmiEntry;
 
   //
-  // Search the SMI entry list for the matching GUID
+  // Search the SMI entry hash bucket for the matching GUID
   //
   SmiEntry = NULL;
-  for (Link = mSmiEntryList.ForwardLink;
-       Link != &mSmiEntryList;
+  Bucket = SmmCoreGetSmiEntryHashBucket (HandlerType);
+  for (Link = Bucket->ForwardLink;
+       Link != Bucket;
        Link = Link->ForwardLink) {
 
-    Item = CR (Link, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+    Item = CR (Link, SMI_ENTRY, HashLink, SMI_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->HandlerType, HandlerType)) {
       //
       // This is the SMI entry
@@ -70,9 +120,10 @@ SmmCoreFindSmiEntry (
       InitializeListHead (&SmiEntry->SmiHandlers);
 
       //
-      // Add it to SMI entry list
+      // Add it to SMI entry list and hash bucket
       //
       InsertTailList (&mSmiEntryList, &SmiEntry->AllEntries);
+      InsertTailList (Bucket, &SmiEntry->HashLink);
     }
   }
   return SmiEntry;
@@ -105,11 +156,17 @@ SmiManage (
   LIST_ENTRY   *Head;
   SMI_ENTRY    *SmiEntry;
   SMI_HANDLER  *SmiHandler;
+  SMI_HANDLER  *SavedCurrentHandler;
   BOOLEAN      SuccessReturn;
+  BOOLEAN      ProfileEnabled;
+  UINT64       StartTicks;
   EFI_STATUS   Status;
 
   Status = EFI_NOT_FOUND;
   SuccessReturn = FALSE;
+  ProfileEnabled = (BOOLEAN) ((PcdGet8 (PcdSmiHandlerProfilePropertyMask) & 0x1) != 0);
+  StartTicks = 0;
+  SavedCurrentHandler = NULL;
   if (HandlerType == NULL) {
     //
     // Root SMI handler
@@ -132,6 +189,12 @@ SmiManage (
   for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
     SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
 
+    if (ProfileEnabled) {
+      SavedCurrentHandler = mSmiManageCurrentHandler;
+      mSmiManageCurrentHandler = SmiHandler;
+      StartTicks = GetPerformanceCounter ();
+    }
+
     Status = SmiHandler->Handler (
                (EFI_HANDLE) SmiHandler,
                Context,
@@ -139,6 +202,13 @@ SmiManage (
                CommBufferSize
                );
 
+    if (ProfileEnabled) {
+      if (mSmiManageCurrentHandler == SmiHandler) {
+        SmiHandlerProfileRecordInvocation (SmiHandler, StartTicks, GetPerformanceCounter ());
+      }
+      mSmiManageCurrentHandler = SavedCurrentHandler;
+    }
+
     switch (Status) {
     case EFI_INTERRUPT_PENDING:
       //
@@ -310,6 +380,10 @@ SmiHandlerUnRegister (
 
   SmiEntry = SmiHandler->SmiEntry;
 
+  if (mSmiManageCurrentHandler == SmiHandler) {
+    mSmiManageCurrentHandler = NULL;
+  }
+
   RemoveEntryList (&SmiHandler->Link);
   FreePool (SmiHandler);
 
@@ -325,6 +399,7 @@ SmiHandlerUnRegister (
     // No handler registered for this interrupt now, remove the SMI_ENTRY
     //
     RemoveEntryList (&SmiEntry->AllEntries);
+    RemoveEntryList (&SmiEntry->HashLink);
 
     FreePool (SmiEntry);
   }
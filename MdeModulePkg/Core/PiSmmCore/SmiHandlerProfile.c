@@ -98,6 +98,9 @@ GLOBAL_REMOVE_IF_UNREFERENCED UINTN  mSmmHardwareSmiDatabaseSize;
 
 GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN  mSmiHandlerProfileRecordingStatus;
 
+GLOBAL_REMOVE_IF_UNREFERENCED UINT64   mSmiHandlerProfileCounterStartValue;
+GLOBAL_REMOVE_IF_UNREFERENCED UINT64   mSmiHandlerProfileCounterEndValue;
+
 GLOBAL_REMOVE_IF_UNREFERENCED SMI_HANDLER_PROFILE_PROTOCOL  mSmiHandlerProfile = {
   SmiHandlerProfileRegisterHandler,
   SmiHandlerProfileUnregisterHandler,
@@ -707,6 +710,9 @@ GetSmmSmiHandlerDataOnSmiEntry(
     SmiHandlerStruct->Handler = (UINTN)SmiHandler->Handler;
     SmiHandlerStruct->ImageRef = AddressToImageRef((UINTN)SmiHandler->Handler);
     SmiHandlerStruct->ContextBufferSize = (UINT32)SmiHandler->ContextSize;
+    SmiHandlerStruct->InvocationCount = SmiHandler->InvocationCount;
+    SmiHandlerStruct->TotalLatency = SmiHandler->TotalLatency;
+    CopyMem (SmiHandlerStruct->LatencyHistogram, SmiHandler->LatencyHistogram, sizeof (SmiHandlerStruct->LatencyHistogram));
     if (SmiHandler->ContextSize != 0) {
       SmiHandlerStruct->ContextBufferOffset = sizeof(SMM_CORE_SMI_HANDLER_STRUCTURE);
       CopyMem ((UINT8 *)SmiHandlerStruct + SmiHandlerStruct->ContextBufferOffset, SmiHandler->Context, SmiHandler->ContextSize);
@@ -833,15 +839,33 @@ BuildSmiHandlerProfileDatabase(
   mSmiHandlerProfileDatabaseSize = GetSmiHandlerProfileDatabaseSize();
   mSmiHandlerProfileDatabase = AllocatePool(mSmiHandlerProfileDatabaseSize);
   if (mSmiHandlerProfileDatabase == NULL) {
+    mSmiHandlerProfileDatabaseSize = 0;
     return;
   }
   Status = GetSmiHandlerProfileDatabaseData(mSmiHandlerProfileDatabase);
   if (EFI_ERROR(Status)) {
     FreePool(mSmiHandlerProfileDatabase);
     mSmiHandlerProfileDatabase = NULL;
+    mSmiHandlerProfileDatabaseSize = 0;
   }
 }
 
+/**
+  Rebuild SMI handler profile database, so that it carries the latest
+  SMI handler invocation statistics.
+**/
+VOID
+RefreshSmiHandlerProfileDatabase (
+  VOID
+  )
+{
+  if (mSmiHandlerProfileDatabase != NULL) {
+    FreePool (mSmiHandlerProfileDatabase);
+    mSmiHandlerProfileDatabase = NULL;
+  }
+  BuildSmiHandlerProfileDatabase ();
+}
+
 /**
   Copy SMI handler profile data.
 
@@ -891,6 +915,11 @@ SmiHandlerProfileHandlerGetInfo(
   SmiHandlerProfileRecordingStatus = mSmiHandlerProfileRecordingStatus;
   mSmiHandlerProfileRecordingStatus = FALSE;
 
+  //
+  // Take a new snapshot for the following GET_DATA_BY_OFFSET commands.
+  //
+  RefreshSmiHandlerProfileDatabase ();
+
   SmiHandlerProfileParameterGetInfo->DataSize = mSmiHandlerProfileDatabaseSize;
   SmiHandlerProfileParameterGetInfo->Header.ReturnStatus = 0;
 
@@ -1084,6 +1113,11 @@ SmmCoreFindHardwareSmiEntry (
       SmiEntry->Signature = SMI_ENTRY_SIGNATURE;
       CopyGuid ((VOID *)&SmiEntry->HandlerType, HandlerType);
       InitializeListHead (&SmiEntry->SmiHandlers);
+      //
+      // Hardware SMI entries are not dispatched by SmiManage(), so they are
+      // not linked on the SMI entry hash table.
+      //
+      InitializeListHead (&SmiEntry->HashLink);
 
       //
       // Add it to SMI entry list
@@ -1332,6 +1366,63 @@ SmiHandlerProfileUnregisterHandler (
   return EFI_SUCCESS;
 }
 
+/**
+  Record the statistics of one SMI handler invocation.
+
+  @param SmiHandler  The SMI handler which has been invoked.
+  @param StartTicks  The performance counter value before the handler is invoked.
+  @param EndTicks    The performance counter value after the handler returns.
+**/
+VOID
+SmiHandlerProfileRecordInvocation (
+  IN SMI_HANDLER  *SmiHandler,
+  IN UINT64       StartTicks,
+  IN UINT64       EndTicks
+  )
+{
+  UINT64  Ticks;
+  UINT64  Latency;
+  UINT64  Microseconds;
+  UINTN   Bucket;
+
+  if (mSmiHandlerProfileCounterEndValue >= mSmiHandlerProfileCounterStartValue) {
+    //
+    // The counter counts up.
+    //
+    if (EndTicks >= StartTicks) {
+      Ticks = EndTicks - StartTicks;
+    } else {
+      Ticks = (mSmiHandlerProfileCounterEndValue - StartTicks) + (EndTicks - mSmiHandlerProfileCounterStartValue);
+    }
+  } else {
+    //
+    // The counter counts down.
+    //
+    if (StartTicks >= EndTicks) {
+      Ticks = StartTicks - EndTicks;
+    } else {
+      Ticks = (StartTicks - mSmiHandlerProfileCounterEndValue) + (mSmiHandlerProfileCounterStartValue - EndTicks);
+    }
+  }
+
+  Latency = GetTimeInNanoSecond (Ticks);
+  Microseconds = DivU64x32 (Latency, 1000);
+  if (Microseconds < 2) {
+    Bucket = 0;
+  } else {
+    Bucket = (UINTN)HighBitSet64 (Microseconds);
+    if (Bucket >= SMI_HANDLER_PROFILE_LATENCY_BUCKETS) {
+      Bucket = SMI_HANDLER_PROFILE_LATENCY_BUCKETS - 1;
+    }
+  }
+
+  SmiHandler->InvocationCount++;
+  SmiHandler->TotalLatency += Latency;
+  if (SmiHandler->LatencyHistogram[Bucket] != MAX_UINT32) {
+    SmiHandler->LatencyHistogram[Bucket]++;
+  }
+}
+
 /**
   Initialize SmiHandler profile feature.
 **/
@@ -1347,6 +1438,11 @@ SmmCoreInitializeSmiHandlerProfile (
   if ((PcdGet8 (PcdSmiHandlerProfilePropertyMask) & 0x1) != 0) {
     InsertTailList (&mRootSmiEntryList, &mRootSmiEntry.AllEntries);
 
+    GetPerformanceCounterProperties (
+      &mSmiHandlerProfileCounterStartValue,
+      &mSmiHandlerProfileCounterEndValue
+      );
+
     Status = gSmst->SmmRegisterProtocolNotify (
                       &gEfiSmmReadyToLockProtocolGuid,
                       SmmReadyToLockInSmiHandlerProfile,
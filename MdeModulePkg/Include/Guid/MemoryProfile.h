@@ -179,6 +179,40 @@ typedef struct {
   //MEMORY_PROFILE_DESCRIPTOR     MemoryDescriptor[MemoryRangeCount];
 } MEMORY_PROFILE_MEMORY_RANGE;
 
+//
+// The sample info is appended to the UEFI memory profile when sampling mode is
+// enabled by PcdMemoryProfileSampleInterval. In sampling mode only one in
+// SampleInterval allocations smaller than SizeThreshold is recorded as ALLOC_INFO,
+// while allocations of at least SizeThreshold bytes are always recorded.
+// So the weight of an ALLOC_INFO is SampleInterval if its Size is smaller than
+// SizeThreshold (or SizeThreshold is 0), otherwise it is 1.
+// The counters below cover every allocate action, sampled or not.
+//
+#define MEMORY_PROFILE_SAMPLE_INFO_SIGNATURE SIGNATURE_32 ('M','P','S','I')
+#define MEMORY_PROFILE_SAMPLE_INFO_REVISION 0x0001
+
+typedef struct {
+  MEMORY_PROFILE_COMMON_HEADER  Header;
+  UINT32                        SampleInterval;
+  UINT32                        DriverSampleCount;
+  UINT64                        SizeThreshold;
+  UINT64                        AllocateCount;
+  UINT64                        SampledCount;
+  UINT64                        AllocateCountByType[EfiMaxMemoryType + 2];
+  UINT64                        AllocateSizeByType[EfiMaxMemoryType + 2];
+  //MEMORY_PROFILE_DRIVER_SAMPLE  DriverSample[DriverSampleCount];
+} MEMORY_PROFILE_SAMPLE_INFO;
+
+#define MEMORY_PROFILE_DRIVER_SAMPLE_SIGNATURE SIGNATURE_32 ('M','P','D','S')
+#define MEMORY_PROFILE_DRIVER_SAMPLE_REVISION 0x0001
+
+typedef struct {
+  MEMORY_PROFILE_COMMON_HEADER  Header;
+  PHYSICAL_ADDRESS              ImageBase;
+  UINT64                        AllocateCount;
+  UINT64                        AllocateSize;
+} MEMORY_PROFILE_DRIVER_SAMPLE;
+
 //
 // UEFI memory profile layout:
 // +--------------------------------+
@@ -196,6 +230,12 @@ typedef struct {
 // +--------------------------------+
 // | ALLOC_INFO(n, mn)              |
 // +--------------------------------+
+// | SAMPLE_INFO (optional)         |
+// +--------------------------------+
+// | DRIVER_SAMPLE(1)               |
+// +--------------------------------+
+// | DRIVER_SAMPLE(n)               |
+// +--------------------------------+
 //
 
 typedef struct _EDKII_MEMORY_PROFILE_PROTOCOL EDKII_MEMORY_PROFILE_PROTOCOL;
@@ -42,7 +42,7 @@ typedef struct {
 } SMM_CORE_IMAGE_DATABASE_STRUCTURE;
 
 #define SMM_CORE_SMI_DATABASE_SIGNATURE SIGNATURE_32 ('S','C','S','D')
-#define SMM_CORE_SMI_DATABASE_REVISION  0x0001
+#define SMM_CORE_SMI_DATABASE_REVISION  0x0002
 
 typedef enum {
   SmmCoreSmiHandlerCategoryRootHandler,
@@ -77,6 +77,14 @@ typedef struct {
   UINT64                    SwSmiInputValue;
 } SMI_HANDLER_PROFILE_SW_REGISTER_CONTEXT;
 
+//
+// Number of latency buckets recorded for each SMI handler.
+// Bucket 0 counts invocations shorter than 2 microseconds, bucket N (N > 0)
+// counts invocations in [2^N, 2^(N+1)) microseconds, and the last bucket
+// also absorbs everything longer.
+//
+#define SMI_HANDLER_PROFILE_LATENCY_BUCKETS  16
+
 typedef struct {
   UINT32                Length;
   UINT32                ImageRef;
@@ -85,6 +93,14 @@ typedef struct {
   UINT16                ContextBufferOffset;
   UINT8                 Reserved[2];
   UINT32                ContextBufferSize;
+  //
+  // Below fields are added since SMM_CORE_SMI_DATABASE_REVISION 0x0002.
+  // They are only updated for handlers dispatched by SmiManage() of the
+  // SMM core (root and GUID handlers) and stay zero for hardware handlers.
+  //
+  UINT64                InvocationCount;
+  UINT64                TotalLatency;        // In nanoseconds
+  UINT32                LatencyHistogram[SMI_HANDLER_PROFILE_LATENCY_BUCKETS];
 //UINT8                 ContextBuffer[];
 } SMM_CORE_SMI_HANDLER_STRUCTURE;
 
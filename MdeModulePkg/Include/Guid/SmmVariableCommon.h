@@ -1,7 +1,7 @@
 /** @file
   The file defined some common structures used for communicating between SMM variable module and SMM variable wrapper module.
 
-Copyright (c) 2011 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2011 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -78,6 +78,12 @@ typedef struct {
 //
 #define SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO                14
 
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_BATCH, followed
+// by Count SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY entries.
+//
+#define SMM_VARIABLE_FUNCTION_BATCH                                 15
+
 ///
 /// Size of SMM communicate header, without including the payload.
 ///
@@ -138,6 +144,11 @@ typedef struct {
   VARIABLE_STORE_HEADER   *RuntimeHobCache;
   VARIABLE_STORE_HEADER   *RuntimeNvCache;
   VARIABLE_STORE_HEADER   *RuntimeVolatileCache;
+  ///
+  /// Incremented by SMM every time it rewrites (reclaims) a variable store
+  /// instead of appending to it.
+  ///
+  UINT32                  *StoreGeneration;
 } SMM_VARIABLE_COMMUNICATE_RUNTIME_VARIABLE_CACHE_CONTEXT;
 
 typedef struct {
@@ -147,4 +158,27 @@ typedef struct {
   BOOLEAN                 AuthenticatedVariableUsage;
 } SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO;
 
+typedef struct {
+  UINTN                   Count;
+} SMM_VARIABLE_COMMUNICATE_BATCH;
+
+///
+/// One operation of SMM_VARIABLE_FUNCTION_BATCH. Variable.Name is followed by
+/// Variable.DataSize bytes of data, and the next entry starts at the next
+/// UINTN aligned offset. The handler updates Variable.DataSize and
+/// Variable.Attributes of a SMM_VARIABLE_FUNCTION_GET_VARIABLE operation, but
+/// the entry keeps the size the caller reserved.
+///
+typedef struct {
+  UINTN                                     Function;     // SMM_VARIABLE_FUNCTION_GET_VARIABLE or SMM_VARIABLE_FUNCTION_SET_VARIABLE
+  EFI_STATUS                                ReturnStatus;
+  SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE  Variable;
+} SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY;
+
+///
+/// Size of a SMM_VARIABLE_FUNCTION_BATCH entry with the given name and data sizes.
+///
+#define SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY_SIZE(NameSize, DataSize) \
+  ALIGN_VALUE (OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY, Variable.Name) + (NameSize) + (DataSize), sizeof (UINTN))
+
 #endif // _SMM_VARIABLE_COMMON_H_
@@ -2,7 +2,7 @@
   The variable data structures are related to EDK II-specific implementation of UEFI variables.
   VariableFormat.h defines variable data headers and variable storage region headers.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -16,8 +16,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define EFI_AUTHENTICATED_VARIABLE_GUID \
   { 0xaaf32c78, 0x947b, 0x439a, { 0xa1, 0x80, 0x2e, 0x14, 0x4e, 0xc3, 0x77, 0x92 } }
 
+#define EDKII_COMPRESSED_VARIABLE_GUID \
+  { 0x374d44fe, 0xe939, 0x4ed9, { 0x9c, 0x45, 0x15, 0x0c, 0x90, 0x91, 0xf6, 0xd0 } }
+
 extern EFI_GUID gEfiVariableGuid;
 extern EFI_GUID gEfiAuthenticatedVariableGuid;
+extern EFI_GUID gEdkiiCompressedVariableGuid;
 
 ///
 /// Alignment of variable name and data, according to the architecture:
@@ -54,6 +58,11 @@ typedef enum {
 
 #define VARIABLE_STORE_SIGNATURE  EFI_VARIABLE_GUID
 #define AUTHENTICATED_VARIABLE_STORE_SIGNATURE  EFI_AUTHENTICATED_VARIABLE_GUID
+///
+/// A variable store with this signature holds authenticated variables, some of
+/// which may have the VARIABLE_DATA_COMPRESSED flag.
+///
+#define COMPRESSED_VARIABLE_STORE_SIGNATURE  EDKII_COMPRESSED_VARIABLE_GUID
 
 ///
 /// Variable Store Header Format and State.
@@ -99,6 +108,16 @@ typedef struct {
 #define VAR_HEADER_VALID_ONLY         0x7f  ///< Variable header has been valid.
 #define VAR_ADDED                     0x3f  ///< Variable has been completely added.
 
+///
+/// Variable flags, in the Reserved field of the variable header.
+/// VARIABLE_DATA_COMPRESSED is only set in a store with the signature
+/// COMPRESSED_VARIABLE_STORE_SIGNATURE. The data of such a variable is
+/// compressed with the UEFI compression algorithm, DataSize is the size of
+/// the compressed data, and the size of the variable data seen by GetVariable()
+/// is the original size recorded in the header of the compressed data.
+///
+#define VARIABLE_DATA_COMPRESSED      0x01
+
 ///
 /// Variable Attribute combinations.
 ///
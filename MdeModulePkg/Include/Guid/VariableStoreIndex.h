@@ -0,0 +1,70 @@
+/** @file
+  The GUID and the format of the HOB that holds the hash index of the NV
+  variable store. The PEI variable driver builds it the first time it reads
+  the store, and the DXE variable driver takes the variable sizes and the
+  variable offsets from it instead of parsing the store again.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_STORE_INDEX_H__
+#define __VARIABLE_STORE_INDEX_H__
+
+#define EDKII_VARIABLE_STORE_INDEX_GUID \
+  { 0x782c1cdb, 0x2f1b, 0x41f3, { 0x94, 0x5d, 0x8d, 0xba, 0xe9, 0x01, 0xd8, 0xb0 } }
+
+extern EFI_GUID gEdkiiVariableStoreIndexGuid;
+
+///
+/// One variable in VARIABLE_STORE_INDEX.
+///
+typedef struct {
+  ///
+  /// Offset of the variable header from the variable store header.
+  ///
+  UINT32          Offset;
+  ///
+  /// 32-bit FNV-1a hash of the characters of the variable name (each one
+  /// taken as a 16-bit value, up to the null terminator) followed by the
+  /// 16 bytes of the vendor GUID.
+  ///
+  UINT32          Hash;
+} VARIABLE_STORE_INDEX_ENTRY;
+
+///
+/// Hash index of all the VAR_ADDED and IN_DELETED_TRANSITION variables of the
+/// NV variable store. It is followed by UINT32 BucketStart[BucketCount + 1] and
+/// VARIABLE_STORE_INDEX_ENTRY Entry[EntryCount]. The entries of bucket B are
+/// Entry[BucketStart[B]] to Entry[BucketStart[B + 1] - 1], in the order of their
+/// offset, and B is the lowest bits of their hash.
+///
+/// BucketCount is 0 if the store could not be indexed.
+///
+typedef struct {
+  ///
+  /// Address of the variable store header that was indexed.
+  ///
+  EFI_PHYSICAL_ADDRESS  StoreBase;
+  UINT32                StoreSize;
+  ///
+  /// Offset of the end of the last variable from the variable store header.
+  ///
+  UINT32                EndOffset;
+  ///
+  /// Total size of the hardware error record variables, and of the other
+  /// variables, in any state.
+  ///
+  UINT32                HwErrVariableTotalSize;
+  UINT32                CommonVariableTotalSize;
+  ///
+  /// Number of variable headers whose write never completed.
+  ///
+  UINT32                IncompleteCount;
+  UINT32                BucketCount;
+  UINT32                EntryCount;
+  UINT32                Reserved;
+} VARIABLE_STORE_INDEX;
+
+#endif // __VARIABLE_STORE_INDEX_H__
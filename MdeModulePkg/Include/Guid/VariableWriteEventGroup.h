@@ -0,0 +1,27 @@
+/** @file
+  The event group signaled by the DXE variable drivers after SetVariable ()
+  has changed a variable, before ExitBootServices (). It allows for the
+  drivers that keep a copy of variable data, like the PCD DXE driver for the
+  HII type PCDs or DxeImageVerificationLib for db, dbx and dbt, to drop that
+  copy.
+
+  The writes of the variables of gEfiImageSecurityDatabaseGuid always signal
+  the event group. The writes of the other variables only signal it when
+  PcdHiiPcdValueCacheEnable is TRUE.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_WRITE_EVENT_GROUP_H__
+#define __VARIABLE_WRITE_EVENT_GROUP_H__
+
+#define EDKII_VARIABLE_WRITE_EVENT_GROUP_GUID \
+  { \
+    0x6c42df50, 0x4e1d, 0x419e, { 0xab, 0x7c, 0x8b, 0x45, 0xc4, 0xd3, 0xe0, 0xea } \
+  }
+
+extern EFI_GUID gEdkiiVariableWriteEventGroupGuid;
+
+#endif
@@ -0,0 +1,42 @@
+/** @file
+  Provides services to compress a buffer using the UEFI Compress algorithm.
+
+  The data compressed by the UEFI Compress Library is decompressed with the
+  UefiDecompressLib library class.
+
+Copyright (c) 2005 - 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __UEFI_COMPRESS_LIB_H__
+#define __UEFI_COMPRESS_LIB_H__
+
+/**
+  Compresses a source buffer with the UEFI compression algorithm, into the
+  format which UefiDecompress () takes.
+
+  The work buffers of the compression are allocated from pool, and the state
+  of the compression is kept in module globals, so the function is not
+  reentrant.
+
+  @param[in]       SrcBuffer     The buffer containing the source data.
+  @param[in]       SrcSize       Number of bytes in SrcBuffer.
+  @param[in]       DstBuffer     The buffer to put the compressed image in.
+  @param[in, out]  DstSize       On input the size (in bytes) of DstBuffer, on
+                                 return the number of bytes placed in DstBuffer.
+
+  @retval RETURN_SUCCESS           The compression was sucessful.
+  @retval RETURN_BUFFER_TOO_SMALL  The buffer was too small.  DstSize is required.
+  @retval RETURN_OUT_OF_RESOURCES  Not enough memory for the work buffers.
+**/
+RETURN_STATUS
+EFIAPI
+UefiCompress (
+  IN      VOID    *SrcBuffer,
+  IN      UINT64  SrcSize,
+  IN      VOID    *DstBuffer,
+  IN OUT  UINT64  *DstSize
+  );
+
+#endif
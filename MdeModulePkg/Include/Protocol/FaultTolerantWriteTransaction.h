@@ -0,0 +1,122 @@
+/** @file
+  EDK II Fault Tolerant Write Transaction protocol queues several writes to the
+  blocks of one firmware volume block device and commits them as a single
+  fault tolerant write, so that they cost one spare block cycle and leave
+  either all the original contents or all the modified contents in flash.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __FAULT_TOLERANT_WRITE_TRANSACTION_H__
+#define __FAULT_TOLERANT_WRITE_TRANSACTION_H__
+
+#define EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL_GUID \
+  { \
+    0xade929d9, 0xa0bc, 0x47ed, { 0xaf, 0xe1, 0xca, 0x36, 0x4c, 0xed, 0xe3, 0x05 } \
+  }
+
+//
+// Forward reference for pure ANSI compatability
+//
+typedef struct _EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL  EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL;
+
+/**
+  Starts a transaction on the blocks of a firmware volume block device.
+
+  @param  This                 A pointer to the calling context.
+  @param  FvBlockHandle        The handle of FVB protocol that provides services
+                               for reading, writing, and erasing the target blocks.
+
+  @retval EFI_SUCCESS          The transaction is started.
+  @retval EFI_ACCESS_DENIED    Another transaction is in progress.
+  @retval EFI_NOT_FOUND        Cannot find FVB protocol by handle.
+  @retval EFI_ABORTED          The function could not complete successfully.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_BEGIN)(
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN EFI_HANDLE                                        FvBlockHandle
+  );
+
+/**
+  Queues a write in the transaction. Nothing is written to flash until the
+  transaction is committed. Later writes overwrite earlier ones where they
+  overlap.
+
+  @param  This                 A pointer to the calling context.
+  @param  Lba                  The logical block address of the target block.
+  @param  Offset               The offset within the target block to place the data.
+  @param  Length               The number of bytes to write to the target block.
+  @param  Buffer               The data to write, copied before the function returns.
+
+  @retval EFI_SUCCESS          The write is queued.
+  @retval EFI_NOT_READY        No transaction is in progress.
+  @retval EFI_INVALID_PARAMETER Buffer is NULL or Length is 0.
+  @retval EFI_BAD_BUFFER_SIZE  The blocks touched by the transaction would not
+                               fit within the spare block.
+  @retval EFI_OUT_OF_RESOURCES Cannot allocate enough memory resource.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_WRITE)(
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN EFI_LBA                                           Lba,
+  IN UINTN                                             Offset,
+  IN UINTN                                             Length,
+  IN VOID                                              *Buffer
+  );
+
+/**
+  Commits the writes queued in the transaction as one fault tolerant write,
+  and ends the transaction whether the commit succeeds or not.
+
+  The commit follows the rules of EFI_FAULT_TOLERANT_WRITE_PROTOCOL.Write():
+  if no writes were allocated it allocates one, otherwise it uses the next
+  allocated write.
+
+  @param  This                 A pointer to the calling context.
+  @param  PrivateData          A pointer to private data that the caller requires
+                               to complete any pending writes in the event of a fault.
+
+  @retval EFI_SUCCESS          The writes are committed, or none was queued.
+  @retval EFI_NOT_READY        No transaction is in progress.
+  @retval Others               The status of the fault tolerant write.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_COMMIT)(
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN VOID                                              *PrivateData OPTIONAL
+  );
+
+/**
+  Discards the writes queued in the transaction and ends it.
+
+  @param  This                 A pointer to the calling context.
+
+  @retval EFI_SUCCESS          The transaction is ended.
+  @retval EFI_NOT_READY        No transaction is in progress.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_ABORT)(
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This
+  );
+
+struct _EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL {
+  EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_BEGIN    Begin;
+  EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_WRITE    Write;
+  EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_COMMIT   Commit;
+  EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_ABORT    Abort;
+};
+
+extern EFI_GUID gEdkiiFaultTolerantWriteTransactionProtocolGuid;
+
+#endif
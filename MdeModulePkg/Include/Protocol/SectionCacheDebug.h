@@ -0,0 +1,83 @@
+/** @file
+  EDKII Section Cache Debug Protocol.
+
+  The DXE Core keeps a bounded cache of the data it extracts from compressed and
+  GUIDed encapsulation sections, so that an encapsulation section opened again is
+  not decoded again. This protocol reports the activity of the cache, and lets
+  debug tools empty it.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __SECTION_CACHE_DEBUG_H__
+#define __SECTION_CACHE_DEBUG_H__
+
+#define EDKII_SECTION_CACHE_DEBUG_PROTOCOL_GUID \
+  { 0x4b1e2d6c, 0x8f3a, 0x4c57, { 0x9e, 0x21, 0x6a, 0xd0, 0x3b, 0x7f, 0xc4, 0x58 } }
+
+typedef struct _EDKII_SECTION_CACHE_DEBUG_PROTOCOL EDKII_SECTION_CACHE_DEBUG_PROTOCOL;
+
+typedef struct {
+  ///
+  /// Number of extractions served from the cache.
+  ///
+  UINT64    HitCount;
+  ///
+  /// Number of extractions that had to decode the section.
+  ///
+  UINT64    MissCount;
+  ///
+  /// Number of entries evicted to stay within the cache size, or because
+  /// memory ran low.
+  ///
+  UINT64    EvictionCount;
+  ///
+  /// Number of entries and bytes of extracted data currently cached.
+  ///
+  UINT32    EntryCount;
+  UINT64    CachedBytes;
+  ///
+  /// Maximum number of bytes of extracted data the cache may hold.
+  ///
+  UINT64    MaximumBytes;
+} EDKII_SECTION_CACHE_STATISTICS;
+
+/**
+  Get the statistics of the section cache.
+
+  @param[in]  This          The EDKII_SECTION_CACHE_DEBUG_PROTOCOL instance.
+  @param[out] Statistics    The statistics of the section cache.
+
+  @retval EFI_SUCCESS             The statistics are returned.
+  @retval EFI_INVALID_PARAMETER   Statistics is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_SECTION_CACHE_GET_STATISTICS) (
+  IN  EDKII_SECTION_CACHE_DEBUG_PROTOCOL  *This,
+  OUT EDKII_SECTION_CACHE_STATISTICS      *Statistics
+  );
+
+/**
+  Evict all the entries of the section cache. The statistics are kept.
+
+  @param[in]  This          The EDKII_SECTION_CACHE_DEBUG_PROTOCOL instance.
+
+  @retval EFI_SUCCESS       The section cache is empty.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_SECTION_CACHE_FLUSH) (
+  IN  EDKII_SECTION_CACHE_DEBUG_PROTOCOL  *This
+  );
+
+struct _EDKII_SECTION_CACHE_DEBUG_PROTOCOL {
+  EDKII_SECTION_CACHE_GET_STATISTICS    GetStatistics;
+  EDKII_SECTION_CACHE_FLUSH             Flush;
+};
+
+extern EFI_GUID gEdkiiSectionCacheDebugProtocolGuid;
+
+#endif
@@ -0,0 +1,30 @@
+/** @file
+  EDK II SMM Fault Tolerant Write Transaction protocol queues several writes to
+  the blocks of one firmware volume block device and commits them as a single
+  fault tolerant write in the SMM environment.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __SMM_FAULT_TOLERANT_WRITE_TRANSACTION_H__
+#define __SMM_FAULT_TOLERANT_WRITE_TRANSACTION_H__
+
+#include <Protocol/FaultTolerantWriteTransaction.h>
+
+#define EDKII_SMM_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL_GUID \
+  { \
+    0x86b99ab7, 0xb940, 0x4068, { 0x9a, 0xa2, 0x95, 0xff, 0xd8, 0x39, 0x67, 0x2a } \
+  }
+
+//
+// SMM Fault Tolerant Write Transaction protocol structure is the same as Fault
+// Tolerant Write Transaction protocol. The SMM one is intend to run in SMM
+// environment, and works on the blocks of SMM FVB protocol instances.
+//
+typedef EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL EDKII_SMM_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL;
+
+extern EFI_GUID gEdkiiSmmFaultTolerantWriteTransactionProtocolGuid;
+
+#endif
@@ -0,0 +1,78 @@
+/** @file
+  EDK II Variable Batch protocol performs a list of GetVariable and SetVariable
+  operations in order, with as few transitions to the variable service as
+  possible, and returns the status of every operation.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_BATCH_H__
+#define __VARIABLE_BATCH_H__
+
+#define EDKII_VARIABLE_BATCH_PROTOCOL_GUID \
+  { \
+    0xfbb65d9c, 0xb85a, 0x4274, { 0xb7, 0x70, 0x69, 0x05, 0xdb, 0x1c, 0x29, 0xc0 } \
+  }
+
+typedef struct _EDKII_VARIABLE_BATCH_PROTOCOL  EDKII_VARIABLE_BATCH_PROTOCOL;
+
+typedef enum {
+  ///
+  /// GetVariable(). Attributes and DataSize are updated as GetVariable() does.
+  ///
+  EdkiiVariableBatchGet,
+  ///
+  /// SetVariable().
+  ///
+  EdkiiVariableBatchSet
+} EDKII_VARIABLE_BATCH_OPERATION;
+
+typedef struct {
+  EDKII_VARIABLE_BATCH_OPERATION  Operation;
+  CHAR16                          *VariableName;
+  EFI_GUID                        *VendorGuid;
+  UINT32                          Attributes;
+  UINTN                           DataSize;
+  VOID                            *Data;
+  ///
+  /// The status GetVariable() or SetVariable() would have returned for the
+  /// operation.
+  ///
+  EFI_STATUS                      Status;
+} EDKII_VARIABLE_BATCH_ENTRY;
+
+/**
+  Performs the variable operations in Entries, in order.
+
+  Every operation behaves as the GetVariable() or SetVariable() call with the
+  same parameters, and sees the result of the operations before it. The
+  operations are not atomic: a failed operation does not undo the operations
+  before it, nor stop the operations after it.
+
+  @param  This                  A pointer to the calling context.
+  @param  Count                 The number of entries in Entries.
+  @param  Entries               The operations to perform. The Status of each
+                                entry is set on return.
+
+  @retval EFI_SUCCESS           All the operations were performed. Check the
+                                Status of every entry for its result.
+  @retval EFI_INVALID_PARAMETER Count is not 0 and Entries is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_VARIABLE_BATCH_EXECUTE)(
+  IN     EDKII_VARIABLE_BATCH_PROTOCOL  *This,
+  IN     UINTN                          Count,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY     *Entries
+  );
+
+struct _EDKII_VARIABLE_BATCH_PROTOCOL {
+  EDKII_VARIABLE_BATCH_EXECUTE          Execute;
+};
+
+extern EFI_GUID gEdkiiVariableBatchProtocolGuid;
+
+#endif
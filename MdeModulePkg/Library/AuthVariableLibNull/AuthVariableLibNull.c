@@ -1,7 +1,7 @@
 /** @file
   Implements NULL authenticated variable services.
 
-Copyright (c) 2015 - 2017, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2015 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -69,3 +69,21 @@ AuthVariableLibProcessVariable (
   ASSERT (FALSE);
   return EFI_UNSUPPORTED;
 }
+
+/**
+  Release the resources of authenticated variable services that can not be
+  used after SetVirtualAddressMap (). Authenticated variables are still
+  processed after it, without these resources.
+
+  The caller needs to call it at ExitBootServices () if it converts the
+  pointers in AUTH_VAR_LIB_CONTEXT_OUT.AddressPointer at SetVirtualAddressMap ().
+
+**/
+VOID
+EFIAPI
+AuthVariableLibExitBootServices (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+}
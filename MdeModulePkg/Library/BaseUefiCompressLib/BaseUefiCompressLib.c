@@ -1,23 +1,29 @@
 /** @file
-  Main file for compression routine.
+  UEFI Compress Library implementation.
 
-  Compression routine. The compression algorithm is a mixture of
-  LZ77 and Huffman coding. LZ77 transforms the source data into a
-  sequence of Original Characters and Pointers to repeated strings.
-  This sequence is further divided into Blocks and Huffman codings
-  are applied to each Block.
+  The compression algorithm is a mixture of LZ77 and Huffman coding. LZ77
+  transforms the source data into a sequence of Original Characters and
+  Pointers to repeated strings. This sequence is further divided into Blocks
+  and Huffman codings are applied to each Block.
 
-  Copyright (c) 2007 - 2018, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2007 - 2020, Intel Corporation. All rights reserved.<BR>
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
-#include <Uefi.h>
-#include <Library/MemoryAllocationLib.h>
+
+#include <Base.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
-#include <Library/ShellLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiCompressLib.h>
 
-#include "Compress.h"
+#define FREE_NON_NULL(Pointer)  \
+  do {                          \
+    if ((Pointer) != NULL) {    \
+      FreePool ((Pointer));     \
+      (Pointer) = NULL;         \
+    }                           \
+  } while (FALSE)
 
 //
 // Macro Definitions
@@ -62,8 +68,9 @@ typedef INT16             NODE;
 
   @param[in] Data    The dword to put.
 **/
+STATIC
 VOID
-PutDword(
+PutDword (
   IN UINT32 Data
   );
 
@@ -115,12 +122,13 @@ STATIC NODE   *mPosition;
 STATIC NODE   *mParent;
 STATIC NODE   *mPrev;
 STATIC NODE   *mNext = NULL;
-INT32         mHuffmanDepth = 0;
+STATIC INT32  mHuffmanDepth = 0;
 
 /**
   Make a CRC table.
 
 **/
+STATIC
 VOID
 MakeCrcTable (
   VOID
@@ -151,6 +159,7 @@ MakeCrcTable (
 
   @param[in] Data    The dword to put.
 **/
+STATIC
 VOID
 PutDword (
   IN UINT32 Data
@@ -176,10 +185,11 @@ PutDword (
 /**
   Allocate memory spaces for data structures used in compression process.
 
-  @retval EFI_SUCCESS           Memory was allocated successfully.
-  @retval EFI_OUT_OF_RESOURCES  A memory allocation failed.
+  @retval RETURN_SUCCESS           Memory was allocated successfully.
+  @retval RETURN_OUT_OF_RESOURCES  A memory allocation failed.
 **/
-EFI_STATUS
+STATIC
+RETURN_STATUS
 AllocateMemory (
   VOID
   )
@@ -197,7 +207,7 @@ AllocateMemory (
   while (mBuf == NULL) {
     mBufSiz = (mBufSiz / 10U) * 9U;
     if (mBufSiz < 4 * 1024U) {
-      return EFI_OUT_OF_RESOURCES;
+      return RETURN_OUT_OF_RESOURCES;
     }
 
     mBuf = AllocateZeroPool (mBufSiz);
@@ -205,31 +215,33 @@ AllocateMemory (
 
   mBuf[0] = 0;
 
-  return EFI_SUCCESS;
+  return RETURN_SUCCESS;
 }
 
 /**
   Called when compression is completed to free memory previously allocated.
 
 **/
+STATIC
 VOID
 FreeMemory (
   VOID
   )
 {
-  SHELL_FREE_NON_NULL (mText);
-  SHELL_FREE_NON_NULL (mLevel);
-  SHELL_FREE_NON_NULL (mChildCount);
-  SHELL_FREE_NON_NULL (mPosition);
-  SHELL_FREE_NON_NULL (mParent);
-  SHELL_FREE_NON_NULL (mPrev);
-  SHELL_FREE_NON_NULL (mNext);
-  SHELL_FREE_NON_NULL (mBuf);
+  FREE_NON_NULL (mText);
+  FREE_NON_NULL (mLevel);
+  FREE_NON_NULL (mChildCount);
+  FREE_NON_NULL (mPosition);
+  FREE_NON_NULL (mParent);
+  FREE_NON_NULL (mPrev);
+  FREE_NON_NULL (mNext);
+  FREE_NON_NULL (mBuf);
 }
 
 /**
   Initialize String Info Log data structures.
 **/
+STATIC
 VOID
 InitSlide (
   VOID
@@ -261,6 +273,7 @@ InitSlide (
   @retval NIL(Zero)   No child could be found.
 
 **/
+STATIC
 NODE
 Child (
   IN NODE   LoopVar6,
@@ -285,6 +298,7 @@ Child (
   @param[in] LoopVar5       The edge character.
   @param[in] LoopVar4       The child node.
 **/
+STATIC
 VOID
 MakeChild (
   IN NODE   LoopVar6,
@@ -311,6 +325,7 @@ MakeChild (
 
   @param[in] Old     The node to split.
 **/
+STATIC
 VOID
 Split (
   IN NODE Old
@@ -340,6 +355,7 @@ Split (
   Insert string info for current position into the String Info Log.
 
 **/
+STATIC
 VOID
 InsertNode (
   VOID
@@ -468,6 +484,7 @@ InsertNode (
   ensures a clean deletion).
 
 **/
+STATIC
 VOID
 DeleteNode (
   VOID
@@ -562,6 +579,7 @@ DeleteNode (
 
   @return The number of bytes actually read.
 **/
+STATIC
 INT32
 FreadCrc (
   OUT UINT8 *LoopVar7,
@@ -594,24 +612,21 @@ FreadCrc (
   @retval TRUE      The operation was successful.
   @retval FALSE     The operation failed due to insufficient memory.
 **/
+STATIC
 BOOLEAN
 GetNextMatch (
   VOID
   )
 {
   INT32 LoopVar8;
-  VOID  *Temp;
 
   mRemainder--;
   mPos++;
   if (mPos == WNDSIZ * 2) {
-    Temp = AllocateZeroPool (WNDSIZ + MAXMATCH);
-    if (Temp == NULL) {
-      return (FALSE);
-    }
-    CopyMem (Temp, &mText[WNDSIZ], WNDSIZ + MAXMATCH);
-    CopyMem (&mText[0], Temp, WNDSIZ + MAXMATCH);
-    FreePool (Temp);
+    //
+    // CopyMem () handles the overlapping buffers.
+    //
+    CopyMem (&mText[0], &mText[WNDSIZ], WNDSIZ + MAXMATCH);
     LoopVar8 = FreadCrc (&mText[WNDSIZ + MAXMATCH], WNDSIZ);
     mRemainder += LoopVar8;
     mPos = WNDSIZ;
@@ -628,6 +643,7 @@ GetNextMatch (
 
   @param[in] LoopVar1    The index of the item to move.
 **/
+STATIC
 VOID
 DownHeap (
   IN INT32 i
@@ -664,6 +680,7 @@ DownHeap (
 
   @param[in] LoopVar1      The top node.
 **/
+STATIC
 VOID
 CountLen (
   IN INT32 LoopVar1
@@ -684,6 +701,7 @@ CountLen (
 
   @param[in] Root   The root of the tree.
 **/
+STATIC
 VOID
 MakeLen (
   IN INT32 Root
@@ -739,6 +757,7 @@ MakeLen (
   @param[in] Len    The code length array.
   @param[out] Code  The stores codes for each symbol.
 **/
+STATIC
 VOID
 MakeCode (
   IN  INT32         LoopVar8,
@@ -769,6 +788,7 @@ MakeCode (
 
   @return The root of the Huffman tree.
 **/
+STATIC
 INT32
 MakeTree (
   IN  INT32             NParm,
@@ -852,6 +872,7 @@ MakeTree (
   @param[in] LoopVar8   The rightmost LoopVar8 bits of the data is used.
   @param[in] x   The data.
 **/
+STATIC
 VOID
 PutBits (
   IN INT32    LoopVar8,
@@ -890,6 +911,7 @@ PutBits (
 
   @param[in] LoopVar5     The number to encode.
 **/
+STATIC
 VOID
 EncodeC (
   IN INT32 LoopVar5
@@ -903,6 +925,7 @@ EncodeC (
 
   @param[in] LoopVar7     The number to encode.
 **/
+STATIC
 VOID
 EncodeP (
   IN UINT32 LoopVar7
@@ -929,6 +952,7 @@ EncodeP (
   Count the frequencies for the Extra Set.
 
 **/
+STATIC
 VOID
 CountTFreq (
   VOID
@@ -986,6 +1010,7 @@ CountTFreq (
   @param[in] Special        The special symbol that needs to be take care of.
 
 **/
+STATIC
 VOID
 WritePTLen (
   IN INT32 LoopVar8,
@@ -1024,6 +1049,7 @@ WritePTLen (
 /**
   Outputs the code length array for Char&Length Set.
 **/
+STATIC
 VOID
 WriteCLen (
   VOID
@@ -1079,6 +1105,7 @@ WriteCLen (
   Huffman code the block and output it.
 
 **/
+STATIC
 VOID
 SendBlock (
   VOID
@@ -1152,6 +1179,7 @@ SendBlock (
   Start the huffman encoding.
 
 **/
+STATIC
 VOID
 HufEncodeStart (
   VOID
@@ -1173,6 +1201,7 @@ HufEncodeStart (
                    a Pointer.
   @param[in] LoopVar7     The 'Position' field of a Pointer.
 **/
+STATIC
 VOID
 CompressOutput (
   IN UINT32 LoopVar5,
@@ -1210,6 +1239,7 @@ CompressOutput (
   End the huffman encoding.
 
 **/
+STATIC
 VOID
 HufEncodeEnd (
   VOID
@@ -1226,20 +1256,21 @@ HufEncodeEnd (
 /**
   The main controlling routine for compression process.
 
-  @retval EFI_SUCCESS           The compression is successful.
-  @retval EFI_OUT_0F_RESOURCES  Not enough memory for compression process.
+  @retval RETURN_SUCCESS           The compression is successful.
+  @retval RETURN_OUT_OF_RESOURCES  Not enough memory for compression process.
 **/
-EFI_STATUS
+STATIC
+RETURN_STATUS
 Encode (
   VOID
   )
 {
-  EFI_STATUS  Status;
+  RETURN_STATUS  Status;
   INT32       LastMatchLen;
   NODE        LastMatchPos;
 
   Status = AllocateMemory ();
-  if (EFI_ERROR (Status)) {
+  if (RETURN_ERROR (Status)) {
     FreeMemory ();
     return Status;
   }
@@ -1261,7 +1292,7 @@ Encode (
     LastMatchLen  = mMatchLen;
     LastMatchPos  = mMatchPos;
     if (!GetNextMatch ()) {
-      Status = EFI_OUT_OF_RESOURCES;
+      Status = RETURN_OUT_OF_RESOURCES;
     }
     if (mMatchLen > mRemainder) {
       mMatchLen = mRemainder;
@@ -1283,7 +1314,7 @@ Encode (
       LastMatchLen--;
       while (LastMatchLen > 0) {
         if (!GetNextMatch ()) {
-          Status = EFI_OUT_OF_RESOURCES;
+          Status = RETURN_OUT_OF_RESOURCES;
         }
         LastMatchLen--;
       }
@@ -1300,7 +1331,12 @@ Encode (
 }
 
 /**
-  The compression routine.
+  Compresses a source buffer with the UEFI compression algorithm, into the
+  format which UefiDecompress () takes.
+
+  The work buffers of the compression are allocated from pool, and the state
+  of the compression is kept in module globals, so the function is not
+  reentrant.
 
   @param[in]       SrcBuffer     The buffer containing the source data.
   @param[in]       SrcSize       Number of bytes in SrcBuffer.
@@ -1308,18 +1344,20 @@ Encode (
   @param[in, out]  DstSize       On input the size (in bytes) of DstBuffer, on
                                  return the number of bytes placed in DstBuffer.
 
-  @retval EFI_SUCCESS           The compression was sucessful.
-  @retval EFI_BUFFER_TOO_SMALL  The buffer was too small.  DstSize is required.
+  @retval RETURN_SUCCESS           The compression was sucessful.
+  @retval RETURN_BUFFER_TOO_SMALL  The buffer was too small.  DstSize is required.
+  @retval RETURN_OUT_OF_RESOURCES  Not enough memory for the work buffers.
 **/
-EFI_STATUS
-Compress (
+RETURN_STATUS
+EFIAPI
+UefiCompress (
   IN      VOID    *SrcBuffer,
   IN      UINT64  SrcSize,
   IN      VOID    *DstBuffer,
   IN OUT  UINT64  *DstSize
   )
 {
-  EFI_STATUS  Status;
+  RETURN_STATUS  Status;
 
   //
   // Initializations
@@ -1351,8 +1389,8 @@ Compress (
   // Compress it
   //
   Status = Encode ();
-  if (EFI_ERROR (Status)) {
-    return EFI_OUT_OF_RESOURCES;
+  if (RETURN_ERROR (Status)) {
+    return RETURN_OUT_OF_RESOURCES;
   }
   //
   // Null terminate the compressed data
@@ -1372,11 +1410,10 @@ Compress (
   //
   if (mCompSize + 1 + 8 > *DstSize) {
     *DstSize = mCompSize + 1 + 8;
-    return EFI_BUFFER_TOO_SMALL;
+    return RETURN_BUFFER_TOO_SMALL;
   } else {
     *DstSize = mCompSize + 1 + 8;
-    return EFI_SUCCESS;
+    return RETURN_SUCCESS;
   }
 
 }
-
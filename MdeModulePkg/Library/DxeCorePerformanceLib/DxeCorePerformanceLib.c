@@ -77,6 +77,70 @@ CHAR8   *mDevicePathString    = NULL;
 
 EFI_DEVICE_PATH_TO_TEXT_PROTOCOL  *mDevicePathToText = NULL;
 
+//
+// Data for deferred performance records.
+//
+// The string pool and its hash table only hold the strings of the records not
+// merged yet, and are emptied by each merge. The hash table is kept at most half
+// full, so at most DEFERRED_STRING_HASH_SIZE / 2 distinct strings are interned
+// between two merges; the next string forces a merge.
+//
+#define DEFERRED_STRING_POOL_SIZE     0x2000
+#define DEFERRED_STRING_HASH_SIZE     0x400
+
+#define DEFERRED_RECORD_CALLER_GUID   BIT0
+#define DEFERRED_RECORD_GUID          BIT1
+#define DEFERRED_RECORD_MODULE_INFO   BIT2
+#define DEFERRED_RECORD_MODULE_FILE   BIT3
+
+///
+/// A performance measurement saved as it was passed to CreatePerformanceMeasurement(),
+/// with a raw performance counter value as timestamp and interned strings.
+///
+typedef struct {
+  UINT64                      Ticker;
+  CONST VOID                  *CallerIdentifier;
+  UINT64                      Address;
+  EFI_GUID                    CallerGuid;
+  EFI_GUID                    Guid;
+  ///
+  /// Module GUID looked up from the caller identifier when the measurement was taken.
+  /// With DEFERRED_RECORD_MODULE_FILE it is the FFS file GUID of the image, and the
+  /// module name is only looked up at merge time.
+  ///
+  EFI_GUID                    ModuleGuid;
+  UINT16                      Identifier;
+  ///
+  /// Offset of the string in the string pool, 0 for NULL
+  ///
+  UINT16                      StringOffset;
+  ///
+  /// Offset of the module name in the string pool, with DEFERRED_RECORD_MODULE_INFO
+  ///
+  UINT16                      ModuleNameOffset;
+  UINT8                       Attribute;
+  UINT8                       Flags;
+} DEFERRED_PERF_RECORD;
+
+DEFERRED_PERF_RECORD  *mDeferredRecords        = NULL;
+UINT32                mDeferredRecordCount     = 0;
+UINT32                mDeferredRecordMaxCount  = 0;
+CHAR8                 *mDeferredStringPool     = NULL;
+UINTN                 mDeferredStringPoolSize  = 0;
+UINTN                 mDeferredStringCount     = 0;
+UINT16                *mDeferredStringHash     = NULL;
+
+//
+// Cost of CreatePerformanceMeasurement() and of the merge of the deferred records.
+//
+UINT64  mCounterStartValue    = 0;
+UINT64  mCounterEndValue      = 0;
+UINT64  mRecordCallCount      = 0;
+UINT64  mRecordCallTicks      = 0;
+UINT64  mDeferredMergeTicks   = 0;
+UINT64  mDeferredNameCount    = 0;
+UINT64  mDeferredNameTicks    = 0;
+
 //
 // Interfaces for PerformanceMeasurement Protocol.
 //
@@ -402,6 +466,123 @@ AllocateBootPerformanceTable (
   return EFI_SUCCESS;
 }
 
+/**
+  Get the loaded image protocol of an image handle, or of the image that
+  produced the driver binding protocol on a controller handle.
+
+  @param    Handle        Image handle or Controller handle.
+  @param    LoadedImage   On return, the loaded image protocol, or NULL.
+  @param    FileGuid      On return, the FFS file GUID from the file path of the
+                          image, or NULL if the image was not loaded from a FV.
+
+  @retval EFI_SUCCESS     The loaded image protocol is found.
+  @retval other value     The handle has no loaded image.
+**/
+EFI_STATUS
+GetLoadedImageFromHandle (
+  IN  EFI_HANDLE                 Handle,
+  OUT EFI_LOADED_IMAGE_PROTOCOL  **LoadedImage,
+  OUT EFI_GUID                   **FileGuid
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_DRIVER_BINDING_PROTOCOL *DriverBinding;
+
+  *LoadedImage = NULL;
+  *FileGuid    = NULL;
+
+  //
+  // Try Handle as ImageHandle.
+  //
+  Status = gBS->HandleProtocol (
+                Handle,
+                &gEfiLoadedImageProtocolGuid,
+                (VOID**) LoadedImage
+                );
+
+  if (EFI_ERROR (Status)) {
+    //
+    // Try Handle as Controller Handle
+    //
+    Status = gBS->OpenProtocol (
+                  Handle,
+                  &gEfiDriverBindingProtocolGuid,
+                  (VOID **) &DriverBinding,
+                  NULL,
+                  NULL,
+                  EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                  );
+    if (!EFI_ERROR (Status)) {
+      //
+      // Get Image protocol from ImageHandle
+      //
+      Status = gBS->HandleProtocol (
+                    DriverBinding->ImageHandle,
+                    &gEfiLoadedImageProtocolGuid,
+                    (VOID**) LoadedImage
+                    );
+    }
+  }
+
+  if (EFI_ERROR (Status) || *LoadedImage == NULL) {
+    *LoadedImage = NULL;
+    return Status;
+  }
+
+  //
+  // Get Module Guid from DevicePath.
+  //
+  if ((*LoadedImage)->FilePath != NULL &&
+      (*LoadedImage)->FilePath->Type == MEDIA_DEVICE_PATH &&
+      (*LoadedImage)->FilePath->SubType == MEDIA_PIWG_FW_FILE_DP
+     ) {
+    *FileGuid = &((MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *) (*LoadedImage)->FilePath)->FvFileName;
+  }
+  return Status;
+}
+
+/**
+  Get the module name from the FFS UI section of a file in any FV.
+
+  @param    FileGuid      The FFS file GUID of the module.
+  @param    NameString    The ascii string will be filled into it. If not found, it is left unchanged.
+  @param    BufferSize    Size of the input NameString buffer.
+
+  @retval EFI_SUCCESS     Successfully get module name.
+  @retval other value     Module Name can't be got.
+**/
+EFI_STATUS
+GetModuleNameFromFfsFile (
+  IN  CONST EFI_GUID   *FileGuid,
+  OUT CHAR8            *NameString,
+  IN  UINTN            BufferSize
+  )
+{
+  EFI_STATUS                  Status;
+  UINTN                       Index;
+  UINTN                       StringSize;
+  CHAR16                      *StringPtr;
+
+  StringPtr  = NULL;
+  StringSize = 0;
+  Status = GetSectionFromAnyFv (
+            FileGuid,
+            EFI_SECTION_USER_INTERFACE,
+            0,
+            (VOID **) &StringPtr,
+            &StringSize
+            );
+
+  if (!EFI_ERROR (Status)) {
+    for (Index = 0; Index < BufferSize - 1 && StringPtr[Index] != 0; Index++) {
+      NameString[Index] = (CHAR8) StringPtr[Index];
+    }
+    NameString[Index] = 0;
+    FreePool (StringPtr);
+  }
+  return Status;
+}
+
 /**
   Get a human readable module name and module guid for the given image handle.
   If module name can't be found, "" string will return.
@@ -426,17 +607,15 @@ GetModuleInfoFromHandle (
 {
   EFI_STATUS                  Status;
   EFI_LOADED_IMAGE_PROTOCOL   *LoadedImage;
-  EFI_DRIVER_BINDING_PROTOCOL *DriverBinding;
   CHAR8                       *PdbFileName;
   EFI_GUID                    *TempGuid;
+  EFI_GUID                    *FileGuid;
   UINTN                       StartIndex;
   UINTN                       Index;
   INTN                        Count;
   BOOLEAN                     ModuleGuidIsGet;
-  UINTN                       StringSize;
   CHAR16                      *StringPtr;
   EFI_COMPONENT_NAME2_PROTOCOL      *ComponentName2;
-  MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *FvFilePath;
 
   if (NameString == NULL || BufferSize == 0) {
     return EFI_INVALID_PARAMETER;
@@ -468,56 +647,17 @@ GetModuleInfoFromHandle (
   NameString[0] = 0;
 
   if (Handle != NULL) {
-    //
-    // Try Handle as ImageHandle.
-    //
-    Status = gBS->HandleProtocol (
-                  Handle,
-                  &gEfiLoadedImageProtocolGuid,
-                  (VOID**) &LoadedImage
-                  );
-
-    if (EFI_ERROR (Status)) {
-      //
-      // Try Handle as Controller Handle
-      //
-      Status = gBS->OpenProtocol (
-                    Handle,
-                    &gEfiDriverBindingProtocolGuid,
-                    (VOID **) &DriverBinding,
-                    NULL,
-                    NULL,
-                    EFI_OPEN_PROTOCOL_GET_PROTOCOL
-                    );
-      if (!EFI_ERROR (Status)) {
-        //
-        // Get Image protocol from ImageHandle
-        //
-        Status = gBS->HandleProtocol (
-                      DriverBinding->ImageHandle,
-                      &gEfiLoadedImageProtocolGuid,
-                      (VOID**) &LoadedImage
-                      );
-      }
-    }
-  }
-
-  if (!EFI_ERROR (Status) && LoadedImage != NULL) {
-    //
-    // Get Module Guid from DevicePath.
-    //
-    if (LoadedImage->FilePath != NULL &&
-        LoadedImage->FilePath->Type == MEDIA_DEVICE_PATH &&
-        LoadedImage->FilePath->SubType == MEDIA_PIWG_FW_FILE_DP
-       ) {
+    Status = GetLoadedImageFromHandle (Handle, &LoadedImage, &FileGuid);
+    if (FileGuid != NULL) {
       //
       // Determine GUID associated with module logging performance
       //
       ModuleGuidIsGet = TRUE;
-      FvFilePath      = (MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *) LoadedImage->FilePath;
-      TempGuid        = &FvFilePath->FvFileName;
+      TempGuid        = FileGuid;
     }
+  }
 
+  if (!EFI_ERROR (Status) && LoadedImage != NULL) {
     //
     // Method 1 Get Module Name from PDB string.
     //
@@ -589,26 +729,7 @@ GetModuleInfoFromHandle (
     //
     // Method 3 Try to get the image's FFS UI section by image GUID
     //
-    StringPtr  = NULL;
-    StringSize = 0;
-    Status = GetSectionFromAnyFv (
-              TempGuid,
-              EFI_SECTION_USER_INTERFACE,
-              0,
-              (VOID **) &StringPtr,
-              &StringSize
-              );
-
-    if (!EFI_ERROR (Status)) {
-      //
-      // Method 3. Get the name string from FFS UI section
-      //
-      for (Index = 0; Index < BufferSize - 1 && StringPtr[Index] != 0; Index++) {
-        NameString[Index] = (CHAR8) StringPtr[Index];
-      }
-      NameString[Index] = 0;
-      FreePool (StringPtr);
-    }
+    Status = GetModuleNameFromFfsFile (TempGuid, NameString, BufferSize);
   }
 
 Done:
@@ -888,6 +1009,104 @@ GetDeviceInfoFromHandleAndUpdateLength (
   return EFI_UNSUPPORTED;
 }
 
+/**
+  Return the number of performance counter ticks elapsed since a start value.
+
+  @param  StartTicker      The performance counter value at the start.
+
+  @return The number of performance counter ticks elapsed.
+
+**/
+UINT64
+GetElapsedTicks (
+  IN UINT64  StartTicker
+  )
+{
+  UINT64  EndTicker;
+
+  EndTicker = GetPerformanceCounter ();
+  if (mCounterEndValue >= mCounterStartValue) {
+    return EndTicker - StartTicker;
+  }
+  return StartTicker - EndTicker;
+}
+
+/**
+  Get the name of the image a deferred performance record was taken for.
+
+  The image handle is only used if it still refers to an image loaded from the
+  same FFS file, since the image may have been unloaded and its handle reused
+  since the measurement was taken. Otherwise the name comes from the FFS UI
+  section of the file.
+
+  @param CallerIdentifier  - Image handle or controller handle of the measurement.
+  @param FileGuid          - FFS file GUID of the image saved when the measurement was taken.
+  @param ModuleName        - On return, the module name.
+
+**/
+VOID
+GetDeferredModuleName (
+  IN  CONST VOID      *CallerIdentifier,
+  IN  CONST EFI_GUID  *FileGuid,
+  OUT CHAR8           *ModuleName
+  )
+{
+  EFI_LOADED_IMAGE_PROTOCOL   *LoadedImage;
+  EFI_GUID                    *CurrentFileGuid;
+  EFI_GUID                    ModuleGuid;
+  UINT64                      StartTicker;
+
+  StartTicker = 0;
+  DEBUG_CODE_BEGIN ();
+  StartTicker = GetPerformanceCounter ();
+  DEBUG_CODE_END ();
+
+  GetLoadedImageFromHandle ((EFI_HANDLE)CallerIdentifier, &LoadedImage, &CurrentFileGuid);
+  if ((CurrentFileGuid != NULL) && CompareGuid (CurrentFileGuid, FileGuid)) {
+    GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, FPDT_STRING_EVENT_RECORD_NAME_LENGTH, &ModuleGuid);
+  } else {
+    GetModuleNameFromFfsFile (FileGuid, ModuleName, FPDT_STRING_EVENT_RECORD_NAME_LENGTH);
+  }
+
+  DEBUG_CODE_BEGIN ();
+  mDeferredNameCount++;
+  mDeferredNameTicks += GetElapsedTicks (StartTicker);
+  DEBUG_CODE_END ();
+}
+
+/**
+  Get the module name and GUID of a performance record.
+
+  @param CallerIdentifier  - Image handle or pointer to caller ID GUID.
+  @param SavedModuleGuid   - Module GUID saved when the measurement was taken, or NULL
+                             to look the module up from CallerIdentifier.
+  @param SavedModuleName   - Module name saved when the measurement was taken, or NULL.
+                             If only SavedModuleGuid is given, it is the FFS file GUID
+                             of the image and the name is looked up now.
+  @param ModuleName        - On return, the module name.
+  @param ModuleGuid        - On return, the module GUID.
+
+**/
+VOID
+GetRecordModuleInfo (
+  IN  CONST VOID      *CallerIdentifier,
+  IN  CONST EFI_GUID  *SavedModuleGuid,  OPTIONAL
+  IN  CONST CHAR8     *SavedModuleName,  OPTIONAL
+  OUT CHAR8           *ModuleName,
+  OUT EFI_GUID        *ModuleGuid
+  )
+{
+  if (SavedModuleName != NULL) {
+    AsciiStrCpyS (ModuleName, FPDT_STRING_EVENT_RECORD_NAME_LENGTH, SavedModuleName);
+    CopyGuid (ModuleGuid, SavedModuleGuid);
+  } else if (SavedModuleGuid != NULL) {
+    GetDeferredModuleName (CallerIdentifier, SavedModuleGuid, ModuleName);
+    CopyGuid (ModuleGuid, SavedModuleGuid);
+  } else {
+    GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, FPDT_STRING_EVENT_RECORD_NAME_LENGTH, ModuleGuid);
+  }
+}
+
 /**
   Create performance record with event description and a timestamp.
 
@@ -900,6 +1119,10 @@ GetDeviceInfoFromHandleAndUpdateLength (
   @param Attribute         - The attribute of the measurement. According to attribute can create a start
                              record for PERF_START/PERF_START_EX, or a end record for PERF_END/PERF_END_EX,
                              or a general record for other Perf macros.
+  @param SavedModuleGuid   - Module GUID saved when the measurement was taken, or NULL
+                             to look the module up from CallerIdentifier.
+  @param SavedModuleName   - Module name saved when the measurement was taken, or NULL
+                             to look the name up now.
 
   @retval EFI_SUCCESS           - Successfully created performance record.
   @retval EFI_OUT_OF_RESOURCES  - Ran out of space to store the records.
@@ -920,7 +1143,9 @@ InsertFpdtRecord (
   IN       UINT64                      Ticker,
   IN       UINT64                      Address,  OPTIONAL
   IN       UINT16                      PerfId,
-  IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute
+  IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute,
+  IN CONST EFI_GUID                    *SavedModuleGuid,  OPTIONAL
+  IN CONST CHAR8                       *SavedModuleName   OPTIONAL
   )
 {
   EFI_GUID                     ModuleGuid;
@@ -998,7 +1223,7 @@ InsertFpdtRecord (
   switch (PerfId) {
   case MODULE_START_ID:
   case MODULE_END_ID:
-    GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, sizeof (ModuleName), &ModuleGuid);
+    GetRecordModuleInfo (CallerIdentifier, SavedModuleGuid, SavedModuleName, ModuleName, &ModuleGuid);
     StringPtr = ModuleName;
     //
     // Cache the offset of start image start record and use to update the start image end record if needed.
@@ -1031,7 +1256,7 @@ InsertFpdtRecord (
 
   case MODULE_LOADIMAGE_START_ID:
   case MODULE_LOADIMAGE_END_ID:
-    GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, sizeof (ModuleName), &ModuleGuid);
+    GetRecordModuleInfo (CallerIdentifier, SavedModuleGuid, SavedModuleName, ModuleName, &ModuleGuid);
     StringPtr = ModuleName;
     if (PerfId == MODULE_LOADIMAGE_START_ID) {
       mLoadImageCount ++;
@@ -1071,7 +1296,7 @@ InsertFpdtRecord (
   case MODULE_DB_SUPPORT_END_ID:
   case MODULE_DB_STOP_START_ID:
   case MODULE_DB_STOP_END_ID:
-    GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, sizeof (ModuleName), &ModuleGuid);
+    GetRecordModuleInfo (CallerIdentifier, SavedModuleGuid, SavedModuleName, ModuleName, &ModuleGuid);
     StringPtr = ModuleName;
     if (!PcdGetBool (PcdEdkiiFpdtStringRecordEnableOnly)) {
       FpdtRecordPtr.GuidQwordEvent->Header.Type           = FPDT_GUID_QWORD_EVENT_TYPE;
@@ -1085,7 +1310,7 @@ InsertFpdtRecord (
     break;
 
   case MODULE_DB_END_ID:
-    GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, sizeof (ModuleName), &ModuleGuid);
+    GetRecordModuleInfo (CallerIdentifier, SavedModuleGuid, SavedModuleName, ModuleName, &ModuleGuid);
     StringPtr = ModuleName;
     if (!PcdGetBool (PcdEdkiiFpdtStringRecordEnableOnly)) {
       FpdtRecordPtr.GuidQwordStringEvent->Header.Type     = FPDT_GUID_QWORD_STRING_EVENT_TYPE;
@@ -1131,7 +1356,7 @@ InsertFpdtRecord (
   case PERF_INMODULE_END_ID:
   case PERF_CROSSMODULE_START_ID:
   case PERF_CROSSMODULE_END_ID:
-    GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, sizeof (ModuleName), &ModuleGuid);
+    GetRecordModuleInfo (CallerIdentifier, SavedModuleGuid, SavedModuleName, ModuleName, &ModuleGuid);
     if (String != NULL) {
       StringPtr = String;
     } else {
@@ -1153,7 +1378,7 @@ InsertFpdtRecord (
 
   default:
     if (Attribute != PerfEntry) {
-      GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, sizeof (ModuleName), &ModuleGuid);
+      GetRecordModuleInfo (CallerIdentifier, SavedModuleGuid, SavedModuleName, ModuleName, &ModuleGuid);
       if (String != NULL) {
         StringPtr = String;
       } else {
@@ -1244,6 +1469,265 @@ InsertFpdtRecord (
   return EFI_SUCCESS;
 }
 
+/**
+  Intern a string in the string pool of the deferred performance records.
+
+  Only the part of the string that fits in a FPDT record is kept.
+
+  @param  String           Pointer to a Null-terminated ASCII string.
+  @param  StringOffset     On return, the offset of the string in the string pool.
+
+  @retval EFI_SUCCESS           The string is in the string pool.
+  @retval EFI_OUT_OF_RESOURCES  The string pool is full.
+
+**/
+EFI_STATUS
+InternDeferredString (
+  IN  CONST CHAR8  *String,
+  OUT UINT16       *StringOffset
+  )
+{
+  UINTN        Length;
+  UINT32       Hash;
+  UINTN        Index;
+  CHAR8        *Candidate;
+
+  Hash = 2166136261U;
+  for (Length = 0; Length < STRING_SIZE - 1 && String[Length] != 0; Length++) {
+    Hash = (Hash ^ (UINT8) String[Length]) * 16777619U;
+  }
+
+  for (Index = Hash & (DEFERRED_STRING_HASH_SIZE - 1);
+       mDeferredStringHash[Index] != 0;
+       Index = (Index + 1) & (DEFERRED_STRING_HASH_SIZE - 1)) {
+    Candidate = mDeferredStringPool + mDeferredStringHash[Index];
+    if ((AsciiStrnCmp (Candidate, String, Length) == 0) && (Candidate[Length] == 0)) {
+      *StringOffset = mDeferredStringHash[Index];
+      return EFI_SUCCESS;
+    }
+  }
+
+  //
+  // Keep the hash table at most half full.
+  //
+  if ((mDeferredStringPoolSize + Length + 1 > DEFERRED_STRING_POOL_SIZE) ||
+      (mDeferredStringCount >= DEFERRED_STRING_HASH_SIZE / 2)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CopyMem (mDeferredStringPool + mDeferredStringPoolSize, String, Length);
+  mDeferredStringPool[mDeferredStringPoolSize + Length] = 0;
+  mDeferredStringHash[Index] = (UINT16) mDeferredStringPoolSize;
+  *StringOffset = (UINT16) mDeferredStringPoolSize;
+  mDeferredStringPoolSize += Length + 1;
+  mDeferredStringCount++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Merge the deferred performance records into the FPDT records, in the order they
+  were created, and empty the string pool.
+
+**/
+VOID
+MergeDeferredRecords (
+  VOID
+  )
+{
+  UINT32                Index;
+  DEFERRED_PERF_RECORD  *Record;
+  UINT64                StartTicker;
+
+  StartTicker = GetPerformanceCounter ();
+
+  for (Index = 0; Index < mDeferredRecordCount; Index++) {
+    Record = &mDeferredRecords[Index];
+    InsertFpdtRecord (
+      ((Record->Flags & DEFERRED_RECORD_CALLER_GUID) != 0) ? &Record->CallerGuid : Record->CallerIdentifier,
+      ((Record->Flags & DEFERRED_RECORD_GUID) != 0) ? &Record->Guid : NULL,
+      (Record->StringOffset != 0) ? mDeferredStringPool + Record->StringOffset : NULL,
+      Record->Ticker,
+      Record->Address,
+      Record->Identifier,
+      (PERF_MEASUREMENT_ATTRIBUTE) Record->Attribute,
+      ((Record->Flags & (DEFERRED_RECORD_MODULE_INFO | DEFERRED_RECORD_MODULE_FILE)) != 0) ? &Record->ModuleGuid : NULL,
+      ((Record->Flags & DEFERRED_RECORD_MODULE_INFO) != 0) ? mDeferredStringPool + Record->ModuleNameOffset : NULL
+      );
+  }
+  mDeferredRecordCount = 0;
+
+  ZeroMem (mDeferredStringHash, DEFERRED_STRING_HASH_SIZE * sizeof (UINT16));
+  mDeferredStringPoolSize = 1;
+  mDeferredStringCount    = 0;
+
+  mDeferredMergeTicks += GetElapsedTicks (StartTicker);
+}
+
+/**
+  Intern the strings of a deferred performance record in the string pool.
+
+  @param  String            Pointer to a Null-terminated ASCII string, or NULL.
+  @param  ModuleName        Pointer to a Null-terminated ASCII module name, or NULL.
+  @param  StringOffset      On return, the offset of String, 0 if String is NULL.
+  @param  ModuleNameOffset  On return, the offset of ModuleName, 0 if ModuleName is NULL.
+
+  @retval EFI_SUCCESS           The strings are in the string pool.
+  @retval EFI_OUT_OF_RESOURCES  The string pool is full.
+
+**/
+EFI_STATUS
+InternDeferredRecordStrings (
+  IN  CONST CHAR8  *String,      OPTIONAL
+  IN  CONST CHAR8  *ModuleName,  OPTIONAL
+  OUT UINT16       *StringOffset,
+  OUT UINT16       *ModuleNameOffset
+  )
+{
+  EFI_STATUS  Status;
+
+  *StringOffset     = 0;
+  *ModuleNameOffset = 0;
+  if (String != NULL) {
+    Status = InternDeferredString (String, StringOffset);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+  if (ModuleName != NULL) {
+    return InternDeferredString (ModuleName, ModuleNameOffset);
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Save a performance measurement to be merged into the FPDT records later.
+
+  The data that may not be valid any more at merge time is copied: the strings,
+  the GUIDs, and the GUID of the module the caller identifier refers to. The
+  name of an image loaded from a FV is looked up at merge time, from its FFS
+  file GUID; other callers can only be named from their live handle, so they
+  are named now. The time stamp is the raw performance counter value. The
+  driver binding start end records are created right away, because they
+  describe the controller with its current name and device path.
+
+  @param CallerIdentifier  - Image handle or pointer to caller ID GUID.
+  @param Guid              - Pointer to a GUID.
+  @param String            - Pointer to a string describing the measurement.
+  @param Ticker            - 64-bit time stamp.
+  @param Address           - Pointer to a location in memory relevant to the measurement.
+  @param PerfId            - Performance identifier describing the type of measurement.
+  @param Attribute         - The attribute of the measurement.
+
+  @retval EFI_SUCCESS           - Successfully saved or created performance record.
+  @retval EFI_OUT_OF_RESOURCES  - Ran out of space to store the records.
+  @retval EFI_INVALID_PARAMETER - Invalid parameter passed to function - NULL
+                                  pointer or invalid PerfId.
+
+**/
+EFI_STATUS
+DeferFpdtRecord (
+  IN CONST VOID                        *CallerIdentifier,  OPTIONAL
+  IN CONST VOID                        *Guid,    OPTIONAL
+  IN CONST CHAR8                       *String,  OPTIONAL
+  IN       UINT64                      Ticker,
+  IN       UINT64                      Address,  OPTIONAL
+  IN       UINT16                      PerfId,
+  IN       PERF_MEASUREMENT_ATTRIBUTE  Attribute
+  )
+{
+  DEFERRED_PERF_RECORD  *Record;
+  UINT16                StringOffset;
+  UINT16                ModuleNameOffset;
+  UINT16                ProgressId;
+  BOOLEAN               CallerIsGuid;
+  EFI_GUID              ModuleGuid;
+  CHAR8                 ModuleName[FPDT_STRING_EVENT_RECORD_NAME_LENGTH];
+  CHAR8                 *ModuleNamePtr;
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage;
+  EFI_GUID              *FileGuid;
+  EFI_STATUS            Status;
+
+  if (Ticker == 0) {
+    Ticker = GetPerformanceCounter ();
+  }
+
+  ProgressId = PerfId;
+  if ((PerfId == 0) && (Attribute != PerfEntry)) {
+    if (EFI_ERROR (GetFpdtRecordId (Attribute, CallerIdentifier, String, &ProgressId))) {
+      ProgressId = 0;
+    }
+  }
+  if ((ProgressId == MODULE_DB_END_ID) && (Address != 0)) {
+    MergeDeferredRecords ();
+    return InsertFpdtRecord (CallerIdentifier, Guid, String, Ticker, Address, PerfId, Attribute, NULL, NULL);
+  }
+
+  //
+  // The caller identifier of the event and callback records is a GUID. Any other
+  // caller identifier is resolved to a module GUID now, as the handle may be gone
+  // or reused at merge time. Only callers that are not images loaded from a FV
+  // are named now, because they cannot be named from a GUID at merge time.
+  //
+  CallerIsGuid = (BOOLEAN) ((CallerIdentifier != NULL) &&
+                            ((PerfId == PERF_EVENTSIGNAL_START_ID) || (PerfId == PERF_EVENTSIGNAL_END_ID) ||
+                             (PerfId == PERF_CALLBACK_START_ID) || (PerfId == PERF_CALLBACK_END_ID)));
+  ModuleNamePtr = NULL;
+  FileGuid      = NULL;
+  if (!CallerIsGuid) {
+    GetLoadedImageFromHandle ((EFI_HANDLE)CallerIdentifier, &LoadedImage, &FileGuid);
+    if (FileGuid != NULL) {
+      CopyGuid (&ModuleGuid, FileGuid);
+    } else {
+      ZeroMem (ModuleName, sizeof (ModuleName));
+      GetModuleInfoFromHandle ((EFI_HANDLE)CallerIdentifier, ModuleName, sizeof (ModuleName), &ModuleGuid);
+      ModuleNamePtr = ModuleName;
+    }
+  }
+
+  if (mDeferredRecordCount == mDeferredRecordMaxCount) {
+    MergeDeferredRecords ();
+  }
+
+  Status = InternDeferredRecordStrings (String, ModuleNamePtr, &StringOffset, &ModuleNameOffset);
+  if (EFI_ERROR (Status)) {
+    //
+    // The string pool is full, merging the records empties it.
+    //
+    MergeDeferredRecords ();
+    Status = InternDeferredRecordStrings (String, ModuleNamePtr, &StringOffset, &ModuleNameOffset);
+    if (EFI_ERROR (Status)) {
+      return InsertFpdtRecord (CallerIdentifier, Guid, String, Ticker, Address, PerfId, Attribute, NULL, NULL);
+    }
+  }
+
+  Record = &mDeferredRecords[mDeferredRecordCount++];
+  Record->Ticker           = Ticker;
+  Record->CallerIdentifier = CallerIdentifier;
+  Record->Address          = Address;
+  Record->Identifier       = PerfId;
+  Record->StringOffset     = StringOffset;
+  Record->ModuleNameOffset = ModuleNameOffset;
+  Record->Attribute        = (UINT8) Attribute;
+  Record->Flags            = 0;
+
+  if (CallerIsGuid) {
+    CopyGuid (&Record->CallerGuid, CallerIdentifier);
+    Record->Flags |= DEFERRED_RECORD_CALLER_GUID;
+  } else if (FileGuid != NULL) {
+    CopyGuid (&Record->ModuleGuid, &ModuleGuid);
+    Record->Flags |= DEFERRED_RECORD_MODULE_FILE;
+  } else {
+    CopyGuid (&Record->ModuleGuid, &ModuleGuid);
+    Record->Flags |= DEFERRED_RECORD_MODULE_INFO;
+  }
+  if (Guid != NULL) {
+    CopyGuid (&Record->Guid, Guid);
+    Record->Flags |= DEFERRED_RECORD_GUID;
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Dumps all the PEI performance.
 
@@ -1316,6 +1800,28 @@ ReportFpdtRecordBuffer (
   UINT64          BPDTAddr;
 
   if (!mFpdtBufferIsReported) {
+    if (mDeferredRecords != NULL) {
+      mLockInsertRecord = TRUE;
+      MergeDeferredRecords ();
+      mLockInsertRecord = FALSE;
+      FreePool (mDeferredRecords);
+      mDeferredRecords = NULL;
+    }
+
+    DEBUG_CODE_BEGIN ();
+    if (mRecordCallCount != 0) {
+      DEBUG ((
+        DEBUG_INFO,
+        "DxeCorePerformanceLib: %ld records, %ld ns per record, %ld ns to merge deferred records, %ld of it to name %ld of them\n",
+        mRecordCallCount,
+        DivU64x64Remainder (GetTimeInNanoSecond (mRecordCallTicks), mRecordCallCount, NULL),
+        GetTimeInNanoSecond (mDeferredMergeTicks),
+        GetTimeInNanoSecond (mDeferredNameTicks),
+        mDeferredNameCount
+        ));
+    }
+    DEBUG_CODE_END ();
+
     Status = AllocateBootPerformanceTable ();
     if (!EFI_ERROR(Status)) {
       BPDTAddr = (UINT64)(UINTN)mAcpiBootPerformanceTable;
@@ -1373,6 +1879,30 @@ DxeCorePerformanceLibConstructor (
   //
   InternalGetPeiPerformance (GetHobList());
 
+  GetPerformanceCounterProperties (&mCounterStartValue, &mCounterEndValue);
+
+  //
+  // Allocate the buffer of the deferred performance records, followed by the
+  // string hash table and the string pool. Without it, the records are created
+  // immediately.
+  //
+  mDeferredRecordMaxCount = PcdGet32 (PcdEdkiiFpdtDeferredRecordCount);
+  if (mDeferredRecordMaxCount != 0) {
+    mDeferredRecords = AllocateZeroPool (
+                         mDeferredRecordMaxCount * sizeof (DEFERRED_PERF_RECORD) +
+                         DEFERRED_STRING_HASH_SIZE * sizeof (UINT16) +
+                         DEFERRED_STRING_POOL_SIZE
+                         );
+    if (mDeferredRecords != NULL) {
+      mDeferredStringHash = (UINT16 *) (mDeferredRecords + mDeferredRecordMaxCount);
+      mDeferredStringPool = (CHAR8 *) (mDeferredStringHash + DEFERRED_STRING_HASH_SIZE);
+      //
+      // Offset 0 of the string pool stands for the NULL string.
+      //
+      mDeferredStringPoolSize = 1;
+    }
+  }
+
   //
   // Install the protocol interfaces for DXE performance library instance.
   //
@@ -1448,6 +1978,7 @@ CreatePerformanceMeasurement (
   )
 {
   EFI_STATUS   Status;
+  UINT64       StartTicker;
 
   Status = EFI_SUCCESS;
 
@@ -1456,7 +1987,21 @@ CreatePerformanceMeasurement (
   }
   mLockInsertRecord = TRUE;
 
-  Status = InsertFpdtRecord (CallerIdentifier, Guid, String, TimeStamp, Address, (UINT16)Identifier, Attribute);
+  StartTicker = 0;
+  DEBUG_CODE_BEGIN ();
+  StartTicker = GetPerformanceCounter ();
+  DEBUG_CODE_END ();
+
+  if (mDeferredRecords != NULL) {
+    Status = DeferFpdtRecord (CallerIdentifier, Guid, String, TimeStamp, Address, (UINT16)Identifier, Attribute);
+  } else {
+    Status = InsertFpdtRecord (CallerIdentifier, Guid, String, TimeStamp, Address, (UINT16)Identifier, Attribute, NULL, NULL);
+  }
+
+  DEBUG_CODE_BEGIN ();
+  mRecordCallCount++;
+  mRecordCallTicks += GetElapsedTicks (StartTicker);
+  DEBUG_CODE_END ();
 
   mLockInsertRecord = FALSE;
 
@@ -1,13 +1,47 @@
 /** @file
   Interpret and execute the S3 data in S3 boot script.
 
-  Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 #include "InternalBootScriptLib.h"
 
+//
+// Statistics slots for the library specific opcodes, after the PI ones.
+//
+#define S3_BOOT_SCRIPT_STATISTICS_LABEL      (EFI_BOOT_SCRIPT_PCI_CONFIG2_POLL_OPCODE + 1)
+#define S3_BOOT_SCRIPT_STATISTICS_WRITE_RUN  (EFI_BOOT_SCRIPT_PCI_CONFIG2_POLL_OPCODE + 2)
+#define S3_BOOT_SCRIPT_STATISTICS_MAX        (EFI_BOOT_SCRIPT_PCI_CONFIG2_POLL_OPCODE + 3)
+
+typedef struct {
+  UINTN   Count;
+  UINT64  Ticks;
+} S3_BOOT_SCRIPT_OPCODE_STATISTICS;
+
+GLOBAL_REMOVE_IF_UNREFERENCED CHAR8 *mS3BootScriptOpCodeName[S3_BOOT_SCRIPT_STATISTICS_MAX] = {
+  "IO_WRITE",
+  "IO_READ_WRITE",
+  "MEM_WRITE",
+  "MEM_READ_WRITE",
+  "PCI_CONFIG_WRITE",
+  "PCI_CONFIG_READ_WRITE",
+  "SMBUS_EXECUTE",
+  "STALL",
+  "DISPATCH",
+  "DISPATCH_2",
+  "INFORMATION",
+  "PCI_CONFIG2_WRITE",
+  "PCI_CONFIG2_READ_WRITE",
+  "IO_POLL",
+  "MEM_POLL",
+  "PCI_CONFIG_POLL",
+  "PCI_CONFIG2_POLL",
+  "LABEL",
+  "WRITE_RUN"
+};
+
 /**
   Executes an SMBus operation to an SMBus controller. Returns when either the command has been
   executed or an error is encountered in doing the operation.
@@ -1585,6 +1619,84 @@ BootScriptPciCfg2Poll (
 
 }
 
+/**
+  Computes the number of performance counter ticks between two readings,
+  taking into account that the counter may have wrapped around once between
+  them.
+
+  @param  StartTicks      The counter value at the start of the interval.
+  @param  EndTicks        The counter value at the end of the interval.
+  @param  CounterStart    The first value the counter takes, as returned by
+                          GetPerformanceCounterProperties().
+  @param  CounterEnd      The last value the counter takes, as returned by
+                          GetPerformanceCounterProperties().
+
+  @return The number of ticks elapsed.
+
+**/
+UINT64
+GetS3BootScriptElapsedTicks (
+  IN UINT64  StartTicks,
+  IN UINT64  EndTicks,
+  IN UINT64  CounterStart,
+  IN UINT64  CounterEnd
+  )
+{
+  if (CounterEnd >= CounterStart) {
+    //
+    // The counter counts up from CounterStart to CounterEnd.
+    //
+    if (EndTicks >= StartTicks) {
+      return EndTicks - StartTicks;
+    }
+    return (CounterEnd - StartTicks) + (EndTicks - CounterStart) + 1;
+  }
+
+  //
+  // The counter counts down from CounterStart to CounterEnd.
+  //
+  if (StartTicks >= EndTicks) {
+    return StartTicks - EndTicks;
+  }
+  return (StartTicks - CounterEnd) + (CounterStart - EndTicks) + 1;
+}
+
+/**
+  Reports the time spent in each opcode during the S3 boot script execution.
+
+  @param  Statistics      The per opcode statistics.
+  @param  RunWriteCount   The number of writes performed by write runs.
+
+**/
+VOID
+DumpS3BootScriptStatistics (
+  IN S3_BOOT_SCRIPT_OPCODE_STATISTICS  *Statistics,
+  IN UINTN                             RunWriteCount
+  )
+{
+  UINTN   Index;
+  UINT64  TotalTicks;
+
+  TotalTicks = 0;
+  DEBUG ((EFI_D_INFO, "S3BootScript replay breakdown:\n"));
+  DEBUG ((EFI_D_INFO, "  OpCode                     Count     Time(us)\n"));
+  for (Index = 0; Index < S3_BOOT_SCRIPT_STATISTICS_MAX; Index++) {
+    if (Statistics[Index].Count == 0) {
+      continue;
+    }
+    TotalTicks += Statistics[Index].Ticks;
+    DEBUG ((
+      EFI_D_INFO,
+      "  %-24a %8Lu %12Lu\n",
+      mS3BootScriptOpCodeName[Index],
+      (UINT64) Statistics[Index].Count,
+      DivU64x32 (GetTimeInNanoSecond (Statistics[Index].Ticks), 1000)
+      ));
+  }
+  DEBUG ((EFI_D_INFO, "  Writes in write runs: %Lu\n", (UINT64) RunWriteCount));
+  DEBUG ((EFI_D_INFO, "  Total: %Lu us\n", DivU64x32 (GetTimeInNanoSecond (TotalTicks), 1000)));
+}
+
 /**
   Executes the S3 boot script table.
 
@@ -1606,6 +1718,13 @@ S3BootScriptExecute (
   UINT64                OrMask;
   EFI_BOOT_SCRIPT_COMMON_HEADER  ScriptHeader;
   EFI_BOOT_SCRIPT_TABLE_HEADER   TableHeader;
+  S3_BOOT_SCRIPT_OPCODE_STATISTICS  Statistics[S3_BOOT_SCRIPT_STATISTICS_MAX];
+  UINTN                 StatisticsIndex;
+  UINTN                 RunWriteCount;
+  UINT64                StartTicks;
+  UINT64                EndTicks;
+  UINT64                CounterStart;
+  UINT64                CounterEnd;
   Script = mS3BootScriptTablePtr->TableBase;
   if (Script != 0) {
     CopyMem ((VOID*)&TableHeader, Script, sizeof(EFI_BOOT_SCRIPT_TABLE_HEADER));
@@ -1626,6 +1745,9 @@ S3BootScriptExecute (
   Status        = EFI_SUCCESS;
   AndMask       = 0;
   OrMask        = 0;
+  RunWriteCount = 0;
+  ZeroMem (Statistics, sizeof (Statistics));
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
 
   DEBUG ((EFI_D_INFO, "TableHeader.Version - 0x%04x\n", (UINTN)TableHeader.Version));
   DEBUG ((EFI_D_INFO, "TableHeader.TableLength - 0x%08x\n", (UINTN)TableLength));
@@ -1634,6 +1756,7 @@ S3BootScriptExecute (
     DEBUG ((EFI_D_INFO, "ExecuteBootScript - %08x\n", (UINTN)Script));
 
     CopyMem ((VOID*)&ScriptHeader, Script, sizeof(EFI_BOOT_SCRIPT_COMMON_HEADER));
+    StartTicks = GetPerformanceCounter ();
     switch (ScriptHeader.OpCode) {
 
     case EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE:
@@ -1701,6 +1824,7 @@ S3BootScriptExecute (
 
     case S3_BOOT_SCRIPT_LIB_TERMINATE_OPCODE:
       DEBUG ((EFI_D_INFO, "S3_BOOT_SCRIPT_LIB_TERMINATE_OPCODE\n"));
+      DumpS3BootScriptStatistics (Statistics, RunWriteCount);
       DEBUG ((EFI_D_INFO, "S3BootScriptDone - %r\n", EFI_SUCCESS));
       return EFI_SUCCESS;
 
@@ -1756,12 +1880,33 @@ S3BootScriptExecute (
       DEBUG ((EFI_D_INFO, "S3_BOOT_SCRIPT_LIB_LABEL_OPCODE\n"));
       BootScriptExecuteLabel (Script);
       break;
+
+    case S3_BOOT_SCRIPT_LIB_WRITE_RUN_OPCODE:
+      //
+      // Write runs are counted in the statistics rather than traced one by
+      // one, since they are the bulk of the script.
+      //
+      Status = BootScriptExecuteWriteRun (Script, &RunWriteCount);
+      break;
+
     default:
       DEBUG ((EFI_D_INFO, "S3BootScriptDone - %r\n", EFI_UNSUPPORTED));
       return EFI_UNSUPPORTED;
     }
 
+    EndTicks = GetPerformanceCounter ();
+    if (ScriptHeader.OpCode <= EFI_BOOT_SCRIPT_PCI_CONFIG2_POLL_OPCODE) {
+      StatisticsIndex = ScriptHeader.OpCode;
+    } else if (ScriptHeader.OpCode == S3_BOOT_SCRIPT_LIB_LABEL_OPCODE) {
+      StatisticsIndex = S3_BOOT_SCRIPT_STATISTICS_LABEL;
+    } else {
+      StatisticsIndex = S3_BOOT_SCRIPT_STATISTICS_WRITE_RUN;
+    }
+    Statistics[StatisticsIndex].Count++;
+    Statistics[StatisticsIndex].Ticks += GetS3BootScriptElapsedTicks (StartTicks, EndTicks, CounterStart, CounterEnd);
+
     if (EFI_ERROR (Status)) {
+      DumpS3BootScriptStatistics (Statistics, RunWriteCount);
       DEBUG ((EFI_D_INFO, "S3BootScriptDone - %r\n", Status));
       return Status;
     }
@@ -1769,6 +1914,7 @@ S3BootScriptExecute (
     Script  = Script + ScriptHeader.Length;
   }
 
+  DumpS3BootScriptStatistics (Statistics, RunWriteCount);
   DEBUG ((EFI_D_INFO, "S3BootScriptDone - %r\n", Status));
 
   return Status;
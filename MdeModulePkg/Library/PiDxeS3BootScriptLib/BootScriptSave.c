@@ -251,6 +251,9 @@ S3BootScriptEventCallBack (
     // or else, that will impact the performance. However, after SmmReadyToLock, we should append terminate
     // node on every add to boot script table.
     //
+    if (PcdGetBool (PcdS3BootScriptCompactTable)) {
+      S3BootScriptCompactTable ();
+    }
     S3BootScriptInternalCloseTable ();
     mS3BootScriptTablePtr->SmmLocked = TRUE;
 
@@ -0,0 +1,347 @@
+/** @file
+  Compaction of the boot time S3 boot script table into write runs, and
+  execution of the write runs.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+#include "InternalBootScriptLib.h"
+
+/**
+  Checks if a boot script record is a single I/O, memory or PCI configuration write
+  that can be coalesced into a write run, and gets its target.
+
+  Writes that would fail at S3 resume (invalid width, unaligned or out of range
+  address) are not coalesced, so they keep failing the same way.
+
+  @param Script   Pointer to the boot script record.
+  @param Space    On output, the address space of the write.
+  @param Width    On output, the width of the write.
+  @param Address  On output, the address of the write. For PCI, it is the PCI
+                  Segment Library address.
+  @param Data     On output, pointer to the data of the write.
+
+  @retval TRUE    The record can be coalesced into a write run.
+  @retval FALSE   The record must be kept as it is.
+**/
+BOOLEAN
+S3BootScriptGetSingleWrite (
+  IN  UINT8                     *Script,
+  OUT UINT8                     *Space,
+  OUT S3_BOOT_SCRIPT_LIB_WIDTH  *Width,
+  OUT UINT64                    *Address,
+  OUT UINT8                     **Data
+  )
+{
+  EFI_BOOT_SCRIPT_COMMON_HEADER      ScriptHeader;
+  EFI_BOOT_SCRIPT_IO_WRITE           IoWrite;
+  EFI_BOOT_SCRIPT_MEM_WRITE          MemWrite;
+  EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE   PciCfgWrite;
+  EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE  PciCfg2Write;
+  UINTN                              HeaderSize;
+  UINT32                             Count;
+  UINTN                              WidthInByte;
+
+  CopyMem ((VOID*)&ScriptHeader, Script, sizeof (EFI_BOOT_SCRIPT_COMMON_HEADER));
+  switch (ScriptHeader.OpCode) {
+  case EFI_BOOT_SCRIPT_IO_WRITE_OPCODE:
+    CopyMem ((VOID*)&IoWrite, Script, sizeof (EFI_BOOT_SCRIPT_IO_WRITE));
+    HeaderSize = sizeof (EFI_BOOT_SCRIPT_IO_WRITE);
+    Count      = IoWrite.Count;
+    *Address   = IoWrite.Address;
+    *Space     = S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO;
+    break;
+
+  case EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE:
+    CopyMem ((VOID*)&MemWrite, Script, sizeof (EFI_BOOT_SCRIPT_MEM_WRITE));
+    HeaderSize = sizeof (EFI_BOOT_SCRIPT_MEM_WRITE);
+    Count      = MemWrite.Count;
+    *Address   = MemWrite.Address;
+    *Space     = S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM;
+    break;
+
+  case EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE:
+    CopyMem ((VOID*)&PciCfgWrite, Script, sizeof (EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE));
+    HeaderSize = sizeof (EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE);
+    Count      = PciCfgWrite.Count;
+    *Address   = PCI_ADDRESS_ENCODE (0, PciCfgWrite.Address);
+    *Space     = S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI;
+    break;
+
+  case EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE:
+    CopyMem ((VOID*)&PciCfg2Write, Script, sizeof (EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE));
+    HeaderSize = sizeof (EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE);
+    Count      = PciCfg2Write.Count;
+    *Address   = PCI_ADDRESS_ENCODE (PciCfg2Write.Segment, PciCfg2Write.Address);
+    *Space     = S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI;
+    break;
+
+  default:
+    return FALSE;
+  }
+
+  //
+  // Only plain writes are coalesced, FIFO and fill writes are kept as they are.
+  // 64-bit PCI configuration writes are not supported by the executor.
+  //
+  *Width = (S3_BOOT_SCRIPT_LIB_WIDTH) ScriptHeader.Width;
+  if (Count != 1 || ScriptHeader.Width > S3BootScriptWidthUint64) {
+    return FALSE;
+  }
+  if (*Space == S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI && *Width == S3BootScriptWidthUint64) {
+    return FALSE;
+  }
+
+  WidthInByte = (UINTN) (0x01 << (*Width & 0x03));
+  if (ScriptHeader.Length != HeaderSize + WidthInByte) {
+    return FALSE;
+  }
+  if ((*Address & (WidthInByte - 1)) != 0) {
+    return FALSE;
+  }
+  if (*Space == S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO && *Address > MAX_IO_ADDRESS) {
+    return FALSE;
+  }
+
+  *Data = Script + HeaderSize;
+  return TRUE;
+}
+
+/**
+  Compacts the boot time boot script table in place.
+
+  Consecutive single I/O, memory and PCI configuration writes of the same width
+  are coalesced into S3_BOOT_SCRIPT_LIB_WRITE_RUN records with delta-encoded
+  addresses. All the other records, including labels, are kept in order.
+  Each record is at least as large as the write run entry replacing it, so the
+  compacted table never grows and can be written over the original one.
+
+**/
+VOID
+S3BootScriptCompactTable (
+  VOID
+  )
+{
+  UINT8                               *TableBase;
+  UINT8                               *Source;
+  UINT8                               *Destination;
+  UINT8                               *End;
+  UINT8                               *Run;
+  S3_BOOT_SCRIPT_LIB_WRITE_RUN        RunHeader;
+  S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY  RunEntry;
+  EFI_BOOT_SCRIPT_GENERIC_HEADER      ScriptHeader;
+  UINT8                               Space;
+  S3_BOOT_SCRIPT_LIB_WIDTH            Width;
+  UINT64                              Address;
+  UINT64                              LastAddress;
+  UINT8                               *DataPtr;
+  UINT64                              Data;
+  UINTN                               WidthInByte;
+  UINTN                               EntryLength;
+  UINT32                              OriginalLength;
+  UINTN                               RunCount;
+  UINTN                               WriteCount;
+
+  TableBase = mS3BootScriptTablePtr->TableBase;
+  if (TableBase == NULL) {
+    return;
+  }
+
+  OriginalLength = mS3BootScriptTablePtr->TableLength;
+  Source         = TableBase + sizeof (EFI_BOOT_SCRIPT_TABLE_HEADER);
+  End            = TableBase + OriginalLength;
+  Destination    = Source;
+  Run            = NULL;
+  LastAddress    = 0;
+  RunCount       = 0;
+  WriteCount     = 0;
+  ZeroMem (&RunHeader, sizeof (RunHeader));
+
+  while (Source < End) {
+    CopyMem ((VOID*)&ScriptHeader, Source, sizeof (EFI_BOOT_SCRIPT_GENERIC_HEADER));
+    if (ScriptHeader.Length < sizeof (EFI_BOOT_SCRIPT_GENERIC_HEADER) ||
+        ScriptHeader.Length > (UINTN) (End - Source)) {
+      //
+      // Corrupted table, keep the rest of it as it is.
+      //
+      ASSERT (FALSE);
+      break;
+    }
+
+    if (!S3BootScriptGetSingleWrite (Source, &Space, &Width, &Address, &DataPtr)) {
+      if (Run != NULL) {
+        CopyMem (Run, &RunHeader, sizeof (RunHeader));
+        Run = NULL;
+      }
+      CopyMem (Destination, Source, ScriptHeader.Length);
+      Destination += ScriptHeader.Length;
+      Source      += ScriptHeader.Length;
+      continue;
+    }
+
+    //
+    // Take the data before the record may be overwritten.
+    //
+    WidthInByte = (UINTN) (0x01 << (Width & 0x03));
+    EntryLength = sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY) + WidthInByte;
+    Data        = 0;
+    CopyMem (&Data, DataPtr, WidthInByte);
+    Source     += ScriptHeader.Length;
+
+    if (Run != NULL &&
+        RunHeader.Space == Space &&
+        RunHeader.Width == (UINT8) Width &&
+        RunHeader.Count < MAX_UINT8 &&
+        RunHeader.Length + EntryLength <= MAX_UINT8 &&
+        ((Address >= LastAddress) ? (Address - LastAddress <= MAX_INT16) :
+                                    (LastAddress - Address <= (UINT64) MAX_INT16 + 1))) {
+      RunEntry.Delta = (INT16) (Address - LastAddress);
+    } else {
+      //
+      // Start a new write run.
+      //
+      if (Run != NULL) {
+        CopyMem (Run, &RunHeader, sizeof (RunHeader));
+      }
+      Run               = Destination;
+      RunHeader.OpCode  = S3_BOOT_SCRIPT_LIB_WRITE_RUN_OPCODE;
+      RunHeader.Length  = (UINT8) sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN);
+      RunHeader.Space   = Space;
+      RunHeader.Width   = (UINT8) Width;
+      RunHeader.Count   = 0;
+      RunHeader.Address = Address;
+      RunEntry.Delta    = 0;
+      Destination      += sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN);
+      RunCount++;
+    }
+
+    CopyMem (Destination, &RunEntry, sizeof (RunEntry));
+    CopyMem (Destination + sizeof (RunEntry), &Data, WidthInByte);
+    Destination      += EntryLength;
+    RunHeader.Count  += 1;
+    RunHeader.Length += (UINT8) EntryLength;
+    LastAddress       = Address;
+    WriteCount++;
+  }
+
+  if (Run != NULL) {
+    CopyMem (Run, &RunHeader, sizeof (RunHeader));
+  }
+
+  if (Source < End) {
+    CopyMem (Destination, Source, End - Source);
+    Destination += End - Source;
+  }
+
+  mS3BootScriptTablePtr->TableLength = (UINT32) (Destination - TableBase);
+  DEBUG ((
+    DEBUG_INFO,
+    "S3BootScriptCompactTable - 0x%x -> 0x%x bytes, %d writes in %d runs\n",
+    OriginalLength,
+    mS3BootScriptTablePtr->TableLength,
+    WriteCount,
+    RunCount
+    ));
+}
+
+/**
+  Interprete the boot script node with S3_BOOT_SCRIPT_LIB_WRITE_RUN OP code.
+
+  The writes of the run are issued back to back through IoLib or PciSegmentLib,
+  without the per-access stride calculation and trace of the I/O, memory and
+  PCI configuration write opcodes they were coalesced from.
+
+  @param  Script          The pointer of typed node in boot script table
+  @param  WriteCount      Incremented by the number of writes performed.
+
+  @retval EFI_SUCCESS            The operation was executed successfully
+  @retval EFI_INVALID_PARAMETER  The node is malformed.
+
+**/
+EFI_STATUS
+BootScriptExecuteWriteRun (
+  IN     UINT8    *Script,
+  IN OUT UINTN    *WriteCount
+  )
+{
+  S3_BOOT_SCRIPT_LIB_WRITE_RUN  WriteRun;
+  UINT8                         *Entry;
+  UINT8                         *Data;
+  UINTN                         EntryLength;
+  UINTN                         Index;
+  UINT64                        Address;
+
+  CopyMem ((VOID*)&WriteRun, (VOID*)Script, sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN));
+  if (WriteRun.Width > S3BootScriptWidthUint64 ||
+      WriteRun.Space > S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI ||
+      (WriteRun.Space == S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI && WriteRun.Width == S3BootScriptWidthUint64)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  EntryLength = sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY) + (UINTN) (0x01 << WriteRun.Width);
+  if (WriteRun.Length != sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN) + WriteRun.Count * EntryLength) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Address = WriteRun.Address;
+  Entry   = Script + sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN);
+  for (Index = 0; Index < WriteRun.Count; Index++, Entry += EntryLength) {
+    Address += (UINT64) (INT64) (INT16) ReadUnaligned16 ((UINT16 *) Entry);
+    Data     = Entry + sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY);
+
+    switch (WriteRun.Space) {
+    case S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO:
+      switch (WriteRun.Width) {
+      case S3BootScriptWidthUint8:
+        IoWrite8 ((UINTN) Address, *Data);
+        break;
+      case S3BootScriptWidthUint16:
+        IoWrite16 ((UINTN) Address, ReadUnaligned16 ((UINT16 *) Data));
+        break;
+      case S3BootScriptWidthUint32:
+        IoWrite32 ((UINTN) Address, ReadUnaligned32 ((UINT32 *) Data));
+        break;
+      default:
+        IoWrite64 ((UINTN) Address, ReadUnaligned64 ((UINT64 *) Data));
+        break;
+      }
+      break;
+
+    case S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM:
+      switch (WriteRun.Width) {
+      case S3BootScriptWidthUint8:
+        MmioWrite8 ((UINTN) Address, *Data);
+        break;
+      case S3BootScriptWidthUint16:
+        MmioWrite16 ((UINTN) Address, ReadUnaligned16 ((UINT16 *) Data));
+        break;
+      case S3BootScriptWidthUint32:
+        MmioWrite32 ((UINTN) Address, ReadUnaligned32 ((UINT32 *) Data));
+        break;
+      default:
+        MmioWrite64 ((UINTN) Address, ReadUnaligned64 ((UINT64 *) Data));
+        break;
+      }
+      break;
+
+    default:
+      switch (WriteRun.Width) {
+      case S3BootScriptWidthUint8:
+        PciSegmentWrite8 (Address, *Data);
+        break;
+      case S3BootScriptWidthUint16:
+        PciSegmentWrite16 (Address, ReadUnaligned16 ((UINT16 *) Data));
+        break;
+      default:
+        PciSegmentWrite32 (Address, ReadUnaligned32 ((UINT32 *) Data));
+        break;
+      }
+      break;
+    }
+  }
+
+  *WriteCount += WriteRun.Count;
+  return EFI_SUCCESS;
+}
@@ -2,7 +2,7 @@
   Support for S3 boot script lib. This file defined some internal macro and internal
   data structure
 
-  Copyright (c) 2006 - 2016, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -91,6 +91,42 @@ extern SCRIPT_TABLE_PRIVATE_DATA       *mS3BootScriptTablePtr;
 //
 #define  S3_BOOT_SCRIPT_LIB_LABEL_OPCODE    0xFE
 
+//
+// Define Opcode for the write run which is implementation specific. It is only
+// produced when the boot time table is compacted at SmmReadyToLock.
+//
+#define  S3_BOOT_SCRIPT_LIB_WRITE_RUN_OPCODE    0xFD
+
+//
+// Address spaces of a write run.
+//
+#define  S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO        0x00
+#define  S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM       0x01
+#define  S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI       0x02
+
+#pragma pack(1)
+//
+// A write run coalesces consecutive single writes of the same width to the same
+// address space. It is followed by Count entries of S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY,
+// each followed by (1 << Width) bytes of data. The address of an entry is the
+// address of the previous entry (or Address for the first one) plus Delta.
+// For PCI, the addresses are PCI Segment Library addresses.
+//
+typedef struct {
+  UINT16  OpCode;
+  UINT8   Length;
+  UINT8   Space;
+  UINT8   Width;
+  UINT8   Count;
+  UINT64  Address;
+} S3_BOOT_SCRIPT_LIB_WRITE_RUN;
+
+typedef struct {
+  INT16   Delta;
+//UINT8   Data[1 << Width];
+} S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY;
+#pragma pack()
+
 ///
 /// The opcode indicate the start of the boot script table.
 ///
@@ -100,6 +136,34 @@ extern SCRIPT_TABLE_PRIVATE_DATA       *mS3BootScriptTablePtr;
 ///
 #define S3_BOOT_SCRIPT_LIB_TERMINATE_OPCODE              0xFF
 
+/**
+  Compacts the boot time boot script table in place.
+
+  Consecutive single I/O, memory and PCI configuration writes of the same width
+  are coalesced into S3_BOOT_SCRIPT_LIB_WRITE_RUN records with delta-encoded
+  addresses. All the other records, including labels, are kept in order.
+
+**/
+VOID
+S3BootScriptCompactTable (
+  VOID
+  );
+
+/**
+  Interprete the boot script node with S3_BOOT_SCRIPT_LIB_WRITE_RUN OP code.
+
+  @param  Script          The pointer of typed node in boot script table
+  @param  WriteCount      Incremented by the number of writes performed.
+
+  @retval EFI_SUCCESS            The operation was executed successfully
+  @retval EFI_INVALID_PARAMETER  The node is malformed.
+
+**/
+EFI_STATUS
+BootScriptExecuteWriteRun (
+  IN     UINT8    *Script,
+  IN OUT UINTN    *WriteCount
+  );
 
 #endif //__INTERNAL_BOOT_SCRIPT_LIB__
 
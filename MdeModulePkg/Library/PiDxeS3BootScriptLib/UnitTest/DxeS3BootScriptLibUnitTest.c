@@ -0,0 +1,719 @@
+/** @file
+  Unit tests of the compaction of the S3 boot script table into write runs:
+  the write runs must replay the same writes, in the same order, as the
+  records they replace.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../InternalBootScriptLib.h"
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestRandomLib.h>
+
+#define UNIT_TEST_APP_NAME        "DxeS3BootScriptLib Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+#define TEST_TABLE_SIZE           SIZE_256KB
+#define TEST_MAX_EVENTS           0x4000
+#define TEST_RANDOM_TABLES        16
+#define TEST_RANDOM_RECORDS       0x800
+
+//
+// Address space of a logged event that is a record kept as it is.
+//
+#define TEST_EVENT_KEPT_RECORD    0xFF
+
+///
+/// A write performed by the replay, or a record kept by the compaction.
+///
+typedef struct {
+  UINT8   Space;
+  UINT8   Width;
+  UINT64  Address;
+  UINT64  Data;
+} TEST_EVENT;
+
+typedef struct {
+  TEST_EVENT  Events[TEST_MAX_EVENTS];
+  UINTN       Count;
+} TEST_EVENT_LOG;
+
+SCRIPT_TABLE_PRIVATE_DATA  mTablePrivate;
+SCRIPT_TABLE_PRIVATE_DATA  *mS3BootScriptTablePtr = &mTablePrivate;
+
+//
+// The table being built and its copy before compaction. The events expected
+// from the replay are logged while the table is built.
+//
+UINT8           *mTable;
+UINT8           *mOriginalTable;
+UINTN           mKeptOffset[TEST_MAX_EVENTS];
+UINTN           mKeptCount;
+TEST_EVENT_LOG  mExpected;
+TEST_EVENT_LOG  mReplayed;
+
+/**
+  Adds an event to a log.
+
+  @param[in]  Log      The log.
+  @param[in]  Space    The address space of the write, or TEST_EVENT_KEPT_RECORD.
+  @param[in]  Width    The width of the write.
+  @param[in]  Address  The address of the write, or the index of the kept record.
+  @param[in]  Data     The data of the write.
+**/
+STATIC
+VOID
+LogEvent (
+  IN TEST_EVENT_LOG  *Log,
+  IN UINT8           Space,
+  IN UINT8           Width,
+  IN UINT64          Address,
+  IN UINT64          Data
+  )
+{
+  if (Log->Count < TEST_MAX_EVENTS) {
+    Log->Events[Log->Count].Space   = Space;
+    Log->Events[Log->Count].Width   = Width;
+    Log->Events[Log->Count].Address = Address;
+    Log->Events[Log->Count].Data    = Data;
+  }
+  Log->Count++;
+}
+
+//
+// IoLib and PciSegmentLib writes, logged instead of performed.
+//
+UINT8
+EFIAPI
+IoWrite8 (
+  IN UINTN  Port,
+  IN UINT8  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO, S3BootScriptWidthUint8, Port, Value);
+  return Value;
+}
+
+UINT16
+EFIAPI
+IoWrite16 (
+  IN UINTN   Port,
+  IN UINT16  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO, S3BootScriptWidthUint16, Port, Value);
+  return Value;
+}
+
+UINT32
+EFIAPI
+IoWrite32 (
+  IN UINTN   Port,
+  IN UINT32  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO, S3BootScriptWidthUint32, Port, Value);
+  return Value;
+}
+
+UINT64
+EFIAPI
+IoWrite64 (
+  IN UINTN   Port,
+  IN UINT64  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO, S3BootScriptWidthUint64, Port, Value);
+  return Value;
+}
+
+UINT8
+EFIAPI
+MmioWrite8 (
+  IN UINTN  Address,
+  IN UINT8  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM, S3BootScriptWidthUint8, Address, Value);
+  return Value;
+}
+
+UINT16
+EFIAPI
+MmioWrite16 (
+  IN UINTN   Address,
+  IN UINT16  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM, S3BootScriptWidthUint16, Address, Value);
+  return Value;
+}
+
+UINT32
+EFIAPI
+MmioWrite32 (
+  IN UINTN   Address,
+  IN UINT32  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM, S3BootScriptWidthUint32, Address, Value);
+  return Value;
+}
+
+UINT64
+EFIAPI
+MmioWrite64 (
+  IN UINTN   Address,
+  IN UINT64  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM, S3BootScriptWidthUint64, Address, Value);
+  return Value;
+}
+
+UINT8
+EFIAPI
+PciSegmentWrite8 (
+  IN UINT64  Address,
+  IN UINT8   Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI, S3BootScriptWidthUint8, Address, Value);
+  return Value;
+}
+
+UINT16
+EFIAPI
+PciSegmentWrite16 (
+  IN UINT64  Address,
+  IN UINT16  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI, S3BootScriptWidthUint16, Address, Value);
+  return Value;
+}
+
+UINT32
+EFIAPI
+PciSegmentWrite32 (
+  IN UINT64  Address,
+  IN UINT32  Value
+  )
+{
+  LogEvent (&mReplayed, S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI, S3BootScriptWidthUint32, Address, Value);
+  return Value;
+}
+
+/**
+  Appends an I/O, memory or PCI configuration write record to the table.
+
+  @param[in]  OpCode     The opcode of the record.
+  @param[in]  Width      The width of the write.
+  @param[in]  Address    The address of the write.
+  @param[in]  Segment    The PCI segment, for EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE.
+  @param[in]  Count      The number of writes.
+  @param[in]  Coalesced  TRUE if the record is expected to be coalesced into a
+                         write run, FALSE if it is expected to be kept.
+**/
+STATIC
+VOID
+AppendWrite (
+  IN UINT16                    OpCode,
+  IN S3_BOOT_SCRIPT_LIB_WIDTH  Width,
+  IN UINT64                    Address,
+  IN UINT16                    Segment,
+  IN UINT32                    Count,
+  IN BOOLEAN                   Coalesced
+  )
+{
+  EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE  Header;
+  UINTN                              HeaderSize;
+  UINTN                              WidthInByte;
+  UINT64                             Data;
+  UINT8                              Space;
+  UINT64                             WriteAddress;
+  UINTN                              Index;
+  UINT8                              *Record;
+
+  if (OpCode == EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE) {
+    HeaderSize   = sizeof (EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE);
+    Space        = S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI;
+    WriteAddress = PCI_ADDRESS_ENCODE (Segment, Address);
+  } else {
+    HeaderSize   = sizeof (EFI_BOOT_SCRIPT_MEM_WRITE);
+    if (OpCode == EFI_BOOT_SCRIPT_IO_WRITE_OPCODE) {
+      Space        = S3_BOOT_SCRIPT_LIB_WRITE_RUN_IO;
+      WriteAddress = Address;
+    } else if (OpCode == EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE) {
+      Space        = S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM;
+      WriteAddress = Address;
+    } else {
+      Space        = S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI;
+      WriteAddress = PCI_ADDRESS_ENCODE (0, Address);
+    }
+  }
+
+  WidthInByte    = (UINTN) (0x01 << (Width & 0x03));
+  Header.OpCode  = OpCode;
+  Header.Length  = (UINT8) (HeaderSize + WidthInByte * Count);
+  Header.Width   = Width;
+  Header.Count   = Count;
+  Header.Address = Address;
+  Header.Segment = Segment;
+
+  Record = mTable + mTablePrivate.TableLength;
+  CopyMem (Record, &Header, HeaderSize);
+  for (Index = 0; Index < Count; Index++) {
+    Data = UnitTestRandom ();
+    CopyMem (Record + HeaderSize + Index * WidthInByte, &Data, WidthInByte);
+  }
+  mTablePrivate.TableLength += Header.Length;
+
+  if (Coalesced) {
+    Data = 0;
+    CopyMem (&Data, Record + HeaderSize, WidthInByte);
+    LogEvent (&mExpected, Space, (UINT8) Width, WriteAddress, Data);
+  } else {
+    mKeptOffset[mKeptCount] = (UINTN) (Record - mTable);
+    LogEvent (&mExpected, TEST_EVENT_KEPT_RECORD, 0, mKeptCount, 0);
+    mKeptCount++;
+  }
+}
+
+/**
+  Appends a stall record to the table. It is expected to be kept.
+**/
+STATIC
+VOID
+AppendStall (
+  VOID
+  )
+{
+  EFI_BOOT_SCRIPT_STALL  Stall;
+
+  Stall.OpCode   = EFI_BOOT_SCRIPT_STALL_OPCODE;
+  Stall.Length   = (UINT8) sizeof (Stall);
+  Stall.Duration = (UINTN) UnitTestRandom ();
+  CopyMem (mTable + mTablePrivate.TableLength, &Stall, sizeof (Stall));
+
+  mKeptOffset[mKeptCount] = mTablePrivate.TableLength;
+  LogEvent (&mExpected, TEST_EVENT_KEPT_RECORD, 0, mKeptCount, 0);
+  mKeptCount++;
+  mTablePrivate.TableLength += sizeof (Stall);
+}
+
+/**
+  Compacts the table and replays it: the write runs are executed and the other
+  records are checked against the records they were copied from.
+
+  @retval UNIT_TEST_PASSED             The replay matches the expected events.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The replay does not match.
+**/
+STATIC
+UNIT_TEST_STATUS
+CompactAndReplay (
+  VOID
+  )
+{
+  UINT8                           *Script;
+  UINT8                           *End;
+  EFI_BOOT_SCRIPT_GENERIC_HEADER  Header;
+  UINT32                          OriginalLength;
+  UINTN                           KeptIndex;
+  UINTN                           WriteCount;
+  UINTN                           Index;
+
+  OriginalLength = mTablePrivate.TableLength;
+  CopyMem (mOriginalTable, mTable, OriginalLength);
+
+  S3BootScriptCompactTable ();
+  UT_ASSERT_TRUE (mTablePrivate.TableLength <= OriginalLength);
+
+  mReplayed.Count = 0;
+  KeptIndex       = 0;
+  WriteCount      = 0;
+  Script          = mTable + sizeof (EFI_BOOT_SCRIPT_TABLE_HEADER);
+  End             = mTable + mTablePrivate.TableLength;
+  while (Script < End) {
+    CopyMem (&Header, Script, sizeof (Header));
+    UT_ASSERT_TRUE (Header.Length >= sizeof (Header));
+    UT_ASSERT_TRUE (Header.Length <= (UINTN) (End - Script));
+    if (Header.OpCode == S3_BOOT_SCRIPT_LIB_WRITE_RUN_OPCODE) {
+      UT_ASSERT_NOT_EFI_ERROR (BootScriptExecuteWriteRun (Script, &WriteCount));
+    } else {
+      UT_ASSERT_TRUE (KeptIndex < mKeptCount);
+      UT_ASSERT_MEM_EQUAL (Script, mOriginalTable + mKeptOffset[KeptIndex], Header.Length);
+      LogEvent (&mReplayed, TEST_EVENT_KEPT_RECORD, 0, KeptIndex, 0);
+      KeptIndex++;
+    }
+    Script += Header.Length;
+  }
+
+  UT_ASSERT_EQUAL (mReplayed.Count, mExpected.Count);
+  UT_ASSERT_EQUAL (KeptIndex, mKeptCount);
+  UT_ASSERT_EQUAL (WriteCount + KeptIndex, mExpected.Count);
+  for (Index = 0; Index < mExpected.Count; Index++) {
+    UT_ASSERT_EQUAL (mReplayed.Events[Index].Space,   mExpected.Events[Index].Space);
+    UT_ASSERT_EQUAL (mReplayed.Events[Index].Width,   mExpected.Events[Index].Width);
+    UT_ASSERT_EQUAL (mReplayed.Events[Index].Address, mExpected.Events[Index].Address);
+    UT_ASSERT_EQUAL (mReplayed.Events[Index].Data,    mExpected.Events[Index].Data);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Allocates an empty boot script table.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                    The table is allocated.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupTable (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_BOOT_SCRIPT_TABLE_HEADER  TableHeader;
+
+  mTable         = AllocateZeroPool (TEST_TABLE_SIZE);
+  mOriginalTable = AllocateZeroPool (TEST_TABLE_SIZE);
+  if ((mTable == NULL) || (mOriginalTable == NULL)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  ZeroMem (&TableHeader, sizeof (TableHeader));
+  TableHeader.OpCode = S3_BOOT_SCRIPT_LIB_TABLE_OPCODE;
+  TableHeader.Length = (UINT8) sizeof (TableHeader);
+  CopyMem (mTable, &TableHeader, sizeof (TableHeader));
+
+  ZeroMem (&mTablePrivate, sizeof (mTablePrivate));
+  mTablePrivate.TableBase   = mTable;
+  mTablePrivate.TableLength = sizeof (TableHeader);
+  mKeptCount      = 0;
+  mExpected.Count = 0;
+  mReplayed.Count = 0;
+  UnitTestRandomSeed (0x5333);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the boot script table.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupTable (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mTable != NULL) {
+    FreePool (mTable);
+    mTable = NULL;
+  }
+  if (mOriginalTable != NULL) {
+    FreePool (mOriginalTable);
+    mOriginalTable = NULL;
+  }
+}
+
+/**
+  Randomly generated tables of single writes, mostly to nearby addresses, with
+  a few other records, must replay the same writes once compacted.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+RandomTablesReplaySameWrites (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN                     Table;
+  UINTN                     Index;
+  UINT64                    Address;
+  UINT64                    Pick;
+  UINTN                     WidthInByte;
+  S3_BOOT_SCRIPT_LIB_WIDTH  Width;
+  UINT16                    OpCode;
+  UNIT_TEST_STATUS          Status;
+  UINT32                    CompactedLength;
+  UINT32                    OriginalLength;
+
+  for (Table = 0; Table < TEST_RANDOM_TABLES; Table++) {
+    mTablePrivate.TableLength = sizeof (EFI_BOOT_SCRIPT_TABLE_HEADER);
+    mKeptCount      = 0;
+    mExpected.Count = 0;
+    Address         = 0xFED00000;
+    OpCode          = EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE;
+    Width           = S3BootScriptWidthUint32;
+
+    for (Index = 0; Index < TEST_RANDOM_RECORDS; Index++) {
+      Pick = UnitTestRandom () % 100;
+      if (Pick < 2) {
+        AppendStall ();
+        continue;
+      }
+      if (Pick < 10) {
+        //
+        // Switch to another address space or width.
+        //
+        switch (UnitTestRandom () % 4) {
+        case 0:
+          OpCode  = EFI_BOOT_SCRIPT_IO_WRITE_OPCODE;
+          Address = UnitTestRandom () % 0x10000;
+          break;
+        case 1:
+          OpCode  = EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE;
+          Address = UnitTestRandom ();
+          break;
+        case 2:
+          OpCode  = EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE;
+          Address = UnitTestRandom () & 0xFFFFFF00;
+          break;
+        default:
+          OpCode  = EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE;
+          Address = UnitTestRandom () & 0xFFFFFF00;
+          break;
+        }
+        Width = (S3_BOOT_SCRIPT_LIB_WIDTH) ((UINTN) UnitTestRandom () % ((OpCode == EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE ||
+                                                                          OpCode == EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE) ? 3 : 4));
+      } else if (Pick < 15) {
+        //
+        // A far address, out of the reach of a delta.
+        //
+        Address += 0x10000 + UnitTestRandom () % 0x10000;
+      } else {
+        //
+        // A nearby address, before or after the previous one.
+        //
+        Address = Address + UnitTestRandom () % 0x200 - 0x100;
+      }
+
+      //
+      // Keep the addresses aligned, and within UINTN for the memory writes.
+      //
+      WidthInByte = (UINTN) (0x01 << Width);
+      Address    &= ~(UINT64) (WidthInByte - 1);
+      if (OpCode == EFI_BOOT_SCRIPT_IO_WRITE_OPCODE) {
+        Address &= MAX_IO_ADDRESS;
+      } else {
+        Address &= MAX_UINT32;
+      }
+      AppendWrite (OpCode, Width, Address, (UINT16) (Table & 0x3), 1, TRUE);
+    }
+
+    OriginalLength = mTablePrivate.TableLength;
+    Status = CompactAndReplay ();
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+    CompactedLength = mTablePrivate.TableLength;
+    UT_LOG_INFO ("Table %Lu: 0x%x -> 0x%x bytes\n", (UINT64) Table, OriginalLength, CompactedLength);
+    UT_ASSERT_TRUE (CompactedLength < OriginalLength);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Writes that the executor would not perform as a single write, and the other
+  records, must be kept byte for byte and in order, and split the write runs.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+OtherRecordsAreKept (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  AppendWrite (EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE, S3BootScriptWidthUint32, 0xFED00000, 0, 1, TRUE);
+  AppendStall ();
+  AppendWrite (EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE, S3BootScriptWidthUint32, 0xFED00004, 0, 1, TRUE);
+  //
+  // More than one write.
+  //
+  AppendWrite (EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE, S3BootScriptWidthUint32, 0xFED00008, 0, 2, FALSE);
+  //
+  // FIFO and fill writes.
+  //
+  AppendWrite (EFI_BOOT_SCRIPT_IO_WRITE_OPCODE, S3BootScriptWidthFifoUint8, 0x80, 0, 1, FALSE);
+  AppendWrite (EFI_BOOT_SCRIPT_IO_WRITE_OPCODE, S3BootScriptWidthFillUint16, 0x80, 0, 1, FALSE);
+  //
+  // Unaligned address.
+  //
+  AppendWrite (EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE, S3BootScriptWidthUint32, 0xFED00011, 0, 1, FALSE);
+  //
+  // I/O port out of range.
+  //
+  AppendWrite (EFI_BOOT_SCRIPT_IO_WRITE_OPCODE, S3BootScriptWidthUint8, 0x10000, 0, 1, FALSE);
+  //
+  // 64-bit PCI configuration write.
+  //
+  AppendWrite (EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE, S3BootScriptWidthUint64, 0x00100000, 1, 1, FALSE);
+  AppendWrite (EFI_BOOT_SCRIPT_IO_WRITE_OPCODE, S3BootScriptWidthUint16, 0xCF8, 0, 1, TRUE);
+  AppendWrite (EFI_BOOT_SCRIPT_IO_WRITE_OPCODE, S3BootScriptWidthUint16, 0xCFC, 0, 1, TRUE);
+
+  return CompactAndReplay ();
+}
+
+/**
+  Malformed write runs must be rejected without performing any write.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+MalformedWriteRunIsRejected (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                         Script[sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN) + 2 * (sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY) + sizeof (UINT32))];
+  S3_BOOT_SCRIPT_LIB_WRITE_RUN  WriteRun;
+  UINTN                         WriteCount;
+
+  ZeroMem (Script, sizeof (Script));
+  WriteRun.OpCode  = S3_BOOT_SCRIPT_LIB_WRITE_RUN_OPCODE;
+  WriteRun.Length  = (UINT8) sizeof (Script);
+  WriteRun.Space   = S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM;
+  WriteRun.Width   = S3BootScriptWidthUint32;
+  WriteRun.Count   = 2;
+  WriteRun.Address = 0xFED00000;
+  WriteCount       = 0;
+
+  CopyMem (Script, &WriteRun, sizeof (WriteRun));
+  UT_ASSERT_NOT_EFI_ERROR (BootScriptExecuteWriteRun (Script, &WriteCount));
+  UT_ASSERT_EQUAL (WriteCount, 2);
+  UT_ASSERT_EQUAL (mReplayed.Count, 2);
+
+  mReplayed.Count = 0;
+  WriteCount      = 0;
+
+  WriteRun.Count = 3;
+  CopyMem (Script, &WriteRun, sizeof (WriteRun));
+  UT_ASSERT_STATUS_EQUAL (BootScriptExecuteWriteRun (Script, &WriteCount), EFI_INVALID_PARAMETER);
+
+  WriteRun.Count = 2;
+  WriteRun.Space = S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI + 1;
+  CopyMem (Script, &WriteRun, sizeof (WriteRun));
+  UT_ASSERT_STATUS_EQUAL (BootScriptExecuteWriteRun (Script, &WriteCount), EFI_INVALID_PARAMETER);
+
+  WriteRun.Space = S3_BOOT_SCRIPT_LIB_WRITE_RUN_MEM;
+  WriteRun.Width = S3BootScriptWidthFifoUint32;
+  CopyMem (Script, &WriteRun, sizeof (WriteRun));
+  UT_ASSERT_STATUS_EQUAL (BootScriptExecuteWriteRun (Script, &WriteCount), EFI_INVALID_PARAMETER);
+
+  WriteRun.Space  = S3_BOOT_SCRIPT_LIB_WRITE_RUN_PCI;
+  WriteRun.Width  = S3BootScriptWidthUint64;
+  WriteRun.Count  = 1;
+  WriteRun.Length = (UINT8) (sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN) + sizeof (S3_BOOT_SCRIPT_LIB_WRITE_RUN_ENTRY) + sizeof (UINT64));
+  CopyMem (Script, &WriteRun, sizeof (WriteRun));
+  UT_ASSERT_STATUS_EQUAL (BootScriptExecuteWriteRun (Script, &WriteCount), EFI_INVALID_PARAMETER);
+
+  UT_ASSERT_EQUAL (WriteCount, 0);
+  UT_ASSERT_EQUAL (mReplayed.Count, 0);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the boot
+  script write runs and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      WriteRunTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the boot script write run Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&WriteRunTests, Framework, "S3 Boot Script Write Run Tests", "DxeS3BootScriptLib.WriteRun", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for WriteRunTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (WriteRunTests, "Compacted tables should replay the same writes", "RoundTrip", RandomTablesReplaySameWrites, SetupTable, CleanupTable, NULL);
+  AddTestCase (WriteRunTests, "Other records should be kept in order",          "Kept",      OtherRecordsAreKept,          SetupTable, CleanupTable, NULL);
+  AddTestCase (WriteRunTests, "Malformed write runs should be rejected",        "Malformed", MalformedWriteRunIsRejected,  SetupTable, CleanupTable, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,40 @@
+/** @file
+  Deterministic pseudo random numbers for the host based unit tests.
+
+  The same seed always gives the same sequence, so that a failing test can be
+  run again with the same inputs.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __UNIT_TEST_RANDOM_LIB_H__
+#define __UNIT_TEST_RANDOM_LIB_H__
+
+/**
+  Restarts the pseudo random sequence.
+
+  @param[in]  Seed  The seed of the sequence.
+
+**/
+VOID
+EFIAPI
+UnitTestRandomSeed (
+  IN UINT64  Seed
+  );
+
+/**
+  Returns the next number of the pseudo random sequence. All the bits of the
+  number are equally random.
+
+  @return The next pseudo random number.
+
+**/
+UINT64
+EFIAPI
+UnitTestRandom (
+  VOID
+  );
+
+#endif
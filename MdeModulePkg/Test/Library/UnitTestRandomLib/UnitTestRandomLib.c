@@ -0,0 +1,51 @@
+/** @file
+  Deterministic pseudo random numbers for the host based unit tests, from the
+  SplitMix64 generator.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/BaseLib.h>
+#include <Library/UnitTestRandomLib.h>
+
+UINT64  mUnitTestRandomState;
+
+/**
+  Restarts the pseudo random sequence.
+
+  @param[in]  Seed  The seed of the sequence.
+
+**/
+VOID
+EFIAPI
+UnitTestRandomSeed (
+  IN UINT64  Seed
+  )
+{
+  mUnitTestRandomState = Seed;
+}
+
+/**
+  Returns the next number of the pseudo random sequence. All the bits of the
+  number are equally random.
+
+  @return The next pseudo random number.
+
+**/
+UINT64
+EFIAPI
+UnitTestRandom (
+  VOID
+  )
+{
+  UINT64  Value;
+
+  mUnitTestRandomState += 0x9E3779B97F4A7C15ULL;
+  Value = mUnitTestRandomState;
+  Value = MultU64x64 (Value ^ RShiftU64 (Value, 30), 0xBF58476D1CE4E5B9ULL);
+  Value = MultU64x64 (Value ^ RShiftU64 (Value, 27), 0x94D049BB133111EBULL);
+  return Value ^ RShiftU64 (Value, 31);
+}
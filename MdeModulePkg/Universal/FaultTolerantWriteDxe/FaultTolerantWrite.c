@@ -3,7 +3,7 @@
   These are the common Fault Tolerant Write (FTW) functions that are shared
   by DXE FTW driver and SMM FTW driver.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -172,6 +172,8 @@ FtwAllocate (
   @param Fvb             The FVB protocol that provides services for
                          reading, writing, and erasing the target block.
   @param BlockSize       The size of the block.
+  @param SkipUnchanged   TRUE to leave the target blocks that already hold
+                         their new content untouched.
 
   @retval  EFI_SUCCESS          The function completed successfully
   @retval  EFI_ABORTED          The function could not complete successfully
@@ -181,7 +183,8 @@ EFI_STATUS
 FtwWriteRecord (
   IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL     *This,
   IN EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL    *Fvb,
-  IN UINTN                                 BlockSize
+  IN UINTN                                 BlockSize,
+  IN BOOLEAN                               SkipUnchanged
   )
 {
   EFI_STATUS                      Status;
@@ -232,7 +235,7 @@ FtwWriteRecord (
     // Update blocks other than working block or boot block
     //
     NumberOfWriteBlocks = FTW_BLOCKS ((UINTN) (Record->Offset + Record->Length), BlockSize);
-    Status = FlushSpareBlockToTargetBlock (FtwDevice, Fvb, Record->Lba, BlockSize, NumberOfWriteBlocks);
+    Status = FlushSpareBlockToTargetBlock (FtwDevice, Fvb, Record->Lba, BlockSize, NumberOfWriteBlocks, SkipUnchanged);
   }
 
   if (EFI_ERROR (Status)) {
@@ -575,7 +578,7 @@ FtwWrite (
   //  Since the content has already backuped in spare block, the write is
   //  guaranteed to be completed with fault tolerant manner.
   //
-  Status = FtwWriteRecord (This, Fvb, BlockSize);
+  Status = FtwWriteRecord (This, Fvb, BlockSize, TRUE);
   if (EFI_ERROR (Status)) {
     FreePool (SpareBuffer);
     return EFI_ABORTED;
@@ -699,8 +702,10 @@ FtwRestart (
   //
   //  Since the content has already backuped in spare block, the write is
   //  guaranteed to be completed with fault tolerant manner.
+  //  The last write may have been interrupted while programming a target
+  //  block, so rewrite all of them rather than trusting their content.
   //
-  Status = FtwWriteRecord (This, Fvb, BlockSize);
+  Status = FtwWriteRecord (This, Fvb, BlockSize, FALSE);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
   }
@@ -885,3 +890,292 @@ FtwGetLastWrite (
   return Status;
 }
 
+/**
+  Frees the writes queued in the transaction and ends it.
+
+  @param FtwDevice       The private data of FTW driver.
+
+**/
+STATIC
+VOID
+FtwTransactionEnd (
+  IN EFI_FTW_DEVICE                        *FtwDevice
+  )
+{
+  FTW_TRANSACTION_WRITE  *Write;
+
+  while (!IsListEmpty (&FtwDevice->TransactionWriteList)) {
+    Write = FTW_TRANSACTION_WRITE_FROM_LINK (GetFirstNode (&FtwDevice->TransactionWriteList));
+    RemoveEntryList (&Write->Link);
+    FreePool (Write);
+  }
+
+  FtwDevice->TransactionActive    = FALSE;
+  FtwDevice->TransactionFvbHandle = NULL;
+}
+
+/**
+  Starts a transaction on the blocks of a firmware volume block device.
+
+  @param This            The pointer to this protocol instance.
+  @param FvBlockHandle   The handle of FVB protocol that provides services for
+                         reading, writing, and erasing the target blocks.
+
+  @retval EFI_SUCCESS          The transaction is started.
+  @retval EFI_ACCESS_DENIED    Another transaction is in progress.
+  @retval EFI_NOT_FOUND        Cannot find FVB protocol by handle.
+  @retval EFI_ABORTED          The function could not complete successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionBegin (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN EFI_HANDLE                                        FvBlockHandle
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_FTW_DEVICE                      *FtwDevice;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  UINTN                               BlockSize;
+  UINTN                               NumberOfBlocks;
+
+  FtwDevice = FTW_CONTEXT_FROM_TRANSACTION (This);
+
+  if (FtwDevice->TransactionActive) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  Status = FtwGetFvbByHandle (FvBlockHandle, &Fvb);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Now, one FVB has one type of BlockSize.
+  //
+  Status = Fvb->GetBlockSize (Fvb, 0, &BlockSize, &NumberOfBlocks);
+  if (EFI_ERROR (Status) || (BlockSize == 0)) {
+    DEBUG ((EFI_D_ERROR, "Ftw: TransactionBegin(), Get block size - %r\n", Status));
+    return EFI_ABORTED;
+  }
+
+  FtwDevice->TransactionActive    = TRUE;
+  FtwDevice->TransactionFvbHandle = FvBlockHandle;
+  FtwDevice->TransactionBlockSize = BlockSize;
+  FtwDevice->TransactionStart     = MAX_UINT64;
+  FtwDevice->TransactionEnd       = 0;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Queues a write in the transaction.
+
+  @param This            The pointer to this protocol instance.
+  @param Lba             The logical block address of the target block.
+  @param Offset          The offset within the target block to place the data.
+  @param Length          The number of bytes to write to the target block.
+  @param Buffer          The data to write.
+
+  @retval EFI_SUCCESS           The write is queued.
+  @retval EFI_NOT_READY         No transaction is in progress.
+  @retval EFI_INVALID_PARAMETER Buffer is NULL or Length is 0.
+  @retval EFI_BAD_BUFFER_SIZE   The blocks touched by the transaction would not
+                                fit within the spare block.
+  @retval EFI_OUT_OF_RESOURCES  Cannot allocate enough memory resource.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionWrite (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN EFI_LBA                                           Lba,
+  IN UINTN                                             Offset,
+  IN UINTN                                             Length,
+  IN VOID                                              *Buffer
+  )
+{
+  EFI_FTW_DEVICE                      *FtwDevice;
+  FTW_TRANSACTION_WRITE               *Write;
+  UINT64                              Start;
+  UINT64                              End;
+  UINT64                              FirstLba;
+  UINT64                              LastLba;
+
+  FtwDevice = FTW_CONTEXT_FROM_TRANSACTION (This);
+
+  if (!FtwDevice->TransactionActive) {
+    return EFI_NOT_READY;
+  }
+
+  if ((Buffer == NULL) || (Length == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Start = MultU64x64 (Lba, FtwDevice->TransactionBlockSize) + Offset;
+  End   = Start + Length;
+  if (End < Start) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // The transaction is committed as one fault tolerant write, so all the
+  // blocks it touches must fit within the spare block.
+  //
+  FirstLba = DivU64x64Remainder (MIN (Start, FtwDevice->TransactionStart), FtwDevice->TransactionBlockSize, NULL);
+  LastLba  = DivU64x64Remainder (MAX (End, FtwDevice->TransactionEnd) - 1, FtwDevice->TransactionBlockSize, NULL);
+  if (MultU64x64 (LastLba - FirstLba + 1, FtwDevice->TransactionBlockSize) > FtwDevice->SpareAreaLength) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  Write = AllocatePool (sizeof (FTW_TRANSACTION_WRITE) + Length);
+  if (Write == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Write->Signature = FTW_TRANSACTION_WRITE_SIGNATURE;
+  Write->Start     = Start;
+  Write->Length    = Length;
+  CopyMem (Write + 1, Buffer, Length);
+  InsertTailList (&FtwDevice->TransactionWriteList, &Write->Link);
+
+  FtwDevice->TransactionStart = MIN (Start, FtwDevice->TransactionStart);
+  FtwDevice->TransactionEnd   = MAX (End, FtwDevice->TransactionEnd);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Commits the writes queued in the transaction as one fault tolerant write,
+  and ends the transaction.
+
+  The range from the first to the last byte written by the transaction is
+  read from flash, the queued writes are applied to it in order, and the
+  result goes through FtwWrite(), so the whole transaction costs one spare
+  block cycle and is recovered like any other fault tolerant write.
+
+  @param This            The pointer to this protocol instance.
+  @param PrivateData     A pointer to private data that the caller requires to
+                         complete any pending writes in the event of a fault.
+
+  @retval EFI_SUCCESS          The writes are committed, or none was queued.
+  @retval EFI_NOT_READY        No transaction is in progress.
+  @retval Others               The status of the fault tolerant write.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionCommit (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN VOID                                              *PrivateData OPTIONAL
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_FTW_DEVICE                      *FtwDevice;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  LIST_ENTRY                          *Link;
+  FTW_TRANSACTION_WRITE               *Write;
+  EFI_LBA                             Lba;
+  UINTN                               BlockSize;
+  UINTN                               NumberOfBlocks;
+  UINTN                               Index;
+  UINTN                               Count;
+  UINT64                              Base;
+  UINTN                               Offset;
+  UINT8                               *Buffer;
+
+  FtwDevice = FTW_CONTEXT_FROM_TRANSACTION (This);
+
+  if (!FtwDevice->TransactionActive) {
+    return EFI_NOT_READY;
+  }
+
+  if (IsListEmpty (&FtwDevice->TransactionWriteList)) {
+    FtwTransactionEnd (FtwDevice);
+    return EFI_SUCCESS;
+  }
+
+  Status = FtwGetFvbByHandle (FtwDevice->TransactionFvbHandle, &Fvb);
+  if (EFI_ERROR (Status)) {
+    FtwTransactionEnd (FtwDevice);
+    return EFI_NOT_FOUND;
+  }
+
+  BlockSize      = FtwDevice->TransactionBlockSize;
+  Lba            = DivU64x64Remainder (FtwDevice->TransactionStart, BlockSize, NULL);
+  Base           = MultU64x64 (Lba, BlockSize);
+  Offset         = (UINTN) (FtwDevice->TransactionStart - Base);
+  NumberOfBlocks = FTW_BLOCKS ((UINTN) (FtwDevice->TransactionEnd - Base), BlockSize);
+
+  Buffer = AllocatePool (NumberOfBlocks * BlockSize);
+  if (Buffer == NULL) {
+    FtwTransactionEnd (FtwDevice);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Read the current content of the target blocks, so that the bytes between
+  // the queued writes are preserved, then apply the writes in order.
+  //
+  for (Index = 0; Index < NumberOfBlocks; Index += 1) {
+    Count  = BlockSize;
+    Status = Fvb->Read (Fvb, Lba + Index, 0, &Count, Buffer + Index * BlockSize);
+    if (EFI_ERROR (Status)) {
+      FreePool (Buffer);
+      FtwTransactionEnd (FtwDevice);
+      return EFI_ABORTED;
+    }
+  }
+
+  for (Link = GetFirstNode (&FtwDevice->TransactionWriteList);
+       !IsNull (&FtwDevice->TransactionWriteList, Link);
+       Link = GetNextNode (&FtwDevice->TransactionWriteList, Link)) {
+    Write = FTW_TRANSACTION_WRITE_FROM_LINK (Link);
+    CopyMem (Buffer + (UINTN) (Write->Start - Base), Write + 1, Write->Length);
+  }
+
+  Status = FtwWrite (
+             &FtwDevice->FtwInstance,
+             Lba,
+             Offset,
+             (UINTN) (FtwDevice->TransactionEnd - FtwDevice->TransactionStart),
+             PrivateData,
+             FtwDevice->TransactionFvbHandle,
+             Buffer + Offset
+             );
+  DEBUG ((EFI_D_INFO, "Ftw: TransactionCommit(), Lba - 0x%lx, NumberOfBlocks - 0x%x - %r\n", Lba, NumberOfBlocks, Status));
+
+  FreePool (Buffer);
+  FtwTransactionEnd (FtwDevice);
+
+  return Status;
+}
+
+/**
+  Discards the writes queued in the transaction and ends it.
+
+  @param This            The pointer to this protocol instance.
+
+  @retval EFI_SUCCESS          The transaction is ended.
+  @retval EFI_NOT_READY        No transaction is in progress.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionAbort (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This
+  )
+{
+  EFI_FTW_DEVICE                      *FtwDevice;
+
+  FtwDevice = FTW_CONTEXT_FROM_TRANSACTION (This);
+
+  if (!FtwDevice->TransactionActive) {
+    return EFI_NOT_READY;
+  }
+
+  FtwTransactionEnd (FtwDevice);
+
+  return EFI_SUCCESS;
+}
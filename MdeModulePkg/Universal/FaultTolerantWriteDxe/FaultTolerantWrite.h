@@ -3,7 +3,7 @@
   The internal header file includes the common header files, defines
   internal structure and functions used by Ftw module.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -16,9 +16,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/ZeroGuid.h>
 #include <Protocol/FaultTolerantWrite.h>
+#include <Protocol/FaultTolerantWriteTransaction.h>
 #include <Protocol/FirmwareVolumeBlock.h>
 #include <Protocol/SwapAddressRange.h>
 
+#include <Library/BaseLib.h>
 #include <Library/PcdLib.h>
 #include <Library/DebugLib.h>
 #include <Library/UefiLib.h>
@@ -47,6 +49,21 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define FTW_DEVICE_SIGNATURE  SIGNATURE_32 ('F', 'T', 'W', 'D')
 
+#define FTW_TRANSACTION_WRITE_SIGNATURE  SIGNATURE_32 ('F', 'T', 'W', 'Q')
+
+//
+// A write queued in a fault tolerant write transaction, followed by the data
+// to write.
+//
+typedef struct {
+  UINTN                                   Signature;
+  LIST_ENTRY                              Link;
+  UINT64                                  Start;              // Offset of the first byte to write, from the start of the FVB.
+  UINTN                                   Length;             // Number of bytes to write.
+} FTW_TRANSACTION_WRITE;
+
+#define FTW_TRANSACTION_WRITE_FROM_LINK(a)  CR (a, FTW_TRANSACTION_WRITE, Link, FTW_TRANSACTION_WRITE_SIGNATURE)
+
 //
 // EFI Fault tolerant protocol private data structure
 //
@@ -76,6 +93,13 @@ typedef struct {
   EFI_LBA                                 FtwWorkSpaceLbaInSpare; // Start LBA of working space in spare block.
   UINTN                                   FtwWorkSpaceBaseInSpare;// Offset into the FtwWorkSpaceLbaInSpare block.
   UINT8                                   *FtwWorkSpace;      // Point to Work Space in memory buffer
+  EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL FtwTransactionInstance;
+  BOOLEAN                                 TransactionActive;  // A transaction is in progress.
+  EFI_HANDLE                              TransactionFvbHandle;   // FVB handle of the transaction target blocks.
+  UINTN                                   TransactionBlockSize;   // Block size in bytes of the transaction target blocks.
+  LIST_ENTRY                              TransactionWriteList;   // FTW_TRANSACTION_WRITE queued in the transaction.
+  UINT64                                  TransactionStart;   // Offset of the first byte written by the transaction.
+  UINT64                                  TransactionEnd;     // Offset following the last byte written by the transaction.
   //
   // Following a buffer of FtwWorkSpace[FTW_WORK_SPACE_SIZE],
   // Allocated with EFI_FTW_DEVICE.
@@ -83,6 +107,7 @@ typedef struct {
 } EFI_FTW_DEVICE;
 
 #define FTW_CONTEXT_FROM_THIS(a)  CR (a, EFI_FTW_DEVICE, FtwInstance, FTW_DEVICE_SIGNATURE)
+#define FTW_CONTEXT_FROM_TRANSACTION(a)  CR (a, EFI_FTW_DEVICE, FtwTransactionInstance, FTW_DEVICE_SIGNATURE)
 
 //
 // Driver entry point
@@ -270,6 +295,88 @@ FtwGetLastWrite (
   OUT BOOLEAN                              *Complete
   );
 
+/**
+  Starts a transaction on the blocks of a firmware volume block device.
+
+  @param This            The pointer to this protocol instance.
+  @param FvBlockHandle   The handle of FVB protocol that provides services for
+                         reading, writing, and erasing the target blocks.
+
+  @retval EFI_SUCCESS          The transaction is started.
+  @retval EFI_ACCESS_DENIED    Another transaction is in progress.
+  @retval EFI_NOT_FOUND        Cannot find FVB protocol by handle.
+  @retval EFI_ABORTED          The function could not complete successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionBegin (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN EFI_HANDLE                                        FvBlockHandle
+  );
+
+/**
+  Queues a write in the transaction.
+
+  @param This            The pointer to this protocol instance.
+  @param Lba             The logical block address of the target block.
+  @param Offset          The offset within the target block to place the data.
+  @param Length          The number of bytes to write to the target block.
+  @param Buffer          The data to write.
+
+  @retval EFI_SUCCESS           The write is queued.
+  @retval EFI_NOT_READY         No transaction is in progress.
+  @retval EFI_INVALID_PARAMETER Buffer is NULL or Length is 0.
+  @retval EFI_BAD_BUFFER_SIZE   The blocks touched by the transaction would not
+                                fit within the spare block.
+  @retval EFI_OUT_OF_RESOURCES  Cannot allocate enough memory resource.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionWrite (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN EFI_LBA                                           Lba,
+  IN UINTN                                             Offset,
+  IN UINTN                                             Length,
+  IN VOID                                              *Buffer
+  );
+
+/**
+  Commits the writes queued in the transaction as one fault tolerant write,
+  and ends the transaction.
+
+  @param This            The pointer to this protocol instance.
+  @param PrivateData     A pointer to private data that the caller requires to
+                         complete any pending writes in the event of a fault.
+
+  @retval EFI_SUCCESS          The writes are committed, or none was queued.
+  @retval EFI_NOT_READY        No transaction is in progress.
+  @retval Others               The status of the fault tolerant write.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionCommit (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This,
+  IN VOID                                              *PrivateData OPTIONAL
+  );
+
+/**
+  Discards the writes queued in the transaction and ends it.
+
+  @param This            The pointer to this protocol instance.
+
+  @retval EFI_SUCCESS          The transaction is ended.
+  @retval EFI_NOT_READY        No transaction is in progress.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwTransactionAbort (
+  IN EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL   *This
+  );
+
 /**
   Erase spare block.
 
@@ -355,6 +462,8 @@ IsBootBlock (
   @param Lba             Lba of the target block
   @param BlockSize       The size of the block
   @param NumberOfBlocks  The number of consecutive blocks starting with Lba
+  @param SkipUnchanged   TRUE to leave the target blocks that already hold the
+                         content of the spare block untouched
 
   @retval  EFI_SUCCESS               Spare block content is copied to target block
   @retval  EFI_INVALID_PARAMETER     Input parameter error
@@ -368,7 +477,8 @@ FlushSpareBlockToTargetBlock (
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *FvBlock,
   EFI_LBA                             Lba,
   UINTN                               BlockSize,
-  UINTN                               NumberOfBlocks
+  UINTN                               NumberOfBlocks,
+  BOOLEAN                             SkipUnchanged
   );
 
 /**
@@ -40,7 +40,7 @@
   If one of them is not satisfied, FtwWrite may fail.
   Usually, Spare area only takes one block. That's SpareAreaLength = BlockSize, NumberOfSpareBlock = 1.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -186,11 +186,13 @@ FvbNotificationEvent (
   //
   // Install protocol interface
   //
-  Status = gBS->InstallProtocolInterface (
+  Status = gBS->InstallMultipleProtocolInterfaces (
                   &FtwDevice->Handle,
                   &gEfiFaultTolerantWriteProtocolGuid,
-                  EFI_NATIVE_INTERFACE,
-                  &FtwDevice->FtwInstance
+                  &FtwDevice->FtwInstance,
+                  &gEdkiiFaultTolerantWriteTransactionProtocolGuid,
+                  &FtwDevice->FtwTransactionInstance,
+                  NULL
                   );
   ASSERT_EFI_ERROR (Status);
 
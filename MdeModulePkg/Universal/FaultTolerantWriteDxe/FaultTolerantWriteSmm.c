@@ -43,7 +43,7 @@
   Caution: This module requires additional review when modified.
   This driver need to make sure the CommBuffer is not in the SMRAM range.
 
-Copyright (c) 2010 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -52,6 +52,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/MmServicesTableLib.h>
 #include <Library/BaseLib.h>
 #include <Protocol/SmmSwapAddressRange.h>
+#include <Protocol/SmmFaultTolerantWriteTransaction.h>
 #include "FaultTolerantWrite.h"
 #include "FaultTolerantWriteSmmCommon.h"
 #include <Protocol/MmEndOfDxe.h>
@@ -551,6 +552,14 @@ FvbNotificationEvent (
                     );
   ASSERT_EFI_ERROR (Status);
 
+  Status = gMmst->MmInstallProtocolInterface (
+                    &mFtwDevice->Handle,
+                    &gEdkiiSmmFaultTolerantWriteTransactionProtocolGuid,
+                    EFI_NATIVE_INTERFACE,
+                    &mFtwDevice->FtwTransactionInstance
+                    );
+  ASSERT_EFI_ERROR (Status);
+
   ///
   /// Register SMM FTW SMI handler
   ///
@@ -2,7 +2,7 @@
 
   Internal generic functions to operate flash block.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -456,6 +456,8 @@ FlushSpareBlockToBootBlock (
   @param Lba             Lba of the target block
   @param BlockSize       The size of the block
   @param NumberOfBlocks  The number of consecutive blocks starting with Lba
+  @param SkipUnchanged   TRUE to leave the target blocks that already hold the
+                         content of the spare block untouched
 
   @retval  EFI_SUCCESS               Spare block content is copied to target block
   @retval  EFI_INVALID_PARAMETER     Input parameter error
@@ -469,12 +471,14 @@ FlushSpareBlockToTargetBlock (
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *FvBlock,
   EFI_LBA                             Lba,
   UINTN                               BlockSize,
-  UINTN                               NumberOfBlocks
+  UINTN                               NumberOfBlocks,
+  BOOLEAN                             SkipUnchanged
   )
 {
   EFI_STATUS  Status;
   UINTN       Length;
   UINT8       *Buffer;
+  UINT8       *TargetBuffer;
   UINTN       Count;
   UINT8       *Ptr;
   UINTN       Index;
@@ -510,23 +514,57 @@ FlushSpareBlockToTargetBlock (
 
     Ptr += Count;
   }
-  //
-  // Erase the target block
-  //
-  Status = FtwEraseBlock (FtwDevice, FvBlock, Lba, NumberOfBlocks);
-  if (EFI_ERROR (Status)) {
-    FreePool (Buffer);
-    return EFI_ABORTED;
+
+  TargetBuffer = NULL;
+  if (SkipUnchanged) {
+    TargetBuffer = AllocatePool (BlockSize);
+    if (TargetBuffer == NULL) {
+      FreePool (Buffer);
+      return EFI_OUT_OF_RESOURCES;
+    }
+  } else {
+    //
+    // Erase the target block
+    //
+    Status = FtwEraseBlock (FtwDevice, FvBlock, Lba, NumberOfBlocks);
+    if (EFI_ERROR (Status)) {
+      FreePool (Buffer);
+      return EFI_ABORTED;
+    }
   }
   //
   // Write memory buffer to block, using the FvBlock protocol interface
   //
   Ptr = Buffer;
   for (Index = 0; Index < NumberOfBlocks; Index += 1) {
+    if (SkipUnchanged) {
+      //
+      // A target block that already holds its new content needs neither an
+      // erase nor a write, the spare block still backs it up until the write
+      // record is marked DEST_COMPLETED.
+      //
+      Count   = BlockSize;
+      Status  = FvBlock->Read (FvBlock, Lba + Index, 0, &Count, TargetBuffer);
+      if (!EFI_ERROR (Status) && (Count == BlockSize) && (CompareMem (TargetBuffer, Ptr, BlockSize) == 0)) {
+        Ptr += BlockSize;
+        continue;
+      }
+
+      Status = FtwEraseBlock (FtwDevice, FvBlock, Lba + Index, 1);
+      if (EFI_ERROR (Status)) {
+        FreePool (TargetBuffer);
+        FreePool (Buffer);
+        return EFI_ABORTED;
+      }
+    }
+
     Count   = BlockSize;
     Status  = FvBlock->Write (FvBlock, Lba + Index, 0, &Count, Ptr);
     if (EFI_ERROR (Status)) {
       DEBUG ((EFI_D_ERROR, "Ftw: FVB Write block - %r\n", Status));
+      if (TargetBuffer != NULL) {
+        FreePool (TargetBuffer);
+      }
       FreePool (Buffer);
       return Status;
     }
@@ -534,9 +572,12 @@ FlushSpareBlockToTargetBlock (
     Ptr += Count;
   }
 
+  if (TargetBuffer != NULL) {
+    FreePool (TargetBuffer);
+  }
   FreePool (Buffer);
 
-  return Status;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -994,6 +1035,7 @@ InitFtwDevice (
   FtwDevice->FtwBackupFvb     = NULL;
   FtwDevice->FtwWorkSpaceLba  = (EFI_LBA) (-1);
   FtwDevice->FtwSpareLba      = (EFI_LBA) (-1);
+  InitializeListHead (&FtwDevice->TransactionWriteList);
 
   FtwDevice->WorkSpaceAddress = (EFI_PHYSICAL_ADDRESS) PcdGet64 (PcdFlashNvStorageFtwWorkingBase64);
   if (FtwDevice->WorkSpaceAddress == 0) {
@@ -1373,6 +1415,11 @@ InitFtwProtocol (
   FtwDevice->FtwInstance.Abort           = FtwAbort;
   FtwDevice->FtwInstance.GetLastWrite    = FtwGetLastWrite;
 
+  FtwDevice->FtwTransactionInstance.Begin  = FtwTransactionBegin;
+  FtwDevice->FtwTransactionInstance.Write  = FtwTransactionWrite;
+  FtwDevice->FtwTransactionInstance.Commit = FtwTransactionCommit;
+  FtwDevice->FtwTransactionInstance.Abort  = FtwTransactionAbort;
+
   return EFI_SUCCESS;
 }
 
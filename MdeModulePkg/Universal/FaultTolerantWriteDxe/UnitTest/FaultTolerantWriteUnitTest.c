@@ -0,0 +1,808 @@
+/** @file
+  Unit tests of the fault tolerant write transactions, run against an emulated
+  flash device that counts block erases.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../FaultTolerantWrite.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "FaultTolerantWriteDxe Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Layout of the emulated flash device, one FVB holding the target blocks,
+// the FTW working block and the FTW spare blocks.
+//
+#define FLASH_BLOCK_SIZE          SIZE_4KB
+#define FLASH_BLOCK_COUNT         32
+#define FLASH_TARGET_LBA          0
+#define FLASH_TARGET_BLOCKS       8
+#define FLASH_WORKING_LBA         8
+#define FLASH_SPARE_LBA           16
+#define FLASH_SPARE_BLOCKS        8
+
+typedef struct {
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  Fvb;
+  UINT8                               *Flash;
+  UINTN                               EraseCount[FLASH_BLOCK_COUNT];
+  //
+  // Number of target block erases that succeed before one fails, to emulate
+  // a power failure. MAX_UINTN never fails.
+  //
+  UINTN                               FailTargetEraseAfter;
+} EMULATED_FLASH;
+
+EMULATED_FLASH  mFlash;
+EFI_FTW_DEVICE  *mFtwDevice;
+
+//
+// Writes queued by the tests, relative to the start of the target blocks.
+// They touch target blocks 0 to 3, and the last two overlap earlier ones.
+//
+typedef struct {
+  UINTN  Offset;
+  UINTN  Length;
+  UINT8  Value;
+} TEST_WRITE;
+
+TEST_WRITE  mTestWrites[] = {
+  { 0x0010,                       0x20,  0x11 },
+  { FLASH_BLOCK_SIZE + 0x100,     0x40,  0x22 },
+  { FLASH_BLOCK_SIZE * 2 - 0x10,  0x30,  0x33 },
+  { FLASH_BLOCK_SIZE * 3 + 0x800, 0x100, 0x44 },
+  { FLASH_BLOCK_SIZE * 3 + 0x880, 0x10,  0x55 },
+  { 0x0020,                       0x08,  0x66 }
+};
+
+/**
+  Returns the number of erases of the blocks [Lba, Lba + NumberOfBlocks).
+
+  @param[in]  Lba             The first block.
+  @param[in]  NumberOfBlocks  The number of blocks.
+
+  @return The number of erases.
+**/
+STATIC
+UINTN
+EraseCount (
+  IN EFI_LBA  Lba,
+  IN UINTN    NumberOfBlocks
+  )
+{
+  UINTN  Count;
+  UINTN  Index;
+
+  Count = 0;
+  for (Index = 0; Index < NumberOfBlocks; Index++) {
+    Count += mFlash.EraseCount[Lba + Index];
+  }
+  return Count;
+}
+
+/**
+  Retrieves the attributes of the emulated flash.
+
+  @param[in]  This        Indicates the EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL instance.
+  @param[out] Attributes  Pointer to EFI_FVB_ATTRIBUTES_2 in which the attributes are returned.
+
+  @retval EFI_SUCCESS     The firmware volume attributes were returned.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+EmulatedFvbGetAttributes (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT       EFI_FVB_ATTRIBUTES_2                *Attributes
+  )
+{
+  *Attributes = EFI_FVB2_READ_STATUS | EFI_FVB2_WRITE_STATUS | EFI_FVB2_ERASE_POLARITY;
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieves the base address of the emulated flash.
+
+  @param[in]  This        Indicates the EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL instance.
+  @param[out] Address     Pointer to a caller-allocated EFI_PHYSICAL_ADDRESS.
+
+  @retval EFI_SUCCESS     The firmware volume base address was returned.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+EmulatedFvbGetPhysicalAddress (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  OUT       EFI_PHYSICAL_ADDRESS                *Address
+  )
+{
+  *Address = (EFI_PHYSICAL_ADDRESS) (UINTN) mFlash.Flash;
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieves the size of the blocks of the emulated flash.
+
+  @param[in]  This            Indicates the EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL instance.
+  @param[in]  Lba             Indicates the block whose size to return.
+  @param[out] BlockSize       Pointer to a caller-allocated UINTN for the block size.
+  @param[out] NumberOfBlocks  Pointer to a caller-allocated UINTN for the number of
+                              consecutive blocks, starting with Lba, that have the
+                              same size.
+
+  @retval EFI_SUCCESS            The block size was returned.
+  @retval EFI_INVALID_PARAMETER  The requested LBA is out of range.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+EmulatedFvbGetBlockSize (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN        EFI_LBA                             Lba,
+  OUT       UINTN                               *BlockSize,
+  OUT       UINTN                               *NumberOfBlocks
+  )
+{
+  if (Lba >= FLASH_BLOCK_COUNT) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *BlockSize      = FLASH_BLOCK_SIZE;
+  *NumberOfBlocks = FLASH_BLOCK_COUNT - (UINTN) Lba;
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads from the emulated flash.
+
+  @param[in]      This      Indicates the EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL instance.
+  @param[in]      Lba       The starting logical block index from which to read.
+  @param[in]      Offset    Offset into the block at which to begin reading.
+  @param[in, out] NumBytes  Pointer to a UINTN, the number of bytes to read.
+  @param[out]     Buffer    Pointer to a caller-allocated buffer.
+
+  @retval EFI_SUCCESS          The emulated flash was read successfully.
+  @retval EFI_BAD_BUFFER_SIZE  The read would go past the end of the flash.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+EmulatedFvbRead (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN        EFI_LBA                             Lba,
+  IN        UINTN                               Offset,
+  IN OUT    UINTN                               *NumBytes,
+  IN OUT    UINT8                               *Buffer
+  )
+{
+  UINTN  Start;
+
+  Start = (UINTN) Lba * FLASH_BLOCK_SIZE + Offset;
+  if (Start + *NumBytes > FLASH_BLOCK_COUNT * FLASH_BLOCK_SIZE) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+  CopyMem (Buffer, mFlash.Flash + Start, *NumBytes);
+  return EFI_SUCCESS;
+}
+
+/**
+  Programs the emulated flash. As on NOR flash, programming can only clear
+  bits, so a write to a block that was not erased corrupts it.
+
+  @param[in]      This      Indicates the EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL instance.
+  @param[in]      Lba       The starting logical block index to write to.
+  @param[in]      Offset    Offset into the block at which to begin writing.
+  @param[in, out] NumBytes  Pointer to a UINTN, the number of bytes to write.
+  @param[in]      Buffer    Pointer to a caller-allocated buffer that contains the source.
+
+  @retval EFI_SUCCESS          The emulated flash was written successfully.
+  @retval EFI_BAD_BUFFER_SIZE  The write would go past the end of the flash.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+EmulatedFvbWrite (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  IN        EFI_LBA                             Lba,
+  IN        UINTN                               Offset,
+  IN OUT    UINTN                               *NumBytes,
+  IN        UINT8                               *Buffer
+  )
+{
+  UINTN  Start;
+  UINTN  Index;
+
+  Start = (UINTN) Lba * FLASH_BLOCK_SIZE + Offset;
+  if (Start + *NumBytes > FLASH_BLOCK_COUNT * FLASH_BLOCK_SIZE) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+  for (Index = 0; Index < *NumBytes; Index++) {
+    mFlash.Flash[Start + Index] &= Buffer[Index];
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Erases blocks of the emulated flash and counts the erases.
+
+  @param[in] This   Indicates the EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL instance.
+  @param     ...    Pairs of starting LBA and number of blocks, terminated by
+                    EFI_LBA_LIST_TERMINATOR.
+
+  @retval EFI_SUCCESS            The erase request successfully completed.
+  @retval EFI_DEVICE_ERROR       The emulated power failure happened.
+  @retval EFI_INVALID_PARAMETER  The blocks are out of range.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+EmulatedFvbEraseBlocks (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *This,
+  ...
+  )
+{
+  VA_LIST  Args;
+  EFI_LBA  Lba;
+  UINTN    NumberOfBlocks;
+
+  VA_START (Args, This);
+  while ((Lba = VA_ARG (Args, EFI_LBA)) != EFI_LBA_LIST_TERMINATOR) {
+    NumberOfBlocks = VA_ARG (Args, UINTN);
+    if (Lba + NumberOfBlocks > FLASH_BLOCK_COUNT) {
+      VA_END (Args);
+      return EFI_INVALID_PARAMETER;
+    }
+    for (; NumberOfBlocks > 0; Lba++, NumberOfBlocks--) {
+      if (Lba < FLASH_TARGET_LBA + FLASH_TARGET_BLOCKS) {
+        if (mFlash.FailTargetEraseAfter == 0) {
+          VA_END (Args);
+          return EFI_DEVICE_ERROR;
+        }
+        if (mFlash.FailTargetEraseAfter != MAX_UINTN) {
+          mFlash.FailTargetEraseAfter--;
+        }
+      }
+      SetMem (mFlash.Flash + (UINTN) Lba * FLASH_BLOCK_SIZE, FLASH_BLOCK_SIZE, FTW_ERASED_BYTE);
+      mFlash.EraseCount[Lba]++;
+    }
+  }
+  VA_END (Args);
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieve the FVB protocol interface by HANDLE. The emulated flash is the
+  only FVB.
+
+  @param[in]  FvBlockHandle     The handle of FVB protocol that provides services for
+                                reading, writing, and erasing the target block.
+  @param[out] FvBlock           The interface of FVB protocol
+
+  @retval EFI_SUCCESS           The interface information for the specified protocol was returned.
+  @retval EFI_UNSUPPORTED       The device does not support the FVB protocol.
+**/
+EFI_STATUS
+FtwGetFvbByHandle (
+  IN  EFI_HANDLE                          FvBlockHandle,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvBlock
+  )
+{
+  if (FvBlockHandle != (EFI_HANDLE) &mFlash) {
+    return EFI_UNSUPPORTED;
+  }
+  *FvBlock = &mFlash.Fvb;
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieve the Swap Address Range protocol interface. There is none.
+
+  @param[out] SarProtocol       The interface of SAR protocol
+
+  @retval EFI_NOT_FOUND         The SAR protocol instance was not found.
+**/
+EFI_STATUS
+FtwGetSarProtocol (
+  OUT VOID                                **SarProtocol
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Function returns an array of handles that support the FVB protocol
+  in a buffer allocated from pool.
+
+  @param[out]  NumberHandles    The number of handles returned in Buffer.
+  @param[out]  Buffer           A pointer to the buffer to return the requested
+                                array of  handles that support FVB protocol.
+
+  @retval EFI_SUCCESS           The array of handles was returned in Buffer, and the number of
+                                handles in Buffer was returned in NumberHandles.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough pool memory to store the matching results.
+**/
+EFI_STATUS
+GetFvbCountAndBuffer (
+  OUT UINTN                               *NumberHandles,
+  OUT EFI_HANDLE                          **Buffer
+  )
+{
+  *Buffer = AllocatePool (sizeof (EFI_HANDLE));
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  **Buffer       = (EFI_HANDLE) &mFlash;
+  *NumberHandles = 1;
+  return EFI_SUCCESS;
+}
+
+/**
+  Computes and returns a 32-bit CRC for a data buffer.
+
+  @param[in]  Buffer       A pointer to the buffer on which the 32-bit CRC is to be computed.
+  @param[in]  Length       The number of bytes in the buffer Data.
+
+  @retval Crc32            The 32-bit CRC was computed for the data buffer.
+**/
+UINT32
+FtwCalculateCrc32 (
+  IN  VOID                         *Buffer,
+  IN  UINTN                        Length
+  )
+{
+  return CalculateCrc32 (Buffer, Length);
+}
+
+/**
+  Starts the FTW driver on the emulated flash, as the driver entry point does
+  after a reset.
+
+  @retval EFI_SUCCESS  The FTW driver is started.
+  @retval Others       The FTW driver failed to start.
+**/
+STATIC
+EFI_STATUS
+StartFtw (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  if (mFtwDevice != NULL) {
+    FreePool (mFtwDevice);
+    mFtwDevice = NULL;
+  }
+
+  Status = InitFtwDevice (&mFtwDevice);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  return InitFtwProtocol (mFtwDevice);
+}
+
+/**
+  Creates an emulated flash with known content in the target blocks and
+  starts the FTW driver on it.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                      The flash and the FTW driver are ready.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The FTW driver failed to start.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupFlash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  ZeroMem (&mFlash, sizeof (mFlash));
+  mFlash.Fvb.GetAttributes      = EmulatedFvbGetAttributes;
+  mFlash.Fvb.GetPhysicalAddress = EmulatedFvbGetPhysicalAddress;
+  mFlash.Fvb.GetBlockSize       = EmulatedFvbGetBlockSize;
+  mFlash.Fvb.Read               = EmulatedFvbRead;
+  mFlash.Fvb.Write              = EmulatedFvbWrite;
+  mFlash.Fvb.EraseBlocks        = EmulatedFvbEraseBlocks;
+  mFlash.FailTargetEraseAfter   = MAX_UINTN;
+
+  mFlash.Flash = AllocateAlignedPages (EFI_SIZE_TO_PAGES (FLASH_BLOCK_COUNT * FLASH_BLOCK_SIZE), FLASH_BLOCK_SIZE);
+  if (mFlash.Flash == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  SetMem (mFlash.Flash, FLASH_BLOCK_COUNT * FLASH_BLOCK_SIZE, FTW_ERASED_BYTE);
+  for (Index = 0; Index < FLASH_TARGET_BLOCKS * FLASH_BLOCK_SIZE; Index++) {
+    mFlash.Flash[FLASH_TARGET_LBA * FLASH_BLOCK_SIZE + Index] = (UINT8) (Index % 251);
+  }
+
+  PatchPcdSet64 (PcdFlashNvStorageFtwWorkingBase64, (UINT64) (UINTN) (mFlash.Flash + FLASH_WORKING_LBA * FLASH_BLOCK_SIZE));
+  PatchPcdSet32 (PcdFlashNvStorageFtwWorkingSize, FLASH_BLOCK_SIZE);
+  PatchPcdSet64 (PcdFlashNvStorageFtwSpareBase64, (UINT64) (UINTN) (mFlash.Flash + FLASH_SPARE_LBA * FLASH_BLOCK_SIZE));
+  PatchPcdSet32 (PcdFlashNvStorageFtwSpareSize, FLASH_SPARE_BLOCKS * FLASH_BLOCK_SIZE);
+
+  if (EFI_ERROR (StartFtw ())) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  ZeroMem (mFlash.EraseCount, sizeof (mFlash.EraseCount));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Stops the FTW driver and frees the emulated flash.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupFlash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mFtwDevice != NULL) {
+    FtwTransactionAbort (&mFtwDevice->FtwTransactionInstance);
+    FreePool (mFtwDevice);
+    mFtwDevice = NULL;
+  }
+  if (mFlash.Flash != NULL) {
+    FreeAlignedPages (mFlash.Flash, EFI_SIZE_TO_PAGES (FLASH_BLOCK_COUNT * FLASH_BLOCK_SIZE));
+    mFlash.Flash = NULL;
+  }
+}
+
+/**
+  Returns a copy of the target blocks with mTestWrites applied.
+
+  @return The expected content of the target blocks, or NULL.
+**/
+STATIC
+UINT8 *
+ExpectedTargetBlocks (
+  VOID
+  )
+{
+  UINT8  *Expected;
+  UINTN  Index;
+
+  Expected = AllocateCopyPool (FLASH_TARGET_BLOCKS * FLASH_BLOCK_SIZE, mFlash.Flash + FLASH_TARGET_LBA * FLASH_BLOCK_SIZE);
+  if (Expected != NULL) {
+    for (Index = 0; Index < ARRAY_SIZE (mTestWrites); Index++) {
+      SetMem (Expected + mTestWrites[Index].Offset, mTestWrites[Index].Length, mTestWrites[Index].Value);
+    }
+  }
+  return Expected;
+}
+
+/**
+  Starts a transaction on the target blocks and queues mTestWrites in it.
+
+  @retval EFI_SUCCESS  All the writes are queued.
+  @retval Others       A write failed to queue.
+**/
+STATIC
+EFI_STATUS
+QueueTestWrites (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINT8       Buffer[0x100];
+
+  Status = FtwTransactionBegin (&mFtwDevice->FtwTransactionInstance, (EFI_HANDLE) &mFlash);
+  for (Index = 0; !EFI_ERROR (Status) && (Index < ARRAY_SIZE (mTestWrites)); Index++) {
+    SetMem (Buffer, mTestWrites[Index].Length, mTestWrites[Index].Value);
+    Status = FtwTransactionWrite (
+               &mFtwDevice->FtwTransactionInstance,
+               FLASH_TARGET_LBA + mTestWrites[Index].Offset / FLASH_BLOCK_SIZE,
+               mTestWrites[Index].Offset % FLASH_BLOCK_SIZE,
+               mTestWrites[Index].Length,
+               Buffer
+               );
+  }
+  return Status;
+}
+
+/**
+  A committed transaction must leave the same content in flash as the
+  separate fault tolerant writes it replaces, for one spare block cycle
+  instead of one per write.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CommitCostsOneSpareCycle (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Expected;
+  UINTN       Index;
+  UINT8       Buffer[0x100];
+  UINTN       SeparateSpareErases;
+  UINTN       SeparateTargetErases;
+  UINTN       TransactionSpareErases;
+  UINTN       TransactionTargetErases;
+
+  Expected = ExpectedTargetBlocks ();
+  UT_ASSERT_NOT_NULL (Expected);
+
+  //
+  // One fault tolerant write per queued write.
+  //
+  for (Index = 0; Index < ARRAY_SIZE (mTestWrites); Index++) {
+    SetMem (Buffer, mTestWrites[Index].Length, mTestWrites[Index].Value);
+    Status = FtwWrite (
+               &mFtwDevice->FtwInstance,
+               FLASH_TARGET_LBA + mTestWrites[Index].Offset / FLASH_BLOCK_SIZE,
+               mTestWrites[Index].Offset % FLASH_BLOCK_SIZE,
+               mTestWrites[Index].Length,
+               NULL,
+               (EFI_HANDLE) &mFlash,
+               Buffer
+               );
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  UT_ASSERT_MEM_EQUAL (mFlash.Flash + FLASH_TARGET_LBA * FLASH_BLOCK_SIZE, Expected, FLASH_TARGET_BLOCKS * FLASH_BLOCK_SIZE);
+  SeparateSpareErases  = EraseCount (FLASH_SPARE_LBA, FLASH_SPARE_BLOCKS);
+  SeparateTargetErases = EraseCount (FLASH_TARGET_LBA, FLASH_TARGET_BLOCKS);
+
+  //
+  // The same writes in one transaction, on a fresh flash.
+  //
+  CleanupFlash (NULL);
+  UT_ASSERT_EQUAL (SetupFlash (NULL), UNIT_TEST_PASSED);
+  Status = QueueTestWrites ();
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (EraseCount (0, FLASH_BLOCK_COUNT), 0);
+  Status = FtwTransactionCommit (&mFtwDevice->FtwTransactionInstance, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_MEM_EQUAL (mFlash.Flash + FLASH_TARGET_LBA * FLASH_BLOCK_SIZE, Expected, FLASH_TARGET_BLOCKS * FLASH_BLOCK_SIZE);
+  TransactionSpareErases  = EraseCount (FLASH_SPARE_LBA, FLASH_SPARE_BLOCKS);
+  TransactionTargetErases = EraseCount (FLASH_TARGET_LBA, FLASH_TARGET_BLOCKS);
+
+  UT_LOG_INFO (
+    "%d writes, spare block erases: separate %d, transaction %d\n",
+    ARRAY_SIZE (mTestWrites),
+    SeparateSpareErases,
+    TransactionSpareErases
+    );
+  UT_LOG_INFO (
+    "%d writes, target block erases: separate %d, transaction %d\n",
+    ARRAY_SIZE (mTestWrites),
+    SeparateTargetErases,
+    TransactionTargetErases
+    );
+  UT_ASSERT_EQUAL (TransactionSpareErases * ARRAY_SIZE (mTestWrites), SeparateSpareErases);
+  //
+  // Target blocks 0 to 3 change, each is erased once.
+  //
+  UT_ASSERT_EQUAL (TransactionTargetErases, 4);
+  UT_ASSERT_TRUE (TransactionTargetErases < SeparateTargetErases);
+
+  FreePool (Expected);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A fault tolerant write must not erase the target blocks whose content does
+  not change.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+WriteSkipsUnchangedBlocks (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Buffer;
+
+  //
+  // Rewrite target blocks 1 to 5 with their own content, except one byte in
+  // block 3.
+  //
+  Buffer = AllocateCopyPool (5 * FLASH_BLOCK_SIZE, mFlash.Flash + (FLASH_TARGET_LBA + 1) * FLASH_BLOCK_SIZE);
+  UT_ASSERT_NOT_NULL (Buffer);
+  Buffer[2 * FLASH_BLOCK_SIZE + 7] = 0;
+
+  Status = FtwWrite (&mFtwDevice->FtwInstance, FLASH_TARGET_LBA + 1, 0, 5 * FLASH_BLOCK_SIZE, NULL, (EFI_HANDLE) &mFlash, Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_MEM_EQUAL (mFlash.Flash + (FLASH_TARGET_LBA + 1) * FLASH_BLOCK_SIZE, Buffer, 5 * FLASH_BLOCK_SIZE);
+  UT_ASSERT_EQUAL (EraseCount (FLASH_TARGET_LBA, FLASH_TARGET_BLOCKS), 1);
+  UT_ASSERT_EQUAL (EraseCount (FLASH_TARGET_LBA + 3, 1), 1);
+
+  FreePool (Buffer);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A commit interrupted by a power failure once the spare block holds the new
+  content must be completed when the FTW driver starts again.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+InterruptedCommitIsRestarted (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Expected;
+
+  Expected = ExpectedTargetBlocks ();
+  UT_ASSERT_NOT_NULL (Expected);
+
+  Status = QueueTestWrites ();
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // Lose power when erasing the second target block.
+  //
+  mFlash.FailTargetEraseAfter = 1;
+  Status = FtwTransactionCommit (&mFtwDevice->FtwTransactionInstance, NULL);
+  UT_ASSERT_TRUE (EFI_ERROR (Status));
+  UT_ASSERT_FALSE (mFtwDevice->TransactionActive);
+  UT_ASSERT_TRUE (CompareMem (mFlash.Flash + FLASH_TARGET_LBA * FLASH_BLOCK_SIZE, Expected, FLASH_TARGET_BLOCKS * FLASH_BLOCK_SIZE) != 0);
+
+  mFlash.FailTargetEraseAfter = MAX_UINTN;
+  Status = StartFtw ();
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_MEM_EQUAL (mFlash.Flash + FLASH_TARGET_LBA * FLASH_BLOCK_SIZE, Expected, FLASH_TARGET_BLOCKS * FLASH_BLOCK_SIZE);
+
+  FreePool (Expected);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The transaction protocol must reject calls out of order and transactions
+  larger than the spare block, and an aborted or empty transaction must leave
+  the flash untouched.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED             The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+TransactionStateIsChecked (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_FAULT_TOLERANT_WRITE_TRANSACTION_PROTOCOL  *Transaction;
+  UINT8                                            Buffer[0x10];
+  UINT8                                            *Original;
+
+  Transaction = &mFtwDevice->FtwTransactionInstance;
+  ZeroMem (Buffer, sizeof (Buffer));
+  Original = AllocateCopyPool (FLASH_BLOCK_COUNT * FLASH_BLOCK_SIZE, mFlash.Flash);
+  UT_ASSERT_NOT_NULL (Original);
+
+  UT_ASSERT_STATUS_EQUAL (Transaction->Write (Transaction, 0, 0, sizeof (Buffer), Buffer), EFI_NOT_READY);
+  UT_ASSERT_STATUS_EQUAL (Transaction->Commit (Transaction, NULL), EFI_NOT_READY);
+  UT_ASSERT_STATUS_EQUAL (Transaction->Abort (Transaction), EFI_NOT_READY);
+  UT_ASSERT_STATUS_EQUAL (Transaction->Begin (Transaction, (EFI_HANDLE) Buffer), EFI_NOT_FOUND);
+
+  UT_ASSERT_NOT_EFI_ERROR (Transaction->Begin (Transaction, (EFI_HANDLE) &mFlash));
+  UT_ASSERT_STATUS_EQUAL (Transaction->Begin (Transaction, (EFI_HANDLE) &mFlash), EFI_ACCESS_DENIED);
+  UT_ASSERT_STATUS_EQUAL (Transaction->Write (Transaction, 0, 0, 0, Buffer), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (Transaction->Write (Transaction, 0, 0, sizeof (Buffer), NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_NOT_EFI_ERROR (Transaction->Write (Transaction, 0, FLASH_BLOCK_SIZE - 1, sizeof (Buffer), Buffer));
+  UT_ASSERT_NOT_EFI_ERROR (Transaction->Write (Transaction, FLASH_SPARE_BLOCKS - 1, 0, sizeof (Buffer), Buffer));
+  UT_ASSERT_STATUS_EQUAL (Transaction->Write (Transaction, FLASH_SPARE_BLOCKS, 0, sizeof (Buffer), Buffer), EFI_BAD_BUFFER_SIZE);
+  UT_ASSERT_NOT_EFI_ERROR (Transaction->Abort (Transaction));
+  UT_ASSERT_STATUS_EQUAL (Transaction->Abort (Transaction), EFI_NOT_READY);
+
+  UT_ASSERT_NOT_EFI_ERROR (Transaction->Begin (Transaction, (EFI_HANDLE) &mFlash));
+  UT_ASSERT_NOT_EFI_ERROR (Transaction->Commit (Transaction, NULL));
+
+  UT_ASSERT_EQUAL (EraseCount (0, FLASH_BLOCK_COUNT), 0);
+  UT_ASSERT_MEM_EQUAL (mFlash.Flash, Original, FLASH_BLOCK_COUNT * FLASH_BLOCK_SIZE);
+
+  FreePool (Original);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  fault tolerant write transactions and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TransactionTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the fault tolerant write transaction Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&TransactionTests, Framework, "FaultTolerantWrite Transaction Tests", "FaultTolerantWrite.Transaction", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TransactionTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (TransactionTests, "Commit should cost one spare block cycle",  "OneSpareCycle", CommitCostsOneSpareCycle,     SetupFlash, CleanupFlash, NULL);
+  AddTestCase (TransactionTests, "Write should skip unchanged target blocks", "SkipUnchanged", WriteSkipsUnchangedBlocks,    SetupFlash, CleanupFlash, NULL);
+  AddTestCase (TransactionTests, "Interrupted commit should be restarted",    "PowerFailure",  InterruptedCommitIsRestarted, SetupFlash, CleanupFlash, NULL);
+  AddTestCase (TransactionTests, "Transaction calls should be checked",       "State",         TransactionStateIsChecked,    SetupFlash, CleanupFlash, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,58 @@
+/** @file
+  Search of the DynamicEx token map of a PCD database, shared by the PEI and
+  DXE PCD drivers.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "ExMapTable.h"
+
+/**
+  Search the ExMap table for a dynamic-ex PCD.
+
+  The build tool sorts the ExMap table by {ExGuidIndex, ExTokenNumber}, so
+  it is searched with a binary search.
+
+  @param ExMap           The ExMap table of a PCD database.
+  @param ExTokenCount    The number of entries in ExMap.
+  @param GuidIndex       Index of the token space guid in the GuidTable.
+  @param ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or PCD_INVALID_TOKEN_NUMBER if it
+          is not in ExMap.
+
+**/
+UINTN
+SearchExMapTable (
+  IN CONST DYNAMICEX_MAPPING    *ExMap,
+  IN UINTN                      ExTokenCount,
+  IN UINTN                      GuidIndex,
+  IN UINTN                      ExTokenNumber
+  )
+{
+  UINTN               Low;
+  UINTN               High;
+  UINTN               Middle;
+
+  Low  = 0;
+  High = ExTokenCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if ((ExMap[Middle].ExGuidIndex < GuidIndex) ||
+        ((ExMap[Middle].ExGuidIndex == GuidIndex) && (ExMap[Middle].ExTokenNumber < ExTokenNumber))) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if ((Low < ExTokenCount) &&
+      (ExMap[Low].ExGuidIndex == GuidIndex) &&
+      (ExMap[Low].ExTokenNumber == ExTokenNumber)) {
+    return ExMap[Low].TokenNumber;
+  }
+
+  return PCD_INVALID_TOKEN_NUMBER;
+}
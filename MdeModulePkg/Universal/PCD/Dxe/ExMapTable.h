@@ -0,0 +1,40 @@
+/** @file
+  Search of the DynamicEx token map of a PCD database, shared by the PEI and
+  DXE PCD drivers.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PCD_EX_MAP_TABLE_H_
+#define _PCD_EX_MAP_TABLE_H_
+
+#include <Uefi/UefiBaseType.h>
+#include <Guid/PcdDataBaseSignatureGuid.h>
+#include <Protocol/Pcd.h>
+
+/**
+  Search the ExMap table for a dynamic-ex PCD.
+
+  The build tool sorts the ExMap table by {ExGuidIndex, ExTokenNumber}, so
+  it is searched with a binary search.
+
+  @param ExMap           The ExMap table of a PCD database.
+  @param ExTokenCount    The number of entries in ExMap.
+  @param GuidIndex       Index of the token space guid in the GuidTable.
+  @param ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or PCD_INVALID_TOKEN_NUMBER if it
+          is not in ExMap.
+
+**/
+UINTN
+SearchExMapTable (
+  IN CONST DYNAMICEX_MAPPING    *ExMap,
+  IN UINTN                      ExTokenCount,
+  IN UINTN                      GuidIndex,
+  IN UINTN                      ExTokenNumber
+  );
+
+#endif
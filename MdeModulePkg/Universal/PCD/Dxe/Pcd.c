@@ -3,7 +3,7 @@
   produce the implementation of native PCD protocol and EFI_PCD_PROTOCOL defined in
   PI 1.4a Vol3.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -105,6 +105,48 @@ EFI_GET_PCD_INFO_PROTOCOL  mEfiGetPcdInfoInstance = {
 EFI_HANDLE mPcdHandle = NULL;
 UINTN      mVpdBaseAddress = 0;
 
+/**
+  Notification function of the gEdkiiVariableWriteEventGroupGuid event group.
+
+  A variable was set, so the values of the HII type PCDs read from their
+  variables may be stale.
+
+  @param  Event     Event whose notification function is being invoked.
+  @param  Context   Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+HiiPcdVariableWriteNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  //
+  // Running at TPL_NOTIFY, this can not interrupt a holder of mPcdDatabaseLock.
+  //
+  HiiPcdValueCacheInvalidate ();
+}
+
+/**
+  Notification function of the ReadyToBoot event, reporting the variable reads
+  saved by the HII type PCD value cache.
+
+  @param  Event     Event whose notification function is being invoked.
+  @param  Context   Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+HiiPcdValueCacheReport (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  DEBUG ((DEBUG_INFO, "PcdDxe - HII type PCD value cache saved %Lu variable reads\n", (UINT64) mHiiPcdVariableReadsSaved));
+  gBS->CloseEvent (Event);
+}
+
 /**
   Main entry for PCD DXE driver.
 
@@ -125,6 +167,7 @@ PcdDxeInit (
 {
   EFI_STATUS Status;
   VOID       *Registration;
+  EFI_EVENT  Event;
 
   //
   // Make sure the Pcd Protocol is not already installed in the system
@@ -170,6 +213,28 @@ PcdDxeInit (
     &Registration
     );
 
+  if (FeaturePcdGet (PcdHiiPcdValueCacheEnable)) {
+    //
+    // Drop the cached values of the HII type PCDs whenever a variable is set.
+    //
+    Status = gBS->CreateEventEx (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    HiiPcdVariableWriteNotify,
+                    NULL,
+                    &gEdkiiVariableWriteEventGroupGuid,
+                    &Event
+                    );
+    ASSERT_EFI_ERROR (Status);
+
+    EfiCreateEventReadyToBootEx (
+      TPL_CALLBACK,
+      HiiPcdValueCacheReport,
+      NULL,
+      &Event
+      );
+  }
+
   //
   // Cache VpdBaseAddress in entry point for the following usage.
   //
@@ -311,6 +376,10 @@ DxePcdSetSku (
       DEBUG ((DEBUG_INFO, "PcdDxe - SkuId is found in SkuId table.\n"));
       Status = UpdatePcdDatabase (SkuId, TRUE);
       if (!EFI_ERROR (Status)) {
+        //
+        // The default values of the HII type PCDs have changed.
+        //
+        HiiPcdValueCacheInvalidate ();
         mPcdDatabase.DxeDb->SystemSkuId = (SKU_ID) SkuId;
         DEBUG ((DEBUG_INFO, "PcdDxe - Set current SKU Id to 0x%lx.\n", (SKU_ID) SkuId));
         return;
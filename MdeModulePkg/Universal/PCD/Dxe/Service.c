@@ -2,7 +2,7 @@
     Help functions used by PCD DXE driver.
 
 Copyright (c) 2014, Hewlett-Packard Development Company, L.P.<BR>
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 (C) Copyright 2016 Hewlett Packard Enterprise Development LP<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -28,6 +28,8 @@ BOOLEAN        mDxeExMapTableEmpty;
 BOOLEAN        mPeiDatabaseEmpty;
 
 LIST_ENTRY    *mCallbackFnTable;
+BOOLEAN       *mHiiPcdValueCached;
+UINTN          mHiiPcdVariableReadsSaved;
 EFI_GUID     **TmpTokenSpaceBuffer;
 UINTN          TmpTokenSpaceBufferCount;
 
@@ -456,7 +458,20 @@ GetWorker (
       } else {
         VaraiableDefaultBuffer = (UINT8 *) PcdDb + VariableHead->DefaultValueOffset;
       }
+      if ((mHiiPcdValueCached != NULL) && mHiiPcdValueCached[TmpTokenNumber]) {
+        //
+        // The default value buffer already holds the value of the variable,
+        // and the variable has not been set since it was read.
+        //
+        mHiiPcdVariableReadsSaved++;
+        RetPtr = (VOID *) VaraiableDefaultBuffer;
+        break;
+      }
+
       Status = GetHiiVariable (Guid, Name, &Data, &DataSize);
+      if ((mHiiPcdValueCached != NULL) && ((Status == EFI_SUCCESS) || (Status == EFI_NOT_FOUND))) {
+        mHiiPcdValueCached[TmpTokenNumber] = TRUE;
+      }
       if (Status == EFI_SUCCESS) {
         if (DataSize >= (VariableHead->Offset + GetSize)) {
           if (GetSize == 0) {
@@ -926,6 +941,14 @@ BuildPcdDxeDataBase (
   mCallbackFnTable = AllocateZeroPool (mPcdTotalTokenCount * sizeof (LIST_ENTRY));
   ASSERT(mCallbackFnTable != NULL);
 
+  //
+  // Initialized the HII type PCD value cache flags
+  //
+  if (FeaturePcdGet (PcdHiiPcdValueCacheEnable)) {
+    mHiiPcdValueCached = AllocateZeroPool (mPcdTotalTokenCount * sizeof (BOOLEAN));
+    ASSERT (mHiiPcdValueCached != NULL);
+  }
+
   //
   // EBC compiler is very choosy. It may report warning about comparison
   // between UINTN and 0 . So we add 1 in each size of the
@@ -936,6 +959,23 @@ BuildPcdDxeDataBase (
   }
 }
 
+/**
+  Drop the values of the HII type PCDs read from their variables, so that the
+  next read of every HII type PCD reads its variable again.
+
+  The caller must hold mPcdDatabaseLock, or run at TPL_NOTIFY.
+
+**/
+VOID
+HiiPcdValueCacheInvalidate (
+  VOID
+  )
+{
+  if (mHiiPcdValueCached != NULL) {
+    ZeroMem (mHiiPcdValueCached, mPcdTotalTokenCount * sizeof (BOOLEAN));
+  }
+}
+
 /**
   Get Variable which contains HII type PCD entry.
 
@@ -1217,6 +1257,7 @@ SetWorker (
       VariableOffset = VariableHead->Offset;
       Attributes = VariableHead->Attributes;
       Status = SetHiiVariable (Guid, Name, Attributes, Data, *Size, VariableOffset);
+      HiiPcdValueCacheInvalidate ();
       break;
 
     case PCD_TYPE_DATA:
@@ -1566,11 +1607,11 @@ GetExPcdTokenNumber (
   IN UINT32                     ExTokenNumber
   )
 {
-  UINT32              Index;
   DYNAMICEX_MAPPING   *ExMap;
   EFI_GUID            *GuidTable;
   EFI_GUID            *MatchGuid;
   UINTN               MatchGuidIdx;
+  UINTN               TokenNumber;
 
   if (!mPeiDatabaseEmpty) {
     ExMap       = (DYNAMICEX_MAPPING *)((UINT8 *)mPcdDatabase.PeiDb + mPcdDatabase.PeiDb->ExMapTableOffset);
@@ -1582,11 +1623,9 @@ GetExPcdTokenNumber (
 
       MatchGuidIdx = MatchGuid - GuidTable;
 
-      for (Index = 0; Index < mPcdDatabase.PeiDb->ExTokenCount; Index++) {
-        if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-            (MatchGuidIdx == ExMap[Index].ExGuidIndex)) {
-            return ExMap[Index].TokenNumber;
-        }
+      TokenNumber = SearchExMapTable (ExMap, mPcdDatabase.PeiDb->ExTokenCount, MatchGuidIdx, ExTokenNumber);
+      if (TokenNumber != PCD_INVALID_TOKEN_NUMBER) {
+        return TokenNumber;
       }
     }
   }
@@ -1603,16 +1642,10 @@ GetExPcdTokenNumber (
 
   MatchGuidIdx = MatchGuid - GuidTable;
 
-  for (Index = 0; Index < mPcdDatabase.DxeDb->ExTokenCount; Index++) {
-    if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-         (MatchGuidIdx == ExMap[Index].ExGuidIndex)) {
-        return ExMap[Index].TokenNumber;
-    }
-  }
-
-  ASSERT (FALSE);
+  TokenNumber = SearchExMapTable (ExMap, mPcdDatabase.DxeDb->ExTokenCount, MatchGuidIdx, ExTokenNumber);
+  ASSERT (TokenNumber != PCD_INVALID_TOKEN_NUMBER);
 
-  return 0;
+  return TokenNumber;
 }
 
 /**
@@ -1,7 +1,7 @@
 /** @file
 Private functions used by PCD DXE driver.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -12,6 +12,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <PiDxe.h>
 #include <Guid/PcdDataBaseHobGuid.h>
 #include <Guid/PcdDataBaseSignatureGuid.h>
+#include <Guid/VariableWriteEventGroup.h>
 #include <Protocol/Pcd.h>
 #include <Protocol/PiPcd.h>
 #include <Protocol/PcdInfo.h>
@@ -29,11 +30,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 
+#include "ExMapTable.h"
+
 //
 // Please make sure the PCD Serivce DXE Version is consistent with
 // the version of the generated DXE PCD Database by build tool.
 //
-#define PCD_SERVICE_DXE_VERSION      7
+#define PCD_SERVICE_DXE_VERSION      8
 
 //
 // PCD_DXE_SERVICE_DRIVER_VERSION is defined in Autogen.h.
@@ -1055,6 +1058,18 @@ BuildPcdDxeDataBase (
   VOID
   );
 
+/**
+  Drop the values of the HII type PCDs read from their variables, so that the
+  next read of every HII type PCD reads its variable again.
+
+  The caller must hold mPcdDatabaseLock, or run at TPL_NOTIFY.
+
+**/
+VOID
+HiiPcdValueCacheInvalidate (
+  VOID
+  );
+
 /**
   Get Token Number according to dynamic-ex PCD's {token space guid:token number}
 
@@ -1191,5 +1206,8 @@ extern  UINTN          TmpTokenSpaceBufferCount;
 
 extern EFI_LOCK mPcdDatabaseLock;
 
+extern  BOOLEAN       *mHiiPcdValueCached;
+extern  UINTN          mHiiPcdVariableReadsSaved;
+
 #endif
 
@@ -0,0 +1,458 @@
+/** @file
+  Unit tests of the search of the DynamicEx token map. SearchExMapTable () is
+  compared with a linear scan of the map for tokens which are in the map and
+  for tokens which are not, on an empty map, a map of one entry and random
+  maps sorted the way the build tool sorts them. Both searches are then timed
+  on maps of growing size.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "../ExMapTable.h"
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestRandomLib.h>
+
+#define UNIT_TEST_APP_NAME        "PCD DXE DynamicEx Map Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// The random maps hold 1 to TEST_MAX_TOKEN_COUNT entries. All their token
+// numbers are below TEST_MISSING_TOKEN_OFFSET, so adding it to a token number
+// makes a token which is not in the map.
+//
+#define TEST_MAP_COUNT            400
+#define TEST_MAX_TOKEN_COUNT      512
+#define TEST_MISSING_TOKEN_OFFSET 0x1000000
+
+//
+// The timed lookups, half of them for tokens which are not in the map, in
+// maps of 16 to TEST_TIMED_MAX_TOKEN_COUNT entries.
+//
+#define TEST_TIMED_LOOKUP_COUNT   100000
+#define TEST_TIMED_MAX_TOKEN_COUNT 2048
+
+CONST UINTN         mTimedTokenCount[] = { 16, 128, 512, TEST_TIMED_MAX_TOKEN_COUNT };
+
+DYNAMICEX_MAPPING   mExMap[TEST_TIMED_MAX_TOKEN_COUNT];
+
+//
+// The {ExGuidIndex, ExTokenNumber} of the timed lookups.
+//
+UINTN               mLookupGuidIndex[TEST_TIMED_LOOKUP_COUNT];
+UINTN               mLookupExTokenNumber[TEST_TIMED_LOOKUP_COUNT];
+
+/**
+  Searches the ExMap table for a dynamic-ex PCD the way the PCD driver did
+  before the table was searched with a binary search.
+
+  @param ExMap           The ExMap table of a PCD database.
+  @param ExTokenCount    The number of entries in ExMap.
+  @param GuidIndex       Index of the token space guid in the GuidTable.
+  @param ExTokenNumber   Dynamic-ex PCD token number.
+
+  @return Token Number for dynamic-ex PCD, or PCD_INVALID_TOKEN_NUMBER if it
+          is not in ExMap.
+**/
+UINTN
+LinearSearchExMapTable (
+  IN CONST DYNAMICEX_MAPPING    *ExMap,
+  IN UINTN                      ExTokenCount,
+  IN UINTN                      GuidIndex,
+  IN UINTN                      ExTokenNumber
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ExTokenCount; Index++) {
+    if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
+        (GuidIndex == ExMap[Index].ExGuidIndex)) {
+      return ExMap[Index].TokenNumber;
+    }
+  }
+
+  return PCD_INVALID_TOKEN_NUMBER;
+}
+
+/**
+  Fills mExMap with a random map sorted by {ExGuidIndex, ExTokenNumber}.
+
+  Token numbers leave gaps, and some token space GUIDs of the GuidTable have
+  no entry, so that searches for tokens between the entries are also made.
+
+  @param[in]  Count  Number of entries of the map.
+**/
+VOID
+BuildExMap (
+  IN UINTN  Count
+  )
+{
+  UINTN   Index;
+  UINT16  GuidIndex;
+  UINT32  ExTokenNumber;
+
+  GuidIndex     = (UINT16) ((UINTN) UnitTestRandom () % 3);
+  ExTokenNumber = (UINT32) ((UINTN) UnitTestRandom () % 16);
+  for (Index = 0; Index < Count; Index++) {
+    mExMap[Index].ExGuidIndex   = GuidIndex;
+    mExMap[Index].ExTokenNumber = ExTokenNumber;
+    mExMap[Index].TokenNumber   = (UINT16) (Index + 1);
+
+    if ((UINTN) UnitTestRandom () % 4 == 0) {
+      GuidIndex     = (UINT16) (GuidIndex + 1 + (UINTN) UnitTestRandom () % 2);
+      ExTokenNumber = (UINT32) ((UINTN) UnitTestRandom () % 16);
+    } else {
+      ExTokenNumber = (UINT32) (ExTokenNumber + 1 + (UINTN) UnitTestRandom () % 4);
+    }
+  }
+}
+
+/**
+  Checks that SearchExMapTable () finds the same token number as the linear
+  scan of a map.
+
+  @param[in]  ExMap          The ExMap table.
+  @param[in]  ExTokenCount   The number of entries in ExMap.
+  @param[in]  GuidIndex      Index of the token space guid in the GuidTable.
+  @param[in]  ExTokenNumber  Dynamic-ex PCD token number.
+
+  @retval UNIT_TEST_PASSED               Both searches found the same token number.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    The searches disagree.
+**/
+UNIT_TEST_STATUS
+CheckSearch (
+  IN CONST DYNAMICEX_MAPPING    *ExMap,
+  IN UINTN                      ExTokenCount,
+  IN UINTN                      GuidIndex,
+  IN UINTN                      ExTokenNumber
+  )
+{
+  UINTN  Expected;
+  UINTN  TokenNumber;
+
+  Expected    = LinearSearchExMapTable (ExMap, ExTokenCount, GuidIndex, ExTokenNumber);
+  TokenNumber = SearchExMapTable (ExMap, ExTokenCount, GuidIndex, ExTokenNumber);
+  if (TokenNumber != Expected) {
+    UT_LOG_ERROR (
+      "{%Lu, 0x%Lx} in a map of %Lu entries: found %Lu, expected %Lu\n",
+      (UINT64) GuidIndex,
+      (UINT64) ExTokenNumber,
+      (UINT64) ExTokenCount,
+      (UINT64) TokenNumber,
+      (UINT64) Expected
+      );
+  }
+  UT_ASSERT_EQUAL (TokenNumber, Expected);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Searches of an empty map find nothing, and do not read the map.
+
+  @param[in]  Context    Unused.
+
+  @retval UNIT_TEST_PASSED               The searches found nothing.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A search found a token.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SearchEmptyMap (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_EQUAL (SearchExMapTable (NULL, 0, 0, 0), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (NULL, 0, 1, 0x10), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (mExMap, 0, 0, 0), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (mExMap, 0, MAX_UINT16, MAX_UINT32), PCD_INVALID_TOKEN_NUMBER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Searches of a map of one entry find the entry, and nothing on either side
+  of it.
+
+  @param[in]  Context    Unused.
+
+  @retval UNIT_TEST_PASSED               The searches found the entry only.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A search found the wrong token.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SearchSingleEntryMap (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  DYNAMICEX_MAPPING  ExMap;
+
+  ExMap.ExTokenNumber = 0x10;
+  ExMap.TokenNumber   = 7;
+  ExMap.ExGuidIndex   = 3;
+
+  UT_ASSERT_EQUAL (SearchExMapTable (&ExMap, 1, 3, 0x10), 7);
+
+  UT_ASSERT_EQUAL (SearchExMapTable (&ExMap, 1, 3, 0x0F), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (&ExMap, 1, 3, 0x11), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (&ExMap, 1, 2, 0x10), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (&ExMap, 1, 4, 0x10), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (&ExMap, 1, 0, 0), PCD_INVALID_TOKEN_NUMBER);
+  UT_ASSERT_EQUAL (SearchExMapTable (&ExMap, 1, MAX_UINT16, MAX_UINT32), PCD_INVALID_TOKEN_NUMBER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Searches of random maps find the same token numbers as the linear scan,
+  both for the tokens of the map and for tokens around them which are not in
+  the map.
+
+  @param[in]  Context    Unused.
+
+  @retval UNIT_TEST_PASSED               All searches agree with the linear scan.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A search disagrees with the linear scan.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SearchMatchesLinearScan (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+  UINTN             MapNumber;
+  UINTN             Count;
+  UINTN             Index;
+  UINTN             GuidIndex;
+  UINTN             ExTokenNumber;
+
+  UnitTestRandomSeed (0x5043445845784D61ULL);
+
+  for (MapNumber = 0; MapNumber < TEST_MAP_COUNT; MapNumber++) {
+    //
+    // Every other map is small, so that the first and last few steps of the
+    // search are taken often.
+    //
+    if (MapNumber % 2 == 0) {
+      Count = (UINTN) UnitTestRandom () % 8 + 1;
+    } else {
+      Count = (UINTN) UnitTestRandom () % TEST_MAX_TOKEN_COUNT + 1;
+    }
+    BuildExMap (Count);
+
+    for (Index = 0; Index < Count; Index++) {
+      GuidIndex     = mExMap[Index].ExGuidIndex;
+      ExTokenNumber = mExMap[Index].ExTokenNumber;
+
+      UT_ASSERT_EQUAL (SearchExMapTable (mExMap, Count, GuidIndex, ExTokenNumber), mExMap[Index].TokenNumber);
+      UT_ASSERT_EQUAL (
+        SearchExMapTable (mExMap, Count, GuidIndex, ExTokenNumber + TEST_MISSING_TOKEN_OFFSET),
+        PCD_INVALID_TOKEN_NUMBER
+        );
+
+      Status = CheckSearch (mExMap, Count, GuidIndex, ExTokenNumber + 1);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+      Status = CheckSearch (mExMap, Count, GuidIndex, ExTokenNumber - 1);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+      Status = CheckSearch (mExMap, Count, GuidIndex + 1, ExTokenNumber);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+      Status = CheckSearch (mExMap, Count, GuidIndex - 1, ExTokenNumber);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+
+    //
+    // Tokens before the first entry and after the last one.
+    //
+    Status = CheckSearch (mExMap, Count, 0, 0);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+    Status = CheckSearch (mExMap, Count, mExMap[Count - 1].ExGuidIndex, MAX_UINT32);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+    Status = CheckSearch (mExMap, Count, MAX_UINT16, 0);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Times the lookups of mLookupGuidIndex and mLookupExTokenNumber in mExMap,
+  with SearchExMapTable () or with the linear scan.
+
+  @param[in]   Count         Number of entries of mExMap.
+  @param[in]   Linear        TRUE to time the linear scan, FALSE to time SearchExMapTable ().
+  @param[out]  TokenSum      The sum of the token numbers found.
+
+  @return The average time of a lookup in nanoseconds.
+**/
+UINT64
+TimeSearches (
+  IN  UINTN    Count,
+  IN  BOOLEAN  Linear,
+  OUT UINTN    *TokenSum
+  )
+{
+  UINTN    Index;
+  clock_t  Start;
+  clock_t  Elapsed;
+
+  *TokenSum = 0;
+  Start = clock ();
+  for (Index = 0; Index < TEST_TIMED_LOOKUP_COUNT; Index++) {
+    if (Linear) {
+      *TokenSum += LinearSearchExMapTable (mExMap, Count, mLookupGuidIndex[Index], mLookupExTokenNumber[Index]);
+    } else {
+      *TokenSum += SearchExMapTable (mExMap, Count, mLookupGuidIndex[Index], mLookupExTokenNumber[Index]);
+    }
+  }
+  Elapsed = clock () - Start;
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000000 / TEST_TIMED_LOOKUP_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Times SearchExMapTable () and the linear scan in random maps of 16 to
+  TEST_TIMED_MAX_TOKEN_COUNT entries, and checks that both find the same
+  tokens.
+
+  @param[in]  Context    Unused.
+
+  @retval UNIT_TEST_PASSED               Both searches found the same tokens.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    The searches disagree.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SearchLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Round;
+  UINTN   Count;
+  UINTN   Index;
+  UINTN   Entry;
+  UINTN   LinearSum;
+  UINTN   BinarySum;
+  UINT64  LinearTime;
+  UINT64  BinaryTime;
+
+  UnitTestRandomSeed (0x5043444C6174656EULL);
+
+  for (Round = 0; Round < ARRAY_SIZE (mTimedTokenCount); Round++) {
+    Count = mTimedTokenCount[Round];
+    BuildExMap (Count);
+    for (Index = 0; Index < TEST_TIMED_LOOKUP_COUNT; Index++) {
+      Entry = (UINTN) UnitTestRandom () % Count;
+      mLookupGuidIndex[Index]     = mExMap[Entry].ExGuidIndex;
+      mLookupExTokenNumber[Index] = mExMap[Entry].ExTokenNumber;
+      if (Index % 2 != 0) {
+        mLookupExTokenNumber[Index] += TEST_MISSING_TOKEN_OFFSET;
+      }
+    }
+
+    LinearTime = TimeSearches (Count, TRUE, &LinearSum);
+    BinaryTime = TimeSearches (Count, FALSE, &BinarySum);
+    UT_ASSERT_EQUAL (BinarySum, LinearSum);
+    UT_LOG_INFO ("%4Lu DynamicEx tokens: linear %Lu ns, binary %Lu ns\n", (UINT64) Count, LinearTime, BinaryTime);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the search of
+  the DynamicEx token map and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ExMapTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the DynamicEx map search Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&ExMapTests, Framework, "PCD DynamicEx Map Search Tests", "Pcd.ExMap", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ExMapTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (ExMapTests, "Search of an empty map should find nothing",        "Empty",       SearchEmptyMap,          NULL, NULL, NULL);
+  AddTestCase (ExMapTests, "Search of a map of one entry should find it only",  "SingleEntry", SearchSingleEntryMap,    NULL, NULL, NULL);
+  AddTestCase (ExMapTests, "Search should match the linear scan of random maps", "MatchScan",  SearchMatchesLinearScan, NULL, NULL, NULL);
+  AddTestCase (ExMapTests, "Search latency against the map size",               "Latency",    SearchLatency,           NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -2,7 +2,7 @@
   The driver internal functions are implmented here.
   They build Pei PCD database, and provide access service to PCD database.
 
-Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -978,7 +978,6 @@ GetExPcdTokenNumber (
   IN UINTN                      ExTokenNumber
   )
 {
-  UINT32              Index;
   DYNAMICEX_MAPPING   *ExMap;
   EFI_GUID            *GuidTable;
   EFI_GUID            *MatchGuid;
@@ -999,14 +998,7 @@ GetExPcdTokenNumber (
 
   MatchGuidIdx = MatchGuid - GuidTable;
 
-  for (Index = 0; Index < PeiPcdDb->ExTokenCount; Index++) {
-    if ((ExTokenNumber == ExMap[Index].ExTokenNumber) &&
-        (MatchGuidIdx == ExMap[Index].ExGuidIndex)) {
-      return ExMap[Index].TokenNumber;
-    }
-  }
-
-  return PCD_INVALID_TOKEN_NUMBER;
+  return SearchExMapTable (ExMap, PeiPcdDb->ExTokenCount, MatchGuidIdx, ExTokenNumber);
 }
 
 /**
@@ -0,0 +1,1180 @@
+/** @file
+  Unit tests of the lookups of the PEI variable driver in the NV variable
+  store. The lookups through the VARIABLE_INDEX_TABLE used before permanent
+  memory is installed, and through the VARIABLE_STORE_INDEX built after, are
+  compared with the walk of the store over random stores, and the three are
+  timed on stores of growing size.
+
+  The enumeration of the variables resumed from the variable returned by the
+  last PeiGetNextVariableName () call is also compared with the enumeration
+  which searches for that variable, and both are timed.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "../Variable.h"
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestRandomLib.h>
+
+#define UNIT_TEST_APP_NAME        "PEI Variable Lookup Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Each random store holds up to TEST_VARIABLE_MAX variables named after
+// TEST_NAME_COUNT names, under one of TEST_GUID_COUNT vendor GUIDs. Lookups
+// also ask for names which are never set.
+//
+#define TEST_STORE_SIZE           SIZE_64KB
+#define TEST_STORE_COUNT          1500
+#define TEST_VARIABLE_MAX         400
+#define TEST_NAME_COUNT           192
+#define TEST_LOOKUP_NAME_COUNT    (TEST_NAME_COUNT + 8)
+#define TEST_NAME_LENGTH          16
+#define TEST_GUID_COUNT           2
+#define TEST_LOOKUP_COUNT         200
+
+//
+// The timed lookups, in stores of 32 to 2048 variables.
+//
+#define TEST_TIMED_STORE_COUNT    4
+#define TEST_TIMED_LOOKUP_COUNT   10000
+
+//
+// The random stores enumerated, and the variables the HOB variable store
+// holds to override some of the NV variables.
+//
+#define TEST_ENUMERATION_STORE_COUNT  300
+#define TEST_HOB_VARIABLE_COUNT       8
+#define TEST_ENUMERATION_MAX          (TEST_VARIABLE_MAX + TEST_HOB_VARIABLE_COUNT)
+
+//
+// The timed enumerations, in stores of 100, 1000 and 2000 variables.
+//
+#define TEST_TIMED_ENUMERATION_COUNT  5
+
+//
+// Size of the buffer of the emulated HOB list.
+//
+#define TEST_HOB_LIST_SIZE        SIZE_128KB
+
+//
+// The NV variable store follows a firmware volume header with a two-entry
+// block map.
+//
+#define TEST_FV_HEADER_LENGTH     (sizeof (EFI_FIRMWARE_VOLUME_HEADER) + sizeof (EFI_FV_BLOCK_MAP_ENTRY))
+
+//
+// Functions of Variable.c which are not declared in Variable.h.
+//
+VARIABLE_HEADER *
+GetStartPointer (
+  IN VARIABLE_STORE_HEADER       *VarStoreHeader
+  );
+
+VARIABLE_HEADER *
+GetEndPointer (
+  IN VARIABLE_STORE_HEADER       *VarStoreHeader
+  );
+
+UINTN
+GetVariableHeaderSize (
+  IN  BOOLEAN       AuthFlag
+  );
+
+CHAR16 *
+GetVariableNamePtr (
+  IN VARIABLE_HEADER    *Variable,
+  IN BOOLEAN            AuthFlag
+  );
+
+EFI_GUID *
+GetVendorGuidPtr (
+  IN VARIABLE_HEADER    *Variable,
+  IN BOOLEAN            AuthFlag
+  );
+
+VARIABLE_HEADER *
+GetNextVariablePtr (
+  IN  VARIABLE_STORE_INFO   *StoreInfo,
+  IN  VARIABLE_HEADER       *Variable,
+  IN  VARIABLE_HEADER       *VariableHeader
+  );
+
+VARIABLE_STORE_INDEX *
+BuildVariableStoreIndex (
+  IN VARIABLE_STORE_INFO    *StoreInfo
+  );
+
+EFI_STATUS
+FindVariableEx (
+  IN VARIABLE_STORE_INFO         *StoreInfo,
+  IN CONST CHAR16                *VariableName,
+  IN CONST EFI_GUID              *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK     *PtrTrack
+  );
+
+extern EFI_GUID  mNextVariableCursorGuid;
+
+EFI_GUID  mTestGuid[TEST_GUID_COUNT] = {
+  { 0x6C2D5E1B, 0x8A47, 0x4F3E, { 0x9B, 0x16, 0x52, 0xC8, 0x0E, 0x7D, 0xA3, 0x40 } },
+  { 0x6C2D5E1B, 0x8A47, 0x4F3E, { 0x9B, 0x16, 0x52, 0xC8, 0x0E, 0x7D, 0xA3, 0x41 } }
+};
+
+CHAR16                  mTestName[TEST_LOOKUP_NAME_COUNT][TEST_NAME_LENGTH];
+EFI_FIRMWARE_VOLUME_HEADER  *mFv;
+VARIABLE_STORE_HEADER   *mStore;
+UINTN                   mStoreEnd;
+BOOLEAN                 mAuthFormat;
+
+//
+// The lookups through the walk, the VARIABLE_INDEX_TABLE and the
+// VARIABLE_STORE_INDEX.
+//
+VARIABLE_STORE_INFO     mWalkStoreInfo;
+VARIABLE_STORE_INFO     mTableStoreInfo;
+VARIABLE_STORE_INFO     mIndexStoreInfo;
+
+//
+// The variables returned by the enumerations which search for the previous
+// variable, and by the enumerations which resume from it.
+//
+CHAR16                  mSearchedName[TEST_ENUMERATION_MAX][TEST_NAME_LENGTH];
+EFI_GUID                mSearchedGuid[TEST_ENUMERATION_MAX];
+CHAR16                  mResumedName[TEST_ENUMERATION_MAX][TEST_NAME_LENGTH];
+EFI_GUID                mResumedGuid[TEST_ENUMERATION_MAX];
+
+UINT64                  mHobList[TEST_HOB_LIST_SIZE / sizeof (UINT64)];
+UINTN                   mHobListEnd;
+
+/**
+  Builds a GUID HOB at the end of the emulated HOB list.
+
+  @param  Guid          The GUID to tag the customized HOB.
+  @param  DataLength    The size of the data payload for the GUID HOB.
+
+  @return The start address of GUID HOB data, or NULL if the list is full.
+**/
+VOID *
+EFIAPI
+BuildGuidHob (
+  IN CONST EFI_GUID              *Guid,
+  IN UINTN                       DataLength
+  )
+{
+  EFI_HOB_GUID_TYPE   *Hob;
+  UINTN               HobLength;
+
+  ASSERT (DataLength <= (0xFFF8 - sizeof (EFI_HOB_GUID_TYPE)));
+
+  HobLength = ALIGN_VALUE (sizeof (EFI_HOB_GUID_TYPE) + DataLength, 8);
+  if (mHobListEnd + HobLength > sizeof (mHobList)) {
+    return NULL;
+  }
+
+  Hob = (EFI_HOB_GUID_TYPE *) ((UINT8 *) mHobList + mHobListEnd);
+  Hob->Header.HobType   = EFI_HOB_TYPE_GUID_EXTENSION;
+  Hob->Header.HobLength = (UINT16) HobLength;
+  Hob->Header.Reserved  = 0;
+  CopyGuid (&Hob->Name, Guid);
+  mHobListEnd += HobLength;
+
+  return Hob + 1;
+}
+
+/**
+  Returns the next instance of the matched GUID HOB from the emulated HOB list.
+
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      A pointer to a Guid.
+
+  @return The next instance of the matched GUID HOB, or NULL.
+**/
+VOID *
+EFIAPI
+GetNextGuidHob (
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  EFI_HOB_GUID_TYPE   *Hob;
+
+  Hob = (EFI_HOB_GUID_TYPE *) HobStart;
+  while ((UINTN) Hob < (UINTN) mHobList + mHobListEnd) {
+    if ((Hob->Header.HobType == EFI_HOB_TYPE_GUID_EXTENSION) && CompareGuid (&Hob->Name, Guid)) {
+      return Hob;
+    }
+    Hob = (EFI_HOB_GUID_TYPE *) ((UINT8 *) Hob + Hob->Header.HobLength);
+  }
+
+  return NULL;
+}
+
+/**
+  Returns the first instance of the matched GUID HOB from the emulated HOB
+  list.
+
+  @param  Guid          The GUID to match with in the HOB list.
+
+  @return The first instance of the matched GUID HOB, or NULL.
+**/
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  return GetNextGuidHob (Guid, mHobList);
+}
+
+/**
+  Allocates the pages from the host heap.
+
+  @param[in]  MemoryType    The type of memory to allocate.
+  @param[in]  Pages         The number of pages to allocate.
+  @param[out] Memory        Pointer of memory allocated.
+
+  @retval EFI_SUCCESS           The memory range was successfully allocated.
+  @retval EFI_OUT_OF_RESOURCES  The pages could not be allocated.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesAllocatePages (
+  IN EFI_MEMORY_TYPE            MemoryType,
+  IN UINTN                      Pages,
+  OUT EFI_PHYSICAL_ADDRESS      *Memory
+  )
+{
+  VOID    *Buffer;
+
+  Buffer = AllocatePool (EFI_PAGES_TO_SIZE (Pages));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Memory = (EFI_PHYSICAL_ADDRESS) (UINTN) Buffer;
+  return EFI_SUCCESS;
+}
+
+/**
+  Frees the pages allocated by PeiServicesAllocatePages ().
+
+  @param[in] Memory         The base physical address of the pages to be freed.
+  @param[in] Pages          The number of contiguous 4 KB pages to free.
+
+  @retval EFI_SUCCESS       The requested pages were freed.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesFreePages (
+  IN EFI_PHYSICAL_ADDRESS       Memory,
+  IN UINTN                      Pages
+  )
+{
+  FreePool ((VOID *) (UINTN) Memory);
+  return EFI_SUCCESS;
+}
+
+/**
+  Not used by the tests.
+
+  @param[in]  PpiList       A pointer to the list of interfaces.
+
+  @retval EFI_SUCCESS       Always.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesInstallPpi (
+  IN CONST EFI_PEI_PPI_DESCRIPTOR     *PpiList
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Not used by the tests.
+
+  @param[in]  NotifyList    A pointer to the list of notification interfaces.
+
+  @retval EFI_SUCCESS       Always.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesNotifyPpi (
+  IN CONST EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyList
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  The test stores hold no compressed variables.
+
+  @param[in]  Source           The source buffer containing the compressed data.
+  @param[in]  SourceSize       The size, in bytes, of the source buffer.
+  @param[out] DestinationSize  A pointer to the size, in bytes, of the uncompressed buffer.
+  @param[out] ScratchSize      A pointer to the size, in bytes, of the scratch buffer.
+
+  @retval RETURN_UNSUPPORTED   Always.
+**/
+RETURN_STATUS
+EFIAPI
+UefiDecompressGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  The test stores hold no compressed variables.
+
+  @param[in]      Source       The source buffer containing the compressed data.
+  @param[in, out] Destination  The destination buffer to store the decompressed data.
+  @param[in, out] Scratch      A temporary scratch buffer.
+
+  @retval RETURN_UNSUPPORTED   Always.
+**/
+RETURN_STATUS
+EFIAPI
+UefiDecompress (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch  OPTIONAL
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  Creates the name of a test variable, "Var" followed by the hexadecimal
+  digits of its number, lowest first.
+
+  Names which are prefixes of other names, like "Var1" and "Var10", are
+  created on purpose.
+
+  @param[out]  Name    Buffer of TEST_NAME_LENGTH characters for the name.
+  @param[in]   Number  Number of the variable.
+**/
+STATIC
+VOID
+CreateTestName (
+  OUT CHAR16  *Name,
+  IN  UINTN   Number
+  )
+{
+  UINTN   Length;
+
+  StrCpyS (Name, TEST_NAME_LENGTH, L"Var");
+  Length = 3;
+  do {
+    Name[Length++] = L"0123456789ABCDEF"[Number & 0xF];
+    Number >>= 4;
+  } while (Number != 0);
+  Name[Length] = L'\0';
+}
+
+/**
+  Formats an empty variable store.
+
+  @param[out] Store       The variable store.
+  @param[in]  Size        Size of the variable store in bytes.
+  @param[in]  AuthFormat  TRUE to create a store of authenticated variables.
+**/
+STATIC
+VOID
+FormatStore (
+  OUT VARIABLE_STORE_HEADER   *Store,
+  IN  UINTN                   Size,
+  IN  BOOLEAN                 AuthFormat
+  )
+{
+  SetMem (Store, Size, 0xFF);
+  CopyGuid (&Store->Signature, AuthFormat ? &gEfiAuthenticatedVariableGuid : &gEfiVariableGuid);
+  Store->Size      = (UINT32) Size;
+  Store->Format    = VARIABLE_STORE_FORMATTED;
+  Store->State     = VARIABLE_STORE_HEALTHY;
+  Store->Reserved  = 0;
+  Store->Reserved1 = 0;
+}
+
+/**
+  Creates an empty NV variable store in place of the previous one, where
+  GetVariableStore () finds it, and empties the emulated HOB list.
+
+  @param[in]  Size        Size of the variable store in bytes.
+  @param[in]  AuthFormat  TRUE to create a store of authenticated variables.
+
+  @retval TRUE            The store is created.
+  @retval FALSE           No memory for the store.
+**/
+STATIC
+BOOLEAN
+CreateStore (
+  IN UINTN    Size,
+  IN BOOLEAN  AuthFormat
+  )
+{
+  if (mFv != NULL) {
+    FreePool (mFv);
+  }
+
+  mFv = AllocateZeroPool (TEST_FV_HEADER_LENGTH + Size);
+  if (mFv == NULL) {
+    mStore = NULL;
+    return FALSE;
+  }
+
+  mFv->FvLength     = TEST_FV_HEADER_LENGTH + Size;
+  mFv->Signature    = EFI_FVH_SIGNATURE;
+  mFv->HeaderLength = (UINT16) TEST_FV_HEADER_LENGTH;
+  mFv->Revision     = EFI_FVH_REVISION;
+  CopyGuid (&mFv->FileSystemGuid, &gEfiSystemNvDataFvGuid);
+  mFv->BlockMap[0].NumBlocks = 1;
+  mFv->BlockMap[0].Length    = (UINT32) mFv->FvLength;
+
+  mStore = (VARIABLE_STORE_HEADER *) ((UINT8 *) mFv + TEST_FV_HEADER_LENGTH);
+  FormatStore (mStore, Size, AuthFormat);
+  PatchPcdSet64 (PcdFlashNvStorageVariableBase64, (UINT64) (UINTN) mFv);
+  PatchPcdSet32 (PcdFlashNvStorageVariableSize, (UINT32) mFv->FvLength);
+
+  mStoreEnd   = 0;
+  mAuthFormat = AuthFormat;
+  mHobListEnd = 0;
+  return TRUE;
+}
+
+/**
+  Appends a variable to the store.
+
+  @param[in]  Name        Name of the variable.
+  @param[in]  Guid        Vendor GUID of the variable.
+  @param[in]  DataSize    Size of the variable data in bytes.
+  @param[in]  State       State of the new variable header.
+
+  @return Pointer to the new variable header, or NULL if the store is full.
+**/
+STATIC
+VARIABLE_HEADER *
+AppendVariable (
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid,
+  IN UINTN      DataSize,
+  IN UINT8      State
+  )
+{
+  VARIABLE_STORE_INFO             StoreInfo;
+  VARIABLE_HEADER                 *Variable;
+  AUTHENTICATED_VARIABLE_HEADER   *AuthVariable;
+  UINTN                           NameSize;
+  UINTN                           Size;
+
+  NameSize = StrSize (Name);
+  Size     = GetVariableHeaderSize (mAuthFormat) + NameSize + GET_PAD_SIZE (NameSize) + DataSize + GET_PAD_SIZE (DataSize);
+  Variable = (VARIABLE_HEADER *) ((UINTN) GetStartPointer (mStore) + mStoreEnd);
+  if ((UINTN) Variable + Size > (UINTN) GetEndPointer (mStore)) {
+    return NULL;
+  }
+
+  ZeroMem (Variable, GetVariableHeaderSize (mAuthFormat));
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = State;
+  Variable->Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS;
+  if (mAuthFormat) {
+    AuthVariable = (AUTHENTICATED_VARIABLE_HEADER *) Variable;
+    AuthVariable->NameSize = (UINT32) NameSize;
+    AuthVariable->DataSize = (UINT32) DataSize;
+  } else {
+    Variable->NameSize = (UINT32) NameSize;
+    Variable->DataSize = (UINT32) DataSize;
+  }
+  CopyGuid (GetVendorGuidPtr (Variable, mAuthFormat), Guid);
+  CopyMem (GetVariableNamePtr (Variable, mAuthFormat), Name, NameSize);
+  SetMem ((UINT8 *) GetVariableNamePtr (Variable, mAuthFormat) + NameSize + GET_PAD_SIZE (NameSize), DataSize, (UINT8) DataSize);
+
+  ZeroMem (&StoreInfo, sizeof (StoreInfo));
+  StoreInfo.VariableStoreHeader = mStore;
+  StoreInfo.AuthFlag            = mAuthFormat;
+  mStoreEnd = (UINTN) GetNextVariablePtr (&StoreInfo, Variable, Variable) - (UINTN) GetStartPointer (mStore);
+  return Variable;
+}
+
+/**
+  Sets up the three lookups in the store: the walk, the VARIABLE_INDEX_TABLE
+  the way GetVariableStore () creates it before permanent memory is
+  installed, and the VARIABLE_STORE_INDEX built after.
+
+  @return The index of the store, BucketCount is 0 if it cannot be indexed.
+**/
+STATIC
+VARIABLE_STORE_INDEX *
+SetupLookups (
+  VOID
+  )
+{
+  VARIABLE_STORE_INDEX  *StoreIndex;
+
+  ZeroMem (&mWalkStoreInfo, sizeof (mWalkStoreInfo));
+  mWalkStoreInfo.VariableStoreHeader = mStore;
+  mWalkStoreInfo.AuthFlag            = mAuthFormat;
+
+  CopyMem (&mTableStoreInfo, &mWalkStoreInfo, sizeof (mTableStoreInfo));
+  mTableStoreInfo.IndexTable = BuildGuidHob (&gEfiVariableIndexTableGuid, sizeof (VARIABLE_INDEX_TABLE));
+  mTableStoreInfo.IndexTable->Length      = 0;
+  mTableStoreInfo.IndexTable->StartPtr    = GetStartPointer (mStore);
+  mTableStoreInfo.IndexTable->EndPtr      = GetEndPointer (mStore);
+  mTableStoreInfo.IndexTable->GoneThrough = 0;
+
+  CopyMem (&mIndexStoreInfo, &mWalkStoreInfo, sizeof (mIndexStoreInfo));
+  StoreIndex = BuildVariableStoreIndex (&mIndexStoreInfo);
+  if ((StoreIndex != NULL) && (StoreIndex->BucketCount != 0)) {
+    mIndexStoreInfo.StoreIndex = StoreIndex;
+  }
+
+  return StoreIndex;
+}
+
+/**
+  Finds a variable with one of the lookups.
+
+  @param[in]   StoreInfo   The store info of the lookup.
+  @param[in]   Name        Name of the variable.
+  @param[in]   Guid        Vendor GUID of the variable.
+  @param[out]  PtrTrack    The variable found.
+
+  @return The status returned by FindVariableEx ().
+**/
+STATIC
+EFI_STATUS
+FindTestVariable (
+  IN  VARIABLE_STORE_INFO     *StoreInfo,
+  IN  CHAR16                  *Name,
+  IN  EFI_GUID                *Guid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  ZeroMem (PtrTrack, sizeof (*PtrTrack));
+  return FindVariableEx (StoreInfo, Name, Guid, PtrTrack);
+}
+
+/**
+  Checks that the VARIABLE_INDEX_TABLE and the VARIABLE_STORE_INDEX find the
+  same variable as the walk of the store.
+
+  @param[in]  Name           Name of the variable.
+  @param[in]  Guid           Vendor GUID of the variable.
+
+  @retval UNIT_TEST_PASSED  The three lookups agree.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckLookup (
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid
+  )
+{
+  VARIABLE_POINTER_TRACK  Walked;
+  VARIABLE_POINTER_TRACK  Tabled;
+  VARIABLE_POINTER_TRACK  Indexed;
+  EFI_STATUS              WalkStatus;
+  EFI_STATUS              TableStatus;
+  EFI_STATUS              IndexStatus;
+
+  WalkStatus  = FindTestVariable (&mWalkStoreInfo, Name, Guid, &Walked);
+  TableStatus = FindTestVariable (&mTableStoreInfo, Name, Guid, &Tabled);
+  IndexStatus = FindTestVariable (&mIndexStoreInfo, Name, Guid, &Indexed);
+
+  UT_ASSERT_STATUS_EQUAL (TableStatus, WalkStatus);
+  UT_ASSERT_STATUS_EQUAL (IndexStatus, WalkStatus);
+  UT_ASSERT_EQUAL ((UINTN) Tabled.CurrPtr, (UINTN) Walked.CurrPtr);
+  UT_ASSERT_EQUAL ((UINTN) Indexed.CurrPtr, (UINTN) Walked.CurrPtr);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the variable store.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mFv != NULL) {
+    FreePool (mFv);
+    mFv    = NULL;
+    mStore = NULL;
+  }
+}
+
+/**
+  Lookups in random stores, with variables in every state and some names
+  without a null terminator, must find the same variable through the
+  VARIABLE_INDEX_TABLE, through the VARIABLE_STORE_INDEX and by the walk.
+
+  @param[in]  Context  Pointer to a BOOLEAN, TRUE for stores of authenticated
+                       variables.
+
+  @retval UNIT_TEST_PASSED  The three lookups always agree.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+LookupMatchesWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINT8      States[] = {
+    VAR_ADDED,
+    VAR_ADDED,
+    VAR_ADDED,
+    VAR_ADDED & VAR_DELETED,
+    VAR_ADDED & VAR_DELETED,
+    VAR_ADDED & VAR_IN_DELETED_TRANSITION,
+    VAR_ADDED & VAR_IN_DELETED_TRANSITION & VAR_DELETED,
+    VAR_HEADER_VALID_ONLY
+  };
+  UNIT_TEST_STATUS        Status;
+  VARIABLE_STORE_INDEX    *StoreIndex;
+  VARIABLE_HEADER         *Variable;
+  CHAR16                  *Name;
+  UINTN                   Number;
+  UINTN                   VariableCount;
+  UINTN                   Lookup;
+  BOOLEAN                 Corrupted;
+
+  for (Number = 0; Number < TEST_LOOKUP_NAME_COUNT; Number++) {
+    CreateTestName (mTestName[Number], Number);
+  }
+
+  UnitTestRandomSeed (0x9E15);
+  for (Number = 0; Number < TEST_STORE_COUNT; Number++) {
+    UT_ASSERT_TRUE (CreateStore (TEST_STORE_SIZE, *(BOOLEAN *) Context));
+
+    Corrupted     = FALSE;
+    VariableCount = (UINTN) UnitTestRandom () % TEST_VARIABLE_MAX;
+    while (VariableCount-- > 0) {
+      Variable = AppendVariable (
+                   mTestName[(UINTN) UnitTestRandom () % TEST_NAME_COUNT],
+                   &mTestGuid[(UINTN) UnitTestRandom () % TEST_GUID_COUNT],
+                   (UINTN) UnitTestRandom () % 64,
+                   States[(UINTN) UnitTestRandom () % ARRAY_SIZE (States)]
+                   );
+      if (Variable == NULL) {
+        break;
+      }
+
+      if ((UINTN) UnitTestRandom () % 1024 == 0) {
+        //
+        // Overwrite the null terminator of the name.
+        //
+        Name = GetVariableNamePtr (Variable, mAuthFormat);
+        Name[StrLen (Name)] = L'X';
+        Corrupted = TRUE;
+      }
+    }
+
+    StoreIndex = SetupLookups ();
+    UT_ASSERT_NOT_NULL (StoreIndex);
+    if (!Corrupted) {
+      UT_ASSERT_NOT_EQUAL (StoreIndex->BucketCount, 0);
+    }
+
+    for (Lookup = 0; Lookup < TEST_LOOKUP_COUNT; Lookup++) {
+      Status = CheckLookup (
+                 mTestName[(UINTN) UnitTestRandom () % TEST_LOOKUP_NAME_COUNT],
+                 &mTestGuid[(UINTN) UnitTestRandom () % TEST_GUID_COUNT]
+                 );
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Returns the average time of the lookups of random variables of the store.
+
+  @param[in]  StoreInfo      The store info of the lookup.
+  @param[in]  Name           Names of the variables of the store.
+  @param[in]  VariableCount  Number of variables in the store.
+
+  @return The average time of a lookup in nanoseconds.
+**/
+STATIC
+UINT64
+TimeLookups (
+  IN VARIABLE_STORE_INFO  *StoreInfo,
+  IN CHAR16               (*Name)[TEST_NAME_LENGTH],
+  IN UINTN                VariableCount
+  )
+{
+  VARIABLE_POINTER_TRACK  Variable;
+  UINTN                   Lookup;
+  clock_t                 Start;
+  clock_t                 Elapsed;
+
+  Start = clock ();
+  for (Lookup = 0; Lookup < TEST_TIMED_LOOKUP_COUNT; Lookup++) {
+    FindTestVariable (StoreInfo, Name[(UINTN) UnitTestRandom () % VariableCount], &mTestGuid[0], &Variable);
+  }
+  Elapsed = clock () - Start;
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000000 / TEST_TIMED_LOOKUP_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Times the lookups by the walk, through the VARIABLE_INDEX_TABLE and through
+  the VARIABLE_STORE_INDEX in stores of 32 to 2048 variables, after checking
+  that the three find every variable.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The three lookups find every variable.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+LookupLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS      Status;
+  VARIABLE_STORE_INDEX  *StoreIndex;
+  CHAR16                (*Name)[TEST_NAME_LENGTH];
+  UINTN                 StoreNumber;
+  UINTN                 VariableCount;
+  UINTN                 Number;
+  UINT64                WalkTime;
+  UINT64                TableTime;
+  UINT64                IndexTime;
+
+  UnitTestRandomSeed (0x7A3B);
+  for (StoreNumber = 0; StoreNumber < TEST_TIMED_STORE_COUNT; StoreNumber++) {
+    VariableCount = 32 << (2 * StoreNumber);
+    Name = AllocatePool (VariableCount * sizeof (*Name));
+    UT_ASSERT_NOT_NULL (Name);
+    UT_ASSERT_TRUE (CreateStore (VariableCount * 64, FALSE));
+
+    for (Number = 0; Number < VariableCount; Number++) {
+      CreateTestName (Name[Number], Number);
+      UT_ASSERT_NOT_NULL (AppendVariable (Name[Number], &mTestGuid[0], 8, VAR_ADDED));
+    }
+
+    StoreIndex = SetupLookups ();
+    UT_ASSERT_NOT_NULL (StoreIndex);
+    UT_ASSERT_EQUAL (StoreIndex->EntryCount, VariableCount);
+
+    for (Number = 0; Number < VariableCount; Number++) {
+      Status = CheckLookup (Name[Number], &mTestGuid[0]);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+
+    WalkTime  = TimeLookups (&mWalkStoreInfo, Name, VariableCount);
+    TableTime = TimeLookups (&mTableStoreInfo, Name, VariableCount);
+    IndexTime = TimeLookups (&mIndexStoreInfo, Name, VariableCount);
+    UT_LOG_INFO (
+      "%5Lu variables: walk %Lu ns, index table %Lu ns, store index %Lu ns (%Lu byte HOB)\n",
+      (UINT64) VariableCount,
+      WalkTime,
+      TableTime,
+      IndexTime,
+      (UINT64) (sizeof (VARIABLE_STORE_INDEX) + (StoreIndex->BucketCount + 1) * sizeof (UINT32) +
+                StoreIndex->EntryCount * sizeof (VARIABLE_STORE_INDEX_ENTRY))
+      );
+
+    FreePool (Name);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Builds a HOB variable store holding some of the variables the NV variable
+  store may hold, each with the given state.
+
+  @param[in]  State       State of the variables.
+
+  @retval TRUE            The store is built.
+  @retval FALSE           The emulated HOB list is full.
+**/
+STATIC
+BOOLEAN
+BuildHobStore (
+  IN UINT8    State
+  )
+{
+  VARIABLE_STORE_HEADER   *NvStore;
+  UINTN                   NvStoreEnd;
+  UINTN                   Number;
+
+  NvStore    = mStore;
+  NvStoreEnd = mStoreEnd;
+
+  mStore = BuildGuidHob (mAuthFormat ? &gEfiAuthenticatedVariableGuid : &gEfiVariableGuid, SIZE_4KB);
+  if (mStore == NULL) {
+    mStore = NvStore;
+    return FALSE;
+  }
+
+  FormatStore (mStore, SIZE_4KB, mAuthFormat);
+  mStoreEnd = 0;
+  for (Number = 0; Number < TEST_HOB_VARIABLE_COUNT; Number++) {
+    AppendVariable (mTestName[Number * (TEST_NAME_COUNT / TEST_HOB_VARIABLE_COUNT)], &mTestGuid[Number % TEST_GUID_COUNT], 4, State);
+  }
+
+  mStore    = NvStore;
+  mStoreEnd = NvStoreEnd;
+  return TRUE;
+}
+
+/**
+  Forgets the variable returned by the last PeiGetNextVariableName () call,
+  so that the next call searches for the variable it is given.
+**/
+STATIC
+VOID
+ForgetNextVariableCursor (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE   *GuidHob;
+
+  GuidHob = GetFirstGuidHob (&mNextVariableCursorGuid);
+  if (GuidHob == NULL) {
+    return;
+  }
+
+  if ((UINTN) GuidHob + GuidHob->Header.HobLength == (UINTN) mHobList + mHobListEnd) {
+    mHobListEnd -= GuidHob->Header.HobLength;
+  } else {
+    GuidHob->Header.HobType = EFI_HOB_TYPE_UNUSED;
+  }
+}
+
+/**
+  Enumerates all the variables with PeiGetNextVariableName ().
+
+  @param[in]   UseCursor   FALSE to forget the variable returned by the last
+                           call before each call, so that it is searched for.
+  @param[out]  Name        Buffer for the names of up to MaxCount variables,
+                           NULL to only count them.
+  @param[out]  Guid        Buffer for the vendor GUIDs of up to MaxCount
+                           variables, NULL to only count them.
+  @param[in]   MaxCount    The number of variables expected at most.
+  @param[out]  Count       The number of variables enumerated.
+
+  @retval EFI_NOT_FOUND         All the variables are enumerated.
+  @retval EFI_BUFFER_TOO_SMALL  More than MaxCount variables are enumerated.
+  @return The other status which ended the enumeration.
+**/
+STATIC
+EFI_STATUS
+EnumerateTestVariables (
+  IN  BOOLEAN   UseCursor,
+  OUT CHAR16    (*Name)[TEST_NAME_LENGTH]  OPTIONAL,
+  OUT EFI_GUID  *Guid  OPTIONAL,
+  IN  UINTN     MaxCount,
+  OUT UINTN     *Count
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      NextName[TEST_NAME_LENGTH];
+  EFI_GUID    NextGuid;
+  UINTN       NameSize;
+
+  ForgetNextVariableCursor ();
+
+  *Count = 0;
+  NextName[0] = L'\0';
+  ZeroMem (&NextGuid, sizeof (NextGuid));
+  while (*Count <= MaxCount) {
+    if (!UseCursor) {
+      ForgetNextVariableCursor ();
+    }
+
+    NameSize = sizeof (NextName);
+    Status   = PeiGetNextVariableName (NULL, &NameSize, NextName, &NextGuid);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if ((Name != NULL) && (Guid != NULL) && (*Count < MaxCount)) {
+      CopyMem (Name[*Count], NextName, NameSize);
+      CopyGuid (&Guid[*Count], &NextGuid);
+    }
+    (*Count)++;
+  }
+
+  return EFI_BUFFER_TOO_SMALL;
+}
+
+/**
+  Enumerations of random stores, with variables in every state and a HOB
+  variable store overriding some of them, must return the same variables
+  whether they resume from the variable returned by the last call or search
+  for it, before and after the store is indexed.
+
+  @param[in]  Context  Pointer to a BOOLEAN, TRUE for stores of authenticated
+                       variables.
+
+  @retval UNIT_TEST_PASSED  The enumerations always agree.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NextVariableCursorMatchesSearch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINT8      States[] = {
+    VAR_ADDED,
+    VAR_ADDED,
+    VAR_ADDED & VAR_DELETED,
+    VAR_ADDED & VAR_IN_DELETED_TRANSITION,
+    VAR_HEADER_VALID_ONLY
+  };
+  BOOLEAN                 Added[TEST_NAME_COUNT][TEST_GUID_COUNT];
+  EFI_STATUS              SearchStatus;
+  EFI_STATUS              ResumeStatus;
+  UINTN                   SearchCount;
+  UINTN                   ResumeCount;
+  UINTN                   StoreNumber;
+  UINTN                   VariableCount;
+  UINTN                   Number;
+  UINTN                   GuidNumber;
+  UINTN                   Pass;
+  UINT8                   State;
+
+  for (Number = 0; Number < TEST_LOOKUP_NAME_COUNT; Number++) {
+    CreateTestName (mTestName[Number], Number);
+  }
+
+  UnitTestRandomSeed (0x4E57);
+  for (StoreNumber = 0; StoreNumber < TEST_ENUMERATION_STORE_COUNT; StoreNumber++) {
+    UT_ASSERT_TRUE (CreateStore (TEST_STORE_SIZE, *(BOOLEAN *) Context));
+    if (StoreNumber % 2 == 0) {
+      UT_ASSERT_TRUE (BuildHobStore ((StoreNumber % 4 == 0) ? VAR_ADDED : (VAR_ADDED & VAR_IN_DELETED_TRANSITION)));
+    }
+
+    //
+    // Two ADDED variables with the same name and GUID would make any
+    // enumeration loop, the variable driver never writes them.
+    //
+    ZeroMem (Added, sizeof (Added));
+    VariableCount = (UINTN) UnitTestRandom () % TEST_VARIABLE_MAX;
+    while (VariableCount-- > 0) {
+      Number     = (UINTN) UnitTestRandom () % TEST_NAME_COUNT;
+      GuidNumber = (UINTN) UnitTestRandom () % TEST_GUID_COUNT;
+      State      = States[(UINTN) UnitTestRandom () % ARRAY_SIZE (States)];
+      if (State == VAR_ADDED) {
+        if (Added[Number][GuidNumber]) {
+          State &= VAR_DELETED;
+        }
+        Added[Number][GuidNumber] = TRUE;
+      }
+      if (AppendVariable (mTestName[Number], &mTestGuid[GuidNumber], (UINTN) UnitTestRandom () % 64, State) == NULL) {
+        break;
+      }
+    }
+
+    for (Pass = 0; Pass < 2; Pass++) {
+      SearchStatus = EnumerateTestVariables (FALSE, mSearchedName, mSearchedGuid, TEST_ENUMERATION_MAX, &SearchCount);
+      ResumeStatus = EnumerateTestVariables (TRUE, mResumedName, mResumedGuid, TEST_ENUMERATION_MAX, &ResumeCount);
+      UT_ASSERT_STATUS_EQUAL (SearchStatus, EFI_NOT_FOUND);
+      UT_ASSERT_STATUS_EQUAL (ResumeStatus, EFI_NOT_FOUND);
+      UT_ASSERT_EQUAL (ResumeCount, SearchCount);
+      UT_ASSERT_MEM_EQUAL (mResumedName, mSearchedName, SearchCount * sizeof (mSearchedName[0]));
+      UT_ASSERT_MEM_EQUAL (mResumedGuid, mSearchedGuid, SearchCount * sizeof (mSearchedGuid[0]));
+
+      //
+      // Then again once permanent memory is installed.
+      //
+      BuildVariableStoreIndexOnMemoryDiscovered (NULL, NULL, NULL);
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Returns the average time of the enumeration of all the variables.
+
+  @param[in]  UseCursor   TRUE to resume from the variable returned by the last
+                          call, FALSE to search for it.
+  @param[out] Count       The number of variables enumerated.
+
+  @return The average time of an enumeration in microseconds.
+**/
+STATIC
+UINT64
+TimeEnumerations (
+  IN  BOOLEAN   UseCursor,
+  OUT UINTN     *Count
+  )
+{
+  UINTN       Enumeration;
+  clock_t     Start;
+  clock_t     Elapsed;
+
+  Start = clock ();
+  for (Enumeration = 0; Enumeration < TEST_TIMED_ENUMERATION_COUNT; Enumeration++) {
+    EnumerateTestVariables (UseCursor, NULL, NULL, MAX_UINTN - 1, Count);
+  }
+  Elapsed = clock () - Start;
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000 / TEST_TIMED_ENUMERATION_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Times the enumeration of all the variables of NV stores of 100, 1000 and
+  2000 variables before permanent memory is installed, resuming from the
+  variable returned by the last call and searching for it.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  Both enumerations return every variable.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NextVariableLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINTN  VariableCount[] = { 100, 1000, 2000 };
+  CHAR16              Name[TEST_NAME_LENGTH];
+  UINTN               StoreNumber;
+  UINTN               Number;
+  UINTN               SearchCount;
+  UINTN               ResumeCount;
+  UINT64              SearchTime;
+  UINT64              ResumeTime;
+
+  for (StoreNumber = 0; StoreNumber < ARRAY_SIZE (VariableCount); StoreNumber++) {
+    UT_ASSERT_TRUE (CreateStore (VariableCount[StoreNumber] * 64, FALSE));
+    for (Number = 0; Number < VariableCount[StoreNumber]; Number++) {
+      CreateTestName (Name, Number);
+      UT_ASSERT_NOT_NULL (AppendVariable (Name, &mTestGuid[Number % TEST_GUID_COUNT], 8, VAR_ADDED));
+    }
+
+    SearchTime = TimeEnumerations (FALSE, &SearchCount);
+    ResumeTime = TimeEnumerations (TRUE, &ResumeCount);
+    UT_ASSERT_EQUAL (SearchCount, VariableCount[StoreNumber]);
+    UT_ASSERT_EQUAL (ResumeCount, VariableCount[StoreNumber]);
+    UT_LOG_INFO ("%5Lu variables: search %Lu us, cursor %Lu us\n", (UINT64) VariableCount[StoreNumber], SearchTime, ResumeTime);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the lookups
+  of the PEI variable driver and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      LookupTests;
+  UNIT_TEST_SUITE_HANDLE      NextTests;
+  STATIC BOOLEAN              AuthFormat    = TRUE;
+  STATIC BOOLEAN              NonAuthFormat = FALSE;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the PEI variable lookup Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&LookupTests, Framework, "PEI Variable Lookup Tests", "Variable.Pei.Lookup", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for LookupTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (LookupTests, "Table and index should match the walk of a store",               "MatchWalk",     LookupMatchesWalk, NULL, CleanupStore, &NonAuthFormat);
+  AddTestCase (LookupTests, "Table and index should match the walk of an authenticated store", "MatchWalkAuth", LookupMatchesWalk, NULL, CleanupStore, &AuthFormat);
+  AddTestCase (LookupTests, "Lookup latency against store occupancy",                          "Latency",       LookupLatency,     NULL, CleanupStore, NULL);
+
+  //
+  // Populate the PeiGetNextVariableName Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&NextTests, Framework, "PEI GetNextVariableName Cursor Tests", "Variable.Pei.NextCursor", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for NextTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (NextTests, "Cursor should match the search of a store",               "MatchSearch",     NextVariableCursorMatchesSearch, NULL, CleanupStore, &NonAuthFormat);
+  AddTestCase (NextTests, "Cursor should match the search of an authenticated store", "MatchSearchAuth", NextVariableCursorMatchesSearch, NULL, CleanupStore, &AuthFormat);
+  AddTestCase (NextTests, "Enumeration latency against store occupancy",              "Latency",         NextVariableLatency,             NULL, CleanupStore, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
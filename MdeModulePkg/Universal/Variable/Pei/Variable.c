@@ -2,7 +2,7 @@
   Implement ReadOnly Variable Services required by PEIM and install
   PEI ReadOnly Varaiable2 PPI. These services operates the non volatile storage space.
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 Copyright (c) Microsoft Corporation.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -25,6 +25,19 @@ EFI_PEI_PPI_DESCRIPTOR     mPpiListVariable = {
   &mVariablePpi
 };
 
+EFI_PEI_NOTIFY_DESCRIPTOR  mMemoryDiscoveredNotifyList = {
+  (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST),
+  &gEfiPeiMemoryDiscoveredPpiGuid,
+  BuildVariableStoreIndexOnMemoryDiscovered
+};
+
+//
+// GUID of the guid hob holding the VARIABLE_NEXT_CURSOR.
+//
+EFI_GUID  mNextVariableCursorGuid = {
+  0x3b0d4f6e, 0x58a1, 0x4c27, { 0xa9, 0x3e, 0x71, 0x0c, 0xd2, 0x4b, 0x86, 0xf5 }
+};
+
 
 /**
   Provide the functionality of the variable services.
@@ -43,6 +56,16 @@ PeimInitializeVariableServices (
   IN CONST EFI_PEI_SERVICES          **PeiServices
   )
 {
+  EFI_STATUS    Status;
+
+  //
+  // The index of the NV variable store may take up to 64KB, so it is only
+  // built once permanent memory is installed. Until then the lookups use the
+  // variable index table of the first VAR_ADDED variables.
+  //
+  Status = PeiServicesNotifyPpi (&mMemoryDiscoveredNotifyList);
+  ASSERT_EFI_ERROR (Status);
+
   return PeiServicesInstallPpi (&mPpiListVariable);
 }
 
@@ -343,6 +366,7 @@ GetVariableStoreStatus (
   )
 {
   if ((CompareGuid (&VarStoreHeader->Signature, &gEfiAuthenticatedVariableGuid) ||
+       CompareGuid (&VarStoreHeader->Signature, &gEdkiiCompressedVariableGuid) ||
        CompareGuid (&VarStoreHeader->Signature, &gEfiVariableGuid)) &&
       VarStoreHeader->Format == VARIABLE_STORE_FORMATTED &&
       VarStoreHeader->State == VARIABLE_STORE_HEALTHY
@@ -546,6 +570,248 @@ GetHobVariableStore (
   }
 }
 
+/**
+  Calculate the hash of a variable name and vendor GUID that is used by
+  VARIABLE_STORE_INDEX.
+
+  @param Name           Pointer to the variable name.
+  @param NameLength     Maximum number of characters of Name to hash, the hash
+                        stops at the first null character.
+  @param VendorGuid     Pointer to the vendor GUID.
+
+  @return The hash value.
+
+**/
+UINT32
+GetVariableStoreIndexHash (
+  IN CONST CHAR16           *Name,
+  IN UINTN                  NameLength,
+  IN CONST EFI_GUID         *VendorGuid
+  )
+{
+  UINT32        Hash;
+  UINTN         Index;
+  CONST UINT8   *Guid;
+
+  //
+  // FNV-1a over the characters of the name and the bytes of the GUID.
+  //
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < NameLength && Name[Index] != L'\0'; Index++) {
+    Hash = (Hash ^ Name[Index]) * 0x01000193;
+  }
+
+  Guid = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Guid[Index]) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+  Check whether the variable state means the variable is found by FindVariableEx ().
+
+  @param State          The state of the variable header.
+
+  @retval TRUE          The variable is VAR_ADDED or VAR_IN_DELETED_TRANSITION.
+  @retval FALSE         The variable is in any other state.
+
+**/
+BOOLEAN
+IsIndexedVariableState (
+  IN UINT8                  State
+  )
+{
+  return (BOOLEAN) ((State == VAR_ADDED) || (State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)));
+}
+
+/**
+  Index all the variables of the NV variable store, and publish the index in
+  a guid hob for the later lookups and for the DXE variable driver.
+
+  The store is walked once. The entries are collected in a scratch buffer in
+  the order of their offset, and are then distributed to their bucket in the
+  guid hob. The index is built only once per boot, after permanent memory is
+  installed. The index is published even if the store cannot be indexed,
+  with BucketCount set to 0, so that the store is not walked for it again.
+
+  @param StoreInfo      Pointer to the store info structure of the NV variable store.
+
+  @return Pointer to the index, or NULL if the guid hob cannot be created.
+
+**/
+VARIABLE_STORE_INDEX *
+BuildVariableStoreIndex (
+  IN VARIABLE_STORE_INFO    *StoreInfo
+  )
+{
+  EFI_STATUS                    Status;
+  VARIABLE_STORE_HEADER         *VariableStoreHeader;
+  VARIABLE_STORE_INDEX          Summary;
+  VARIABLE_STORE_INDEX          *StoreIndex;
+  VARIABLE_STORE_INDEX_ENTRY    *Scratch;
+  VARIABLE_STORE_INDEX_ENTRY    *Entry;
+  EFI_PHYSICAL_ADDRESS          ScratchBase;
+  UINT32                        ScratchCount;
+  UINT32                        *BucketStart;
+  VARIABLE_HEADER               *Variable;
+  VARIABLE_HEADER               *NextVariable;
+  VARIABLE_HEADER               *EndPtr;
+  UINTN                         NameLength;
+  UINTN                         Size;
+  UINT32                        Mask;
+  UINT32                        Index;
+  UINT32                        Bucket;
+  BOOLEAN                       Indexable;
+
+  VariableStoreHeader = StoreInfo->VariableStoreHeader;
+
+  ZeroMem (&Summary, sizeof (Summary));
+  Summary.StoreBase = (EFI_PHYSICAL_ADDRESS) (UINTN) VariableStoreHeader;
+  Summary.StoreSize = VariableStoreHeader->Size;
+
+  //
+  // The offset of a variable whose content is partly in the spare block does
+  // not locate it, leave such a store to the walk.
+  //
+  Indexable = (BOOLEAN) ((StoreInfo->FtwLastWriteData == NULL) &&
+                         (GetVariableStoreStatus (VariableStoreHeader) == EfiValid) &&
+                         (~VariableStoreHeader->Size != 0));
+
+  //
+  // No more entries than fit in a guid hob are collected.
+  //
+  Scratch      = NULL;
+  ScratchCount = (UINT32) ((VARIABLE_STORE_INDEX_MAX_SIZE - sizeof (VARIABLE_STORE_INDEX) - 2 * sizeof (UINT32)) /
+                           sizeof (VARIABLE_STORE_INDEX_ENTRY));
+  if (Indexable) {
+    Status = PeiServicesAllocatePages (
+               EfiBootServicesData,
+               EFI_SIZE_TO_PAGES (ScratchCount * sizeof (VARIABLE_STORE_INDEX_ENTRY)),
+               &ScratchBase
+               );
+    if (EFI_ERROR (Status)) {
+      Indexable = FALSE;
+    } else {
+      Scratch = (VARIABLE_STORE_INDEX_ENTRY *) (UINTN) ScratchBase;
+    }
+  }
+
+  //
+  // Record the offset and the hash of the variables to index, and sum up the
+  // variable sizes the same way the DXE variable driver does.
+  //
+  Variable = GetStartPointer (VariableStoreHeader);
+  EndPtr   = GetEndPointer (VariableStoreHeader);
+  while (Indexable && (Variable < EndPtr) && IsValidVariableHeader (Variable)) {
+    if ((UINTN) EndPtr - (UINTN) Variable < GetVariableHeaderSize (StoreInfo->AuthFlag)) {
+      Indexable = FALSE;
+      break;
+    }
+
+    if (IsIndexedVariableState (Variable->State)) {
+      //
+      // FindVariableEx () compares NameSize bytes, so a name without a null
+      // character in it also matches any longer name with the same prefix,
+      // which a hash cannot find.
+      //
+      NameLength = NameSizeOfVariable (Variable, StoreInfo->AuthFlag) / sizeof (CHAR16);
+      if ((NameLength == 0) ||
+          (StrnLenS (GetVariableNamePtr (Variable, StoreInfo->AuthFlag), NameLength) == NameLength) ||
+          (Summary.EntryCount == ScratchCount)) {
+        Indexable = FALSE;
+        break;
+      }
+      Scratch[Summary.EntryCount].Offset = (UINT32) ((UINTN) Variable - (UINTN) VariableStoreHeader);
+      Scratch[Summary.EntryCount].Hash   = GetVariableStoreIndexHash (
+                                             GetVariableNamePtr (Variable, StoreInfo->AuthFlag),
+                                             NameLength,
+                                             GetVendorGuidPtr (Variable, StoreInfo->AuthFlag)
+                                             );
+      Summary.EntryCount++;
+    } else if (((Variable->State & (UINT8) ~VAR_ADDED) != 0) && ((Variable->State & (UINT8) ~VAR_DELETED) != 0)) {
+      //
+      // The write of the variable never completed, it may still become VAR_ADDED.
+      //
+      Summary.IncompleteCount++;
+    }
+
+    NextVariable = GetNextVariablePtr (StoreInfo, Variable, Variable);
+    if (NextVariable <= Variable) {
+      Indexable = FALSE;
+      break;
+    }
+
+    if ((Variable->Attributes & (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) == (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
+      Summary.HwErrVariableTotalSize += (UINT32) ((UINTN) NextVariable - (UINTN) Variable);
+    } else {
+      Summary.CommonVariableTotalSize += (UINT32) ((UINTN) NextVariable - (UINTN) Variable);
+    }
+
+    Variable = NextVariable;
+  }
+  Summary.EndOffset = (UINT32) ((UINTN) Variable - (UINTN) VariableStoreHeader);
+
+  Size = sizeof (VARIABLE_STORE_INDEX);
+  if (Indexable) {
+    Summary.BucketCount = MAX (GetPowerOfTwo32 (Summary.EntryCount) / 2, 1);
+    Size += (Summary.BucketCount + 1) * sizeof (UINT32) + Summary.EntryCount * sizeof (VARIABLE_STORE_INDEX_ENTRY);
+    if (Size > VARIABLE_STORE_INDEX_MAX_SIZE) {
+      //
+      // Too many variables for a guid hob.
+      //
+      Indexable = FALSE;
+      Size = sizeof (VARIABLE_STORE_INDEX);
+    }
+  }
+
+  if (!Indexable) {
+    DEBUG ((DEBUG_INFO, "PeiVariable: NV variable store is not indexed\n"));
+    Summary.BucketCount = 0;
+    Summary.EntryCount  = 0;
+  }
+
+  StoreIndex = (VARIABLE_STORE_INDEX *) BuildGuidHob (&gEdkiiVariableStoreIndexGuid, Size);
+  if (StoreIndex != NULL) {
+    CopyMem (StoreIndex, &Summary, sizeof (Summary));
+  }
+
+  if ((StoreIndex != NULL) && (StoreIndex->BucketCount != 0)) {
+    BucketStart = (UINT32 *) (StoreIndex + 1);
+    Entry       = (VARIABLE_STORE_INDEX_ENTRY *) (BucketStart + StoreIndex->BucketCount + 1);
+    Mask        = StoreIndex->BucketCount - 1;
+
+    //
+    // Distribute the entries to their bucket, keeping the order of their offset
+    // inside each bucket. BucketStart[B + 1] first counts the entries of bucket
+    // B, then serves as the next free slot of bucket B while the entries are
+    // placed, and ends up as the start of bucket B + 1.
+    //
+    ZeroMem (BucketStart, (StoreIndex->BucketCount + 1) * sizeof (UINT32));
+    for (Index = 0; Index < StoreIndex->EntryCount; Index++) {
+      BucketStart[(Scratch[Index].Hash & Mask) + 1]++;
+    }
+    for (Bucket = 1; Bucket < StoreIndex->BucketCount; Bucket++) {
+      BucketStart[Bucket + 1] += BucketStart[Bucket];
+    }
+    for (Bucket = StoreIndex->BucketCount; Bucket > 0; Bucket--) {
+      BucketStart[Bucket] = BucketStart[Bucket - 1];
+    }
+    for (Index = 0; Index < StoreIndex->EntryCount; Index++) {
+      Entry[BucketStart[(Scratch[Index].Hash & Mask) + 1]++] = Scratch[Index];
+    }
+
+    DEBUG ((DEBUG_INFO, "PeiVariable: %d variables indexed in %d buckets\n", StoreIndex->EntryCount, StoreIndex->BucketCount));
+  }
+
+  if (Scratch != NULL) {
+    PeiServicesFreePages (ScratchBase, EFI_SIZE_TO_PAGES (ScratchCount * sizeof (VARIABLE_STORE_INDEX_ENTRY)));
+  }
+
+  return StoreIndex;
+}
+
 /**
   Return the variable store header and the store info based on the Index.
 
@@ -569,6 +835,7 @@ GetVariableStore (
   UINT32                                BackUpOffset;
 
   StoreInfo->IndexTable = NULL;
+  StoreInfo->StoreIndex = NULL;
   StoreInfo->FtwLastWriteData = NULL;
   StoreInfo->AuthFlag = FALSE;
   VariableStoreHeader = NULL;
@@ -632,23 +899,49 @@ GetVariableStore (
 
         VariableStoreHeader = (VARIABLE_STORE_HEADER *) ((UINT8 *) FvHeader + FvHeader->HeaderLength);
 
-        StoreInfo->AuthFlag = (BOOLEAN) (CompareGuid (&VariableStoreHeader->Signature, &gEfiAuthenticatedVariableGuid));
+        //
+        // A store holding compressed variables uses the authenticated variable header.
+        //
+        StoreInfo->AuthFlag = (BOOLEAN) (CompareGuid (&VariableStoreHeader->Signature, &gEfiAuthenticatedVariableGuid) ||
+                                         CompareGuid (&VariableStoreHeader->Signature, &gEdkiiCompressedVariableGuid));
+        StoreInfo->VariableStoreHeader = VariableStoreHeader;
 
-        GuidHob = GetFirstGuidHob (&gEfiVariableIndexTableGuid);
+        //
+        // The index of all the variables is built once permanent memory is
+        // installed.
+        //
+        GuidHob = GetFirstGuidHob (&gEdkiiVariableStoreIndexGuid);
         if (GuidHob != NULL) {
-          StoreInfo->IndexTable = GET_GUID_HOB_DATA (GuidHob);
-        } else {
+          StoreInfo->StoreIndex = GET_GUID_HOB_DATA (GuidHob);
+        }
+
+        if ((StoreInfo->StoreIndex != NULL) &&
+            ((StoreInfo->StoreIndex->BucketCount == 0) ||
+             (StoreInfo->StoreIndex->StoreBase != (EFI_PHYSICAL_ADDRESS) (UINTN) VariableStoreHeader))) {
+          StoreInfo->StoreIndex = NULL;
+        }
+
+        if (StoreInfo->StoreIndex == NULL) {
           //
-          // If it's the first time to access variable region in flash, create a guid hob to record
-          // VAR_ADDED type variable info.
-          // Note that as the resource of PEI phase is limited, only store the limited number of
-          // VAR_ADDED type variables to reduce access time.
+          // Before that, or if the store cannot be indexed, the lookups walk
+          // the store and record the first VAR_ADDED variables they find.
           //
-          StoreInfo->IndexTable = (VARIABLE_INDEX_TABLE *) BuildGuidHob (&gEfiVariableIndexTableGuid, sizeof (VARIABLE_INDEX_TABLE));
-          StoreInfo->IndexTable->Length      = 0;
-          StoreInfo->IndexTable->StartPtr    = GetStartPointer (VariableStoreHeader);
-          StoreInfo->IndexTable->EndPtr      = GetEndPointer   (VariableStoreHeader);
-          StoreInfo->IndexTable->GoneThrough = 0;
+          GuidHob = GetFirstGuidHob (&gEfiVariableIndexTableGuid);
+          if (GuidHob != NULL) {
+            StoreInfo->IndexTable = GET_GUID_HOB_DATA (GuidHob);
+          } else {
+            //
+            // If it's the first time to access variable region in flash, create a guid hob to record
+            // VAR_ADDED type variable info.
+            // Note that as the resource of PEI phase is limited, only store the limited number of
+            // VAR_ADDED type variables to reduce access time.
+            //
+            StoreInfo->IndexTable = (VARIABLE_INDEX_TABLE *) BuildGuidHob (&gEfiVariableIndexTableGuid, sizeof (VARIABLE_INDEX_TABLE));
+            StoreInfo->IndexTable->Length      = 0;
+            StoreInfo->IndexTable->StartPtr    = GetStartPointer (VariableStoreHeader);
+            StoreInfo->IndexTable->EndPtr      = GetEndPointer   (VariableStoreHeader);
+            StoreInfo->IndexTable->GoneThrough = 0;
+          }
         }
       }
       break;
@@ -662,6 +955,39 @@ GetVariableStore (
   return VariableStoreHeader;
 }
 
+/**
+  Index the variables of the NV variable store once permanent memory is
+  installed, and publish the index for the later lookups and for the DXE
+  variable driver.
+
+  @param  PeiServices       An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  NotifyDescriptor  Address of the notification descriptor data structure.
+  @param  Ppi               Address of the PPI that was installed.
+
+  @retval EFI_SUCCESS       The index is published, or the store cannot be found.
+
+**/
+EFI_STATUS
+EFIAPI
+BuildVariableStoreIndexOnMemoryDiscovered (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  VARIABLE_STORE_INFO   StoreInfo;
+
+  if (GetVariableStore (VariableStoreTypeNv, &StoreInfo) == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  if (GetFirstGuidHob (&gEdkiiVariableStoreIndexGuid) == NULL) {
+    BuildVariableStoreIndex (&StoreInfo);
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Get variable header that has consecutive content.
 
@@ -784,6 +1110,73 @@ GetVariableNameOrData (
   CopyMem (Buffer, NameOrData, Size);
 }
 
+/**
+  Find the variable in the NV variable store with its hash index.
+
+  @param  StoreInfo           Pointer to the store info structure.
+  @param  VariableName        Name of the variable to be found, not empty.
+  @param  VendorGuid          Vendor GUID to be found.
+  @param  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+
+  @retval  EFI_SUCCESS            Variable found successfully
+  @retval  EFI_NOT_FOUND          Variable not found
+
+**/
+EFI_STATUS
+FindVariableInStoreIndex (
+  IN VARIABLE_STORE_INFO         *StoreInfo,
+  IN CONST CHAR16                *VariableName,
+  IN CONST EFI_GUID              *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK     *PtrTrack
+  )
+{
+  VARIABLE_STORE_INDEX          *StoreIndex;
+  VARIABLE_STORE_INDEX_ENTRY    *Entry;
+  UINT32                        *BucketStart;
+  UINT32                        Hash;
+  UINT32                        Bucket;
+  UINT32                        Index;
+  VARIABLE_HEADER               *Variable;
+  VARIABLE_HEADER               *VariableHeader;
+  VARIABLE_HEADER               *InDeletedVariable;
+
+  StoreIndex  = StoreInfo->StoreIndex;
+  BucketStart = (UINT32 *) (StoreIndex + 1);
+  Entry       = (VARIABLE_STORE_INDEX_ENTRY *) (BucketStart + StoreIndex->BucketCount + 1);
+
+  Hash   = GetVariableStoreIndexHash (VariableName, MAX_UINTN, VendorGuid);
+  Bucket = Hash & (StoreIndex->BucketCount - 1);
+
+  //
+  // The entries of a bucket are in the order of their offset, so the first
+  // match wins the same way as in the walk of the store.
+  //
+  InDeletedVariable = NULL;
+  for (Index = BucketStart[Bucket]; Index < BucketStart[Bucket + 1]; Index++) {
+    if (Entry[Index].Hash != Hash) {
+      continue;
+    }
+
+    Variable = (VARIABLE_HEADER *) ((UINTN) StoreInfo->VariableStoreHeader + Entry[Index].Offset);
+    if (!GetVariableHeader (StoreInfo, Variable, &VariableHeader) ||
+        !IsIndexedVariableState (VariableHeader->State)) {
+      continue;
+    }
+
+    if (CompareWithValidVariable (StoreInfo, Variable, VariableHeader, VariableName, VendorGuid, PtrTrack) == EFI_SUCCESS) {
+      if (VariableHeader->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+        InDeletedVariable = PtrTrack->CurrPtr;
+      } else {
+        return EFI_SUCCESS;
+      }
+    }
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
+
 /**
   Find the variable in the specified variable store.
 
@@ -834,6 +1227,10 @@ FindVariableEx (
   PtrTrack->StartPtr = GetStartPointer (VariableStoreHeader);
   PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader);
 
+  if ((StoreInfo->StoreIndex != NULL) && (VariableName[0] != 0)) {
+    return FindVariableInStoreIndex (StoreInfo, VariableName, VendorGuid, PtrTrack);
+  }
+
   InDeletedVariable = NULL;
 
   //
@@ -975,6 +1372,146 @@ FindVariable (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Check if the data of a variable is compressed.
+
+  @param  StoreInfo       Pointer to variable store info structure.
+  @param  VariableHeader  Pointer to the Variable Header that has consecutive content.
+
+  @retval TRUE            The variable data is compressed.
+  @retval FALSE           The variable data is not compressed.
+
+**/
+BOOLEAN
+IsCompressedVariable (
+  IN VARIABLE_STORE_INFO    *StoreInfo,
+  IN VARIABLE_HEADER        *VariableHeader
+  )
+{
+  return (BOOLEAN) (((VariableHeader->Reserved & VARIABLE_DATA_COMPRESSED) != 0) &&
+                    CompareGuid (&StoreInfo->VariableStoreHeader->Signature, &gEdkiiCompressedVariableGuid));
+}
+
+/**
+  Get the size of the decompressed data of a compressed variable.
+
+  @param  StoreInfo       Pointer to variable store info structure.
+  @param  Variable        Pointer to the Variable Header.
+  @param  VariableHeader  Pointer to the Variable Header that has consecutive content.
+  @param  DataSize        Return the size of the decompressed data.
+
+  @retval EFI_SUCCESS           The size is returned.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data is corrupted.
+
+**/
+EFI_STATUS
+GetDecompressedDataSize (
+  IN  VARIABLE_STORE_INFO   *StoreInfo,
+  IN  VARIABLE_HEADER       *Variable,
+  IN  VARIABLE_HEADER       *VariableHeader,
+  OUT UINTN                 *DataSize
+  )
+{
+  EFI_STATUS    Status;
+  UINTN         SourceSize;
+  UINT8         StreamHeader[8];
+  UINT32        DestinationSize;
+  UINT32        ScratchSize;
+
+  SourceSize = DataSizeOfVariable (VariableHeader, StoreInfo->AuthFlag);
+  if (SourceSize < sizeof (StreamHeader)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  //
+  // Only the stream header, which holds the sizes, is needed.
+  //
+  GetVariableNameOrData (
+    StoreInfo,
+    GetVariableDataPtr (Variable, VariableHeader, StoreInfo->AuthFlag),
+    sizeof (StreamHeader),
+    StreamHeader
+    );
+  Status = UefiDecompressGetInfo (StreamHeader, (UINT32) SourceSize, &DestinationSize, &ScratchSize);
+  if (EFI_ERROR (Status)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  *DataSize = DestinationSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Decompress the data of a compressed variable to output buffer.
+
+  @param  StoreInfo       Pointer to variable store info structure.
+  @param  Variable        Pointer to the Variable Header.
+  @param  VariableHeader  Pointer to the Variable Header that has consecutive content.
+  @param  Buffer          Pointer to output buffer, large enough to hold the
+                          decompressed data.
+
+  @retval EFI_SUCCESS           The data is decompressed.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory to decompress the data.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data is corrupted.
+
+**/
+EFI_STATUS
+DecompressVariableData (
+  IN  VARIABLE_STORE_INFO   *StoreInfo,
+  IN  VARIABLE_HEADER       *Variable,
+  IN  VARIABLE_HEADER       *VariableHeader,
+  OUT VOID                  *Buffer
+  )
+{
+  EFI_STATUS            Status;
+  UINT8                 *Source;
+  UINTN                 SourceSize;
+  UINT32                DestinationSize;
+  UINT32                ScratchSize;
+  EFI_PHYSICAL_ADDRESS  Scratch;
+  EFI_PHYSICAL_ADDRESS  Gathered;
+
+  Source     = GetVariableDataPtr (Variable, VariableHeader, StoreInfo->AuthFlag);
+  SourceSize = DataSizeOfVariable (VariableHeader, StoreInfo->AuthFlag);
+  Gathered   = 0;
+
+  if ((StoreInfo->FtwLastWriteData != NULL) &&
+      ((UINTN) Source < (UINTN) StoreInfo->FtwLastWriteData->TargetAddress) &&
+      (((UINTN) Source + SourceSize) > (UINTN) StoreInfo->FtwLastWriteData->TargetAddress)) {
+    //
+    // The compressed data is inconsecutive, combine its two partial contents first.
+    //
+    Status = PeiServicesAllocatePages (EfiBootServicesData, EFI_SIZE_TO_PAGES (SourceSize), &Gathered);
+    if (EFI_ERROR (Status)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    GetVariableNameOrData (StoreInfo, Source, SourceSize, (UINT8 *) (UINTN) Gathered);
+    Source = (UINT8 *) (UINTN) Gathered;
+  }
+
+  Status = UefiDecompressGetInfo (Source, (UINT32) SourceSize, &DestinationSize, &ScratchSize);
+  if (!EFI_ERROR (Status)) {
+    Status = PeiServicesAllocatePages (EfiBootServicesData, EFI_SIZE_TO_PAGES (ScratchSize), &Scratch);
+    if (EFI_ERROR (Status)) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      Status = UefiDecompress (Source, Buffer, (VOID *) (UINTN) Scratch);
+      if (EFI_ERROR (Status)) {
+        Status = EFI_VOLUME_CORRUPTED;
+      }
+      PeiServicesFreePages (Scratch, EFI_SIZE_TO_PAGES (ScratchSize));
+    }
+  } else {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+
+  if (Gathered != 0) {
+    PeiServicesFreePages (Gathered, EFI_SIZE_TO_PAGES (SourceSize));
+  }
+
+  return Status;
+}
+
 /**
   This service retrieves a variable's value using its name and GUID.
 
@@ -1018,6 +1555,7 @@ PeiGetVariable (
   EFI_STATUS              Status;
   VARIABLE_STORE_INFO     StoreInfo;
   VARIABLE_HEADER         *VariableHeader;
+  BOOLEAN                 Compressed;
 
   if (VariableName == NULL || VariableGuid == NULL || DataSize == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -1041,13 +1579,29 @@ PeiGetVariable (
   //
   // Get data size
   //
-  VarDataSize = DataSizeOfVariable (VariableHeader, StoreInfo.AuthFlag);
+  Compressed = IsCompressedVariable (&StoreInfo, VariableHeader);
+  if (Compressed) {
+    Status = GetDecompressedDataSize (&StoreInfo, Variable.CurrPtr, VariableHeader, &VarDataSize);
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
+  } else {
+    VarDataSize = DataSizeOfVariable (VariableHeader, StoreInfo.AuthFlag);
+  }
+
   if (*DataSize >= VarDataSize) {
     if (Data == NULL) {
       return EFI_INVALID_PARAMETER;
     }
 
-    GetVariableNameOrData (&StoreInfo, GetVariableDataPtr (Variable.CurrPtr, VariableHeader, StoreInfo.AuthFlag), VarDataSize, Data);
+    if (Compressed) {
+      Status = DecompressVariableData (&StoreInfo, Variable.CurrPtr, VariableHeader, Data);
+      if (EFI_ERROR (Status)) {
+        return EFI_DEVICE_ERROR;
+      }
+    } else {
+      GetVariableNameOrData (&StoreInfo, GetVariableDataPtr (Variable.CurrPtr, VariableHeader, StoreInfo.AuthFlag), VarDataSize, Data);
+    }
     Status = EFI_SUCCESS;
   } else {
     Status = EFI_BUFFER_TOO_SMALL;
@@ -1061,6 +1615,101 @@ PeiGetVariable (
   return Status;
 }
 
+/**
+  Find the variable returned by the last PeiGetNextVariableName () call, if
+  the caller asks for the variable after that one.
+
+  The variable stores do not change in PEI, and the last call has checked
+  that no HOB variable overrides the variable, so the variable found is the
+  one FindVariable () would find, without the walk of the store which
+  FindVariable () needs before permanent memory is installed.
+
+  @param  VariableName  Name of the variable to be found.
+  @param  VendorGuid    Vendor GUID to be found.
+  @param  PtrTrack      Variable Track Pointer structure that contains Variable Information.
+  @param  StoreInfo     Return the store info.
+
+  @retval  EFI_SUCCESS            The variable is found at the cursor.
+  @retval  EFI_NOT_FOUND          The cursor does not hold the variable, the
+                                  caller must search for it.
+**/
+EFI_STATUS
+FindVariableAtNextVariableCursor (
+  IN CONST  CHAR16            *VariableName,
+  IN CONST  EFI_GUID          *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  OUT VARIABLE_STORE_INFO     *StoreInfo
+  )
+{
+  EFI_HOB_GUID_TYPE       *GuidHob;
+  VARIABLE_NEXT_CURSOR    *Cursor;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *VariableHeader;
+
+  GuidHob = GetFirstGuidHob (&mNextVariableCursorGuid);
+  if ((GuidHob == NULL) || (VariableName[0] == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Cursor = (VARIABLE_NEXT_CURSOR *) GET_GUID_HOB_DATA (GuidHob);
+  VariableStoreHeader = GetVariableStore (Cursor->Type, StoreInfo);
+  if (VariableStoreHeader == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  PtrTrack->StartPtr = GetStartPointer (VariableStoreHeader);
+  PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader);
+
+  Variable = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + Cursor->Offset);
+  if (!GetVariableHeader (StoreInfo, Variable, &VariableHeader) || (VariableHeader->State != VAR_ADDED)) {
+    return EFI_NOT_FOUND;
+  }
+
+  return CompareWithValidVariable (StoreInfo, Variable, VariableHeader, VariableName, VendorGuid, PtrTrack);
+}
+
+/**
+  Remember the variable returned by PeiGetNextVariableName (), from which the
+  next call of the enumeration resumes.
+
+  @param  VariableStoreHeader  The variable stores, indexed by VARIABLE_STORE_TYPE.
+  @param  PtrTrack             The variable returned.
+
+**/
+VOID
+SetNextVariableCursor (
+  IN VARIABLE_STORE_HEADER        **VariableStoreHeader,
+  IN VARIABLE_POINTER_TRACK       *PtrTrack
+  )
+{
+  EFI_HOB_GUID_TYPE       *GuidHob;
+  VARIABLE_NEXT_CURSOR    *Cursor;
+  VARIABLE_STORE_TYPE     Type;
+
+  for (Type = (VARIABLE_STORE_TYPE) 0; Type < VariableStoreTypeMax; Type++) {
+    if ((VariableStoreHeader[Type] != NULL) && (PtrTrack->StartPtr == GetStartPointer (VariableStoreHeader[Type]))) {
+      break;
+    }
+  }
+  if (Type == VariableStoreTypeMax) {
+    return;
+  }
+
+  GuidHob = GetFirstGuidHob (&mNextVariableCursorGuid);
+  if (GuidHob != NULL) {
+    Cursor = (VARIABLE_NEXT_CURSOR *) GET_GUID_HOB_DATA (GuidHob);
+  } else {
+    Cursor = (VARIABLE_NEXT_CURSOR *) BuildGuidHob (&mNextVariableCursorGuid, sizeof (VARIABLE_NEXT_CURSOR));
+    if (Cursor == NULL) {
+      return;
+    }
+  }
+
+  Cursor->Type   = Type;
+  Cursor->Offset = (UINT32) ((UINTN) PtrTrack->CurrPtr - (UINTN) VariableStoreHeader[Type]);
+}
+
 /**
   Return the next variable name and GUID.
 
@@ -1117,7 +1766,13 @@ PeiGetNextVariableName (
 
   VariableHeader = NULL;
 
-  Status = FindVariable (VariableName, VariableGuid, &Variable, &StoreInfo);
+  //
+  // An enumeration passes back the variable returned by the previous call.
+  //
+  Status = FindVariableAtNextVariableCursor (VariableName, VariableGuid, &Variable, &StoreInfo);
+  if (EFI_ERROR (Status)) {
+    Status = FindVariable (VariableName, VariableGuid, &Variable, &StoreInfo);
+  }
   if (Variable.CurrPtr == NULL || Status != EFI_SUCCESS) {
     return Status;
   }
@@ -1214,6 +1869,7 @@ PeiGetNextVariableName (
 
         CopyMem (VariableGuid, GetVendorGuidPtr (VariableHeader, StoreInfo.AuthFlag), sizeof (EFI_GUID));
 
+        SetNextVariableCursor (VariableStoreHeader, &Variable);
         Status = EFI_SUCCESS;
       } else {
         Status = EFI_BUFFER_TOO_SMALL;
@@ -2,7 +2,7 @@
   The internal header file includes the common header files, defines
   internal structure and functions used by PeiVariable module.
 
-Copyright (c) 2006 - 2017, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -12,6 +12,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <PiPei.h>
 #include <Ppi/ReadOnlyVariable2.h>
+#include <Ppi/MemoryDiscovered.h>
 
 #include <Library/DebugLib.h>
 #include <Library/PeimEntryPoint.h>
@@ -20,12 +21,20 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/PeiServicesTablePointerLib.h>
 #include <Library/PeiServicesLib.h>
+#include <Library/BaseLib.h>
+#include <Library/UefiDecompressLib.h>
 
 #include <Guid/VariableFormat.h>
 #include <Guid/VariableIndexTable.h>
+#include <Guid/VariableStoreIndex.h>
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/FaultTolerantWrite.h>
 
+//
+// The largest data a guid hob can hold.
+//
+#define VARIABLE_STORE_INDEX_MAX_SIZE  (0xFFF8 - sizeof (EFI_HOB_GUID_TYPE))
+
 typedef enum {
   VariableStoreTypeHob,
   VariableStoreTypeNv,
@@ -35,6 +44,7 @@ typedef enum {
 typedef struct {
   VARIABLE_STORE_HEADER                   *VariableStoreHeader;
   VARIABLE_INDEX_TABLE                    *IndexTable;
+  VARIABLE_STORE_INDEX                    *StoreIndex;
   //
   // If it is not NULL, it means there may be an inconsecutive variable whose
   // partial content is still in NV storage, but another partial content is backed up
@@ -44,6 +54,23 @@ typedef struct {
   BOOLEAN                                 AuthFlag;
 } VARIABLE_STORE_INFO;
 
+///
+/// The variable returned by the last PeiGetNextVariableName () call. It is
+/// kept in a guid hob, as the PEIM may execute in place before permanent
+/// memory is installed.
+///
+typedef struct {
+  ///
+  /// Type of the variable store holding the variable.
+  ///
+  VARIABLE_STORE_TYPE                     Type;
+  ///
+  /// Offset of the variable header from the variable store header, which
+  /// stays valid when the HOB variable store moves to permanent memory.
+  ///
+  UINT32                                  Offset;
+} VARIABLE_NEXT_CURSOR;
+
 //
 // Functions
 //
@@ -65,6 +92,26 @@ PeimInitializeVariableServices (
   IN CONST EFI_PEI_SERVICES          **PeiServices
   );
 
+/**
+  Index the variables of the NV variable store once permanent memory is
+  installed, and publish the index for the later lookups and for the DXE
+  variable driver.
+
+  @param  PeiServices       An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  NotifyDescriptor  Address of the notification descriptor data structure.
+  @param  Ppi               Address of the PPI that was installed.
+
+  @retval EFI_SUCCESS       The index is published, or the store cannot be found.
+
+**/
+EFI_STATUS
+EFIAPI
+BuildVariableStoreIndexOnMemoryDiscovered (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  );
+
 /**
   This service retrieves a variable's value using its name and GUID.
 
@@ -1,7 +1,7 @@
 /** @file
   Measure TCG required variable.
 
-Copyright (c) 2013 - 2017, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2013 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -17,6 +17,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/BaseLib.h>
 #include <Library/TpmMeasurementLib.h>
+#include <Library/PcdLib.h>
 
 #include "PrivilegePolymorphic.h"
 
@@ -337,3 +338,27 @@ RecordSecureBootPolicyVarData(
     DEBUG((DEBUG_INFO, "RecordSecureBootPolicyVarData GetVariable %s Status %x\n", EFI_SECURE_BOOT_MODE_NAME, Status));
   }
 }
+
+/**
+  Checks if the gEdkiiVariableWriteEventGroupGuid event group is signaled
+  after a variable has been set.
+
+  DxeImageVerificationLib depends on the event group for db, dbx and dbt, so
+  the writes of the image security database variables always signal it. The
+  other writes only signal it when the PCD DXE driver caches the values of the
+  HII type PCDs.
+
+  @param[in] VendorGuid                   Variable vendor GUID.
+
+  @retval TRUE                            The event group is signaled.
+  @retval FALSE                           No driver depends on the event group for the variable.
+
+**/
+BOOLEAN
+IsVariableWriteEventNeeded (
+  IN CONST EFI_GUID                         *VendorGuid
+  )
+{
+  return (BOOLEAN) (FeaturePcdGet (PcdHiiPcdValueCacheEnable) ||
+                    CompareGuid (VendorGuid, &gEfiImageSecurityDatabaseGuid));
+}
@@ -7,7 +7,7 @@
   vs. non-privileged driver code.
 
   Copyright (c) 2017, Red Hat, Inc.<BR>
-  Copyright (c) 2010 - 2018, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2010 - 2020, Intel Corporation. All rights reserved.<BR>
 
   SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
@@ -29,6 +29,20 @@ SecureBootHook (
   IN EFI_GUID                               *VendorGuid
   );
 
+/**
+  Checks if the gEdkiiVariableWriteEventGroupGuid event group is signaled
+  after a variable has been set. Only the DXE variable drivers signal it.
+
+  @param[in] VendorGuid                   Variable vendor GUID.
+
+  @retval TRUE                            The event group is signaled.
+  @retval FALSE                           No driver depends on the event group for the variable.
+**/
+BOOLEAN
+IsVariableWriteEventNeeded (
+  IN CONST EFI_GUID                         *VendorGuid
+  );
+
 /**
   Initialization for MOR Control Lock.
 
@@ -2,7 +2,7 @@
   Handles non-volatile variable store garbage collection, using FTW
   (Fault Tolerant Write) protocol.
 
-Copyright (c) 2006 - 2015, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -92,8 +92,18 @@ GetLbaAndOffsetByAddress (
   volume block device. The destination is specified by parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  The buffer still goes to flash in a single FTW write, so that a power
+  failure leaves either the old or the new variable store. That write is
+  only trimmed at the ends: the blocks before the first changed block and
+  after the last changed block are neither erased nor copied through the
+  spare block, but every block in between is rewritten, whether its content
+  changes or not. If the blocks of the store are not all of the same size,
+  the whole store is written.
+
   @param  VariableBase   Base address of variable to write
   @param  VariableBuffer Point to the variable data buffer.
+  @param  BlockCount     Return the number of flash blocks rewritten, 0 if the
+                         whole store is written without looking at its blocks.
 
   @retval EFI_SUCCESS    The function completed successfully.
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
@@ -102,17 +112,28 @@ GetLbaAndOffsetByAddress (
 **/
 EFI_STATUS
 FtwVariableSpace (
-  IN EFI_PHYSICAL_ADDRESS   VariableBase,
-  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  IN  EFI_PHYSICAL_ADDRESS   VariableBase,
+  IN  VARIABLE_STORE_HEADER  *VariableBuffer,
+  OUT UINTN                  *BlockCount
   )
 {
   EFI_STATUS                         Status;
   EFI_HANDLE                         FvbHandle;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL *Fvb;
   EFI_LBA                            VarLba;
   UINTN                              VarOffset;
+  EFI_LBA                            WriteLba;
+  UINTN                              WriteOffset;
   UINTN                              FtwBufferSize;
+  UINTN                              BlockSize;
+  UINTN                              NumberOfBlocks;
+  UINTN                              WriteStart;
+  UINTN                              WriteEnd;
+  UINTN                              Length;
   EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
 
+  *BlockCount = 0;
+
   //
   // Locate fault tolerant write protocol.
   //
@@ -123,7 +144,7 @@ FtwVariableSpace (
   //
   // Locate Fvb handle by address.
   //
-  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, NULL);
+  Status = GetFvbInfoByAddress (VariableBase, &FvbHandle, &Fvb);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -138,17 +159,70 @@ FtwVariableSpace (
   FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
   ASSERT (FtwBufferSize == VariableBuffer->Size);
 
+  WriteLba    = VarLba;
+  WriteOffset = VarOffset;
+  WriteStart  = 0;
+  WriteEnd    = FtwBufferSize;
+
+  //
+  // The unchanged blocks can only be located if all the blocks of the store
+  // have the same size, otherwise write the whole store.
+  //
+  Status = Fvb->GetBlockSize (Fvb, VarLba, &BlockSize, &NumberOfBlocks);
+  if (!EFI_ERROR (Status) && (BlockSize > VarOffset) &&
+      ((VarOffset + FtwBufferSize + BlockSize - 1) / BlockSize <= NumberOfBlocks)) {
+    //
+    // Skip the leading blocks which are the same in flash and in the buffer.
+    // The offsets are from VariableBase, whose first block starts VarOffset
+    // bytes before it.
+    //
+    while (WriteStart < FtwBufferSize) {
+      Length = MIN (BlockSize - (VarOffset + WriteStart) % BlockSize, FtwBufferSize - WriteStart);
+      if (CompareMem ((UINT8 *) (UINTN) VariableBase + WriteStart, (UINT8 *) VariableBuffer + WriteStart, Length) != 0) {
+        break;
+      }
+      WriteStart += Length;
+    }
+
+    if (WriteStart == FtwBufferSize) {
+      //
+      // Nothing changes.
+      //
+      return EFI_SUCCESS;
+    }
+
+    //
+    // Skip the trailing blocks which are the same, typically erased blocks
+    // beyond the end of the variables in both.
+    //
+    while (WriteEnd > WriteStart) {
+      Length = (VarOffset + WriteEnd) % BlockSize;
+      if (Length == 0) {
+        Length = BlockSize;
+      }
+      Length = MIN (Length, WriteEnd - WriteStart);
+      if (CompareMem ((UINT8 *) (UINTN) VariableBase + WriteEnd - Length, (UINT8 *) VariableBuffer + WriteEnd - Length, Length) != 0) {
+        break;
+      }
+      WriteEnd -= Length;
+    }
+
+    *BlockCount = (VarOffset + WriteEnd + BlockSize - 1) / BlockSize - (VarOffset + WriteStart) / BlockSize;
+    WriteLba    = VarLba + (VarOffset + WriteStart) / BlockSize;
+    WriteOffset = (VarOffset + WriteStart) % BlockSize;
+  }
+
   //
   // FTW write record.
   //
   Status = FtwProtocol->Write (
                           FtwProtocol,
-                          VarLba,         // LBA
-                          VarOffset,      // Offset
-                          FtwBufferSize,  // NumBytes
-                          NULL,           // PrivateData NULL
-                          FvbHandle,      // Fvb Handle
-                          (VOID *) VariableBuffer // write buffer
+                          WriteLba,                               // LBA
+                          WriteOffset,                            // Offset
+                          WriteEnd - WriteStart,                  // NumBytes
+                          NULL,                                   // PrivateData NULL
+                          FvbHandle,                              // Fvb Handle
+                          (UINT8 *) VariableBuffer + WriteStart   // write buffer
                           );
 
   return Status;
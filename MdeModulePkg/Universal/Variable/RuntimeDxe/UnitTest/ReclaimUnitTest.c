@@ -0,0 +1,566 @@
+/** @file
+  Unit tests of the write of a reclaimed variable store to flash. The
+  FtwVariableSpace () writes to a fake firmware volume block are checked
+  against the new store over random reclaims, and the flash blocks they
+  rewrite are counted against those of a write of the whole store.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../Variable.h"
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestRandomLib.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Reclaim Write Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// The fake firmware volume has 4 KB blocks and holds the NV variable store
+// right behind its header, as in the FVs of most platforms.
+//
+#define TEST_BLOCK_SIZE           SIZE_4KB
+#define TEST_BLOCK_COUNT          64
+#define TEST_FV_HEADER_LENGTH     (sizeof (EFI_FIRMWARE_VOLUME_HEADER) + sizeof (EFI_FV_BLOCK_MAP_ENTRY))
+#define TEST_STORE_SIZE           (TEST_BLOCK_COUNT * TEST_BLOCK_SIZE - TEST_FV_HEADER_LENGTH)
+
+//
+// Each reclaim removes up to TEST_DELETED_SIZE_MAX bytes of deleted variables
+// from the store and appends up to TEST_ADDED_SIZE_MAX bytes of new ones, or
+// updates variables in place at TEST_UPDATED_COUNT_MAX random offsets.
+//
+#define TEST_RECLAIM_COUNT        20000
+#define TEST_DELETED_SIZE_MAX     SIZE_4KB
+#define TEST_ADDED_SIZE_MAX       SIZE_4KB
+#define TEST_UPDATED_COUNT_MAX    4
+#define TEST_NON_UNIFORM_COUNT    100
+
+UINT8                               *mFlash;
+VARIABLE_STORE_HEADER               *mOldStore;
+VARIABLE_STORE_HEADER               *mNewStore;
+UINTN                               mStoreEnd;
+BOOLEAN                             mUniformBlocks;
+
+//
+// What the fake FTW protocol was asked to write.
+//
+UINTN                               mWriteCount;
+UINTN                               mWriteStart;
+UINTN                               mWriteLength;
+
+/**
+  Returns the address of the fake firmware volume.
+
+  @param[in]  This     The fake FVB protocol.
+  @param[out] Address  Return the address of the fake firmware volume.
+
+  @retval EFI_SUCCESS  The address is returned.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FakeFvbGetPhysicalAddress (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL  *This,
+  OUT       EFI_PHYSICAL_ADDRESS                 *Address
+  )
+{
+  *Address = (EFI_PHYSICAL_ADDRESS) (UINTN) mFlash;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the size of the blocks of the fake firmware volume. Unless
+  mUniformBlocks is set, each block is reported as the only one of its size.
+
+  @param[in]  This            The fake FVB protocol.
+  @param[in]  Lba             The block to return the size of.
+  @param[out] BlockSize       Return the size of the block.
+  @param[out] NumberOfBlocks  Return the number of blocks of the same size from Lba.
+
+  @retval EFI_SUCCESS            The size is returned.
+  @retval EFI_INVALID_PARAMETER  Lba is beyond the fake firmware volume.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FakeFvbGetBlockSize (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL  *This,
+  IN        EFI_LBA                              Lba,
+  OUT       UINTN                                *BlockSize,
+  OUT       UINTN                                *NumberOfBlocks
+  )
+{
+  if (Lba >= TEST_BLOCK_COUNT) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *BlockSize      = TEST_BLOCK_SIZE;
+  *NumberOfBlocks = mUniformBlocks ? (UINTN) (TEST_BLOCK_COUNT - Lba) : 1;
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes a buffer to the fake firmware volume at once, and records what is
+  written.
+
+  @param[in] This         The fake FTW protocol.
+  @param[in] Lba          The first block to write.
+  @param[in] Offset       The offset of the write in that block.
+  @param[in] Length       The number of bytes to write.
+  @param[in] PrivateData  Unused.
+  @param[in] FvbHandle    The handle of the fake FVB protocol.
+  @param[in] Buffer       The bytes to write.
+
+  @retval EFI_SUCCESS            The buffer is written.
+  @retval EFI_INVALID_PARAMETER  The write is not within the fake firmware volume.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FakeFtwWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *This,
+  IN EFI_LBA                            Lba,
+  IN UINTN                              Offset,
+  IN UINTN                              Length,
+  IN VOID                               *PrivateData,
+  IN EFI_HANDLE                         FvbHandle,
+  IN VOID                               *Buffer
+  )
+{
+  UINTN  Start;
+
+  Start = (UINTN) Lba * TEST_BLOCK_SIZE + Offset;
+  if ((FvbHandle != (EFI_HANDLE) &mFlash) || (Offset >= TEST_BLOCK_SIZE) ||
+      (Start + Length > TEST_BLOCK_COUNT * TEST_BLOCK_SIZE)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem (mFlash + Start, Buffer, Length);
+  mWriteCount++;
+  mWriteStart  = Start;
+  mWriteLength = Length;
+  return EFI_SUCCESS;
+}
+
+EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL  mFakeFvb = {
+  NULL,
+  NULL,
+  FakeFvbGetPhysicalAddress,
+  FakeFvbGetBlockSize,
+  NULL,
+  NULL,
+  NULL,
+  NULL
+};
+
+EFI_FAULT_TOLERANT_WRITE_PROTOCOL    mFakeFtw = {
+  NULL,
+  NULL,
+  FakeFtwWrite,
+  NULL,
+  NULL,
+  NULL
+};
+
+/**
+  Get Fault Tolerant Write protocol.
+
+  @param[out] FtwProtocol       Return the fake FTW protocol.
+
+  @retval EFI_SUCCESS           The fake FTW protocol is returned.
+**/
+EFI_STATUS
+GetFtwProtocol (
+  OUT VOID                                **FtwProtocol
+  )
+{
+  *FtwProtocol = &mFakeFtw;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the fake fvb handle and/or fvb protocol if the address is in the fake
+  firmware volume.
+
+  @param[in]  Address        The Flash address.
+  @param[out] FvbHandle      In output, if it is not NULL, it points to the fake FVB handle.
+  @param[out] FvbProtocol    In output, if it is not NULL, it points to the fake FVB protocol.
+
+  @retval EFI_SUCCESS        The address is in the fake firmware volume.
+  @retval EFI_NOT_FOUND      The address is outside of the fake firmware volume.
+**/
+EFI_STATUS
+GetFvbInfoByAddress (
+  IN  EFI_PHYSICAL_ADDRESS                Address,
+  OUT EFI_HANDLE                          *FvbHandle OPTIONAL,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvbProtocol OPTIONAL
+  )
+{
+  if ((Address < (UINTN) mFlash) || (Address >= (UINTN) mFlash + TEST_BLOCK_COUNT * TEST_BLOCK_SIZE)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (FvbHandle != NULL) {
+    *FvbHandle = (EFI_HANDLE) &mFlash;
+  }
+  if (FvbProtocol != NULL) {
+    *FvbProtocol = &mFakeFvb;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Fills a range of a store with random bytes, which stand for the variables.
+
+  @param[in] Buffer  The first byte to fill.
+  @param[in] Length  The number of bytes to fill.
+**/
+STATIC
+VOID
+FillRandomVariables (
+  IN UINT8  *Buffer,
+  IN UINTN  Length
+  )
+{
+  while (Length-- > 0) {
+    *Buffer++ = (UINT8) UnitTestRandom ();
+  }
+}
+
+/**
+  Creates the fake firmware volume with an empty NV variable store, and the
+  buffers which hold the store before and after a reclaim.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                 The fake firmware volume is created.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of resources.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupFlash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+
+  mFlash    = AllocatePool (TEST_BLOCK_COUNT * TEST_BLOCK_SIZE);
+  mOldStore = AllocatePool (TEST_STORE_SIZE);
+  mNewStore = AllocatePool (TEST_STORE_SIZE);
+  if ((mFlash == NULL) || (mOldStore == NULL) || (mNewStore == NULL)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  SetMem (mFlash, TEST_BLOCK_COUNT * TEST_BLOCK_SIZE, 0xff);
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) mFlash;
+  ZeroMem (FvHeader, TEST_FV_HEADER_LENGTH);
+  FvHeader->FvLength              = TEST_BLOCK_COUNT * TEST_BLOCK_SIZE;
+  FvHeader->Signature             = EFI_FVH_SIGNATURE;
+  FvHeader->HeaderLength          = (UINT16) TEST_FV_HEADER_LENGTH;
+  FvHeader->Revision              = EFI_FVH_REVISION;
+  FvHeader->BlockMap[0].NumBlocks = TEST_BLOCK_COUNT;
+  FvHeader->BlockMap[0].Length    = TEST_BLOCK_SIZE;
+
+  mNewStore->Size = TEST_STORE_SIZE;
+  CopyGuid (&mNewStore->Signature, &gEfiVariableGuid);
+  mNewStore->Format    = VARIABLE_STORE_FORMATTED;
+  mNewStore->State     = VARIABLE_STORE_HEALTHY;
+  mNewStore->Reserved  = 0;
+  mNewStore->Reserved1 = 0;
+  CopyMem (mFlash + TEST_FV_HEADER_LENGTH, mNewStore, sizeof (VARIABLE_STORE_HEADER));
+  mStoreEnd = sizeof (VARIABLE_STORE_HEADER);
+
+  mUniformBlocks = TRUE;
+  UnitTestRandomSeed (0x7EC1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the fake firmware volume and the store buffers.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupFlash (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mFlash != NULL) {
+    FreePool (mFlash);
+    mFlash = NULL;
+  }
+  if (mOldStore != NULL) {
+    FreePool (mOldStore);
+    mOldStore = NULL;
+  }
+  if (mNewStore != NULL) {
+    FreePool (mNewStore);
+    mNewStore = NULL;
+  }
+}
+
+/**
+  Builds the store as a reclaim would leave it in mNewStore, from the store in
+  flash. Most reclaims remove a random range of deleted variables, move the
+  variables after it down, and append new variables. One reclaim in four
+  only updates a few variables in place instead, and one in sixteen leaves
+  the store unchanged.
+**/
+STATIC
+VOID
+ReclaimStore (
+  VOID
+  )
+{
+  UINTN  DeletedStart;
+  UINTN  DeletedSize;
+  UINTN  AddedSize;
+  UINTN  UpdatedCount;
+
+  CopyMem (mOldStore, mFlash + TEST_FV_HEADER_LENGTH, TEST_STORE_SIZE);
+  CopyMem (mNewStore, mOldStore, TEST_STORE_SIZE);
+  switch ((UINTN) UnitTestRandom () % 16) {
+  case 0:
+    return;
+
+  case 1:
+  case 2:
+  case 3:
+  case 4:
+    if (mStoreEnd > sizeof (VARIABLE_STORE_HEADER)) {
+      UpdatedCount = 1 + (UINTN) UnitTestRandom () % TEST_UPDATED_COUNT_MAX;
+      while (UpdatedCount-- > 0) {
+        FillRandomVariables (
+          (UINT8 *) mNewStore + sizeof (VARIABLE_STORE_HEADER) + (UINTN) UnitTestRandom () % (mStoreEnd - sizeof (VARIABLE_STORE_HEADER)),
+          1
+          );
+      }
+      return;
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  if (mStoreEnd > sizeof (VARIABLE_STORE_HEADER)) {
+    DeletedStart = sizeof (VARIABLE_STORE_HEADER) + (UINTN) UnitTestRandom () % (mStoreEnd - sizeof (VARIABLE_STORE_HEADER));
+    DeletedSize  = 1 + (UINTN) UnitTestRandom () % MIN (TEST_DELETED_SIZE_MAX, mStoreEnd - DeletedStart);
+    CopyMem (
+      (UINT8 *) mNewStore + DeletedStart,
+      (UINT8 *) mOldStore + DeletedStart + DeletedSize,
+      mStoreEnd - DeletedStart - DeletedSize
+      );
+    mStoreEnd -= DeletedSize;
+  }
+
+  AddedSize = MIN ((UINTN) UnitTestRandom () % TEST_ADDED_SIZE_MAX, TEST_STORE_SIZE - mStoreEnd);
+  FillRandomVariables ((UINT8 *) mNewStore + mStoreEnd, AddedSize);
+  mStoreEnd += AddedSize;
+  SetMem ((UINT8 *) mNewStore + mStoreEnd, TEST_STORE_SIZE - mStoreEnd, 0xff);
+}
+
+/**
+  Checks FtwVariableSpace () over random reclaims: the flash must hold the new
+  store afterwards, the blocks it reports must be the blocks the FTW write
+  covers, and the first and last of them must change. The blocks rewritten
+  are counted against the blocks of a write of the whole store, and so are
+  the unchanged blocks rewritten between the first and the last changed one.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               Every write matches the new store.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A write does not match.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ReclaimWritesChangedRange (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Reclaim;
+  UINTN       WriteCount;
+  UINTN       BlockCount;
+  UINTN       FirstBlock;
+  UINTN       EndBlock;
+  UINTN       Block;
+  UINTN       Start;
+  UINTN       End;
+  UINT64      RewrittenBlocks;
+  UINT64      UnchangedRewrittenBlocks;
+  UINT64      WholeStoreBlocks;
+
+  RewrittenBlocks          = 0;
+  UnchangedRewrittenBlocks = 0;
+  WholeStoreBlocks         = 0;
+  for (Reclaim = 0; Reclaim < TEST_RECLAIM_COUNT; Reclaim++) {
+    ReclaimStore ();
+
+    WriteCount = mWriteCount;
+    Status = FtwVariableSpace ((EFI_PHYSICAL_ADDRESS) (UINTN) (mFlash + TEST_FV_HEADER_LENGTH), mNewStore, &BlockCount);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_MEM_EQUAL (mFlash + TEST_FV_HEADER_LENGTH, mNewStore, TEST_STORE_SIZE);
+
+    WholeStoreBlocks += (TEST_FV_HEADER_LENGTH + TEST_STORE_SIZE + TEST_BLOCK_SIZE - 1) / TEST_BLOCK_SIZE;
+    if (CompareMem (mOldStore, mNewStore, TEST_STORE_SIZE) == 0) {
+      UT_ASSERT_EQUAL (mWriteCount, WriteCount);
+      UT_ASSERT_EQUAL (BlockCount, 0);
+      continue;
+    }
+
+    UT_ASSERT_EQUAL (mWriteCount, WriteCount + 1);
+    FirstBlock = mWriteStart / TEST_BLOCK_SIZE;
+    EndBlock   = (mWriteStart + mWriteLength + TEST_BLOCK_SIZE - 1) / TEST_BLOCK_SIZE;
+    UT_ASSERT_EQUAL (BlockCount, EndBlock - FirstBlock);
+    RewrittenBlocks += BlockCount;
+
+    //
+    // Compare the part of each block written which is in the store.
+    //
+    for (Block = FirstBlock; Block < EndBlock; Block++) {
+      Start = MAX (Block * TEST_BLOCK_SIZE, TEST_FV_HEADER_LENGTH) - TEST_FV_HEADER_LENGTH;
+      End   = MIN ((Block + 1) * TEST_BLOCK_SIZE - TEST_FV_HEADER_LENGTH, TEST_STORE_SIZE);
+      if (CompareMem ((UINT8 *) mOldStore + Start, (UINT8 *) mNewStore + Start, End - Start) != 0) {
+        continue;
+      }
+      UT_ASSERT_TRUE ((Block != FirstBlock) && (Block != EndBlock - 1));
+      UnchangedRewrittenBlocks++;
+    }
+  }
+
+  UT_LOG_INFO (
+    "%Lu reclaims: %Lu blocks rewritten, %Lu of them unchanged, against %Lu for whole store writes\n",
+    (UINT64) TEST_RECLAIM_COUNT,
+    RewrittenBlocks,
+    UnchangedRewrittenBlocks,
+    WholeStoreBlocks
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks that FtwVariableSpace () writes the whole store when the blocks of
+  the firmware volume may not all be of the same size.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               Every write covers the whole store.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A write does not.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NonUniformBlocksWriteWholeStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Reclaim;
+  UINTN       WriteCount;
+  UINTN       BlockCount;
+
+  mUniformBlocks = FALSE;
+  for (Reclaim = 0; Reclaim < TEST_NON_UNIFORM_COUNT; Reclaim++) {
+    ReclaimStore ();
+
+    WriteCount = mWriteCount;
+    Status = FtwVariableSpace ((EFI_PHYSICAL_ADDRESS) (UINTN) (mFlash + TEST_FV_HEADER_LENGTH), mNewStore, &BlockCount);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_MEM_EQUAL (mFlash + TEST_FV_HEADER_LENGTH, mNewStore, TEST_STORE_SIZE);
+    UT_ASSERT_EQUAL (mWriteCount, WriteCount + 1);
+    UT_ASSERT_EQUAL (mWriteStart, TEST_FV_HEADER_LENGTH);
+    UT_ASSERT_EQUAL (mWriteLength, TEST_STORE_SIZE);
+    UT_ASSERT_EQUAL (BlockCount, 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the write of
+  the reclaimed variable store and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ReclaimTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the reclaim write Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&ReclaimTests, Framework, "Variable Reclaim Write Tests", "Variable.Reclaim", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ReclaimTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (ReclaimTests, "Reclaim should rewrite only the changed range of blocks",   "ChangedRange", ReclaimWritesChangedRange,       SetupFlash, CleanupFlash, NULL);
+  AddTestCase (ReclaimTests, "Reclaim should rewrite the whole store on non uniform blocks", "NonUniform",   NonUniformBlocksWriteWholeStore, SetupFlash, CleanupFlash, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,1132 @@
+/** @file
+  Unit tests of the variable batch protocol of VariableSmmRuntimeDxe. The
+  batches are sent through a fake MM communicate protocol, whose handler serves
+  SMM_VARIABLE_FUNCTION_GET_VARIABLE, SMM_VARIABLE_FUNCTION_SET_VARIABLE and
+  SMM_VARIABLE_FUNCTION_BATCH requests from an in-memory variable store.
+
+  Random batches are compared with the same operations sent one by one
+  through GetVariable () and SetVariable (), and both are timed, with the SMI
+  round trip emulated by a busy wait in the fake MM communicate protocol.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <PiDxe.h>
+#include <Protocol/MmCommunication2.h>
+#include <Protocol/VariableBatch.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiRuntimeLib.h>
+#include <Library/UefiDecompressLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestRandomLib.h>
+#include <Guid/SmmVariableCommon.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Batch Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// The fake variable store holds up to TEST_VARIABLE_MAX variables, named
+// from TEST_NAME_COUNT names. Batches also use a name which is never set.
+//
+#define TEST_VARIABLE_MAX         32
+#define TEST_NAME_COUNT           24
+#define TEST_LOOKUP_NAME_COUNT    (TEST_NAME_COUNT + 1)
+#define TEST_NAME_LENGTH          16
+#define TEST_DATA_SIZE_MAX        SIZE_16KB
+
+//
+// The random batches, sent with the communicate buffer payload of the default
+// PcdMaxVariableSize and with a payload ten times larger.
+//
+#define TEST_BATCH_COUNT          2000
+#define TEST_BATCH_ENTRY_MAX      64
+#define TEST_SMALL_PAYLOAD_SIZE   SIZE_1KB
+#define TEST_LARGE_PAYLOAD_SIZE   (10 * SIZE_1KB)
+
+//
+// The timed batches of TEST_TIMED_ENTRY_COUNT SetVariable () operations. The
+// SMI round trip is emulated as TEST_SMI_ROUND_TRIP_US microseconds, the order
+// of the time it takes all the CPUs of a multi-core host to enter and leave
+// SMM.
+//
+#define TEST_TIMED_ENTRY_COUNT    50
+#define TEST_TIMED_BATCH_COUNT    100
+#define TEST_SMI_ROUND_TRIP_US    50
+
+#define TEST_VARIABLE_ATTRIBUTES  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+typedef struct {
+  BOOLEAN   InUse;
+  CHAR16    Name[TEST_NAME_LENGTH];
+  EFI_GUID  Guid;
+  UINT32    Attributes;
+  UINTN     DataSize;
+  UINT8     Data[TEST_DATA_SIZE_MAX];
+} TEST_VARIABLE;
+
+//
+// The VariableSmmRuntimeDxe globals which InitCommunicateBuffer () and
+// SendCommunicateBuffer () use.
+//
+extern EFI_MM_COMMUNICATION2_PROTOCOL  *mMmCommunication2;
+extern UINT8                           *mVariableBuffer;
+extern UINT8                           *mVariableBufferPhysical;
+extern UINTN                           mVariableBufferSize;
+extern UINTN                           mVariableBufferPayloadSize;
+
+EFI_STATUS
+EFIAPI
+RuntimeServiceGetVariable (
+  IN      CHAR16                            *VariableName,
+  IN      EFI_GUID                          *VendorGuid,
+  OUT     UINT32                            *Attributes OPTIONAL,
+  IN OUT  UINTN                             *DataSize,
+  OUT     VOID                              *Data
+  );
+
+EFI_STATUS
+EFIAPI
+RuntimeServiceSetVariable (
+  IN CHAR16                                 *VariableName,
+  IN EFI_GUID                               *VendorGuid,
+  IN UINT32                                 Attributes,
+  IN UINTN                                  DataSize,
+  IN VOID                                   *Data
+  );
+
+EFI_STATUS
+EFIAPI
+VariableBatchExecute (
+  IN     EDKII_VARIABLE_BATCH_PROTOCOL      *This,
+  IN     UINTN                              Count,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY         *Entries
+  );
+
+//
+// The tests call no boot or runtime service.
+//
+EFI_BOOT_SERVICES           *gBS = NULL;
+EFI_RUNTIME_SERVICES        *gRT = NULL;
+
+EFI_GUID                    mTestGuid = { 0x6E1AB47D, 0x30C2, 0x4F65, { 0x9B, 0x84, 0x1D, 0xE7, 0x52, 0xA0, 0x3C, 0x19 } };
+
+CHAR16                      mTestName[TEST_LOOKUP_NAME_COUNT][TEST_NAME_LENGTH];
+TEST_VARIABLE               mStore[TEST_VARIABLE_MAX];
+TEST_VARIABLE               mSavedStore[TEST_VARIABLE_MAX];
+TEST_VARIABLE               mBatchStore[TEST_VARIABLE_MAX];
+UINT8                       *mSmramBuffer;
+UINTN                       mSmiCount;
+UINTN                       mSmiRoundTrip;
+UINTN                       mSecureBootHookCount;
+
+//
+// The random batch entries, and the data buffers they point to.
+//
+EDKII_VARIABLE_BATCH_ENTRY  mBatchEntry[TEST_BATCH_ENTRY_MAX];
+EDKII_VARIABLE_BATCH_ENTRY  mSingleEntry[TEST_BATCH_ENTRY_MAX];
+UINT8                       mBatchData[TEST_BATCH_ENTRY_MAX][TEST_DATA_SIZE_MAX];
+UINT8                       mSingleData[TEST_BATCH_ENTRY_MAX][TEST_DATA_SIZE_MAX];
+
+/**
+  Returns whether ExitBootServices () has been called, which the tests never do.
+
+  @retval FALSE  ExitBootServices () has not been called.
+**/
+BOOLEAN
+EFIAPI
+EfiAtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Acquires a lock, which the single threaded tests need not do.
+
+  @param[in]  Lock  The lock to acquire.
+**/
+VOID
+EFIAPI
+EfiAcquireLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+}
+
+/**
+  Releases a lock, which the single threaded tests need not do.
+
+  @param[in]  Lock  The lock to release.
+**/
+VOID
+EFIAPI
+EfiReleaseLock (
+  IN EFI_LOCK  *Lock
+  )
+{
+}
+
+/**
+  Signals an event group, which has no member in the tests.
+
+  @param[in]  EventGroup  The event group to signal.
+
+  @retval EFI_SUCCESS  The event group is signaled.
+**/
+EFI_STATUS
+EFIAPI
+EfiEventGroupSignal (
+  IN CONST EFI_GUID  *EventGroup
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Counts the variable writes which the secure boot policy is measured for.
+
+  @param[in]  VariableName  The name of the variable written.
+  @param[in]  VendorGuid    The vendor GUID of the variable written.
+**/
+VOID
+EFIAPI
+SecureBootHook (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid
+  )
+{
+  mSecureBootHookCount++;
+}
+
+/**
+  Every variable write signals the variable write event group in the tests.
+
+  @param[in]  VendorGuid    The vendor GUID of the variable written.
+
+  @retval TRUE  The event group is signaled.
+**/
+BOOLEAN
+IsVariableWriteEventNeeded (
+  IN CONST EFI_GUID  *VendorGuid
+  )
+{
+  return TRUE;
+}
+
+/**
+  The secure boot policy is not measured in the tests.
+**/
+VOID
+EFIAPI
+RecordSecureBootPolicyVarData (
+  VOID
+  )
+{
+}
+
+/**
+  Initializes a lock, which the single threaded tests need not do.
+
+  @param[in, out]  Lock      The lock to initialize.
+  @param[in]       Priority  The task priority level of the lock.
+
+  @return Lock.
+**/
+EFI_LOCK *
+EFIAPI
+EfiInitializeLock (
+  IN OUT EFI_LOCK  *Lock,
+  IN     EFI_TPL   Priority
+  )
+{
+  return Lock;
+}
+
+/**
+  The tests do not run the driver entry point, which creates the events.
+
+  @param[in]   ProtocolGuid    Unused.
+  @param[in]   NotifyTpl       Unused.
+  @param[in]   NotifyFunction  Unused.
+  @param[in]   NotifyContext   Unused.
+  @param[out]  Registration    Unused.
+
+  @return NULL.
+**/
+EFI_EVENT
+EFIAPI
+EfiCreateProtocolNotifyEvent (
+  IN  EFI_GUID          *ProtocolGuid,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction,
+  IN  VOID              *NotifyContext,  OPTIONAL
+  OUT VOID              **Registration
+  )
+{
+  return NULL;
+}
+
+/**
+  The tests do not run the driver entry point, which creates the events.
+
+  @param[in]   NotifyTpl         Unused.
+  @param[in]   NotifyFunction    Unused.
+  @param[in]   NotifyContext     Unused.
+  @param[out]  ReadyToBootEvent  Unused.
+
+  @retval EFI_UNSUPPORTED  Always.
+**/
+EFI_STATUS
+EFIAPI
+EfiCreateEventReadyToBootEx (
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction,  OPTIONAL
+  IN  VOID              *NotifyContext,  OPTIONAL
+  OUT EFI_EVENT         *ReadyToBootEvent
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The tests do not run the driver entry point, which creates the events.
+
+  @param[in]   NotifyTpl        Unused.
+  @param[in]   NotifyFunction   Unused.
+  @param[in]   NotifyContext    Unused.
+  @param[out]  LegacyBootEvent  Unused.
+
+  @retval EFI_UNSUPPORTED  Always.
+**/
+EFI_STATUS
+EFIAPI
+EfiCreateEventLegacyBootEx (
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction,  OPTIONAL
+  IN  VOID              *NotifyContext,  OPTIONAL
+  OUT EFI_EVENT         *LegacyBootEvent
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The tests never reach SetVirtualAddressMap ().
+
+  @param[in]       DebugDisposition  Unused.
+  @param[in, out]  Address           Unused.
+
+  @retval EFI_UNSUPPORTED  Always.
+**/
+EFI_STATUS
+EFIAPI
+EfiConvertPointer (
+  IN     UINTN  DebugDisposition,
+  IN OUT VOID   **Address
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The tests never reach SetVirtualAddressMap ().
+
+  @param[in]       DebugDisposition  Unused.
+  @param[in, out]  ListHead          Unused.
+
+  @retval EFI_UNSUPPORTED  Always.
+**/
+EFI_STATUS
+EFIAPI
+EfiConvertList (
+  IN     UINTN       DebugDisposition,
+  IN OUT LIST_ENTRY  *ListHead
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The runtime cache, which holds the compressed variables, is disabled in the
+  tests.
+
+  @param[in]  Source           The source buffer containing the compressed data.
+  @param[in]  SourceSize       The size, in bytes, of the source buffer.
+  @param[out] DestinationSize  A pointer to the size, in bytes, of the uncompressed buffer.
+  @param[out] ScratchSize      A pointer to the size, in bytes, of the scratch buffer.
+
+  @retval RETURN_UNSUPPORTED   Always.
+**/
+RETURN_STATUS
+EFIAPI
+UefiDecompressGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  The runtime cache, which holds the compressed variables, is disabled in the
+  tests.
+
+  @param[in]      Source       The source buffer containing the compressed data.
+  @param[in, out] Destination  The destination buffer to store the decompressed data.
+  @param[in, out] Scratch      A temporary scratch buffer.
+
+  @retval RETURN_UNSUPPORTED   Always.
+**/
+RETURN_STATUS
+EFIAPI
+UefiDecompress (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch  OPTIONAL
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  Finds a variable of the fake variable store.
+
+  @param[in]  VariableName  The name of the variable.
+  @param[in]  VendorGuid    The vendor GUID of the variable.
+
+  @return The variable, or NULL if it is not in the store.
+**/
+STATIC
+TEST_VARIABLE *
+FindTestVariable (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TEST_VARIABLE_MAX; Index++) {
+    if (mStore[Index].InUse && (StrCmp (mStore[Index].Name, VariableName) == 0) &&
+        CompareGuid (&mStore[Index].Guid, VendorGuid)) {
+      return &mStore[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Gets a variable of the fake variable store, as VariableServiceGetVariable ()
+  does.
+
+  @param[in]       VariableName  The name of the variable.
+  @param[in]       VendorGuid    The vendor GUID of the variable.
+  @param[out]      Attributes    Return the attributes of the variable.
+  @param[in, out]  DataSize      The size of Data, return the size of the variable data.
+  @param[out]      Data          Return the variable data.
+
+  @retval EFI_SUCCESS           The variable is returned.
+  @retval EFI_NOT_FOUND         The variable is not in the store.
+  @retval EFI_BUFFER_TOO_SMALL  DataSize is too small for the variable data.
+**/
+STATIC
+EFI_STATUS
+FakeGetVariable (
+  IN     CHAR16    *VariableName,
+  IN     EFI_GUID  *VendorGuid,
+  OUT    UINT32    *Attributes,
+  IN OUT UINTN     *DataSize,
+  OUT    VOID      *Data
+  )
+{
+  TEST_VARIABLE  *Variable;
+
+  Variable = FindTestVariable (VariableName, VendorGuid);
+  if (Variable == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *Attributes = Variable->Attributes;
+  if (*DataSize < Variable->DataSize) {
+    *DataSize = Variable->DataSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  *DataSize = Variable->DataSize;
+  CopyMem (Data, Variable->Data, Variable->DataSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Sets a variable of the fake variable store, as VariableServiceSetVariable ()
+  does. A zero DataSize deletes the variable.
+
+  @param[in]  VariableName  The name of the variable.
+  @param[in]  VendorGuid    The vendor GUID of the variable.
+  @param[in]  Attributes    The attributes of the variable.
+  @param[in]  DataSize      The size of the variable data.
+  @param[in]  Data          The variable data.
+
+  @retval EFI_SUCCESS            The variable is set.
+  @retval EFI_INVALID_PARAMETER  The attributes or the name are not valid.
+  @retval EFI_NOT_FOUND          The variable to delete is not in the store.
+  @retval EFI_OUT_OF_RESOURCES   The store has no room for the variable.
+**/
+STATIC
+EFI_STATUS
+FakeSetVariable (
+  IN CHAR16    *VariableName,
+  IN EFI_GUID  *VendorGuid,
+  IN UINT32    Attributes,
+  IN UINTN     DataSize,
+  IN VOID      *Data
+  )
+{
+  TEST_VARIABLE  *Variable;
+
+  if (((Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0) && ((Attributes & EFI_VARIABLE_BOOTSERVICE_ACCESS) == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (StrSize (VariableName) > sizeof (Variable->Name)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Variable = FindTestVariable (VariableName, VendorGuid);
+  if (DataSize == 0) {
+    if (Variable == NULL) {
+      return EFI_NOT_FOUND;
+    }
+    Variable->InUse = FALSE;
+    return EFI_SUCCESS;
+  }
+
+  if (DataSize > TEST_DATA_SIZE_MAX) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  if (Variable == NULL) {
+    for (Variable = mStore; Variable < &mStore[TEST_VARIABLE_MAX] && Variable->InUse; Variable++) {
+    }
+    if (Variable == &mStore[TEST_VARIABLE_MAX]) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    StrCpyS (Variable->Name, TEST_NAME_LENGTH, VariableName);
+    CopyGuid (&Variable->Guid, VendorGuid);
+    Variable->InUse = TRUE;
+  }
+
+  Variable->Attributes = Attributes;
+  Variable->DataSize   = DataSize;
+  CopyMem (Variable->Data, Data, DataSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Busy waits for the emulated SMI round trip.
+**/
+STATIC
+VOID
+WaitSmiRoundTrip (
+  VOID
+  )
+{
+  clock_t  Start;
+
+  if (mSmiRoundTrip == 0) {
+    return;
+  }
+
+  Start = clock ();
+  while ((UINT64) (clock () - Start) * 1000000 < (UINT64) mSmiRoundTrip * CLOCKS_PER_SEC) {
+  }
+}
+
+/**
+  Communicates with the fake SMM variable handler. The message is copied in and
+  out of a buffer which stands for SMRAM, as SmmVariableHandler () copies it to
+  mVariableBufferPayload.
+
+  @param[in]      This                The fake MM communicate protocol.
+  @param[in, out] CommBufferPhysical  Unused.
+  @param[in, out] CommBufferVirtual   The message.
+  @param[in, out] CommSize            The size of the message buffer.
+
+  @retval EFI_SUCCESS            The message is handled.
+  @retval EFI_INVALID_PARAMETER  The message is larger than the message buffer.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FakeCommunicate (
+  IN CONST EFI_MM_COMMUNICATION2_PROTOCOL  *This,
+  IN OUT VOID                              *CommBufferPhysical,
+  IN OUT VOID                              *CommBufferVirtual,
+  IN OUT UINTN                             *CommSize
+  )
+{
+  EFI_MM_COMMUNICATE_HEADER             *CommunicateHeader;
+  SMM_VARIABLE_COMMUNICATE_HEADER       *FunctionHeader;
+  SMM_VARIABLE_COMMUNICATE_BATCH        *Batch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY  *Entry;
+  UINTN                                 MessageLength;
+  UINTN                                 Offset;
+  UINTN                                 DataSize;
+  UINTN                                 Index;
+
+  CommunicateHeader = (EFI_MM_COMMUNICATE_HEADER *) CommBufferVirtual;
+  MessageLength     = CommunicateHeader->MessageLength;
+  if (MessageLength + SMM_COMMUNICATE_HEADER_SIZE > *CommSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  mSmiCount++;
+  WaitSmiRoundTrip ();
+
+  CopyMem (mSmramBuffer, CommunicateHeader->Data, MessageLength);
+  FunctionHeader = (SMM_VARIABLE_COMMUNICATE_HEADER *) mSmramBuffer;
+  switch (FunctionHeader->Function) {
+  case SMM_VARIABLE_FUNCTION_GET_VARIABLE:
+  case SMM_VARIABLE_FUNCTION_SET_VARIABLE:
+    //
+    // The function header followed by the variable is laid out as a batch
+    // entry, handle it as a batch of one.
+    //
+    Entry = (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY *) ((UINT8 *) FunctionHeader->Data - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY, Variable));
+    Batch = NULL;
+    break;
+
+  case SMM_VARIABLE_FUNCTION_BATCH:
+    Batch = (SMM_VARIABLE_COMMUNICATE_BATCH *) FunctionHeader->Data;
+    Entry = (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY *) (Batch + 1);
+    break;
+
+  default:
+    FunctionHeader->ReturnStatus = EFI_UNSUPPORTED;
+    CopyMem (CommunicateHeader->Data, mSmramBuffer, MessageLength);
+    return EFI_SUCCESS;
+  }
+
+  Offset = 0;
+  for (Index = 0; Index < ((Batch == NULL) ? 1 : Batch->Count); Index++) {
+    Entry    = (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY *) ((UINT8 *) Entry + Offset);
+    DataSize = Entry->Variable.DataSize;
+    if (Entry->Function == SMM_VARIABLE_FUNCTION_GET_VARIABLE) {
+      Entry->ReturnStatus = FakeGetVariable (
+                              Entry->Variable.Name,
+                              &Entry->Variable.Guid,
+                              &Entry->Variable.Attributes,
+                              &Entry->Variable.DataSize,
+                              (UINT8 *) Entry->Variable.Name + Entry->Variable.NameSize
+                              );
+    } else {
+      Entry->ReturnStatus = FakeSetVariable (
+                              Entry->Variable.Name,
+                              &Entry->Variable.Guid,
+                              Entry->Variable.Attributes,
+                              Entry->Variable.DataSize,
+                              (UINT8 *) Entry->Variable.Name + Entry->Variable.NameSize
+                              );
+    }
+    Offset = SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY_SIZE (Entry->Variable.NameSize, DataSize);
+  }
+
+  FunctionHeader->ReturnStatus = (Batch == NULL) ? Entry->ReturnStatus : EFI_SUCCESS;
+  CopyMem (CommunicateHeader->Data, mSmramBuffer, MessageLength);
+  return EFI_SUCCESS;
+}
+
+EFI_MM_COMMUNICATION2_PROTOCOL  mFakeMmCommunication2 = {
+  FakeCommunicate
+};
+
+/**
+  Sets up the communicate buffer of VariableSmmRuntimeDxe for a payload size,
+  and empties the fake variable store.
+
+  @param[in]  PayloadSize  The payload size of the communicate buffer.
+
+  @retval TRUE   The communicate buffer is set up.
+  @retval FALSE  Out of resources.
+**/
+STATIC
+BOOLEAN
+SetupCommunicateBuffer (
+  IN UINTN  PayloadSize
+  )
+{
+  if (mVariableBuffer != NULL) {
+    FreePool (mVariableBuffer);
+  }
+  if (mSmramBuffer != NULL) {
+    FreePool (mSmramBuffer);
+  }
+
+  mVariableBufferPayloadSize = PayloadSize;
+  mVariableBufferSize        = SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize;
+  mVariableBuffer            = AllocatePool (mVariableBufferSize);
+  mVariableBufferPhysical    = mVariableBuffer;
+  mSmramBuffer               = AllocatePool (mVariableBufferSize);
+  mMmCommunication2          = &mFakeMmCommunication2;
+  mSmiRoundTrip              = 0;
+  ZeroMem (mStore, sizeof (mStore));
+
+  return (BOOLEAN) ((mVariableBuffer != NULL) && (mSmramBuffer != NULL));
+}
+
+/**
+  Creates the names of the test variables, and seeds the random generator.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The names are created.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupNames (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Number;
+  UINTN  Length;
+
+  for (Number = 0; Number < TEST_LOOKUP_NAME_COUNT; Number++) {
+    StrCpyS (mTestName[Number], TEST_NAME_LENGTH, L"BatchVar");
+    Length = StrLen (mTestName[Number]);
+    mTestName[Number][Length++] = L"0123456789"[Number / 10];
+    mTestName[Number][Length++] = L"0123456789"[Number % 10];
+    mTestName[Number][Length]   = L'\0';
+  }
+  UnitTestRandomSeed (0xBA7C);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the communicate buffers.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupCommunicateBuffer (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mVariableBuffer != NULL) {
+    FreePool (mVariableBuffer);
+    mVariableBuffer         = NULL;
+    mVariableBufferPhysical = NULL;
+  }
+  if (mSmramBuffer != NULL) {
+    FreePool (mSmramBuffer);
+    mSmramBuffer = NULL;
+  }
+}
+
+/**
+  Returns a random data size, which is sometimes larger than the communicate
+  buffer payload, so that the operation is sent alone or fails.
+
+  @return The data size.
+**/
+STATIC
+UINTN
+RandomDataSize (
+  VOID
+  )
+{
+  switch ((UINTN) UnitTestRandom () % 16) {
+  case 0:
+    return 0;
+
+  case 1:
+  case 2:
+    return (UINTN) UnitTestRandom () % TEST_DATA_SIZE_MAX;
+
+  case 3:
+    return mVariableBufferPayloadSize - 0x40 + (UINTN) UnitTestRandom () % 0x80;
+
+  default:
+    return 1 + (UINTN) UnitTestRandom () % 0x100;
+  }
+}
+
+/**
+  Creates a random batch in mBatchEntry, and a copy of it in mSingleEntry.
+  Most entries get or set one of the test variables. A few are not valid,
+  or ask for a variable which is never set.
+
+  @param[in]  Count  The number of entries.
+**/
+STATIC
+VOID
+CreateRandomBatch (
+  IN UINTN  Count
+  )
+{
+  EDKII_VARIABLE_BATCH_ENTRY  *Entry;
+  UINTN                       Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    Entry = &mBatchEntry[Index];
+    Entry->Operation    = ((UINTN) UnitTestRandom () % 2 == 0) ? EdkiiVariableBatchGet : EdkiiVariableBatchSet;
+    Entry->VariableName = mTestName[(UINTN) UnitTestRandom () % TEST_LOOKUP_NAME_COUNT];
+    Entry->VendorGuid   = &mTestGuid;
+    Entry->Attributes   = (Entry->Operation == EdkiiVariableBatchGet) ? 0 : TEST_VARIABLE_ATTRIBUTES;
+    Entry->DataSize     = RandomDataSize ();
+    Entry->Data         = mBatchData[Index];
+    Entry->Status       = EFI_NOT_READY;
+    if (Entry->Operation == EdkiiVariableBatchSet) {
+      SetMem (Entry->Data, MIN (Entry->DataSize, TEST_DATA_SIZE_MAX), (UINT8) UnitTestRandom ());
+    }
+
+    switch ((UINTN) UnitTestRandom () % 32) {
+    case 0:
+      Entry->VariableName = NULL;
+      break;
+
+    case 1:
+      Entry->VariableName = L"";
+      break;
+
+    case 2:
+      Entry->Operation = (EDKII_VARIABLE_BATCH_OPERATION) 2;
+      break;
+
+    case 3:
+      Entry->Attributes = EFI_VARIABLE_RUNTIME_ACCESS;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  CopyMem (mSingleEntry, mBatchEntry, Count * sizeof (mBatchEntry[0]));
+  for (Index = 0; Index < Count; Index++) {
+    mSingleEntry[Index].Data = mSingleData[Index];
+    CopyMem (mSingleData[Index], mBatchData[Index], MIN (mBatchEntry[Index].DataSize, TEST_DATA_SIZE_MAX));
+  }
+}
+
+/**
+  Performs the operations of a batch one by one, through GetVariable () and
+  SetVariable ().
+
+  @param[in]      Count    The number of entries.
+  @param[in, out] Entries  The operations, whose Status is set on return.
+**/
+STATIC
+VOID
+ExecuteSingleCalls (
+  IN     UINTN                       Count,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY  *Entries
+  )
+{
+  EDKII_VARIABLE_BATCH_ENTRY  *Entry;
+  UINTN                       Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    Entry = &Entries[Index];
+    if (Entry->Operation == EdkiiVariableBatchGet) {
+      Entry->Status = RuntimeServiceGetVariable (Entry->VariableName, Entry->VendorGuid, &Entry->Attributes, &Entry->DataSize, Entry->Data);
+    } else if (Entry->Operation == EdkiiVariableBatchSet) {
+      Entry->Status = RuntimeServiceSetVariable (Entry->VariableName, Entry->VendorGuid, Entry->Attributes, Entry->DataSize, Entry->Data);
+    } else {
+      Entry->Status = EFI_UNSUPPORTED;
+    }
+  }
+}
+
+/**
+  Checks that random batches leave the same store and return the same results
+  as the same operations sent one by one, and take no more SMIs.
+
+  @param[in]  Context  The payload size of the communicate buffer.
+
+  @retval UNIT_TEST_PASSED             The batches match the single calls.
+  @retval UNIT_TEST_ERROR_TEST_FAILED  A batch does not match.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BatchMatchesSingleCalls (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_VARIABLE_BATCH_ENTRY  *BatchEntry;
+  EDKII_VARIABLE_BATCH_ENTRY  *SingleEntry;
+  UINTN                       Batch;
+  UINTN                       Count;
+  UINTN                       Index;
+  UINTN                       BatchSmiCount;
+  UINTN                       SingleSmiCount;
+  UINTN                       BatchHookCount;
+  UINT64                      TotalBatchSmiCount;
+  UINT64                      TotalSingleSmiCount;
+
+  UT_ASSERT_TRUE (SetupCommunicateBuffer (*(UINTN *) Context));
+
+  TotalBatchSmiCount  = 0;
+  TotalSingleSmiCount = 0;
+  for (Batch = 0; Batch < TEST_BATCH_COUNT; Batch++) {
+    Count = 1 + (UINTN) UnitTestRandom () % TEST_BATCH_ENTRY_MAX;
+    CreateRandomBatch (Count);
+    CopyMem (mSavedStore, mStore, sizeof (mStore));
+
+    mSmiCount            = 0;
+    mSecureBootHookCount = 0;
+    UT_ASSERT_NOT_EFI_ERROR (VariableBatchExecute (NULL, Count, mBatchEntry));
+    BatchSmiCount  = mSmiCount;
+    BatchHookCount = mSecureBootHookCount;
+
+    //
+    // Run the single calls from the same store, and compare the store they
+    // leave with the batch one.
+    //
+    CopyMem (mBatchStore, mStore, sizeof (mStore));
+    CopyMem (mStore, mSavedStore, sizeof (mStore));
+    mSmiCount            = 0;
+    mSecureBootHookCount = 0;
+    ExecuteSingleCalls (Count, mSingleEntry);
+    SingleSmiCount = mSmiCount;
+
+    UT_ASSERT_MEM_EQUAL (mStore, mBatchStore, sizeof (mStore));
+    UT_ASSERT_EQUAL (mSecureBootHookCount, BatchHookCount);
+    UT_ASSERT_TRUE (BatchSmiCount <= SingleSmiCount);
+    TotalBatchSmiCount  += BatchSmiCount;
+    TotalSingleSmiCount += SingleSmiCount;
+
+    for (Index = 0; Index < Count; Index++) {
+      BatchEntry  = &mBatchEntry[Index];
+      SingleEntry = &mSingleEntry[Index];
+      UT_ASSERT_STATUS_EQUAL (BatchEntry->Status, SingleEntry->Status);
+      if ((BatchEntry->Operation == EdkiiVariableBatchGet) &&
+          ((BatchEntry->Status == EFI_SUCCESS) || (BatchEntry->Status == EFI_BUFFER_TOO_SMALL))) {
+        UT_ASSERT_EQUAL (BatchEntry->DataSize, SingleEntry->DataSize);
+        UT_ASSERT_EQUAL (BatchEntry->Attributes, SingleEntry->Attributes);
+        if (BatchEntry->Status == EFI_SUCCESS) {
+          UT_ASSERT_MEM_EQUAL (BatchEntry->Data, SingleEntry->Data, BatchEntry->DataSize);
+        }
+      }
+    }
+  }
+
+  UT_LOG_INFO (
+    "payload %5Lu: %Lu batches in %Lu SMIs, %Lu SMIs one by one\n",
+    (UINT64) *(UINTN *) Context,
+    (UINT64) TEST_BATCH_COUNT,
+    TotalBatchSmiCount,
+    TotalSingleSmiCount
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Times TEST_TIMED_ENTRY_COUNT SetVariable () operations, sent in a batch or
+  one by one.
+
+  @param[in]   DataSize  The data size of the variables.
+  @param[in]   UseBatch  Whether to send the operations in a batch.
+  @param[out]  SmiCount  Return the number of SMIs of one round of operations.
+
+  @return The wall time of one round of operations, in microseconds.
+**/
+STATIC
+UINT64
+TimeSetVariables (
+  IN  UINTN    DataSize,
+  IN  BOOLEAN  UseBatch,
+  OUT UINTN    *SmiCount
+  )
+{
+  EDKII_VARIABLE_BATCH_ENTRY  *Entry;
+  UINTN                       Round;
+  UINTN                       Index;
+  clock_t                     Start;
+  clock_t                     Elapsed;
+
+  for (Index = 0; Index < TEST_TIMED_ENTRY_COUNT; Index++) {
+    Entry = &mBatchEntry[Index];
+    Entry->Operation    = EdkiiVariableBatchSet;
+    Entry->VariableName = mTestName[Index % TEST_NAME_COUNT];
+    Entry->VendorGuid   = &mTestGuid;
+    Entry->Attributes   = TEST_VARIABLE_ATTRIBUTES;
+    Entry->DataSize     = DataSize;
+    Entry->Data         = mBatchData[Index % TEST_BATCH_ENTRY_MAX];
+  }
+
+  mSmiCount = 0;
+  Start = clock ();
+  for (Round = 0; Round < TEST_TIMED_BATCH_COUNT; Round++) {
+    if (UseBatch) {
+      VariableBatchExecute (NULL, TEST_TIMED_ENTRY_COUNT, mBatchEntry);
+    } else {
+      for (Index = 0; Index < TEST_TIMED_ENTRY_COUNT; Index++) {
+        Entry = &mBatchEntry[Index];
+        Entry->Status = RuntimeServiceSetVariable (Entry->VariableName, Entry->VendorGuid, Entry->Attributes, Entry->DataSize, Entry->Data);
+      }
+    }
+  }
+  Elapsed = clock () - Start;
+
+  *SmiCount = mSmiCount / TEST_TIMED_BATCH_COUNT;
+  for (Index = 0; Index < TEST_TIMED_ENTRY_COUNT; Index++) {
+    if (EFI_ERROR (mBatchEntry[Index].Status)) {
+      *SmiCount = 0;
+    }
+  }
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000 / TEST_TIMED_BATCH_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Times TEST_TIMED_ENTRY_COUNT SetVariable () operations sent in a batch and
+  one by one, for both payload sizes and two data sizes, with and without the
+  emulated SMI round trip.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  All the operations succeed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BatchLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINTN  PayloadSize[] = { TEST_SMALL_PAYLOAD_SIZE, TEST_LARGE_PAYLOAD_SIZE };
+  STATIC CONST UINTN  DataSize[]    = { 32, 128 };
+  STATIC CONST UINTN  RoundTrip[]   = { 0, TEST_SMI_ROUND_TRIP_US };
+  UINTN               PayloadNumber;
+  UINTN               DataNumber;
+  UINTN               RoundTripNumber;
+  UINTN               SingleSmiCount;
+  UINTN               BatchSmiCount;
+  UINT64              SingleTime;
+  UINT64              BatchTime;
+
+  for (PayloadNumber = 0; PayloadNumber < ARRAY_SIZE (PayloadSize); PayloadNumber++) {
+    for (DataNumber = 0; DataNumber < ARRAY_SIZE (DataSize); DataNumber++) {
+      for (RoundTripNumber = 0; RoundTripNumber < ARRAY_SIZE (RoundTrip); RoundTripNumber++) {
+        UT_ASSERT_TRUE (SetupCommunicateBuffer (PayloadSize[PayloadNumber]));
+        mSmiRoundTrip = RoundTrip[RoundTripNumber];
+
+        SingleTime = TimeSetVariables (DataSize[DataNumber], FALSE, &SingleSmiCount);
+        BatchTime  = TimeSetVariables (DataSize[DataNumber], TRUE, &BatchSmiCount);
+        UT_ASSERT_EQUAL (SingleSmiCount, TEST_TIMED_ENTRY_COUNT);
+        UT_ASSERT_NOT_EQUAL (BatchSmiCount, 0);
+        UT_LOG_INFO (
+          "payload %5Lu, %Lu x %3Lu bytes, SMI %2Lu us: one by one %2Lu SMIs %5Lu us, batch %2Lu SMIs %5Lu us\n",
+          (UINT64) PayloadSize[PayloadNumber],
+          (UINT64) TEST_TIMED_ENTRY_COUNT,
+          (UINT64) DataSize[DataNumber],
+          (UINT64) RoundTrip[RoundTripNumber],
+          (UINT64) SingleSmiCount,
+          SingleTime,
+          (UINT64) BatchSmiCount,
+          BatchTime
+          );
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the variable
+  batch protocol and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      BatchTests;
+  STATIC UINTN                SmallPayloadSize = TEST_SMALL_PAYLOAD_SIZE;
+  STATIC UINTN                LargePayloadSize = TEST_LARGE_PAYLOAD_SIZE;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the variable batch Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&BatchTests, Framework, "Variable Batch Tests", "Variable.Batch", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BatchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (BatchTests, "Batch should match single calls with a small payload", "MatchSmall", BatchMatchesSingleCalls, SetupNames, CleanupCommunicateBuffer, &SmallPayloadSize);
+  AddTestCase (BatchTests, "Batch should match single calls with a large payload", "MatchLarge", BatchMatchesSingleCalls, SetupNames, CleanupCommunicateBuffer, &LargePayloadSize);
+  AddTestCase (BatchTests, "SetVariable latency in a batch and one by one",         "Latency",    BatchLatency,            SetupNames, CleanupCommunicateBuffer, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
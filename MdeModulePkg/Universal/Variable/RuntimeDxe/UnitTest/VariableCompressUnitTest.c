@@ -0,0 +1,1370 @@
+/** @file
+  Unit tests of the compressed variables of the NV variable store. The data of
+  random variables is compressed the way SetVariable () does and read back
+  through GetVariableDataSize (), ReadVariableData () and GetVariableData (),
+  at boot time and at runtime. Corrupted compressed streams must be reported,
+  and the conversion of an authenticated store done by Reclaim () must keep
+  the data of every variable.
+
+  The space saved on a store holding the usual secure boot, HII and boot
+  option variables is reported, with the time of the reads of the compressed
+  variables.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "../VariableParsing.h"
+#include "../VariableCompress.h"
+#include <Guid/GlobalVariable.h>
+#include <Guid/ImageAuthentication.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestRandomLib.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Compression Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// The random stores hold TEST_VARIABLE_COUNT variables of up to
+// TEST_MAX_DATA_SIZE bytes each.
+//
+#define TEST_STORE_SIZE           SIZE_512KB
+#define TEST_MAX_DATA_SIZE        SIZE_16KB
+#define TEST_VARIABLE_COUNT       24
+#define TEST_ROUND_COUNT          8
+#define TEST_NAME_LENGTH          16
+
+//
+// The random corruptions of a compressed stream.
+//
+#define TEST_CORRUPTION_COUNT     2000
+
+//
+// The timed reads of each variable of the store of usual variables.
+//
+#define TEST_TIMED_READ_COUNT     200
+
+typedef enum {
+  TestDataSparse,
+  TestDataText,
+  TestDataRandom,
+  TestDataKindMax
+} TEST_DATA_KIND;
+
+EFI_GUID  mTestGuid = {
+  0x7C1D9B24, 0x5F3E, 0x4A81, { 0x9E, 0x27, 0x4B, 0xD0, 0x63, 0x18, 0xA5, 0xC2 }
+};
+
+//
+// The vendor GUID of the HII varstores of the store of usual variables.
+//
+EFI_GUID  mTestSetupGuid = {
+  0xEC87D643, 0xEBA4, 0x4BB5, { 0xA1, 0xE5, 0x3F, 0x3E, 0x36, 0xB2, 0x0D, 0xA9 }
+};
+
+//
+// A self-signed X.509 certificate with a 2048-bit RSA key. The serial number,
+// the public key modulus, the key identifiers and the signature are zeroed,
+// and filled with random bytes for each certificate of the store of usual
+// variables.
+//
+CONST UINT8  mTestCertificate[] = {
+  0x30, 0x82, 0x03, 0xD3, 0x30, 0x82, 0x02, 0xBB, 0xA0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x30, 0x0D, 0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x0B,
+  0x05, 0x00, 0x30, 0x79, 0x31, 0x0B, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x55,
+  0x53, 0x31, 0x13, 0x30, 0x11, 0x06, 0x03, 0x55, 0x04, 0x08, 0x0C, 0x0A, 0x57, 0x61, 0x73, 0x68,
+  0x69, 0x6E, 0x67, 0x74, 0x6F, 0x6E, 0x31, 0x10, 0x30, 0x0E, 0x06, 0x03, 0x55, 0x04, 0x07, 0x0C,
+  0x07, 0x52, 0x65, 0x64, 0x6D, 0x6F, 0x6E, 0x64, 0x31, 0x1C, 0x30, 0x1A, 0x06, 0x03, 0x55, 0x04,
+  0x0A, 0x0C, 0x13, 0x45, 0x78, 0x61, 0x6D, 0x70, 0x6C, 0x65, 0x20, 0x43, 0x6F, 0x72, 0x70, 0x6F,
+  0x72, 0x61, 0x74, 0x69, 0x6F, 0x6E, 0x31, 0x25, 0x30, 0x23, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0C,
+  0x1C, 0x45, 0x78, 0x61, 0x6D, 0x70, 0x6C, 0x65, 0x20, 0x55, 0x45, 0x46, 0x49, 0x20, 0x53, 0x69,
+  0x67, 0x6E, 0x69, 0x6E, 0x67, 0x20, 0x43, 0x41, 0x20, 0x32, 0x30, 0x31, 0x31, 0x30, 0x1E, 0x17,
+  0x0D, 0x32, 0x36, 0x31, 0x30, 0x31, 0x39, 0x30, 0x37, 0x30, 0x30, 0x32, 0x38, 0x5A, 0x17, 0x0D,
+  0x33, 0x36, 0x31, 0x30, 0x31, 0x36, 0x30, 0x37, 0x30, 0x30, 0x32, 0x38, 0x5A, 0x30, 0x79, 0x31,
+  0x0B, 0x30, 0x09, 0x06, 0x03, 0x55, 0x04, 0x06, 0x13, 0x02, 0x55, 0x53, 0x31, 0x13, 0x30, 0x11,
+  0x06, 0x03, 0x55, 0x04, 0x08, 0x0C, 0x0A, 0x57, 0x61, 0x73, 0x68, 0x69, 0x6E, 0x67, 0x74, 0x6F,
+  0x6E, 0x31, 0x10, 0x30, 0x0E, 0x06, 0x03, 0x55, 0x04, 0x07, 0x0C, 0x07, 0x52, 0x65, 0x64, 0x6D,
+  0x6F, 0x6E, 0x64, 0x31, 0x1C, 0x30, 0x1A, 0x06, 0x03, 0x55, 0x04, 0x0A, 0x0C, 0x13, 0x45, 0x78,
+  0x61, 0x6D, 0x70, 0x6C, 0x65, 0x20, 0x43, 0x6F, 0x72, 0x70, 0x6F, 0x72, 0x61, 0x74, 0x69, 0x6F,
+  0x6E, 0x31, 0x25, 0x30, 0x23, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0C, 0x1C, 0x45, 0x78, 0x61, 0x6D,
+  0x70, 0x6C, 0x65, 0x20, 0x55, 0x45, 0x46, 0x49, 0x20, 0x53, 0x69, 0x67, 0x6E, 0x69, 0x6E, 0x67,
+  0x20, 0x43, 0x41, 0x20, 0x32, 0x30, 0x31, 0x31, 0x30, 0x82, 0x01, 0x22, 0x30, 0x0D, 0x06, 0x09,
+  0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x01, 0x05, 0x00, 0x03, 0x82, 0x01, 0x0F, 0x00,
+  0x30, 0x82, 0x01, 0x0A, 0x02, 0x82, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x01, 0x00, 0x01, 0xA3, 0x53,
+  0x30, 0x51, 0x30, 0x1D, 0x06, 0x03, 0x55, 0x1D, 0x0E, 0x04, 0x16, 0x04, 0x14, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x30, 0x1F, 0x06, 0x03, 0x55, 0x1D, 0x23, 0x04, 0x18, 0x30, 0x16, 0x80, 0x14, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x30, 0x0F, 0x06, 0x03, 0x55, 0x1D, 0x13, 0x01, 0x01, 0xFF, 0x04, 0x05, 0x30, 0x03,
+  0x01, 0x01, 0xFF, 0x30, 0x0D, 0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x01, 0x0B,
+  0x05, 0x00, 0x03, 0x82, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+//
+// The fields of mTestCertificate which differ between certificates.
+//
+#define TEST_CERTIFICATE_SKI_OFFSET   637
+#define TEST_CERTIFICATE_AKI_OFFSET   670
+#define TEST_CERTIFICATE_KEY_ID_SIZE  20
+
+typedef struct {
+  UINTN   Offset;
+  UINTN   Size;
+} TEST_CERTIFICATE_FIELD;
+
+CONST TEST_CERTIFICATE_FIELD  mTestCertificateField[] = {
+  { 15,                          20                           },  // Serial number
+  { 361,                         256                          },  // Public key modulus
+  { TEST_CERTIFICATE_SKI_OFFSET, TEST_CERTIFICATE_KEY_ID_SIZE },  // Subject key identifier
+  { 727,                         256                          }   // Signature
+};
+
+typedef struct {
+  CHAR16            Name[TEST_NAME_LENGTH];
+  UINT8             *Data;
+  UINTN             DataSize;
+  ///
+  /// The variable in the store of compressed variables, and in the store of
+  /// authenticated variables it was converted from, if any.
+  ///
+  VARIABLE_HEADER   *Variable;
+  VARIABLE_HEADER   *PlainVariable;
+} TEST_VARIABLE;
+
+TEST_VARIABLE           mTestVariable[TEST_VARIABLE_COUNT];
+VARIABLE_STORE_HEADER   *mStore;
+VARIABLE_STORE_HEADER   *mPlainStore;
+BOOLEAN                 mAtRuntime;
+
+//
+// Buffer the variable data is read into, followed by TEST_GUARD_SIZE bytes
+// which must not be written.
+//
+#define TEST_GUARD_SIZE           16
+#define TEST_GUARD_BYTE           0xA5
+
+UINT8                   mBuffer[TEST_MAX_DATA_SIZE + TEST_GUARD_SIZE];
+
+/**
+  Indicates whether the virtual address has been converted.
+
+  @retval TRUE        The emulated runtime phase has been entered.
+  @retval FALSE       The emulated runtime phase has not been entered.
+
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return mAtRuntime;
+}
+
+/**
+  Creates an empty store of authenticated variables.
+
+  @param[in]  Signature   Signature of the variable store.
+
+  @return Pointer to the store, or NULL if there is no memory for it.
+**/
+STATIC
+VARIABLE_STORE_HEADER *
+CreateStore (
+  IN EFI_GUID   *Signature
+  )
+{
+  VARIABLE_STORE_HEADER   *Store;
+
+  Store = AllocatePool (TEST_STORE_SIZE);
+  if (Store == NULL) {
+    return NULL;
+  }
+
+  SetMem (Store, TEST_STORE_SIZE, 0xFF);
+  CopyGuid (&Store->Signature, Signature);
+  Store->Size      = TEST_STORE_SIZE;
+  Store->Format    = VARIABLE_STORE_FORMATTED;
+  Store->State     = VARIABLE_STORE_HEALTHY;
+  Store->Reserved  = 0;
+  Store->Reserved1 = 0;
+  return Store;
+}
+
+/**
+  Finds the end of the variables of a store.
+
+  @param[in]  Store       Pointer to the variable store.
+
+  @return Pointer to the first free byte of the store.
+**/
+STATIC
+VARIABLE_HEADER *
+FindStoreEnd (
+  IN VARIABLE_STORE_HEADER  *Store
+  )
+{
+  VARIABLE_HEADER   *Variable;
+
+  Variable = GetStartPointer (Store);
+  while (IsValidVariableHeader (Variable, GetEndPointer (Store))) {
+    Variable = GetNextVariablePtr (Variable, TRUE);
+  }
+
+  return Variable;
+}
+
+/**
+  Appends an authenticated variable to a store.
+
+  @param[in]  Store       Pointer to the variable store.
+  @param[in]  Name        Name of the variable.
+  @param[in]  Guid        Vendor GUID of the variable.
+  @param[in]  Attributes  Attributes of the variable.
+  @param[in]  Data        Data of the variable.
+  @param[in]  DataSize    Size of the variable data in bytes.
+  @param[in]  State       State of the new variable header.
+
+  @return Pointer to the new variable header, or NULL if the store is full.
+**/
+STATIC
+VARIABLE_HEADER *
+AppendVariable (
+  IN VARIABLE_STORE_HEADER  *Store,
+  IN CHAR16                 *Name,
+  IN EFI_GUID               *Guid,
+  IN UINT32                 Attributes,
+  IN UINT8                  *Data,
+  IN UINTN                  DataSize,
+  IN UINT8                  State
+  )
+{
+  VARIABLE_HEADER   *Variable;
+  UINTN             NameSize;
+  UINTN             Size;
+
+  NameSize = StrSize (Name);
+  Size     = GetVariableHeaderSize (TRUE) + NameSize + GET_PAD_SIZE (NameSize) + DataSize;
+  Variable = FindStoreEnd (Store);
+  if ((UINTN) Variable + Size > (UINTN) GetEndPointer (Store)) {
+    return NULL;
+  }
+
+  ZeroMem (Variable, GetVariableHeaderSize (TRUE));
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = State;
+  Variable->Attributes = Attributes;
+  SetNameSizeOfVariable (Variable, NameSize, TRUE);
+  SetDataSizeOfVariable (Variable, DataSize, TRUE);
+  CopyGuid (GetVendorGuidPtr (Variable, TRUE), Guid);
+  CopyMem (GetVariableNamePtr (Variable, TRUE), Name, NameSize);
+  CopyMem (GetVariableDataPtr (Variable, TRUE), Data, DataSize);
+  return Variable;
+}
+
+/**
+  Fills a buffer with test variable data.
+
+  @param[out]  Data       Buffer to fill.
+  @param[in]   DataSize   Size of the buffer in bytes.
+  @param[in]   Kind       TestDataSparse for mostly zero data like the HII
+                          varstores, TestDataText for repeated text, and
+                          TestDataRandom for data which does not compress.
+**/
+STATIC
+VOID
+FillTestData (
+  OUT UINT8           *Data,
+  IN  UINTN           DataSize,
+  IN  TEST_DATA_KIND  Kind
+  )
+{
+  STATIC CONST CHAR8  Text[] = "UEFI Network Boot Option PXE IPv4 Intel ";
+  UINTN               Index;
+
+  switch (Kind) {
+  case TestDataSparse:
+    ZeroMem (Data, DataSize);
+    for (Index = 0; Index < DataSize; Index += 1 + (UINTN) UnitTestRandom () % 6) {
+      Data[Index] = (UnitTestRandom () % 3 == 0) ? (UINT8) (UnitTestRandom () % 4) : 1;
+    }
+    break;
+
+  case TestDataText:
+    for (Index = 0; Index < DataSize; Index++) {
+      Data[Index] = Text[Index % (sizeof (Text) - 1)];
+    }
+    break;
+
+  default:
+    for (Index = 0; Index < DataSize; Index++) {
+      Data[Index] = (UINT8) UnitTestRandom ();
+    }
+    break;
+  }
+}
+
+/**
+  Checks the data of a variable seen by the variable services.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  Data        The data the variable was written with.
+  @param[in]  DataSize    Size of Data in bytes.
+
+  @retval UNIT_TEST_PASSED               GetVariableDataSize (), ReadVariableData ()
+                                         and GetVariableData () return the data.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    The data or its size differs, or the
+                                         read wrote past the data.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckVariableData (
+  IN VARIABLE_HEADER  *Variable,
+  IN UINT8            *Data,
+  IN UINTN            DataSize
+  )
+{
+  VOID    *Pointer;
+  UINTN   Index;
+
+  UT_ASSERT_EQUAL (GetVariableDataSize (Variable, TRUE), DataSize);
+
+  SetMem (mBuffer, DataSize + TEST_GUARD_SIZE, TEST_GUARD_BYTE);
+  UT_ASSERT_NOT_EFI_ERROR (ReadVariableData (Variable, TRUE, mBuffer));
+  UT_ASSERT_MEM_EQUAL (mBuffer, Data, DataSize);
+  for (Index = DataSize; Index < DataSize + TEST_GUARD_SIZE; Index++) {
+    UT_ASSERT_EQUAL (mBuffer[Index], TEST_GUARD_BYTE);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (GetVariableData (Variable, TRUE, &Pointer));
+  UT_ASSERT_MEM_EQUAL (Pointer, Data, DataSize);
+  if (!IsCompressedVariable (mStore, Variable)) {
+    UT_ASSERT_EQUAL (Pointer, GetVariableDataPtr (Variable, TRUE));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Allocates the buffers of the data of the test variables.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                      The buffers are allocated.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  No memory for the buffers.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupTestVariables (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Number;
+
+  for (Number = 0; Number < TEST_VARIABLE_COUNT; Number++) {
+    mTestVariable[Number].Name[0] = L'\0';
+    mTestVariable[Number].Data    = AllocatePool (TEST_MAX_DATA_SIZE);
+    if (mTestVariable[Number].Data == NULL) {
+      return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+    }
+  }
+
+  UnitTestRandomSeed (0x56617243);
+  mAtRuntime = FALSE;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the stores and the data of the test variables, and the decompressed
+  data cache.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupTestVariables (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Number;
+
+  mAtRuntime = FALSE;
+  VariableDecompressCacheInvalidate ();
+
+  for (Number = 0; Number < TEST_VARIABLE_COUNT; Number++) {
+    if (mTestVariable[Number].Data != NULL) {
+      FreePool (mTestVariable[Number].Data);
+      mTestVariable[Number].Data = NULL;
+    }
+  }
+  if (mStore != NULL) {
+    FreePool (mStore);
+    mStore = NULL;
+  }
+  if (mPlainStore != NULL) {
+    FreePool (mPlainStore);
+    mPlainStore = NULL;
+  }
+}
+
+/**
+  Creates the name of a test variable, "Var" followed by a letter.
+
+  @param[out]  Name    Buffer of TEST_NAME_LENGTH characters for the name.
+  @param[in]   Number  Number of the variable, less than 26.
+**/
+STATIC
+VOID
+CreateTestName (
+  OUT CHAR16  *Name,
+  IN  UINTN   Number
+  )
+{
+  StrCpyS (Name, TEST_NAME_LENGTH, L"VarA");
+  Name[3] = (CHAR16) (L'A' + Number);
+}
+
+/**
+  Fills a test variable with random data of a random kind. A quarter of the
+  variables are of the size of PcdVariableCompressThreshold or one byte less.
+
+  @param[in]   Number  Number of the test variable.
+
+  @return The kind of the data.
+**/
+STATIC
+TEST_DATA_KIND
+CreateRandomTestVariable (
+  IN UINTN    Number
+  )
+{
+  TEST_VARIABLE   *Test;
+  TEST_DATA_KIND  Kind;
+
+  Test = &mTestVariable[Number];
+  CreateTestName (Test->Name, Number);
+  Kind = (TEST_DATA_KIND) (UnitTestRandom () % TestDataKindMax);
+  if (UnitTestRandom () % 4 == 0) {
+    Test->DataSize = PcdGet32 (PcdVariableCompressThreshold) - (UINTN) (UnitTestRandom () % 2);
+  } else {
+    Test->DataSize = 1 + (UINTN) UnitTestRandom () % TEST_MAX_DATA_SIZE;
+  }
+  FillTestData (Test->Data, Test->DataSize, Kind);
+  return Kind;
+}
+
+/**
+  Compresses random variables appended to a store of compressed variables,
+  and reads their data back at boot time and at runtime.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               The data of every variable is read back.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A variable is compressed when it must
+                                         not be, or the other way around, or its
+                                         data differs.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CompressedDataRoundTrip (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+  TEST_VARIABLE     *Test;
+  TEST_DATA_KIND    Kind;
+  VARIABLE_HEADER   *NextVariable;
+  UINT32            Attributes;
+  UINTN             Round;
+  UINTN             Number;
+  UINTN             VariableSize;
+  UINT8             *Pointer;
+  BOOLEAN           Compressible;
+
+  for (Round = 0; Round < TEST_ROUND_COUNT; Round++) {
+    mStore = CreateStore (&gEdkiiCompressedVariableGuid);
+    UT_ASSERT_NOT_NULL (mStore);
+    UT_ASSERT_NOT_EFI_ERROR (VariableDecompressCacheRegisterStore (mStore, NULL, TEST_MAX_DATA_SIZE));
+
+    for (Number = 0; Number < TEST_VARIABLE_COUNT; Number++) {
+      Test       = &mTestVariable[Number];
+      Kind       = CreateRandomTestVariable (Number);
+      Attributes = EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
+      if (UnitTestRandom () % 4 != 0) {
+        Attributes |= EFI_VARIABLE_NON_VOLATILE;
+      }
+
+      Test->Variable = AppendVariable (mStore, Test->Name, &mTestGuid, Attributes, Test->Data, Test->DataSize, VAR_ADDED);
+      UT_ASSERT_NOT_NULL (Test->Variable);
+      NextVariable = GetNextVariablePtr (Test->Variable, TRUE);
+
+      //
+      // The space the variable no longer uses must be free.
+      //
+      VariableSize = CompressVariable (mStore, Test->Variable, TRUE);
+      UT_ASSERT_EQUAL (VariableSize, (UINTN) GetNextVariablePtr (Test->Variable, TRUE) - (UINTN) Test->Variable);
+      for (Pointer = (UINT8 *) Test->Variable + VariableSize; Pointer < (UINT8 *) NextVariable; Pointer++) {
+        UT_ASSERT_EQUAL (*Pointer, 0xFF);
+      }
+
+      Compressible = (BOOLEAN) (((Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) &&
+                                (Test->DataSize >= PcdGet32 (PcdVariableCompressThreshold)));
+      if (IsCompressedVariable (mStore, Test->Variable)) {
+        UT_ASSERT_TRUE (Compressible);
+        UT_ASSERT_TRUE (DataSizeOfVariable (Test->Variable, TRUE) <= Test->DataSize - Test->DataSize / 8);
+      } else {
+        UT_ASSERT_FALSE (Compressible && (Kind != TestDataRandom));
+        UT_ASSERT_EQUAL (DataSizeOfVariable (Test->Variable, TRUE), Test->DataSize);
+      }
+
+      Status = CheckVariableData (Test->Variable, Test->Data, Test->DataSize);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+
+    //
+    // At runtime, the data is read from the cache filled at boot time, then
+    // decompressed again once the cache is discarded.
+    //
+    mAtRuntime = TRUE;
+    for (Number = 0; Number < 2 * TEST_VARIABLE_COUNT; Number++) {
+      if (Number == TEST_VARIABLE_COUNT) {
+        VariableDecompressCacheInvalidate ();
+      }
+      Test   = &mTestVariable[Number % TEST_VARIABLE_COUNT];
+      Status = CheckVariableData (Test->Variable, Test->Data, Test->DataSize);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+
+    //
+    // Nothing is compressed at runtime.
+    //
+    Test = &mTestVariable[0];
+    FillTestData (Test->Data, TEST_MAX_DATA_SIZE, TestDataSparse);
+    Test->Variable = AppendVariable (
+                       mStore,
+                       Test->Name,
+                       &mTestGuid,
+                       EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                       Test->Data,
+                       TEST_MAX_DATA_SIZE,
+                       VAR_ADDED
+                       );
+    UT_ASSERT_NOT_NULL (Test->Variable);
+    CompressVariable (mStore, Test->Variable, TRUE);
+    UT_ASSERT_FALSE (IsCompressedVariable (mStore, Test->Variable));
+    UT_ASSERT_EQUAL (CompressVariableData (Test->Variable->Attributes, Test->Data, TEST_MAX_DATA_SIZE), TEST_MAX_DATA_SIZE);
+
+    mAtRuntime = FALSE;
+    VariableDecompressCacheInvalidate ();
+    FreePool (mStore);
+    mStore = NULL;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Checks the sizes of the data of compressed variables and of variables stored
+  as is, and that the flag VARIABLE_DATA_COMPRESSED is ignored in a store of
+  authenticated variables.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               The sizes are those of the data seen by
+                                         the variable services.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A size differs.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CompressedDataSizes (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+  TEST_VARIABLE     *Test;
+  TEST_VARIABLE     *Plain;
+  UINT8             *Stream;
+  UINTN             StreamSize;
+  VOID              *Pointer;
+
+  mStore = CreateStore (&gEdkiiCompressedVariableGuid);
+  UT_ASSERT_NOT_NULL (mStore);
+  UT_ASSERT_NOT_EFI_ERROR (VariableDecompressCacheRegisterStore (mStore, NULL, TEST_MAX_DATA_SIZE));
+
+  //
+  // The compressed stream starts with its own size and the original size.
+  //
+  Test = &mTestVariable[0];
+  CreateTestName (Test->Name, 0);
+  Test->DataSize = SIZE_4KB;
+  FillTestData (Test->Data, Test->DataSize, TestDataSparse);
+  Test->Variable = AppendVariable (
+                     mStore,
+                     Test->Name,
+                     &mTestGuid,
+                     EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                     Test->Data,
+                     Test->DataSize,
+                     VAR_ADDED
+                     );
+  UT_ASSERT_NOT_NULL (Test->Variable);
+  CompressVariable (mStore, Test->Variable, TRUE);
+  UT_ASSERT_TRUE (IsCompressedVariable (mStore, Test->Variable));
+
+  Stream     = GetVariableDataPtr (Test->Variable, TRUE);
+  StreamSize = DataSizeOfVariable (Test->Variable, TRUE);
+  UT_ASSERT_TRUE (StreamSize < Test->DataSize);
+  UT_ASSERT_EQUAL (ReadUnaligned32 ((UINT32 *) Stream) + 2 * sizeof (UINT32), StreamSize);
+  UT_ASSERT_EQUAL (ReadUnaligned32 ((UINT32 *) Stream + 1), Test->DataSize);
+  Status = CheckVariableData (Test->Variable, Test->Data, Test->DataSize);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  //
+  // A variable too small to be compressed is stored as is.
+  //
+  Plain = &mTestVariable[1];
+  CreateTestName (Plain->Name, 1);
+  Plain->DataSize = PcdGet32 (PcdVariableCompressThreshold) - 1;
+  FillTestData (Plain->Data, Plain->DataSize, TestDataSparse);
+  Plain->Variable = AppendVariable (
+                      mStore,
+                      Plain->Name,
+                      &mTestGuid,
+                      EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                      Plain->Data,
+                      Plain->DataSize,
+                      VAR_ADDED
+                      );
+  UT_ASSERT_NOT_NULL (Plain->Variable);
+  CompressVariable (mStore, Plain->Variable, TRUE);
+  UT_ASSERT_FALSE (IsCompressedVariable (mStore, Plain->Variable));
+  Status = CheckVariableData (Plain->Variable, Plain->Data, Plain->DataSize);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  //
+  // The same compressed stream in a store of authenticated variables is the
+  // data of the variable, whatever its flags.
+  //
+  mPlainStore = mStore;
+  mStore      = CreateStore (&gEfiAuthenticatedVariableGuid);
+  UT_ASSERT_NOT_NULL (mStore);
+  UT_ASSERT_NOT_EFI_ERROR (VariableDecompressCacheRegisterStore (mStore, NULL, TEST_MAX_DATA_SIZE));
+  Plain = &mTestVariable[2];
+  CreateTestName (Plain->Name, 2);
+  Plain->DataSize = StreamSize;
+  CopyMem (Plain->Data, Stream, StreamSize);
+  Plain->Variable = AppendVariable (
+                      mStore,
+                      Plain->Name,
+                      &mTestGuid,
+                      EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                      Plain->Data,
+                      Plain->DataSize,
+                      VAR_ADDED
+                      );
+  UT_ASSERT_NOT_NULL (Plain->Variable);
+  Plain->Variable->Reserved = VARIABLE_DATA_COMPRESSED;
+  UT_ASSERT_FALSE (IsCompressedVariable (mStore, Plain->Variable));
+  Status = CheckVariableData (Plain->Variable, Plain->Data, Plain->DataSize);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  //
+  // A compressed variable of a store which is not the one of the cache is not
+  // decompressed.
+  //
+  UT_ASSERT_EQUAL (GetVariableDataSize (Test->Variable, TRUE), StreamSize);
+  UT_ASSERT_NOT_EFI_ERROR (GetVariableData (Test->Variable, TRUE, &Pointer));
+  UT_ASSERT_EQUAL (Pointer, (VOID *) Stream);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reads the data of a compressed variable whose stream is corrupted.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[out] Status      Returns the status of ReadVariableData ().
+
+  @retval UNIT_TEST_PASSED               ReadVariableData () and GetVariableData ()
+                                         return the same status, and the read did
+                                         not write past the data.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    The statuses differ, or the read wrote
+                                         past the data.
+**/
+STATIC
+UNIT_TEST_STATUS
+ReadCorruptedVariable (
+  IN  VARIABLE_HEADER   *Variable,
+  OUT EFI_STATUS        *Status
+  )
+{
+  UINTN   DataSize;
+  UINTN   Index;
+  VOID    *Pointer;
+
+  DataSize = GetVariableDataSize (Variable, TRUE);
+  UT_ASSERT_TRUE (DataSize <= TEST_MAX_DATA_SIZE);
+
+  VariableDecompressCacheInvalidate ();
+  SetMem (mBuffer, DataSize + TEST_GUARD_SIZE, TEST_GUARD_BYTE);
+  *Status = ReadVariableData (Variable, TRUE, mBuffer);
+  for (Index = DataSize; Index < DataSize + TEST_GUARD_SIZE; Index++) {
+    UT_ASSERT_EQUAL (mBuffer[Index], TEST_GUARD_BYTE);
+  }
+
+  VariableDecompressCacheInvalidate ();
+  UT_ASSERT_STATUS_EQUAL (GetVariableData (Variable, TRUE, &Pointer), *Status);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Reads the data of a compressed variable whose stream is corrupted in the
+  header, and with random bytes changed.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               Every corrupted header is reported, and
+                                         no read writes past the data.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A corrupted header is not reported, or a
+                                         read writes past the data.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CorruptedStreams (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  TestStatus;
+  EFI_STATUS        Status;
+  TEST_VARIABLE     *Test;
+  UINT8             *Stream;
+  UINTN             StreamSize;
+  UINT8             *Original;
+  UINTN             Corruption;
+  UINTN             Change;
+  UINTN             CorruptedCount;
+  VOID              *Pointer;
+
+  mStore = CreateStore (&gEdkiiCompressedVariableGuid);
+  UT_ASSERT_NOT_NULL (mStore);
+  UT_ASSERT_NOT_EFI_ERROR (VariableDecompressCacheRegisterStore (mStore, NULL, TEST_MAX_DATA_SIZE));
+
+  Test = &mTestVariable[0];
+  CreateTestName (Test->Name, 0);
+  Test->DataSize = SIZE_4KB;
+  FillTestData (Test->Data, Test->DataSize, TestDataSparse);
+  Test->Variable = AppendVariable (
+                     mStore,
+                     Test->Name,
+                     &mTestGuid,
+                     EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                     Test->Data,
+                     Test->DataSize,
+                     VAR_ADDED
+                     );
+  UT_ASSERT_NOT_NULL (Test->Variable);
+  CompressVariable (mStore, Test->Variable, TRUE);
+  UT_ASSERT_TRUE (IsCompressedVariable (mStore, Test->Variable));
+
+  Stream     = GetVariableDataPtr (Test->Variable, TRUE);
+  StreamSize = DataSizeOfVariable (Test->Variable, TRUE);
+  Original   = mTestVariable[1].Data;
+  CopyMem (Original, Stream, StreamSize);
+
+  //
+  // The size of the compressed data goes past the variable.
+  //
+  WriteUnaligned32 ((UINT32 *) Stream, ReadUnaligned32 ((UINT32 *) Stream) + 1);
+  TestStatus = ReadCorruptedVariable (Test->Variable, &Status);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_VOLUME_CORRUPTED);
+  CopyMem (Stream, Original, StreamSize);
+
+  //
+  // The variable is shorter than its compressed data.
+  //
+  SetDataSizeOfVariable (Test->Variable, StreamSize - 1, TRUE);
+  TestStatus = ReadCorruptedVariable (Test->Variable, &Status);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_VOLUME_CORRUPTED);
+
+  //
+  // The variable is shorter than the header of the compressed data.
+  //
+  SetDataSizeOfVariable (Test->Variable, 2 * sizeof (UINT32) - 1, TRUE);
+  UT_ASSERT_EQUAL (GetVariableDataSize (Test->Variable, TRUE), 2 * sizeof (UINT32) - 1);
+  TestStatus = ReadCorruptedVariable (Test->Variable, &Status);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_VOLUME_CORRUPTED);
+  SetDataSizeOfVariable (Test->Variable, StreamSize, TRUE);
+
+  //
+  // At runtime, the original size is larger than the spare buffer.
+  //
+  WriteUnaligned32 ((UINT32 *) Stream + 1, TEST_MAX_DATA_SIZE + 1);
+  VariableDecompressCacheInvalidate ();
+  mAtRuntime = TRUE;
+  UT_ASSERT_STATUS_EQUAL (GetVariableData (Test->Variable, TRUE, &Pointer), EFI_OUT_OF_RESOURCES);
+  mAtRuntime = FALSE;
+  CopyMem (Stream, Original, StreamSize);
+
+  //
+  // Random bytes of the compressed data are changed. The decompression may
+  // not notice, but it must not write past the data.
+  //
+  CorruptedCount = 0;
+  for (Corruption = 0; Corruption < TEST_CORRUPTION_COUNT; Corruption++) {
+    for (Change = 0; Change <= (UINTN) UnitTestRandom () % 4; Change++) {
+      Stream[2 * sizeof (UINT32) + (UINTN) UnitTestRandom () % (StreamSize - 2 * sizeof (UINT32))] ^= (UINT8) (1 + UnitTestRandom () % 0xFF);
+    }
+    mAtRuntime = (BOOLEAN) (Corruption % 2 != 0);
+    TestStatus = ReadCorruptedVariable (Test->Variable, &Status);
+    mAtRuntime = FALSE;
+    if (TestStatus != UNIT_TEST_PASSED) {
+      return TestStatus;
+    }
+    if (Status == EFI_VOLUME_CORRUPTED) {
+      CorruptedCount++;
+    } else {
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+    }
+    CopyMem (Stream, Original, StreamSize);
+  }
+  UT_LOG_INFO ("%Lu of %Lu corrupted streams reported\n", (UINT64) CorruptedCount, (UINT64) TEST_CORRUPTION_COUNT);
+
+  return CheckVariableData (Test->Variable, Test->Data, Test->DataSize);
+}
+
+/**
+  Copies the variables which are ADDED in a store to a store of compressed
+  variables and compresses them, the way Reclaim () converts the NV variable
+  store.
+
+  @param[in]   Store      Pointer to the variable store to convert.
+  @param[out]  NewStore   Buffer of Store->Size bytes for the converted store.
+**/
+STATIC
+VOID
+ConvertStore (
+  IN  VARIABLE_STORE_HEADER   *Store,
+  OUT VARIABLE_STORE_HEADER   *NewStore
+  )
+{
+  VARIABLE_HEADER   *Variable;
+  VARIABLE_HEADER   *NextVariable;
+  UINT8             *CurrPtr;
+
+  SetMem (NewStore, Store->Size, 0xFF);
+  CopyMem (NewStore, Store, sizeof (VARIABLE_STORE_HEADER));
+  CopyGuid (&NewStore->Signature, &gEdkiiCompressedVariableGuid);
+
+  CurrPtr  = (UINT8 *) GetStartPointer (NewStore);
+  Variable = GetStartPointer (Store);
+  while (IsValidVariableHeader (Variable, GetEndPointer (Store))) {
+    NextVariable = GetNextVariablePtr (Variable, TRUE);
+    if (Variable->State == VAR_ADDED) {
+      CopyMem (CurrPtr, Variable, (UINTN) NextVariable - (UINTN) Variable);
+      CurrPtr += CompressVariable (Store, (VARIABLE_HEADER *) CurrPtr, TRUE);
+    }
+    Variable = NextVariable;
+  }
+}
+
+/**
+  Converts a store of authenticated variables to a store of compressed
+  variables, and converts the result again.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               The converted store holds the data of
+                                         the variables which are ADDED, and the
+                                         second conversion changes nothing.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A variable is lost or its data differs,
+                                         or the second conversion changes the store.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ReclaimConversion (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS        Status;
+  TEST_VARIABLE           *Test;
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_STORE_HEADER   *Store;
+  UINTN                   Number;
+  UINTN                   CompressedCount;
+  UINTN                   PlainSize;
+  UINTN                   ConvertedSize;
+
+  mPlainStore = CreateStore (&gEfiAuthenticatedVariableGuid);
+  UT_ASSERT_NOT_NULL (mPlainStore);
+  mStore = CreateStore (&gEdkiiCompressedVariableGuid);
+  UT_ASSERT_NOT_NULL (mStore);
+
+  //
+  // Every fifth variable is deleted, and every third one carries the flag
+  // VARIABLE_DATA_COMPRESSED, which means nothing in this store.
+  //
+  for (Number = 0; Number < TEST_VARIABLE_COUNT; Number++) {
+    Test = &mTestVariable[Number];
+    CreateRandomTestVariable (Number);
+    Test->PlainVariable = AppendVariable (
+                            mPlainStore,
+                            Test->Name,
+                            &mTestGuid,
+                            EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                            Test->Data,
+                            Test->DataSize,
+                            (Number % 5 == 1) ? (VAR_ADDED & VAR_DELETED) : VAR_ADDED
+                            );
+    UT_ASSERT_NOT_NULL (Test->PlainVariable);
+    if (Number % 3 == 0) {
+      Test->PlainVariable->Reserved = VARIABLE_DATA_COMPRESSED;
+    }
+  }
+  PlainSize = (UINTN) FindStoreEnd (mPlainStore) - (UINTN) GetStartPointer (mPlainStore);
+
+  ConvertStore (mPlainStore, mStore);
+  UT_ASSERT_NOT_EFI_ERROR (VariableDecompressCacheRegisterStore (mStore, NULL, TEST_MAX_DATA_SIZE));
+  ConvertedSize = (UINTN) FindStoreEnd (mStore) - (UINTN) GetStartPointer (mStore);
+
+  CompressedCount = 0;
+  Variable = GetStartPointer (mStore);
+  for (Number = 0; Number < TEST_VARIABLE_COUNT; Number++) {
+    if (Number % 5 == 1) {
+      continue;
+    }
+    Test = &mTestVariable[Number];
+    UT_ASSERT_TRUE (IsValidVariableHeader (Variable, GetEndPointer (mStore)));
+    UT_ASSERT_EQUAL (NameSizeOfVariable (Variable, TRUE), StrSize (Test->Name));
+    UT_ASSERT_MEM_EQUAL (GetVariableNamePtr (Variable, TRUE), Test->Name, StrSize (Test->Name));
+    if (IsCompressedVariable (mStore, Variable)) {
+      CompressedCount++;
+    } else {
+      UT_ASSERT_EQUAL (Variable->Reserved & VARIABLE_DATA_COMPRESSED, 0);
+    }
+    Status = CheckVariableData (Variable, Test->Data, Test->DataSize);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+    Variable = GetNextVariablePtr (Variable, TRUE);
+  }
+  UT_ASSERT_FALSE (IsValidVariableHeader (Variable, GetEndPointer (mStore)));
+  UT_LOG_INFO (
+    "%Lu of %Lu variables compressed, store bytes used %Lu -> %Lu\n",
+    (UINT64) CompressedCount,
+    (UINT64) TEST_VARIABLE_COUNT,
+    (UINT64) PlainSize,
+    (UINT64) ConvertedSize
+    );
+
+  //
+  // The variables which are compressed are copied as is, and the others still
+  // do not compress.
+  //
+  Store = CreateStore (&gEdkiiCompressedVariableGuid);
+  UT_ASSERT_NOT_NULL (Store);
+  ConvertStore (mStore, Store);
+  Status = (CompareMem (Store, mStore, TEST_STORE_SIZE) == 0) ? UNIT_TEST_PASSED : UNIT_TEST_ERROR_TEST_FAILED;
+  FreePool (Store);
+  UT_ASSERT_EQUAL (Status, UNIT_TEST_PASSED);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Appends a test variable to the store of authenticated variables, and to the
+  store of compressed variables where it is compressed.
+
+  @param[in]  Number      Number of the test variable.
+  @param[in]  Name        Name of the variable.
+  @param[in]  Guid        Vendor GUID of the variable.
+  @param[in]  DataSize    Size of the data already in the test variable.
+
+  @retval TRUE            The variable is appended to both stores.
+  @retval FALSE           A store is full.
+**/
+STATIC
+BOOLEAN
+AppendUsualVariable (
+  IN UINTN      Number,
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid,
+  IN UINTN      DataSize
+  )
+{
+  TEST_VARIABLE   *Test;
+  UINT32          Attributes;
+
+  Test           = &mTestVariable[Number];
+  Test->DataSize = DataSize;
+  StrCpyS (Test->Name, TEST_NAME_LENGTH, Name);
+  Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
+  Test->PlainVariable = AppendVariable (mPlainStore, Test->Name, Guid, Attributes, Test->Data, DataSize, VAR_ADDED);
+  Test->Variable      = AppendVariable (mStore, Test->Name, Guid, Attributes, Test->Data, DataSize, VAR_ADDED);
+  if ((Test->PlainVariable == NULL) || (Test->Variable == NULL)) {
+    return FALSE;
+  }
+
+  CompressVariable (mStore, Test->Variable, TRUE);
+  return TRUE;
+}
+
+/**
+  Fills the data of a test variable with a list of X.509 certificates, the
+  way the PK, KEK and db variables hold them.
+
+  @param[in]  Number      Number of the test variable.
+  @param[in]  Count       Number of certificates.
+
+  @return Size of the data.
+**/
+STATIC
+UINTN
+CreateCertificateList (
+  IN UINTN    Number,
+  IN UINTN    Count
+  )
+{
+  EFI_SIGNATURE_LIST  *List;
+  EFI_SIGNATURE_DATA  *Signature;
+  UINTN               DataSize;
+  UINTN               Field;
+  UINTN               Index;
+
+  DataSize = 0;
+  while (Count-- > 0) {
+    List = (EFI_SIGNATURE_LIST *) (mTestVariable[Number].Data + DataSize);
+    CopyGuid (&List->SignatureType, &gEfiCertX509Guid);
+    List->SignatureHeaderSize = 0;
+    List->SignatureSize       = (UINT32) (sizeof (EFI_GUID) + sizeof (mTestCertificate));
+    List->SignatureListSize   = (UINT32) (sizeof (EFI_SIGNATURE_LIST) + List->SignatureSize);
+
+    Signature = (EFI_SIGNATURE_DATA *) (List + 1);
+    CopyGuid (&Signature->SignatureOwner, &mTestGuid);
+    CopyMem (Signature->SignatureData, mTestCertificate, sizeof (mTestCertificate));
+    for (Field = 0; Field < ARRAY_SIZE (mTestCertificateField); Field++) {
+      for (Index = 0; Index < mTestCertificateField[Field].Size; Index++) {
+        Signature->SignatureData[mTestCertificateField[Field].Offset + Index] = (UINT8) UnitTestRandom ();
+      }
+    }
+    CopyMem (
+      &Signature->SignatureData[TEST_CERTIFICATE_AKI_OFFSET],
+      &Signature->SignatureData[TEST_CERTIFICATE_SKI_OFFSET],
+      TEST_CERTIFICATE_KEY_ID_SIZE
+      );
+
+    DataSize += List->SignatureListSize;
+  }
+
+  return DataSize;
+}
+
+/**
+  Times the reads of the data of a variable.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  DataSize    Size of the data of the variable.
+  @param[in]  Cached      TRUE to read the data through GetVariableData (),
+                          FALSE to read it with ReadVariableData ().
+
+  @return The average time of a read in nanoseconds.
+**/
+STATIC
+UINT64
+TimeVariableReads (
+  IN VARIABLE_HEADER  *Variable,
+  IN UINTN            DataSize,
+  IN BOOLEAN          Cached
+  )
+{
+  UINTN     Read;
+  VOID      *Pointer;
+  clock_t   Start;
+  clock_t   Elapsed;
+
+  Start = clock ();
+  for (Read = 0; Read < TEST_TIMED_READ_COUNT; Read++) {
+    if (Cached) {
+      GetVariableData (Variable, TRUE, &Pointer);
+      CopyMem (mBuffer, Pointer, DataSize);
+    } else {
+      ReadVariableData (Variable, TRUE, mBuffer);
+    }
+  }
+  Elapsed = clock () - Start;
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000000 / TEST_TIMED_READ_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Reports the space saved by the compression of a store holding the usual
+  secure boot, HII and boot option variables, and times the reads of their
+  data.
+
+  The reads of the variables stored as is copy their data. The reads of the
+  compressed variables decompress their data at runtime, when it is not in
+  the cache, and copy it from the cache at boot time.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               The data of every variable is read back,
+                                         and the compressed store is smaller.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    The data of a variable differs, or the
+                                         compression saves no space.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+UsualStoreSavings (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINTN    HiiSize[] = { 0x1C00, 0x800, 0x400, 0x1200 };
+  STATIC CHAR16         *HiiName[] = { L"Setup", L"SaSetup", L"MeSetup", L"CpuSetup" };
+  UNIT_TEST_STATUS      Status;
+  TEST_VARIABLE         *Test;
+  EFI_SIGNATURE_LIST    *List;
+  CHAR16                BootName[TEST_NAME_LENGTH];
+  UINTN                 Count;
+  UINTN                 Number;
+  UINTN                 Index;
+  UINTN                 DataSize;
+  UINTN                 PlainSize;
+  UINTN                 CompressedSize;
+  UINT64                CopyTime;
+  UINT64                MissTime;
+  UINT64                HitTime;
+
+  mPlainStore = CreateStore (&gEfiAuthenticatedVariableGuid);
+  UT_ASSERT_NOT_NULL (mPlainStore);
+  mStore = CreateStore (&gEdkiiCompressedVariableGuid);
+  UT_ASSERT_NOT_NULL (mStore);
+  UT_ASSERT_NOT_EFI_ERROR (VariableDecompressCacheRegisterStore (mStore, NULL, TEST_MAX_DATA_SIZE));
+
+  //
+  // PK, KEK and db hold one, two and three certificates.
+  //
+  UT_ASSERT_TRUE (AppendUsualVariable (0, EFI_PLATFORM_KEY_NAME, &gEfiGlobalVariableGuid, CreateCertificateList (0, 1)));
+  UT_ASSERT_TRUE (AppendUsualVariable (1, EFI_KEY_EXCHANGE_KEY_NAME, &gEfiGlobalVariableGuid, CreateCertificateList (1, 2)));
+  UT_ASSERT_TRUE (AppendUsualVariable (2, EFI_IMAGE_SECURITY_DATABASE, &gEfiImageSecurityDatabaseGuid, CreateCertificateList (2, 3)));
+
+  //
+  // dbx holds a list of 220 SHA-256 hashes.
+  //
+  List = (EFI_SIGNATURE_LIST *) mTestVariable[3].Data;
+  CopyGuid (&List->SignatureType, &gEfiCertSha256Guid);
+  List->SignatureHeaderSize = 0;
+  List->SignatureSize       = (UINT32) (sizeof (EFI_GUID) + sizeof (EFI_SHA256_HASH));
+  List->SignatureListSize   = (UINT32) (sizeof (EFI_SIGNATURE_LIST) + 220 * List->SignatureSize);
+  for (Index = 0; Index < 220; Index++) {
+    CopyGuid ((EFI_GUID *) ((UINT8 *) (List + 1) + Index * List->SignatureSize), &mTestGuid);
+    FillTestData ((UINT8 *) (List + 1) + Index * List->SignatureSize + sizeof (EFI_GUID), sizeof (EFI_SHA256_HASH), TestDataRandom);
+  }
+  UT_ASSERT_TRUE (AppendUsualVariable (3, EFI_IMAGE_SECURITY_DATABASE1, &gEfiImageSecurityDatabaseGuid, List->SignatureListSize));
+
+  //
+  // The HII varstores are mostly zero.
+  //
+  Number = 4;
+  for (Index = 0; Index < ARRAY_SIZE (HiiSize); Index++, Number++) {
+    FillTestData (mTestVariable[Number].Data, HiiSize[Index], TestDataSparse);
+    UT_ASSERT_TRUE (AppendUsualVariable (Number, HiiName[Index], &mTestSetupGuid, HiiSize[Index]));
+  }
+
+  //
+  // The boot options are below the threshold.
+  //
+  for (Index = 0; Index < 12; Index++, Number++) {
+    DataSize = 80 + (UINTN) UnitTestRandom () % 120;
+    FillTestData (mTestVariable[Number].Data, DataSize, TestDataText);
+    for (Count = 40; Count < DataSize; Count++) {
+      mTestVariable[Number].Data[Count] = (UINT8) (UnitTestRandom () % 8);
+    }
+    StrCpyS (BootName, TEST_NAME_LENGTH, L"Boot0000");
+    BootName[7] = L"0123456789ABCDEF"[Index];
+    UT_ASSERT_TRUE (AppendUsualVariable (Number, BootName, &gEfiGlobalVariableGuid, DataSize));
+  }
+
+  for (Index = 0; Index < Number; Index++) {
+    Test   = &mTestVariable[Index];
+    Status = CheckVariableData (Test->Variable, Test->Data, Test->DataSize);
+    if (Status != UNIT_TEST_PASSED) {
+      return Status;
+    }
+
+    CopyTime = TimeVariableReads (Test->PlainVariable, Test->DataSize, FALSE);
+    MissTime = 0;
+    HitTime  = 0;
+    if (IsCompressedVariable (mStore, Test->Variable)) {
+      VariableDecompressCacheInvalidate ();
+      mAtRuntime = TRUE;
+      MissTime   = TimeVariableReads (Test->Variable, Test->DataSize, FALSE);
+      mAtRuntime = FALSE;
+      HitTime    = TimeVariableReads (Test->Variable, Test->DataSize, TRUE);
+    }
+    UT_LOG_INFO (
+      "%-8s %5Lu bytes, stored %5Lu, copy %Lu ns, miss %Lu ns, hit %Lu ns\n",
+      Test->Name,
+      (UINT64) Test->DataSize,
+      (UINT64) DataSizeOfVariable (Test->Variable, TRUE),
+      CopyTime,
+      MissTime,
+      HitTime
+      );
+  }
+
+  PlainSize      = (UINTN) FindStoreEnd (mPlainStore) - (UINTN) GetStartPointer (mPlainStore);
+  CompressedSize = (UINTN) FindStoreEnd (mStore) - (UINTN) GetStartPointer (mStore);
+  UT_ASSERT_TRUE (CompressedSize < PlainSize);
+  UT_LOG_INFO (
+    "store bytes used %Lu, compressed %Lu (%Lu%% saved)\n",
+    (UINT64) PlainSize,
+    (UINT64) CompressedSize,
+    (UINT64) (100 - CompressedSize * 100 / PlainSize)
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the compressed
+  variables and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      CompressTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the variable compression Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&CompressTests, Framework, "Variable Compression Tests", "Variable.Compress", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for CompressTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (CompressTests, "Compressed data should read back",               "RoundTrip",  CompressedDataRoundTrip, SetupTestVariables, CleanupTestVariables, NULL);
+  AddTestCase (CompressTests, "Data sizes should be those of the services",     "Sizes",      CompressedDataSizes,     SetupTestVariables, CleanupTestVariables, NULL);
+  AddTestCase (CompressTests, "Corrupted streams should be reported",           "Corrupted",  CorruptedStreams,        SetupTestVariables, CleanupTestVariables, NULL);
+  AddTestCase (CompressTests, "Reclaim should convert a store of variables",    "Reclaim",    ReclaimConversion,       SetupTestVariables, CleanupTestVariables, NULL);
+  AddTestCase (CompressTests, "Space saved on a store of usual variables",      "Savings",    UsualStoreSavings,       SetupTestVariables, CleanupTestVariables, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,1022 @@
+/** @file
+  Unit tests of the hash index of the variable stores. The lookups through the
+  index are compared with the walk of the store in FindVariableEx () over
+  randomly updated stores, and both are timed on stores of growing size.
+
+  The enumeration of the variables resumed from the variable returned by the
+  last VariableServiceGetNextVariableInternal () call is also compared with
+  the enumeration which searches for that variable, and both are timed.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "../VariableParsing.h"
+#include "../VariableIndex.h"
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestRandomLib.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Hash Index Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// The random stores hold up to TEST_NAME_COUNT names under each of the
+// TEST_GUID_COUNT vendor GUIDs. Lookups also ask for names which are never set.
+//
+#define TEST_STORE_SIZE           SIZE_64KB
+#define TEST_NAME_COUNT           96
+#define TEST_LOOKUP_NAME_COUNT    (TEST_NAME_COUNT + 8)
+#define TEST_NAME_LENGTH          16
+#define TEST_GUID_COUNT           2
+#define TEST_OPERATION_COUNT      20000
+#define TEST_RECLAIM_INTERVAL     1000
+
+//
+// The timed lookups, in stores of 32 to 8192 variables.
+//
+#define TEST_TIMED_STORE_COUNT    5
+#define TEST_TIMED_LOOKUP_COUNT   10000
+
+//
+// The random enumeration steps, and the variables the HOB store holds to
+// override some of the NV variables.
+//
+#define TEST_ENUMERATION_STEP_COUNT  200000
+#define TEST_HOB_VARIABLE_COUNT      8
+
+//
+// The timed enumerations, in stores of 100, 1000 and 3000 variables.
+//
+#define TEST_TIMED_ENUMERATION_COUNT  10
+
+EFI_GUID  mTestGuid[TEST_GUID_COUNT] = {
+  { 0x4A3BC5D9, 0x13E2, 0x4C6F, { 0x8D, 0x5A, 0x27, 0x90, 0x61, 0xB3, 0xE4, 0x0C } },
+  { 0x4A3BC5D9, 0x13E2, 0x4C6F, { 0x8D, 0x5A, 0x27, 0x90, 0x61, 0xB3, 0xE4, 0x0D } }
+};
+
+CHAR16                  mTestName[TEST_LOOKUP_NAME_COUNT][TEST_NAME_LENGTH];
+VARIABLE_STORE_HEADER   *mStore;
+VARIABLE_STORE_HEADER   *mHobStore;
+UINTN                   mStoreEnd;
+UINT32                  mStoreGeneration;
+BOOLEAN                 mAuthFormat;
+BOOLEAN                 mAtRuntime;
+
+//
+// Offsets of the variable headers whose write is in progress.
+//
+UINTN                   mPendingOffset[VARIABLE_INDEX_PENDING_MAX - 1];
+UINTN                   mPendingCount;
+
+/**
+  Indicates whether the virtual address has been converted.
+
+  @retval TRUE        The emulated runtime phase has been entered.
+  @retval FALSE       The emulated runtime phase has not been entered.
+
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return mAtRuntime;
+}
+
+/**
+  Creates the name of a test variable, "Var" followed by the hexadecimal
+  digits of its number, lowest first.
+
+  Names which are prefixes of other names, like "Var1" and "Var10", are
+  created on purpose.
+
+  @param[out]  Name    Buffer of TEST_NAME_LENGTH characters for the name.
+  @param[in]   Number  Number of the variable.
+**/
+STATIC
+VOID
+CreateTestName (
+  OUT CHAR16  *Name,
+  IN  UINTN   Number
+  )
+{
+  UINTN   Length;
+
+  StrCpyS (Name, TEST_NAME_LENGTH, L"Var");
+  Length = 3;
+  do {
+    Name[Length++] = L"0123456789ABCDEF"[Number & 0xF];
+    Number >>= 4;
+  } while (Number != 0);
+  Name[Length] = L'\0';
+}
+
+/**
+  Creates an empty variable store.
+
+  @param[in]  Size        Size of the variable store in bytes.
+  @param[in]  AuthFormat  TRUE to create a store of authenticated variables.
+
+  @retval TRUE            The store is created.
+  @retval FALSE           No memory for the store.
+**/
+STATIC
+BOOLEAN
+CreateStore (
+  IN UINTN    Size,
+  IN BOOLEAN  AuthFormat
+  )
+{
+  mStore = AllocatePool (Size);
+  if (mStore == NULL) {
+    return FALSE;
+  }
+
+  SetMem (mStore, Size, 0xFF);
+  CopyGuid (&mStore->Signature, AuthFormat ? &gEfiAuthenticatedVariableGuid : &gEfiVariableGuid);
+  mStore->Size      = (UINT32) Size;
+  mStore->Format    = VARIABLE_STORE_FORMATTED;
+  mStore->State     = VARIABLE_STORE_HEALTHY;
+  mStore->Reserved  = 0;
+  mStore->Reserved1 = 0;
+
+  mStoreEnd        = 0;
+  mStoreGeneration = 0;
+  mAuthFormat      = AuthFormat;
+  mAtRuntime       = FALSE;
+  mPendingCount    = 0;
+  return TRUE;
+}
+
+/**
+  Appends a variable to the store.
+
+  @param[in]  Name        Name of the variable.
+  @param[in]  Guid        Vendor GUID of the variable.
+  @param[in]  Attributes  Attributes of the variable.
+  @param[in]  DataSize    Size of the variable data in bytes.
+  @param[in]  State       State of the new variable header.
+
+  @return Pointer to the new variable header, or NULL if the store is full.
+**/
+STATIC
+VARIABLE_HEADER *
+AppendVariable (
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid,
+  IN UINT32     Attributes,
+  IN UINTN      DataSize,
+  IN UINT8      State
+  )
+{
+  VARIABLE_HEADER   *Variable;
+  UINTN             NameSize;
+  UINTN             Size;
+
+  NameSize = StrSize (Name);
+  Size     = GetVariableHeaderSize (mAuthFormat) + NameSize + GET_PAD_SIZE (NameSize) + DataSize;
+  Variable = (VARIABLE_HEADER *) ((UINTN) GetStartPointer (mStore) + mStoreEnd);
+  if ((UINTN) Variable + Size > (UINTN) GetEndPointer (mStore)) {
+    return NULL;
+  }
+
+  ZeroMem (Variable, GetVariableHeaderSize (mAuthFormat));
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = State;
+  Variable->Attributes = Attributes;
+  SetNameSizeOfVariable (Variable, NameSize, mAuthFormat);
+  SetDataSizeOfVariable (Variable, DataSize, mAuthFormat);
+  CopyGuid (GetVendorGuidPtr (Variable, mAuthFormat), Guid);
+  CopyMem (GetVariableNamePtr (Variable, mAuthFormat), Name, NameSize);
+  SetMem (GetVariableDataPtr (Variable, mAuthFormat), DataSize, (UINT8) DataSize);
+
+  mStoreEnd = (UINTN) GetNextVariablePtr (Variable, mAuthFormat) - (UINTN) GetStartPointer (mStore);
+  return Variable;
+}
+
+/**
+  Rewrites the store with the variables which are ADDED or IN_DELETED_TRANSITION,
+  the way a reclaim does, and reports the rewrite to the index.
+
+  @param[in]  UseGeneration   TRUE to report the rewrite through the generation
+                              counter of the store, FALSE to invalidate the index.
+**/
+STATIC
+VOID
+ReclaimStore (
+  IN BOOLEAN  UseGeneration
+  )
+{
+  VARIABLE_HEADER   *Variable;
+  VARIABLE_HEADER   *Next;
+  UINT8             *Buffer;
+  UINTN             Offset;
+  UINTN             Size;
+
+  Buffer = AllocateZeroPool (mStoreEnd);
+  ASSERT (Buffer != NULL);
+
+  Offset   = 0;
+  Variable = GetStartPointer (mStore);
+  while (IsValidVariableHeader (Variable, GetEndPointer (mStore))) {
+    Next = GetNextVariablePtr (Variable, mAuthFormat);
+    if ((Variable->State == VAR_ADDED) ||
+        (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      Size = (UINTN) Next - (UINTN) Variable;
+      CopyMem (Buffer + Offset, Variable, Size);
+      Offset += Size;
+    }
+    Variable = Next;
+  }
+
+  SetMem (GetStartPointer (mStore), mStoreEnd, 0xFF);
+  CopyMem (GetStartPointer (mStore), Buffer, Offset);
+  mStoreEnd     = Offset;
+  mPendingCount = 0;
+  FreePool (Buffer);
+
+  ResetNextVariableCursor (mStore);
+
+  if (UseGeneration) {
+    mStoreGeneration++;
+  } else {
+    VariableIndexInvalidate (mStore);
+  }
+}
+
+/**
+  Finds a variable with the walk of the store in FindVariableEx (), with the
+  index of the store detached.
+
+  @param[in]   Name           Name of the variable.
+  @param[in]   Guid           Vendor GUID of the variable.
+  @param[in]   IgnoreRtCheck  Ignore the runtime access attribute at runtime.
+  @param[out]  PtrTrack       The variable found.
+
+  @return The status returned by FindVariableEx ().
+**/
+STATIC
+EFI_STATUS
+FindVariableByWalk (
+  IN  CHAR16                  *Name,
+  IN  EFI_GUID                *Guid,
+  IN  BOOLEAN                 IgnoreRtCheck,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_STORE_HEADER   *Store;
+  EFI_STATUS              Status;
+
+  ZeroMem (PtrTrack, sizeof (*PtrTrack));
+  PtrTrack->StartPtr = GetStartPointer (mStore);
+  PtrTrack->EndPtr   = GetEndPointer (mStore);
+
+  Store = mVariableIndex[VariableStoreTypeNv].Store;
+  mVariableIndex[VariableStoreTypeNv].Store = NULL;
+  Status = FindVariableEx (Name, Guid, IgnoreRtCheck, PtrTrack, mAuthFormat);
+  mVariableIndex[VariableStoreTypeNv].Store = Store;
+
+  return Status;
+}
+
+/**
+  Checks that the index finds the same variable as the walk of the store.
+
+  @param[in]  Name           Name of the variable.
+  @param[in]  Guid           Vendor GUID of the variable.
+  @param[in]  IgnoreRtCheck  Ignore the runtime access attribute at runtime.
+
+  @retval UNIT_TEST_PASSED  The index and the walk agree.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckLookup (
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid,
+  IN BOOLEAN    IgnoreRtCheck
+  )
+{
+  VARIABLE_POINTER_TRACK  Indexed;
+  VARIABLE_POINTER_TRACK  Walked;
+  EFI_STATUS              IndexStatus;
+  EFI_STATUS              WalkStatus;
+
+  ZeroMem (&Indexed, sizeof (Indexed));
+  Indexed.StartPtr = GetStartPointer (mStore);
+  Indexed.EndPtr   = GetEndPointer (mStore);
+  IndexStatus = VariableIndexFind (Name, Guid, IgnoreRtCheck, &Indexed, mAuthFormat);
+  WalkStatus  = FindVariableByWalk (Name, Guid, IgnoreRtCheck, &Walked);
+
+  UT_ASSERT_NOT_EQUAL (IndexStatus, EFI_UNSUPPORTED);
+  UT_ASSERT_STATUS_EQUAL (IndexStatus, WalkStatus);
+  UT_ASSERT_EQUAL ((UINTN) Indexed.CurrPtr, (UINTN) Walked.CurrPtr);
+  UT_ASSERT_EQUAL ((UINTN) Indexed.InDeletedTransitionPtr, (UINTN) Walked.InDeletedTransitionPtr);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Sets a variable the way UpdateVariable () does: the new variable is appended
+  and the old one goes through IN_DELETED_TRANSITION to DELETED. Some writes
+  are left in progress, or stop with the old variable in transition.
+
+  @param[in]  Name        Name of the variable.
+  @param[in]  Guid        Vendor GUID of the variable.
+
+  @retval TRUE            The variable is set.
+  @retval FALSE           The store is full.
+**/
+STATIC
+BOOLEAN
+SetTestVariable (
+  IN CHAR16     *Name,
+  IN EFI_GUID   *Guid
+  )
+{
+  VARIABLE_POINTER_TRACK  Old;
+  VARIABLE_HEADER         *Variable;
+  BOOLEAN                 Pending;
+
+  Pending = (BOOLEAN) (((UINTN) UnitTestRandom () % 8 == 0) && (mPendingCount < ARRAY_SIZE (mPendingOffset)));
+  Variable = AppendVariable (
+               Name,
+               Guid,
+               EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | (((UINTN) UnitTestRandom () % 2 == 0) ? EFI_VARIABLE_RUNTIME_ACCESS : 0),
+               (UINTN) UnitTestRandom () % 32,
+               Pending ? VAR_HEADER_VALID_ONLY : VAR_ADDED
+               );
+  if (Variable == NULL) {
+    return FALSE;
+  }
+
+  if (Pending) {
+    mPendingOffset[mPendingCount++] = (UINTN) Variable - (UINTN) GetStartPointer (mStore);
+    return TRUE;
+  }
+
+  if (!EFI_ERROR (FindVariableByWalk (Name, Guid, TRUE, &Old)) && (Old.CurrPtr != Variable)) {
+    Old.CurrPtr->State &= VAR_IN_DELETED_TRANSITION;
+    if ((UINTN) UnitTestRandom () % 8 != 0) {
+      Old.CurrPtr->State &= VAR_DELETED;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Allocates the variable store and registers it with the index.
+
+  @param[in]  Context  Pointer to a BOOLEAN, TRUE for a store of authenticated
+                       variables.
+
+  @retval UNIT_TEST_PASSED                 The store is ready.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  No memory for the store.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Number;
+
+  for (Number = 0; Number < TEST_LOOKUP_NAME_COUNT; Number++) {
+    CreateTestName (mTestName[Number], Number);
+  }
+
+  if (!CreateStore (TEST_STORE_SIZE, *(BOOLEAN *) Context)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  if (EFI_ERROR (VariableIndexRegisterStore (VariableStoreTypeNv, mStore, &mStoreGeneration))) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  UnitTestRandomSeed (0x1DE5);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the variable store and the index.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupStore (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_INDEX  *Index;
+
+  Index = &mVariableIndex[VariableStoreTypeNv];
+  if (Index->Entries != NULL) {
+    FreePool (Index->Entries);
+    FreePool (Index->Buckets);
+  }
+  ZeroMem (Index, sizeof (*Index));
+
+  if (mStore != NULL) {
+    FreePool (mStore);
+    mStore = NULL;
+  }
+
+  if (mHobStore != NULL) {
+    FreePool (mHobStore);
+    mHobStore = NULL;
+  }
+
+  ResetNextVariableCursor (NULL);
+}
+
+/**
+  Random sets, deletes, completions of pending writes and reclaims of the
+  store, at boot time and at runtime, must not change the variable found by
+  any lookup.
+
+  @param[in]  Context  Pointer to a BOOLEAN, TRUE for a store of authenticated
+                       variables.
+
+  @retval UNIT_TEST_PASSED  The index and the walk always agree.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+IndexLookupMatchesWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS        Status;
+  VARIABLE_POINTER_TRACK  Variable;
+  UINTN                   Operation;
+  UINTN                   Lookup;
+  UINTN                   Pending;
+  CHAR16                  *Name;
+  EFI_GUID                *Guid;
+
+  for (Operation = 0; Operation < TEST_OPERATION_COUNT; Operation++) {
+    Name = mTestName[(UINTN) UnitTestRandom () % TEST_NAME_COUNT];
+    Guid = &mTestGuid[(UINTN) UnitTestRandom () % TEST_GUID_COUNT];
+
+    switch ((UINTN) UnitTestRandom () % 8) {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+      if (!SetTestVariable (Name, Guid)) {
+        ReclaimStore ((BOOLEAN) (Operation % 2 == 0));
+      }
+      break;
+
+    case 4:
+      if (!EFI_ERROR (FindVariableByWalk (Name, Guid, TRUE, &Variable))) {
+        Variable.CurrPtr->State &= VAR_DELETED;
+      }
+      break;
+
+    case 5:
+      //
+      // Complete a pending write, or abandon it.
+      //
+      if (mPendingCount != 0) {
+        Pending  = (UINTN) UnitTestRandom () % mPendingCount;
+        Variable.CurrPtr = (VARIABLE_HEADER *) ((UINTN) GetStartPointer (mStore) + mPendingOffset[Pending]);
+        Variable.CurrPtr->State &= ((UINTN) UnitTestRandom () % 4 == 0) ? VAR_DELETED : VAR_ADDED;
+        mPendingOffset[Pending] = mPendingOffset[--mPendingCount];
+      }
+      break;
+
+    case 6:
+      if ((UINTN) UnitTestRandom () % 16 == 0) {
+        mAtRuntime = (BOOLEAN) !mAtRuntime;
+      }
+      break;
+
+    default:
+      if (Operation % TEST_RECLAIM_INTERVAL == 0) {
+        ReclaimStore ((BOOLEAN) ((UINTN) UnitTestRandom () % 2 == 0));
+      }
+      break;
+    }
+
+    for (Lookup = 0; Lookup < 4; Lookup++) {
+      Status = CheckLookup (
+                 mTestName[(UINTN) UnitTestRandom () % TEST_LOOKUP_NAME_COUNT],
+                 &mTestGuid[(UINTN) UnitTestRandom () % TEST_GUID_COUNT],
+                 (BOOLEAN) ((UINTN) UnitTestRandom () % 2 == 0)
+                 );
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Returns the average time of the lookups of random variables of the store.
+
+  @param[in]  Name           Names of the variables of the store.
+  @param[in]  VariableCount  Number of variables in the store.
+  @param[in]  UseIndex       TRUE to look up through the index, FALSE to walk
+                             the store.
+
+  @return The average time of a lookup in nanoseconds.
+**/
+STATIC
+UINT64
+TimeLookups (
+  IN CHAR16   (*Name)[TEST_NAME_LENGTH],
+  IN UINTN    VariableCount,
+  IN BOOLEAN  UseIndex
+  )
+{
+  VARIABLE_POINTER_TRACK  Variable;
+  UINTN                   Lookup;
+  UINTN                   Number;
+  clock_t                 Start;
+  clock_t                 Elapsed;
+
+  Start = clock ();
+  for (Lookup = 0; Lookup < TEST_TIMED_LOOKUP_COUNT; Lookup++) {
+    Number = (UINTN) UnitTestRandom () % VariableCount;
+    if (UseIndex) {
+      Variable.StartPtr = GetStartPointer (mStore);
+      Variable.EndPtr   = GetEndPointer (mStore);
+      VariableIndexFind (Name[Number], &mTestGuid[0], FALSE, &Variable, mAuthFormat);
+    } else {
+      FindVariableByWalk (Name[Number], &mTestGuid[0], FALSE, &Variable);
+    }
+  }
+  Elapsed = clock () - Start;
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000000 / TEST_TIMED_LOOKUP_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Times the lookups through the index and through the walk in stores of 32 to
+  8192 variables, after checking that both find every variable.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  Both lookups find every variable.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+IndexLookupLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+  CHAR16            (*Name)[TEST_NAME_LENGTH];
+  UINTN             StoreNumber;
+  UINTN             VariableCount;
+  UINTN             Number;
+  UINT64            WalkTime;
+  UINT64            IndexTime;
+
+  for (StoreNumber = 0; StoreNumber < TEST_TIMED_STORE_COUNT; StoreNumber++) {
+    VariableCount = 32 << (2 * StoreNumber);
+    Name = AllocatePool (VariableCount * sizeof (*Name));
+    UT_ASSERT_NOT_NULL (Name);
+    UT_ASSERT_TRUE (CreateStore (VariableCount * 64, FALSE));
+    UT_ASSERT_NOT_EFI_ERROR (VariableIndexRegisterStore (VariableStoreTypeNv, mStore, NULL));
+
+    for (Number = 0; Number < VariableCount; Number++) {
+      CreateTestName (Name[Number], Number);
+      UT_ASSERT_NOT_NULL (
+        AppendVariable (
+          Name[Number],
+          &mTestGuid[0],
+          EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+          8,
+          VAR_ADDED
+          )
+        );
+    }
+
+    for (Number = 0; Number < VariableCount; Number++) {
+      Status = CheckLookup (Name[Number], &mTestGuid[0], FALSE);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+
+    WalkTime  = TimeLookups (Name, VariableCount, FALSE);
+    IndexTime = TimeLookups (Name, VariableCount, TRUE);
+    UT_LOG_INFO ("%5Lu variables: walk %Lu ns, index %Lu ns\n", (UINT64) VariableCount, WalkTime, IndexTime);
+
+    FreePool (Name);
+    CleanupStore (NULL);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Allocates the NV variable store and registers it with the index, after a HOB
+  variable store holding some of the variables the NV store may hold.
+
+  @param[in]  Context  Pointer to a BOOLEAN, TRUE for stores of authenticated
+                       variables.
+
+  @retval UNIT_TEST_PASSED                 The stores are ready.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  No memory for the stores.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupStoresWithHob (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Number;
+
+  for (Number = 0; Number < TEST_LOOKUP_NAME_COUNT; Number++) {
+    CreateTestName (mTestName[Number], Number);
+  }
+
+  if (!CreateStore (SIZE_4KB, *(BOOLEAN *) Context)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  for (Number = 0; Number < TEST_HOB_VARIABLE_COUNT; Number++) {
+    AppendVariable (
+      mTestName[Number * (TEST_NAME_COUNT / TEST_HOB_VARIABLE_COUNT)],
+      &mTestGuid[Number % TEST_GUID_COUNT],
+      EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+      4,
+      VAR_ADDED
+      );
+  }
+  mHobStore = mStore;
+  mStore    = NULL;
+
+  return SetupStore (Context);
+}
+
+/**
+  Returns the variable after the given one, the way GetNextVariableName ()
+  does.
+
+  @param[in]   StoreList   The variable stores, indexed by VARIABLE_STORE_TYPE.
+  @param[in]   Name        Name of the previous variable, empty for the first one.
+  @param[in]   Guid        Vendor GUID of the previous variable.
+  @param[in]   UseCursor   FALSE to forget the variable returned by the last call
+                           first, so that the previous variable is searched for.
+  @param[out]  Variable    The next variable.
+
+  @return The status returned by VariableServiceGetNextVariableInternal ().
+**/
+STATIC
+EFI_STATUS
+GetNextTestVariable (
+  IN  VARIABLE_STORE_HEADER   **StoreList,
+  IN  CHAR16                  *Name,
+  IN  EFI_GUID                *Guid,
+  IN  BOOLEAN                 UseCursor,
+  OUT VARIABLE_HEADER         **Variable
+  )
+{
+  if (!UseCursor) {
+    ResetNextVariableCursor (NULL);
+  }
+
+  *Variable = NULL;
+  return VariableServiceGetNextVariableInternal (Name, Guid, StoreList, Variable, mAuthFormat);
+}
+
+/**
+  Copies the name and the vendor GUID of a variable the way a caller of
+  GetNextVariableName () receives them.
+
+  @param[in]   Variable    The variable, NULL to restart the enumeration.
+  @param[out]  Name        Buffer of TEST_NAME_LENGTH characters for the name.
+  @param[out]  Guid        The vendor GUID of the variable.
+**/
+STATIC
+VOID
+CopyTestVariableName (
+  IN  VARIABLE_HEADER         *Variable,
+  OUT CHAR16                  *Name,
+  OUT EFI_GUID                *Guid
+  )
+{
+  if (Variable == NULL) {
+    Name[0] = L'\0';
+    ZeroMem (Guid, sizeof (*Guid));
+    return;
+  }
+
+  CopyMem (Name, GetVariableNamePtr (Variable, mAuthFormat), NameSizeOfVariable (Variable, mAuthFormat));
+  CopyGuid (Guid, GetVendorGuidPtr (Variable, mAuthFormat));
+}
+
+/**
+  An enumeration of the variables interleaved with random sets, deletes,
+  completions of pending writes and reclaims of the store, at boot time and
+  at runtime, must return the same variable at every step whether it resumes
+  from the variable returned by the last call or searches for it.
+
+  @param[in]  Context  Pointer to a BOOLEAN, TRUE for stores of authenticated
+                       variables.
+
+  @retval UNIT_TEST_PASSED  Both enumerations always agree.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NextVariableCursorMatchesSearch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_STORE_HEADER   *StoreList[VariableStoreTypeMax];
+  VARIABLE_POINTER_TRACK  Variable;
+  VARIABLE_HEADER         *Added;
+  VARIABLE_HEADER         *Resumed;
+  VARIABLE_HEADER         *Searched;
+  EFI_STATUS              ResumeStatus;
+  EFI_STATUS              SearchStatus;
+  CHAR16                  Name[TEST_NAME_LENGTH];
+  EFI_GUID                Guid;
+  UINTN                   Step;
+  UINTN                   Pending;
+  UINTN                   Enumerations;
+
+  StoreList[VariableStoreTypeVolatile] = NULL;
+  StoreList[VariableStoreTypeHob]      = mHobStore;
+  StoreList[VariableStoreTypeNv]       = mStore;
+
+  Enumerations = 0;
+  CopyTestVariableName (NULL, Name, &Guid);
+  for (Step = 0; Step < TEST_ENUMERATION_STEP_COUNT; Step++) {
+    switch ((UINTN) UnitTestRandom () % 16) {
+    case 0:
+    case 1:
+      if (!SetTestVariable (mTestName[(UINTN) UnitTestRandom () % TEST_NAME_COUNT], &mTestGuid[(UINTN) UnitTestRandom () % TEST_GUID_COUNT])) {
+        ReclaimStore ((BOOLEAN) (Step % 2 == 0));
+      }
+      break;
+
+    case 2:
+      if (!EFI_ERROR (FindVariableByWalk (mTestName[(UINTN) UnitTestRandom () % TEST_NAME_COUNT], &mTestGuid[(UINTN) UnitTestRandom () % TEST_GUID_COUNT], TRUE, &Variable))) {
+        Variable.CurrPtr->State &= VAR_DELETED;
+      }
+      break;
+
+    case 3:
+      //
+      // Complete a pending write the way UpdateVariable () does, deleting the
+      // old variable, or abandon it. Two ADDED variables with the same name
+      // would make any enumeration loop.
+      //
+      if (mPendingCount != 0) {
+        Pending = (UINTN) UnitTestRandom () % mPendingCount;
+        Added   = (VARIABLE_HEADER *) ((UINTN) GetStartPointer (mStore) + mPendingOffset[Pending]);
+        mPendingOffset[Pending] = mPendingOffset[--mPendingCount];
+        if ((UINTN) UnitTestRandom () % 4 == 0) {
+          Added->State &= VAR_DELETED;
+        } else {
+          if (!EFI_ERROR (FindVariableByWalk (GetVariableNamePtr (Added, mAuthFormat), GetVendorGuidPtr (Added, mAuthFormat), TRUE, &Variable))) {
+            Variable.CurrPtr->State &= VAR_DELETED;
+          }
+          Added->State &= VAR_ADDED;
+        }
+      }
+      break;
+
+    case 4:
+      if ((UINTN) UnitTestRandom () % 64 == 0) {
+        mAtRuntime = (BOOLEAN) !mAtRuntime;
+      }
+      break;
+
+    case 5:
+      if ((UINTN) UnitTestRandom () % 64 == 0) {
+        ReclaimStore ((BOOLEAN) ((UINTN) UnitTestRandom () % 2 == 0));
+      }
+      break;
+
+    default:
+      break;
+    }
+
+    //
+    // The search runs last, so that the next step resumes from the variable
+    // it returned, which must be the one returned from the cursor.
+    //
+    ResumeStatus = GetNextTestVariable (StoreList, Name, &Guid, TRUE, &Resumed);
+    SearchStatus = GetNextTestVariable (StoreList, Name, &Guid, FALSE, &Searched);
+    UT_ASSERT_STATUS_EQUAL (ResumeStatus, SearchStatus);
+    UT_ASSERT_EQUAL ((UINTN) Resumed, (UINTN) Searched);
+
+    if (EFI_ERROR (SearchStatus)) {
+      Searched = NULL;
+      Enumerations++;
+    }
+    CopyTestVariableName (Searched, Name, &Guid);
+  }
+
+  UT_LOG_INFO ("%Lu enumerations\n", (UINT64) Enumerations);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Returns the average time of the enumeration of all the variables.
+
+  @param[in]  StoreList   The variable stores, indexed by VARIABLE_STORE_TYPE.
+  @param[in]  UseCursor   TRUE to resume from the variable returned by the last
+                          call, FALSE to search for it.
+  @param[out] Count       The number of variables enumerated.
+
+  @return The average time of an enumeration in microseconds.
+**/
+STATIC
+UINT64
+TimeEnumerations (
+  IN  VARIABLE_STORE_HEADER   **StoreList,
+  IN  BOOLEAN                 UseCursor,
+  OUT UINTN                   *Count
+  )
+{
+  VARIABLE_HEADER   *Variable;
+  CHAR16            Name[TEST_NAME_LENGTH];
+  EFI_GUID          Guid;
+  UINTN             Enumeration;
+  clock_t           Start;
+  clock_t           Elapsed;
+
+  Start = clock ();
+  for (Enumeration = 0; Enumeration < TEST_TIMED_ENUMERATION_COUNT; Enumeration++) {
+    *Count = 0;
+    CopyTestVariableName (NULL, Name, &Guid);
+    while (!EFI_ERROR (GetNextTestVariable (StoreList, Name, &Guid, UseCursor, &Variable))) {
+      CopyTestVariableName (Variable, Name, &Guid);
+      (*Count)++;
+    }
+  }
+  Elapsed = clock () - Start;
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000 / TEST_TIMED_ENUMERATION_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Times the enumeration of all the variables of NV stores of 100, 1000 and
+  3000 variables with no hash index, resuming from the variable returned by
+  the last call and searching for it.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  Both enumerations return every variable.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+NextVariableLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST UINTN      VariableCount[] = { 100, 1000, 3000 };
+  VARIABLE_STORE_HEADER   *StoreList[VariableStoreTypeMax];
+  CHAR16                  Name[TEST_NAME_LENGTH];
+  UINTN                   StoreNumber;
+  UINTN                   Number;
+  UINTN                   SearchCount;
+  UINTN                   ResumeCount;
+  UINT64                  SearchTime;
+  UINT64                  ResumeTime;
+
+  for (StoreNumber = 0; StoreNumber < ARRAY_SIZE (VariableCount); StoreNumber++) {
+    UT_ASSERT_TRUE (CreateStore (VariableCount[StoreNumber] * 64, FALSE));
+    for (Number = 0; Number < VariableCount[StoreNumber]; Number++) {
+      CreateTestName (Name, Number);
+      UT_ASSERT_NOT_NULL (
+        AppendVariable (
+          Name,
+          &mTestGuid[Number % TEST_GUID_COUNT],
+          EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+          8,
+          VAR_ADDED
+          )
+        );
+    }
+
+    StoreList[VariableStoreTypeVolatile] = NULL;
+    StoreList[VariableStoreTypeHob]      = NULL;
+    StoreList[VariableStoreTypeNv]       = mStore;
+
+    SearchTime = TimeEnumerations (StoreList, FALSE, &SearchCount);
+    ResumeTime = TimeEnumerations (StoreList, TRUE, &ResumeCount);
+    UT_ASSERT_EQUAL (SearchCount, VariableCount[StoreNumber]);
+    UT_ASSERT_EQUAL (ResumeCount, VariableCount[StoreNumber]);
+    UT_LOG_INFO ("%5Lu variables: search %Lu us, cursor %Lu us\n", (UINT64) VariableCount[StoreNumber], SearchTime, ResumeTime);
+
+    CleanupStore (NULL);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the variable
+  hash index and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+  UNIT_TEST_SUITE_HANDLE      NextTests;
+  STATIC BOOLEAN              AuthFormat    = TRUE;
+  STATIC BOOLEAN              NonAuthFormat = FALSE;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the variable hash index Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "Variable Hash Index Tests", "Variable.Index", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (IndexTests, "Index should match the walk of a store",               "MatchWalk",     IndexLookupMatchesWalk, SetupStore, CleanupStore, &NonAuthFormat);
+  AddTestCase (IndexTests, "Index should match the walk of an authenticated store", "MatchWalkAuth", IndexLookupMatchesWalk, SetupStore, CleanupStore, &AuthFormat);
+  AddTestCase (IndexTests, "Index lookup latency against store occupancy",          "Latency",       IndexLookupLatency,     NULL,       NULL,         NULL);
+
+  //
+  // Populate the GetNextVariableName Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&NextTests, Framework, "GetNextVariableName Cursor Tests", "Variable.NextCursor", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for NextTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (NextTests, "Cursor should match the search of a store",               "MatchSearch",     NextVariableCursorMatchesSearch, SetupStoresWithHob, CleanupStore, &NonAuthFormat);
+  AddTestCase (NextTests, "Cursor should match the search of an authenticated store", "MatchSearchAuth", NextVariableCursorMatchesSearch, SetupStoresWithHob, CleanupStore, &AuthFormat);
+  AddTestCase (NextTests, "Enumeration latency against store occupancy",              "Latency",         NextVariableLatency,             NULL,               NULL,         NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
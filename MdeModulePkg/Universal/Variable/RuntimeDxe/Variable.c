@@ -28,6 +28,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "VariableNonVolatile.h"
 #include "VariableParsing.h"
 #include "VariableRuntimeCache.h"
+#include "VariableIndex.h"
+#include "VariableCompress.h"
 
 VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
 
@@ -42,6 +44,12 @@ VARIABLE_STORE_HEADER  *mNvVariableCache      = NULL;
 ///
 EFI_FIRMWARE_VOLUME_HEADER *mNvFvHeaderCache  = NULL;
 
+///
+/// Index of the non-volatile variable store built by the PEI variable driver,
+/// NULL if the store was parsed at init.
+///
+VARIABLE_STORE_INDEX   *mNvVariableStoreIndex = NULL;
+
 ///
 /// The memory entry used for variable statistics data.
 ///
@@ -490,6 +498,41 @@ InitializeVariableQuota (
   CalculateCommonUserVariableTotalSize ();
 }
 
+/**
+  Gets the time elapsed since the given performance counter value.
+
+  @param[in] StartTicks   Performance counter value at the start.
+
+  @return The elapsed time in microseconds.
+
+**/
+STATIC
+UINT64
+GetElapsedMicroseconds (
+  IN UINT64   StartTicks
+  )
+{
+  UINT64  EndTicks;
+  UINT64  CounterStart;
+  UINT64  CounterEnd;
+
+  EndTicks = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterEnd >= CounterStart) {
+    //
+    // The counter counts up.
+    //
+    EndTicks = (EndTicks >= StartTicks) ? EndTicks - StartTicks : (CounterEnd - StartTicks) + (EndTicks - CounterStart);
+  } else {
+    //
+    // The counter counts down.
+    //
+    EndTicks = (StartTicks >= EndTicks) ? StartTicks - EndTicks : (StartTicks - CounterEnd) + (CounterStart - EndTicks);
+  }
+
+  return DivU64x32 (GetTimeInNanoSecond (EndTicks), 1000);
+}
+
 /**
 
   Variable store garbage collection and reclaim operation.
@@ -538,6 +581,17 @@ Reclaim (
   VARIABLE_HEADER       *UpdatingVariable;
   VARIABLE_HEADER       *UpdatingInDeletedTransition;
   BOOLEAN               AuthFormat;
+  UINT64                StartTicks;
+  UINTN                 BlockCount;
+  BOOLEAN               Compress;
+
+  //
+  // The timer may not be usable at runtime, where the duration is not reported.
+  //
+  StartTicks = 0;
+  if (!AtRuntime ()) {
+    StartTicks = GetPerformanceCounter ();
+  }
 
   AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
   UpdatingVariable = NULL;
@@ -606,6 +660,18 @@ Reclaim (
   CopyMem (ValidBuffer, VariableStoreHeader, sizeof (VARIABLE_STORE_HEADER));
   CurrPtr = (UINT8 *) GetStartPointer ((VARIABLE_STORE_HEADER *) ValidBuffer);
 
+  //
+  // With variable compression enabled, convert the NV variable store to the
+  // compressed variable store format, and compress the large variables which
+  // are not compressed yet while copying them.
+  //
+  Compress = FALSE;
+  if (!IsVolatile && !mVariableModuleGlobal->VariableGlobal.EmuNvMode && AuthFormat &&
+      (PcdGet32 (PcdVariableCompressThreshold) != 0)) {
+    CopyGuid (&((VARIABLE_STORE_HEADER *) ValidBuffer)->Signature, &gEdkiiCompressedVariableGuid);
+    Compress = TRUE;
+  }
+
   //
   // Reinstall all ADDED variables as long as they are not identical to Updating Variable.
   //
@@ -615,6 +681,9 @@ Reclaim (
     if (Variable != UpdatingVariable && Variable->State == VAR_ADDED) {
       VariableSize = (UINTN) NextVariable - (UINTN) Variable;
       CopyMem (CurrPtr, (UINT8 *) Variable, VariableSize);
+      if (Compress) {
+        VariableSize = CompressVariable (VariableStoreHeader, (VARIABLE_HEADER *) CurrPtr, AuthFormat);
+      }
       CurrPtr += VariableSize;
       if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
         HwErrVariableTotalSize += VariableSize;
@@ -667,6 +736,9 @@ Reclaim (
         VariableSize = (UINTN) NextVariable - (UINTN) Variable;
         CopyMem (CurrPtr, (UINT8 *) Variable, VariableSize);
         ((VARIABLE_HEADER *) CurrPtr)->State = VAR_ADDED;
+        if (Compress) {
+          VariableSize = CompressVariable (VariableStoreHeader, (VARIABLE_HEADER *) CurrPtr, AuthFormat);
+        }
         CurrPtr += VariableSize;
         if ((!IsVolatile) && ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
           HwErrVariableTotalSize += VariableSize;
@@ -744,13 +816,22 @@ Reclaim (
     //
     Status = FtwVariableSpace (
               VariableBase,
-              (VARIABLE_STORE_HEADER *) ValidBuffer
+              (VARIABLE_STORE_HEADER *) ValidBuffer,
+              &BlockCount
               );
     if (!EFI_ERROR (Status)) {
       *LastVariableOffset = (UINTN) CurrPtr - (UINTN) ValidBuffer;
       mVariableModuleGlobal->HwErrVariableTotalSize = HwErrVariableTotalSize;
       mVariableModuleGlobal->CommonVariableTotalSize = CommonVariableTotalSize;
       mVariableModuleGlobal->CommonUserVariableTotalSize = CommonUserVariableTotalSize;
+      if (!AtRuntime ()) {
+        DEBUG ((
+          DEBUG_INFO,
+          "Variable: Reclaim rewrote %Lu flash block(s) in %Lu us\n",
+          (UINT64) BlockCount,
+          GetElapsedMicroseconds (StartTicks)
+          ));
+      }
     } else {
       mVariableModuleGlobal->HwErrVariableTotalSize = 0;
       mVariableModuleGlobal->CommonVariableTotalSize = 0;
@@ -777,6 +858,8 @@ Reclaim (
 Done:
   DoneStatus = EFI_SUCCESS;
   if (IsVolatile || mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
+    VariableIndexInvalidate ((VARIABLE_STORE_HEADER *) (UINTN) VariableBase);
+    ResetNextVariableCursor ((VARIABLE_STORE_HEADER *) (UINTN) VariableBase);
     DoneStatus = SynchronizeRuntimeVariableCache (
                    &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache,
                    0,
@@ -789,6 +872,9 @@ Done:
     // For NV variable reclaim, we use mNvVariableCache as the buffer, so copy the data back.
     //
     CopyMem (mNvVariableCache, (UINT8 *) (UINTN) VariableBase, VariableStoreHeader->Size);
+    VariableIndexInvalidate (mNvVariableCache);
+    VariableDecompressCacheInvalidate ();
+    ResetNextVariableCursor (mNvVariableCache);
     DoneStatus = SynchronizeRuntimeVariableCache (
                    &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
                    0,
@@ -797,6 +883,13 @@ Done:
     ASSERT_EFI_ERROR (DoneStatus);
   }
 
+  //
+  // Tell the owner of the runtime caches to rebuild their indexes as well.
+  //
+  if (mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.StoreGeneration != NULL) {
+    (*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.StoreGeneration))++;
+  }
+
   if (!EFI_ERROR (Status) && EFI_ERROR (DoneStatus)) {
     Status = DoneStatus;
   }
@@ -1460,8 +1553,8 @@ AutoUpdateLangVariable (
       // Update Lang
       //
       VariableName = EFI_PLATFORM_LANG_VARIABLE_NAME;
-      Data         = GetVariableDataPtr (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
-      DataSize     = DataSizeOfVariable (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+      Status       = GetVariableData (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat, &Data);
+      DataSize     = GetVariableDataSize (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
     } else {
       Status = FindVariable (EFI_LANG_VARIABLE_NAME, &gEfiGlobalVariableGuid, &Variable, &mVariableModuleGlobal->VariableGlobal, FALSE);
       if (!EFI_ERROR (Status)) {
@@ -1469,8 +1562,8 @@ AutoUpdateLangVariable (
         // Update PlatformLang
         //
         VariableName = EFI_LANG_VARIABLE_NAME;
-        Data         = GetVariableDataPtr (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
-        DataSize     = DataSizeOfVariable (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+        Status       = GetVariableData (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat, &Data);
+        DataSize     = GetVariableDataSize (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
       } else {
         //
         // Neither PlatformLang nor Lang is set, directly return
@@ -1478,6 +1571,9 @@ AutoUpdateLangVariable (
         return EFI_SUCCESS;
       }
     }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
   }
 
   Status = EFI_SUCCESS;
@@ -1646,6 +1742,8 @@ UpdateVariable (
   UINTN                               MergedBufSize;
   BOOLEAN                             DataReady;
   UINTN                               DataOffset;
+  VOID                                *CurrentData;
+  UINTN                               CompressedSize;
   BOOLEAN                             IsCommonVariable;
   BOOLEAN                             IsCommonUserVariable;
   AUTHENTICATED_VARIABLE_HEADER       *AuthVariable;
@@ -1793,6 +1891,7 @@ UpdateVariable (
         if (!EFI_ERROR (Status)) {
           if (!Variable->Volatile) {
             CacheVariable->InDeletedTransitionPtr->State = State;
+            VariableDecompressCacheRemove (CacheVariable->InDeletedTransitionPtr);
           }
         } else {
           goto Done;
@@ -1815,6 +1914,7 @@ UpdateVariable (
         UpdateVariableInfo (VariableName, VendorGuid, Variable->Volatile, FALSE, FALSE, TRUE, FALSE, &gVariableInfo);
         if (!Variable->Volatile) {
           CacheVariable->CurrPtr->State = State;
+          VariableDecompressCacheRemove (CacheVariable->CurrPtr);
           FlushHobVariableToFlash (VariableName, VendorGuid);
         }
       }
@@ -1824,8 +1924,9 @@ UpdateVariable (
     // If the variable is marked valid, and the same data has been passed in,
     // then return to the caller immediately.
     //
-    if (DataSizeOfVariable (CacheVariable->CurrPtr, AuthFormat) == DataSize &&
-        (CompareMem (Data, GetVariableDataPtr (CacheVariable->CurrPtr, AuthFormat), DataSize) == 0) &&
+    if (GetVariableDataSize (CacheVariable->CurrPtr, AuthFormat) == DataSize &&
+        !EFI_ERROR (GetVariableData (CacheVariable->CurrPtr, AuthFormat, &CurrentData)) &&
+        (CompareMem (Data, CurrentData, DataSize) == 0) &&
         ((Attributes & EFI_VARIABLE_APPEND_WRITE) == 0) &&
         (TimeStamp == NULL)) {
       //
@@ -1847,11 +1948,10 @@ UpdateVariable (
         //
         DataOffset = GetVariableDataOffset (CacheVariable->CurrPtr, AuthFormat);
         BufferForMerge = (UINT8 *) ((UINTN) NextVariable + DataOffset);
-        CopyMem (
-          BufferForMerge,
-          (UINT8 *) ((UINTN) CacheVariable->CurrPtr + DataOffset),
-          DataSizeOfVariable (CacheVariable->CurrPtr, AuthFormat)
-          );
+        Status = ReadVariableData (CacheVariable->CurrPtr, AuthFormat, BufferForMerge);
+        if (EFI_ERROR (Status)) {
+          goto Done;
+        }
 
         //
         // Set Max Auth/Non-Volatile/Volatile Variable Data Size as default MaxDataSize.
@@ -1872,7 +1972,7 @@ UpdateVariable (
           MaxDataSize = PcdGet32 (PcdMaxHardwareErrorVariableSize) - DataOffset;
         }
 
-        if (DataSizeOfVariable (CacheVariable->CurrPtr, AuthFormat) + DataSize > MaxDataSize) {
+        if (GetVariableDataSize (CacheVariable->CurrPtr, AuthFormat) + DataSize > MaxDataSize) {
           //
           // Existing data size + new data size exceed maximum variable size limitation.
           //
@@ -1881,12 +1981,12 @@ UpdateVariable (
         }
         CopyMem (
           (UINT8*) (
-            (UINTN) BufferForMerge + DataSizeOfVariable (CacheVariable->CurrPtr, AuthFormat)
+            (UINTN) BufferForMerge + GetVariableDataSize (CacheVariable->CurrPtr, AuthFormat)
             ),
           Data,
           DataSize
           );
-        MergedBufSize = DataSizeOfVariable (CacheVariable->CurrPtr, AuthFormat) +
+        MergedBufSize = GetVariableDataSize (CacheVariable->CurrPtr, AuthFormat) +
                           DataSize;
 
         //
@@ -2022,6 +2122,20 @@ UpdateVariable (
   // service can get actual size in GetVariable.
   //
   SetNameSizeOfVariable (NextVariable, VarNameSize, AuthFormat);
+
+  //
+  // Large NV variables are stored compressed in a store which allows it, from
+  // here DataSize is the size of the data in the store.
+  //
+  if (((Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) &&
+      !mVariableModuleGlobal->VariableGlobal.EmuNvMode &&
+      IsCompressedVariableStore (mNvVariableCache)) {
+    CompressedSize = CompressVariableData (Attributes, (UINT8 *) ((UINTN) NextVariable + VarDataOffset), DataSize);
+    if (CompressedSize < DataSize) {
+      NextVariable->Reserved = VARIABLE_DATA_COMPRESSED;
+      DataSize = CompressedSize;
+    }
+  }
   SetDataSizeOfVariable (NextVariable, DataSize, AuthFormat);
 
   //
@@ -2272,6 +2386,7 @@ UpdateVariable (
       if (!EFI_ERROR (Status)) {
         if (!Variable->Volatile) {
           CacheVariable->InDeletedTransitionPtr->State = State;
+          VariableDecompressCacheRemove (CacheVariable->InDeletedTransitionPtr);
         }
       } else {
         goto Done;
@@ -2292,6 +2407,7 @@ UpdateVariable (
              );
     if (!EFI_ERROR (Status) && !Variable->Volatile) {
       CacheVariable->CurrPtr->State = State;
+      VariableDecompressCacheRemove (CacheVariable->CurrPtr);
     }
   }
 
@@ -2377,7 +2493,7 @@ VariableServiceGetVariable (
   //
   // Get data size
   //
-  VarDataSize = DataSizeOfVariable (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+  VarDataSize = GetVariableDataSize (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
   ASSERT (VarDataSize != 0);
 
   if (*DataSize >= VarDataSize) {
@@ -2386,7 +2502,11 @@ VariableServiceGetVariable (
       goto Done;
     }
 
-    CopyMem (Data, GetVariableDataPtr (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat), VarDataSize);
+    Status = ReadVariableData (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat, Data);
+    if (EFI_ERROR (Status)) {
+      Status = EFI_DEVICE_ERROR;
+      goto Done;
+    }
 
     *DataSize = VarDataSize;
     UpdateVariableInfo (VariableName, VendorGuid, Variable.Volatile, TRUE, FALSE, FALSE, FALSE, &gVariableInfo);
@@ -3268,6 +3388,8 @@ FlushHobVariableToFlash (
       if (mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.HobFlushComplete != NULL) {
         *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.HobFlushComplete) = TRUE;
       }
+      VariableIndexRegisterStore (VariableStoreTypeHob, NULL, NULL);
+      ResetNextVariableCursor (VariableStoreHeader);
       if (!AtRuntime ()) {
         FreePool ((VOID *) VariableStoreHeader);
       }
@@ -3292,9 +3414,19 @@ VariableWriteServiceInitialize (
   UINTN                           Index;
   UINT8                           Data;
   VARIABLE_ENTRY_PROPERTY         *VariableEntry;
+  BOOLEAN                         NeedReclaim;
 
   AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
 
+  //
+  // With variable compression enabled, the reclaim converts the NV variable
+  // store to the compressed variable store format.
+  //
+  NeedReclaim = (BOOLEAN) ((PcdGet32 (PcdVariableCompressThreshold) != 0) &&
+                           mVariableModuleGlobal->VariableGlobal.AuthFormat &&
+                           !mVariableModuleGlobal->VariableGlobal.EmuNvMode &&
+                           !IsCompressedVariableStore (mNvVariableCache));
+
   //
   // Check if the free area is really free.
   //
@@ -3304,22 +3436,26 @@ VariableWriteServiceInitialize (
       //
       // There must be something wrong in variable store, do reclaim operation.
       //
-      Status = Reclaim (
-                 mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase,
-                 &mVariableModuleGlobal->NonVolatileLastVariableOffset,
-                 FALSE,
-                 NULL,
-                 NULL,
-                 0
-                 );
-      if (EFI_ERROR (Status)) {
-        ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
-        return Status;
-      }
+      NeedReclaim = TRUE;
       break;
     }
   }
 
+  if (NeedReclaim) {
+    Status = Reclaim (
+               mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase,
+               &mVariableModuleGlobal->NonVolatileLastVariableOffset,
+               FALSE,
+               NULL,
+               NULL,
+               0
+               );
+    if (EFI_ERROR (Status)) {
+      ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+      return Status;
+    }
+  }
+
   FlushHobVariableToFlash (NULL, NULL);
 
   Status = EFI_SUCCESS;
@@ -3658,6 +3794,27 @@ VariableCommonInitialize (
   VolatileVariableStore->Reserved    = 0;
   VolatileVariableStore->Reserved1   = 0;
 
+  //
+  // Index the variable stores searched by FindVariable (), lookups fall back
+  // to walking a store which could not be indexed.
+  //
+  VariableIndexRegisterStore (VariableStoreTypeVolatile, VolatileVariableStore, NULL);
+  VariableIndexRegisterStore (
+    VariableStoreTypeHob,
+    (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase,
+    NULL
+    );
+  VariableIndexRegisterStore (VariableStoreTypeNv, mNvVariableCache, NULL);
+  if (mNvVariableStoreIndex != NULL) {
+    VariableIndexImport (mNvVariableCache, mNvVariableStoreIndex);
+  }
+
+  //
+  // Only the NV variable store may hold compressed variables. The runtime
+  // readers of their data get a copy in a buffer of the maximum variable size.
+  //
+  VariableDecompressCacheRegisterStore (mNvVariableCache, NULL, ScratchSize);
+
   return EFI_SUCCESS;
 }
 
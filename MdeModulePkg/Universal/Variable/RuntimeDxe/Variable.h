@@ -2,7 +2,7 @@
   The internal header file includes the common header files, defines
   internal structure and functions used by Variable modules.
 
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -28,12 +28,16 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UefiLib.h>
 #include <Library/BaseLib.h>
 #include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/AuthVariableLib.h>
 #include <Library/VarCheckLib.h>
+#include <Library/UefiDecompressLib.h>
 #include <Guid/GlobalVariable.h>
 #include <Guid/EventGroup.h>
 #include <Guid/VariableFormat.h>
+#include <Guid/VariableStoreIndex.h>
+#include <Guid/VariableWriteEventGroup.h>
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/FaultTolerantWrite.h>
 #include <Guid/VarErrorFlag.h>
@@ -74,6 +78,7 @@ typedef struct {
   BOOLEAN                 *ReadLock;
   BOOLEAN                 *PendingUpdate;
   BOOLEAN                 *HobFlushComplete;
+  UINT32                  *StoreGeneration;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeHobCache;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeNvCache;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeVolatileCache;
@@ -145,9 +150,14 @@ FlushHobVariableToFlash (
   This function writes a buffer to variable storage space into a firmware
   volume block device. The destination is specified by the parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
+  The unchanged blocks at either end of the store are trimmed from the write,
+  unless the blocks of the store are not all of the same size. The blocks
+  between the first and the last changed block are all rewritten.
 
   @param  VariableBase   Base address of the variable to write.
   @param  VariableBuffer Point to the variable data buffer.
+  @param  BlockCount     Return the number of flash blocks rewritten, 0 if the
+                         whole store is written without looking at its blocks.
 
   @retval EFI_SUCCESS    The function completed successfully.
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol.
@@ -156,8 +166,9 @@ FlushHobVariableToFlash (
 **/
 EFI_STATUS
 FtwVariableSpace (
-  IN EFI_PHYSICAL_ADDRESS   VariableBase,
-  IN VARIABLE_STORE_HEADER  *VariableBuffer
+  IN  EFI_PHYSICAL_ADDRESS   VariableBase,
+  IN  VARIABLE_STORE_HEADER  *VariableBuffer,
+  OUT UINTN                  *BlockCount
   );
 
 /**
@@ -692,6 +703,7 @@ InitializeVariableQuota (
 extern VARIABLE_MODULE_GLOBAL       *mVariableModuleGlobal;
 extern EFI_FIRMWARE_VOLUME_HEADER   *mNvFvHeaderCache;
 extern VARIABLE_STORE_HEADER        *mNvVariableCache;
+extern VARIABLE_STORE_INDEX         *mNvVariableStoreIndex;
 extern VARIABLE_INFO_ENTRY          *gVariableInfo;
 extern BOOLEAN                      mEndOfDxe;
 extern VAR_CHECK_REQUEST_SOURCE     mRequestSource;
@@ -0,0 +1,116 @@
+/** @file
+  Compresses the data of the large non-volatile variables written to a
+  variable store with the signature COMPRESSED_VARIABLE_STORE_SIGNATURE, with
+  the UEFI compression algorithm.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Library/UefiCompressLib.h>
+
+#include "VariableParsing.h"
+#include "VariableCompress.h"
+
+/**
+  Compresses the data of a non-volatile variable being written, if it is
+  large enough and the compressed data saves space.
+
+  The compression allocates its work buffers from pool, so the data is only
+  compressed at boot time. The caller checks that the variable goes to a
+  store with the signature COMPRESSED_VARIABLE_STORE_SIGNATURE.
+
+  @param[in]      Attributes  Attributes of the variable.
+  @param[in, out] Data        The variable data, replaced by the compressed
+                              data if the return value is less than DataSize.
+  @param[in]      DataSize    Size of the variable data.
+
+  @return Size of the data to store, less than DataSize if it is compressed.
+
+**/
+UINTN
+CompressVariableData (
+  IN     UINT32               Attributes,
+  IN OUT UINT8                *Data,
+  IN     UINTN                DataSize
+  )
+{
+  RETURN_STATUS   Status;
+  UINT8           *Buffer;
+  UINT64          CompressedSize;
+
+  if ((PcdGet32 (PcdVariableCompressThreshold) == 0) ||
+      (DataSize < PcdGet32 (PcdVariableCompressThreshold)) ||
+      ((Attributes & EFI_VARIABLE_NON_VOLATILE) == 0) ||
+      AtRuntime ()) {
+    return DataSize;
+  }
+
+  //
+  // Every read of a compressed variable which is not cached decompresses it,
+  // only keep the compressed data if it saves at least an eighth of the space.
+  //
+  CompressedSize = DataSize - DataSize / 8;
+  Buffer = AllocatePool ((UINTN) CompressedSize);
+  if (Buffer == NULL) {
+    return DataSize;
+  }
+
+  Status = UefiCompress (Data, DataSize, Buffer, &CompressedSize);
+  if (!RETURN_ERROR (Status)) {
+    CopyMem (Data, Buffer, (UINTN) CompressedSize);
+    DataSize = (UINTN) CompressedSize;
+  }
+
+  FreePool (Buffer);
+  return DataSize;
+}
+
+/**
+  Compresses the data of a variable copied to a buffer in place, the way
+  CompressVariableData () does for a variable being written.
+
+  @param[in]      Store       Pointer to the variable store the variable was
+                              copied from. The flag VARIABLE_DATA_COMPRESSED
+                              of a variable copied from a store which never
+                              holds compressed variables is cleared.
+  @param[in, out] Variable    Pointer to the Variable Header, whose state is
+                              VAR_ADDED. The space the variable no longer
+                              uses is set to 0xff.
+  @param[in]      AuthFormat  TRUE indicates authenticated variables are used.
+                              FALSE indicates authenticated variables are not used.
+
+  @return Size of the variable, from its header to the next variable header.
+
+**/
+UINTN
+CompressVariable (
+  IN     VARIABLE_STORE_HEADER  *Store,
+  IN OUT VARIABLE_HEADER        *Variable,
+  IN     BOOLEAN                AuthFormat
+  )
+{
+  UINTN       VariableSize;
+  UINTN       DataSize;
+  UINTN       CompressedSize;
+
+  VariableSize = (UINTN) GetNextVariablePtr (Variable, AuthFormat) - (UINTN) Variable;
+  if (!AuthFormat || IsCompressedVariable (Store, Variable)) {
+    return VariableSize;
+  }
+
+  Variable->Reserved = (UINT8) (Variable->Reserved & ~VARIABLE_DATA_COMPRESSED);
+
+  DataSize       = DataSizeOfVariable (Variable, AuthFormat);
+  CompressedSize = CompressVariableData (Variable->Attributes, GetVariableDataPtr (Variable, AuthFormat), DataSize);
+  if (CompressedSize < DataSize) {
+    SetDataSizeOfVariable (Variable, CompressedSize, AuthFormat);
+    Variable->Reserved = (UINT8) (Variable->Reserved | VARIABLE_DATA_COMPRESSED);
+    DataSize     = VariableSize;
+    VariableSize = (UINTN) GetNextVariablePtr (Variable, AuthFormat) - (UINTN) Variable;
+    SetMem ((UINT8 *) Variable + VariableSize, DataSize - VariableSize, 0xff);
+  }
+
+  return VariableSize;
+}
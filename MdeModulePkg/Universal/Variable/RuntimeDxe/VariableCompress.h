@@ -0,0 +1,250 @@
+/** @file
+  The compressed variables of the NV variable store, and the cache of their
+  decompressed data shared by the variable driver and the variable runtime
+  cache.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_COMPRESS_H_
+#define _VARIABLE_COMPRESS_H_
+
+#include "Variable.h"
+
+typedef struct {
+  LIST_ENTRY              Link;
+  ///
+  /// Offset of the variable header from the first variable of the store,
+  /// MAX_UINT32 if the entry is stale.
+  ///
+  UINT32                  Offset;
+  ///
+  /// Size of the decompressed data, which follows this structure.
+  ///
+  UINT32                  DataSize;
+} VARIABLE_DECOMPRESS_ENTRY;
+
+typedef struct {
+  ///
+  /// Variable store whose compressed variables are cached, NULL if none.
+  ///
+  VARIABLE_STORE_HEADER   *Store;
+  ///
+  /// Optional counter bumped by whoever rewrites the store without telling
+  /// this cache, e.g. the SMM variable driver reclaiming a runtime cache.
+  ///
+  UINT32                  *Generation;
+  UINT32                  CachedGeneration;
+  ///
+  /// Decompressed data of the variables of the store, allocated at boot time.
+  ///
+  LIST_ENTRY              Entries;
+  ///
+  /// Scratch buffer of the UEFI decompression.
+  ///
+  VOID                    *Scratch;
+  UINT32                  ScratchSize;
+  ///
+  /// Buffer holding the data of the last variable decompressed without a
+  /// cache entry, at runtime.
+  ///
+  UINT8                   *Spare;
+  UINTN                   SpareSize;
+} VARIABLE_DECOMPRESS_CACHE;
+
+extern VARIABLE_DECOMPRESS_CACHE  mVariableDecompressCache;
+
+/**
+  Checks if a variable store may hold compressed variables.
+
+  @param[in] Store        Pointer to the variable store.
+
+  @retval TRUE            The store has the signature COMPRESSED_VARIABLE_STORE_SIGNATURE.
+  @retval FALSE           The store never holds compressed variables.
+
+**/
+BOOLEAN
+IsCompressedVariableStore (
+  IN VARIABLE_STORE_HEADER    *Store
+  );
+
+/**
+  Checks if the data of a variable is stored compressed.
+
+  The flag VARIABLE_DATA_COMPRESSED is only meaningful in a store with the
+  signature COMPRESSED_VARIABLE_STORE_SIGNATURE.
+
+  @param[in] Store        Pointer to the variable store holding the variable.
+  @param[in] Variable     Pointer to the Variable Header.
+
+  @retval TRUE            The data of the variable is compressed.
+  @retval FALSE           The data of the variable is stored as is.
+
+**/
+BOOLEAN
+IsCompressedVariable (
+  IN VARIABLE_STORE_HEADER    *Store,
+  IN VARIABLE_HEADER          *Variable
+  );
+
+/**
+  Gets the size of the variable data seen by the variable services, which is
+  the size of the decompressed data for a compressed variable.
+
+  @param[in] Variable     Pointer to the Variable Header.
+  @param[in] AuthFormat   TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+
+  @return Size of the variable data in bytes.
+
+**/
+UINTN
+GetVariableDataSize (
+  IN VARIABLE_HEADER          *Variable,
+  IN BOOLEAN                  AuthFormat
+  );
+
+/**
+  Gets a pointer to the variable data seen by the variable services.
+
+  The data of a variable stored as is is returned in place. The data of a
+  compressed variable is returned from the decompressed data cache, where it
+  stays until the variable is deleted or the store rewritten. At runtime, the
+  data of a compressed variable which is not cached yet is decompressed into
+  a buffer reused by the next such call.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  AuthFormat  TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+  @param[out] Data        Returns the pointer to the variable data.
+
+  @retval EFI_SUCCESS           Data points to the variable data.
+  @retval EFI_OUT_OF_RESOURCES  No memory to decompress the variable data.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data of the variable is invalid.
+
+**/
+EFI_STATUS
+GetVariableData (
+  IN  VARIABLE_HEADER         *Variable,
+  IN  BOOLEAN                 AuthFormat,
+  OUT VOID                    **Data
+  );
+
+/**
+  Copies the variable data seen by the variable services to a buffer.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  AuthFormat  TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+  @param[out] Buffer      Buffer of at least GetVariableDataSize () bytes.
+
+  @retval EFI_SUCCESS           The variable data is copied to Buffer.
+  @retval EFI_OUT_OF_RESOURCES  No memory to decompress the variable data.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data of the variable is invalid.
+
+**/
+EFI_STATUS
+ReadVariableData (
+  IN  VARIABLE_HEADER         *Variable,
+  IN  BOOLEAN                 AuthFormat,
+  OUT VOID                    *Buffer
+  );
+
+/**
+  Associates the variable store which may hold compressed variables with the
+  decompressed data cache, and allocates the buffers used to decompress them.
+
+  Any rewrite of the store other than appending variables and deleting them
+  through VariableDecompressCacheRemove () must be reported with
+  VariableDecompressCacheInvalidate () or through Generation.
+
+  @param[in] Store        Pointer to the variable store.
+  @param[in] Generation   Optional pointer to a counter which is changed every
+                          time the store is rewritten.
+  @param[in] SpareSize    Size of the buffer used to return the data of a
+                          variable which cannot be cached at runtime, 0 if
+                          GetVariableData () is not called at runtime.
+
+  @retval EFI_SUCCESS           The store is associated with the cache.
+  @retval EFI_OUT_OF_RESOURCES  No memory for the buffers, compressed variables
+                                are decompressed into buffers allocated at
+                                boot time.
+
+**/
+EFI_STATUS
+VariableDecompressCacheRegisterStore (
+  IN VARIABLE_STORE_HEADER    *Store,
+  IN UINT32                   *Generation  OPTIONAL,
+  IN UINTN                    SpareSize
+  );
+
+/**
+  Discards the decompressed data cache after the store has been rewritten.
+
+**/
+VOID
+VariableDecompressCacheInvalidate (
+  VOID
+  );
+
+/**
+  Discards the decompressed data of a variable which is being deleted.
+
+  @param[in] Variable     Pointer to the Variable Header in the store.
+
+**/
+VOID
+VariableDecompressCacheRemove (
+  IN VARIABLE_HEADER          *Variable
+  );
+
+/**
+  Compresses the data of a non-volatile variable being written, if it is
+  large enough and the compressed data saves space.
+
+  The compression allocates its work buffers from pool, so the data is only
+  compressed at boot time. The caller checks that the variable goes to a
+  store with the signature COMPRESSED_VARIABLE_STORE_SIGNATURE.
+
+  @param[in]      Attributes  Attributes of the variable.
+  @param[in, out] Data        The variable data, replaced by the compressed
+                              data if the return value is less than DataSize.
+  @param[in]      DataSize    Size of the variable data.
+
+  @return Size of the data to store, less than DataSize if it is compressed.
+
+**/
+UINTN
+CompressVariableData (
+  IN     UINT32               Attributes,
+  IN OUT UINT8                *Data,
+  IN     UINTN                DataSize
+  );
+
+/**
+  Compresses the data of a variable copied to a buffer in place, the way
+  CompressVariableData () does for a variable being written.
+
+  @param[in]      Store       Pointer to the variable store the variable was
+                              copied from. The flag VARIABLE_DATA_COMPRESSED
+                              of a variable copied from a store which never
+                              holds compressed variables is cleared.
+  @param[in, out] Variable    Pointer to the Variable Header, whose state is
+                              VAR_ADDED. The space the variable no longer
+                              uses is set to 0xff.
+  @param[in]      AuthFormat  TRUE indicates authenticated variables are used.
+                              FALSE indicates authenticated variables are not used.
+
+  @return Size of the variable, from its header to the next variable header.
+
+**/
+UINTN
+CompressVariable (
+  IN     VARIABLE_STORE_HEADER  *Store,
+  IN OUT VARIABLE_HEADER        *Variable,
+  IN     BOOLEAN                AuthFormat
+  );
+
+#endif
@@ -0,0 +1,539 @@
+/** @file
+  Reads the data of the compressed variables of the NV variable store, and
+  caches their decompressed data so that the variable services and the
+  authenticated variable support see the data as if it were stored as is.
+
+  A variable store with the signature COMPRESSED_VARIABLE_STORE_SIGNATURE
+  holds authenticated variables. The data of those with the flag
+  VARIABLE_DATA_COMPRESSED is compressed with the UEFI compression algorithm,
+  and DataSize in their header is the size of the compressed data.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableCompress.h"
+
+VARIABLE_DECOMPRESS_CACHE  mVariableDecompressCache = {
+  NULL,
+  NULL,
+  0,
+  INITIALIZE_LIST_HEAD_VARIABLE (mVariableDecompressCache.Entries),
+  NULL,
+  0,
+  NULL,
+  0
+};
+
+/**
+  Checks if a variable store may hold compressed variables.
+
+  @param[in] Store        Pointer to the variable store.
+
+  @retval TRUE            The store has the signature COMPRESSED_VARIABLE_STORE_SIGNATURE.
+  @retval FALSE           The store never holds compressed variables.
+
+**/
+BOOLEAN
+IsCompressedVariableStore (
+  IN VARIABLE_STORE_HEADER    *Store
+  )
+{
+  return CompareGuid (&Store->Signature, &gEdkiiCompressedVariableGuid);
+}
+
+/**
+  Checks if the data of a variable is stored compressed.
+
+  The flag VARIABLE_DATA_COMPRESSED is only meaningful in a store with the
+  signature COMPRESSED_VARIABLE_STORE_SIGNATURE.
+
+  @param[in] Store        Pointer to the variable store holding the variable.
+  @param[in] Variable     Pointer to the Variable Header.
+
+  @retval TRUE            The data of the variable is compressed.
+  @retval FALSE           The data of the variable is stored as is.
+
+**/
+BOOLEAN
+IsCompressedVariable (
+  IN VARIABLE_STORE_HEADER    *Store,
+  IN VARIABLE_HEADER          *Variable
+  )
+{
+  return (BOOLEAN) (((Variable->Reserved & VARIABLE_DATA_COMPRESSED) != 0) &&
+                    IsCompressedVariableStore (Store));
+}
+
+/**
+  Checks if a variable is a compressed variable of the store associated with
+  the decompressed data cache, the only store whose variables are read
+  compressed.
+
+  @param[in] Variable     Pointer to the Variable Header.
+
+  @retval TRUE            The data of the variable is compressed.
+  @retval FALSE           The data of the variable is stored as is.
+
+**/
+STATIC
+BOOLEAN
+IsCachedStoreCompressedVariable (
+  IN VARIABLE_HEADER          *Variable
+  )
+{
+  VARIABLE_STORE_HEADER   *Store;
+
+  Store = mVariableDecompressCache.Store;
+  return (BOOLEAN) ((Store != NULL) &&
+                    (Variable >= GetStartPointer (Store)) &&
+                    (Variable < GetEndPointer (Store)) &&
+                    IsCompressedVariable (Store, Variable));
+}
+
+/**
+  Gets the size of the variable data seen by the variable services, which is
+  the size of the decompressed data for a compressed variable.
+
+  @param[in] Variable     Pointer to the Variable Header.
+  @param[in] AuthFormat   TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+
+  @return Size of the variable data in bytes.
+
+**/
+UINTN
+GetVariableDataSize (
+  IN VARIABLE_HEADER          *Variable,
+  IN BOOLEAN                  AuthFormat
+  )
+{
+  UINTN   DataSize;
+
+  DataSize = DataSizeOfVariable (Variable, AuthFormat);
+  if (!IsCachedStoreCompressedVariable (Variable) || (DataSize < 2 * sizeof (UINT32))) {
+    return DataSize;
+  }
+
+  //
+  // The compressed data starts with its own size, then the original size.
+  //
+  return ReadUnaligned32 ((UINT32 *) (GetVariableDataPtr (Variable, AuthFormat) + sizeof (UINT32)));
+}
+
+/**
+  Allocates the scratch buffer of the UEFI decompression.
+
+  @retval EFI_SUCCESS           The scratch buffer is allocated.
+  @retval EFI_OUT_OF_RESOURCES  No memory for the scratch buffer.
+
+**/
+STATIC
+EFI_STATUS
+AllocateDecompressScratch (
+  VOID
+  )
+{
+  RETURN_STATUS   Status;
+  UINT32          Header[2];
+  UINT32          DestinationSize;
+  UINT32          ScratchSize;
+
+  if (mVariableDecompressCache.Scratch != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // The scratch size does not depend on the compressed data, get it with the
+  // header of empty data.
+  //
+  Header[0] = 0;
+  Header[1] = 0;
+  Status = UefiDecompressGetInfo (Header, (UINT32) sizeof (Header), &DestinationSize, &ScratchSize);
+  if (RETURN_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mVariableDecompressCache.Scratch = AllocateRuntimePool (ScratchSize);
+  if (mVariableDecompressCache.Scratch == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  mVariableDecompressCache.ScratchSize = ScratchSize;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Decompresses the data of a compressed variable.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  AuthFormat  TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+  @param[out] Buffer      Buffer of at least GetVariableDataSize () bytes.
+
+  @retval EFI_SUCCESS           The decompressed data is in Buffer.
+  @retval EFI_OUT_OF_RESOURCES  No scratch buffer for the decompression.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data of the variable is invalid.
+
+**/
+STATIC
+EFI_STATUS
+DecompressVariableData (
+  IN  VARIABLE_HEADER         *Variable,
+  IN  BOOLEAN                 AuthFormat,
+  OUT VOID                    *Buffer
+  )
+{
+  EFI_STATUS      Status;
+  UINT8           *Source;
+  UINTN           SourceSize;
+  UINT32          DestinationSize;
+  UINT32          ScratchSize;
+
+  if (mVariableDecompressCache.Scratch == NULL) {
+    if (AtRuntime ()) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Status = AllocateDecompressScratch ();
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Source     = GetVariableDataPtr (Variable, AuthFormat);
+  SourceSize = DataSizeOfVariable (Variable, AuthFormat);
+  if (RETURN_ERROR (UefiDecompressGetInfo (Source, (UINT32) SourceSize, &DestinationSize, &ScratchSize)) ||
+      (DestinationSize != GetVariableDataSize (Variable, AuthFormat)) ||
+      (ScratchSize > mVariableDecompressCache.ScratchSize)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  if (RETURN_ERROR (UefiDecompress (Source, Buffer, mVariableDecompressCache.Scratch))) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Discards a decompressed data cache entry.
+
+  The memory of the entry is only freed at boot time, at runtime the entry
+  is left stale in the list.
+
+  @param[in] Entry        The entry to discard.
+
+**/
+STATIC
+VOID
+DiscardDecompressEntry (
+  IN VARIABLE_DECOMPRESS_ENTRY  *Entry
+  )
+{
+  if (AtRuntime ()) {
+    Entry->Offset = MAX_UINT32;
+  } else {
+    RemoveEntryList (&Entry->Link);
+    FreePool (Entry);
+  }
+}
+
+/**
+  Finds the decompressed data cache entry of a variable of the store.
+
+  @param[in] Variable     Pointer to the Variable Header.
+
+  @return The entry of the variable, or NULL if the data of the variable is
+          not cached.
+
+**/
+STATIC
+VARIABLE_DECOMPRESS_ENTRY *
+FindDecompressEntry (
+  IN VARIABLE_HEADER          *Variable
+  )
+{
+  VARIABLE_DECOMPRESS_CACHE   *Cache;
+  VARIABLE_DECOMPRESS_ENTRY   *Entry;
+  LIST_ENTRY                  *Link;
+  UINT32                      Offset;
+
+  Cache = &mVariableDecompressCache;
+  if ((Cache->Store == NULL) ||
+      (Variable < GetStartPointer (Cache->Store)) ||
+      (Variable >= GetEndPointer (Cache->Store))) {
+    return NULL;
+  }
+
+  if ((Cache->Generation != NULL) && (*(Cache->Generation) != Cache->CachedGeneration)) {
+    VariableDecompressCacheInvalidate ();
+    Cache->CachedGeneration = *(Cache->Generation);
+  }
+
+  Offset = (UINT32) ((UINTN) Variable - (UINTN) GetStartPointer (Cache->Store));
+  for (Link = GetFirstNode (&Cache->Entries); !IsNull (&Cache->Entries, Link); Link = GetNextNode (&Cache->Entries, Link)) {
+    Entry = BASE_CR (Link, VARIABLE_DECOMPRESS_ENTRY, Link);
+    if (Entry->Offset == Offset) {
+      return Entry;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Gets the decompressed data cache entry of a compressed variable, and
+  decompresses the variable into a new entry if there is none yet.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  AuthFormat  TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+  @param[out] Entry       Returns the entry of the variable.
+
+  @retval EFI_SUCCESS           Entry holds the decompressed data of the variable.
+  @retval EFI_NOT_FOUND         The data of the variable cannot be cached: it is
+                                runtime, the variable is not in the store of the
+                                cache, or there is no memory for the entry.
+  @retval EFI_OUT_OF_RESOURCES  No scratch buffer for the decompression.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data of the variable is invalid.
+
+**/
+STATIC
+EFI_STATUS
+GetDecompressEntry (
+  IN  VARIABLE_HEADER             *Variable,
+  IN  BOOLEAN                     AuthFormat,
+  OUT VARIABLE_DECOMPRESS_ENTRY   **Entry
+  )
+{
+  EFI_STATUS                  Status;
+  VARIABLE_DECOMPRESS_ENTRY   *NewEntry;
+  UINTN                       DataSize;
+
+  *Entry = FindDecompressEntry (Variable);
+  if (*Entry != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  if (AtRuntime () || (mVariableDecompressCache.Store == NULL) ||
+      (Variable < GetStartPointer (mVariableDecompressCache.Store)) ||
+      (Variable >= GetEndPointer (mVariableDecompressCache.Store))) {
+    return EFI_NOT_FOUND;
+  }
+
+  DataSize = GetVariableDataSize (Variable, AuthFormat);
+  NewEntry = AllocateRuntimePool (sizeof (VARIABLE_DECOMPRESS_ENTRY) + DataSize);
+  if (NewEntry == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = DecompressVariableData (Variable, AuthFormat, NewEntry + 1);
+  if (EFI_ERROR (Status)) {
+    FreePool (NewEntry);
+    return Status;
+  }
+
+  NewEntry->Offset   = (UINT32) ((UINTN) Variable - (UINTN) GetStartPointer (mVariableDecompressCache.Store));
+  NewEntry->DataSize = (UINT32) DataSize;
+  InsertHeadList (&mVariableDecompressCache.Entries, &NewEntry->Link);
+  *Entry = NewEntry;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Gets a pointer to the variable data seen by the variable services.
+
+  The data of a variable stored as is is returned in place. The data of a
+  compressed variable is returned from the decompressed data cache, where it
+  stays until the variable is deleted or the store rewritten. At runtime, the
+  data of a compressed variable which is not cached yet is decompressed into
+  a buffer reused by the next such call.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  AuthFormat  TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+  @param[out] Data        Returns the pointer to the variable data.
+
+  @retval EFI_SUCCESS           Data points to the variable data.
+  @retval EFI_OUT_OF_RESOURCES  No memory to decompress the variable data.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data of the variable is invalid.
+
+**/
+EFI_STATUS
+GetVariableData (
+  IN  VARIABLE_HEADER         *Variable,
+  IN  BOOLEAN                 AuthFormat,
+  OUT VOID                    **Data
+  )
+{
+  EFI_STATUS                  Status;
+  VARIABLE_DECOMPRESS_ENTRY   *Entry;
+
+  if (!IsCachedStoreCompressedVariable (Variable)) {
+    *Data = GetVariableDataPtr (Variable, AuthFormat);
+    return EFI_SUCCESS;
+  }
+
+  Status = GetDecompressEntry (Variable, AuthFormat, &Entry);
+  if (!EFI_ERROR (Status)) {
+    *Data = Entry + 1;
+    return EFI_SUCCESS;
+  } else if (Status != EFI_NOT_FOUND) {
+    return Status;
+  }
+
+  if (GetVariableDataSize (Variable, AuthFormat) > mVariableDecompressCache.SpareSize) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = DecompressVariableData (Variable, AuthFormat, mVariableDecompressCache.Spare);
+  if (!EFI_ERROR (Status)) {
+    *Data = mVariableDecompressCache.Spare;
+  }
+
+  return Status;
+}
+
+/**
+  Copies the variable data seen by the variable services to a buffer.
+
+  @param[in]  Variable    Pointer to the Variable Header.
+  @param[in]  AuthFormat  TRUE indicates authenticated variables are used.
+                          FALSE indicates authenticated variables are not used.
+  @param[out] Buffer      Buffer of at least GetVariableDataSize () bytes.
+
+  @retval EFI_SUCCESS           The variable data is copied to Buffer.
+  @retval EFI_OUT_OF_RESOURCES  No memory to decompress the variable data.
+  @retval EFI_VOLUME_CORRUPTED  The compressed data of the variable is invalid.
+
+**/
+EFI_STATUS
+ReadVariableData (
+  IN  VARIABLE_HEADER         *Variable,
+  IN  BOOLEAN                 AuthFormat,
+  OUT VOID                    *Buffer
+  )
+{
+  EFI_STATUS                  Status;
+  VARIABLE_DECOMPRESS_ENTRY   *Entry;
+
+  if (!IsCachedStoreCompressedVariable (Variable)) {
+    CopyMem (Buffer, GetVariableDataPtr (Variable, AuthFormat), DataSizeOfVariable (Variable, AuthFormat));
+    return EFI_SUCCESS;
+  }
+
+  Status = GetDecompressEntry (Variable, AuthFormat, &Entry);
+  if (!EFI_ERROR (Status)) {
+    CopyMem (Buffer, Entry + 1, Entry->DataSize);
+    return EFI_SUCCESS;
+  } else if (Status != EFI_NOT_FOUND) {
+    return Status;
+  }
+
+  return DecompressVariableData (Variable, AuthFormat, Buffer);
+}
+
+/**
+  Associates the variable store which may hold compressed variables with the
+  decompressed data cache, and allocates the buffers used to decompress them.
+
+  Any rewrite of the store other than appending variables and deleting them
+  through VariableDecompressCacheRemove () must be reported with
+  VariableDecompressCacheInvalidate () or through Generation.
+
+  @param[in] Store        Pointer to the variable store.
+  @param[in] Generation   Optional pointer to a counter which is changed every
+                          time the store is rewritten.
+  @param[in] SpareSize    Size of the buffer used to return the data of a
+                          variable which cannot be cached at runtime, 0 if
+                          GetVariableData () is not called at runtime.
+
+  @retval EFI_SUCCESS           The store is associated with the cache.
+  @retval EFI_OUT_OF_RESOURCES  No memory for the buffers, compressed variables
+                                are decompressed into buffers allocated at
+                                boot time.
+
+**/
+EFI_STATUS
+VariableDecompressCacheRegisterStore (
+  IN VARIABLE_STORE_HEADER    *Store,
+  IN UINT32                   *Generation  OPTIONAL,
+  IN UINTN                    SpareSize
+  )
+{
+  EFI_STATUS                  Status;
+  VARIABLE_DECOMPRESS_CACHE   *Cache;
+
+  Cache = &mVariableDecompressCache;
+  VariableDecompressCacheInvalidate ();
+  Cache->Store            = Store;
+  Cache->Generation       = Generation;
+  Cache->CachedGeneration = (Generation != NULL) ? *Generation : 0;
+
+  //
+  // The buffers are only needed at runtime if the store holds, or is going to
+  // hold, compressed variables.
+  //
+  if ((PcdGet32 (PcdVariableCompressThreshold) == 0) && !IsCompressedVariableStore (Store)) {
+    return EFI_SUCCESS;
+  }
+
+  Status = AllocateDecompressScratch ();
+  if (!EFI_ERROR (Status) && (SpareSize > Cache->SpareSize)) {
+    if (Cache->Spare != NULL) {
+      FreePool (Cache->Spare);
+    }
+    Cache->Spare     = AllocateRuntimePool (SpareSize);
+    Cache->SpareSize = (Cache->Spare != NULL) ? SpareSize : 0;
+    if (Cache->Spare == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  return Status;
+}
+
+/**
+  Discards the decompressed data cache after the store has been rewritten.
+
+**/
+VOID
+VariableDecompressCacheInvalidate (
+  VOID
+  )
+{
+  LIST_ENTRY                  *Link;
+  VARIABLE_DECOMPRESS_ENTRY   *Entry;
+
+  Link = GetFirstNode (&mVariableDecompressCache.Entries);
+  while (!IsNull (&mVariableDecompressCache.Entries, Link)) {
+    Entry = BASE_CR (Link, VARIABLE_DECOMPRESS_ENTRY, Link);
+    Link  = GetNextNode (&mVariableDecompressCache.Entries, Link);
+    DiscardDecompressEntry (Entry);
+  }
+}
+
+/**
+  Discards the decompressed data of a variable which is being deleted.
+
+  @param[in] Variable     Pointer to the Variable Header in the store.
+
+**/
+VOID
+VariableDecompressCacheRemove (
+  IN VARIABLE_HEADER          *Variable
+  )
+{
+  VARIABLE_DECOMPRESS_ENTRY   *Entry;
+
+  if (!IsCachedStoreCompressedVariable (Variable)) {
+    return;
+  }
+
+  Entry = FindDecompressEntry (Variable);
+  if (Entry != NULL) {
+    DiscardDecompressEntry (Entry);
+  }
+}
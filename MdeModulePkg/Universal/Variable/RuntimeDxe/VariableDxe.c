@@ -3,13 +3,15 @@
   and volatile storage space and install variable architecture protocol.
 
 Copyright (C) 2013, Red Hat, Inc.
-Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2006 - 2020, Intel Corporation. All rights reserved.<BR>
 (C) Copyright 2015 Hewlett Packard Enterprise Development LP<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 
 #include "Variable.h"
+#include "VariableIndex.h"
+#include "VariableCompress.h"
 
 EFI_HANDLE                          mHandle                    = NULL;
 EFI_EVENT                           mVirtualAddressChangeEvent = NULL;
@@ -249,6 +251,16 @@ VariableClassAddressChangeEvent (
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal);
   EfiConvertPointer (0x0, (VOID **) &mNvVariableCache);
   EfiConvertPointer (0x0, (VOID **) &mNvFvHeaderCache);
+  for (Index = 0; Index < VariableStoreTypeMax; Index++) {
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[Index].Store);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[Index].Buckets);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[Index].Entries);
+  }
+  EfiConvertList (0x0, &mVariableDecompressCache.Entries);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Store);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Generation);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Scratch);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Spare);
 
   if (mAuthContextOut.AddressPointer != NULL) {
     for (Index = 0; Index < mAuthContextOut.AddressPointerCount; Index++) {
@@ -337,6 +349,29 @@ OnEndOfDxe (
   gBS->CloseEvent (Event);
 }
 
+/**
+  Notification function of EFI_EVENT_GROUP_EXIT_BOOT_SERVICES event group.
+
+  This is a notification function registered on EFI_EVENT_GROUP_EXIT_BOOT_SERVICES event group.
+  It releases the resources of AuthVariableLib that can not be used after
+  SetVirtualAddressMap ().
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+OnExitBootServices (
+  EFI_EVENT                               Event,
+  VOID                                    *Context
+  )
+{
+  if (mVariableModuleGlobal->VariableGlobal.AuthSupport) {
+    AuthVariableLibExitBootServices ();
+  }
+}
+
 /**
   Initializes variable write service for DXE.
 
@@ -465,6 +500,40 @@ FtwNotificationEvent (
 
 }
 
+/**
+  This code sets variable in storage blocks (Volatile or Non-Volatile), and
+  signals the gEdkiiVariableWriteEventGroupGuid event group before
+  ExitBootServices () when the variable was set and IsVariableWriteEventNeeded ()
+  requires it.
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+
+  @return The status returned by VariableServiceSetVariable ().
+
+**/
+EFI_STATUS
+EFIAPI
+RuntimeServiceSetVariable (
+  IN CHAR16                  *VariableName,
+  IN EFI_GUID                *VendorGuid,
+  IN UINT32                  Attributes,
+  IN UINTN                   DataSize,
+  IN VOID                    *Data
+  )
+{
+  EFI_STATUS                 Status;
+
+  Status = VariableServiceSetVariable (VariableName, VendorGuid, Attributes, DataSize, Data);
+  if (!EFI_ERROR (Status) && !AtRuntime () && IsVariableWriteEventNeeded (VendorGuid)) {
+    EfiEventGroupSignal (&gEdkiiVariableWriteEventGroupGuid);
+  }
+  return Status;
+}
 
 /**
   Variable Driver main entry point. The Variable driver places the 4 EFI
@@ -488,6 +557,7 @@ VariableServiceInitialize (
   EFI_STATUS                            Status;
   EFI_EVENT                             ReadyToBootEvent;
   EFI_EVENT                             EndOfDxeEvent;
+  EFI_EVENT                             ExitBootServicesEvent;
 
   Status = VariableCommonInitialize ();
   ASSERT_EFI_ERROR (Status);
@@ -510,7 +580,7 @@ VariableServiceInitialize (
 
   SystemTable->RuntimeServices->GetVariable         = VariableServiceGetVariable;
   SystemTable->RuntimeServices->GetNextVariableName = VariableServiceGetNextVariableName;
-  SystemTable->RuntimeServices->SetVariable         = VariableServiceSetVariable;
+  SystemTable->RuntimeServices->SetVariable         = RuntimeServiceSetVariable;
   SystemTable->RuntimeServices->QueryVariableInfo   = VariableServiceQueryVariableInfo;
 
   //
@@ -576,6 +646,20 @@ VariableServiceInitialize (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  //
+  // Register the event handling function to release the resources of
+  // AuthVariableLib that hold physical addresses.
+  //
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  OnExitBootServices,
+                  NULL,
+                  &gEfiEventExitBootServicesGuid,
+                  &ExitBootServicesEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   return EFI_SUCCESS;
 }
 
@@ -1,13 +1,14 @@
 /** @file
   Provides variable driver extended services.
 
-Copyright (c) 2015 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2015 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 
 #include "Variable.h"
 #include "VariableParsing.h"
+#include "VariableCompress.h"
 
 /**
   Finds variable in storage blocks of volatile and non-volatile storage areas.
@@ -56,8 +57,15 @@ VariableExLibFindVariable (
     return Status;
   }
 
-  AuthVariableInfo->DataSize        = DataSizeOfVariable (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
-  AuthVariableInfo->Data            = GetVariableDataPtr (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+  //
+  // The data of a compressed variable is returned decompressed, from the
+  // decompressed data cache.
+  //
+  Status = GetVariableData (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat, &AuthVariableInfo->Data);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  AuthVariableInfo->DataSize        = GetVariableDataSize (Variable.CurrPtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
   AuthVariableInfo->Attributes      = Variable.CurrPtr->Attributes;
   if (mVariableModuleGlobal->VariableGlobal.AuthFormat) {
     AuthVariable = (AUTHENTICATED_VARIABLE_HEADER *) Variable.CurrPtr;
@@ -125,8 +133,11 @@ VariableExLibFindNextVariable (
 
   AuthVariableInfo->VariableName    = GetVariableNamePtr (VariablePtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
   AuthVariableInfo->VendorGuid      = GetVendorGuidPtr (VariablePtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
-  AuthVariableInfo->DataSize        = DataSizeOfVariable (VariablePtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
-  AuthVariableInfo->Data            = GetVariableDataPtr (VariablePtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+  Status = GetVariableData (VariablePtr, mVariableModuleGlobal->VariableGlobal.AuthFormat, &AuthVariableInfo->Data);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  AuthVariableInfo->DataSize        = GetVariableDataSize (VariablePtr, mVariableModuleGlobal->VariableGlobal.AuthFormat);
   AuthVariableInfo->Attributes      = VariablePtr->Attributes;
   if (mVariableModuleGlobal->VariableGlobal.AuthFormat) {
     AuthVariablePtr = (AUTHENTICATED_VARIABLE_HEADER *) VariablePtr;
@@ -0,0 +1,552 @@
+/** @file
+  In-memory hash index of the variable stores.
+
+  FindVariableEx () walks a variable store from its first variable header, so
+  each GetVariable () and SetVariable () costs time proportional to the number
+  of variables (live and deleted) in the store. The index maps the name and
+  GUID of each variable to its headers. It is built on the first lookup in a
+  store and extended with the variables appended to the store since the last
+  lookup, so UpdateVariable () needs no change. A reclaim rewrites the store,
+  and discards its index.
+
+  Caution: This module requires additional review when modified.
+  This driver will have external input - variable data. They may be input in SMM mode.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+
+VARIABLE_INDEX  mVariableIndex[VariableStoreTypeMax];
+
+/**
+  Calculates the hash of a variable name and vendor GUID.
+
+  @param[in] Name         Pointer to the variable name.
+  @param[in] NameLength   Maximum number of characters of Name to hash, the
+                          hash stops at the first null character.
+  @param[in] VendorGuid   Pointer to the vendor GUID.
+
+  @return The hash value.
+
+**/
+STATIC
+UINT32
+VariableIndexHash (
+  IN CONST CHAR16     *Name,
+  IN UINTN            NameLength,
+  IN CONST EFI_GUID   *VendorGuid
+  )
+{
+  UINT32        Hash;
+  UINTN         Index;
+  CONST UINT8   *Guid;
+
+  //
+  // FNV-1a over the characters of the name and the bytes of the GUID.
+  //
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < NameLength && Name[Index] != L'\0'; Index++) {
+    Hash = (Hash ^ Name[Index]) * 0x01000193;
+  }
+
+  Guid = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Guid[Index]) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+  Inserts a variable header in its bucket of the index.
+
+  @param[in, out] Index       Pointer to the index, which has room for the entry.
+  @param[in]      Offset      Offset of the variable header in the store.
+  @param[in]      Hash        Hash of the variable name and vendor GUID.
+
+**/
+STATIC
+VOID
+VariableIndexInsert (
+  IN OUT VARIABLE_INDEX   *Index,
+  IN     UINT32           Offset,
+  IN     UINT32           Hash
+  )
+{
+  VARIABLE_INDEX_ENTRY  *Entry;
+
+  Entry         = &Index->Entries[Index->EntryCount];
+  Entry->Offset = Offset;
+  Entry->Next   = Index->Buckets[Hash & Index->BucketMask];
+  Index->EntryCount++;
+  Index->Buckets[Hash & Index->BucketMask] = Index->EntryCount;
+}
+
+/**
+  Adds a variable header to the index.
+
+  @param[in, out] Index       Pointer to the index.
+  @param[in]      Variable    Pointer to the variable header.
+  @param[in]      Offset      Offset of the variable header in the store.
+  @param[in]      AuthFormat  TRUE indicates authenticated variables are used.
+                              FALSE indicates authenticated variables are not used.
+
+**/
+STATIC
+VOID
+VariableIndexAdd (
+  IN OUT VARIABLE_INDEX   *Index,
+  IN     VARIABLE_HEADER  *Variable,
+  IN     UINT32           Offset,
+  IN     BOOLEAN          AuthFormat
+  )
+{
+  CHAR16                *Name;
+  UINTN                 NameLength;
+
+  Name       = GetVariableNamePtr (Variable, AuthFormat);
+  NameLength = NameSizeOfVariable (Variable, AuthFormat) / sizeof (CHAR16);
+
+  //
+  // FindVariableEx () compares NameSize bytes, so a name without a null
+  // character in it also matches any longer name with the same prefix,
+  // which a hash cannot find. Leave such a store to the walk.
+  //
+  if ((Index->EntryCount >= Index->MaxEntries) ||
+      (NameLength == 0) ||
+      (StrnLenS (Name, NameLength) == NameLength)) {
+    Index->Valid = FALSE;
+    return;
+  }
+
+  VariableIndexInsert (Index, Offset, VariableIndexHash (Name, NameLength, GetVendorGuidPtr (Variable, AuthFormat)));
+}
+
+/**
+  Checks whether the state of a variable header may still become VAR_ADDED,
+  i.e. the variable is being written.
+
+  @param[in] State    The state of the variable header.
+
+  @retval TRUE        The variable is being written.
+  @retval FALSE       The variable has been written, or was abandoned.
+
+**/
+STATIC
+BOOLEAN
+VariableIndexIsPendingState (
+  IN UINT8    State
+  )
+{
+  return (BOOLEAN) (((State & (UINT8) ~VAR_ADDED) != 0) &&
+                    ((State & (UINT8) ~VAR_DELETED) != 0));
+}
+
+/**
+  Resets the index to an empty one, the next lookup parses the whole store.
+
+  @param[in, out] Index       Pointer to the index.
+
+**/
+STATIC
+VOID
+VariableIndexReset (
+  IN OUT VARIABLE_INDEX   *Index
+  )
+{
+  ZeroMem (Index->Buckets, (Index->BucketMask + 1) * sizeof (UINT32));
+  Index->EntryCount        = 0;
+  Index->IndexedOffset     = 0;
+  Index->PendingCount      = 0;
+  Index->Valid             = TRUE;
+  Index->IndexedGeneration = (Index->Generation != NULL) ? *(Index->Generation) : 0;
+}
+
+/**
+  Brings the index up to date with the variable store.
+
+  @param[in, out] Index       Pointer to the index.
+  @param[in]      AuthFormat  TRUE indicates authenticated variables are used.
+                              FALSE indicates authenticated variables are not used.
+
+**/
+STATIC
+VOID
+VariableIndexUpdate (
+  IN OUT VARIABLE_INDEX   *Index,
+  IN     BOOLEAN          AuthFormat
+  )
+{
+  VARIABLE_HEADER   *StartPtr;
+  VARIABLE_HEADER   *EndPtr;
+  VARIABLE_HEADER   *Variable;
+  UINT32            Pending;
+  UINT32            Offset;
+
+  if ((Index->Generation != NULL) && (*(Index->Generation) != Index->IndexedGeneration)) {
+    VariableIndexReset (Index);
+  }
+
+  if (!Index->Valid) {
+    return;
+  }
+
+  StartPtr = GetStartPointer (Index->Store);
+  EndPtr   = GetEndPointer (Index->Store);
+
+  //
+  // Index the variables whose write has completed since the last lookup.
+  //
+  Pending = 0;
+  while (Pending < Index->PendingCount) {
+    Variable = (VARIABLE_HEADER *) ((UINTN) StartPtr + Index->PendingOffset[Pending]);
+    if (VariableIndexIsPendingState (Variable->State)) {
+      Pending++;
+      continue;
+    }
+
+    if ((Variable->State == VAR_ADDED) ||
+        (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      VariableIndexAdd (Index, Variable, Index->PendingOffset[Pending], AuthFormat);
+    }
+
+    Index->PendingCount--;
+    Index->PendingOffset[Pending] = Index->PendingOffset[Index->PendingCount];
+  }
+
+  //
+  // Index the variables appended to the store since the last lookup.
+  //
+  Variable = (VARIABLE_HEADER *) ((UINTN) StartPtr + Index->IndexedOffset);
+  while (IsValidVariableHeader (Variable, EndPtr) && Index->Valid) {
+    Offset = (UINT32) ((UINTN) Variable - (UINTN) StartPtr);
+    if ((Variable->State == VAR_ADDED) ||
+        (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+      VariableIndexAdd (Index, Variable, Offset, AuthFormat);
+    } else if (VariableIndexIsPendingState (Variable->State)) {
+      if (Index->PendingCount == VARIABLE_INDEX_PENDING_MAX) {
+        Index->Valid = FALSE;
+        break;
+      }
+      Index->PendingOffset[Index->PendingCount++] = Offset;
+    }
+
+    Variable = GetNextVariablePtr (Variable, AuthFormat);
+  }
+
+  //
+  // A corrupted size may move the next header past the end of the store, the
+  // walk in FindVariableEx () stops there as well.
+  //
+  if (Variable > EndPtr) {
+    Variable = EndPtr;
+  }
+  Index->IndexedOffset = (UINT32) ((UINTN) Variable - (UINTN) StartPtr);
+}
+
+/**
+  Checks whether a variable header matches a variable name and vendor GUID
+  the way FindVariableEx () does.
+
+  @param[in] Variable       Pointer to the variable header.
+  @param[in] VariableName   Name of the variable to be found.
+  @param[in] VendorGuid     Vendor GUID to be found.
+  @param[in] IgnoreRtCheck  Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                            check at runtime when searching variable.
+  @param[in] AuthFormat     TRUE indicates authenticated variables are used.
+                            FALSE indicates authenticated variables are not used.
+
+  @retval TRUE              The variable matches.
+  @retval FALSE             The variable does not match.
+
+**/
+STATIC
+BOOLEAN
+VariableIndexMatch (
+  IN VARIABLE_HEADER  *Variable,
+  IN CHAR16           *VariableName,
+  IN EFI_GUID         *VendorGuid,
+  IN BOOLEAN          IgnoreRtCheck,
+  IN BOOLEAN          AuthFormat
+  )
+{
+  if ((Variable->State != VAR_ADDED) &&
+      (Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED))) {
+    return FALSE;
+  }
+
+  if (!IgnoreRtCheck && AtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+    return FALSE;
+  }
+
+  if (!CompareGuid (VendorGuid, GetVendorGuidPtr (Variable, AuthFormat))) {
+    return FALSE;
+  }
+
+  ASSERT (NameSizeOfVariable (Variable, AuthFormat) != 0);
+  return (BOOLEAN) (CompareMem (
+                      VariableName,
+                      GetVariableNamePtr (Variable, AuthFormat),
+                      NameSizeOfVariable (Variable, AuthFormat)
+                      ) == 0);
+}
+
+/**
+  Associates a variable store with the hash index of the given store type.
+
+  The index is built lazily, the first lookup parses the variables which are
+  already present in the store. Later appends to the store are picked up by
+  the next lookup, but any other rewrite of the store (e.g. reclaim) must be
+  reported with VariableIndexInvalidate () or through Generation.
+
+  @param[in] StoreType    The type of the variable store.
+  @param[in] Store        Pointer to the variable store, NULL to detach the index
+                          from its current store.
+  @param[in] Generation   Optional pointer to a counter which is changed every
+                          time the store is rewritten.
+
+  @retval EFI_SUCCESS           The store is associated with the index.
+  @retval EFI_UNSUPPORTED       The variable hash index is disabled.
+  @retval EFI_OUT_OF_RESOURCES  No memory for the index, lookups in the store
+                                walk the store.
+
+**/
+EFI_STATUS
+VariableIndexRegisterStore (
+  IN VARIABLE_STORE_TYPE      StoreType,
+  IN VARIABLE_STORE_HEADER    *Store       OPTIONAL,
+  IN UINT32                   *Generation  OPTIONAL
+  )
+{
+  VARIABLE_INDEX  *Index;
+  UINT32          MaxEntries;
+  UINT32          BucketCount;
+
+  if (!FeaturePcdGet (PcdEnableVariableHashIndex)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  ASSERT (StoreType < VariableStoreTypeMax);
+  Index = &mVariableIndex[StoreType];
+  Index->Store = NULL;
+  if (Store == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  if (Store->Size <= sizeof (VARIABLE_STORE_HEADER)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Every variable takes at least the size of a variable header.
+  //
+  MaxEntries  = (UINT32) ((Store->Size - sizeof (VARIABLE_STORE_HEADER)) / sizeof (VARIABLE_HEADER));
+  BucketCount = MAX (GetPowerOfTwo32 (MaxEntries / 4), 16);
+
+  if ((Index->MaxEntries < MaxEntries) || (Index->BucketMask + 1 < BucketCount)) {
+    if (Index->Entries != NULL) {
+      FreePool (Index->Entries);
+      FreePool (Index->Buckets);
+    }
+    Index->Entries    = AllocateRuntimePool (MaxEntries * sizeof (VARIABLE_INDEX_ENTRY));
+    Index->Buckets    = AllocateRuntimePool (BucketCount * sizeof (UINT32));
+    Index->MaxEntries = MaxEntries;
+    Index->BucketMask = BucketCount - 1;
+    if ((Index->Entries == NULL) || (Index->Buckets == NULL)) {
+      if (Index->Entries != NULL) {
+        FreePool (Index->Entries);
+      }
+      if (Index->Buckets != NULL) {
+        FreePool (Index->Buckets);
+      }
+      ZeroMem (Index, sizeof (*Index));
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  Index->Store      = Store;
+  Index->Generation = Generation;
+  VariableIndexReset (Index);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Discards the index of a variable store after the store has been rewritten.
+
+  @param[in] Store        Pointer to the variable store.
+
+**/
+VOID
+VariableIndexInvalidate (
+  IN VARIABLE_STORE_HEADER    *Store
+  )
+{
+  VARIABLE_STORE_TYPE   StoreType;
+
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    if ((Store != NULL) && (mVariableIndex[StoreType].Store == Store)) {
+      VariableIndexReset (&mVariableIndex[StoreType]);
+    }
+  }
+}
+
+/**
+  Seeds the index of a variable store with the index of the same store built
+  by the PEI variable driver, so that the first lookup does not parse it.
+
+  The PEI index uses the same hash, and offsets from the store header.
+
+  @param[in] Store        Pointer to the variable store, which has just been
+                          registered.
+  @param[in] StoreIndex   Pointer to the index built by the PEI variable driver,
+                          already checked against the store.
+
+**/
+VOID
+VariableIndexImport (
+  IN VARIABLE_STORE_HEADER        *Store,
+  IN CONST VARIABLE_STORE_INDEX   *StoreIndex
+  )
+{
+  VARIABLE_STORE_TYPE                 StoreType;
+  VARIABLE_INDEX                      *Index;
+  CONST VARIABLE_STORE_INDEX_ENTRY    *Entry;
+  UINT32                              StartOffset;
+  UINT32                              Number;
+
+  if (!FeaturePcdGet (PcdEnableVariableHashIndex)) {
+    return;
+  }
+
+  Index = NULL;
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    if ((Store != NULL) && (mVariableIndex[StoreType].Store == Store)) {
+      Index = &mVariableIndex[StoreType];
+      break;
+    }
+  }
+
+  if ((Index == NULL) || !Index->Valid || (Index->IndexedOffset != 0) ||
+      (StoreIndex->EntryCount > Index->MaxEntries)) {
+    return;
+  }
+
+  StartOffset = (UINT32) ((UINTN) GetStartPointer (Store) - (UINTN) Store);
+  Entry       = (CONST VARIABLE_STORE_INDEX_ENTRY *) ((CONST UINT32 *) (StoreIndex + 1) + StoreIndex->BucketCount + 1);
+  for (Number = 0; Number < StoreIndex->EntryCount; Number++) {
+    VariableIndexInsert (Index, Entry[Number].Offset - StartOffset, Entry[Number].Hash);
+  }
+
+  Index->IndexedOffset = StoreIndex->EndOffset - StartOffset;
+}
+
+/**
+  Finds the variable in the specified variable store with the hash index.
+
+  It returns the same variable as the walk of the store in FindVariableEx ()
+  does, and is only a faster way to get there.
+
+  @param[in]       VariableName        Name of the variable to be found, not empty.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+  @retval          EFI_UNSUPPORTED     The searched range has no usable index,
+                                       the caller must walk the store.
+**/
+EFI_STATUS
+VariableIndexFind (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  )
+{
+  VARIABLE_STORE_TYPE   StoreType;
+  VARIABLE_INDEX        *Index;
+  VARIABLE_INDEX_ENTRY  *Entry;
+  VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *AddedVariable;
+  VARIABLE_HEADER       *InDeletedVariable;
+  UINT32                Number;
+  UINT32                Bucket;
+
+  if (!FeaturePcdGet (PcdEnableVariableHashIndex)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Only a search over a whole registered store can use its index.
+  //
+  Index = NULL;
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    if ((mVariableIndex[StoreType].Store != NULL) &&
+        (PtrTrack->StartPtr == GetStartPointer (mVariableIndex[StoreType].Store)) &&
+        (PtrTrack->EndPtr == GetEndPointer (mVariableIndex[StoreType].Store))) {
+      Index = &mVariableIndex[StoreType];
+      break;
+    }
+  }
+
+  if (Index == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  VariableIndexUpdate (Index, AuthFormat);
+  if (!Index->Valid) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Bucket = VariableIndexHash (VariableName, MAX_UINTN, VendorGuid) & Index->BucketMask;
+
+  //
+  // The walk returns the first ADDED variable in the store, and the last
+  // IN_DELETED_TRANSITION variable before it. The entries of a bucket are not
+  // sorted by offset, so find the ADDED one first.
+  //
+  AddedVariable = NULL;
+  for (Number = Index->Buckets[Bucket]; Number != 0; Number = Entry->Next) {
+    Entry    = &Index->Entries[Number - 1];
+    Variable = (VARIABLE_HEADER *) ((UINTN) PtrTrack->StartPtr + Entry->Offset);
+    if ((Variable->State == VAR_ADDED) &&
+        ((AddedVariable == NULL) || (Variable < AddedVariable)) &&
+        VariableIndexMatch (Variable, VariableName, VendorGuid, IgnoreRtCheck, AuthFormat)) {
+      AddedVariable = Variable;
+    }
+  }
+
+  InDeletedVariable = NULL;
+  for (Number = Index->Buckets[Bucket]; Number != 0; Number = Entry->Next) {
+    Entry    = &Index->Entries[Number - 1];
+    Variable = (VARIABLE_HEADER *) ((UINTN) PtrTrack->StartPtr + Entry->Offset);
+    if ((Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) &&
+        ((AddedVariable == NULL) || (Variable < AddedVariable)) &&
+        ((InDeletedVariable == NULL) || (Variable > InDeletedVariable)) &&
+        VariableIndexMatch (Variable, VariableName, VendorGuid, IgnoreRtCheck, AuthFormat)) {
+      InDeletedVariable = Variable;
+    }
+  }
+
+  if (AddedVariable != NULL) {
+    PtrTrack->CurrPtr                = AddedVariable;
+    PtrTrack->InDeletedTransitionPtr = InDeletedVariable;
+  } else {
+    PtrTrack->CurrPtr                = InDeletedVariable;
+    PtrTrack->InDeletedTransitionPtr = NULL;
+  }
+
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/** @file
+  The in-memory hash index of the variable stores, shared by the variable
+  driver and the variable runtime cache.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_INDEX_H_
+#define _VARIABLE_INDEX_H_
+
+#include "Variable.h"
+
+///
+/// Maximum number of variable headers that are not yet ADDED (their write is
+/// in progress) which may sit below the indexed offset of a store.
+///
+#define VARIABLE_INDEX_PENDING_MAX  8
+
+typedef struct {
+  ///
+  /// Offset of the variable header from the first variable of the store.
+  ///
+  UINT32                  Offset;
+  ///
+  /// One-based number of the next entry in the same bucket, 0 ends the chain.
+  ///
+  UINT32                  Next;
+} VARIABLE_INDEX_ENTRY;
+
+typedef struct {
+  ///
+  /// Variable store covered by this index, NULL if none.
+  ///
+  VARIABLE_STORE_HEADER   *Store;
+  ///
+  /// Optional counter bumped by whoever rewrites the store without telling
+  /// this index, e.g. the SMM variable driver reclaiming a runtime cache.
+  ///
+  UINT32                  *Generation;
+  UINT32                  IndexedGeneration;
+  ///
+  /// One-based entry numbers of the first entry of each bucket.
+  ///
+  UINT32                  *Buckets;
+  UINT32                  BucketMask;
+  VARIABLE_INDEX_ENTRY    *Entries;
+  UINT32                  MaxEntries;
+  UINT32                  EntryCount;
+  ///
+  /// Offset of the first variable header not parsed into the index yet.
+  ///
+  UINT32                  IndexedOffset;
+  UINT32                  PendingOffset[VARIABLE_INDEX_PENDING_MAX];
+  UINT32                  PendingCount;
+  ///
+  /// FALSE if the index overflowed, lookups walk the store until the index is
+  /// invalidated.
+  ///
+  BOOLEAN                 Valid;
+} VARIABLE_INDEX;
+
+extern VARIABLE_INDEX  mVariableIndex[VariableStoreTypeMax];
+
+/**
+  Associates a variable store with the hash index of the given store type.
+
+  The index is built lazily, the first lookup parses the variables which are
+  already present in the store. Later appends to the store are picked up by
+  the next lookup, but any other rewrite of the store (e.g. reclaim) must be
+  reported with VariableIndexInvalidate () or through Generation.
+
+  @param[in] StoreType    The type of the variable store.
+  @param[in] Store        Pointer to the variable store, NULL to detach the index
+                          from its current store.
+  @param[in] Generation   Optional pointer to a counter which is changed every
+                          time the store is rewritten.
+
+  @retval EFI_SUCCESS           The store is associated with the index.
+  @retval EFI_UNSUPPORTED       The variable hash index is disabled.
+  @retval EFI_OUT_OF_RESOURCES  No memory for the index, lookups in the store
+                                walk the store.
+
+**/
+EFI_STATUS
+VariableIndexRegisterStore (
+  IN VARIABLE_STORE_TYPE      StoreType,
+  IN VARIABLE_STORE_HEADER    *Store       OPTIONAL,
+  IN UINT32                   *Generation  OPTIONAL
+  );
+
+/**
+  Discards the index of a variable store after the store has been rewritten.
+
+  @param[in] Store        Pointer to the variable store.
+
+**/
+VOID
+VariableIndexInvalidate (
+  IN VARIABLE_STORE_HEADER    *Store
+  );
+
+/**
+  Seeds the index of a variable store with the index of the same store built
+  by the PEI variable driver, so that the first lookup does not parse it.
+
+  @param[in] Store        Pointer to the variable store, which has just been
+                          registered.
+  @param[in] StoreIndex   Pointer to the index built by the PEI variable driver,
+                          already checked against the store.
+
+**/
+VOID
+VariableIndexImport (
+  IN VARIABLE_STORE_HEADER        *Store,
+  IN CONST VARIABLE_STORE_INDEX   *StoreIndex
+  );
+
+/**
+  Finds the variable in the specified variable store with the hash index.
+
+  It returns the same variable as the walk of the store in FindVariableEx ()
+  does, and is only a faster way to get there.
+
+  @param[in]       VariableName        Name of the variable to be found, not empty.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully
+  @retval          EFI_NOT_FOUND       Variable not found
+  @retval          EFI_UNSUPPORTED     The searched range has no usable index,
+                                       the caller must walk the store.
+**/
+EFI_STATUS
+VariableIndexFind (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  );
+
+#endif
@@ -1,7 +1,7 @@
 /** @file
   Common variable non-volatile store routines.
 
-Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2019 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -73,6 +73,7 @@ InitEmuNonVolatileVariableStore (
         PcdGet64 (PcdEmuVariableNvStoreReserved);
     if ((VariableStore->Size == VariableStoreLength) &&
         (CompareGuid (&VariableStore->Signature, &gEfiAuthenticatedVariableGuid) ||
+         CompareGuid (&VariableStore->Signature, &gEdkiiCompressedVariableGuid) ||
          CompareGuid (&VariableStore->Signature, &gEfiVariableGuid)) &&
         (VariableStore->Format == VARIABLE_STORE_FORMATTED) &&
         (VariableStore->State == VARIABLE_STORE_HEALTHY)) {
@@ -272,6 +273,79 @@ InitRealNonVolatileVariableStore (
   return EFI_SUCCESS;
 }
 
+/**
+  Get the index of the non-volatile variable store built by the PEI variable
+  driver, if it indexed the same store that has been loaded in mNvVariableCache.
+
+  @return Pointer to the index, or NULL if there is no usable index for the store.
+
+**/
+VARIABLE_STORE_INDEX *
+GetPeiVariableStoreIndex (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE             *GuidHob;
+  VARIABLE_STORE_INDEX          *StoreIndex;
+  VARIABLE_STORE_INDEX_ENTRY    *Entry;
+  VARIABLE_HEADER               *Variable;
+  VARIABLE_HEADER               *EndPtr;
+  UINTN                         HobSize;
+  UINTN                         StartOffset;
+  UINT32                        Index;
+
+  GuidHob = GetFirstGuidHob (&gEdkiiVariableStoreIndexGuid);
+  if ((GuidHob == NULL) || (mNvFvHeaderCache == NULL)) {
+    return NULL;
+  }
+
+  StoreIndex = GET_GUID_HOB_DATA (GuidHob);
+  HobSize    = GET_GUID_HOB_DATA_SIZE (GuidHob);
+
+  //
+  // The index is only usable if the PEI variable driver indexed the variable
+  // store in NV storage (not a backup of it in the spare block), every variable
+  // write in the store completed, and the store has not changed since.
+  //
+  if ((HobSize < sizeof (VARIABLE_STORE_INDEX)) ||
+      (StoreIndex->BucketCount == 0) ||
+      (StoreIndex->IncompleteCount != 0) ||
+      (StoreIndex->StoreBase != NV_STORAGE_VARIABLE_BASE + mNvFvHeaderCache->HeaderLength) ||
+      (StoreIndex->StoreSize != mNvVariableCache->Size)) {
+    return NULL;
+  }
+
+  if ((StoreIndex->BucketCount >= HobSize / sizeof (UINT32)) ||
+      (StoreIndex->EntryCount > HobSize / sizeof (VARIABLE_STORE_INDEX_ENTRY)) ||
+      (HobSize < sizeof (VARIABLE_STORE_INDEX) + (StoreIndex->BucketCount + 1) * sizeof (UINT32) +
+                 StoreIndex->EntryCount * sizeof (VARIABLE_STORE_INDEX_ENTRY))) {
+    return NULL;
+  }
+
+  StartOffset = (UINTN) GetStartPointer (mNvVariableCache) - (UINTN) mNvVariableCache;
+  EndPtr      = GetEndPointer (mNvVariableCache);
+  if ((StoreIndex->EndOffset < StartOffset) ||
+      (StoreIndex->EndOffset > mNvVariableCache->Size) ||
+      IsValidVariableHeader ((VARIABLE_HEADER *) ((UINTN) mNvVariableCache + StoreIndex->EndOffset), EndPtr)) {
+    return NULL;
+  }
+
+  Entry = (VARIABLE_STORE_INDEX_ENTRY *) ((UINT32 *) (StoreIndex + 1) + StoreIndex->BucketCount + 1);
+  for (Index = 0; Index < StoreIndex->EntryCount; Index++) {
+    if ((Entry[Index].Offset < StartOffset) || (Entry[Index].Offset >= StoreIndex->EndOffset)) {
+      return NULL;
+    }
+
+    Variable = (VARIABLE_HEADER *) ((UINTN) mNvVariableCache + Entry[Index].Offset);
+    if (!IsValidVariableHeader (Variable, EndPtr) ||
+        ((Variable->State != VAR_ADDED) && (Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)))) {
+      return NULL;
+    }
+  }
+
+  return StoreIndex;
+}
+
 /**
   Init non-volatile variable store.
 
@@ -308,11 +382,29 @@ InitNonVolatileVariableStore (
 
   mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = VariableStoreBase;
   mNvVariableCache = (VARIABLE_STORE_HEADER *) (UINTN) VariableStoreBase;
-  mVariableModuleGlobal->VariableGlobal.AuthFormat = (BOOLEAN)(CompareGuid (&mNvVariableCache->Signature, &gEfiAuthenticatedVariableGuid));
+  mVariableModuleGlobal->VariableGlobal.AuthFormat = (BOOLEAN)(CompareGuid (&mNvVariableCache->Signature, &gEfiAuthenticatedVariableGuid) ||
+                                                               CompareGuid (&mNvVariableCache->Signature, &gEdkiiCompressedVariableGuid));
 
   mVariableModuleGlobal->MaxVariableSize = PcdGet32 (PcdMaxVariableSize);
   mVariableModuleGlobal->MaxAuthVariableSize = ((PcdGet32 (PcdMaxAuthVariableSize) != 0) ? PcdGet32 (PcdMaxAuthVariableSize) : mVariableModuleGlobal->MaxVariableSize);
 
+  //
+  // The PEI variable driver may have parsed the store already, take the
+  // variable sizes and the last variable offset from its index.
+  //
+  mNvVariableStoreIndex = NULL;
+  if (!mVariableModuleGlobal->VariableGlobal.EmuNvMode) {
+    mNvVariableStoreIndex = GetPeiVariableStoreIndex ();
+  }
+
+  if (mNvVariableStoreIndex != NULL) {
+    mVariableModuleGlobal->HwErrVariableTotalSize        = mNvVariableStoreIndex->HwErrVariableTotalSize;
+    mVariableModuleGlobal->CommonVariableTotalSize       = mNvVariableStoreIndex->CommonVariableTotalSize;
+    mVariableModuleGlobal->NonVolatileLastVariableOffset = mNvVariableStoreIndex->EndOffset;
+    DEBUG ((DEBUG_INFO, "Variable driver uses the PEI index of %d variables\n", mNvVariableStoreIndex->EntryCount));
+    return EFI_SUCCESS;
+  }
+
   //
   // Parse non-volatile variable data and get last variable offset.
   //
@@ -1,7 +1,7 @@
 /** @file
   Common variable non-volatile store routines.
 
-Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2019 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -51,6 +51,18 @@ InitRealNonVolatileVariableStore (
   OUT EFI_PHYSICAL_ADDRESS              *VariableStoreBase
   );
 
+/**
+  Get the index of the non-volatile variable store built by the PEI variable
+  driver, if it indexed the same store that has been loaded in mNvVariableCache.
+
+  @return Pointer to the index, or NULL if there is no usable index for the store.
+
+**/
+VARIABLE_STORE_INDEX *
+GetPeiVariableStoreIndex (
+  VOID
+  );
+
 /**
   Init non-volatile variable store.
 
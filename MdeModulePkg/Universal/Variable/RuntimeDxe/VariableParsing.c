@@ -2,12 +2,31 @@
   Functions in this module are associated with variable parsing operations and
   are intended to be usable across variable driver source files.
 
-Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2019 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 
 #include "VariableParsing.h"
+#include "VariableIndex.h"
+
+typedef struct {
+  ///
+  /// Variable store holding the variable, NULL if there is none.
+  ///
+  VARIABLE_STORE_HEADER   *Store;
+  ///
+  /// Offset of the variable header from the first variable of the store.
+  ///
+  UINTN                   Offset;
+} VARIABLE_NEXT_CURSOR;
+
+///
+/// The variable returned by the last VariableServiceGetNextVariableInternal ()
+/// call. A caller enumerating the variables passes it back in the next call,
+/// which then resumes the walk from there instead of searching for it.
+///
+STATIC VARIABLE_NEXT_CURSOR  mNextVariableCursor;
 
 /**
 
@@ -54,6 +73,7 @@ GetVariableStoreStatus (
   )
 {
   if ((CompareGuid (&VarStoreHeader->Signature, &gEfiAuthenticatedVariableGuid) ||
+       CompareGuid (&VarStoreHeader->Signature, &gEdkiiCompressedVariableGuid) ||
        CompareGuid (&VarStoreHeader->Signature, &gEfiVariableGuid)) &&
       VarStoreHeader->Format == VARIABLE_STORE_FORMATTED &&
       VarStoreHeader->State == VARIABLE_STORE_HEALTHY
@@ -460,9 +480,17 @@ FindVariableEx (
   IN     BOOLEAN                 AuthFormat
   )
 {
+  EFI_STATUS                     Status;
   VARIABLE_HEADER                *InDeletedVariable;
   VOID                           *Point;
 
+  if (VariableName[0] != 0) {
+    Status = VariableIndexFind (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack, AuthFormat);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+  }
+
   PtrTrack->InDeletedTransitionPtr = NULL;
 
   //
@@ -508,6 +536,100 @@ FindVariableEx (
   return (PtrTrack->CurrPtr  == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
 }
 
+/**
+  Forgets the variable from which VariableServiceGetNextVariableInternal ()
+  would resume, after the variable store holding it has been rewritten.
+
+  @param[in] Store        Pointer to the rewritten variable store, NULL if any
+                          store may have been rewritten.
+
+**/
+VOID
+ResetNextVariableCursor (
+  IN VARIABLE_STORE_HEADER    *Store  OPTIONAL
+  )
+{
+  if ((Store == NULL) || (mNextVariableCursor.Store == Store)) {
+    mNextVariableCursor.Store = NULL;
+  }
+}
+
+/**
+  Finds the variable returned by the last VariableServiceGetNextVariableInternal ()
+  call, if the caller asks for the variable after that one.
+
+  The variable found is the one FindVariableEx () would find: it is the only
+  ADDED variable with its name and GUID in the store, and the previous call has
+  already checked that no HOB variable overrides it.
+
+  @param[in]  VariableName      Pointer to variable name.
+  @param[in]  VendorGuid        Variable Vendor Guid.
+  @param[in]  VariableStoreList A list of variable stores that should be used to get the next variable.
+  @param[out] PtrTrack          Variable Track Pointer structure that contains Variable Information.
+  @param[in]  AuthFormat        TRUE indicates authenticated variables are used.
+                                FALSE indicates authenticated variables are not used.
+
+  @retval EFI_SUCCESS           The variable is found at the cursor.
+  @retval EFI_NOT_FOUND         The cursor does not hold the variable, the caller
+                                must search for it.
+
+**/
+STATIC
+EFI_STATUS
+FindVariableAtNextVariableCursor (
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  IN  VARIABLE_STORE_HEADER   **VariableStoreList,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN  BOOLEAN                 AuthFormat
+  )
+{
+  VARIABLE_STORE_TYPE     StoreType;
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *StoreEnd;
+  UINTN                   NameSize;
+
+  if ((mNextVariableCursor.Store == NULL) || (VariableName[0] == 0) || (VendorGuid == NULL)) {
+    return EFI_NOT_FOUND;
+  }
+
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    if (VariableStoreList[StoreType] == mNextVariableCursor.Store) {
+      break;
+    }
+  }
+  if (StoreType == VariableStoreTypeMax) {
+    return EFI_NOT_FOUND;
+  }
+
+  StoreEnd = GetEndPointer (mNextVariableCursor.Store);
+  Variable = (VARIABLE_HEADER *) ((UINTN) GetStartPointer (mNextVariableCursor.Store) + mNextVariableCursor.Offset);
+  if (((UINTN) StoreEnd - (UINTN) Variable < GetVariableHeaderSize (AuthFormat)) ||
+      !IsValidVariableHeader (Variable, StoreEnd) ||
+      (Variable->State != VAR_ADDED)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (AtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+    return EFI_NOT_FOUND;
+  }
+
+  NameSize = NameSizeOfVariable (Variable, AuthFormat);
+  if ((NameSize == 0) ||
+      ((UINTN) StoreEnd - (UINTN) GetVariableNamePtr (Variable, AuthFormat) < NameSize) ||
+      !CompareGuid (VendorGuid, GetVendorGuidPtr (Variable, AuthFormat)) ||
+      (CompareMem (VariableName, GetVariableNamePtr (Variable, AuthFormat), NameSize) != 0)) {
+    return EFI_NOT_FOUND;
+  }
+
+  PtrTrack->StartPtr               = GetStartPointer (mNextVariableCursor.Store);
+  PtrTrack->EndPtr                 = StoreEnd;
+  PtrTrack->CurrPtr                = Variable;
+  PtrTrack->InDeletedTransitionPtr = NULL;
+  PtrTrack->Volatile               = (BOOLEAN) (StoreType == VariableStoreTypeVolatile);
+  return EFI_SUCCESS;
+}
+
 /**
   This code finds the next available variable.
 
@@ -553,8 +675,13 @@ VariableServiceGetNextVariableInternal (
 
   ZeroMem (&Variable, sizeof (Variable));
 
+  //
+  // An enumeration passes back the variable returned by the previous call.
+  //
+  Status = FindVariableAtNextVariableCursor (VariableName, VendorGuid, VariableStoreList, &Variable, AuthFormat);
+
   // Check if the variable exists in the given variable store list
-  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; EFI_ERROR (Status) && (StoreType < VariableStoreTypeMax); StoreType++) {
     if (VariableStoreList[StoreType] == NULL) {
       continue;
     }
@@ -678,6 +805,17 @@ VariableServiceGetNextVariableInternal (
 
         *VariablePtr = Variable.CurrPtr;
         Status = EFI_SUCCESS;
+
+        //
+        // Remember the variable for the next call of the enumeration.
+        //
+        for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+          if ((VariableStoreList[StoreType] != NULL) && (Variable.StartPtr == GetStartPointer (VariableStoreList[StoreType]))) {
+            mNextVariableCursor.Store  = VariableStoreList[StoreType];
+            mNextVariableCursor.Offset = (UINTN) Variable.CurrPtr - (UINTN) Variable.StartPtr;
+            break;
+          }
+        }
         goto Done;
       }
     }
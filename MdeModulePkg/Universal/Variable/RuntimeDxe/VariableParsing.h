@@ -2,7 +2,7 @@
   Functions in this module are associated with variable parsing operations and
   are intended to be usable across variable driver source files.
 
-Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2019 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -280,6 +280,19 @@ FindVariableEx (
   IN     BOOLEAN                 AuthFormat
   );
 
+/**
+  Forgets the variable from which VariableServiceGetNextVariableInternal ()
+  would resume, after the variable store holding it has been rewritten.
+
+  @param[in] Store        Pointer to the rewritten variable store, NULL if any
+                          store may have been rewritten.
+
+**/
+VOID
+ResetNextVariableCursor (
+  IN VARIABLE_STORE_HEADER    *Store  OPTIONAL
+  );
+
 /**
   This code finds the next available variable.
 
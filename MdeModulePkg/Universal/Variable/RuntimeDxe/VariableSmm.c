@@ -14,7 +14,7 @@
   VariableServiceSetVariable(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
   SmmVariableGetStatistics() should also do validation based on its own knowledge.
 
-Copyright (c) 2010 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2020, Intel Corporation. All rights reserved.<BR>
 Copyright (c) 2018, Linaro, Ltd. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -424,6 +424,95 @@ SmmVariableGetStatistics (
   return EFI_SUCCESS;
 }
 
+/**
+  Performs the operations of a SMM_VARIABLE_FUNCTION_BATCH request, in order.
+
+  Caution: This function may receive untrusted input.
+  The request is external input, so the layout of all the entries is validated
+  before any operation is performed.
+
+  @param[in, out] Payload       The request, copied out of the communicate buffer.
+                                The results of the operations are written to it.
+  @param[in]      PayloadSize   The size of the request.
+
+  @retval EFI_SUCCESS           All the operations were performed. The status of
+                                each one is in its ReturnStatus.
+  @retval EFI_ACCESS_DENIED     The request is malformed, no operation was performed.
+
+**/
+EFI_STATUS
+SmmVariableBatch (
+  IN OUT UINT8                                            *Payload,
+  IN     UINTN                                            PayloadSize
+  )
+{
+  SMM_VARIABLE_COMMUNICATE_BATCH                          *Batch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY                    *Entry;
+  UINTN                                                   Index;
+  UINTN                                                   Offset;
+  UINTN                                                   InfoSize;
+  UINTN                                                   DataSize;
+
+  Batch = (SMM_VARIABLE_COMMUNICATE_BATCH *) Payload;
+
+  Offset = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  for (Index = 0; Index < Batch->Count; Index++) {
+    if (Offset > PayloadSize ||
+        PayloadSize - Offset < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY, Variable.Name)) {
+      return EFI_ACCESS_DENIED;
+    }
+    Entry    = (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY *) (Payload + Offset);
+    InfoSize = PayloadSize - Offset - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY, Variable.Name);
+    if (Entry->Variable.NameSize > InfoSize || Entry->Variable.DataSize > InfoSize - Entry->Variable.NameSize) {
+      return EFI_ACCESS_DENIED;
+    }
+    Offset += SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY_SIZE (Entry->Variable.NameSize, Entry->Variable.DataSize);
+  }
+
+  //
+  // The VariableSpeculationBarrier() call here is to ensure the previous
+  // range checks for the entries have been completed before the subsequent
+  // consumption of their content.
+  //
+  VariableSpeculationBarrier ();
+
+  Offset = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  for (Index = 0; Index < Batch->Count; Index++) {
+    Entry = (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY *) (Payload + Offset);
+    //
+    // GetVariable() updates DataSize, the entry keeps the size it was sent with.
+    //
+    DataSize = Entry->Variable.DataSize;
+    if (Entry->Variable.NameSize < sizeof (CHAR16) ||
+        Entry->Variable.Name[Entry->Variable.NameSize / sizeof (CHAR16) - 1] != L'\0') {
+      //
+      // Make sure VariableName is A Null-terminated string.
+      //
+      Entry->ReturnStatus = EFI_ACCESS_DENIED;
+    } else if (Entry->Function == SMM_VARIABLE_FUNCTION_GET_VARIABLE) {
+      Entry->ReturnStatus = VariableServiceGetVariable (
+                              Entry->Variable.Name,
+                              &Entry->Variable.Guid,
+                              &Entry->Variable.Attributes,
+                              &Entry->Variable.DataSize,
+                              (UINT8 *) Entry->Variable.Name + Entry->Variable.NameSize
+                              );
+    } else if (Entry->Function == SMM_VARIABLE_FUNCTION_SET_VARIABLE) {
+      Entry->ReturnStatus = VariableServiceSetVariable (
+                              Entry->Variable.Name,
+                              &Entry->Variable.Guid,
+                              Entry->Variable.Attributes,
+                              Entry->Variable.DataSize,
+                              (UINT8 *) Entry->Variable.Name + Entry->Variable.NameSize
+                              );
+    } else {
+      Entry->ReturnStatus = EFI_UNSUPPORTED;
+    }
+    Offset += SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY_SIZE (Entry->Variable.NameSize, DataSize);
+  }
+
+  return EFI_SUCCESS;
+}
 
 /**
   Communication service SMI Handler entry.
@@ -821,7 +910,8 @@ SmmVariableHandler (
           RuntimeVariableCacheContext->RuntimeNvCache == NULL ||
           RuntimeVariableCacheContext->PendingUpdate == NULL ||
           RuntimeVariableCacheContext->ReadLock == NULL ||
-          RuntimeVariableCacheContext->HobFlushComplete == NULL) {
+          RuntimeVariableCacheContext->HobFlushComplete == NULL ||
+          RuntimeVariableCacheContext->StoreGeneration == NULL) {
         DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Required runtime cache buffer is NULL!\n"));
         Status = EFI_ACCESS_DENIED;
         goto EXIT;
@@ -885,6 +975,13 @@ SmmVariableHandler (
         Status = EFI_ACCESS_DENIED;
         goto EXIT;
       }
+      if (!VariableSmmIsBufferOutsideSmmValid (
+            (UINTN) RuntimeVariableCacheContext->StoreGeneration,
+            sizeof (*(RuntimeVariableCacheContext->StoreGeneration)))) {
+        DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Runtime cache store generation buffer in SMRAM or overflow!\n"));
+        Status = EFI_ACCESS_DENIED;
+        goto EXIT;
+      }
 
       VariableCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
       VariableCacheContext->VariableRuntimeHobCache.Store      = RuntimeVariableCacheContext->RuntimeHobCache;
@@ -893,6 +990,7 @@ SmmVariableHandler (
       VariableCacheContext->PendingUpdate                      = RuntimeVariableCacheContext->PendingUpdate;
       VariableCacheContext->ReadLock                           = RuntimeVariableCacheContext->ReadLock;
       VariableCacheContext->HobFlushComplete                   = RuntimeVariableCacheContext->HobFlushComplete;
+      VariableCacheContext->StoreGeneration                    = RuntimeVariableCacheContext->StoreGeneration;
 
       // Set up the intial pending request since the RT cache needs to be in sync with SMM cache
       VariableCacheContext->VariableRuntimeHobCache.PendingUpdateOffset = 0;
@@ -945,6 +1043,21 @@ SmmVariableHandler (
       Status = EFI_SUCCESS;
       break;
 
+    case SMM_VARIABLE_FUNCTION_BATCH:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_BATCH)) {
+        DEBUG ((DEBUG_ERROR, "VariableBatch: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      //
+      // Copy the input communicate buffer payload to pre-allocated SMM variable buffer payload.
+      //
+      CopyMem (mVariableBufferPayload, SmmVariableFunctionHeader->Data, CommBufferPayloadSize);
+      Status = SmmVariableBatch (mVariableBufferPayload, CommBufferPayloadSize);
+      if (!EFI_ERROR (Status)) {
+        CopyMem (SmmVariableFunctionHeader->Data, mVariableBufferPayload, CommBufferPayloadSize);
+      }
+      break;
+
     default:
       Status = EFI_UNSUPPORTED;
   }
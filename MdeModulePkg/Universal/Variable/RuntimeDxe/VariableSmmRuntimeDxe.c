@@ -8,12 +8,12 @@
   This external input must be validated carefully to avoid security issue like
   buffer overflow, integer overflow.
 
-  RuntimeServiceGetVariable() and RuntimeServiceSetVariable() are external API
-  to receive data buffer. The size should be checked carefully.
+  RuntimeServiceGetVariable(), RuntimeServiceSetVariable() and VariableBatchExecute()
+  are external API to receive data buffer. The size should be checked carefully.
 
   InitCommunicateBuffer() is really function to check the variable data size.
 
-Copyright (c) 2010 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2010 - 2020, Intel Corporation. All rights reserved.<BR>
 Copyright (c) Microsoft Corporation.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -25,6 +25,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmVariable.h>
 #include <Protocol/VariableLock.h>
 #include <Protocol/VarCheck.h>
+#include <Protocol/VariableBatch.h>
 
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -35,12 +36,16 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/UefiLib.h>
 #include <Library/BaseLib.h>
+#include <Library/PerformanceLib.h>
 
 #include <Guid/EventGroup.h>
 #include <Guid/SmmVariableCommon.h>
+#include <Guid/VariableWriteEventGroup.h>
 
 #include "PrivilegePolymorphic.h"
 #include "VariableParsing.h"
+#include "VariableIndex.h"
+#include "VariableCompress.h"
 
 EFI_HANDLE                       mHandle                    = NULL;
 EFI_SMM_VARIABLE_PROTOCOL       *mSmmVariable               = NULL;
@@ -61,9 +66,12 @@ BOOLEAN                          mVariableRuntimeCachePendingUpdate;
 BOOLEAN                          mVariableRuntimeCacheReadLock;
 BOOLEAN                          mVariableAuthFormat;
 BOOLEAN                          mHobFlushComplete;
+UINT32                           mVariableRuntimeCacheStoreGeneration;
+UINT32                           mVariableRuntimeCacheCursorGeneration;
 EFI_LOCK                         mVariableServicesLock;
 EDKII_VARIABLE_LOCK_PROTOCOL     mVariableLock;
 EDKII_VAR_CHECK_PROTOCOL         mVarCheck;
+EDKII_VARIABLE_BATCH_PROTOCOL    mVariableBatch;
 
 /**
   Some Secure Boot Policy Variable may update following other variable changes(SecureBoot follows PK change, etc).
@@ -552,6 +560,7 @@ CheckForRuntimeCacheSync (
       FreePages (mVariableRuntimeHobCacheBuffer, EFI_SIZE_TO_PAGES (mVariableRuntimeHobCacheBufferSize));
     }
     mVariableRuntimeHobCacheBuffer = NULL;
+    VariableIndexRegisterStore (VariableStoreTypeHob, NULL, NULL);
   }
 }
 
@@ -636,7 +645,7 @@ FindVariableInRuntimeCache (
       //
       // Get data size
       //
-      TempDataSize = DataSizeOfVariable (RtPtrTrack.CurrPtr, mVariableAuthFormat);
+      TempDataSize = GetVariableDataSize (RtPtrTrack.CurrPtr, mVariableAuthFormat);
       ASSERT (TempDataSize != 0);
 
       if (*DataSize >= TempDataSize) {
@@ -645,7 +654,10 @@ FindVariableInRuntimeCache (
           goto Done;
         }
 
-        CopyMem (Data, GetVariableDataPtr (RtPtrTrack.CurrPtr, mVariableAuthFormat), TempDataSize);
+        if (EFI_ERROR (ReadVariableData (RtPtrTrack.CurrPtr, mVariableAuthFormat, Data))) {
+          Status = EFI_DEVICE_ERROR;
+          goto Done;
+        }
         *DataSize = TempDataSize;
 
         UpdateVariableInfo (VariableName, VendorGuid, RtPtrTrack.Volatile, TRUE, FALSE, FALSE, TRUE, &mVariableInfo);
@@ -877,6 +889,15 @@ GetNextVariableNameInRuntimeCache (
     VariableStoreHeader[VariableStoreTypeHob]      = mVariableRuntimeHobCacheBuffer;
     VariableStoreHeader[VariableStoreTypeNv]       = mVariableRuntimeNvCacheBuffer;
 
+    //
+    // The SMM variable driver rewrites the caches on reclaim, so the variable
+    // at which the enumeration stopped may no longer be there.
+    //
+    if (mVariableRuntimeCacheCursorGeneration != mVariableRuntimeCacheStoreGeneration) {
+      ResetNextVariableCursor (NULL);
+      mVariableRuntimeCacheCursorGeneration = mVariableRuntimeCacheStoreGeneration;
+    }
+
     Status =  VariableServiceGetNextVariableInternal (
                 VariableName,
                 VendorGuid,
@@ -1055,7 +1076,10 @@ RuntimeServiceGetNextVariableName (
 }
 
 /**
-  This code sets variable in storage blocks (Volatile or Non-Volatile).
+  Sets a variable in a variable store in SMM.
+
+  The caller holds mVariableServicesLock and has checked that VariableName,
+  VendorGuid and Data are valid.
 
   Caution: This function may receive untrusted input.
   The data size and data are external input, so this function will validate it carefully to avoid buffer overflow.
@@ -1075,8 +1099,7 @@ RuntimeServiceGetNextVariableName (
 
 **/
 EFI_STATUS
-EFIAPI
-RuntimeServiceSetVariable (
+SetVariableInSmm (
   IN CHAR16                                 *VariableName,
   IN EFI_GUID                               *VendorGuid,
   IN UINT32                                 Attributes,
@@ -1089,17 +1112,6 @@ RuntimeServiceSetVariable (
   SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE  *SmmVariableHeader;
   UINTN                                     VariableNameSize;
 
-  //
-  // Check input parameters.
-  //
-  if (VariableName == NULL || VariableName[0] == 0 || VendorGuid == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (DataSize != 0 && Data == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
-
   VariableNameSize      = StrSize (VariableName);
   SmmVariableHeader     = NULL;
 
@@ -1111,8 +1123,6 @@ RuntimeServiceSetVariable (
     return EFI_INVALID_PARAMETER;
   }
 
-  AcquireLockOnlyAtBootTime(&mVariableServicesLock);
-
   //
   // Init the communicate buffer. The buffer data size is:
   // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
@@ -1120,7 +1130,7 @@ RuntimeServiceSetVariable (
   PayloadSize = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name) + VariableNameSize + DataSize;
   Status = InitCommunicateBuffer ((VOID **)&SmmVariableHeader, PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE);
   if (EFI_ERROR (Status)) {
-    goto Done;
+    return Status;
   }
   ASSERT (SmmVariableHeader != NULL);
 
@@ -1134,9 +1144,54 @@ RuntimeServiceSetVariable (
   //
   // Send data to SMM.
   //
-  Status = SendCommunicateBuffer (PayloadSize);
+  return SendCommunicateBuffer (PayloadSize);
+}
 
-Done:
+/**
+  This code sets variable in storage blocks (Volatile or Non-Volatile).
+
+  Caution: This function may receive untrusted input.
+  The data size and data are external input, so this function will validate it carefully to avoid buffer overflow.
+
+  @param[in] VariableName                 Name of Variable to be found.
+  @param[in] VendorGuid                   Variable vendor GUID.
+  @param[in] Attributes                   Attribute value of the variable found
+  @param[in] DataSize                     Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param[in] Data                         Data pointer.
+
+  @retval EFI_INVALID_PARAMETER           Invalid parameter.
+  @retval EFI_SUCCESS                     Set successfully.
+  @retval EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
+  @retval EFI_NOT_FOUND                   Not found.
+  @retval EFI_WRITE_PROTECTED             Variable is read-only.
+
+**/
+EFI_STATUS
+EFIAPI
+RuntimeServiceSetVariable (
+  IN CHAR16                                 *VariableName,
+  IN EFI_GUID                               *VendorGuid,
+  IN UINT32                                 Attributes,
+  IN UINTN                                  DataSize,
+  IN VOID                                   *Data
+  )
+{
+  EFI_STATUS                                Status;
+
+  //
+  // Check input parameters.
+  //
+  if (VariableName == NULL || VariableName[0] == 0 || VendorGuid == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (DataSize != 0 && Data == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  AcquireLockOnlyAtBootTime(&mVariableServicesLock);
+  Status = SetVariableInSmm (VariableName, VendorGuid, Attributes, DataSize, Data);
   ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
 
   if (!EfiAtRuntime ()) {
@@ -1145,11 +1200,306 @@ Done:
         VariableName,
         VendorGuid
         );
+      if (IsVariableWriteEventNeeded (VendorGuid)) {
+        EfiEventGroupSignal (&gEdkiiVariableWriteEventGroupGuid);
+      }
     }
   }
   return Status;
 }
 
+/**
+  Gets the size of a batch entry in the communicate buffer.
+
+  @param[in]  Entry               The batch entry.
+  @param[out] NameSize            The size of the variable name.
+  @param[out] DataSize            The size of the data area of the entry.
+
+  @return The size of the entry, or 0 if it does not fit in the communicate buffer.
+
+**/
+UINTN
+GetVariableBatchEntrySize (
+  IN  EDKII_VARIABLE_BATCH_ENTRY            *Entry,
+  OUT UINTN                                 *NameSize,
+  OUT UINTN                                 *DataSize
+  )
+{
+  UINTN                                     MaxSize;
+
+  MaxSize   = mVariableBufferPayloadSize - sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  *NameSize = StrSize (Entry->VariableName);
+  *DataSize = Entry->DataSize;
+  if (*NameSize > MaxSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY, Variable.Name) ||
+      *DataSize > MaxSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY, Variable.Name) - *NameSize ||
+      SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY_SIZE (*NameSize, *DataSize) > MaxSize) {
+    return 0;
+  }
+
+  return SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY_SIZE (*NameSize, *DataSize);
+}
+
+/**
+  Sends the operations packed in the communicate buffer to SMM, and copies
+  their results to the batch entries they were packed from.
+
+  @param[in]      PackedCount     The number of operations packed.
+  @param[in]      PayloadSize     The size of the packed operations.
+  @param[in, out] Entries         The batch entries, starting with the first packed one.
+                                  The packed entries have the status EFI_NOT_STARTED.
+  @param[in]      Count           The number of entries, up to the last packed one.
+
+**/
+VOID
+SendVariableBatch (
+  IN     UINTN                              PackedCount,
+  IN     UINTN                              PayloadSize,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY         *Entries,
+  IN     UINTN                              Count
+  )
+{
+  EFI_STATUS                                Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH            *Batch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY      *SmmEntry;
+  EDKII_VARIABLE_BATCH_ENTRY                *Entry;
+  UINTN                                     Index;
+  UINTN                                     Offset;
+  UINTN                                     NameSize;
+  UINTN                                     DataSize;
+
+  Batch = NULL;
+  Status = InitCommunicateBuffer ((VOID **) &Batch, PayloadSize, SMM_VARIABLE_FUNCTION_BATCH);
+  ASSERT_EFI_ERROR (Status);
+  ASSERT (Batch != NULL);
+  Batch->Count = PackedCount;
+
+  //
+  // Send data to SMM.
+  //
+  Status = SendCommunicateBuffer (PayloadSize);
+
+  Offset = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  for (Index = 0; Index < Count; Index++) {
+    Entry = &Entries[Index];
+    if (Entry->Status != EFI_NOT_STARTED) {
+      continue;
+    }
+    SmmEntry = (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY *) ((UINT8 *) Batch + Offset);
+    Offset  += GetVariableBatchEntrySize (Entry, &NameSize, &DataSize);
+
+    if (EFI_ERROR (Status)) {
+      Entry->Status = Status;
+      continue;
+    }
+    Entry->Status = SmmEntry->ReturnStatus;
+    if (Entry->Operation == EdkiiVariableBatchGet &&
+        (Entry->Status == EFI_SUCCESS || Entry->Status == EFI_BUFFER_TOO_SMALL)) {
+      Entry->DataSize   = SmmEntry->Variable.DataSize;
+      Entry->Attributes = SmmEntry->Variable.Attributes;
+      if (Entry->Status == EFI_SUCCESS) {
+        if (Entry->Data == NULL) {
+          Entry->Status = EFI_INVALID_PARAMETER;
+        } else {
+          CopyMem (Entry->Data, (UINT8 *) SmmEntry->Variable.Name + NameSize, Entry->DataSize);
+        }
+      }
+    }
+  }
+}
+
+/**
+  Performs the variable operations in Entries, in order.
+
+  The operations are packed in the communicate buffer and sent to SMM in as few
+  SMIs as fit. A GetVariable() with no SetVariable() packed ahead of it is
+  served from the runtime cache when it is enabled. An operation that does not
+  fit in a batch on its own is sent alone.
+
+  Caution: This function may receive untrusted input.
+  The data size and data are external input, so this function will validate it carefully to avoid buffer overflow.
+
+  @param[in]      This            A pointer to the calling context.
+  @param[in]      Count           The number of entries in Entries.
+  @param[in, out] Entries         The operations to perform. The Status of each
+                                  entry is set on return.
+
+  @retval EFI_SUCCESS             All the operations were performed.
+  @retval EFI_INVALID_PARAMETER   Count is not 0 and Entries is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchExecute (
+  IN     EDKII_VARIABLE_BATCH_PROTOCOL      *This,
+  IN     UINTN                              Count,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY         *Entries
+  )
+{
+  EFI_STATUS                                Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH            *Batch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY      *SmmEntry;
+  EDKII_VARIABLE_BATCH_ENTRY                *Entry;
+  UINTN                                     Index;
+  UINTN                                     First;
+  UINTN                                     PackedCount;
+  UINTN                                     PayloadSize;
+  UINTN                                     EntrySize;
+  UINTN                                     NameSize;
+  UINTN                                     DataSize;
+  UINTN                                     SmiCount;
+  BOOLEAN                                   SetPending;
+  BOOLEAN                                   SignalWrite;
+
+  if (Count != 0 && Entries == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Record the wall time of the batch, SMIs included, at boot time.
+  //
+  if (!EfiAtRuntime ()) {
+    PERF_INMODULE_BEGIN ("VariableBatch");
+  }
+
+  AcquireLockOnlyAtBootTime (&mVariableServicesLock);
+
+  Batch = NULL;
+  Status = InitCommunicateBuffer ((VOID **) &Batch, 0, SMM_VARIABLE_FUNCTION_BATCH);
+  ASSERT_EFI_ERROR (Status);
+  ASSERT (Batch != NULL);
+
+  First       = 0;
+  PackedCount = 0;
+  PayloadSize = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+  SmiCount    = 0;
+  SetPending  = FALSE;
+  for (Index = 0; Index < Count; Index++) {
+    Entry = &Entries[Index];
+
+    //
+    // Check input parameters, as GetVariable() and SetVariable() do.
+    //
+    if (Entry->VariableName == NULL || Entry->VendorGuid == NULL) {
+      Entry->Status = EFI_INVALID_PARAMETER;
+      continue;
+    }
+    if (Entry->Operation == EdkiiVariableBatchGet) {
+      if (Entry->VariableName[0] == 0) {
+        Entry->Status = EFI_NOT_FOUND;
+        continue;
+      }
+      if (FeaturePcdGet (PcdEnableVariableRuntimeCache) && !SetPending) {
+        //
+        // Every SetVariable() ahead of it has completed, the runtime cache is up to date.
+        //
+        Entry->Status = FindVariableInRuntimeCache (
+                          Entry->VariableName,
+                          Entry->VendorGuid,
+                          &Entry->Attributes,
+                          &Entry->DataSize,
+                          Entry->Data
+                          );
+        continue;
+      }
+    } else if (Entry->Operation == EdkiiVariableBatchSet) {
+      if (Entry->VariableName[0] == 0 || (Entry->DataSize != 0 && Entry->Data == NULL)) {
+        Entry->Status = EFI_INVALID_PARAMETER;
+        continue;
+      }
+    } else {
+      Entry->Status = EFI_UNSUPPORTED;
+      continue;
+    }
+
+    EntrySize = GetVariableBatchEntrySize (Entry, &NameSize, &DataSize);
+    if (EntrySize == 0 || EntrySize > mVariableBufferPayloadSize - PayloadSize) {
+      if (PackedCount != 0) {
+        SendVariableBatch (PackedCount, PayloadSize, &Entries[First], Index - First);
+        SmiCount++;
+        First       = Index;
+        PackedCount = 0;
+        PayloadSize = sizeof (SMM_VARIABLE_COMMUNICATE_BATCH);
+        SetPending  = FALSE;
+      }
+      if (EntrySize == 0) {
+        //
+        // It does not fit in a batch, send it alone. FindVariableInSmm() trims
+        // the output buffer to what fits in the communicate buffer.
+        //
+        if (Entry->Operation == EdkiiVariableBatchGet) {
+          Entry->Status = FindVariableInSmm (
+                            Entry->VariableName,
+                            Entry->VendorGuid,
+                            &Entry->Attributes,
+                            &Entry->DataSize,
+                            Entry->Data
+                            );
+        } else {
+          Entry->Status = SetVariableInSmm (
+                            Entry->VariableName,
+                            Entry->VendorGuid,
+                            Entry->Attributes,
+                            Entry->DataSize,
+                            Entry->Data
+                            );
+        }
+        SmiCount++;
+        First = Index + 1;
+        continue;
+      }
+    }
+
+    SmmEntry = (SMM_VARIABLE_COMMUNICATE_BATCH_ENTRY *) ((UINT8 *) Batch + PayloadSize);
+    CopyGuid (&SmmEntry->Variable.Guid, Entry->VendorGuid);
+    SmmEntry->ReturnStatus        = EFI_NOT_STARTED;
+    SmmEntry->Variable.DataSize   = DataSize;
+    SmmEntry->Variable.NameSize   = NameSize;
+    CopyMem (SmmEntry->Variable.Name, Entry->VariableName, NameSize);
+    if (Entry->Operation == EdkiiVariableBatchGet) {
+      SmmEntry->Function            = SMM_VARIABLE_FUNCTION_GET_VARIABLE;
+      SmmEntry->Variable.Attributes = 0;
+    } else {
+      SmmEntry->Function            = SMM_VARIABLE_FUNCTION_SET_VARIABLE;
+      SmmEntry->Variable.Attributes = Entry->Attributes;
+      CopyMem ((UINT8 *) SmmEntry->Variable.Name + NameSize, Entry->Data, DataSize);
+      SetPending = TRUE;
+    }
+    Entry->Status = EFI_NOT_STARTED;
+    PackedCount++;
+    PayloadSize += EntrySize;
+  }
+
+  if (PackedCount != 0) {
+    SendVariableBatch (PackedCount, PayloadSize, &Entries[First], Count - First);
+    SmiCount++;
+  }
+
+  ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+
+  DEBUG ((DEBUG_VERBOSE, "VariableBatch: %Lu operations in %Lu SMIs\n", (UINT64) Count, (UINT64) SmiCount));
+
+  if (!EfiAtRuntime ()) {
+    PERF_INMODULE_END ("VariableBatch");
+
+    SignalWrite = FALSE;
+    for (Index = 0; Index < Count; Index++) {
+      if (Entries[Index].Operation == EdkiiVariableBatchSet && !EFI_ERROR (Entries[Index].Status)) {
+        SecureBootHook (
+          Entries[Index].VariableName,
+          Entries[Index].VendorGuid
+          );
+        if (IsVariableWriteEventNeeded (Entries[Index].VendorGuid)) {
+          SignalWrite = TRUE;
+        }
+      }
+    }
+    if (SignalWrite) {
+      EfiEventGroupSignal (&gEdkiiVariableWriteEventGroupGuid);
+    }
+  }
+  return EFI_SUCCESS;
+}
+
 
 /**
   This code returns information about the EFI variables.
@@ -1311,11 +1661,24 @@ VariableAddressChangeEvent (
   IN VOID                                   *Context
   )
 {
+  VARIABLE_STORE_TYPE   StoreType;
+
   EfiConvertPointer (0x0, (VOID **) &mVariableBuffer);
   EfiConvertPointer (0x0, (VOID **) &mMmCommunication2);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeHobCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeNvCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeVolatileCacheBuffer);
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Store);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Generation);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Buckets);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Entries);
+  }
+  EfiConvertList (0x0, &mVariableDecompressCache.Entries);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Store);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Generation);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Scratch);
+  EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableDecompressCache.Spare);
 }
 
 /**
@@ -1524,6 +1887,7 @@ SendRuntimeVariableCacheContextToSmm (
   SmmRuntimeVarCacheContext->PendingUpdate = &mVariableRuntimeCachePendingUpdate;
   SmmRuntimeVarCacheContext->ReadLock = &mVariableRuntimeCacheReadLock;
   SmmRuntimeVarCacheContext->HobFlushComplete = &mHobFlushComplete;
+  SmmRuntimeVarCacheContext->StoreGeneration = &mVariableRuntimeCacheStoreGeneration;
 
   //
   // Send data to SMM.
@@ -1604,6 +1968,16 @@ SmmVariableReady (
             Status = SendRuntimeVariableCacheContextToSmm ();
             if (!EFI_ERROR (Status)) {
               SyncRuntimeCache ();
+              //
+              // SMM rewrites the caches on reclaim, and reports it through the store generation.
+              //
+              VariableIndexRegisterStore (VariableStoreTypeVolatile, mVariableRuntimeVolatileCacheBuffer, &mVariableRuntimeCacheStoreGeneration);
+              VariableIndexRegisterStore (VariableStoreTypeHob, mVariableRuntimeHobCacheBuffer, &mVariableRuntimeCacheStoreGeneration);
+              VariableIndexRegisterStore (VariableStoreTypeNv, mVariableRuntimeNvCacheBuffer, &mVariableRuntimeCacheStoreGeneration);
+              //
+              // Compressed variables are decompressed into the caller buffer, no spare buffer is needed.
+              //
+              VariableDecompressCacheRegisterStore (mVariableRuntimeNvCacheBuffer, &mVariableRuntimeCacheStoreGeneration, 0);
             }
           }
         }
@@ -1655,6 +2029,15 @@ SmmVariableReady (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  mVariableBatch.Execute = VariableBatchExecute;
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mHandle,
+                  &gEdkiiVariableBatchProtocolGuid,
+                  &mVariableBatch,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   gBS->CloseEvent (Event);
 }
 
@@ -0,0 +1,81 @@
+/** @file
+  GUID and data structure of the GUID extension HOB index.
+
+  The index is built by DXE IPL once the HOB list handed to the DXE Core is
+  complete. It maps the GUID of every GUID extension HOB to the HOB offsets in
+  the HOB list, so HobLib instances can look GUID HOBs up without walking the
+  whole list.
+
+  The GUID is used twice:
+  - As the GUID of an extension HOB whose data is the EFI_PHYSICAL_ADDRESS of
+    the HOB_INDEX_HEADER.
+  - As the GUID of a System Configuration Table entry that points to the
+    HOB_INDEX_HEADER.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __HOB_INDEX_GUID_H__
+#define __HOB_INDEX_GUID_H__
+
+#define HOB_INDEX_GUID \
+  { \
+    0xa18556a1, 0x33ac, 0x47d6, {0x97, 0x41, 0x27, 0x5c, 0x11, 0x9f, 0xe1, 0x35 } \
+  }
+
+#define HOB_INDEX_SIGNATURE  SIGNATURE_32 ('H', 'I', 'D', 'X')
+#define HOB_INDEX_REVISION   0x00000001
+
+///
+/// The HOB index header, followed by
+///   UINT32  BucketStart[BucketCount + 1];
+///   UINT32  HobOffset[EntryCount];
+/// The offsets of the GUID extension HOBs of bucket N are
+/// HobOffset[BucketStart[N]] .. HobOffset[BucketStart[N + 1] - 1], in HOB list order.
+///
+typedef struct {
+  UINT32                Signature;
+  UINT32                Revision;
+  ///
+  /// Address of the first HOB of the indexed HOB list. The HOB offsets are
+  /// relative to it, so the DXE Core updates it when it relocates the HOB list.
+  ///
+  EFI_PHYSICAL_ADDRESS  HobList;
+  ///
+  /// Offset from HobList of the end of the indexed HOBs. HOBs built after
+  /// the index start at this offset and are not covered by the index.
+  ///
+  UINT64                IndexedLength;
+  ///
+  /// Number of GUID hash buckets. It is a power of two.
+  ///
+  UINT32                BucketCount;
+  ///
+  /// Number of GUID extension HOBs in the index.
+  ///
+  UINT32                EntryCount;
+} HOB_INDEX_HEADER;
+
+///
+/// Get the bucket of a GUID in a HOB index with BucketCount buckets.
+///
+#define HOB_INDEX_BUCKET(Guid, BucketCount) \
+  ((((UINT32 *) (Guid))[0] ^ ((UINT32 *) (Guid))[1] ^ ((UINT32 *) (Guid))[2] ^ ((UINT32 *) (Guid))[3]) & ((BucketCount) - 1))
+
+///
+/// Get the BucketStart array of a HOB index.
+///
+#define HOB_INDEX_BUCKET_START(HobIndex) \
+  ((UINT32 *) ((HOB_INDEX_HEADER *) (HobIndex) + 1))
+
+///
+/// Get the HobOffset array of a HOB index.
+///
+#define HOB_INDEX_HOB_OFFSET(HobIndex) \
+  (HOB_INDEX_BUCKET_START (HobIndex) + ((HOB_INDEX_HEADER *) (HobIndex))->BucketCount + 1)
+
+extern EFI_GUID gEdkiiHobIndexGuid;
+
+#endif
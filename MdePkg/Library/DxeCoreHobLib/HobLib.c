@@ -8,11 +8,16 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <PiDxe.h>
 
+#include <Guid/HobIndex.h>
+
 #include <Library/HobLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DxeCoreEntryPoint.h>
 
+HOB_INDEX_HEADER  *mHobIndex = NULL;
+BOOLEAN           mHobIndexSearched = FALSE;
+
 /**
   Returns the pointer to the HOB list.
 
@@ -105,6 +110,126 @@ GetFirstHob (
   return GetNextHob (Type, HobList);
 }
 
+/**
+  Returns the next instance of the matched GUID HOB from the starting HOB by
+  walking the HOB list.
+
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      The starting HOB pointer to search from.
+
+  @return The next instance of the matched GUID HOB from the starting HOB.
+
+**/
+VOID *
+InternalGetNextGuidHobByScan (
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  EFI_PEI_HOB_POINTERS  GuidHob;
+
+  GuidHob.Raw = (UINT8 *) HobStart;
+  while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
+    if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
+      break;
+    }
+    GuidHob.Raw = GET_NEXT_HOB (GuidHob);
+  }
+  return GuidHob.Raw;
+}
+
+/**
+  Returns the next instance of the matched GUID HOB from the starting HOB by
+  looking it up in the GUID HOB index.
+
+  The HOBs built after the index are not covered by it, so when the index has no
+  match the search continues by walking the HOB list from the end of the indexed HOBs.
+
+  @param  HobIndex      The GUID HOB index.
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      The starting HOB pointer to search from. It must be within
+                        the HOBs covered by HobIndex.
+
+  @return The next instance of the matched GUID HOB from the starting HOB.
+
+**/
+VOID *
+InternalGetNextGuidHobFromIndex (
+  IN CONST HOB_INDEX_HEADER *HobIndex,
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  UINT8                 *HobList;
+  UINTN                 StartOffset;
+  UINT32                *BucketStart;
+  UINT32                *HobOffset;
+  UINT32                Bucket;
+  UINT32                Index;
+  EFI_PEI_HOB_POINTERS  GuidHob;
+
+  HobList     = (UINT8 *) (UINTN) HobIndex->HobList;
+  StartOffset = (UINTN) HobStart - (UINTN) HobList;
+  BucketStart = HOB_INDEX_BUCKET_START (HobIndex);
+  HobOffset   = HOB_INDEX_HOB_OFFSET (HobIndex);
+  Bucket      = HOB_INDEX_BUCKET (Guid, HobIndex->BucketCount);
+
+  //
+  // The offsets of a bucket are in HOB list order, so the first match at or
+  // after HobStart is the next instance.
+  //
+  for (Index = BucketStart[Bucket]; Index < BucketStart[Bucket + 1]; Index++) {
+    if (HobOffset[Index] < StartOffset) {
+      continue;
+    }
+    GuidHob.Raw = HobList + HobOffset[Index];
+    if ((GuidHob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) &&
+        CompareGuid (Guid, &GuidHob.Guid->Name)) {
+      return GuidHob.Raw;
+    }
+  }
+
+  return InternalGetNextGuidHobByScan (Guid, HobList + (UINTN) HobIndex->IndexedLength);
+}
+
+/**
+  Returns the GUID HOB index built by DXE IPL for the HOB list.
+
+  The System Configuration Table is not available yet when the DXE Core starts,
+  so the index is located once through its GUID extension HOB and cached. The
+  DXE Core relocates the HOB list during its initialization and rebases the
+  index on the new HOB list, so the index is only used while it indexes the
+  current HOB list.
+
+  @return The GUID HOB index, or NULL if the current HOB list is not indexed.
+
+**/
+HOB_INDEX_HEADER *
+InternalGetHobIndex (
+  VOID
+  )
+{
+  VOID              *GuidHob;
+  HOB_INDEX_HEADER  *HobIndex;
+
+  if (!mHobIndexSearched) {
+    mHobIndexSearched = TRUE;
+    GuidHob = InternalGetNextGuidHobByScan (&gEdkiiHobIndexGuid, GetHobList ());
+    if (GuidHob != NULL) {
+      HobIndex = (HOB_INDEX_HEADER *) (UINTN) (*(EFI_PHYSICAL_ADDRESS *) GET_GUID_HOB_DATA (GuidHob));
+      if ((HobIndex->Signature == HOB_INDEX_SIGNATURE) &&
+          (HobIndex->Revision == HOB_INDEX_REVISION)) {
+        mHobIndex = HobIndex;
+      }
+    }
+  }
+
+  if ((mHobIndex == NULL) || (mHobIndex->HobList != (EFI_PHYSICAL_ADDRESS) (UINTN) GetHobList ())) {
+    return NULL;
+  }
+  return mHobIndex;
+}
+
 /**
   Returns the next instance of the matched GUID HOB from the starting HOB.
 
@@ -134,16 +259,16 @@ GetNextGuidHob (
   IN CONST VOID             *HobStart
   )
 {
-  EFI_PEI_HOB_POINTERS  GuidHob;
+  CONST HOB_INDEX_HEADER  *HobIndex;
 
-  GuidHob.Raw = (UINT8 *) HobStart;
-  while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
-    if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
-      break;
-    }
-    GuidHob.Raw = GET_NEXT_HOB (GuidHob);
+  HobIndex = InternalGetHobIndex ();
+  if ((HobIndex != NULL) &&
+      ((UINTN) HobStart >= (UINTN) HobIndex->HobList) &&
+      ((UINTN) HobStart - (UINTN) HobIndex->HobList <= HobIndex->IndexedLength)) {
+    return InternalGetNextGuidHobFromIndex (HobIndex, Guid, HobStart);
   }
-  return GuidHob.Raw;
+
+  return InternalGetNextGuidHobByScan (Guid, HobStart);
 }
 
 /**
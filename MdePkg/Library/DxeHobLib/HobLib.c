@@ -9,13 +9,15 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <PiDxe.h>
 
 #include <Guid/HobList.h>
+#include <Guid/HobIndex.h>
 
 #include <Library/HobLib.h>
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 
-VOID  *mHobList = NULL;
+VOID              *mHobList = NULL;
+HOB_INDEX_HEADER  *mHobIndex = NULL;
 
 /**
   Returns the pointer to the HOB list.
@@ -53,7 +55,8 @@ GetHobList (
 
 /**
   The constructor function caches the pointer to HOB list by calling GetHobList()
-  and will always return EFI_SUCCESS.
+  and the pointer to the GUID HOB index if it is published in the System
+  Configuration Table. It will always return EFI_SUCCESS.
 
   @param  ImageHandle   The firmware allocated handle for the EFI image.
   @param  SystemTable   A pointer to the EFI System Table.
@@ -68,8 +71,18 @@ HobLibConstructor (
   IN EFI_SYSTEM_TABLE  *SystemTable
   )
 {
+  EFI_STATUS  Status;
+
   GetHobList ();
 
+  Status = EfiGetSystemConfigurationTable (&gEdkiiHobIndexGuid, (VOID **) &mHobIndex);
+  if (EFI_ERROR (Status) ||
+      (mHobIndex->Signature != HOB_INDEX_SIGNATURE) ||
+      (mHobIndex->Revision != HOB_INDEX_REVISION) ||
+      (mHobIndex->HobList != (EFI_PHYSICAL_ADDRESS) (UINTN) mHobList)) {
+    mHobIndex = NULL;
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -139,6 +152,88 @@ GetFirstHob (
   return GetNextHob (Type, HobList);
 }
 
+/**
+  Returns the next instance of the matched GUID HOB from the starting HOB by
+  walking the HOB list.
+
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      The starting HOB pointer to search from.
+
+  @return The next instance of the matched GUID HOB from the starting HOB.
+
+**/
+VOID *
+InternalGetNextGuidHobByScan (
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  EFI_PEI_HOB_POINTERS  GuidHob;
+
+  GuidHob.Raw = (UINT8 *) HobStart;
+  while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
+    if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
+      break;
+    }
+    GuidHob.Raw = GET_NEXT_HOB (GuidHob);
+  }
+  return GuidHob.Raw;
+}
+
+/**
+  Returns the next instance of the matched GUID HOB from the starting HOB by
+  looking it up in the GUID HOB index.
+
+  The HOBs built after the index are not covered by it, so when the index has no
+  match the search continues by walking the HOB list from the end of the indexed HOBs.
+
+  @param  HobIndex      The GUID HOB index.
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      The starting HOB pointer to search from. It must be within
+                        the HOBs covered by HobIndex.
+
+  @return The next instance of the matched GUID HOB from the starting HOB.
+
+**/
+VOID *
+InternalGetNextGuidHobFromIndex (
+  IN CONST HOB_INDEX_HEADER *HobIndex,
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  UINT8                 *HobList;
+  UINTN                 StartOffset;
+  UINT32                *BucketStart;
+  UINT32                *HobOffset;
+  UINT32                Bucket;
+  UINT32                Index;
+  EFI_PEI_HOB_POINTERS  GuidHob;
+
+  HobList     = (UINT8 *) (UINTN) HobIndex->HobList;
+  StartOffset = (UINTN) HobStart - (UINTN) HobList;
+  BucketStart = HOB_INDEX_BUCKET_START (HobIndex);
+  HobOffset   = HOB_INDEX_HOB_OFFSET (HobIndex);
+  Bucket      = HOB_INDEX_BUCKET (Guid, HobIndex->BucketCount);
+
+  //
+  // The offsets of a bucket are in HOB list order, so the first match at or
+  // after HobStart is the next instance.
+  //
+  for (Index = BucketStart[Bucket]; Index < BucketStart[Bucket + 1]; Index++) {
+    if (HobOffset[Index] < StartOffset) {
+      continue;
+    }
+    GuidHob.Raw = HobList + HobOffset[Index];
+    if ((GuidHob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) &&
+        CompareGuid (Guid, &GuidHob.Guid->Name)) {
+      return GuidHob.Raw;
+    }
+  }
+
+  return InternalGetNextGuidHobByScan (Guid, HobList + (UINTN) HobIndex->IndexedLength);
+}
+
 /**
   Returns the next instance of the matched GUID HOB from the starting HOB.
 
@@ -168,16 +263,16 @@ GetNextGuidHob (
   IN CONST VOID             *HobStart
   )
 {
-  EFI_PEI_HOB_POINTERS  GuidHob;
+  CONST HOB_INDEX_HEADER  *HobIndex;
 
-  GuidHob.Raw = (UINT8 *) HobStart;
-  while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
-    if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
-      break;
-    }
-    GuidHob.Raw = GET_NEXT_HOB (GuidHob);
+  HobIndex = mHobIndex;
+  if ((HobIndex != NULL) &&
+      ((UINTN) HobStart >= (UINTN) HobIndex->HobList) &&
+      ((UINTN) HobStart - (UINTN) HobIndex->HobList <= HobIndex->IndexedLength)) {
+    return InternalGetNextGuidHobFromIndex (HobIndex, Guid, HobStart);
   }
-  return GuidHob.Raw;
+
+  return InternalGetNextGuidHobByScan (Guid, HobStart);
 }
 
 /**
@@ -18,7 +18,7 @@
   They will do basic validation for authentication data structure, then call crypto library
   to verify the signature.
 
-Copyright (c) 2009 - 2019, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -1757,6 +1757,151 @@ CleanCertsFromDb (
   return Status;
 }
 
+/**
+  Free the X.509 certificates in the certificate cache of PK or KEK.
+
+  @param[in, out] Cache         The certificate cache of the variable.
+
+**/
+VOID
+FreeCertCache (
+  IN OUT AUTH_CERT_CACHE        *Cache
+  )
+{
+  UINTN                         Index;
+
+  for (Index = 0; Index < Cache->CertCount; Index++) {
+    X509Free (Cache->Certs[Index]);
+  }
+  Cache->CertCount = 0;
+}
+
+/**
+  Construct the X.509 certificates in the signature lists of PK or KEK into
+  the certificate cache of the variable.
+
+  The cache is left empty if the variable holds more than AUTH_CERT_CACHE_MAX_CERTS
+  certificates, or one of them can not be constructed.
+
+  @param[in, out] Cache         The certificate cache of the variable.
+  @param[in]      Data          Pointer to the variable data.
+  @param[in]      DataSize      Size of the variable data.
+  @param[in]      Digest        SHA-256 digest of the variable data.
+
+**/
+VOID
+RefreshCertCache (
+  IN OUT AUTH_CERT_CACHE        *Cache,
+  IN     UINT8                  *Data,
+  IN     UINTN                  DataSize,
+  IN     UINT8                  *Digest
+  )
+{
+  EFI_SIGNATURE_LIST            *CertList;
+  EFI_SIGNATURE_DATA            *Cert;
+  UINTN                         CertCount;
+  UINTN                         Index;
+
+  FreeCertCache (Cache);
+  Cache->Valid = TRUE;
+  CopyMem (Cache->Digest, Digest, SHA256_DIGEST_SIZE);
+
+  CertList = (EFI_SIGNATURE_LIST *) Data;
+  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
+    if (CompareGuid (&CertList->SignatureType, &gEfiCertX509Guid)) {
+      Cert      = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
+      CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+      for (Index = 0; Index < CertCount; Index++) {
+        if ((Cache->CertCount == AUTH_CERT_CACHE_MAX_CERTS) ||
+            !X509ConstructCertificate (
+               Cert->SignatureData,
+               CertList->SignatureSize - (sizeof (EFI_SIGNATURE_DATA) - 1),
+               (UINT8 **) &Cache->Certs[Cache->CertCount]
+               )) {
+          FreeCertCache (Cache);
+          return;
+        }
+        Cache->CertCount++;
+        Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+      }
+    }
+    DataSize -= CertList->SignatureListSize;
+    CertList = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+  }
+}
+
+/**
+  Verify the PKCS#7 SignedData against the X.509 certificates of PK or KEK,
+  which are constructed once and reused until the variable data change.
+
+  The cache holds every X.509 certificate of the variable, or none. A FALSE
+  return with an empty cache does not reject the SignedData: the caller then
+  verifies it against the variable data as before, which decides the result.
+  The cache stays empty after AuthVariableLibExitBootServices().
+
+  @param[in, out] Cache         The certificate cache of the variable.
+  @param[in]      Data          Pointer to the variable data.
+  @param[in]      DataSize      Size of the variable data.
+  @param[in]      SigData       Pointer to the PKCS#7 SignedData.
+  @param[in]      SigDataSize   Size of the PKCS#7 SignedData.
+  @param[in]      NewData       Pointer to the content to be verified.
+  @param[in]      NewDataSize   Size of the content to be verified.
+
+  @retval TRUE                  The SignedData is verified by one of the certificates.
+  @retval FALSE                 The SignedData is not verified by the cached certificates.
+
+**/
+BOOLEAN
+VerifyWithCertCache (
+  IN OUT AUTH_CERT_CACHE        *Cache,
+  IN     UINT8                  *Data,
+  IN     UINTN                  DataSize,
+  IN     UINT8                  *SigData,
+  IN     UINTN                  SigDataSize,
+  IN     UINT8                  *NewData,
+  IN     UINTN                  NewDataSize
+  )
+{
+  UINT8                         Digest[SHA256_DIGEST_SIZE];
+
+  if (mCertCacheReleased) {
+    return FALSE;
+  }
+
+  if (Cache->HashCtx != mHashCtx) {
+    //
+    // The certificates were constructed before SetVirtualAddressMap(), and hold
+    // physical addresses, but the caller did not release them at ExitBootServices().
+    // Drop them without X509Free().
+    //
+    Cache->Valid     = FALSE;
+    Cache->CertCount = 0;
+    Cache->HashCtx   = mHashCtx;
+  }
+
+  if (!Sha256Init (mHashCtx) ||
+      !Sha256Update (mHashCtx, Data, DataSize) ||
+      !Sha256Final (mHashCtx, Digest)) {
+    //
+    // The cached certificates can not be checked against the variable data,
+    // drop them and leave the verification to the caller.
+    //
+    FreeCertCache (Cache);
+    Cache->Valid = FALSE;
+    return FALSE;
+  }
+
+  if (!Cache->Valid || (CompareMem (Cache->Digest, Digest, SHA256_DIGEST_SIZE) != 0)) {
+    RefreshCertCache (Cache, Data, DataSize, Digest);
+  }
+
+  if (Cache->CertCount == 0) {
+    return FALSE;
+  }
+
+  return Pkcs7VerifyWithX509 (SigData, SigDataSize, Cache->Certs, Cache->CertCount, NewData, NewDataSize);
+}
+
 /**
   Process variable with EFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS set
 
@@ -1960,6 +2105,10 @@ VerifyTimeBasedPayload (
 
   CopyMem (Buffer, PayloadPtr, PayloadSize);
 
+  if (!mAuthVarLibContextIn->AtRuntime ()) {
+    PERF_START_EX (NULL, "AuthVarVerify", NULL, 0, AuthVarType);
+  }
+
   if (AuthVarType == AuthVarTypePk) {
     //
     // Verify that the signature has been made with the current Platform Key (no chaining for PK).
@@ -2000,16 +2149,20 @@ VerifyTimeBasedPayload (
     }
 
     //
-    // Verify Pkcs7 SignedData via Pkcs7Verify library.
+    // The signer is the platform key, so verify against its constructed certificate,
+    // or via Pkcs7Verify library if the certificate could not be constructed.
     //
-    VerifyStatus = Pkcs7Verify (
-                     SigData,
-                     SigDataSize,
-                     TopLevelCert,
-                     TopLevelCertSize,
-                     NewData,
-                     NewDataSize
-                     );
+    VerifyStatus = VerifyWithCertCache (&mPkCertCache, Data, DataSize, SigData, SigDataSize, NewData, NewDataSize);
+    if (!VerifyStatus && (mPkCertCache.CertCount == 0)) {
+      VerifyStatus = Pkcs7Verify (
+                       SigData,
+                       SigDataSize,
+                       TopLevelCert,
+                       TopLevelCertSize,
+                       NewData,
+                       NewDataSize
+                       );
+    }
 
   } else if (AuthVarType == AuthVarTypeKek) {
 
@@ -2026,6 +2179,15 @@ VerifyTimeBasedPayload (
       return Status;
     }
 
+    //
+    // Verify against the constructed KEK certificates. The KEK Signature Database
+    // is only gone through if they could not be constructed.
+    //
+    VerifyStatus = VerifyWithCertCache (&mKekCertCache, Data, DataSize, SigData, SigDataSize, NewData, NewDataSize);
+    if (VerifyStatus || (mKekCertCache.CertCount != 0)) {
+      goto Exit;
+    }
+
     //
     // Ready to verify Pkcs7 SignedData. Go through KEK Signature Database to find out X.509 CertList.
     //
@@ -2172,6 +2334,10 @@ VerifyTimeBasedPayload (
 
 Exit:
 
+  if (!mAuthVarLibContextIn->AtRuntime ()) {
+    PERF_END_EX (NULL, "AuthVarVerify", NULL, 0, AuthVarType);
+  }
+
   if (AuthVarType == AuthVarTypePk || AuthVarType == AuthVarTypePriv) {
     Pkcs7FreeSigners (TopLevelCert);
     Pkcs7FreeSigners (SignerCerts);
@@ -12,7 +12,7 @@
   may not be modified without authorization. If platform fails to protect these resources,
   the authentication service provided in this driver will be broken, and the behavior is undefined.
 
-Copyright (c) 2009 - 2018, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2009 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -27,6 +27,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseCryptLib.h>
 #include <Library/PlatformSecureLib.h>
+#include <Library/PerformanceLib.h>
 
 #include <Guid/AuthenticatedVariableFormat.h>
 #include <Guid/ImageAuthentication.h>
@@ -87,6 +88,36 @@ typedef struct {
 } AUTH_CERT_DB_DATA;
 #pragma pack()
 
+///
+/// The most X.509 certificates of PK or KEK kept constructed in AUTH_CERT_CACHE.
+/// Signed data are verified against a larger database by Pkcs7Verify() directly.
+///
+#define AUTH_CERT_CACHE_MAX_CERTS        16
+
+///
+/// The X.509 certificates of PK or KEK, constructed by X509ConstructCertificate()
+/// once and reused to verify signed data until the variable changes.
+///
+typedef struct {
+  ///
+  /// TRUE if Digest and Certs describe the variable data.
+  ///
+  BOOLEAN     Valid;
+  ///
+  /// SHA-256 digest of the variable data the certificates were constructed from.
+  ///
+  UINT8       Digest[SHA256_DIGEST_SIZE];
+  ///
+  /// The value of mHashCtx when the certificates were constructed. mHashCtx is
+  /// converted at SetVirtualAddressMap(), after which the certificates
+  /// constructed before can not be used any more. They are freed at
+  /// ExitBootServices() by AuthVariableLibExitBootServices().
+  ///
+  VOID        *HashCtx;
+  UINTN       CertCount;
+  VOID        *Certs[AUTH_CERT_CACHE_MAX_CERTS];
+} AUTH_CERT_CACHE;
+
 extern UINT8    *mCertDbStore;
 extern UINT32   mMaxCertDbSize;
 extern UINT32   mPlatformMode;
@@ -94,6 +125,10 @@ extern UINT8    mVendorKeyState;
 
 extern VOID     *mHashCtx;
 
+extern AUTH_CERT_CACHE  mPkCertCache;
+extern AUTH_CERT_CACHE  mKekCertCache;
+extern BOOLEAN          mCertCacheReleased;
+
 extern AUTH_VAR_LIB_CONTEXT_IN *mAuthVarLibContextIn;
 
 
@@ -172,6 +207,17 @@ CleanCertsFromDb (
   VOID
   );
 
+/**
+  Free the X.509 certificates in the certificate cache of PK or KEK.
+
+  @param[in, out] Cache         The certificate cache of the variable.
+
+**/
+VOID
+FreeCertCache (
+  IN OUT AUTH_CERT_CACHE        *Cache
+  );
+
 /**
   Filter out the duplicated EFI_SIGNATURE_DATA from the new data by comparing to the original data.
 
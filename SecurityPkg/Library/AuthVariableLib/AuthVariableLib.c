@@ -11,7 +11,7 @@
   may not be modified without authorization. If platform fails to protect these resources,
   the authentication service provided in this driver will be broken, and the behavior is undefined.
 
-Copyright (c) 2015 - 2016, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2015 - 2020, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
@@ -33,6 +33,13 @@ EFI_GUID mSignatureSupport[] = {EFI_CERT_SHA1_GUID, EFI_CERT_SHA256_GUID, EFI_CE
 //
 VOID  *mHashCtx = NULL;
 
+//
+// Constructed X.509 certificates of PK and KEK, and whether they are released
+//
+AUTH_CERT_CACHE  mPkCertCache;
+AUTH_CERT_CACHE  mKekCertCache;
+BOOLEAN          mCertCacheReleased = FALSE;
+
 VARIABLE_ENTRY_PROPERTY mAuthVarEntry[] = {
   {
     &gEfiSecureBootEnableDisableGuid,
@@ -419,3 +426,24 @@ AuthVariableLibProcessVariable (
 
   return Status;
 }
+
+/**
+  Release the resources of authenticated variable services that can not be
+  used after SetVirtualAddressMap (). Authenticated variables are still
+  processed after it, without these resources.
+
+  The X.509 certificates constructed from PK and KEK hold physical addresses,
+  so they are freed, and the signed data are verified via Pkcs7Verify () from
+  now on.
+
+**/
+VOID
+EFIAPI
+AuthVariableLibExitBootServices (
+  VOID
+  )
+{
+  FreeCertCache (&mPkCertCache);
+  FreeCertCache (&mKekCertCache);
+  mCertCacheReleased = TRUE;
+}
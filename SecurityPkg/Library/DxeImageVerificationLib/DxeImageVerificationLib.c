@@ -72,6 +72,15 @@ HASH_TABLE mHash[] = {
 
 EFI_STRING mHashTypeStr;
 
+//
+// Signed images that passed verification, and the digest of the "db", "dbx" and
+// "dbt" contents they were verified against.
+//
+IMAGE_VERDICT  mImageVerdict[IMAGE_VERDICT_CACHE_SIZE];
+UINTN          mImageVerdictCount = 0;
+UINTN          mImageVerdictNext  = 0;
+UINT8          mImageVerdictDatabaseDigest[SHA256_DIGEST_SIZE];
+
 /**
   SecureBoot Hook for processing image verification.
 
@@ -820,6 +829,89 @@ AddImageExeInfo (
   }
 }
 
+/**
+  Check whether the hash of a TBSCertificate is in the index of the forbidden
+  database (DBX).
+
+  @param[in]  TBSCert           Pointer to the TBSCertificate.
+  @param[in]  TBSCertSize       Size of the TBSCertificate.
+  @param[out] RevocationTime    Return the time that the certificate was revoked.
+  @param[out] IsFound           Search result.
+
+  @retval TRUE                  The index was searched.
+  @retval FALSE                 The index is not available; search the variable.
+
+**/
+BOOLEAN
+IsCertHashFoundInDbxIndex (
+  IN  UINT8     *TBSCert,
+  IN  UINTN     TBSCertSize,
+  OUT EFI_TIME  *RevocationTime,
+  OUT BOOLEAN   *IsFound
+  )
+{
+  STATIC CONST struct {
+    EFI_GUID  *SignatureType;
+    UINT32    HashAlg;
+  } CertHashType[] = {
+    { &gEfiCertX509Sha256Guid, HASHALG_SHA256 },
+    { &gEfiCertX509Sha384Guid, HASHALG_SHA384 },
+    { &gEfiCertX509Sha512Guid, HASHALG_SHA512 }
+  };
+  UINTN               Index;
+  UINT32              HashAlg;
+  VOID                *HashCtx;
+  BOOLEAN             Status;
+  UINT8               CertDigest[MAX_DIGEST_SIZE];
+  EFI_SIGNATURE_LIST  *SignatureList;
+  EFI_SIGNATURE_DATA  *Signature;
+  EFI_SIGNATURE_DATA  *FirstSignature;
+  UINTN               FirstDigestLength;
+
+  FirstSignature    = NULL;
+  FirstDigestLength = 0;
+  for (Index = 0; Index < ARRAY_SIZE (CertHashType); Index++) {
+    HashAlg = CertHashType[Index].HashAlg;
+    HashCtx = AllocatePool (mHash[HashAlg].GetContextSize ());
+    if (HashCtx == NULL) {
+      return FALSE;
+    }
+    Status = mHash[HashAlg].HashInit (HashCtx) &&
+             mHash[HashAlg].HashUpdate (HashCtx, TBSCert, TBSCertSize) &&
+             mHash[HashAlg].HashFinal (HashCtx, CertDigest);
+    FreePool (HashCtx);
+    if (!Status) {
+      return FALSE;
+    }
+
+    if (!LookupSignatureDatabaseIndex (
+           EFI_IMAGE_SECURITY_DATABASE1,
+           CertHashType[Index].SignatureType,
+           CertDigest,
+           mHash[HashAlg].DigestLength,
+           0,
+           &SignatureList,
+           &Signature
+           )) {
+      return FALSE;
+    }
+
+    //
+    // Report the first match in database order, like the scan of the database.
+    //
+    if ((Signature != NULL) && ((FirstSignature == NULL) || ((UINTN) Signature < (UINTN) FirstSignature))) {
+      FirstSignature    = Signature;
+      FirstDigestLength = mHash[HashAlg].DigestLength;
+    }
+  }
+
+  *IsFound = (BOOLEAN) (FirstSignature != NULL);
+  if (*IsFound) {
+    CopyMem (RevocationTime, (EFI_TIME *) (FirstSignature->SignatureData + FirstDigestLength), sizeof (EFI_TIME));
+  }
+  return TRUE;
+}
+
 /**
   Check whether the hash of an given X.509 certificate is in forbidden database (DBX).
 
@@ -876,6 +968,10 @@ IsCertHashFoundInDbx (
     return Status;
   }
 
+  if (IsCertHashFoundInDbxIndex (TBSCert, TBSCertSize, RevocationTime, IsFound)) {
+    return EFI_SUCCESS;
+  }
+
   while ((DbxSize > 0) && (SignatureListSize >= DbxList->SignatureListSize)) {
     //
     // Determine Hash Algorithm of Certificate in the forbidden database.
@@ -990,6 +1086,20 @@ IsSignatureFoundInDatabase (
   *IsFound  = FALSE;
   Data      = NULL;
   DataSize  = 0;
+
+  if (LookupSignatureDatabaseIndex (VariableName, CertType, Signature, SignatureSize, sizeof (EFI_GUID) + SignatureSize, &CertList, &Cert)) {
+    if (Cert != NULL) {
+      *IsFound = TRUE;
+      //
+      // Entries in UEFI_IMAGE_SECURITY_DATABASE that are used to validate image should be measured
+      //
+      if (StrCmp(VariableName, EFI_IMAGE_SECURITY_DATABASE) == 0) {
+        SecureBootHook (VariableName, &gEfiImageSecurityDatabaseGuid, CertList->SignatureSize, Cert);
+      }
+    }
+    return EFI_SUCCESS;
+  }
+
   Status    = gRT->GetVariable (VariableName, &gEfiImageSecurityDatabaseGuid, NULL, &DataSize, NULL);
   if (Status != EFI_BUFFER_TOO_SMALL) {
     if (Status == EFI_NOT_FOUND) {
@@ -1585,6 +1695,95 @@ Done:
   return VerifyStatus;
 }
 
+/**
+  Check whether a signed image already passed verification against the current
+  security databases.
+
+  Verifying the Authenticode signatures of an image against db and dbx costs far
+  more than hashing the image, and identical images are loaded several times,
+  e.g. the same option ROM driver on each port of a network card. The verdict is
+  keyed on the Authenticode digest that HashPeImageByType() just computed for the
+  first signature, so the image is not hashed a second time, and on a digest of
+  the attribute certificate table, which that digest does not cover. The verdict
+  is only remembered for images that passed verification, so that a rejected
+  image is always recorded in the image execution information table.
+
+  @param[in]   SecDataDir   The security data directory of the image.
+  @param[out]  Verdict      The key of the verdict of the image. ImageDigestSize
+                            is 0 if the verdict cannot be remembered.
+
+  @retval TRUE              The image passed verification before.
+  @retval FALSE             The image must be verified.
+
+**/
+BOOLEAN
+IsImageVerdictCached (
+  IN  EFI_IMAGE_DATA_DIRECTORY  *SecDataDir,
+  OUT IMAGE_VERDICT             *Verdict
+  )
+{
+  UINT8  DatabaseDigest[SHA256_DIGEST_SIZE];
+  UINTN  Index;
+
+  ZeroMem (Verdict, sizeof (*Verdict));
+  if (!RefreshSignatureDatabaseIndex (DatabaseDigest)) {
+    return FALSE;
+  }
+
+  if (CompareMem (DatabaseDigest, mImageVerdictDatabaseDigest, SHA256_DIGEST_SIZE) != 0) {
+    //
+    // The security databases were updated, forget all the verdicts.
+    //
+    CopyMem (mImageVerdictDatabaseDigest, DatabaseDigest, SHA256_DIGEST_SIZE);
+    mImageVerdictCount = 0;
+    mImageVerdictNext  = 0;
+  }
+
+  if ((mImageDigestSize == 0) || (mImageDigestSize > MAX_DIGEST_SIZE) ||
+      (SecDataDir->VirtualAddress > mImageSize) ||
+      (SecDataDir->Size > mImageSize - SecDataDir->VirtualAddress)) {
+    return FALSE;
+  }
+  if (!Sha256HashAll (mImageBase + SecDataDir->VirtualAddress, SecDataDir->Size, Verdict->CertTableDigest)) {
+    return FALSE;
+  }
+  CopyGuid (&Verdict->CertType, &mCertType);
+  CopyMem (Verdict->ImageDigest, mImageDigest, mImageDigestSize);
+  Verdict->ImageDigestSize = mImageDigestSize;
+
+  for (Index = 0; Index < mImageVerdictCount; Index++) {
+    if (CompareMem (&mImageVerdict[Index], Verdict, sizeof (*Verdict)) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Remember that a signed image passed verification against the current
+  security databases.
+
+  @param[in]  Verdict       The key of the verdict of the image, as returned by
+                            IsImageVerdictCached().
+
+**/
+VOID
+CacheImageVerdict (
+  IN IMAGE_VERDICT  *Verdict
+  )
+{
+  if (Verdict->ImageDigestSize == 0) {
+    return;
+  }
+
+  CopyMem (&mImageVerdict[mImageVerdictNext], Verdict, sizeof (*Verdict));
+  mImageVerdictNext = (mImageVerdictNext + 1) % IMAGE_VERDICT_CACHE_SIZE;
+  if (mImageVerdictCount < IMAGE_VERDICT_CACHE_SIZE) {
+    mImageVerdictCount++;
+  }
+}
+
 /**
   Provide verification service for signed images, which include both signature validation
   and platform policy control. For signature types, both UEFI WIN_CERTIFICATE_UEFI_GUID and
@@ -1666,6 +1865,8 @@ DxeImageVerificationHandler (
   EFI_STATUS                           HashStatus;
   EFI_STATUS                           DbStatus;
   BOOLEAN                              IsFound;
+  IMAGE_VERDICT                        Verdict;
+  BOOLEAN                              VerdictChecked;
 
   SignatureList     = NULL;
   SignatureListSize = 0;
@@ -1675,6 +1876,8 @@ DxeImageVerificationHandler (
   Action            = EFI_IMAGE_EXECUTION_AUTH_UNTESTED;
   IsVerified        = FALSE;
   IsFound           = FALSE;
+  VerdictChecked    = FALSE;
+  ZeroMem (&Verdict, sizeof (Verdict));
 
   //
   // Check the image type and get policy setting.
@@ -1911,6 +2114,17 @@ DxeImageVerificationHandler (
       continue;
     }
 
+    //
+    // Skip the signature checks if the image passed them before, with the
+    // Authenticode digest of the first signature.
+    //
+    if (!VerdictChecked) {
+      VerdictChecked = TRUE;
+      if (IsImageVerdictCached (SecDataDir, &Verdict)) {
+        return EFI_SUCCESS;
+      }
+    }
+
     //
     // Check the digital signature against the revoked certificate in forbidden database (dbx).
     //
@@ -1970,6 +2184,7 @@ DxeImageVerificationHandler (
   }
 
   if (IsVerified) {
+    CacheImageVerdict (&Verdict);
     return EFI_SUCCESS;
   }
   if (Action == EFI_IMAGE_EXECUTION_AUTH_SIG_FAILED || Action == EFI_IMAGE_EXECUTION_AUTH_SIG_FOUND) {
@@ -2063,6 +2278,7 @@ DxeImageVerificationLibConstructor (
   )
 {
   EFI_EVENT            Event;
+  EFI_EVENT            VariableWriteEvent;
 
   //
   // Register the event to publish the image execution table.
@@ -2074,6 +2290,19 @@ DxeImageVerificationLibConstructor (
     &Event
     );
 
+  //
+  // Register the event to read the security databases again after they may
+  // have changed.
+  //
+  gBS->CreateEventEx (
+         EVT_NOTIFY_SIGNAL,
+         TPL_CALLBACK,
+         SignatureDatabaseChangedNotify,
+         NULL,
+         &gEdkiiVariableWriteEventGroupGuid,
+         &VariableWriteEvent
+         );
+
   return RegisterSecurity2Handler (
           DxeImageVerificationHandler,
           EFI_AUTH_OPERATION_VERIFY_IMAGE | EFI_AUTH_OPERATION_IMAGE_REQUIRED
@@ -30,6 +30,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/VariableWrite.h>
 #include <Guid/ImageAuthentication.h>
 #include <Guid/AuthenticatedVariableFormat.h>
+#include <Guid/VariableWriteEventGroup.h>
 #include <IndustryStandard/PeImage.h>
 
 #define EFI_CERT_TYPE_RSA2048_SHA256_SIZE 256
@@ -73,6 +74,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 // Set max digest size as SHA512 Output (64 bytes) by far
 //
 #define MAX_DIGEST_SIZE    SHA512_DIGEST_SIZE
+
+//
+// Number of images whose successful verification is remembered.
+//
+#define IMAGE_VERDICT_CACHE_SIZE    32
 //
 //
 // PKCS7 Certificate definition
@@ -198,4 +204,113 @@ typedef struct {
   HASH_FINAL               HashFinal;
 } HASH_TABLE;
 
+//
+// Number of leading bytes of the signature data hashed in the signature index.
+//
+#define SIGNATURE_INDEX_HASH_SIZE   32
+
+typedef struct {
+  EFI_SIGNATURE_LIST       *SignatureList;
+  EFI_SIGNATURE_DATA       *Signature;
+} SIGNATURE_INDEX_ENTRY;
+
+//
+// Hash index of the signatures of a security database.
+//
+typedef struct {
+  CHAR16                   *VariableName;
+  //
+  // Contents of the variable
+  //
+  UINT8                    *Data;
+  UINTN                    DataSize;
+  //
+  // Signatures in database order, chained by hash. The chains end with MAX_UINT32.
+  //
+  SIGNATURE_INDEX_ENTRY    *Entries;
+  UINTN                    EntryCount;
+  UINT32                   *Next;
+  UINT32                   *Buckets;
+  UINTN                    BucketCount;
+} SIGNATURE_DATABASE_INDEX;
+
+//
+// Signed image that passed verification against the current security databases.
+//
+typedef struct {
+  //
+  // Authenticode digest of the image, with the hash algorithm of its first
+  // signature, as computed for the verification
+  //
+  EFI_GUID                 CertType;
+  UINT8                    ImageDigest[MAX_DIGEST_SIZE];
+  UINTN                    ImageDigestSize;
+  //
+  // SHA256 digest of the attribute certificate table, which the Authenticode
+  // digest does not cover
+  //
+  UINT8                    CertTableDigest[SHA256_DIGEST_SIZE];
+} IMAGE_VERDICT;
+
+/**
+  Notification function of the gEdkiiVariableWriteEventGroupGuid event group.
+  A variable was changed, which may be db, dbx or dbt.
+
+  @param[in]  Event     Event whose notification function is being invoked.
+  @param[in]  Context   Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+SignatureDatabaseChangedNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  );
+
+/**
+  Read the image security databases if a variable was written since they were
+  last read, compute their digest, and build the index of db and dbx again if
+  their contents changed.
+
+  @param[out]  Digest     The SHA256 digest of the contents of db, dbx and dbt.
+
+  @retval TRUE            The digest is computed.
+  @retval FALSE           The databases cannot be read; the index is not used.
+
+**/
+BOOLEAN
+RefreshSignatureDatabaseIndex (
+  OUT UINT8  *Digest
+  );
+
+/**
+  Look up a signature in the index of a security database.
+
+  @param[in]   VariableName     The name of the database, db or dbx.
+  @param[in]   SignatureType    The type of the signature list to search.
+  @param[in]   SignatureData    The signature data to search for.
+  @param[in]   DataSize         The size of the signature data. Only the first
+                                DataSize bytes of the signatures are compared,
+                                e.g. the revocation time that follows the hash
+                                of a certificate is not.
+  @param[in]   SignatureSize    The size of the EFI_SIGNATURE_DATA of the lists
+                                to search, 0 to search the lists of any size.
+  @param[out]  SignatureList    The list holding the signature found.
+  @param[out]  Signature        The signature found, NULL if none.
+
+  @retval TRUE                  The index was searched.
+  @retval FALSE                 The index is not available; search the variable.
+
+**/
+BOOLEAN
+LookupSignatureDatabaseIndex (
+  IN  CHAR16              *VariableName,
+  IN  CONST EFI_GUID      *SignatureType,
+  IN  CONST UINT8         *SignatureData,
+  IN  UINTN               DataSize,
+  IN  UINTN               SignatureSize,
+  OUT EFI_SIGNATURE_LIST  **SignatureList,
+  OUT EFI_SIGNATURE_DATA  **Signature
+  );
+
 #endif
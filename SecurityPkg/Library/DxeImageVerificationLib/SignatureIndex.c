@@ -0,0 +1,415 @@
+/** @file
+  In-memory index of the signatures in the image security databases.
+
+  The dbx database holds thousands of image hashes, and each image load looks up
+  its hashes in db and dbx several times. The contents of db, dbx and dbt are read
+  and the hash index of db and dbx is built at the first image verification. They
+  are only read again after the variable drivers signaled the
+  gEdkiiVariableWriteEventGroupGuid event group, and the index is only built
+  again if the contents actually changed. Writes made directly through the SMM
+  variable protocol do not signal the group and are not seen.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeImageVerificationLib.h"
+
+//
+// The indexed databases: db and dbx. dbt is only part of the digest.
+//
+SIGNATURE_DATABASE_INDEX  mSignatureIndex[] = {
+  { EFI_IMAGE_SECURITY_DATABASE,  NULL, 0, NULL, 0, NULL, NULL, 0 },
+  { EFI_IMAGE_SECURITY_DATABASE1, NULL, 0, NULL, 0, NULL, NULL, 0 }
+};
+
+BOOLEAN  mSignatureIndexValid = FALSE;
+UINT8    mSignatureDatabaseDigest[SHA256_DIGEST_SIZE];
+
+//
+// TRUE until the databases are read, and again after each variable write.
+//
+BOOLEAN  mSignatureDatabaseChanged = TRUE;
+
+/**
+  Notification function of the gEdkiiVariableWriteEventGroupGuid event group.
+  A variable was changed, which may be db, dbx or dbt.
+
+  @param[in]  Event     Event whose notification function is being invoked.
+  @param[in]  Context   Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+SignatureDatabaseChangedNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  mSignatureDatabaseChanged = TRUE;
+}
+
+/**
+  Compute the hash of a signature for the index.
+
+  @param[in]  SignatureType     The type of the signature list.
+  @param[in]  SignatureData     The signature data.
+  @param[in]  DataSize          The size of the signature data, at most
+                                SIGNATURE_INDEX_HASH_SIZE bytes are hashed.
+
+  @return The hash of the signature.
+
+**/
+UINT32
+SignatureIndexHash (
+  IN CONST EFI_GUID  *SignatureType,
+  IN CONST UINT8     *SignatureData,
+  IN UINTN           DataSize
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  //
+  // FNV-1a over the type and the first bytes of the data. Most signatures are
+  // hashes already, so the first bytes are enough.
+  //
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ ((CONST UINT8 *) SignatureType)[Index]) * 0x01000193;
+  }
+  DataSize = MIN (DataSize, SIGNATURE_INDEX_HASH_SIZE);
+  for (Index = 0; Index < DataSize; Index++) {
+    Hash = (Hash ^ SignatureData[Index]) * 0x01000193;
+  }
+  return Hash;
+}
+
+/**
+  Free the index of a security database.
+
+  @param[in, out]  DatabaseIndex   The index to free.
+
+**/
+VOID
+FreeSignatureDatabaseIndex (
+  IN OUT SIGNATURE_DATABASE_INDEX  *DatabaseIndex
+  )
+{
+  if (DatabaseIndex->Data != NULL) {
+    FreePool (DatabaseIndex->Data);
+  }
+  if (DatabaseIndex->Entries != NULL) {
+    FreePool (DatabaseIndex->Entries);
+  }
+  DatabaseIndex->Data        = NULL;
+  DatabaseIndex->DataSize    = 0;
+  DatabaseIndex->Entries     = NULL;
+  DatabaseIndex->EntryCount  = 0;
+  DatabaseIndex->Buckets     = NULL;
+  DatabaseIndex->Next        = NULL;
+  DatabaseIndex->BucketCount = 0;
+}
+
+/**
+  Build the index of a security database.
+
+  @param[in, out]  DatabaseIndex   The index to build. Data and DataSize hold
+                                   the contents of the database.
+
+  @retval TRUE                     The index is built.
+  @retval FALSE                    The database is malformed or memory is exhausted.
+
+**/
+BOOLEAN
+BuildSignatureDatabaseIndex (
+  IN OUT SIGNATURE_DATABASE_INDEX  *DatabaseIndex
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  UINTN               DataSize;
+  UINTN               CertCount;
+  UINTN               EntryCount;
+  UINTN               BucketCount;
+  UINTN               Index;
+  UINT32              Bucket;
+  SIGNATURE_INDEX_ENTRY  *Entry;
+
+  //
+  // Count the signatures, and check the lists the same way the lookups do.
+  //
+  EntryCount = 0;
+  CertList   = (EFI_SIGNATURE_LIST *) DatabaseIndex->Data;
+  DataSize   = DatabaseIndex->DataSize;
+  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
+    if ((CertList->SignatureListSize < sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize) ||
+        (CertList->SignatureSize <= sizeof (EFI_GUID))) {
+      return FALSE;
+    }
+    EntryCount += (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+    DataSize   -= CertList->SignatureListSize;
+    CertList    = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+  }
+
+  BucketCount = 1;
+  while (BucketCount < EntryCount * 2) {
+    BucketCount <<= 1;
+  }
+
+  //
+  // The entries, the bucket heads and the chains share one allocation.
+  //
+  DatabaseIndex->Entries = AllocatePool (
+                             EntryCount * (sizeof (SIGNATURE_INDEX_ENTRY) + sizeof (UINT32)) +
+                             BucketCount * sizeof (UINT32)
+                             );
+  if (DatabaseIndex->Entries == NULL) {
+    return FALSE;
+  }
+  DatabaseIndex->Next        = (UINT32 *) (DatabaseIndex->Entries + EntryCount);
+  DatabaseIndex->Buckets     = DatabaseIndex->Next + EntryCount;
+  DatabaseIndex->BucketCount = BucketCount;
+  DatabaseIndex->EntryCount  = EntryCount;
+  SetMem32 (DatabaseIndex->Buckets, BucketCount * sizeof (UINT32), MAX_UINT32);
+
+  Entry    = DatabaseIndex->Entries;
+  CertList = (EFI_SIGNATURE_LIST *) DatabaseIndex->Data;
+  DataSize = DatabaseIndex->DataSize;
+  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
+    CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+    Cert      = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
+    for (Index = 0; Index < CertCount; Index++) {
+      Entry->SignatureList = CertList;
+      Entry->Signature     = Cert;
+      Entry++;
+      Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+    }
+    DataSize -= CertList->SignatureListSize;
+    CertList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+  }
+
+  //
+  // Chain the entries backwards, so that each chain is in database order and
+  // a lookup returns the first match, like a scan of the database.
+  //
+  for (Index = EntryCount; Index > 0; Index--) {
+    Entry  = &DatabaseIndex->Entries[Index - 1];
+    Bucket = SignatureIndexHash (
+               &Entry->SignatureList->SignatureType,
+               Entry->Signature->SignatureData,
+               Entry->SignatureList->SignatureSize - sizeof (EFI_GUID)
+               ) & (UINT32) (BucketCount - 1);
+    DatabaseIndex->Next[Index - 1] = DatabaseIndex->Buckets[Bucket];
+    DatabaseIndex->Buckets[Bucket] = (UINT32) (Index - 1);
+  }
+
+  return TRUE;
+}
+
+/**
+  Read the image security databases if a variable was written since they were
+  last read, compute their digest, and build the index of db and dbx again if
+  their contents changed.
+
+  @param[out]  Digest     The SHA256 digest of the contents of db, dbx and dbt.
+
+  @retval TRUE            The digest is computed.
+  @retval FALSE           The databases cannot be read; the index is not used.
+
+**/
+BOOLEAN
+RefreshSignatureDatabaseIndex (
+  OUT UINT8  *Digest
+  )
+{
+  CHAR16      *DatabaseName[3];
+  VOID        *Data[3];
+  UINTN       DataSize[3];
+  VOID        *HashCtx;
+  UINTN       Index;
+  BOOLEAN     Status;
+  EFI_STATUS  VarStatus;
+
+  if (!mSignatureDatabaseChanged) {
+    CopyMem (Digest, mSignatureDatabaseDigest, SHA256_DIGEST_SIZE);
+    return TRUE;
+  }
+
+  DatabaseName[0] = EFI_IMAGE_SECURITY_DATABASE;
+  DatabaseName[1] = EFI_IMAGE_SECURITY_DATABASE1;
+  DatabaseName[2] = EFI_IMAGE_SECURITY_DATABASE2;
+  ZeroMem (Data, sizeof (Data));
+
+  HashCtx = AllocatePool (Sha256GetContextSize ());
+  if (HashCtx == NULL) {
+    mSignatureIndexValid = FALSE;
+    return FALSE;
+  }
+
+  Status = Sha256Init (HashCtx);
+  for (Index = 0; Status && (Index < ARRAY_SIZE (DatabaseName)); Index++) {
+    VarStatus = GetVariable2 (DatabaseName[Index], &gEfiImageSecurityDatabaseGuid, &Data[Index], &DataSize[Index]);
+    if (VarStatus == EFI_NOT_FOUND) {
+      Data[Index]     = NULL;
+      DataSize[Index] = 0;
+    } else if (EFI_ERROR (VarStatus)) {
+      Status = FALSE;
+      break;
+    }
+
+    //
+    // The size is hashed too, so that the contents of adjacent variables
+    // cannot be mistaken for each other.
+    //
+    Status = Sha256Update (HashCtx, &DataSize[Index], sizeof (DataSize[Index]));
+    if (Status && (Data[Index] != NULL)) {
+      Status = Sha256Update (HashCtx, Data[Index], DataSize[Index]);
+    }
+  }
+  if (Status) {
+    Status = Sha256Final (HashCtx, Digest);
+  }
+  FreePool (HashCtx);
+
+  if (!Status) {
+    mSignatureIndexValid = FALSE;
+  } else if (!mSignatureIndexValid || (CompareMem (Digest, mSignatureDatabaseDigest, SHA256_DIGEST_SIZE) != 0)) {
+    //
+    // First use, or db/dbx/dbt were updated: index the new contents. The index
+    // keeps the buffers of db and dbx.
+    //
+    mSignatureIndexValid = TRUE;
+    for (Index = 0; Index < ARRAY_SIZE (mSignatureIndex); Index++) {
+      FreeSignatureDatabaseIndex (&mSignatureIndex[Index]);
+      mSignatureIndex[Index].Data     = Data[Index];
+      mSignatureIndex[Index].DataSize = DataSize[Index];
+      Data[Index] = NULL;
+      if (!BuildSignatureDatabaseIndex (&mSignatureIndex[Index])) {
+        mSignatureIndexValid = FALSE;
+      }
+    }
+    CopyMem (mSignatureDatabaseDigest, Digest, SHA256_DIGEST_SIZE);
+    DEBUG ((
+      DEBUG_INFO,
+      "DxeImageVerificationLib: Indexed %Lu db and %Lu dbx signatures\n",
+      (UINT64) mSignatureIndex[0].EntryCount,
+      (UINT64) mSignatureIndex[1].EntryCount
+      ));
+  }
+
+  //
+  // Read the databases again at the next verification if they could not be
+  // read now.
+  //
+  mSignatureDatabaseChanged = (BOOLEAN) !Status;
+
+  for (Index = 0; Index < ARRAY_SIZE (Data); Index++) {
+    if (Data[Index] != NULL) {
+      FreePool (Data[Index]);
+    }
+  }
+
+  return Status;
+}
+
+/**
+  Look up a signature in the index of a security database.
+
+  @param[in]   VariableName     The name of the database, db or dbx.
+  @param[in]   SignatureType    The type of the signature list to search.
+  @param[in]   SignatureData    The signature data to search for.
+  @param[in]   DataSize         The size of the signature data. Only the first
+                                DataSize bytes of the signatures are compared,
+                                e.g. the revocation time that follows the hash
+                                of a certificate is not.
+  @param[in]   SignatureSize    The size of the EFI_SIGNATURE_DATA of the lists
+                                to search, 0 to search the lists of any size.
+  @param[out]  SignatureList    The list holding the signature found.
+  @param[out]  Signature        The signature found, NULL if none.
+
+  @retval TRUE                  The index was searched.
+  @retval FALSE                 The index is not available; search the variable.
+
+**/
+BOOLEAN
+LookupSignatureDatabaseIndex (
+  IN  CHAR16              *VariableName,
+  IN  CONST EFI_GUID      *SignatureType,
+  IN  CONST UINT8         *SignatureData,
+  IN  UINTN               DataSize,
+  IN  UINTN               SignatureSize,
+  OUT EFI_SIGNATURE_LIST  **SignatureList,
+  OUT EFI_SIGNATURE_DATA  **Signature
+  )
+{
+  SIGNATURE_DATABASE_INDEX  *DatabaseIndex;
+  SIGNATURE_INDEX_ENTRY     *Entry;
+  UINT32                    EntryIndex;
+  UINTN                     Index;
+  UINTN                     HashSize;
+
+  *SignatureList = NULL;
+  *Signature     = NULL;
+
+  if (!mSignatureIndexValid) {
+    return FALSE;
+  }
+
+  DatabaseIndex = NULL;
+  for (Index = 0; Index < ARRAY_SIZE (mSignatureIndex); Index++) {
+    if (StrCmp (VariableName, mSignatureIndex[Index].VariableName) == 0) {
+      DatabaseIndex = &mSignatureIndex[Index];
+      break;
+    }
+  }
+  if (DatabaseIndex == NULL) {
+    return FALSE;
+  }
+  if (DatabaseIndex->EntryCount == 0) {
+    return TRUE;
+  }
+
+  //
+  // The signatures hash their first SIGNATURE_INDEX_HASH_SIZE bytes, which must
+  // all be compared. If they are not, e.g. a short digest is searched in lists of
+  // any size, search the variable.
+  //
+  if (SignatureSize == 0) {
+    if (DataSize < SIGNATURE_INDEX_HASH_SIZE) {
+      return FALSE;
+    }
+    HashSize = SIGNATURE_INDEX_HASH_SIZE;
+  } else {
+    if (SignatureSize < sizeof (EFI_GUID) + DataSize) {
+      //
+      // No signature of that size holds that much data.
+      //
+      return TRUE;
+    }
+    HashSize = MIN (SignatureSize - sizeof (EFI_GUID), SIGNATURE_INDEX_HASH_SIZE);
+    if (HashSize > DataSize) {
+      return FALSE;
+    }
+  }
+
+  EntryIndex = DatabaseIndex->Buckets[
+                 SignatureIndexHash (SignatureType, SignatureData, HashSize) & (UINT32) (DatabaseIndex->BucketCount - 1)
+                 ];
+  while (EntryIndex != MAX_UINT32) {
+    Entry = &DatabaseIndex->Entries[EntryIndex];
+    if (((SignatureSize == 0) ?
+         (Entry->SignatureList->SignatureSize >= sizeof (EFI_GUID) + DataSize) :
+         (Entry->SignatureList->SignatureSize == SignatureSize)) &&
+        CompareGuid (&Entry->SignatureList->SignatureType, SignatureType) &&
+        (CompareMem (Entry->Signature->SignatureData, SignatureData, DataSize) == 0)) {
+      *SignatureList = Entry->SignatureList;
+      *Signature     = Entry->Signature;
+      break;
+    }
+    EntryIndex = DatabaseIndex->Next[EntryIndex];
+  }
+
+  return TRUE;
+}
@@ -0,0 +1,741 @@
+/** @file
+  Unit tests of the index of the signatures in the image security databases.
+  The lookups through the index are compared with the scan of the signature
+  lists, both are timed on dbx databases of growing size, and the databases
+  are checked to be read again only after a variable write.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "../DxeImageVerificationLib.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "Image Security Database Index Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// The test databases hold SHA256 hashes in lists of at most TEST_LIST_HASH_COUNT
+// entries, and one X509 list whose certificates start like the hashes.
+//
+#define TEST_LIST_HASH_COUNT      1000
+#define TEST_DB_HASH_COUNT        64
+#define TEST_DBX_HASH_COUNT       3000
+#define TEST_CERT_SIZE            64
+#define TEST_CERT_COUNT           4
+
+//
+// The timed lookups, in dbx databases of 100 to 10000 hashes.
+//
+#define TEST_TIMED_DATABASE_COUNT 3
+#define TEST_TIMED_LOOKUP_COUNT   10000
+
+extern SIGNATURE_DATABASE_INDEX  mSignatureIndex[];
+extern BOOLEAN                   mSignatureIndexValid;
+extern BOOLEAN                   mSignatureDatabaseChanged;
+
+//
+// Contents of db, dbx and dbt returned by GetVariable2 (), NULL if the variable
+// does not exist.
+//
+VOID    *mDatabaseData[3];
+UINTN   mDatabaseSize[3];
+UINTN   mDatabaseReadCount;
+
+/**
+  Returns a pointer to the contents of an image security database.
+
+  @param[in]   Name   The name of the variable.
+  @param[in]   Guid   The vendor GUID of the variable.
+  @param[out]  Value  On return, a copy of the contents of the variable.
+  @param[out]  Size   On return, the size of the variable.
+
+  @retval EFI_SUCCESS           The variable is returned.
+  @retval EFI_NOT_FOUND         The variable does not exist.
+  @retval EFI_OUT_OF_RESOURCES  No memory for the copy.
+**/
+EFI_STATUS
+EFIAPI
+GetVariable2 (
+  IN CONST CHAR16    *Name,
+  IN CONST EFI_GUID  *Guid,
+  OUT VOID           **Value,
+  OUT UINTN          *Size OPTIONAL
+  )
+{
+  UINTN   Index;
+
+  *Value = NULL;
+  if (!CompareGuid (Guid, &gEfiImageSecurityDatabaseGuid)) {
+    return EFI_NOT_FOUND;
+  }
+  if (StrCmp (Name, EFI_IMAGE_SECURITY_DATABASE) == 0) {
+    Index = 0;
+  } else if (StrCmp (Name, EFI_IMAGE_SECURITY_DATABASE1) == 0) {
+    Index = 1;
+  } else if (StrCmp (Name, EFI_IMAGE_SECURITY_DATABASE2) == 0) {
+    Index = 2;
+  } else {
+    return EFI_NOT_FOUND;
+  }
+
+  mDatabaseReadCount++;
+  if (mDatabaseData[Index] == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  *Value = AllocateCopyPool (mDatabaseSize[Index], mDatabaseData[Index]);
+  if (*Value == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  if (Size != NULL) {
+    *Size = mDatabaseSize[Index];
+  }
+  return EFI_SUCCESS;
+}
+
+//
+// The digest of the databases only has to change with their contents, so the
+// test replaces SHA256 with four interleaved FNV-1a hashes.
+//
+
+/**
+  Returns the size of the hash context.
+
+  @return The size of the hash context.
+**/
+UINTN
+EFIAPI
+Sha256GetContextSize (
+  VOID
+  )
+{
+  return SHA256_DIGEST_SIZE;
+}
+
+/**
+  Initializes a hash context.
+
+  @param[out]  Sha256Context  The hash context.
+
+  @retval TRUE                The context is initialized.
+**/
+BOOLEAN
+EFIAPI
+Sha256Init (
+  OUT  VOID  *Sha256Context
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < SHA256_DIGEST_SIZE / sizeof (UINT64); Index++) {
+    ((UINT64 *) Sha256Context)[Index] = 0xCBF29CE484222325ULL + Index;
+  }
+  return TRUE;
+}
+
+/**
+  Hashes data into a hash context.
+
+  @param[in, out]  Sha256Context  The hash context.
+  @param[in]       Data           The data to hash.
+  @param[in]       DataSize       The size of the data.
+
+  @retval TRUE                    The data is hashed.
+**/
+BOOLEAN
+EFIAPI
+Sha256Update (
+  IN OUT  VOID        *Sha256Context,
+  IN      CONST VOID  *Data,
+  IN      UINTN       DataSize
+  )
+{
+  UINT64  *Hash;
+  UINTN   Index;
+
+  Hash = (UINT64 *) Sha256Context;
+  for (Index = 0; Index < DataSize; Index++) {
+    Hash[Index % 4] = MultU64x64 (Hash[Index % 4] ^ ((CONST UINT8 *) Data)[Index], 0x100000001B3ULL);
+  }
+  return TRUE;
+}
+
+/**
+  Returns the digest of a hash context.
+
+  @param[in, out]  Sha256Context  The hash context.
+  @param[out]      HashValue      The digest.
+
+  @retval TRUE                    The digest is returned.
+**/
+BOOLEAN
+EFIAPI
+Sha256Final (
+  IN OUT  VOID   *Sha256Context,
+  OUT     UINT8  *HashValue
+  )
+{
+  CopyMem (HashValue, Sha256Context, SHA256_DIGEST_SIZE);
+  return TRUE;
+}
+
+/**
+  Creates the SHA256 hash of a test image. The hashes of different numbers
+  differ in their first bytes.
+
+  @param[in]   Number  Number of the test image.
+  @param[out]  Hash    The SHA256_DIGEST_SIZE bytes of the hash.
+**/
+STATIC
+VOID
+CreateTestHash (
+  IN  UINTN  Number,
+  OUT UINT8  *Hash
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < SHA256_DIGEST_SIZE; Index++) {
+    Hash[Index] = (UINT8) ((Number >> ((Index % 4) * 8)) + Index * 0x3B);
+  }
+}
+
+/**
+  Creates the contents of a security database: the SHA256 hashes of the test
+  images FirstNumber to FirstNumber + HashCount - 1, in lists of at most
+  TEST_LIST_HASH_COUNT hashes, followed by an X509 list of TEST_CERT_COUNT
+  certificates that start with the hashes of the first images.
+
+  @param[in]   FirstNumber  Number of the first test image.
+  @param[in]   HashCount    Number of hashes.
+  @param[out]  DataSize     The size of the database.
+
+  @return The database, NULL if out of memory.
+**/
+STATIC
+VOID *
+CreateTestDatabase (
+  IN  UINTN  FirstNumber,
+  IN  UINTN  HashCount,
+  OUT UINTN  *DataSize
+  )
+{
+  UINT8               *Data;
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  UINTN               ListCount;
+  UINTN               Count;
+  UINTN               Number;
+  UINTN               Index;
+
+  ListCount = (HashCount + TEST_LIST_HASH_COUNT - 1) / TEST_LIST_HASH_COUNT;
+  *DataSize = ListCount * sizeof (EFI_SIGNATURE_LIST) +
+              HashCount * (sizeof (EFI_GUID) + SHA256_DIGEST_SIZE) +
+              sizeof (EFI_SIGNATURE_LIST) + TEST_CERT_COUNT * (sizeof (EFI_GUID) + TEST_CERT_SIZE);
+  Data = AllocateZeroPool (*DataSize);
+  if (Data == NULL) {
+    return NULL;
+  }
+
+  CertList = (EFI_SIGNATURE_LIST *) Data;
+  Number   = FirstNumber;
+  while (Number < FirstNumber + HashCount) {
+    Count = MIN (FirstNumber + HashCount - Number, TEST_LIST_HASH_COUNT);
+    CopyGuid (&CertList->SignatureType, &gEfiCertSha256Guid);
+    CertList->SignatureSize     = sizeof (EFI_GUID) + SHA256_DIGEST_SIZE;
+    CertList->SignatureListSize = (UINT32) (sizeof (EFI_SIGNATURE_LIST) + Count * CertList->SignatureSize);
+    Cert = (EFI_SIGNATURE_DATA *) (CertList + 1);
+    for (Index = 0; Index < Count; Index++) {
+      CreateTestHash (Number++, Cert->SignatureData);
+      Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+    }
+    CertList = (EFI_SIGNATURE_LIST *) Cert;
+  }
+
+  CopyGuid (&CertList->SignatureType, &gEfiCertX509Guid);
+  CertList->SignatureSize     = sizeof (EFI_GUID) + TEST_CERT_SIZE;
+  CertList->SignatureListSize = (UINT32) (sizeof (EFI_SIGNATURE_LIST) + TEST_CERT_COUNT * CertList->SignatureSize);
+  Cert = (EFI_SIGNATURE_DATA *) (CertList + 1);
+  for (Index = 0; Index < TEST_CERT_COUNT; Index++) {
+    CreateTestHash (FirstNumber + Index, Cert->SignatureData);
+    Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+  }
+
+  return Data;
+}
+
+/**
+  Scans the signature lists of a security database for a signature, like
+  IsSignatureFoundInDatabase () does without the index.
+
+  @param[in]  Data           The database.
+  @param[in]  DataSize       The size of the database.
+  @param[in]  SignatureType  The type of the signature list to search.
+  @param[in]  Signature      The signature data to search for.
+  @param[in]  SignatureSize  The size of the signature data.
+  @param[in]  AnySize        TRUE to search the lists of any size that hold
+                             SignatureSize bytes of data.
+
+  @return The signature found, NULL if none.
+**/
+STATIC
+EFI_SIGNATURE_DATA *
+ScanTestDatabase (
+  IN UINT8           *Data,
+  IN UINTN           DataSize,
+  IN CONST EFI_GUID  *SignatureType,
+  IN CONST UINT8     *Signature,
+  IN UINTN           SignatureSize,
+  IN BOOLEAN         AnySize
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  UINTN               CertCount;
+  UINTN               Index;
+
+  CertList = (EFI_SIGNATURE_LIST *) Data;
+  while ((DataSize > 0) && (DataSize >= CertList->SignatureListSize)) {
+    CertCount = (CertList->SignatureListSize - sizeof (EFI_SIGNATURE_LIST) - CertList->SignatureHeaderSize) / CertList->SignatureSize;
+    Cert      = (EFI_SIGNATURE_DATA *) ((UINT8 *) CertList + sizeof (EFI_SIGNATURE_LIST) + CertList->SignatureHeaderSize);
+    if ((AnySize ? (CertList->SignatureSize >= sizeof (EFI_GUID) + SignatureSize) :
+                   (CertList->SignatureSize == sizeof (EFI_GUID) + SignatureSize)) &&
+        CompareGuid (&CertList->SignatureType, SignatureType)) {
+      for (Index = 0; Index < CertCount; Index++) {
+        if (CompareMem (Cert->SignatureData, Signature, SignatureSize) == 0) {
+          return Cert;
+        }
+        Cert = (EFI_SIGNATURE_DATA *) ((UINT8 *) Cert + CertList->SignatureSize);
+      }
+    }
+    DataSize -= CertList->SignatureListSize;
+    CertList  = (EFI_SIGNATURE_LIST *) ((UINT8 *) CertList + CertList->SignatureListSize);
+  }
+  return NULL;
+}
+
+/**
+  Sets the contents of an image security database.
+
+  @param[in]  Index     0 for db, 1 for dbx, 2 for dbt.
+  @param[in]  Data      The new contents, NULL to delete the variable.
+  @param[in]  DataSize  The size of the new contents.
+**/
+STATIC
+VOID
+SetTestDatabase (
+  IN UINTN  Index,
+  IN VOID   *Data,
+  IN UINTN  DataSize
+  )
+{
+  if (mDatabaseData[Index] != NULL) {
+    FreePool (mDatabaseData[Index]);
+  }
+  mDatabaseData[Index] = Data;
+  mDatabaseSize[Index] = DataSize;
+}
+
+/**
+  Creates db and dbx, and marks them as changed.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED                 The databases are created.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  Out of memory.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetupDatabases (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VOID    *Data;
+  UINTN   DataSize;
+
+  Data = CreateTestDatabase (0, TEST_DB_HASH_COUNT, &DataSize);
+  if (Data == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  SetTestDatabase (0, Data, DataSize);
+
+  Data = CreateTestDatabase (TEST_DB_HASH_COUNT / 2, TEST_DBX_HASH_COUNT, &DataSize);
+  if (Data == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  SetTestDatabase (1, Data, DataSize);
+  SetTestDatabase (2, NULL, 0);
+
+  SignatureDatabaseChangedNotify (NULL, NULL);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Frees the databases.
+
+  @param[in]  Context  Unused.
+**/
+STATIC
+VOID
+EFIAPI
+CleanupDatabases (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mDatabaseData); Index++) {
+    SetTestDatabase (Index, NULL, 0);
+  }
+}
+
+/**
+  Looks up a SHA256 hash through the index and through the scan of the
+  database, and checks that both find the same signature.
+
+  @param[in]  DatabaseIndex  0 for db, 1 for dbx.
+  @param[in]  SignatureType  The type of the signature list to search.
+  @param[in]  Hash           The SHA256 hash to look up.
+  @param[in]  AnySize        TRUE to search the lists of any size.
+
+  @retval UNIT_TEST_PASSED  Both lookups find the same signature.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckLookup (
+  IN UINTN           DatabaseIndex,
+  IN CONST EFI_GUID  *SignatureType,
+  IN UINT8           *Hash,
+  IN BOOLEAN         AnySize
+  )
+{
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  EFI_SIGNATURE_DATA  *Scanned;
+  UINTN               Offset;
+
+  UT_ASSERT_TRUE (
+    LookupSignatureDatabaseIndex (
+      mSignatureIndex[DatabaseIndex].VariableName,
+      SignatureType,
+      Hash,
+      SHA256_DIGEST_SIZE,
+      AnySize ? 0 : sizeof (EFI_GUID) + SHA256_DIGEST_SIZE,
+      &CertList,
+      &Cert
+      )
+    );
+  Scanned = ScanTestDatabase (
+              mDatabaseData[DatabaseIndex],
+              mDatabaseSize[DatabaseIndex],
+              SignatureType,
+              Hash,
+              SHA256_DIGEST_SIZE,
+              AnySize
+              );
+  if (Scanned == NULL) {
+    UT_ASSERT_TRUE (Cert == NULL);
+  } else {
+    //
+    // The index holds its own copy of the database.
+    //
+    UT_ASSERT_NOT_NULL (Cert);
+    Offset = (UINTN) Scanned - (UINTN) mDatabaseData[DatabaseIndex];
+    UT_ASSERT_EQUAL ((UINTN) Cert, (UINTN) mSignatureIndex[DatabaseIndex].Data + Offset);
+  }
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Looks up the hashes of images that are in db, in dbx, in both and in none,
+  through the index and through the scan, and checks that both agree.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The index lookups match the scan.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+IndexLookupMatchesScan (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8             Digest[SHA256_DIGEST_SIZE];
+  UINT8             Hash[SHA256_DIGEST_SIZE];
+  UINTN             Number;
+  UINTN             DatabaseIndex;
+  UNIT_TEST_STATUS  Status;
+
+  UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (Digest));
+  UT_ASSERT_TRUE (mSignatureIndexValid);
+  UT_ASSERT_EQUAL (mSignatureIndex[0].EntryCount, TEST_DB_HASH_COUNT + TEST_CERT_COUNT);
+  UT_ASSERT_EQUAL (mSignatureIndex[1].EntryCount, TEST_DBX_HASH_COUNT + TEST_CERT_COUNT);
+
+  for (Number = 0; Number < TEST_DB_HASH_COUNT + TEST_DBX_HASH_COUNT + 100; Number++) {
+    CreateTestHash (Number, Hash);
+    for (DatabaseIndex = 0; DatabaseIndex < 2; DatabaseIndex++) {
+      Status = CheckLookup (DatabaseIndex, &gEfiCertSha256Guid, Hash, FALSE);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+      Status = CheckLookup (DatabaseIndex, &gEfiCertX509Guid, Hash, TRUE);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+      Status = CheckLookup (DatabaseIndex, &gEfiCertSha384Guid, Hash, TRUE);
+      if (Status != UNIT_TEST_PASSED) {
+        return Status;
+      }
+    }
+  }
+
+  //
+  // A hash that differs from a listed one after the bytes of the index hash.
+  //
+  CreateTestHash (TEST_DB_HASH_COUNT, Hash);
+  Hash[SHA256_DIGEST_SIZE - 1] ^= 1;
+  return CheckLookup (1, &gEfiCertSha256Guid, Hash, FALSE);
+}
+
+/**
+  Checks that the databases are only read again after a variable write, that
+  the index is kept when they did not change, and that it reflects a change.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The databases are read when expected.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+IndexRefreshedOnVariableWrite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8                  Digest[SHA256_DIGEST_SIZE];
+  UINT8                  NewDigest[SHA256_DIGEST_SIZE];
+  UINT8                  Hash[SHA256_DIGEST_SIZE];
+  SIGNATURE_INDEX_ENTRY  *Entries;
+  EFI_SIGNATURE_LIST     *CertList;
+  EFI_SIGNATURE_DATA     *Cert;
+  VOID                   *Data;
+  UINTN                  DataSize;
+  UINTN                  Verification;
+
+  mDatabaseReadCount = 0;
+  UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (Digest));
+  UT_ASSERT_EQUAL (mDatabaseReadCount, 3);
+  Entries = mSignatureIndex[1].Entries;
+
+  //
+  // No variable write: no read.
+  //
+  for (Verification = 0; Verification < 10; Verification++) {
+    UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (NewDigest));
+    UT_ASSERT_MEM_EQUAL (NewDigest, Digest, SHA256_DIGEST_SIZE);
+  }
+  UT_ASSERT_EQUAL (mDatabaseReadCount, 3);
+
+  //
+  // A write to another variable: read once, same digest, index kept.
+  //
+  SignatureDatabaseChangedNotify (NULL, NULL);
+  UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (NewDigest));
+  UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (NewDigest));
+  UT_ASSERT_EQUAL (mDatabaseReadCount, 6);
+  UT_ASSERT_MEM_EQUAL (NewDigest, Digest, SHA256_DIGEST_SIZE);
+  UT_ASSERT_EQUAL ((UINTN) mSignatureIndex[1].Entries, (UINTN) Entries);
+
+  //
+  // A dbx update: the new hash is found after the write is signaled.
+  //
+  CreateTestHash (TEST_DB_HASH_COUNT / 2 + TEST_DBX_HASH_COUNT, Hash);
+  UT_ASSERT_TRUE (LookupSignatureDatabaseIndex (EFI_IMAGE_SECURITY_DATABASE1, &gEfiCertSha256Guid, Hash, SHA256_DIGEST_SIZE, sizeof (EFI_GUID) + SHA256_DIGEST_SIZE, &CertList, &Cert));
+  UT_ASSERT_TRUE (Cert == NULL);
+
+  Data = CreateTestDatabase (TEST_DB_HASH_COUNT / 2, TEST_DBX_HASH_COUNT + 1, &DataSize);
+  UT_ASSERT_NOT_NULL (Data);
+  SetTestDatabase (1, Data, DataSize);
+  SignatureDatabaseChangedNotify (NULL, NULL);
+  UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (NewDigest));
+  UT_ASSERT_EQUAL (mDatabaseReadCount, 9);
+  UT_ASSERT_TRUE (CompareMem (NewDigest, Digest, SHA256_DIGEST_SIZE) != 0);
+  UT_ASSERT_TRUE (LookupSignatureDatabaseIndex (EFI_IMAGE_SECURITY_DATABASE1, &gEfiCertSha256Guid, Hash, SHA256_DIGEST_SIZE, sizeof (EFI_GUID) + SHA256_DIGEST_SIZE, &CertList, &Cert));
+  UT_ASSERT_NOT_NULL (Cert);
+
+  //
+  // A dbt update changes the digest but not the index.
+  //
+  Data = CreateTestDatabase (0, 1, &DataSize);
+  UT_ASSERT_NOT_NULL (Data);
+  SetTestDatabase (2, Data, DataSize);
+  SignatureDatabaseChangedNotify (NULL, NULL);
+  CopyMem (Digest, NewDigest, SHA256_DIGEST_SIZE);
+  UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (NewDigest));
+  UT_ASSERT_TRUE (CompareMem (NewDigest, Digest, SHA256_DIGEST_SIZE) != 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Times the lookups of hashes, half of them listed, through the index or
+  through the scan of dbx.
+
+  @param[in]  HashCount  Number of hashes in dbx.
+  @param[in]  UseIndex   TRUE to look up through the index, FALSE to scan dbx.
+
+  @return The average time of a lookup in nanoseconds.
+**/
+STATIC
+UINT64
+TimeLookups (
+  IN UINTN    HashCount,
+  IN BOOLEAN  UseIndex
+  )
+{
+  UINT8               Hash[SHA256_DIGEST_SIZE];
+  EFI_SIGNATURE_LIST  *CertList;
+  EFI_SIGNATURE_DATA  *Cert;
+  UINTN               Lookup;
+  clock_t             Start;
+  clock_t             Elapsed;
+
+  Start = clock ();
+  for (Lookup = 0; Lookup < TEST_TIMED_LOOKUP_COUNT; Lookup++) {
+    CreateTestHash ((Lookup * 7919) % (HashCount * 2), Hash);
+    if (UseIndex) {
+      LookupSignatureDatabaseIndex (EFI_IMAGE_SECURITY_DATABASE1, &gEfiCertSha256Guid, Hash, SHA256_DIGEST_SIZE, sizeof (EFI_GUID) + SHA256_DIGEST_SIZE, &CertList, &Cert);
+    } else {
+      ScanTestDatabase (mDatabaseData[1], mDatabaseSize[1], &gEfiCertSha256Guid, Hash, SHA256_DIGEST_SIZE, FALSE);
+    }
+  }
+  Elapsed = clock () - Start;
+
+  return DivU64x32 (MultU64x32 ((UINT64) Elapsed, 1000000000 / TEST_TIMED_LOOKUP_COUNT), CLOCKS_PER_SEC);
+}
+
+/**
+  Times the lookups through the index and through the scan in dbx databases of
+  100 to 10000 hashes.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED  The databases are indexed.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+IndexLookupLatency (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8   Digest[SHA256_DIGEST_SIZE];
+  VOID    *Data;
+  UINTN   DataSize;
+  UINTN   HashCount;
+  UINTN   Round;
+  UINT64  ScanTime;
+  UINT64  IndexTime;
+
+  HashCount = 100;
+  for (Round = 0; Round < TEST_TIMED_DATABASE_COUNT; Round++, HashCount *= 10) {
+    Data = CreateTestDatabase (0, HashCount, &DataSize);
+    UT_ASSERT_NOT_NULL (Data);
+    SetTestDatabase (1, Data, DataSize);
+    SignatureDatabaseChangedNotify (NULL, NULL);
+    UT_ASSERT_TRUE (RefreshSignatureDatabaseIndex (Digest));
+    UT_ASSERT_EQUAL (mSignatureIndex[1].EntryCount, HashCount + TEST_CERT_COUNT);
+
+    ScanTime  = TimeLookups (HashCount, FALSE);
+    IndexTime = TimeLookups (HashCount, TRUE);
+    UT_LOG_INFO ("%5Lu dbx hashes: scan %Lu ns, index %Lu ns\n", (UINT64) HashCount, ScanTime, IndexTime);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the index of
+  the image security databases and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Setup the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the signature index Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "Image Security Database Index Tests", "ImageVerification.Index", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+  AddTestCase (IndexTests, "Index should match the scan of db and dbx",           "MatchScan", IndexLookupMatchesScan,        SetupDatabases, CleanupDatabases, NULL);
+  AddTestCase (IndexTests, "Databases should only be read after variable writes", "Refresh",   IndexRefreshedOnVariableWrite, SetupDatabases, CleanupDatabases, NULL);
+  AddTestCase (IndexTests, "Index lookup latency against dbx size",               "Latency",   IndexLookupLatency,            SetupDatabases, CleanupDatabases, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+
+  @param Argc  Number of arguments.
+  @param Argv  Array of arguments.
+
+  @return Test application exit code.
+**/
+INT32
+main (
+  INT32 Argc,
+  CHAR8 *Argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
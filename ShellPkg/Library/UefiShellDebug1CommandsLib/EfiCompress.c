@@ -2,13 +2,13 @@
   Main file for EfiCompress shell Debug1 function.
 
   (C) Copyright 2015 Hewlett-Packard Development Company, L.P.<BR>
-  Copyright (c) 2005 - 2018, Intel Corporation. All rights reserved.<BR>
+  Copyright (c) 2005 - 2020, Intel Corporation. All rights reserved.<BR>
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 
 #include "UefiShellDebug1CommandsLib.h"
-#include "Compress.h"
+#include <Library/UefiCompressLib.h>
 
 /**
   Function for 'compress' command.
@@ -117,13 +117,13 @@ ShellCommandRunEfiCompress (
             Status = gEfiShellProtocol->ReadFile (InShellFileHandle, &InSize2, InBuffer);
             InSize = InSize2;
             ASSERT_EFI_ERROR (Status);
-            Status = Compress (InBuffer, InSize, OutBuffer, &OutSize);
+            Status = UefiCompress (InBuffer, InSize, OutBuffer, &OutSize);
             if (Status == EFI_BUFFER_TOO_SMALL) {
               OutBuffer = AllocateZeroPool ((UINTN) OutSize);
               if (OutBuffer == NULL) {
                 Status = EFI_OUT_OF_RESOURCES;
               } else {
-                Status = Compress (InBuffer, InSize, OutBuffer, &OutSize);
+                Status = UefiCompress (InBuffer, InSize, OutBuffer, &OutSize);
               }
             }
           }